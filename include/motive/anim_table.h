@@ -15,7 +15,11 @@
 #ifndef MOTIVE_ANIM_TABLE_H_
 #define MOTIVE_ANIM_TABLE_H_
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -25,6 +29,7 @@ namespace motive {
 
 struct AnimTableFb;
 struct AnimListFb;
+struct RigAnimFb;
 class TableDescriberInterface;
 
 /// @class AnimTable
@@ -41,7 +46,11 @@ class TableDescriberInterface;
 /// (e.g. idle, walk forward, jump, etc.).
 ///
 /// Duplicate animations are only loaded once. This allows different objects
-/// to use the same animations without any memory overhead.
+/// to use the same animations without any memory overhead. Animations listed
+/// under the same source name share an entry, and in eagerly-loaded tables,
+/// byte-identical payloads listed under *different* names also resolve to
+/// one shared RigAnim, via RigAnim::ContentHash(). Clips exported once per
+/// character--every humanoid's idle, say--therefore cost their memory once.
 class AnimTable {
  public:
   // Array of animations corresponding to `anim_idx`.
@@ -65,8 +74,89 @@ class AnimTable {
   ///
   typedef const char* LoadFn(const char* file_name, std::string* scratch_buf);
 
+  /// How animation buffers returned by `LoadFn` are checked before
+  /// conversion. See SetBufferVerification().
+  enum BufferVerification {
+    kTrustBuffers,   ///< No checks. Suitable when the build pipeline already
+                     ///< verified the buffers at pack time. The default.
+    kVerifyBuffers,  ///< Run the flatbuffers verifier on every loaded buffer
+                     ///< before conversion.
+    kVerifyByHash,   ///< Compare each buffer's HashAnimBuffer() against the
+                     ///< pack-time hash from `hash_fn`, and run the full
+                     ///< verifier only when the hash is unknown (`hash_fn`
+                     ///< returned 0) or does not match.
+  };
+
+  /// Callback that returns the expected HashAnimBuffer() of the animation
+  /// file `file_name`, as recorded at pack time, or 0 if unknown.
+  typedef uint64_t HashFn(const char* file_name);
+
+  /// Callback that loads the baked-cache entry for the animation file
+  /// `file_name` into `out_buf`. Returns false when no entry exists.
+  typedef bool CacheReadFn(const char* file_name, std::string* out_buf);
+
+  /// Callback that stores `num_bytes` bytes at `bytes` as the baked-cache
+  /// entry for the animation file `file_name`.
+  typedef void CacheWriteFn(const char* file_name, const void* bytes,
+                            size_t num_bytes);
+
+  AnimTable();
   ~AnimTable();
 
+  /// Set how loaded animation buffers are checked before conversion. Must be
+  /// called before any of the Init*() functions; the mode is read by the
+  /// streaming loader thread without locking.
+  ///
+  /// In streaming mode, buffers are checked on the loader thread as each
+  /// animation streams in, so only animations that are actually played pay
+  /// for verification. `hash_fn` is only consulted in kVerifyByHash mode,
+  /// and is called on the loader thread, so it must be safe to call there.
+  ///
+  /// Note: the buffer length is only known when the load function returns
+  /// its data through `scratch_buf`. Buffers returned from other memory
+  /// cannot be measured, and so are trusted in every mode.
+  void SetBufferVerification(BufferVerification verification,
+                             HashFn* hash_fn = nullptr) {
+    buffer_verification_ = verification;
+    hash_fn_ = hash_fn;
+  }
+
+  /// Skip materializing debug strings--the animation name and the per-bone
+  /// names--when loading, and do not build the string-keyed name map. Must
+  /// be called before any of the Init*() functions. Servers and shipping
+  /// builds that never print names reclaim the string share of animation
+  /// memory and shorten load deserialization.
+  ///
+  /// By-hash and by-handle queries are unaffected, and QueryByName() still
+  /// works: it hashes the requested name and resolves through the hash
+  /// index. RigAnim::anim_name() returns an empty string and BoneName()
+  /// "unknown"; read names on demand from the original animation buffers
+  /// with AnimNameFromAnimBuffer() and BoneNameFromAnimBuffer() instead.
+  void SetStripDebugNames(bool strip) { strip_debug_names_ = strip; }
+
+  /// Cache fully built animations between runs. Must be called before any
+  /// of the Init*() functions.
+  ///
+  /// FlatBuffer conversion--building every RigAnim, MatrixAnim, and
+  /// spline--dominates table load time. With a cache set, each animation
+  /// converted from a file is baked (see io/baked_anim.h) and handed to
+  /// `write_fn`; on later runs `read_fn` supplies the baked image and the
+  /// animation is rebuilt in one pass of bulk copies, skipping loading and
+  /// converting the FlatBuffer entirely. A stale image--wrong format
+  /// version or a `build_id` other than the one passed here--falls back to
+  /// conversion and is re-baked, so `build_id` should change whenever the
+  /// source animations do, e.g. a content-pipeline build stamp.
+  ///
+  /// Embedded animations convert quickly in place and are never cached. In
+  /// streaming mode the callbacks run on the loader thread, so they must be
+  /// safe to call there.
+  void SetBakedAnimCache(CacheReadFn* read_fn, CacheWriteFn* write_fn,
+                         uint64_t build_id) {
+    baked_read_fn_ = read_fn;
+    baked_write_fn_ = write_fn;
+    baked_build_id_ = build_id;
+  }
+
   /// Load the AnimTable specified in the FlatBuffer `params`.
   /// For each animation in the AnimTable, `load_fn` is called to get the
   /// to load the individual animation files, if they're not embedded in
@@ -87,6 +177,30 @@ class AnimTable {
   /// Load the AnimTable for only one `object`.
   bool InitFromAnimFileNames(const ListFileNames& list_names, LoadFn* load_fn);
 
+  /// Initialize from file names without loading any animation payloads up
+  /// front. The name indices and the object/anim_idx table are built
+  /// immediately; the animations themselves are streamed in by a background
+  /// thread, in table order, with on-demand queries jumping the queue.
+  /// Query*() never blocks on I/O: until an animation's payload lands, a
+  /// Query(object, anim_idx) returns the object's defining animation as a
+  /// placeholder, and by-name/by-handle queries (which carry no object)
+  /// return nullptr.
+  ///
+  /// Defining animations are the union of every animation on an object, so
+  /// they are computed once the initial stream completes; check
+  /// DefiningAnimsReady() or call BlockUntilAllLoaded() before initializing
+  /// rigs. The memory budget (SetMemoryBudget()) is enforced from that
+  /// point on, so the initial stream briefly holds the whole table.
+  ///
+  /// `load_fn` is called on the background thread, so it must be safe to
+  /// call there.
+  bool InitStreamingFromAnimFileNames(const TableFileNames& table_names,
+                                      LoadFn* load_fn);
+
+  /// Stream the animations for only one `object`.
+  bool InitStreamingFromAnimFileNames(const ListFileNames& list_names,
+                                      LoadFn* load_fn);
+
   /// Get an animation by index. This is fast and is the preferred way to
   /// look up an animation.
   /// @param object An enum defined by the caller specifying the object type.
@@ -102,16 +216,95 @@ class AnimTable {
   ///                 match between objects.
   const RigAnim* Query(int object, int anim_idx) const {
     const AnimIndex idx = CalculateIndex(object, anim_idx);
-    return idx == kInvalidAnimIndex ? nullptr : anims_[idx];
+    if (idx == kInvalidAnimIndex) return nullptr;
+    if (streaming_) {
+      return const_cast<AnimTable*>(this)->QueryStreaming(idx, object);
+    }
+    return anims_[idx];
   }
 
+  /// Opaque token for one animation in this table. Query one with Handle(),
+  /// cache it, and play repeatedly via Query(AnimHandle) with no lookup at
+  /// all. Handles stay valid for the lifetime of the table.
+  typedef uint16_t AnimHandle;
+  static const AnimHandle kInvalidAnimHandle = static_cast<AnimHandle>(-1);
+
   /// Get an animation by name. This is slow and should be avoided when
-  /// possible.
+  /// possible; on hot paths, look up a Handle() once and cache it, or use
+  /// QueryByHash() with hashes baked into your content.
   const RigAnim* QueryByName(const char* anim_name) const {
     return const_cast<AnimTable*>(this)->QueryByName(anim_name);
   }
 
+  /// Get an animation by the hash of its name, in O(1) and without touching
+  /// any strings. `name_hash` is HashAnimName() of the animation's name;
+  /// since the hash is stable across runs and platforms, it can be computed
+  /// at build time and stored in content instead of the name itself.
+  const RigAnim* QueryByHash(uint64_t name_hash) const {
+    return Query(HandleByHash(name_hash));
+  }
+
+  /// Get an animation from a cached token. O(1), no hashing: just an array
+  /// index. Returns nullptr for kInvalidAnimHandle, or in streaming mode,
+  /// while the animation's payload has not streamed in yet.
+  const RigAnim* Query(AnimHandle handle) const {
+    if (handle == kInvalidAnimHandle) return nullptr;
+    if (streaming_) {
+      return const_cast<AnimTable*>(this)->QueryStreaming(handle, -1);
+    }
+    return anims_[handle];
+  }
+
+  /// Return the token for the animation called `anim_name`, or
+  /// kInvalidAnimHandle if the table holds no such animation.
+  AnimHandle Handle(const char* anim_name) const {
+    return HandleByHash(HashAnimName(anim_name));
+  }
+
+  /// Return the token for the animation whose name hashes to `name_hash`.
+  AnimHandle HandleByHash(uint64_t name_hash) const {
+    auto it = hash_map_.find(name_hash);
+    return it == hash_map_.end() ? kInvalidAnimHandle
+                                 : static_cast<AnimHandle>(it->second);
+  }
+
+  /// Hash used by the by-hash index: 64-bit FNV-1a of the animation name.
+  /// Stable across runs and platforms, so build tools can bake the hashes
+  /// into content.
+  static uint64_t HashAnimName(const char* anim_name);
+
+  /// Keep resident animation payloads under `bytes` (approximately), by
+  /// evicting the least-recently-played, unpinned animations. An evicted
+  /// animation streams back in on its next query. 0 (the default) means no
+  /// limit. Only meaningful in streaming mode. Pin() any animation a
+  /// motivator is currently playing: eviction frees the animation's splines,
+  /// which a playing motivator would still be reading.
+  void SetMemoryBudget(size_t bytes);
+
+  /// Prevent the animation from being evicted, e.g. while a motivator is
+  /// playing it. Pins nest: an animation is evictable again once Unpin()
+  /// has been called once per Pin().
+  void Pin(AnimHandle handle);
+  void Unpin(AnimHandle handle);
+
+  /// True once the animation's payload is resident. Always true for tables
+  /// loaded eagerly. Poll this after a Query() returned the placeholder.
+  bool IsLoaded(AnimHandle handle) const;
+
+  /// Block until the animation's payload is resident, or its load failed.
+  /// The request jumps to the front of the streaming queue.
+  void BlockUntilLoaded(AnimHandle handle);
+
+  /// Block until every animation has streamed in at least once and the
+  /// defining animations have been computed.
+  void BlockUntilAllLoaded();
+
+  /// True once DefiningAnim() is valid: immediately for tables loaded
+  /// eagerly, and once the initial stream completes in streaming mode.
+  bool DefiningAnimsReady() const;
+
   /// Return animation that defines the complete rig of this object.
+  /// In streaming mode, only valid once DefiningAnimsReady().
   const RigAnim& DefiningAnim(int object) const {
     return defining_anims_[object];
   }
@@ -134,18 +327,66 @@ class AnimTable {
   typedef uint16_t AnimIndex;
   typedef std::vector<AnimIndex> AnimList;
   typedef std::pair<std::string, AnimIndex> NameToIndex;
+  typedef std::pair<uint64_t, AnimIndex> HashToIndex;
   static const AnimIndex kInvalidAnimIndex = static_cast<AnimIndex>(-1);
 
+  /// Residency of one animation's payload, in streaming mode.
+  enum AnimState {
+    kAnimUnloaded,  ///< No payload; will be queued on the next query.
+    kAnimQueued,    ///< Waiting for the loader thread.
+    kAnimLoading,   ///< The loader thread is reading the file right now.
+    kAnimResident   ///< Payload loaded; the anims_ entry is valid.
+  };
+
   bool Load(TableDescriberInterface* describer, LoadFn* load_fn);
+  bool LoadStreaming(TableDescriberInterface* describer, LoadFn* load_fn);
+  const RigAnimFb* VerifiedRigAnimFb(const char* anim_buf,
+                                     const std::string& scratch_buf,
+                                     const char* file_name) const;
+  RigAnim* LoadAndConvertAnim(const char* file_name, LoadFn* load_fn,
+                              std::string* scratch_buf) const;
+  const RigAnim* QueryStreaming(AnimIndex idx, int object);
+  void LoaderThread();
+  void EnqueueFrontLocked(AnimIndex idx);
+  void EvictOverBudgetLocked();
+  void StopLoaderThread();
   void AnimNames(std::vector<const char*>* anim_names) const;
   size_t MaxAnimIndex() const;
   size_t GatherObjectAnims(int object, const RigAnim** anims) const;
   void CalculateDefiningAnims();
 
+  /// Return the index registered for `anim_name`, or kInvalidAnimIndex.
+  /// When debug names are stripped, the string-keyed map is not built, so
+  /// the lookup goes through the hash index instead.
+  AnimIndex FindRegisteredName(const char* anim_name) const {
+    if (strip_debug_names_) {
+      const auto entry = hash_map_.find(HashAnimName(anim_name));
+      return entry == hash_map_.end() ? kInvalidAnimIndex : entry->second;
+    }
+    const auto entry = name_map_.find(anim_name);
+    return entry == name_map_.end() ? kInvalidAnimIndex : entry->second;
+  }
+
+  /// Register `anim_name` as resolving to `idx`, in the name map (unless
+  /// debug names are stripped) and always in the hash index.
+  void RegisterAnimName(const char* anim_name, AnimIndex idx) {
+    if (!strip_debug_names_) {
+      name_map_.insert(NameToIndex(anim_name, idx));
+    }
+    // Two distinct names hashing identically would alias each other;
+    // that's an authoring error, caught here.
+    const uint64_t name_hash = HashAnimName(anim_name);
+    assert(hash_map_.find(name_hash) == hash_map_.end());
+    hash_map_.insert(HashToIndex(name_hash, idx));
+  }
+
   RigAnim* QueryByName(const char* anim_name) {
-    auto map_entry = name_map_.find(anim_name);
-    if (map_entry == name_map_.end()) return nullptr;
-    return anims_[map_entry->second];
+    const AnimIndex idx = FindRegisteredName(anim_name);
+    if (idx == kInvalidAnimIndex) return nullptr;
+    if (streaming_) {
+      return const_cast<RigAnim*>(QueryStreaming(idx, -1));
+    }
+    return anims_[idx];
   }
 
   AnimIndex CalculateIndex(int object, int anim_idx) const {
@@ -167,11 +408,106 @@ class AnimTable {
 
   /// Map animation name to an animation index.
   /// Used for by-name lookups, and to avoid duplicate copies of the same
-  /// animation.
+  /// animation. Not built when SetStripDebugNames(true); hash_map_ serves
+  /// both roles then.
   std::unordered_map<std::string, AnimIndex> name_map_;
 
-  /// Animation data. Contains no duplicate entries, thanks to name_map_.
+  /// Map HashAnimName() of the animation name to an animation index.
+  /// Precomputed at load so that QueryByHash() and Handle() never touch the
+  /// name strings. Content with sparse, string-keyed anim ids can use this
+  /// index exclusively and ignore the dense object/anim_idx table.
+  std::unordered_map<uint64_t, AnimIndex> hash_map_;
+
+  /// Map RigAnim::ContentHash() to an animation index, so byte-identical
+  /// payloads loaded under different names share one RigAnim. Only filled
+  /// by eager loads: streamed animations are evicted and restored per
+  /// index, so aliasing them would complicate residency bookkeeping.
+  std::unordered_map<uint64_t, AnimIndex> content_map_;
+
+  /// Animation data. Contains no duplicate entries, thanks to name_map_
+  /// and content_map_. In streaming mode, entries are nullptr until their
+  /// payload lands, and again after eviction.
   std::vector<RigAnim*> anims_;
+
+  // Streaming state. Idle unless InitStreamingFromAnimFileNames() was used.
+  // All of it--except `streaming_` itself, which is set once at init--is
+  // guarded by `stream_mutex_`, since the loader thread and query threads
+  // touch it concurrently.
+
+  /// True if this table streams payloads in on a background thread.
+  bool streaming_;
+
+  /// See SetBufferVerification(). Set once before Init*(), and read-only
+  /// afterwards, so the loader thread reads it without locking.
+  BufferVerification buffer_verification_;
+
+  /// Pack-time content hashes for kVerifyByHash. Supplied by the caller.
+  HashFn* hash_fn_;
+
+  /// See SetStripDebugNames(). Set once before Init*(), and read-only
+  /// afterwards.
+  bool strip_debug_names_;
+
+  /// See SetBakedAnimCache(). Set once before Init*(), and read-only
+  /// afterwards, so the loader thread reads them without locking.
+  CacheReadFn* baked_read_fn_;
+  CacheWriteFn* baked_write_fn_;
+  uint64_t baked_build_id_;
+
+  /// Loads animation files on the loader thread. Supplied by the caller.
+  LoadFn* stream_load_fn_;
+
+  /// Source file per animation, for streaming and re-streaming after
+  /// eviction. Empty string for embedded animations, which are loaded
+  /// eagerly and never evicted.
+  std::vector<std::string> anim_file_names_;
+
+  /// AnimState per animation.
+  std::vector<uint8_t> anim_states_;
+
+  /// Approximate resident bytes per animation; 0 when not resident.
+  std::vector<size_t> anim_bytes_;
+
+  /// Eviction order: play_counter_ at each animation's last query.
+  std::vector<uint64_t> last_play_;
+
+  /// Nested Pin() counts. Pinned animations are never evicted.
+  std::vector<uint16_t> pin_counts_;
+
+  /// True until the animation has streamed in for the first time. Once all
+  /// are false, the defining animations can be computed.
+  std::vector<uint8_t> never_loaded_;
+
+  /// Animations waiting for the loader thread. On-demand requests are
+  /// pushed on the front; the initial whole-table stream fills the back.
+  std::deque<AnimIndex> load_queue_;
+
+  /// Monotonic stamp for last_play_.
+  uint64_t play_counter_;
+
+  /// See SetMemoryBudget(). 0 means no limit.
+  size_t memory_budget_;
+
+  /// Approximate bytes of resident animation payloads.
+  size_t resident_bytes_;
+
+  /// Number of animations that have never streamed in.
+  int num_never_loaded_;
+
+  /// True once defining_anims_ holds valid data.
+  bool defining_anims_ready_;
+
+  /// Tells the loader thread to exit.
+  bool quit_loader_;
+
+  std::thread loader_thread_;
+  mutable std::mutex stream_mutex_;
+
+  /// Signalled when work is added to load_queue_ (and on quit).
+  std::condition_variable stream_request_;
+
+  /// Signalled when a load finishes, successfully or not.
+  mutable std::condition_variable stream_complete_;
 };
 
 }  // namespace motive
@@ -0,0 +1,115 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_BAKED_CLIP_H_
+#define MOTIVE_BAKED_CLIP_H_
+
+#include <vector>
+
+#include "motive/common.h"
+#include "motive/matrix_op.h"
+
+namespace motive {
+
+class RigAnim;
+
+/// @class BakedClip
+/// @brief A RigAnim sampled at a fixed rate into a flat keyframe array.
+///
+/// Playback lerps between two neighboring baked frames and composes the bone
+/// matrices directly: no spline evaluation, no per-op motivators. This trades
+/// curve accuracy and memory for constant, cache-friendly per-frame cost, so
+/// it suits background characters--e.g. a large crowd at distance--while
+/// foreground characters keep playing the source splines through
+/// RigMotivator::BlendToAnim().
+///
+/// Bake once at load time, then play on any number of rigs via
+/// RigMotivator::PlayBakedClip(). The clip is immutable after Bake() and
+/// holds no pointers into the source anim, so the anim may be unloaded.
+class BakedClip {
+ public:
+  BakedClip()
+      : sample_period_(0),
+        clip_length_(0),
+        num_frames_(0),
+        repeat_(false) {}
+
+  /// Sample every channel of `anim` at intervals of `sample_period` (in the
+  /// same time units as the anim), from time 0 to the end of the anim's
+  /// longest spline. Spline-driven channels are sampled through
+  /// CompactSpline::BakeYs(); constant channels are replicated.
+  /// Memory is num_frames * NumOps() floats, so pick the coarsest
+  /// `sample_period` the clip's motion tolerates.
+  void Bake(const RigAnim& anim, MotiveTime sample_period);
+
+  /// Compose the local transform of every bone at `time` into `out`, which
+  /// must have NumBones() entries. Channel values are lerped between the two
+  /// neighboring baked frames. `time` wraps when the source anim repeats,
+  /// and clamps to the clip length otherwise.
+  void EvalLocalTransforms(MotiveTime time, mathfu::mat4* out) const;
+
+  BoneIndex NumBones() const {
+    return static_cast<BoneIndex>(bone_parents_.size());
+  }
+
+  /// Same layout as RigAnim::bone_parents(): parents precede children.
+  const BoneIndex* bone_parents() const { return bone_parents_.data(); }
+
+  /// Length of the baked data, in the time units of the source anim.
+  MotiveTime clip_length() const { return clip_length_; }
+
+  /// True if the source anim repeats; playback wraps instead of clamping.
+  bool repeat() const { return repeat_; }
+
+  int num_frames() const { return num_frames_; }
+
+  /// Approximate heap bytes held by this clip. Used for streaming memory
+  /// budgets; not exact.
+  size_t ApproxSizeBytes() const {
+    return sizeof(*this) + values_.capacity() * sizeof(float) +
+           op_types_.capacity() * sizeof(uint8_t) +
+           bone_starts_.capacity() * sizeof(int) +
+           bone_parents_.capacity() * sizeof(BoneIndex);
+  }
+
+ private:
+  int NumChannels() const { return static_cast<int>(op_types_.size()); }
+
+  /// Baked channel values, frames-major: frame f's channels are
+  /// values_[f * NumChannels()] .. values_[(f + 1) * NumChannels() - 1],
+  /// so lerping a pose reads two contiguous rows.
+  std::vector<float> values_;
+
+  /// MatrixOperationType of each channel, compressed to 8 bits. Channels of
+  /// bone i are op_types_[bone_starts_[i]] .. op_types_[bone_starts_[i+1]-1],
+  /// in the source anim's op order.
+  std::vector<uint8_t> op_types_;
+  std::vector<int> bone_starts_;
+
+  /// Bone hierarchy, copied from the source anim.
+  std::vector<BoneIndex> bone_parents_;
+
+  /// Time between baked frames, as passed to Bake().
+  MotiveTime sample_period_;
+
+  /// Time covered by the baked frames.
+  MotiveTime clip_length_;
+
+  int num_frames_;
+  bool repeat_;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_BAKED_CLIP_H_
@@ -38,6 +38,11 @@ static const MotivatorType kMotivatorTypeInvalid = nullptr;
 typedef int32_t MotiveIndex;
 static const MotiveIndex kMotiveIndexInvalid = static_cast<MotiveIndex>(-1);
 
+/// Defragment budget meaning "fully compact every frame".
+/// See MotiveProcessor::SetDefragmentBudget().
+static const MotiveIndex kUnlimitedDefragmentBudget =
+    std::numeric_limits<MotiveIndex>::max();
+
 /// @typedef MotiveDimension
 /// Identify how many slots in the MotiveProcessor a Motivator occupies.
 /// A Motivator3f occupies three slots, for example. Arithmetic is mixed
@@ -58,6 +63,15 @@ typedef int MotiveTime;
 static const MotiveTime kMotiveTimeEndless =
     std::numeric_limits<MotiveTime>::max();
 
+/// @enum MotiveCrossingDirection
+/// Direction in which an animated value crosses a registered threshold.
+/// Values are bit flags and combine. See MotivatorNf::SetCrossingThreshold().
+enum MotiveCrossingDirection {
+  kCrossingRising = 1,   /// The value rises through the threshold.
+  kCrossingFalling = 2,  /// The value falls through the threshold.
+  kCrossingBoth = kCrossingRising | kCrossingFalling
+};
+
 /// @typedef BoneIndex
 /// Identify bone for skeletal animation. Each non-root bone has a parent
 /// whose BoneIndex is less than its own. Each bone has a transformation matrix.
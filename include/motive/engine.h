@@ -15,16 +15,57 @@
 #ifndef MOTIVE_ENGINE_H_
 #define MOTIVE_ENGINE_H_
 
+#include <atomic>
+#include <chrono>
 #include <map>
 #include <set>
+#include <vector>
 
 #include "motive/common.h"
 #include "motive/processor.h"
+#include "motive/util/arena.h"
 
 namespace motive {
 
+class Motivator;
+class MotiveCommandQueue;
+class MotiveJobSystem;
+class RigAnim;
 struct MotiveVersion;
 
+/// Signature of the callback set by MotiveEngine::SetCompletionCallback().
+/// `completed` is an array of `num_completed` Motivators whose animations
+/// finished this frame. The array is only valid during the call.
+typedef void MotiveCompletionFn(void* userdata,
+                                const Motivator* const* completed,
+                                int num_completed);
+
+/// Signature of the callback set by MotiveEngine::SetCrossingCallback().
+/// `crossings` is an array of `num_crossings` threshold crossings detected
+/// this frame. The array is only valid during the call.
+typedef void MotiveCrossingFn(void* userdata, const MotiveCrossing* crossings,
+                              int num_crossings);
+
+/// Signature of the callback set by MotiveEngine::SetValueDeltaCallback().
+/// `deltas` is an array of `num_deltas` quantized value changes detected
+/// this frame. The array is only valid during the call.
+typedef void MotiveValueDeltaFn(void* userdata, const MotiveValueDelta* deltas,
+                                int num_deltas);
+
+/// One processor's capacity high-water mark. Keyed by the processor's type
+/// name rather than its MotivatorType, since type pointers are not stable
+/// across runs; the records can therefore be persisted between sessions.
+/// See MotiveEngine::CapacityHighWaterMarks().
+struct MotiveProcessorCapacity {
+  /// Name of the motivator type, e.g. "Spline". Points at the static name
+  /// registered by the processor, so it stays valid for the life of the
+  /// process.
+  const char* type_name;
+
+  /// Peak number of indices the processor has held.
+  MotiveIndex num_indices;
+};
+
 /// @class MotiveEngine
 /// @brief Hold and update all animation data.
 ///
@@ -43,8 +84,21 @@ class MotiveEngine {
   typedef std::map<MotivatorType, MotiveProcessor*> ProcessorMap;
   typedef std::pair<MotivatorType, MotiveProcessor*> ProcessorPair;
   typedef std::multiset<ProcessorDetails> ProcessorSet;
-  typedef std::map<MotivatorType, MotiveProcessorFunctions> FunctionMap;
-  typedef std::pair<MotivatorType, MotiveProcessorFunctions> FunctionPair;
+
+  /// One slot in the processor-factory registry. A slot is published by the
+  /// release-store of `type` in RegisterProcessorFactory(), after `fns` has
+  /// been filled in, so a lookup that reads `type` is guaranteed to see the
+  /// functions too. Unclaimed and claimed-but-unpublished slots read as
+  /// kMotivatorTypeInvalid.
+  struct FactoryEntry {
+    std::atomic<MotivatorType> type;
+    MotiveProcessorFunctions fns;
+  };
+
+  /// Capacity of the processor-factory registry. There is one entry per
+  /// motivator type, not per engine, so this only needs to cover the types
+  /// linked into the binary.
+  static const int kMaxProcessorTypes = 32;
 
  public:
   MotiveEngine();
@@ -62,14 +116,398 @@ class MotiveEngine {
   ///                   the x-axis.
   void AdvanceFrame(MotiveTime delta_time);
 
+  /// Advance `num_frames` fixed ticks of `delta_time` each, in one call.
+  /// Equivalent to calling AdvanceFrame(delta_time) `num_frames` times,
+  /// except that per-call overhead--command-queue drains, arena resets,
+  /// snapshot publishes, and the completion callback--is paid once for the
+  /// whole batch instead of once per tick. Use for catch-up and
+  /// fast-forward replays in fixed-tick simulations, where seconds of
+  /// animation are advanced between renders.
+  ///
+  /// Queued commands are applied before the first tick; snapshots are
+  /// published and completions reported after the last, so a motivator that
+  /// finishes mid-batch is reported once, at the end. Ticks always run
+  /// serially, even when a job system is set: lockstep servers need the
+  /// determinism, and fixed ticks are too small to amortize dispatch.
+  ///
+  /// @param delta_time Duration of one tick, in user time units.
+  /// @param num_frames Number of ticks to advance. Nothing happens when
+  ///                   it is zero or negative.
+  void AdvanceFrames(MotiveTime delta_time, int num_frames);
+
+  /// Advance as much of the simulation as fits in `budget_usec` microseconds
+  /// of wall-clock time, and carry the rest over to the next call. Use this
+  /// instead of AdvanceFrame() when animation should degrade gracefully
+  /// under load: a spike in motivator count stretches across several frames
+  /// instead of blowing the frame target.
+  ///
+  /// Processors are advanced in the same priority order as AdvanceFrame().
+  /// Processors that support index ranges (see
+  /// MotiveProcessor::ParallelSliceSize()) are advanced slice by slice, so a
+  /// sweep can stop mid-processor and resume where it left off next call.
+  /// Skipped processors and indices accumulate the skipped delta_time, and
+  /// catch up with one correspondingly larger step when the budget allows.
+  ///
+  /// Don't mix with AdvanceFrame() while time is still owed, and note that
+  /// budgeted updates are always serial; the job system is not used.
+  ///
+  /// @param delta_time Elapsed time since the last call, in user time units.
+  /// @param budget_usec Wall-clock budget, in microseconds.
+  /// @return True if every processor is fully caught up; false if some time
+  ///         is still owed and further calls are needed to catch up.
+  bool AdvanceFrameWithBudget(MotiveTime delta_time, int64_t budget_usec);
+
+  /// Declare that `dependent` reads values that `source` produces during
+  /// the same frame--say, a spline target that is fed each frame from a
+  /// matrix motivator's output. When the priority order already advances
+  /// `source`'s processor first, nothing changes; otherwise `dependent` is
+  /// assigned to a dependency pass after `source`'s (see
+  /// MotiveProcessor::SetAdvancePass()), so AdvanceFrame() delivers
+  /// current-frame values instead of values one frame stale. Only the
+  /// indices in later passes are re-visited--the rest of the engine still
+  /// advances once.
+  ///
+  /// Declare dependencies at setup time, in dependency order when chained.
+  /// Both motivators must be valid.
+  void AddDependency(const Motivator& source, Motivator* dependent);
+
+  /// Update MotiveProcessors concurrently by submitting work to `job_system`.
+  /// Processors of equal Priority() are advanced in parallel, and processors
+  /// that support it (see MotiveProcessor::ParallelSliceSize()) are further
+  /// split into index ranges that are advanced by multiple workers.
+  /// Pass nullptr to return to serial updates. The engine does not take
+  /// ownership of `job_system`; it must outlive the engine or be unset
+  /// before it is destroyed.
+  void SetJobSystem(MotiveJobSystem* job_system) { job_system_ = job_system; }
+
+  /// Hook up a lock-free queue that worker threads feed with deferred
+  /// motivator mutations; see MotiveCommandQueue. The engine drains it at
+  /// the start of every AdvanceFrame() and AdvanceFrameWithBudget(), before
+  /// any processor advances, applying runs of identical targets through the
+  /// shared bulk path. Pass nullptr to detach. The engine does not take
+  /// ownership, and every queued motivator must belong to this engine.
+  void SetCommandQueue(MotiveCommandQueue* command_queue) {
+    command_queue_ = command_queue;
+  }
+
+  /// Pre-allocate storage in the MotiveProcessor for `type` so that it can
+  /// hold `num_indices` total indices without reallocating. Call before a
+  /// known spawn spike, e.g. when loading a level. Creates the processor if
+  /// it does not exist yet.
+  /// @param type The kType of the MotivatorInit that will be spawned.
+  /// @param num_indices Total indices to reserve. Note that one motivator
+  ///                    occupies Dimensions() indices, e.g. 3 for a
+  ///                    Motivator3f.
+  void ReserveIndices(MotivatorType type, MotiveIndex num_indices) {
+    Processor(type)->ReserveIndices(num_indices);
+  }
+
+  /// Report every processor's capacity high-water mark: the peak number of
+  /// indices it has held this session. The marks are keyed by type name, so
+  /// they can be persisted and fed to ReserveCapacities() at the next
+  /// startup; a warmed process then sizes its animation buffers once at
+  /// startup instead of re-learning its peaks through repeated mid-session
+  /// reallocation. Call at shutdown, before the engine is Reset().
+  /// @param marks Output array with room for `max_marks` entries. May be
+  ///              nullptr when `max_marks` is 0, to query the count.
+  /// @param max_marks Capacity of `marks`.
+  /// @return Total number of processors. Only the first
+  ///         min(return value, `max_marks`) entries of `marks` are written.
+  size_t CapacityHighWaterMarks(MotiveProcessorCapacity* marks,
+                                size_t max_marks) const;
+
+  /// Pre-size processors from high-water marks recorded by
+  /// CapacityHighWaterMarks() in an earlier session. For each mark whose
+  /// type name is registered in this binary, the processor is created and
+  /// its storage reserved to the recorded peak in one allocation. Marks for
+  /// types that are not linked in are ignored, so stale records are
+  /// harmless. Call at startup, before motivators are created.
+  void ReserveCapacities(const MotiveProcessorCapacity* marks,
+                         size_t num_marks);
+
+  /// Forbid every processor's data arrays from growing past their current
+  /// reserved capacity, fixing the engine's memory footprint for the rest
+  /// of the session. Intended for embedded and kiosk builds that run a
+  /// known set of animations: feed recorded marks through
+  /// ReserveCapacities() at startup, then lock. Paired with
+  /// SetMemoryFunctions() suballocating from one static buffer, the engine
+  /// then runs out of a single fixed allocation, with no mid-session
+  /// reallocation and no heap.
+  ///
+  /// While locked, creating motivators beyond a processor's reserved
+  /// capacity asserts--as does the first motivator of an unreserved type,
+  /// since a processor created after locking has no capacity. Growth never
+  /// happens inside AdvanceFrame()--it lives in the Motivator creation
+  /// path--so locking changes no per-frame costs; it turns quiet
+  /// reallocation into a loud failure during development.
+  void SetCapacitiesLocked(bool locked);
+
+  /// Keep double-buffered snapshots of renderer-facing values (rig global
+  /// transforms, matrix motivator values, and spline motivator values and
+  /// velocities), flipped at the end of each AdvanceFrame(). While enabled,
+  /// a render thread can read last frame's values wait-free--via
+  /// RigMotivator::GlobalTransforms(), MatrixMotivator4f::SnapshotValue(),
+  /// and MotivatorNf::ExtrapolatedValues()--while the simulation writes the
+  /// next frame. Snapshot reads lag the simulation by one frame, and the
+  /// snapshotting processors suspend index defragmentation so that indices
+  /// stay stable under concurrent reads.
+  void SetFrameSnapshots(bool enable);
+
+  /// Pin every processor's evaluation to instruction selections that are
+  /// bit-exact across SSE, NEON, and scalar builds. Lockstep simulations
+  /// that only exchange inputs need identical float results on every
+  /// machine; the optimized evaluator paths reorder and fuse float
+  /// operations, so their low bits can diverge across instruction sets.
+  /// Deterministic mode routes everything through the shared scalar paths,
+  /// trading the SIMD speedup for reproducibility.
+  ///
+  /// Determinism also requires the same sequence of calls with the same
+  /// arguments on every machine--pair this with AdvanceFrames() at a fixed
+  /// tick, and don't mix in the job system's sliced updates. Call before
+  /// motivators are advanced; switching modes mid-simulation changes
+  /// results from that frame on.
+  void SetDeterministic(bool enable);
+
+  /// Call `fn` once at the end of each AdvanceFrame() with the Motivators
+  /// whose animations finished that frame, batched into one array. This
+  /// replaces polling TargetTime() or TimeRemaining() on every motivator
+  /// every frame: the processors detect arrival during their normal update,
+  /// so motivators that are still animating--or long since settled--cost
+  /// nothing.
+  ///
+  /// A multi-dimensional motivator is reported once, on the frame its last
+  /// dimension finishes. Repeating splines never finish. The callback runs
+  /// on the thread that calls AdvanceFrame(), after every processor has
+  /// advanced, so it may read values and start new animations. No callback
+  /// is made on frames where nothing finished.
+  ///
+  /// @param fn Callback to invoke, or nullptr to remove the callback.
+  /// @param userdata Passed through to `fn` verbatim.
+  void SetCompletionCallback(MotiveCompletionFn* fn, void* userdata);
+
+  /// Call `fn` once at the end of each AdvanceFrame() with the threshold
+  /// crossings detected that frame, batched into one array. Thresholds are
+  /// registered per motivator with MotivatorNf::SetCrossingThresholds();
+  /// detection runs inside the processors' bulk evaluation, so this
+  /// replaces comparing Value() per motivator per frame.
+  ///
+  /// The callback runs on the thread that calls AdvanceFrame(), after every
+  /// processor has advanced, so it may read values and start new
+  /// animations. No callback is made on frames where nothing crossed.
+  ///
+  /// @param fn Callback to invoke, or nullptr to remove the callback.
+  /// @param userdata Passed through to `fn` verbatim.
+  void SetCrossingCallback(MotiveCrossingFn* fn, void* userdata);
+
+  /// Call `fn` once at the end of each AdvanceFrame() with every value that
+  /// moved by at least `epsilon` since it was last reported, batched into
+  /// one array of quantized deltas. Built for network replication: feed the
+  /// stream straight to your replication layer instead of reading every
+  /// motivator and diffing against a shadow copy--two full passes over data
+  /// the processors just wrote. Detection runs against the processors' own
+  /// value arrays, right after they are evaluated, while they are still in
+  /// cache; dormant values are skipped without being read.
+  ///
+  /// Each delta reports `quantized_delta * epsilon` of movement, and the
+  /// sub-epsilon remainder carries over to later frames, so a receiver that
+  /// accumulates the deltas tracks the true value within `epsilon` at all
+  /// times--quantization error does not drift. Movement is tracked from the
+  /// frame the callback is set, or the motivator is created; transmit
+  /// starting values through your spawn path.
+  ///
+  /// Only processors that keep their values in bulk arrays report deltas;
+  /// spline-driven motivators do. The callback runs on the thread that
+  /// calls AdvanceFrame(), after every processor has advanced. No callback
+  /// is made on frames where nothing moved.
+  ///
+  /// @param fn Callback to invoke, or nullptr to remove the callback.
+  /// @param epsilon Quantization step, in value units. Must be positive
+  ///                when `fn` is non-null.
+  /// @param userdata Passed through to `fn` verbatim.
+  void SetValueDeltaCallback(MotiveValueDeltaFn* fn, float epsilon,
+                             void* userdata);
+
+  /// Move `num_motivators` motivators from the engines that currently drive
+  /// them into this engine, preserving their animation state. Use to
+  /// rebalance load when motivators are sharded across several engines (one
+  /// per core, say) and one shard empties out: migrating avoids the
+  /// destroy/recreate hitch and the animation pop that comes with it.
+  ///
+  /// Each motivator is adopted by this engine's processor of its type,
+  /// which is created if it does not exist yet. Only types whose processors
+  /// support migration can move (see MotiveProcessor::SupportsMigration());
+  /// simple scalar types and splines do, matrices and rigs do not.
+  /// Update-rate tiers and pinning do not migrate.
+  ///
+  /// Don't call while any involved engine is inside AdvanceFrame().
+  ///
+  /// @param motivators Array of `num_motivators` pointers to the Motivators
+  ///                   to migrate. All must be valid. Motivators already
+  ///                   driven by this engine are left untouched.
+  /// @param num_motivators Number of motivators to migrate.
+  void MigrateMotivators(Motivator* const* motivators, int num_motivators);
+
+  /// Remove every motivator tagged with `group`--see Motivator::SetGroup()
+  /// --in one pass per processor. Destroying motivators through their
+  /// handles costs per-motivator bookkeeping, and a mass teardown (an
+  /// unloading level's tens of thousands of motivators, say) pays it once
+  /// per handle plus a defragmentation cascade behind the frame; this
+  /// sweeps each processor once, so teardown cost scales with the number
+  /// of live indices rather than with per-handle overhead.
+  ///
+  /// The destroyed Motivator handles are reset, as when the engine is
+  /// Reset(), so their destructors later do nothing. The freed indices
+  /// leave holes that the normal per-frame defragment compacts; cap that
+  /// per-frame cost with MotiveProcessor::SetDefragmentBudget(). Don't
+  /// call while AdvanceFrame() is running.
+  ///
+  /// @param group Group to destroy, in
+  ///              [1, MotiveProcessor::kNumMotivatorGroups).
+  /// @return Number of motivators destroyed.
+  int DestroyGroup(int group);
+
+  /// Sum the memory usage of every MotiveProcessor in this engine.
+  /// Answers "how much RAM does animation use right now" without heap
+  /// diffing: report `allocated_bytes` and `live_bytes` to your telemetry,
+  /// and watch `num_holes` and `unused_indices` to catch fragmentation
+  /// before it degrades into a Reset(). Walks the processors' bookkeeping,
+  /// so call it at sampling frequency (say once a second), not every frame,
+  /// and not while AdvanceFrame() is running.
+  MotiveMemoryStats MemoryStats() const;
+
+  /// Serialize the per-index state of every MotiveProcessor that supports
+  /// checkpoints (see MotiveProcessor::SupportsCheckpoint()) into `out`.
+  /// Use for server-side game-state checkpoints: restoring the blob skips
+  /// re-deriving animation state--targets, velocities, spline positions--
+  /// from gameplay data. Splines owned by the caller are recorded by
+  /// CompactSpline::ContentHash() only; splines the processors own
+  /// internally are saved inline.
+  ///
+  /// Each supporting processor is fully defragmented first, so that the
+  /// saved index layout is reproduced by simply re-creating the same
+  /// motivators in the same order. Don't call while AdvanceFrame() is
+  /// running.
+  void SaveCheckpoint(std::vector<uint8_t>* out);
+
+  /// Restore state saved by SaveCheckpoint(). The same motivators must
+  /// already exist, created in the same order as when the checkpoint was
+  /// saved, so that indices line up; their Initialize() calls are cheap,
+  /// and the dynamic state they leave behind is overwritten here.
+  /// `resolver` maps the recorded content hashes back to caller-owned
+  /// splines; see MotiveSplineResolverFn.
+  ///
+  /// Returns false if the blob is malformed, a processor's index layout
+  /// doesn't match, or a spline failed to resolve. As much state as
+  /// possible is restored regardless.
+  bool RestoreCheckpoint(const uint8_t* bytes, size_t num_bytes,
+                         MotiveSplineResolverFn* resolver, void* userdata);
+
+  /// Re-point every motivator playing one of `old_anims` at the paired
+  /// entry in `new_anims`, at the current playback position, without
+  /// destroying or re-creating any motivator. Use when hot-reloading
+  /// animation content: reload the anims, call this with the old and new
+  /// pointers, then free the old anims.
+  ///
+  /// Splines are matched across each anim pair by bone index and operation
+  /// id; operations that vanished in the new anim hold their current value.
+  /// The new anims must be driven by the same defining anims as the old
+  /// ones--reloading a defining anim with a different op layout requires
+  /// re-creating the rig motivators. Don't call while AdvanceFrame() is
+  /// running.
+  void RebindAnims(const RigAnim* const* old_anims,
+                   const RigAnim* const* new_anims, int num_anims);
+
+  /// Re-point every motivator playing one of `old_splines` at the paired
+  /// entry in `new_splines`, preserving playback position and rate. A null
+  /// new spline makes its motivators hold their current value. For
+  /// motivators driven by MotivatorNf::SetSplines() directly; anims are
+  /// rebound wholesale with RebindAnims(). Don't call while AdvanceFrame()
+  /// is running.
+  void RebindSplines(const CompactSpline* const* old_splines,
+                     const CompactSpline* const* new_splines,
+                     int num_splines);
+
+  /// Arena for temporaries that live at most one frame. It is reset at the
+  /// top of AdvanceFrame(), so anything allocated from it survives to the
+  /// end of the current frame and is reclaimed wholesale when the next one
+  /// starts. Internal frame code routes its transients through here so
+  /// that a steady-state tick performs no global heap operations; custom
+  /// MotiveProcessors may do the same from their AdvanceFrame(), on the
+  /// engine thread only.
+  FrameArena& frame_arena() { return frame_arena_; }
+
   /// @private For internal use only.
   MotiveProcessor* Processor(MotivatorType type);
 
   /// @private For internal use only.
+  /// Thread-safe: registrations may race with each other and with
+  /// Processor() lookups on other threads, so engines can be brought up on
+  /// worker threads while another thread registers late. Registering the
+  /// same type twice is a no-op.
   static void RegisterProcessorFactory(MotivatorType type,
                                        const MotiveProcessorFunctions& fns);
 
  private:
+  /// One unit of work for job_system_: advance `processor` by `delta_time`.
+  /// If `end_index` is valid, advance only [start_index, end_index);
+  /// otherwise call the processor's regular AdvanceFrame(). As a special
+  /// case, if `start_index` is kMotiveIndexInvalid, call
+  /// AdvanceFrameTiered() with `frame_number`; processors with update-rate
+  /// tiers are advanced as one such job.
+  struct AdvanceJob {
+    MotiveProcessor* processor;
+    MotiveTime delta_time;
+    MotiveIndex start_index;
+    MotiveIndex end_index;
+    uint32_t frame_number;
+  };
+
+  /// Trampoline with the MotiveJobSystem::JobFn signature.
+  /// `data` is an AdvanceJob.
+  static void RunAdvanceJob(void* data);
+
+  /// AdvanceFrame() by submitting AdvanceJobs to job_system_.
+  void AdvanceFrameParallel(MotiveTime delta_time);
+
+  /// Advance every processor by one frame, pass by pass, serially. The
+  /// shared core of AdvanceFrame()'s serial path and of each tick in
+  /// AdvanceFrames().
+  void AdvanceFramePasses(MotiveTime delta_time);
+
+  /// Flip every processor's snapshot buffers, at the end of AdvanceFrame().
+  void PublishFrameSnapshots();
+
+  /// Gather completions from every processor and invoke the completion
+  /// callback, at the end of AdvanceFrame().
+  void NotifyCompletions();
+
+  /// Gather threshold crossings from every processor and invoke the
+  /// crossing callback, at the end of AdvanceFrame().
+  void NotifyCrossings();
+
+  /// Gather quantized value changes from every processor and invoke the
+  /// value-delta callback, at the end of AdvanceFrame().
+  void NotifyValueDeltas();
+
+  /// Per-processor bookkeeping for AdvanceFrameWithBudget().
+  struct ScheduleState {
+    ScheduleState() : pending_time(0), carry_time(0), resume_index(0) {}
+
+    /// Time accumulated for this processor but not yet applied to any index.
+    MotiveTime pending_time;
+
+    /// Time being applied by a range sweep that ran out of budget. Indices
+    /// before `resume_index` have received it; indices after have not.
+    MotiveTime carry_time;
+    MotiveIndex resume_index;
+  };
+
+  /// Apply `state->carry_time` to the remaining indices of `processor`,
+  /// slice by slice, stopping when `deadline` passes. Returns true if the
+  /// sweep finished.
+  bool FinishSweep(MotiveProcessor* processor, ScheduleState* state,
+                   const std::chrono::steady_clock::time_point& deadline);
+
   /// Map from the MotivatorType to the MotiveProcessor. Only one
   /// MotiveProcessor per type per engine. This is to maximize centralization
   /// of data.
@@ -80,12 +518,87 @@ class MotiveEngine {
   /// the child motivators have lower priority.
   ProcessorSet sorted_processors_;
 
+  /// Apply everything queued on `command_queue_` since the last frame.
+  /// Called at the start of AdvanceFrame(); the drain buffer lives in the
+  /// frame arena.
+  void ApplyCommands();
+
+  /// Optional job system for concurrent AdvanceFrame() updates. Not owned.
+  /// When nullptr, processors are advanced serially, as always.
+  MotiveJobSystem* job_system_;
+
+  /// Optional queue of deferred cross-thread mutations. Not owned. See
+  /// SetCommandQueue().
+  MotiveCommandQueue* command_queue_;
+
+  /// True if SetFrameSnapshots(true) has been called. Applied to processors
+  /// as they are created, since processors are created lazily.
+  bool frame_snapshots_;
+
+  /// True if SetDeterministic(true) has been called. Applied to processors
+  /// as they are created, like frame_snapshots_.
+  bool deterministic_;
+
+  /// True if SetCapacitiesLocked(true) has been called. Applied to
+  /// processors as they are created, like frame_snapshots_.
+  bool capacities_locked_;
+
+  /// Incremented once per AdvanceFrame(). Determines which update-rate
+  /// tiers step this frame; see MotiveProcessor::SetUpdateTier(). Wrapping
+  /// around is harmless, since tiers are powers of two apart.
+  uint32_t frame_number_;
+
+  /// Completion callback and its userdata. See SetCompletionCallback().
+  /// Applied to processors as they are created, like frame_snapshots_.
+  MotiveCompletionFn* completion_fn_;
+  void* completion_userdata_;
+
+  /// Scratch list of completed motivators for NotifyCompletions(). A member
+  /// so that its allocation is reused from frame to frame.
+  std::vector<const Motivator*> completed_motivators_;
+
+  /// Crossing callback and its userdata. See SetCrossingCallback().
+  MotiveCrossingFn* crossing_fn_;
+  void* crossing_userdata_;
+
+  /// Scratch list of crossings for NotifyCrossings(), reused like
+  /// `completed_motivators_`.
+  std::vector<MotiveCrossing> crossings_;
+
+  /// Value-delta callback, its quantization step, and its userdata. See
+  /// SetValueDeltaCallback(). Applied to processors as they are created,
+  /// like frame_snapshots_.
+  MotiveValueDeltaFn* value_delta_fn_;
+  float value_delta_epsilon_;
+  void* value_delta_userdata_;
+
+  /// Scratch list of deltas for NotifyValueDeltas(), reused like
+  /// `completed_motivators_`.
+  std::vector<MotiveValueDelta> value_deltas_;
+
+  /// Bump arena for per-frame transients; see frame_arena(). Reset at the
+  /// top of AdvanceFrame() and AdvanceFrameWithBudget().
+  FrameArena frame_arena_;
+
+  /// Time owed to each processor by AdvanceFrameWithBudget(). Grows lazily
+  /// as processors are created.
+  std::map<MotiveProcessor*, ScheduleState> schedule_states_;
+
+  /// Return the factory registered for `type`, or nullptr if there is none.
+  /// Lock-free; safe to call concurrently with RegisterProcessorFactory().
+  static const MotiveProcessorFunctions* LookupProcessorFactory(
+      MotivatorType type);
+
   /// Current version of the Motive Animation System.
   const MotiveVersion* version_;
 
-  /// ProcessorMap from the MotivatorType to the factory that creates the
-  /// MotiveProcessor. We only create an MotiveProcessor when one is needed.
-  static FunctionMap function_map_;
+  /// Registry of the factories that create the MotiveProcessors, keyed by
+  /// MotivatorType. We only create a MotiveProcessor when one is needed.
+  /// A fixed-capacity append-only array instead of a map so that lookups
+  /// are lock-free: Processor() scans the first `function_registry_count_`
+  /// entries, which never move or change once published.
+  static FactoryEntry function_registry_[kMaxProcessorTypes];
+  static std::atomic<int> function_registry_count_;
 };
 
 }  // namespace motive
@@ -0,0 +1,92 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_IO_BAKED_ANIM_H_
+#define MOTIVE_IO_BAKED_ANIM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace motive {
+
+class RigAnim;
+
+/// Baked image of a fully built RigAnim, for a second-level load cache.
+///
+/// Converting a RigAnimFb into a RigAnim walks the FlatBuffer and rebuilds
+/// every bone's ops and splines; over a large AnimTable that conversion
+/// dominates startup. A baked image stores the *built* representation
+/// instead: loading it is one pass of bulk copies--no FlatBuffer traversal
+/// and one spline allocation per animation--so a warm startup pays tens of
+/// milliseconds where conversion cost seconds. See
+/// AnimTable::SetBakedAnimCache() for the cache that reads and writes these
+/// images transparently.
+///
+/// Images are versioned twice: by the format version compiled in here, and
+/// by a caller-supplied build id, so a cache survives neither a Motive
+/// upgrade nor a content rebuild. A mismatched image simply fails to load
+/// and the caller falls back to FlatBuffer conversion.
+///
+/// Only loader-built animations bake faithfully: spline and motivator ops
+/// must be driven by SplineInit with RangeOfOp() ranges, which is what
+/// RigAnimFromFlatBuffers() produces. Hand-built anims with other init
+/// types are not supported.
+///
+/// Layout, all fields little-endian:
+///   header: magic 'MVBA' (u32), version (u32), build_id (u64),
+///           end_time (i32), repeat (u8), has_names (u8), num_bones (u16),
+///           total_spline_bytes (u32)
+///   name:   anim name, u16 length + bytes (length 0 when names stripped)
+///   bones:  num_bones x {
+///             parent (u8),
+///             bone name, u16 length + bytes (only when has_names),
+///             num_splines (u16), num_ops (u16),
+///             num_ops x {
+///               id (u8), type (u8), kind (u8), then per kind:
+///                 0 motivator only: nothing
+///                 1 constant:       value (f32)
+///                 2 spline:         y_range start/end (f32 x2),
+///                                   x_granularity (f32), num_nodes (u16),
+///                                   format (u8), x_index_log2 (u8),
+///                                   node bytes verbatim
+///                 3 shared spline:  ordinal (u32) of an earlier kind-2
+///                                   spline, counted across the whole anim
+///             }
+///           }
+///
+/// Ops bound to one CompactSpline instance--anim_pipeline deduplicates
+/// identical channels this way--bake the spline once, as kind 2 on first
+/// sight and kind 3 thereafter, so the sharing survives the cache.
+
+/// True if `data` starts with the baked-anim magic. Cache callbacks can use
+/// this to reject foreign files cheaply.
+bool IsBakedAnim(const void* data, size_t size);
+
+/// Serialize the fully built `anim` into `out`, tagged with `build_id`.
+/// `anim` must be loader-built; see the class of animation documented above.
+void BakeRigAnim(const RigAnim& anim, uint64_t build_id, std::string* out);
+
+/// Rebuild `anim` from a baked image in one pass of bulk copies.
+/// Returns false--leaving `anim` in an unspecified, destructible state--if
+/// the image is truncated, from another format version, or tagged with a
+/// build id other than `build_id`.
+/// `strip_debug_names` skips materializing the baked name strings, matching
+/// RigAnimFromFlatBuffers().
+bool InitRigAnimFromBaked(const void* data, size_t size, uint64_t build_id,
+                          bool strip_debug_names, RigAnim* anim);
+
+}  // namespace motive
+
+#endif  // MOTIVE_IO_BAKED_ANIM_H_
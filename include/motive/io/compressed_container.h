@@ -0,0 +1,171 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_IO_COMPRESSED_CONTAINER_H_
+#define MOTIVE_IO_COMPRESSED_CONTAINER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace motive {
+
+/// Compressed container for animation FlatBuffers.
+///
+/// Animation data is highly compressible, so shipping raw FlatBuffers wastes
+/// patch size and, on spinning disks, cold-load time. This container holds
+/// one compressed *frame* per RigAnim FlatBuffer, so a streaming loader can
+/// decompress a single animation on demand without touching the rest of the
+/// file. Within a frame, data is compressed in independent fixed-size
+/// *chunks*, so decompression of early chunks can overlap the file read of
+/// later ones.
+///
+/// The block codec is the LZ4 block format, implemented here so that Motive
+/// gains no external dependency; blocks are interchangeable with other LZ4
+/// implementations. Frames are keyed by AnimTable::HashAnimName() of the
+/// animation name, which plugs directly into AnimTable's by-hash index.
+///
+/// Layout, all fields little-endian:
+///   header:    magic 'MVAN' (u32), version (u32), num_frames (u32),
+///              chunk_size (u32)
+///   directory: num_frames x { name_hash (u64), data_offset (u32),
+///              uncompressed_size (u32) }
+///   data:      per frame, a run of chunks:
+///              { compressed_size (u32), uncompressed_size (u32), bytes }.
+///              compressed_size of 0 marks an incompressible chunk stored
+///              raw.
+
+/// Uncompressed bytes per chunk. Also the codec's match window, since chunks
+/// compress independently.
+static const size_t kAnimContainerChunkSize = 1 << 16;
+
+/// Worst-case compressed size of `size` input bytes, for sizing output
+/// buffers passed to LZCompress().
+size_t LZCompressBound(size_t size);
+
+/// Compress `src_size` bytes into `dst` in LZ4 block format.
+/// `dst_capacity` must be at least LZCompressBound(src_size).
+/// Returns the compressed size, or 0 if `dst_capacity` is too small.
+/// Compressed output may be larger than the input for incompressible data;
+/// the container stores such chunks raw instead.
+size_t LZCompress(const void* src, size_t src_size, void* dst,
+                  size_t dst_capacity);
+
+/// Decompress an LZ4-format block produced by LZCompress().
+/// `dst_size` must be the exact uncompressed size.
+/// Returns the number of bytes written--`dst_size` on success--or 0 if the
+/// input is corrupt or does not fit.
+size_t LZDecompress(const void* src, size_t src_size, void* dst,
+                    size_t dst_size);
+
+/// True if `data` starts with the container magic. Load callbacks use this
+/// to pass raw FlatBuffers through unchanged.
+bool IsAnimContainer(const void* data, size_t size);
+
+/// @class AnimContainerWriter
+/// @brief Build-tool side: packs animation FlatBuffers into a container.
+///
+/// Add every animation with AddFrame(), then call Finish() once to write the
+/// whole container into `out`.
+class AnimContainerWriter {
+ public:
+  /// `out` receives the container in Finish(). Must outlive the writer.
+  explicit AnimContainerWriter(std::string* out) : out_(out), finished_(false) {}
+
+  /// Append one animation FlatBuffer as a frame. `name_hash` is
+  /// AnimTable::HashAnimName() of the animation's name.
+  void AddFrame(uint64_t name_hash, const void* data, size_t size);
+
+  /// Write the header, frame directory, and frame data into `out`.
+  void Finish();
+
+ private:
+  struct Frame {
+    uint64_t name_hash;
+    uint32_t data_offset;
+    uint32_t uncompressed_size;
+  };
+
+  std::string* out_;
+  std::string data_;
+  std::vector<Frame> frames_;
+  std::vector<uint8_t> scratch_;
+  bool finished_;
+};
+
+/// @class AnimContainerReader
+/// @brief Runtime side: decompresses single frames or chunks on demand.
+///
+/// Init() only parses the directory; nothing is decompressed until asked.
+/// The reader does not copy or own the container bytes, so they must stay
+/// valid for its lifetime.
+class AnimContainerReader {
+ public:
+  AnimContainerReader() : data_(nullptr), size_(0) {}
+
+  /// Parse the directory. Returns false if `data` is not a valid container.
+  bool Init(const void* data, size_t size);
+
+  int NumFrames() const { return static_cast<int>(frames_.size()); }
+  uint64_t FrameNameHash(int frame) const { return frames_[frame].name_hash; }
+  size_t FrameSize(int frame) const {
+    return frames_[frame].uncompressed_size;
+  }
+
+  /// Return the index of the frame with the given name hash, or -1.
+  int FrameForHash(uint64_t name_hash) const;
+
+  /// Decompress one whole frame into `out` (resized to FrameSize()).
+  /// Returns false on corrupt data.
+  bool DecompressFrame(int frame, std::string* out) const;
+
+  /// Chunked access, for overlapping decode with file reads: the number of
+  /// chunks in `frame`. Every chunk holds kAnimContainerChunkSize bytes
+  /// except the last.
+  int NumChunks(int frame) const;
+
+  /// Decompress a single chunk of `frame` into `dst`. Returns the bytes
+  /// written, or 0 on corrupt data or insufficient `dst_capacity`.
+  size_t DecompressChunk(int frame, int chunk, void* dst,
+                         size_t dst_capacity) const;
+
+ private:
+  struct Frame {
+    uint64_t name_hash;
+    uint32_t data_offset;
+    uint32_t uncompressed_size;
+  };
+
+  /// Advance past `chunk` chunk headers of `frame`; returns nullptr if the
+  /// walk runs off the container.
+  const uint8_t* ChunkStart(int frame, int chunk) const;
+
+  const uint8_t* data_;
+  size_t size_;
+  std::vector<Frame> frames_;
+};
+
+/// Convenience with the shape of an AnimTable::LoadFn body: if `container`
+/// holds a frame for `name_hash`, decompress it into `scratch_buf` and
+/// return its bytes; otherwise return nullptr. Parses the directory on
+/// every call; keep an AnimContainerReader instead when loading many frames.
+const char* DecompressAnimFrameByHash(const void* container,
+                                      size_t container_size,
+                                      uint64_t name_hash,
+                                      std::string* scratch_buf);
+
+}  // namespace motive
+
+#endif  // MOTIVE_IO_COMPRESSED_CONTAINER_H_
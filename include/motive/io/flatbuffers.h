@@ -15,6 +15,9 @@
 #ifndef MOTIVE_IO_FLATBUFFERS_H_
 #define MOTIVE_IO_FLATBUFFERS_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 namespace motive {
 
 class AnimTable;
@@ -41,11 +44,58 @@ void SplineInitFromFlatBuffers(const SplineParameters& params,
 void Settled1fFromFlatBuffers(const Settled1fParameters& params,
                               Settled1f* settled);
 
-/// Convert from FlatBuffer params to Motive MatrixAnim.
+/// Convert from FlatBuffer params to Motive MatrixAnim. The animation's
+/// splines are created in one buffer owned by `anim`.
 void MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim);
 
+/// Convert from FlatBuffer params to Motive MatrixAnim, creating the
+/// animation's CompactSplines contiguously in `spline_buffer` instead of in
+/// a buffer owned by `anim`. The caller owns the buffer and must keep it
+/// alive--and unmoved--for the life of `anim`. Returns the first byte after
+/// the created splines, so several anims can be packed into one block; see
+/// RigAnimFromFlatBuffers(), which packs a whole rig this way.
+uint8_t* MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim,
+                                   uint8_t* spline_buffer);
+
 /// Convert from FlatBuffer params to Motive MatrixAnim.
-void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim);
+/// When `strip_debug_names` is true, the animation and bone name strings in
+/// `params` are not materialized: RigAnim::anim_name() returns an empty
+/// string and RigAnim::BoneName() "unknown". Shipping builds that never
+/// print them reclaim the string memory and skip their deserialization;
+/// resolve names on demand from the original buffer with
+/// AnimNameFromAnimBuffer() and BoneNameFromAnimBuffer() instead.
+void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim,
+                            bool strip_debug_names = false);
+
+/// Return the animation name stored in the RigAnimFb buffer `buf`, or
+/// nullptr if the buffer stores no name. The returned pointer aliases `buf`.
+/// A side channel for builds that load with debug names stripped: tools
+/// that occasionally need a name--crash reports, console commands--can read
+/// it from the original buffer on demand, without every loaded RigAnim
+/// carrying its strings. `buf` must have been verified with
+/// VerifyAnimBuffer(), or come from a trusted source.
+const char* AnimNameFromAnimBuffer(const void* buf);
+
+/// Return the name of bone `bone_idx` stored in the RigAnimFb buffer `buf`,
+/// or nullptr if the buffer stores no bone names or the index is out of
+/// range. Same contract as AnimNameFromAnimBuffer().
+const char* BoneNameFromAnimBuffer(const void* buf, int bone_idx);
+
+/// Hash of a raw animation buffer: 64-bit FNV-1a over the bytes. Like
+/// AnimTable::HashAnimName(), the hash is stable across runs and platforms,
+/// so build tools can hash each buffer at pack time and ship the hashes
+/// alongside the content. See AnimTable::SetBufferVerification().
+uint64_t HashAnimBuffer(const void* buf, size_t len);
+
+/// Return true if `buf` holds a RigAnimFb that is safe to convert with
+/// RigAnimFromFlatBuffers(). When `pre_verified_hash` is non-zero and matches
+/// HashAnimBuffer() of the buffer, the buffer is byte-for-byte the one that
+/// was verified at pack time, and the structural flatbuffers verification is
+/// skipped; hashing is a single sequential pass, considerably cheaper than
+/// the verifier's pointer chasing on large buffers. Otherwise the flatbuffers
+/// verifier runs in full.
+bool VerifyAnimBuffer(const void* buf, size_t len,
+                      uint64_t pre_verified_hash = 0);
 
 }  // namespace motive
 
@@ -17,6 +17,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <stddef.h>
 
 #include "mathfu/constants.h"
 #include "mathfu/matrix.h"
@@ -327,6 +328,14 @@ class Angle {
     return angle;
   }
 
+  /// Wrap each of the `count` angles in `in` to the range (-pi, pi] and
+  /// write them to `out`. `in` and `out` may be the same array. Produces
+  /// exactly the same values as calling WrapAngle() per element, but the
+  /// loop body is straight-line select code, so compilers can vectorize it
+  /// to wrap several angles per iteration. Use this when normalizing many
+  /// headings at once, e.g. a steering system's per-frame batch.
+  static void WrapAngles(const float* in, size_t count, float* out);
+
   /// Create from `angle`, in radians, which is in the range (-3pi,3pi].
   /// This function is significantly faster than WrapAngle since it avoids
   /// division. It's also more precise for the same reason. The range may seem
@@ -16,6 +16,7 @@
 #define MOTIVE_MATH_BULK_SPLINE_EVALUATOR_H_
 
 #include "motive/math/compact_spline.h"
+#include "motive/util/buffer_allocator.h"
 #include "motive/util/optimizations.h"
 
 namespace motive {
@@ -38,12 +39,27 @@ class BulkSplineEvaluator {
  public:
   typedef int Index;
 
-  // TODO: Call BestProcessorOptimization() to initialize `optimizations_`.
-  BulkSplineEvaluator() : optimization_(kNoOptimizations) {
+  /// One reported threshold crossing; see CollectCrossings().
+  struct Crossing {
+    Index index;
+    MotiveCrossingDirection direction;  /// kCrossingRising or kCrossingFalling.
+  };
+
+  BulkSplineEvaluator() : optimization_(BestProcessorOptimization()) {
     // Avoid "private member variable unused" warning on OSX.
     (void)optimization_;
   }
 
+  /// Override the instruction-set selection made at construction. Pass
+  /// kNoOptimizations to pin evaluation to the scalar C path, which is
+  /// bit-exact across SSE, NEON, and scalar builds--required for lockstep
+  /// simulations that compare results across platforms. The optimized paths
+  /// reorder and fuse float operations, so their low bits can differ from
+  /// the scalar path's and from each other's.
+  void SetOptimization(ProcessorOptimization optimization) {
+    optimization_ = optimization;
+  }
+
   /// Return the number of indices currently allocated. Each index is one
   /// spline that's being evaluated.
   Index NumIndices() const { return static_cast<Index>(sources_.size()); }
@@ -68,6 +84,32 @@ class BulkSplineEvaluator {
   void MoveIndices(const Index old_index, const Index new_index,
                    const Index count);
 
+  /// Copy the data at `source_index` in `source` into `index`. Copy `count`
+  /// indices total. Like MoveIndices(), but between two evaluators: used when
+  /// a spline playback is migrated from one evaluator to another. Spline
+  /// pointers are copied verbatim; if the source owns its spline storage,
+  /// duplicate the spline and call RepointSpline() afterwards.
+  void CopyIndices(const Index index, const Index count,
+                   const BulkSplineEvaluator& source, const Index source_index);
+
+  /// Replace the spline pointer at `index` without altering any evaluation
+  /// state. The new spline must have the same content as the current one;
+  /// use when the spline's storage has been copied or relocated.
+  void RepointSpline(const Index index, const CompactSpline* spline) {
+    assert(sources_[index].spline != nullptr && spline != nullptr);
+    sources_[index].spline = spline;
+  }
+
+  /// Bytes of heap storage held by the per-index arrays, including spare
+  /// capacity. For memory telemetry; see
+  /// MotiveProcessor::AccumulateMemoryStats().
+  /// The splines themselves are owned by the caller and not counted.
+  size_t AllocatedBytes() const;
+
+  /// Bytes of per-index array storage that one index consumes. The live
+  /// counterpart to AllocatedBytes().
+  static size_t BytesPerIndex();
+
   /// Initialize `index` to normalize into the `modular_range` range, whenever
   /// the spline segment is initialized. While travelling along a segment,
   /// note that the value may exit the `modular_range` range. For example, you
@@ -85,6 +127,17 @@ class BulkSplineEvaluator {
   /// Mark spline range as invalid.
   void ClearSplines(const Index index, const Index count);
 
+  /// Detach any splines from the range and hold each index's value constant
+  /// at `y`. The indices go dormant, so they cost nothing to advance.
+  void SetConstantYs(const Index index, const Index count, const float y);
+
+  /// Call after `spline` has been mutated in place (see
+  /// CompactSpline::ReplaceNode() and friends). Re-derives the current cubic
+  /// of every index playing `spline`, so the edit shows up immediately in
+  /// live preview instead of after the next node crossing. Dormant indices
+  /// are woken, since a finished spline may have grown a new tail.
+  void NotifySplineEdited(const CompactSpline* spline);
+
   /// Reposition the spline at `index` evaluate from `x`.
   /// Same as calling SetSpline() with the same spline and
   /// `playback.start_x = x`.
@@ -104,6 +157,22 @@ class BulkSplineEvaluator {
   /// instructions to be effective.
   void AdvanceFrame(const float delta_x);
 
+  /// Same as AdvanceFrame(), but only for the indices in [start, end).
+  /// Several threads may call this concurrently, provided their ranges do not
+  /// overlap and no other calls are made into this class while they run.
+  /// Uses the serial C++ algorithm; SIMD batching gains little on the short
+  /// ranges this is called with.
+  void AdvanceFrameRange(const float delta_x, const Index start,
+                         const Index end);
+
+  /// Same as AdvanceFrame(), but skip the cubic evaluation pass: x values
+  /// advance and cubics crossing a segment boundary are reinitialized, but
+  /// `ys_` is left untouched. For callers that evaluate the cubics
+  /// externally--e.g. in a compute shader--from state exported with
+  /// ExportCubics() and ExportCubicXs(), writing the results back with
+  /// ImportYs(). Until ImportYs() is called, Y() values are stale.
+  void AdvanceFrameWithoutEvaluation(const float delta_x);
+
   /// Return true if the spline for `index` has valid spline data.
   bool Valid(const Index index) const;
 
@@ -121,6 +190,15 @@ class BulkSplineEvaluator {
     return NormalizeY(index, ys_[index]);
   }
 
+  /// Return the current y values for the `count` splines starting at
+  /// `index`, each normalized to be within its valid y_range. Matches
+  /// calling NormalizedY() per index, but the common case--values within
+  /// one modular length of their range--runs through a branchless loop
+  /// that the compiler can vectorize, so prefer this when normalizing many
+  /// modular channels (e.g. headings) at once.
+  /// `out` is an array of length `count`.
+  void NormalizedYs(const Index index, const Index count, float* out) const;
+
   /// Return the current y value for splines, from index onward.
   /// Since this is the most commonly called function, we keep it fast by
   /// returning a pointer to the pre-calculated array. Note that we don't
@@ -162,9 +240,46 @@ class BulkSplineEvaluator {
     }
   }
 
+  /// Predict the y values the `count` indices starting at `index` will hold
+  /// after advancing `lookaheads[i]` more x-units, without mutating any
+  /// state. Playback rates apply, node boundaries are crossed read-only,
+  /// repeating splines wrap, and non-repeating splines clamp to their end
+  /// values--so the results match what Y() and Derivative() would return
+  /// after an equivalent AdvanceFrame(). Also predicts the derivatives when
+  /// `future_derivatives` is non-null. Lookaheads must be >= 0.
+  /// `lookaheads`, `future_ys`, and `future_derivatives` are arrays of
+  /// length `count`.
+  void FutureYs(const Index index, const Index count, const float* lookaheads,
+                float* future_ys, float* future_derivatives = nullptr) const;
+
+  /// Write the y values of the `count` indices starting at `index`
+  /// extrapolated `lookahead` x-units ahead along their current
+  /// derivatives: out[i] = Y(index + i) + Derivative(index + i) * lookahead.
+  /// Read-only and cheap--two multiply-adds per index--so a renderer
+  /// running faster than the simulation can sample smooth values between
+  /// ticks. Unlike FutureYs(), segment boundaries are not crossed and
+  /// repeating splines do not wrap, so keep `lookahead` below one
+  /// simulation tick; the extrapolation error over that span is bounded by
+  /// the curvature the tolerances already allow.
+  /// `out` is an array of length `count`.
+  void ExtrapolatedYs(const Index index, const Index count,
+                      const float lookahead, float* out) const;
+
   /// Return the current playback rate of the spline at `index`.
   float PlaybackRate(const Index index) const { return sources_[index].rate; }
 
+  /// Return true if the spline at `index` restarts at the beginning when it
+  /// reaches the end.
+  bool Repeat(const Index index) const { return sources_[index].repeat; }
+
+  /// Return the y-offset applied to the spline at `index`.
+  /// See SplinePlayback::y_offset.
+  float YOffset(const Index index) const { return sources_[index].y_offset; }
+
+  /// Return the y-scale applied to the spline at `index`.
+  /// See SplinePlayback::y_scale.
+  float YScale(const Index index) const { return sources_[index].y_scale; }
+
   /// Return the spline that is currently being traversed at `index`.
   const CompactSpline* SourceSpline(const Index index) const {
     return sources_[index].spline;
@@ -268,8 +383,143 @@ class BulkSplineEvaluator {
     return y_ranges_[index].modular_range;
   }
 
+  /// True if `index` has played off the end of a non-repeating spline and is
+  /// being skipped by AdvanceFrame(). Dormant indices hold EndY() with zero
+  /// derivative; their X() stops advancing. They wake automatically when a
+  /// new spline or x is set via SetSplines() or SetXs().
+  /// Followers (see SetPlaybackMaster()) ride the same skip flag but are
+  /// not dormant--their values change every frame--so they report false.
+  bool Dormant(const Index index) const {
+    return dormant_[index] != 0 && !FollowingMaster(index);
+  }
+
+  /// Track indices that finish their splines. While enabled, an index that
+  /// plays off the end of a non-repeating spline during AdvanceFrame() gets
+  /// its completion flag set; see Completed(). Tracking costs one byte per
+  /// index and a flag write per finished spline, so leave it off unless
+  /// completions are consumed.
+  void SetTrackCompletions(bool enable);
+
+  /// Return true if `index` finished its spline since the last call to
+  /// ClearCompletions(). Always false while tracking is disabled, and reset
+  /// when a new spline or x is set for `index`.
+  bool Completed(const Index index) const {
+    return !completed_.empty() && completed_[index] != 0;
+  }
+
+  /// Reset all completion flags, typically after reporting them.
+  void ClearCompletions();
+
+  /// Report when the value of `index` crosses `y` in `direction`--foot
+  /// height for footsteps, door angle for triggers. Detection runs as part
+  /// of AdvanceFrame(), one compare against the already-evaluated y per
+  /// registered index, replacing per-motivator polling of Y() from outside.
+  /// Costs one float and one byte per index, allocated on the first
+  /// registration. The threshold follows the index until
+  /// ClearCrossingThreshold(); setting a new spline does not clear it.
+  ///
+  /// Crossings are detected at frame granularity: a value that crosses the
+  /// threshold and returns within a single frame is not reported, the same
+  /// as the polling this replaces. Registration itself never reports; the
+  /// value's current side of the threshold is the starting side.
+  void SetCrossingThreshold(const Index index, const float y,
+                            const MotiveCrossingDirection direction);
+
+  /// Stop reporting crossings for `index`.
+  void ClearCrossingThreshold(const Index index);
+
+  /// Append one Crossing for each threshold crossed since the last call,
+  /// then reset the pending crossings. Call once per frame, after
+  /// AdvanceFrame(); an index whose value crossed in both directions over
+  /// separate frames between calls is appended once per direction.
+  void CollectCrossings(std::vector<Crossing>* crossings);
+
+  /// Make `index` a follower of `master`'s playback. Followers skip the
+  /// per-frame advance and cubic evaluation entirely; after each
+  /// AdvanceFrame(), a gather pass copies their value and segment state
+  /// from the master. When hundreds of indices play the same looping clip
+  /// at identical phase--synchronized crowds--register one master per
+  /// distinct (spline, rate, phase) and the per-frame cost of the rest
+  /// collapses to a few copies per follower.
+  ///
+  /// Registration snaps `index` onto `master`'s spline, rate, and phase;
+  /// whatever it was playing before is abandoned. A master must not itself
+  /// be a follower--chains are not supported. Moving or destroying a
+  /// master orphans its followers, so clear or re-register them first;
+  /// MoveIndices() does remap masters that move as part of the same call.
+  /// Followers never report completions--the master completes once for the
+  /// group--but crossing thresholds registered on a follower still fire on
+  /// its mirrored values. Not supported together with AdvanceFrameRange(),
+  /// whose concurrent callers could read a master mid-update.
+  /// Costs one Index per index, allocated on the first registration.
+  void SetPlaybackMaster(const Index index, const Index master);
+
+  /// Return `index` to independent evaluation, continuing from the phase
+  /// it mirrored last.
+  void ClearPlaybackMaster(const Index index);
+
+  /// True if `index` currently follows a master; see SetPlaybackMaster().
+  bool FollowingMaster(const Index index) const {
+    return !follower_masters_.empty() &&
+           follower_masters_[index] != kNoPlaybackMaster;
+  }
+
+  /// Snapshot the cubic coefficients of `count` indices starting at `index`
+  /// into the flat array `coefficients`, CubicCurve::kNumCoeff (4) floats
+  /// per index, constant term first. Together with ExportCubicXs() and
+  /// ExportYRanges(), this is everything an external evaluator--typically a
+  /// compute shader--needs to reproduce EvaluateCubics() for these indices:
+  ///     y[i] = ((c[4i+3] * x + c[4i+2]) * x + c[4i+1]) * x + c[4i]
+  /// The arrays are index-addressed, with no pointers, so they can be
+  /// uploaded to the GPU as-is. Coefficients only change when an index
+  /// crosses a segment boundary or is given a new spline, so they needn't
+  /// be re-exported every frame; x values change every frame.
+  /// Dormant indices export a constant cubic, so evaluating every index
+  /// unconditionally is correct.
+  void ExportCubics(const Index index, const Index count,
+                    float* coefficients) const;
+
+  /// Snapshot the current evaluation x of `count` cubics starting at
+  /// `index` into `xs`, one float per index. Each cubic starts at x=0, so
+  /// these are segment-local, matching CubicX().
+  void ExportCubicXs(const Index index, const Index count, float* xs) const;
+
+  /// Snapshot the modular y-ranges of `count` indices starting at `index`
+  /// into `ranges`, two floats per index: range start, then range length.
+  /// Length is 0 for indices that don't use modular arithmetic. External
+  /// evaluators that feed NormalizedY() consumers can ignore this; it is
+  /// provided for shaders that want to normalize on the GPU.
+  void ExportYRanges(const Index index, const Index count,
+                     float* ranges) const;
+
+  /// Write externally evaluated y values for `count` indices starting at
+  /// `index` back into the evaluator, so Y() and Ys() serve them as usual.
+  /// `ys` holds one float per index: the raw cubic evaluation, exactly as
+  /// EvaluateCubics() would have produced.
+  void ImportYs(const Index index, const Index count, const float* ys);
+
  private:
+  void SetDormant(const Index index, bool dormant) {
+    dormant_[index] = dormant ? 1 : 0;
+
+    // Setting or clearing a spline invalidates any unreported completion.
+    // MarkDormantIfFinished() re-flags the genuine completions after us.
+    if (!completed_.empty()) completed_[index] = 0;
+  }
+  void MarkDormantIfFinished(const Index index);
+  void DetectCrossings(const Index start, const Index end);
+
+  /// Giving `index` its own playback--a new spline, x, or constant--ends
+  /// any following relationship.
+  void StopFollowing(const Index index) {
+    if (!follower_masters_.empty()) {
+      follower_masters_[index] = kNoPlaybackMaster;
+    }
+  }
+  void BroadcastToFollowers();
+  void AdvanceFrameSkippingDormant(const float delta_x);
   void InitCubic(const Index index, const float start_x);
+  void UpdateLoopCubic(const Index index);
   float SplineStartX(const Index index) const {
     return sources_[index].spline->StartX();
   }
@@ -295,22 +545,41 @@ class BulkSplineEvaluator {
   void EvaluateCubics();
   void EvaluateCubics_C();
 
+  /// Members are ordered so that the fields read together by the cubic
+  /// re-init path--`spline`, `x_index`, and `repeat`--sit at the front of
+  /// the struct, and so that the pointer incurs no alignment padding. That
+  /// keeps the whole struct at 24 bytes on 64-bit targets, so one index's
+  /// re-init state rarely straddles a cache line. Note that sizeof(Source)
+  /// must remain a multiple of sizeof(float): the SIMD variants of
+  /// UpdateCubicXsAndGetMask() gather `rate` with a float-unit stride.
   struct Source {
     Source()
-        : rate(1.0f),
-          y_offset(0.0f),
-          y_scale(1.0f),
-          spline(nullptr),
+        : spline(nullptr),
           x_index(kInvalidSplineIndex),
-          repeat(false) {}
+          repeat(false),
+          rate(1.0f),
+          y_offset(0.0f),
+          y_scale(1.0f) {}
 
     Source(float rate, float y_offset, float y_scale)
-        : rate(rate),
-          y_offset(y_offset),
-          y_scale(y_scale),
-          spline(nullptr),
+        : spline(nullptr),
           x_index(kInvalidSplineIndex),
-          repeat(false) {}
+          repeat(false),
+          rate(rate),
+          y_offset(y_offset),
+          y_scale(y_scale) {}
+
+    /// Pointer to the source spline node. Spline data is owned externally.
+    /// We neither allocate or free this pointer here.
+    const CompactSpline* spline;
+
+    /// Current index into `spline`. The cubics_ valid is instantiated from
+    /// spline[x_index].
+    CompactSplineIndex x_index;
+
+    /// If true, start again at the beginning of the spline when we reach
+    /// the end.
+    bool repeat;
 
     /// Speed at which time flows, relative to the spline's authored rate.
     ///     0   ==> paused
@@ -325,18 +594,6 @@ class BulkSplineEvaluator {
     /// Factor by which we scale the spline along the y-axis. We first scale
     /// the spline along the y-axis before shifting it.
     float y_scale;
-
-    /// Pointer to the source spline node. Spline data is owned externally.
-    /// We neither allocate or free this pointer here.
-    const CompactSpline* spline;
-
-    /// Current index into `spline`. The cubics_ valid is instantiated from
-    /// spline[x_index].
-    CompactSplineIndex x_index;
-
-    /// If true, start again at the beginning of the spline when we reach
-    /// the end.
-    bool repeat;
   };
 
   struct YRange {
@@ -360,30 +617,84 @@ class BulkSplineEvaluator {
   // reasonable tradeoff between memory conservation and runtime performance.
 
   /// Source spline nodes and our current index into these splines.
-  std::vector<Source> sources_;
+  std::vector<Source, BufferAllocator<Source>> sources_;
 
   /// Define the valid output values. We can clamp to a range, or wrap around to
   /// a range using modular arithmetic (two modes of operation).
-  std::vector<YRange> y_ranges_;
+  std::vector<YRange, BufferAllocator<YRange>> y_ranges_;
 
   /// The current `x` value at which `cubics_` are evaluated.
   ///   ys_[i] = cubics_[i].Evaluate(cubic_xs_[i])
-  std::vector<float> cubic_xs_;
+  std::vector<float, BufferAllocator<float>> cubic_xs_;
 
   /// The last valid x value in `cubics_`.
-  std::vector<float> cubic_x_ends_;
+  std::vector<float, BufferAllocator<float>> cubic_x_ends_;
 
   /// Currently active segment of sources_.spline.
   /// Instantiated from
   /// sources_[i].spline->CreateInitCubic(sources_[i].x_index).
-  std::vector<CubicCurve> cubics_;
+  std::vector<CubicCurve, BufferAllocator<CubicCurve>> cubics_;
 
   /// Value of the spline at `cubic_xs_`, normalized and clamped to be within
   /// `y_ranges_`. Evaluated in AdvanceFrame.
-  std::vector<float> ys_;
+  std::vector<float, BufferAllocator<float>> ys_;
 
   /// Stratch buffer used for internal calculations.
-  std::vector<Index> scratch_;
+  std::vector<Index, BufferAllocator<Index>> scratch_;
+
+  /// Non-zero for indices that have played off the end of a non-repeating
+  /// spline. Their cubic is constant and their `cubic_x_ends_` is infinite,
+  /// so skipping them is purely an optimization: processing them anyway
+  /// produces the same values. In idle-heavy scenes most indices are
+  /// dormant, and skipping them cuts the bulk of the per-frame work.
+  std::vector<uint8_t, BufferAllocator<uint8_t>> dormant_;
+
+  /// Non-zero for indices that finished their spline since the last
+  /// ClearCompletions(). Empty unless SetTrackCompletions(true) has been
+  /// called. Flags are per-index bytes, so the concurrent-range guarantees
+  /// of AdvanceFrameRange() extend to completion tracking.
+  std::vector<uint8_t, BufferAllocator<uint8_t>> completed_;
+
+  /// Bits of `crossing_states_`. The direction bits match
+  /// MotiveCrossingDirection.
+  static const uint8_t kCrossingDirectionMask = 0x03;
+  static const uint8_t kCrossingAboveBit = 0x04;
+  static const int kCrossingFiredShift = 3;
+
+  /// Threshold y per index. Meaningful only where `crossing_states_` has a
+  /// direction bit set. Empty until the first SetCrossingThreshold().
+  std::vector<float, BufferAllocator<float>> crossing_ys_;
+
+  /// Packed crossing state per index: which directions to report
+  /// (kCrossingDirectionMask, matching MotiveCrossingDirection), which side
+  /// of the threshold the value was on last frame (kCrossingAboveBit), and
+  /// which crossings fired since the last CollectCrossings() (direction bits
+  /// shifted up by kCrossingFiredShift). Flags are per-index bytes, so the
+  /// concurrent-range guarantees of AdvanceFrameRange() extend to crossing
+  /// detection. Empty until the first SetCrossingThreshold().
+  std::vector<uint8_t, BufferAllocator<uint8_t>> crossing_states_;
+
+  /// Ready-to-copy cubic of each index's first spline segment, with the
+  /// index's y-scale and y-offset baked in. When a repeating spline wraps
+  /// back to its first segment--every index playing a looped clip does,
+  /// once per period--InitCubic() copies this instead of re-deriving the
+  /// cubic from the spline's nodes, so the frame at the loop boundary costs
+  /// barely more than any other. Empty until the first repeating spline;
+  /// see UpdateLoopCubic().
+  std::vector<CubicCurve, BufferAllocator<CubicCurve>> loop_cubics_;
+
+  /// X-length of each index's first spline segment, or 0 when the index has
+  /// no cached loop cubic. Populated alongside `loop_cubics_`.
+  std::vector<float, BufferAllocator<float>> loop_x_ends_;
+
+  /// Sentinel for `follower_masters_` entries that evaluate independently.
+  static const Index kNoPlaybackMaster = -1;
+
+  /// Master index per follower, or kNoPlaybackMaster; see
+  /// SetPlaybackMaster(). Followers reuse the `dormant_` skip flag so every
+  /// advance path bypasses them; the public Dormant() accessor filters them
+  /// out. Empty until the first SetPlaybackMaster().
+  std::vector<Index, BufferAllocator<Index>> follower_masters_;
 
   /// Call the specified optimized functions, when available, instead of the
   /// plain C++ functions. Note that we must perform this check at runtime,
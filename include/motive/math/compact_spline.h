@@ -22,6 +22,7 @@
 namespace motive {
 
 class BulkSplineEvaluator;
+class MotiveJobSystem;
 
 /// @typedef CompactSplineIndex
 /// Index into the spline. Some high values have special meaning (see below).
@@ -46,6 +47,18 @@ enum CompactSplineAddMethod {
                             /// to ensure cubic splines have uniform curvature.
 };
 
+/// Storage format of a CompactSpline's nodes, fixed at creation time.
+/// See the CompactSpline class comment for when each format is suitable.
+enum CompactSplineNodeFormat {
+  kNodeFormatWide,     /// 6-byte detail::CompactSplineNode: 16-bit x, y,
+                       /// and angle.
+  kNodeFormatNarrow,   /// 4-byte detail::CompactSplineNarrowNode: 16-bit x,
+                       /// 8-bit y and angle.
+  kNodeFormatImplied,  /// 4-byte detail::CompactSplineImpliedNode: 16-bit x
+                       /// and y; derivative implied by the neighboring
+                       /// nodes' positions.
+};
+
 /// @struct UncompressedNode
 /// @brief Float representation of a point on the spline.
 ///
@@ -70,6 +83,17 @@ struct UncompressedNode {
 /// The data in this class is compacted as quantized values. It's not intended
 /// to be read directly. You should use the BulkSplineEvaluator to update
 /// and read values from the splines in a performant manner.
+///
+/// Nodes are stored in one of three quantized formats, chosen at creation
+/// time: the default 6-byte detail::CompactSplineNode; the 4-byte
+/// detail::CompactSplineNarrowNode for channels that tolerate 8-bit y and
+/// derivative precision (blend weights, near-unity scales); or the 4-byte
+/// detail::CompactSplineImpliedNode, which keeps full 16-bit x and y but
+/// derives each node's tangent from its neighbors, for smooth
+/// densely-sampled channels whose tangents track the data anyway. Compact
+/// nodes are widened on read, so every format evaluates through the same
+/// code paths. CreateFromNodes() with a tolerance picks the format
+/// automatically.
 class CompactSpline {
  public:
   /// When a `CompactSpline` is created on the stack, it will have this many
@@ -79,12 +103,21 @@ class CompactSpline {
   static const CompactSplineIndex kDefaultMaxNodes = 7;
 
   CompactSpline()
-      : x_granularity_(0.0f), num_nodes_(0), max_nodes_(kDefaultMaxNodes) {}
+      : x_granularity_(0.0f),
+        num_nodes_(0),
+        max_nodes_(kDefaultMaxNodes),
+        format_(kNodeFormatWide),
+        x_index_log2_(0) {}
   CompactSpline(const Range& y_range, const float x_granularity)
-      : max_nodes_(kDefaultMaxNodes) {
+      : max_nodes_(kDefaultMaxNodes),
+        format_(kNodeFormatWide),
+        x_index_log2_(0) {
     Init(y_range, x_granularity);
   }
-  CompactSpline(const CompactSpline& rhs) : max_nodes_(kDefaultMaxNodes) {
+  CompactSpline(const CompactSpline& rhs)
+      : max_nodes_(kDefaultMaxNodes),
+        format_(kNodeFormatWide),
+        x_index_log2_(0) {
     *this = rhs;
   }
   CompactSpline& operator=(const CompactSpline& rhs) {
@@ -92,7 +125,16 @@ class CompactSpline {
     y_range_ = rhs.y_range_;
     x_granularity_ = rhs.x_granularity_;
     num_nodes_ = rhs.num_nodes_;
-    memcpy(nodes_, rhs.nodes_, rhs.num_nodes_ * sizeof(nodes_[0]));
+    if (format_ == rhs.format_) {
+      memcpy(nodes_, rhs.nodes_, rhs.num_nodes_ * rhs.NodeSize());
+    } else {
+      // The node format of the destination is fixed at creation time, like
+      // max_nodes_, so convert node-by-node instead of copying raw bytes.
+      for (CompactSplineIndex i = 0; i < num_nodes_; ++i) {
+        SetNode(i, rhs.Node(i));
+      }
+    }
+    if (x_index_log2_ != 0) BuildXIndex();
     return *this;
   }
 
@@ -157,12 +199,71 @@ class CompactSpline {
     AddNodeVerbatim(detail::CompactSplineNode(x, y, angle));
   }
 
+  /// Append `num_nodes` pre-quantized nodes in one operation.
+  /// `nodes` must have the same memory layout as detail::CompactSplineNode,
+  /// for example the node arrays inside animation FlatBuffers.
+  /// Significantly faster than adding baked nodes one at a time.
+  ///
+  /// @param nodes An array of quantized nodes, laid out like
+  ///              detail::CompactSplineNode.
+  /// @param num_nodes Length of the `nodes` array.
+  void AddNodesVerbatim(const void* nodes, size_t num_nodes) {
+    assert(num_nodes_ + num_nodes <= max_nodes_);
+    if (format_ == kNodeFormatWide) {
+      memcpy(&nodes_[num_nodes_], nodes, num_nodes * sizeof(nodes_[0]));
+      num_nodes_ += static_cast<CompactSplineIndex>(num_nodes);
+    } else {
+      // Serialized data is always in the wide format; compact each node.
+      const detail::CompactSplineNode* wide_nodes =
+          static_cast<const detail::CompactSplineNode*>(nodes);
+      for (size_t i = 0; i < num_nodes; ++i) {
+        AddNodeVerbatim(wide_nodes[i]);
+      }
+    }
+  }
+
+  /// Append `num_nodes` nodes that are already in this spline's own storage
+  /// format. Useful for making exact copies of a spline via
+  /// node_data(); unlike AddNodesVerbatim(), no format conversion occurs.
+  ///
+  /// @param node_data An array of nodes in this spline's format.
+  /// @param num_nodes Length of the `node_data` array.
+  void AppendNodeData(const void* node_data, size_t num_nodes) {
+    assert(num_nodes_ + num_nodes <= max_nodes_);
+    memcpy(reinterpret_cast<uint8_t*>(nodes_) + num_nodes_ * NodeSize(),
+           node_data, num_nodes * NodeSize());
+    num_nodes_ += static_cast<CompactSplineIndex>(num_nodes);
+  }
+
   /// Compress `nodes` and append them to the spline.
   ///
   /// @param nodes An array of uncompressed nodes.
   /// @param num_nodes Length of the `nodes` array.
   void AddUncompressedNodes(const UncompressedNode* nodes, size_t num_nodes);
 
+  /// Replace the node at `index` in place. The new x must keep the nodes
+  /// ordered: between the x's of the neighboring nodes, after quantization.
+  /// Returns false--and leaves the spline untouched--if it does not.
+  /// Only the segments touching `index` change, so interactive editors can
+  /// mutate single keys without rebuilding the spline. Evaluators that are
+  /// mid-playback on this spline must be told of the edit; see
+  /// BulkSplineEvaluator::NotifySplineEdited().
+  bool ReplaceNode(const CompactSplineIndex index, const float x, const float y,
+                   const float derivative);
+
+  /// Insert a node so that it becomes the node at `index`, shifting the
+  /// nodes from `index` onwards up by one; `index` may equal num_nodes() to
+  /// append. The new x must lie between the x's of the nodes that will
+  /// precede and follow it, after quantization. Returns false--and leaves
+  /// the spline untouched--if it does not, or if the spline is already at
+  /// max_nodes().
+  bool InsertNode(const CompactSplineIndex index, const float x, const float y,
+                  const float derivative);
+
+  /// Remove the node at `index`, shifting later nodes down by one. The
+  /// segments on either side of `index` merge into one.
+  void RemoveNode(const CompactSplineIndex index);
+
   /// Indicate that we have stopped adding nodes and want to release the
   /// remaining memory. Useful for when we have one giant buffer from which
   /// we want to add many splines of (potentially unknown) various sizes.
@@ -198,13 +299,18 @@ class CompactSpline {
   ///  \endcode
   void Finalize() {
     max_nodes_ = num_nodes_;
+    // The x-index lives directly after the node array, so shrinking
+    // max_nodes_ moves it; rebuild it in its new position.
+    if (x_index_log2_ != 0) BuildXIndex();
   }
 
   /// Remove all nodes from the spline.
   void Clear() { num_nodes_ = 0; }
 
   /// Returns the memory occupied by this spline.
-  size_t Size() const { return Size(max_nodes_); }
+  size_t Size() const {
+    return SizeWithFormat(max_nodes_, format(), x_index_log2_);
+  }
 
   /// Use on an array of splines created by CreateArrayInPlace().
   /// Returns the next spline in the array.
@@ -254,7 +360,7 @@ class CompactSpline {
   // First and last x, y, and derivatives in the spline.
   float StartX() const { return Front().X(x_granularity_); }
   float StartY() const { return Front().Y(y_range_); }
-  float StartDerivative() const { return nodes_[0].Derivative(); }
+  float StartDerivative() const { return Front().Derivative(); }
 
   float EndX() const { return Back().X(x_granularity_); }
   float EndY() const { return Back().Y(y_range_); }
@@ -263,7 +369,7 @@ class CompactSpline {
   float NodeY(const CompactSplineIndex index) const;
   float NodeDerivative(const CompactSplineIndex index) const {
     assert(index < num_nodes_);
-    return nodes_[index].Derivative();
+    return Node(index).Derivative();
   }
   float LengthX() const { return EndX() - StartX(); }
   Range RangeX() const { return Range(StartX(), EndX()); }
@@ -312,31 +418,138 @@ class CompactSpline {
   CompactSplineIndex max_nodes() const { return max_nodes_; }
 
   /// Return const versions of internal values. For serialization.
-  const detail::CompactSplineNode* nodes() const { return nodes_; }
+  /// Only valid for wide-format splines; serialized node arrays are always
+  /// in the wide format. Use node_data() for format-agnostic raw access.
+  const detail::CompactSplineNode* nodes() const {
+    assert(format_ == kNodeFormatWide);
+    return nodes_;
+  }
   const Range& y_range() const { return y_range_; }
   float x_granularity() const { return x_granularity_; }
 
+  /// True if nodes are stored in the narrow 4-byte format.
+  bool narrow() const { return format_ == kNodeFormatNarrow; }
+
+  /// True if nodes are stored in the implied-tangent 4-byte format.
+  bool implied() const { return format_ == kNodeFormatImplied; }
+
+  /// Storage format of this spline's nodes, fixed at creation time.
+  CompactSplineNodeFormat format() const {
+    return static_cast<CompactSplineNodeFormat>(format_);
+  }
+
+  /// Size in bytes of one node, in this spline's storage format.
+  size_t NodeSize() const { return NodeSizeForFormat(format()); }
+
+  /// Raw node storage, in this spline's format. Together with format() and
+  /// NodeSize(), allows exact copies and content hashes of any format.
+  const void* node_data() const { return nodes_; }
+  size_t node_data_size() const { return num_nodes_ * NodeSize(); }
+
+  /// Hash of the curve: 64-bit FNV-1a over the quantized nodes and the
+  /// quantization parameters, so two splines hash equally iff they evaluate
+  /// identically. Stable across runs, and across platforms of the same
+  /// endianness, so the hash can identify a spline across processes--see
+  /// MotiveEngine::RestoreCheckpoint().
+  uint64_t ContentHash() const;
+
+  /// Address of the node at `index`, for software prefetching ahead of
+  /// IndexForX() and CreateCubicInit() calls. Out-of-range indices,
+  /// including the sentinel indices like kInvalidSplineIndex, return the
+  /// first node, so the result is always safe to prefetch. Pure hint:
+  /// nothing is read through the returned pointer.
+  const void* NodeAddressForPrefetch(const CompactSplineIndex index) const {
+    const CompactSplineIndex i =
+        index < num_nodes_ ? index : static_cast<CompactSplineIndex>(0);
+    return reinterpret_cast<const uint8_t*>(nodes_) + i * NodeSize();
+  }
+
+  /// True if this spline carries a bucketed x-index (see CreateInPlace()).
+  bool has_x_index() const { return x_index_log2_ != 0; }
+
+  /// Log2 of the x-index's bucket count, or 0 when the spline carries no
+  /// index. Pass to Create*() to reproduce this spline's layout.
+  int x_index_log2() const { return x_index_log2_; }
+
+  /// Rebuild the bucketed x-index from the current nodes. Call once after
+  /// the last node is added; until then, lookups through a stale index are
+  /// still correct, just slower. No-op on splines created without an index.
+  ///
+  /// The index is derived data: it is rebuilt here rather than serialized,
+  /// so splines loaded from FlatBuffers only need this one call to get O(1)
+  /// random seeks.
+  void BuildXIndex();
+
   /// Allocate memory for a spline using global `new`.
   /// @param max_nodes The maximum number of nodes that this spline class
   ///                  can hold. Memory is allocated so that these nodes are
   ///                  held contiguously in memory with the rest of the
   ///                  class.
-  static CompactSpline* Create(CompactSplineIndex max_nodes) {
-    uint8_t* buffer = new uint8_t[Size(max_nodes)];
-    return CreateInPlace(max_nodes, buffer);
+  /// @param narrow If true, store nodes in the narrow 4-byte format. See
+  ///               the class comment for when the narrow format is suitable.
+  /// @param x_index_log2 If nonzero, reserve a bucketed x-index of
+  ///                     2^x_index_log2 uniform buckets after the node array,
+  ///                     making IndexForX() O(1) for random seeks. Call
+  ///                     BuildXIndex() after the last node is added. Must be
+  ///                     less than 16. Sequentially-played splines don't need
+  ///                     one; the guess index in IndexForX() already makes
+  ///                     playback O(1).
+  static CompactSpline* Create(CompactSplineIndex max_nodes,
+                               bool narrow = false, int x_index_log2 = 0) {
+    return CreateWithFormat(max_nodes,
+                            narrow ? kNodeFormatNarrow : kNodeFormatWide,
+                            x_index_log2);
+  }
+
+  /// Like Create(), with the node storage format given explicitly. The only
+  /// way to request the implied-tangent format, which the bool overload
+  /// above predates.
+  static CompactSpline* CreateWithFormat(CompactSplineIndex max_nodes,
+                                         CompactSplineNodeFormat format,
+                                         int x_index_log2 = 0) {
+    uint8_t* buffer =
+        new uint8_t[SizeWithFormat(max_nodes, format, x_index_log2)];
+    return CreateInPlaceWithFormat(max_nodes, buffer, format, x_index_log2);
   }
 
   /// Create a CompactSpline in the memory provided by `buffer`.
-  /// @param buffer chunk of memory of size CompactSpline::Size(max_nodes)
+  /// @param buffer chunk of memory of size
+  ///               CompactSpline::Size(max_nodes, narrow, x_index_log2)
   ///
   /// Useful for creating small splines on the stack.
   static CompactSpline* CreateInPlace(CompactSplineIndex max_nodes,
-                                      void* buffer) {
+                                      void* buffer, bool narrow = false,
+                                      int x_index_log2 = 0) {
+    return CreateInPlaceWithFormat(max_nodes, buffer,
+                                   narrow ? kNodeFormatNarrow : kNodeFormatWide,
+                                   x_index_log2);
+  }
+
+  /// Like CreateInPlace(), with the node storage format given explicitly.
+  /// `buffer` must be at least SizeWithFormat(max_nodes, format,
+  /// x_index_log2) bytes.
+  static CompactSpline* CreateInPlaceWithFormat(CompactSplineIndex max_nodes,
+                                                void* buffer,
+                                                CompactSplineNodeFormat format,
+                                                int x_index_log2 = 0) {
+    assert(0 <= x_index_log2 && x_index_log2 < 16);
     CompactSpline* spline = new (buffer) CompactSpline();
     spline->max_nodes_ = max_nodes;
+    spline->format_ = static_cast<uint8_t>(format);
+    spline->x_index_log2_ = static_cast<uint8_t>(x_index_log2);
+    // Zero the index so lookups on a partially-built spline stay in bounds.
+    spline->BuildXIndex();
     return spline;
   }
 
+  /// Allocate an exact copy of `spline`--same node format and curve--that
+  /// additionally carries a bucketed x-index, built and ready for O(1)
+  /// random seeks. Useful for replay and scrubbing, where splines loaded
+  /// through the normal (index-less) paths are seeked to arbitrary times.
+  /// Destroy with Destroy(), like Create().
+  static CompactSpline* CreateIndexedCopy(const CompactSpline& spline,
+                                          int x_index_log2);
+
   /// Allocate memory using global `new`, and initialize it with `nodes`.
   /// @param nodes An array holding the curve, in uncompressed floats.
   /// @param num_nodes The length of the `nodes` array, and max nodes in the
@@ -349,6 +562,21 @@ class CompactSpline {
     return spline;
   }
 
+  /// Like CreateFromNodes() above, but choose the node storage format
+  /// automatically: prefer the implied-tangent 4-byte format when every
+  /// node's reconstructed derivative stays within `tolerance`, since it
+  /// keeps full y precision; then the narrow 4-byte format when every
+  /// node's y and derivative survive narrow quantization to within
+  /// `tolerance`; and the wide format otherwise. See ImpliedFormatFits()
+  /// and NarrowFormatFits() for the exact criteria.
+  /// @param nodes An array holding the curve, in uncompressed floats.
+  /// @param num_nodes The length of the `nodes` array, and max nodes in the
+  ///                  returned spline.
+  /// @param tolerance Maximum acceptable quantization error, in y-units for
+  ///                  node y-values and in y-per-x-units for derivatives.
+  static CompactSpline* CreateFromNodes(const UncompressedNode* nodes,
+                                        size_t num_nodes, float tolerance);
+
   /// Create a CompactSpline from `nodes` in the memory provided by `buffer`.
   /// @param nodes array of node data, uncompressed as floats.
   /// @param num_nodes length of the `nodes` array.
@@ -454,16 +682,52 @@ class CompactSpline {
   /// for splines, and then pass that buffer into CreateInPlace(). Your memory
   /// buffer must be at least Size().
   static size_t Size(CompactSplineIndex max_nodes) {
+    return Size(max_nodes, false);
+  }
+
+  /// Returns the size, in bytes, of a CompactSpline with `max_nodes` nodes
+  /// in the wide or narrow node format, optionally followed by a bucketed
+  /// x-index of 2^x_index_log2 buckets.
+  static size_t Size(CompactSplineIndex max_nodes, bool narrow,
+                     int x_index_log2 = 0) {
+    return SizeWithFormat(max_nodes,
+                          narrow ? kNodeFormatNarrow : kNodeFormatWide,
+                          x_index_log2);
+  }
+
+  /// Like Size() above, for any node storage format.
+  static size_t SizeWithFormat(CompactSplineIndex max_nodes,
+                               CompactSplineNodeFormat format,
+                               int x_index_log2 = 0) {
     // Total size of the class must be rounded up to the nearest alignment
     // so that arrays of the class are properly aligned.
     // Largest type in the class is a float.
     const size_t kAlignMask = sizeof(float) - 1;
-    const size_t size =
-        kBaseSize + max_nodes * sizeof(detail::CompactSplineNode);
+    const size_t node_size = NodeSizeForFormat(format);
+    const size_t index_size =
+        x_index_log2 != 0
+            ? (static_cast<size_t>(1) << x_index_log2) *
+                  sizeof(CompactSplineIndex)
+            : 0;
+    const size_t size = kBaseSize + max_nodes * node_size + index_size;
     const size_t aligned = (size + kAlignMask) & ~kAlignMask;
     return aligned;
   }
 
+  /// Returns true if the curve in `nodes` can be stored in the narrow node
+  /// format without any node's y or derivative drifting more than `tolerance`
+  /// from its uncompressed value. Quantization matches InitFromNodes().
+  static bool NarrowFormatFits(const UncompressedNode* nodes, size_t num_nodes,
+                               float tolerance);
+
+  /// Returns true if the curve in `nodes` can be stored in the
+  /// implied-tangent node format without any node's reconstructed derivative
+  /// drifting more than `tolerance` (in y-per-x units) from its authored
+  /// value. x and y keep full wide-format precision, so only the derivatives
+  /// are checked. Quantization matches InitFromNodes().
+  static bool ImpliedFormatFits(const UncompressedNode* nodes,
+                                size_t num_nodes, float tolerance);
+
   /// Returns the size, in bytes, of an array of CompactSplines (as allocated
   /// with CreateArray(), say).
   ///
@@ -478,6 +742,18 @@ class CompactSpline {
   /// most precise granularity when quantizing x's.
   static float RecommendXGranularity(const float max_x);
 
+  /// Like RecommendXGranularity() above, but additionally considers the
+  /// common spacing of the curve's x-values. When every node x is a whole
+  /// multiple of `x_spacing` (for example, the greatest common divisor of
+  /// integral node times), and `max_x` still fits in the quantized x range
+  /// at that granularity, returns `x_spacing`, so that every node x
+  /// quantizes with zero error. Curves up to `x_spacing` * 65535 long then
+  /// fit in a single spline with exact node x's. Otherwise--when the curve
+  /// is too long for that, or `x_spacing` is 0 because no common spacing is
+  /// known--falls back to the finest granularity that fits `max_x`, as
+  /// above.
+  static float RecommendXGranularity(const float max_x, const float x_spacing);
+
   /// Callback interface for BulkEvaluate(). AddPoint() will be called
   /// `num_points` times, once for every x = start_x + n * delta_x,
   /// where n = 0..num_points-1.
@@ -525,13 +801,115 @@ class CompactSpline {
            reinterpret_cast<float*>(ys));
   }
 
+  /// Baking version of BulkYs(), for sampling large spline sets at fixed
+  /// intervals into track buffers. Differences from BulkYs():
+  ///  - `splines` is an array of pointers, so the splines need not be
+  ///    contiguous in memory like a CreateArray() layout.
+  ///  - Output placement is strided: sample `j` of spline `i` is written to
+  ///    ys[i * y_spline_stride + j * y_point_stride]. Contiguous per-spline
+  ///    tracks use y_point_stride = 1 and y_spline_stride = the track
+  ///    capacity; interleaved vec3-style output uses y_point_stride = 3 and
+  ///    y_spline_stride = 1.
+  ///  - If `job_system` is non-null, splines are baked in parallel batches
+  ///    through it; each batch evaluates on its own stack-local evaluator.
+  ///  - If `job_system` is null and `evaluator` is non-null, `evaluator` is
+  ///    reused instead of constructing one per call. Its internal arrays
+  ///    only ever grow, so reuse across many calls avoids reallocating them
+  ///    each time.
+  /// `derivatives` may be null; when non-null it is strided like `ys` with
+  /// its own stride pair.
+  static void BakeYs(const CompactSpline* const* splines, size_t num_splines,
+                     float start_x, float delta_x, size_t num_points,
+                     float* ys, size_t y_point_stride, size_t y_spline_stride,
+                     float* derivatives = nullptr,
+                     size_t derivative_point_stride = 0,
+                     size_t derivative_spline_stride = 0,
+                     BulkSplineEvaluator* evaluator = nullptr,
+                     MotiveJobSystem* job_system = nullptr);
+
  private:
   static const size_t kBaseSize;
 
   /// All other AddNode() functions end up calling this one.
   void AddNodeVerbatim(const detail::CompactSplineNode& node) {
     assert(num_nodes_ < max_nodes_);
-    nodes_[num_nodes_++] = node;
+    SetNode(num_nodes_++, node);
+  }
+
+  /// Read the node at `index`, widening it when stored in a compact format.
+  detail::CompactSplineNode Node(const CompactSplineIndex index) const {
+    switch (format()) {
+      case kNodeFormatNarrow:
+        return narrow_nodes()[index].Widen();
+      case kNodeFormatImplied:
+        return WidenImplied(index);
+      default:
+        return nodes_[index];
+    }
+  }
+
+  /// Quantized x of the node at `index`. The x quantization is identical in
+  /// every format, so searches by x can skip widening the whole node.
+  CompactSplineXGrain NodeCompactX(const CompactSplineIndex index) const {
+    switch (format()) {
+      case kNodeFormatNarrow:
+        return narrow_nodes()[index].x();
+      case kNodeFormatImplied:
+        return implied_nodes()[index].x();
+      default:
+        return nodes_[index].x();
+    }
+  }
+
+  /// Write `node` at `index`, compacting it when stored in a compact
+  /// format. In the implied format the node's angle is discarded; the
+  /// derivative read back is the secant through the neighboring nodes.
+  void SetNode(const CompactSplineIndex index,
+               const detail::CompactSplineNode& node) {
+    switch (format()) {
+      case kNodeFormatNarrow:
+        narrow_nodes()[index] = detail::CompactSplineNarrowNode(node);
+        break;
+      case kNodeFormatImplied:
+        implied_nodes()[index] = detail::CompactSplineImpliedNode(node);
+        break;
+      default:
+        nodes_[index] = node;
+        break;
+    }
+  }
+
+  /// Widen the implied-format node at `index`: its derivative is the secant
+  /// through the previous and next nodes, Catmull-Rom style, or the
+  /// one-sided secant at the spline's endpoints.
+  detail::CompactSplineNode WidenImplied(const CompactSplineIndex index) const;
+
+  /// Size in bytes of one node stored in `format`.
+  static size_t NodeSizeForFormat(CompactSplineNodeFormat format) {
+    switch (format) {
+      case kNodeFormatNarrow:
+        return sizeof(detail::CompactSplineNarrowNode);
+      case kNodeFormatImplied:
+        return sizeof(detail::CompactSplineImpliedNode);
+      default:
+        return sizeof(detail::CompactSplineNode);
+    }
+  }
+
+  /// View of `nodes_` as the narrow format. Only valid when narrow().
+  const detail::CompactSplineNarrowNode* narrow_nodes() const {
+    return reinterpret_cast<const detail::CompactSplineNarrowNode*>(nodes_);
+  }
+  detail::CompactSplineNarrowNode* narrow_nodes() {
+    return reinterpret_cast<detail::CompactSplineNarrowNode*>(nodes_);
+  }
+
+  /// View of `nodes_` as the implied format. Only valid when implied().
+  const detail::CompactSplineImpliedNode* implied_nodes() const {
+    return reinterpret_cast<const detail::CompactSplineImpliedNode*>(nodes_);
+  }
+  detail::CompactSplineImpliedNode* implied_nodes() {
+    return reinterpret_cast<detail::CompactSplineImpliedNode*>(nodes_);
   }
 
   /// Return true iff `x` is between the the nodes at `index` and `index` + 1.
@@ -542,6 +920,20 @@ class CompactSpline {
   CompactSplineIndex BinarySearchIndexForX(
       const CompactSplineXGrain compact_x) const;
 
+  /// O(1) version of BinarySearchIndexForX() that starts from the bucketed
+  /// x-index. Only call when has_x_index().
+  CompactSplineIndex XIndexLookup(const CompactSplineXGrain compact_x) const;
+
+  /// The bucketed x-index, stored directly after the node array. Entries are
+  /// node indices; see BuildXIndex(). Only valid when x_index_log2_ != 0.
+  CompactSplineIndex* XIndex() {
+    return reinterpret_cast<CompactSplineIndex*>(
+        reinterpret_cast<uint8_t*>(nodes_) + max_nodes_ * NodeSize());
+  }
+  const CompactSplineIndex* XIndex() const {
+    return const_cast<CompactSpline*>(this)->XIndex();
+  }
+
   /// Return e.x - s.x, converted from quantized to external units.
   float WidthX(const detail::CompactSplineNode& s,
                const detail::CompactSplineNode& e) const {
@@ -552,14 +944,15 @@ class CompactSpline {
   CubicInit CreateCubicInit(const detail::CompactSplineNode& s,
                             const detail::CompactSplineNode& e) const;
 
-  const detail::CompactSplineNode& Front() const {
+  // Returned by value since narrow-format nodes are widened on read.
+  detail::CompactSplineNode Front() const {
     assert(num_nodes_ > 0);
-    return nodes_[0];
+    return Node(0);
   }
 
-  const detail::CompactSplineNode& Back() const {
+  detail::CompactSplineNode Back() const {
     assert(num_nodes_ > 0);
-    return nodes_[num_nodes_ - 1];
+    return Node(num_nodes_ - 1);
   }
 
   /// Extreme values for y. See comments on Init() for details.
@@ -575,13 +968,26 @@ class CompactSpline {
   /// `kDefaultMaxNodes` if CreateInPlace() was called.
   CompactSplineIndex max_nodes_;
 
+  /// Storage format of `nodes_`: a CompactSplineNodeFormat value. Fixed at
+  /// creation time, like max_nodes_. Splines created on the stack always
+  /// use the wide format.
+  uint8_t format_;
+
+  /// Log2 of the number of buckets in the x-index after the node array, or
+  /// 0 when this spline has no index. Fixed at creation time, like
+  /// max_nodes_. Splines created on the stack never have an index.
+  uint8_t x_index_log2_;
+
   /// Array of key points (x, y, derivative) that describe the curve.
   /// The curve is interpolated smoothly between these key points.
   /// Key points are stored in quantized form, and converted back to world
   /// co-ordinates by using `y_range_` and `x_granularity_`.
   /// Note: This array can be longer or shorter than kDefaultMaxNodes if
   ///       the class was created with CreateInPlace(). The actual length of
-  ///       this array is stored in max_nodes_.
+  ///       this array is stored in max_nodes_. When `format_` is a compact
+  ///       format, the same bytes hold that format's nodes instead; access
+  ///       them through Node(), SetNode(), narrow_nodes(), and
+  ///       implied_nodes().
   detail::CompactSplineNode nodes_[kDefaultMaxNodes];
 };
 
@@ -156,6 +156,98 @@ class CompactSplineNode {
   CompactSplineAngle angle_;
 };
 
+// Half-width spline node for low-precision channels, e.g. blend weights and
+// near-unity scales. The x value keeps all 16 bits, since timing error
+// accumulates over a curve, but y and angle drop to 8 bits each, for 4 bytes
+// per node instead of 6.
+//
+// CompactSpline stores its nodes in either this format or CompactSplineNode,
+// chosen at creation time. Narrow nodes are widened to CompactSplineNode on
+// read, so evaluation code only ever sees the 16-bit format.
+class CompactSplineNarrowNode {
+ public:
+  // Don't initialize the data to save cycles.
+  CompactSplineNarrowNode() {}
+
+  // Narrow `n` by rounding away the low bits of y and angle.
+  explicit CompactSplineNarrowNode(const CompactSplineNode& n)
+      : x_(n.x()), y_(NarrowY(n.y())), angle_(NarrowAngle(n.angle())) {}
+
+  // Widen back to the 16-bit format. The scale factors are chosen so that
+  // narrow values round-trip exactly: NarrowY(Widen().y()) == y_, and
+  // likewise for angle. In particular, y of 255 widens to the full 65535,
+  // so the narrow format still reaches both ends of y_range.
+  CompactSplineNode Widen() const {
+    return CompactSplineNode(x_, static_cast<CompactSplineYRung>(y_ * 257),
+                             static_cast<CompactSplineAngle>(angle_ * 256));
+  }
+
+  // Get the quantized x value. Identical in both node formats, so searches
+  // by x can read it without widening the whole node.
+  CompactSplineXGrain x() const { return x_; }
+
+ private:
+  static uint8_t NarrowY(const CompactSplineYRung y) {
+    // Round to the nearest multiple of 257 (= 65535 / 255).
+    return static_cast<uint8_t>((y + 128) / 257);
+  }
+
+  static int8_t NarrowAngle(const CompactSplineAngle angle) {
+    // Round to the nearest multiple of 256, clamping the rounded value of
+    // the topmost angle back into range.
+    const int rounded = (static_cast<int>(angle) + 128) >> 8;
+    return static_cast<int8_t>(rounded > 127 ? 127 : rounded);
+  }
+
+  // Same quantization as CompactSplineNode::x_.
+  CompactSplineXGrain x_;
+
+  // Position within y_range. 0 ==> y_range.start. 255 ==> y_range.end.
+  uint8_t y_;
+
+  // Angle from x-axis, in steps 256 times coarser than CompactSplineNode's.
+  int8_t angle_;
+};
+
+// Spline node that stores only x and y, with the derivative implied by its
+// neighbors: the widened derivative is the Catmull-Rom-style secant through
+// the previous and next nodes' (x, y), or the one-sided secant at the
+// curve's endpoints. Keeps the full 16-bit y precision of CompactSplineNode
+// in 4 bytes, at the cost of discarding authored tangents, so it suits
+// smooth densely-sampled channels whose tangents track the data anyway.
+//
+// Unlike CompactSplineNarrowNode, a node cannot widen itself: the
+// derivative depends on the neighboring nodes and the spline's quantization
+// ranges, so CompactSpline reconstructs it in WidenImplied().
+class CompactSplineImpliedNode {
+ public:
+  // Don't initialize the data to save cycles.
+  CompactSplineImpliedNode() {}
+
+  // Keep `n`'s x and y; the angle is dropped and implied by neighbors.
+  explicit CompactSplineImpliedNode(const CompactSplineNode& n)
+      : x_(n.x()), y_(n.y()) {}
+
+  // Widen to the 16-bit format with the reconstructed `derivative`,
+  // calculated by CompactSpline::WidenImplied() from the neighboring nodes.
+  CompactSplineNode Widen(const float derivative) const {
+    return CompactSplineNode(x_, y_,
+                             CompactSplineNode::CompactDerivative(derivative));
+  }
+
+  // Get the quantized values. The x and y quantizations are identical to
+  // CompactSplineNode's, so searches by x can read it without widening.
+  CompactSplineXGrain x() const { return x_; }
+  CompactSplineYRung y() const { return y_; }
+
+ private:
+  // Same quantization as CompactSplineNode::x_.
+  CompactSplineXGrain x_;
+
+  // Same quantization as CompactSplineNode::y_.
+  CompactSplineYRung y_;
+};
+
 }  // namespace detail
 }  // namespace motive
 
@@ -174,6 +174,25 @@ class QuadraticCurve {
     return 0.0f;
   }
 
+  /// Evaluate this curve at each of the `num_xs` x-values in `xs`, writing
+  /// f(xs[i]) to ys[i]. Use when sampling a curve densely: the coefficients
+  /// stay in registers and the loop vectorizes, instead of paying the
+  /// per-call overhead of Evaluate() at every sample.
+  void BulkEvaluate(const float* xs, int num_xs, float* ys) const;
+
+  /// Like BulkEvaluate(), but for the slope: writes f'(xs[i]) to ys[i].
+  void BulkDerivative(const float* xs, int num_xs, float* ys) const;
+
+  /// Evaluate `num_curves` curves, each at its own x: writes
+  /// curves[i].Evaluate(xs[i]) to ys[i]. Use when evaluating many curves
+  /// in one pass, e.g. one curve per animating index.
+  static void BulkEvaluate(const QuadraticCurve* curves, const float* xs,
+                           int num_curves, float* ys);
+
+  /// Like the static BulkEvaluate(), but for the slopes.
+  static void BulkDerivative(const QuadraticCurve* curves, const float* xs,
+                             int num_curves, float* ys);
+
   /// Returns a value below which floating point precision is unreliable.
   /// If we're testing for zero, for instance, we should test against this
   /// value. Pass in the x-range as well, in case that coefficient dominates
@@ -412,6 +431,27 @@ class CubicCurve {
     return 6.0f * c_[3];
   }
 
+  /// Evaluate this curve at each of the `num_xs` x-values in `xs`, writing
+  /// f(xs[i]) to ys[i]. Use when sampling a curve densely: the coefficients
+  /// stay in registers and the loop vectorizes, instead of paying the
+  /// per-call overhead of Evaluate() at every sample.
+  void BulkEvaluate(const float* xs, int num_xs, float* ys) const;
+
+  /// Like BulkEvaluate(), but for the slope: writes f'(xs[i]) to ys[i].
+  void BulkDerivative(const float* xs, int num_xs, float* ys) const;
+
+  /// Evaluate `num_curves` curves, each at its own x: writes
+  /// curves[i].Evaluate(xs[i]) to ys[i]. Use when evaluating many curves
+  /// in one pass, e.g. one curve per animating index. For the engine's
+  /// per-frame spline evaluation, prefer BulkSplineEvaluator, which also
+  /// has platform-specific assembly for this loop.
+  static void BulkEvaluate(const CubicCurve* curves, const float* xs,
+                           int num_curves, float* ys);
+
+  /// Like the static BulkEvaluate(), but for the slopes.
+  static void BulkDerivative(const CubicCurve* curves, const float* xs,
+                             int num_curves, float* ys);
+
   /// Returns true if always curving upward or always curving downward on the
   /// specified x_limits.
   /// That is, returns true if the second derivative has the same sign over
@@ -380,7 +380,8 @@ class QuadraticSpring {
         bias_(0.0f),
         r_(0.0f),
         sqrt_b_(0.0f),
-        log_sqrt_b_reciprocal_(0.0f) {}
+        log_sqrt_b_reciprocal_(0.0f),
+        log2_sqrt_b_(0.0f) {}
 
   /// @brief Creates a curve at constant value `current_value` and
   ///        constant derivative 0.
@@ -393,7 +394,8 @@ class QuadraticSpring {
         bias_(0.0f),
         r_(0.0f),
         sqrt_b_(0.0f),
-        log_sqrt_b_reciprocal_(0.0f) {}
+        log_sqrt_b_reciprocal_(0.0f),
+        log2_sqrt_b_(0.0f) {}
 
   /// @brief Creates a curve that starts at `current_value` and oscillates
   ///        about `target_value`.
@@ -542,6 +544,34 @@ class QuadraticSpring {
     return 2.0f * c.coeff;
   }
 
+  /// @brief Gather the constants required to evaluate the curve with
+  ///        simple arithmetic, for bulk processing.
+  ///
+  /// While `external_x` stays within the portion of the spring curve that `c`
+  /// describes (that is, until `external_x` exceeds `valid_x_end`), the curve
+  /// value is exactly,
+  ///     value(external_x) = base_value + coeff * (external_x + x_offset)^2
+  /// This lets a caller evaluating many springs store the constants in
+  /// parallel arrays and process them in a tight SIMD-friendly loop,
+  /// only returning to the spring when its Context expires.
+  ///
+  /// @param c Context that describes the current portion of the spring curve.
+  /// @param coeff The quadratic coefficient of the current portion.
+  /// @param base_value The curve value at the current portion's peak.
+  /// @param x_offset Amount to add to an external x to get the x relative to
+  ///                 the current portion's peak.
+  /// @param valid_x_end Largest external x for which these constants are
+  ///                    valid. Past it, call @ref IncrementContext and gather
+  ///                    the constants again.
+  void BulkEvaluationConstants(const Context& c, float* coeff,
+                               float* base_value, float* x_offset,
+                               float* valid_x_end) const {
+    *coeff = c.coeff;
+    *base_value = target_ + c.peak;
+    *x_offset = start_x_ - c.peak_x;
+    *valid_x_end = ToExternalX(c.valid_x.end());
+  }
+
   /// @brief Return the spring curve's third derivative.
   /// @returns Return value is always 0 because internally we return quadratics.
   float ThirdDerivative(float external_x) const {
@@ -604,6 +634,12 @@ class QuadraticSpring {
 
   // Cached variable holding 1.0f / log(sqrt_b_).
   float log_sqrt_b_reciprocal_;
+
+  // Cached variable holding log2(sqrt_b_). Calculated exactly, once, so
+  // that sqrt_b_^N can be evaluated as FastExp2(N * log2_sqrt_b_) without
+  // the log's error being amplified by N (which grows large as the curve
+  // dampens).
+  float log2_sqrt_b_;
 };
 
 }  // namespace motive
@@ -32,6 +32,22 @@ namespace motive {
 void CalculateDualCubicMidNode(const CubicInit &init, float *x, float *y,
                                float *derivative);
 
+/// Batched version of CalculateDualCubicMidNode(), for callers that split
+/// many cubics at once (e.g. baking or bulk spline authoring).
+///
+/// Results are identical to calling the single-cubic version in a loop, but
+/// the work is organized in chunks: the branchy split-point search runs per
+/// cubic, while the arithmetic-heavy mid-node evaluation runs as elementwise
+/// loops over the chunk that the compiler can vectorize.
+///
+/// @param inits Array of `count` cubics to split.
+/// @param count Number of cubics.
+/// @param xs Output mid points' x values. Array of length `count`.
+/// @param ys Output mid points' y values. Array of length `count`.
+/// @param derivatives Output mid points' derivatives. Array of length `count`.
+void CalculateDualCubicMidNodes(const CubicInit *inits, size_t count,
+                                float *xs, float *ys, float *derivatives);
+
 }  // namespace motive
 
 #endif  // MOTIVE_MATH_DUAL_CUBIC_H_
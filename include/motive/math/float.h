@@ -104,6 +104,79 @@ inline float MaxPowerOf2Scale(const float f, const int max_exponent) {
       std::min(kMaxFloatExponent, max_exponent - ExponentAsInt(f)));
 }
 
+/// @brief Approximate 2^x. Branch-free and vectorizable.
+/// `x` is clamped to the invertable exponent range, so the result is always
+/// a positive, finite, normal float.
+/// Maximum relative error is about 0.02% (~12 bits): the fractional part
+/// goes through a cubic fit of 2^f on [0, 1), and the integer part is exact
+/// (it becomes the exponent bits directly).
+/// Plenty for damping factors and other animation math; not for numerics
+/// that feed back into themselves across many frames.
+inline float FastExp2(const float x) {
+  const float clamped =
+      std::min(std::max(x, static_cast<float>(kMinInvertableExponent)),
+               static_cast<float>(kMaxInvertableExponent));
+  const float floor_x = std::floor(clamped);
+  const float frac = clamped - floor_x;
+  const float poly =
+      1.0f +
+      frac * (0.695556856f + frac * (0.226173572f + frac * 0.0781455737f));
+  return ExponentFromInt(static_cast<int>(floor_x)) * poly;
+}
+
+/// @brief Approximate log2(x), for positive normal `x`.
+/// Maximum absolute error is about 0.0003 (~12 bits). The exponent bits give
+/// the integer part; a compact rational fit covers the mantissa.
+/// Zero, negative, denormal, and non-finite inputs give meaningless results.
+inline float FastLog2(const float x) {
+  assert(x > 0.0f);
+  IntFloatUnion bits;
+  bits.f = x;
+  const float raw = static_cast<float>(bits.i) * 1.1920928955078125e-7f;
+
+  // Mantissa scaled to [0.5, 1).
+  IntFloatUnion m;
+  m.i = (bits.i & 0x007FFFFF) | 0x3F000000;
+
+  return raw - 124.22551499f - 1.498030302f * m.f -
+         1.72587999f / (0.3520887068f + m.f);
+}
+
+/// @brief Approximate base^exponent, for positive normal `base`.
+/// Computed as FastExp2(exponent * FastLog2(base)), so FastLog2()'s error is
+/// scaled by `exponent` before it reaches the result: relative error is
+/// about 0.02% * (1 + |exponent|). Fine for the small exponents of damping
+/// factors; when the exponent can grow large and the base is fixed, cache
+/// log2(base) exactly and call FastExp2() directly instead.
+inline float FastPow(const float base, const float exponent) {
+  return FastExp2(exponent * FastLog2(base));
+}
+
+/// @brief Approximate 1/x, for positive normal `x`.
+/// A bit-trick initial guess refined by one Newton-Raphson step.
+/// Maximum relative error is about 0.3%; a second Newton step
+/// (y * (2 - x * y) again) brings it under 0.001% if needed.
+inline float FastReciprocal(const float x) {
+  assert(x > 0.0f);
+  IntFloatUnion u;
+  u.f = x;
+  u.i = 0x7EF311C3u - u.i;
+  const float y = u.f;
+  return y * (2.0f - x * y);
+}
+
+/// @brief Approximate 1/sqrt(x), for positive normal `x`.
+/// The classic bit-trick guess refined by one Newton-Raphson step.
+/// Maximum relative error is about 0.2%.
+inline float FastReciprocalSqrt(const float x) {
+  assert(x > 0.0f);
+  IntFloatUnion u;
+  u.f = x;
+  u.i = 0x5F375A86u - (u.i >> 1);
+  const float y = u.f;
+  return y * (1.5f - 0.5f * x * y * y);
+}
+
 /// @brief If the absolute value of `x` is less than epsilon, return zero.
 ///        Otherwise, return `x`.
 /// This function is useful in situations where the mathematical result depends
@@ -69,6 +69,17 @@ class RangeT {
   /// Behavior is undefined for invalid regions.
   T Clamp(const T x) const { return mathfu::Clamp(x, start_, end_); }
 
+  /// Clamp each of the `num_values` entries of `values` to the range,
+  /// writing the results to `out`. `out` may equal `values` to clamp in
+  /// place. Matches calling Clamp() on each entry, but the loop is written
+  /// as branch-free selects that the compiler can vectorize, so prefer it
+  /// when clamping many values against the same range.
+  void Clamp(const T* values, size_t num_values, T* out) const {
+    for (size_t i = 0; i < num_values; ++i) {
+      out[i] = mathfu::Clamp(values[i], start_, end_);
+    }
+  }
+
   /// Clamp `x` so it is inside the start bound. Can save cycles if you
   /// already know that `x` is inside the end bound.
   T ClampAfterStart(const T x) const { return std::max(x, start_); }
@@ -149,6 +160,33 @@ class RangeT {
     return x;
   }
 
+  /// Normalize each of the `num_values` entries of `values` into the range,
+  /// writing the results to `out`. `out` may equal `values` to normalize in
+  /// place. Matches calling NormalizeCloseValue() on each entry. Values
+  /// within one Length() of the range--the common case--run through a
+  /// branch-free pass that the compiler can vectorize; values further out
+  /// fall back to the exact scalar path.
+  void NormalizeCloseValues(const T* values, size_t num_values, T* out) const {
+    // First pass: one length-sized adjustment in each direction, as
+    // selects. At most one of the two adjustments ever applies, since the
+    // intervals they correct are disjoint, so this matches
+    // NormalizeCloseValue() exactly for close values.
+    const T length = Length();
+    for (size_t i = 0; i < num_values; ++i) {
+      const T x = values[i];
+      const T above = x > end_ ? x - length : x;
+      out[i] = above <= start_ ? above + length : above;
+    }
+
+    // Second pass: values further than one length out of range are rare,
+    // so fix any stragglers with the exact scalar path.
+    for (size_t i = 0; i < num_values; ++i) {
+      if (!ContainsExcludingStart(out[i])) {
+        out[i] = NormalizeCloseValue(values[i]);
+      }
+    }
+  }
+
   /// Ensure `x` is within the valid constraint range, by subtracting multiples
   /// of Length() from it until it is.
   /// `x` can be any value.
@@ -17,6 +17,8 @@
 
 #include "mathfu/glsl_mappings.h"
 
+#include "motive/math/compact_spline.h"
+
 namespace motive {
 
 inline int NormalizeIdx(const int idx, const int max, const bool wraps) {
@@ -121,6 +123,82 @@ void CalculateConstSpeedCurveFromPositions(
   //       Then adjust the times and scale the derivatives to match.
 }
 
+/// @brief Select the fewest samples needed to rebuild a sampled curve
+///        within `tolerance`, and write them out as uncompressed nodes.
+///
+/// Greedily grows each spline segment over the samples: a segment from one
+/// kept sample to another is acceptable if the cubic interpolating its end
+/// points (values and derivatives) stays within `tolerance` of every sample
+/// in between. Kept samples are emitted exactly, so the fitted curve passes
+/// through them with their sampled derivatives.
+///
+/// @param xs Sample x values, length `num_samples`, strictly increasing.
+/// @param ys Sample y values, length `num_samples`.
+/// @param derivatives Sample derivatives, length `num_samples`. May be
+///                    nullptr, in which case derivatives are estimated with
+///                    central differences.
+/// @param num_samples Number of samples. Must be at least 1.
+/// @param tolerance Maximum distance, in y units, that the fitted curve may
+///                  stray from any sample.
+/// @param nodes Output array. Must have room for `num_samples` nodes; the
+///              fit never keeps more nodes than it was given samples.
+/// @return The number of nodes written to `nodes`.
+size_t FitNodesToSamples(const float* xs, const float* ys,
+                         const float* derivatives, int num_samples,
+                         float tolerance, UncompressedNode* nodes);
+
+/// @brief Fit a CompactSpline to sampled data, within `tolerance`.
+///
+/// Selects nodes with FitNodesToSamples() and compresses them into a spline
+/// allocated with global `new`; free it with CompactSpline::Destroy().
+/// Nodes are added with kEnsureCubicWellBehaved, so dual-cubic mid-nodes
+/// keep each compressed segment's curvature uniform.
+///
+/// Intended for recording procedural motion at runtime--e.g. handing a
+/// physics ragdoll's settling motion back to spline playback--without
+/// precomputing assets. For many channels at once, prefer
+/// FitCompactSplines(), which reuses scratch space across channels.
+CompactSpline* FitCompactSpline(const float* xs, const float* ys,
+                                const float* derivatives, int num_samples,
+                                float tolerance);
+
+/// @brief Fit one CompactSpline per channel into `buffer`, within
+///        `tolerance`. All channels share the same sample `xs`.
+///
+/// The batched counterpart of FitCompactSpline(), for fitting a whole pose
+/// history--every animated channel of every bone--in one call. Splines are
+/// packed back to back in `buffer`, each shrunk to its fitted size with
+/// Finalize(), and scratch buffers are shared across channels, so there are
+/// no allocations beyond one scratch array per call.
+///
+/// @param xs Sample x values, length `num_samples`, strictly increasing.
+/// @param num_samples Number of samples per channel. Must be at least 1.
+/// @param num_channels Number of channels to fit.
+/// @param ys Sample y values, channel-major: channel `c`'s samples are at
+///           `ys[c * num_samples]` through `ys[c * num_samples +
+///           num_samples - 1]`.
+/// @param derivatives Sample derivatives, laid out like `ys`. May be
+///                    nullptr, in which case derivatives are estimated with
+///                    central differences.
+/// @param tolerance Maximum distance, in y units, that any fitted curve may
+///                  stray from its samples.
+/// @param buffer Memory that receives the splines. Size it with
+///               FitCompactSplinesBufferSize() to guarantee success.
+/// @param buffer_size Length of `buffer`, in bytes.
+/// @param splines Output array of `num_channels` pointers into `buffer`,
+///                one per channel. The pointers are valid as long as
+///                `buffer` is; do not call CompactSpline::Destroy() on them.
+/// @return The number of bytes of `buffer` consumed, or 0 if `buffer_size`
+///         was too small (in which case `splines` is partially written).
+size_t FitCompactSplines(const float* xs, int num_samples, int num_channels,
+                         const float* ys, const float* derivatives,
+                         float tolerance, void* buffer, size_t buffer_size,
+                         CompactSpline** splines);
+
+/// @brief Bytes that `buffer` must hold for FitCompactSplines() to succeed
+///        regardless of how many nodes the fit keeps.
+size_t FitCompactSplinesBufferSize(int num_samples, int num_channels);
+
 }  // namespace motive
 
 #endif  // MOTIVE_MATH_SPLINE_UTIL_H_
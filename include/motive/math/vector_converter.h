@@ -23,7 +23,35 @@ namespace motive {
 /// @brief Convert mathfu types to float pointers.
 ///
 /// Create your own converter if you'd like to use your own vector types in
-/// your Motivators' external API.
+/// your Motivators' external API: pass it as the first template argument of
+/// MotivatorXfTemplate (and MatrixMotivator4fTemplate). This class is the
+/// reference implementation of the contract; see also
+/// samples/own_vector_types for a worked example.
+///
+/// A converter provides the typedefs Vector2, Vector3, Vector4, and
+/// Matrix4, plus the ToPtr() and FromPtr() overload sets below, and is
+/// zero-copy in both directions:
+///
+///   - ToPtr(v) returns a pointer to `v`'s own storage--its components as
+///     contiguous floats, x first (matrices column-major)--never to a
+///     staging copy. Motive writes results through this pointer, so writes
+///     must land in the caller's object.
+///   - FromPtr(p, Vector3()) loads exactly the type's component count of
+///     floats from `p`. The dummy second parameter only selects the
+///     overload. For types whose constructor is a plain load, the
+///     load-and-return compiles down to a single copy out of the
+///     processor's array; there is no intermediate conversion.
+///
+/// `p` points into a processor's internal value array at an arbitrary index
+/// offset, so it is float-aligned but NOT vector-aligned: a SIMD-native
+/// converter must use unaligned loads in FromPtr(). ToPtr() destinations
+/// are the caller's own objects and carry the natural alignment of your
+/// type, so aligned stores are fine there.
+///
+/// For hot read paths that want to skip conversion entirely,
+/// MotivatorNf::Values() returns the same internal pointer FromPtr() reads
+/// from, and MotivatorValueView batch-gathers many motivators into one
+/// contiguous buffer.
 class MathFuVectorConverter {
  public:
   typedef mathfu::vec2 Vector2;
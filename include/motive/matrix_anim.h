@@ -52,6 +52,33 @@ class MatrixAnim {
     return splines_.data();
   }
 
+  /// For construction. Allocates one contiguous chunk of memory that holds
+  /// every CompactSpline in the animation. Create splines inside it with
+  /// CompactSpline::CreateInPlace(), so that a load performs one allocation
+  /// instead of one per spline. The chunk is owned by this class; splines
+  /// inside it must not be individually Destroy()ed, so leave
+  /// Spline::spline null when using this mode.
+  /// @param size Total bytes of all splines, i.e. the sum of
+  ///             CompactSpline::Size(num_nodes) over every spline.
+  uint8_t* AllocateSplineBuffer(size_t size) {
+    // Note: As with `splines_`, this buffer must not be moved after
+    //       construction, since `ops_` points into it.
+    spline_buffer_.resize(size);
+    return spline_buffer_.data();
+  }
+
+  /// Approximate heap bytes held by this animation: splines, spline buffer,
+  /// and the op array. Used for streaming memory budgets; not exact.
+  size_t ApproxSizeBytes() const {
+    size_t bytes = ops_.capacity() * sizeof(MatrixOperationInit) +
+                   splines_.capacity() * sizeof(Spline) +
+                   spline_buffer_.capacity();
+    for (size_t i = 0; i < splines_.size(); ++i) {
+      if (splines_[i].spline != nullptr) bytes += splines_[i].spline->Size();
+    }
+    return bytes;
+  }
+
   /// Return the op array. Non-const version is for construction.
   std::vector<MatrixOperationInit>& ops() { return ops_; }
 
@@ -66,6 +93,11 @@ class MatrixAnim {
 
   /// Hold spline animation data that is referenced by `init_`.
   std::vector<Spline> splines_;
+
+  /// Optional single buffer holding every CompactSpline in the animation,
+  /// created via AllocateSplineBuffer(). Empty when splines are allocated
+  /// individually through Spline::spline.
+  std::vector<uint8_t> spline_buffer_;
 };
 
 }  // namespace motive
@@ -45,16 +45,44 @@ class MatrixInit : public MotivatorInit {
   MOTIVE_INTERFACE();
 
   explicit MatrixInit(const std::vector<MatrixOperationInit>& ops)
-      : MotivatorInit(kType), ops_(&ops) {}
+      : MotivatorInit(kType),
+        ops_(ops.data()),
+        num_ops_(static_cast<int>(ops.size())),
+        inline_splines_(false) {}
 
-  const std::vector<MatrixOperationInit>& ops() const { return *ops_; }
+  /// Initialize from a contiguous array of ops, e.g. one bone's slice of
+  /// RigAnim's packed op array. The array must outlive this init.
+  MatrixInit(const MatrixOperationInit* ops, int num_ops)
+      : MotivatorInit(kType),
+        ops_(ops),
+        num_ops_(num_ops),
+        inline_splines_(false) {}
+
+  const MatrixOperationInit* ops() const { return ops_; }
+  int num_ops() const { return num_ops_; }
+
+  /// When true, spline-driven ops are evaluated by a BulkSplineEvaluator
+  /// embedded in the matrix processor, instead of by child motivators in the
+  /// spline processor. One processor, one memory region, no cross-processor
+  /// indirection--the fast path for large crowds of spline-animated props.
+  /// Inline ops don't support targets (MotivatorMatrix4f::SetChildTarget1f),
+  /// and blends to a constant value snap rather than ease.
+  bool inline_splines() const { return inline_splines_; }
+  void set_inline_splines(bool inline_splines) {
+    inline_splines_ = inline_splines;
+  }
 
  private:
-  /// Reference to the union of all operations that this matrix will be able
-  /// to execute. Later calls to MotivatorMatrix4f::BlendToOps() must provide
-  /// operations that are a subset of those in `ops_`.
+  /// The union of all operations that this matrix will be able to execute.
+  /// Later calls to MotivatorMatrix4f::BlendToOps() must provide operations
+  /// that are a subset of those in `ops_`.
   /// In `RigAnim`, these represent operations in the defining anim.
-  const std::vector<MatrixOperationInit>* ops_;
+  /// Not owned; must outlive this init.
+  const MatrixOperationInit* ops_;
+  int num_ops_;
+
+  /// See inline_splines().
+  bool inline_splines_;
 };
 
 }  // namespace motive
@@ -59,6 +59,18 @@ class MatrixMotivator4fTemplate : public Motivator {
     return reinterpret_cast<const Mat4&>(Processor().Value(index_));
   }
 
+  /// Return the value published at the end of the last engine update. When
+  /// MotiveEngine::SetFrameSnapshots() is enabled, this is safe to read from
+  /// a render thread while the simulation writes the next frame; otherwise
+  /// it is the same as Value().
+  const Mat4& SnapshotValue() const {
+    return reinterpret_cast<const Mat4&>(Processor().SnapshotValue(index_));
+  }
+
+  /// Return true if the last engine update changed Value(). Useful for
+  /// skipping work derived from the matrix while it is settled.
+  bool ValueChanged() const { return Processor().ValueChanged(index_); }
+
   /// Return the translation component of the matrix.
   /// The matrix is a 3D affine transform, so the translation component is the
   /// fourth column.
@@ -17,8 +17,10 @@
 
 #include "motive/engine.h"
 #include "motive/math/angle.h"
+#include "motive/math/bulk_spline_evaluator.h"
 #include "motive/math/compact_spline.h"
 #include "motive/math/range.h"
+#include "motive/spline_init.h"
 #include "motive/vector_motivator.h"
 
 namespace motive {
@@ -36,6 +38,11 @@ typedef uint8_t MatrixOpId;
 static const MatrixOpId kMaxMatrixOpId = 254;
 static const MatrixOpId kInvalidMatrixOpId = 255;
 
+/// Below this squared length, a blended quaternion is considered degenerate
+/// and is replaced with the identity rather than normalized.
+/// See MatrixOperation::ApplyQuaternionValues().
+static const float kMinQuaternionLengthSquared = 1e-8f;
+
 enum MatrixOperationType {
   kInvalidMatrixOperation,
   kRotateAboutX,
@@ -48,6 +55,10 @@ enum MatrixOperationType {
   kScaleY,
   kScaleZ,
   kScaleUniformly,
+  kQuaternionW,
+  kQuaternionX,
+  kQuaternionY,
+  kQuaternionZ,
   kNumMatrixOperationTypes
 };
 
@@ -66,11 +77,21 @@ inline bool ScaleOp(MatrixOperationType op) {
   return kScaleX <= op && op <= kScaleUniformly;
 }
 
+/// Returns true if the operation is one component of a quaternion rotation.
+/// Quaternion components always appear as a contiguous (w, x, y, z) run of
+/// ops, and the run is consumed as a single rotation; see
+/// MatrixOperation::ApplyQuaternionValues().
+inline bool QuaternionOp(MatrixOperationType op) {
+  return kQuaternionW <= op && op <= kQuaternionZ;
+}
+
 /// Returns the default value of the operation. That is, the value of the
 /// operation that does nothing to the transformation. Any operation that
 /// constantly returns the default value can be removed.
+/// The identity quaternion is (1, 0, 0, 0), so only the w component defaults
+/// to one.
 inline float OperationDefaultValue(MatrixOperationType op) {
-  return ScaleOp(op) ? 1.0f : 0.0f;
+  return ScaleOp(op) || op == kQuaternionW ? 1.0f : 0.0f;
 }
 
 /// Returns the range of the matrix operation's spline. Most ranges are just
@@ -171,6 +192,36 @@ class MatrixOperation {
     BlendToOp(init, motive::SplinePlayback());
   }
 
+  // Drive the operation with an inline spline channel: slot `index` of the
+  // `evaluator` embedded in the matrix processor. Values are read straight
+  // out of the evaluator, with no hop to the spline processor. The caller
+  // owns the channel index and must reclaim it when this op is destroyed;
+  // see InlineSplineIndex(). Only spline- or constant-driven inits can run
+  // inline; see MatrixInit::set_inline_splines().
+  MatrixOperation(const MatrixOperationInit& init,
+                  BulkSplineEvaluator* evaluator, MotiveIndex index) {
+    SetId(init.id);
+    SetType(init.type);
+    SetAnimationType(kInlineSplineAnimation);
+    value_.inline_spline.evaluator = evaluator;
+    value_.inline_spline.index = index;
+
+    // Match the modular range the spline processor would have used for the
+    // equivalent child motivator.
+    const SplineInit* spline_init =
+        init.init != nullptr && init.init->type() == SplineInit::kType
+            ? static_cast<const SplineInit*>(init.init)
+            : nullptr;
+    evaluator->SetYRanges(index, 1,
+                          spline_init != nullptr ? spline_init->range()
+                                                 : RangeOfOp(init.type));
+
+    // Start at the op's default value, in case `init` carries no data
+    // (e.g. ops from a defining anim).
+    evaluator->SetConstantYs(index, 1, OperationDefaultValue(init.type));
+    BlendToOp(init, motive::SplinePlayback());
+  }
+
   ~MatrixOperation() {
     // Manually call the Motivator destructor, since the union hides it.
     if (animation_type_ == kMotivatorAnimation) {
@@ -188,8 +239,27 @@ class MatrixOperation {
 
   // Return the value we are animating.
   float Value() const {
-    return animation_type_ == kMotivatorAnimation ? Motivator().Value()
-                                                  : value_.const_value;
+    switch (animation_type_) {
+      case kMotivatorAnimation:
+        return Motivator().Value();
+      case kInlineSplineAnimation:
+        return value_.inline_spline.evaluator->Y(value_.inline_spline.index);
+      default:
+        return value_.const_value;
+    }
+  }
+
+  // True if the operation's value never changes. Animated ops may be driven
+  // by either a child motivator or an inline spline channel.
+  bool Constant() const { return animation_type_ == kConstValueAnimation; }
+
+  // Index of this op's inline spline channel, or kMotiveIndexInvalid when
+  // the op is not driven inline. The owner of the embedded evaluator uses
+  // this to reclaim the channel when the op is destroyed.
+  MotiveIndex InlineSplineIndex() const {
+    return animation_type_ == kInlineSplineAnimation
+               ? value_.inline_spline.index
+               : kMotiveIndexInvalid;
   }
 
   // Return true if we can blend to `op`.
@@ -244,6 +314,31 @@ class MatrixOperation {
         break;
       }
 
+      case kInlineSplineAnimation: {
+        BulkSplineEvaluator* evaluator = value_.inline_spline.evaluator;
+        const MotiveIndex index = value_.inline_spline.index;
+        switch (init.union_type) {
+          case MatrixOperationInit::kUnionEmpty:
+            break;
+
+          case MatrixOperationInit::kUnionInitialValue:
+            // Inline channels have no target machinery, so the value snaps
+            // instead of easing over `playback.blend_x`.
+            evaluator->SetConstantYs(index, 1, init.initial_value);
+            break;
+
+          case MatrixOperationInit::kUnionSpline:
+            evaluator->SetSplines(index, 1, init.spline, playback);
+            break;
+
+          default:
+            // Targets require the spline processor; drive target-animated
+            // ops with child motivators instead.
+            assert(false);
+        }
+        break;
+      }
+
       case kConstValueAnimation:
         // If this value is not driven by an motivator, it must have a constant
         // value.
@@ -262,11 +357,18 @@ class MatrixOperation {
   void BlendToDefault(MotiveTime blend_time) {
     // Don't touch const value ones. Their default value is their const value.
     if (animation_type_ == kConstValueAnimation) return;
+    const float default_value = OperationDefaultValue(Type());
+
+    // Inline channels snap to the default; see BlendToOp().
+    if (animation_type_ == kInlineSplineAnimation) {
+      value_.inline_spline.evaluator->SetConstantYs(value_.inline_spline.index,
+                                                    1, default_value);
+      return;
+    }
     assert(animation_type_ == kMotivatorAnimation);
 
     // Create spline that eases out to the default_value.
     Motivator1f& motivator = Motivator();
-    const float default_value = OperationDefaultValue(Type());
     const MotiveTarget1f target =
         blend_time == 0 ? Current1f(default_value)
                         : Target1f(default_value, 0.0f, blend_time);
@@ -275,6 +377,11 @@ class MatrixOperation {
 
   void SetPlaybackRate(float playback_rate) {
     if (animation_type_ == kConstValueAnimation) return;
+    if (animation_type_ == kInlineSplineAnimation) {
+      value_.inline_spline.evaluator->SetPlaybackRates(
+          value_.inline_spline.index, 1, playback_rate);
+      return;
+    }
     assert(animation_type_ == kMotivatorAnimation);
     Motivator().SetSplinePlaybackRate(playback_rate);
   }
@@ -283,6 +390,14 @@ class MatrixOperation {
     if (animation_type_ == kMotivatorAnimation) {
       // Return the time time to reach the target for the motivator.
       return Motivator().TargetTime();
+    } else if (animation_type_ == kInlineSplineAnimation) {
+      // Time until the inline channel's spline runs out.
+      const BulkSplineEvaluator* evaluator = value_.inline_spline.evaluator;
+      const MotiveIndex index = value_.inline_spline.index;
+      return evaluator->Valid(index)
+                 ? static_cast<MotiveTime>(evaluator->EndX(index) -
+                                           evaluator->X(index))
+                 : 0;
     } else {
       // Constant animations are always at the "end" of their animation.
       return 0;
@@ -300,78 +415,273 @@ class MatrixOperation {
     mathfu::vec4 c1 = mathfu::kAxisY4f;
     mathfu::vec4 c2 = mathfu::kAxisZ4f;
     mathfu::vec4 c3 = mathfu::kAxisW4f;
+    ApplyOps(ops, num_ops, &c0, &c1, &c2, &c3);
+    return mathfu::mat4(c0, c1, c2, c3);
+  }
 
+  // Apply the series of basic matrix operations to the matrix columns,
+  // in place. Equivalent to post-multiplying the matrix each op represents.
+  // A quaternion (w, x, y, z) run is consumed as one rotation.
+  static void ApplyOps(const MatrixOperation* ops, size_t num_ops,
+                       mathfu::vec4* c0_out, mathfu::vec4* c1_out,
+                       mathfu::vec4* c2_out, mathfu::vec4* c3_out) {
     for (size_t i = 0; i < num_ops; ++i) {
       const MatrixOperation& op = ops[i];
-      const float value = op.Value();
+      if (op.Type() == kQuaternionW) {
+        assert(i + 3 < num_ops && ops[i + 1].Type() == kQuaternionX &&
+               ops[i + 2].Type() == kQuaternionY &&
+               ops[i + 3].Type() == kQuaternionZ);
+        ApplyQuaternionValues(op.Value(), ops[i + 1].Value(),
+                              ops[i + 2].Value(), ops[i + 3].Value(), c0_out,
+                              c1_out, c2_out, c3_out);
+        i += 3;
+        continue;
+      }
+      ApplyOpValue(op.Type(), op.Value(), c0_out, c1_out, c2_out, c3_out);
+    }
+  }
 
-      switch (op.Type()) {
-        // ( |  |  |  |)(c -s  0  0)   (c*  c*   |   |)
-        // (c0 c1 c2 c3)(s  c  0  0) = (c0+ c1- c2  c3)
-        // ( |  |  |  |)(0  0  1  0)   (s*  s*   |   |)
-        // ( |  |  |  |)(0  0  0  1)   (c1  c0   |   |)
+  // Apply one basic matrix operation with input `value` to the matrix
+  // columns, in place. Callers that compute op values outside of
+  // MatrixOperations (e.g. the rig processor's anim blending) compose their
+  // matrices through this.
+  static void ApplyOpValue(MatrixOperationType type, float value,
+                           mathfu::vec4* c0_out, mathfu::vec4* c1_out,
+                           mathfu::vec4* c2_out, mathfu::vec4* c3_out) {
+    mathfu::vec4& c0 = *c0_out;
+    mathfu::vec4& c1 = *c1_out;
+    mathfu::vec4& c2 = *c2_out;
+    mathfu::vec4& c3 = *c3_out;
+
+    switch (type) {
+      // ( |  |  |  |)(c -s  0  0)   (c*  c*   |   |)
+      // (c0 c1 c2 c3)(s  c  0  0) = (c0+ c1- c2  c3)
+      // ( |  |  |  |)(0  0  1  0)   (s*  s*   |   |)
+      // ( |  |  |  |)(0  0  0  1)   (c1  c0   |   |)
+      case kRotateAboutX:
+        RotateAboutAxis(value, &c1, &c2);
+        break;
+
+      case kRotateAboutY:
+        RotateAboutAxis(value, &c2, &c0);
+        break;
+
+      case kRotateAboutZ:
+        RotateAboutAxis(value, &c0, &c1);
+        break;
+
+      // ( |  |  |  |)(1  0  0 tx)   ( |  |  | tx*c0+ )
+      // (c0 c1 c2 c3)(0  1  0 ty) = (c0 c1 c2 ty*c1+ )
+      // ( |  |  |  |)(0  0  1 tz)   ( |  |  | tz*c2+ )
+      // ( |  |  |  |)(0  0  0  1)   ( |  |  |    c3  )
+      case kTranslateX:
+        c3 += value * c0;
+        break;
+
+      case kTranslateY:
+        c3 += value * c1;
+        break;
+
+      case kTranslateZ:
+        c3 += value * c2;
+        break;
+
+      // ( |  |  |  |)(sx 0  0  0)   ( |   |   |   |)
+      // (c0 c1 c2 c3)(0  sy 0  0) = (sx* sy* sz*  |)
+      // ( |  |  |  |)(0  0  sz 0)   (c0  c1  c2  c3)
+      // ( |  |  |  |)(0  0  0  1)   ( |   |   |   |)
+      case kScaleX:
+        c0 *= value;
+        break;
+
+      case kScaleY:
+        c1 *= value;
+        break;
+
+      case kScaleZ:
+        c2 *= value;
+        break;
+
+      case kScaleUniformly:
+        c0 *= value;
+        c1 *= value;
+        c2 *= value;
+        break;
+
+      default:
+        assert(false);
+    }
+  }
+
+  // Post-multiply the affine matrix `m` into the matrix columns, in place.
+  // The bottom row of `m` is assumed to be (0, 0, 0, 1), which holds for any
+  // composition of the basic operations above. Used to apply a run of
+  // operations that has been folded into a single precomputed matrix; see
+  // MatrixData::CompilePlan().
+  static void ApplyAffineMatrix(const mathfu::mat4& m, mathfu::vec4* c0_out,
+                                mathfu::vec4* c1_out, mathfu::vec4* c2_out,
+                                mathfu::vec4* c3_out) {
+    const mathfu::vec4 a0 = *c0_out;
+    const mathfu::vec4 a1 = *c1_out;
+    const mathfu::vec4 a2 = *c2_out;
+    *c0_out = a0 * m(0, 0) + a1 * m(1, 0) + a2 * m(2, 0);
+    *c1_out = a0 * m(0, 1) + a1 * m(1, 1) + a2 * m(2, 1);
+    *c2_out = a0 * m(0, 2) + a1 * m(1, 2) + a2 * m(2, 2);
+    *c3_out = a0 * m(0, 3) + a1 * m(1, 3) + a2 * m(2, 3) + *c3_out;
+  }
+
+  // Post-multiply the rotation described by quaternion (w, x, y, z) into the
+  // matrix columns, in place. The quaternion need not be unit length: it is
+  // normalized here, so component-wise weighted sums of unit quaternions
+  // (i.e. nlerp blends) can be passed in directly. A near-zero quaternion,
+  // as can arise when blending two nearly-opposite rotations with equal
+  // weights, applies the identity.
+  static void ApplyQuaternionValues(float w, float x, float y, float z,
+                                    mathfu::vec4* c0_out, mathfu::vec4* c1_out,
+                                    mathfu::vec4* c2_out,
+                                    mathfu::vec4* c3_out) {
+    (void)c3_out;  // Rotations leave the translation column untouched.
+    const float length_squared = w * w + x * x + y * y + z * z;
+    if (length_squared < kMinQuaternionLengthSquared) return;
+    const float inv_length = 1.0f / sqrtf(length_squared);
+    const float qw = w * inv_length;
+    const float qx = x * inv_length;
+    const float qy = y * inv_length;
+    const float qz = z * inv_length;
+
+    // Standard quaternion-to-matrix conversion, post-multiplied with the
+    // same column math as ApplyAffineMatrix(), minus the translation terms.
+    const float xx2 = 2.0f * qx * qx;
+    const float yy2 = 2.0f * qy * qy;
+    const float zz2 = 2.0f * qz * qz;
+    const float xy2 = 2.0f * qx * qy;
+    const float xz2 = 2.0f * qx * qz;
+    const float yz2 = 2.0f * qy * qz;
+    const float wx2 = 2.0f * qw * qx;
+    const float wy2 = 2.0f * qw * qy;
+    const float wz2 = 2.0f * qw * qz;
+    const mathfu::vec4 a0 = *c0_out;
+    const mathfu::vec4 a1 = *c1_out;
+    const mathfu::vec4 a2 = *c2_out;
+    *c0_out = a0 * (1.0f - yy2 - zz2) + a1 * (xy2 + wz2) + a2 * (xz2 - wy2);
+    *c1_out = a0 * (xy2 - wz2) + a1 * (1.0f - xx2 - zz2) + a2 * (yz2 + wx2);
+    *c2_out = a0 * (xz2 + wy2) + a1 * (yz2 - wx2) + a2 * (1.0f - xx2 - yy2);
+  }
+
+  // Execute four series of basic matrix operations at once.
+  //
+  // All four op arrays must run the same sequence of operation types (see
+  // MatrixData::SameOps()); only the animated values may differ. Compared to
+  // four calls to CalculateResultMatrix(), this amortizes the per-op dispatch
+  // over four matrices and gives the compiler four independent column streams
+  // to schedule, so the vector units stay busy.
+  //
+  // `ops` is an array of four pointers to op arrays, each `num_ops` long.
+  // `results` is an array of four pointers to the output matrices.
+  static void CalculateResultMatrices4(const MatrixOperation* const* ops,
+                                       size_t num_ops,
+                                       mathfu::mat4* const* results) {
+    // Four matrices, stored as four columns each, kept in registers.
+    mathfu::vec4 c0[4] = {mathfu::kAxisX4f, mathfu::kAxisX4f, mathfu::kAxisX4f,
+                          mathfu::kAxisX4f};
+    mathfu::vec4 c1[4] = {mathfu::kAxisY4f, mathfu::kAxisY4f, mathfu::kAxisY4f,
+                          mathfu::kAxisY4f};
+    mathfu::vec4 c2[4] = {mathfu::kAxisZ4f, mathfu::kAxisZ4f, mathfu::kAxisZ4f,
+                          mathfu::kAxisZ4f};
+    mathfu::vec4 c3[4] = {mathfu::kAxisW4f, mathfu::kAxisW4f, mathfu::kAxisW4f,
+                          mathfu::kAxisW4f};
+
+    for (size_t i = 0; i < num_ops; ++i) {
+      // Gather the animated values into one lane array.
+      float values[4];
+      for (int m = 0; m < 4; ++m) {
+        assert(ops[m][i].Type() == ops[0][i].Type());
+        values[m] = ops[m][i].Value();
+      }
+
+      // One dispatch per op serves all four matrices. The per-matrix math
+      // matches CalculateResultMatrix() above, case for case.
+      switch (ops[0][i].Type()) {
         case kRotateAboutX:
-          RotateAboutAxis(value, &c1, &c2);
+          for (int m = 0; m < 4; ++m) {
+            RotateAboutAxis(values[m], &c1[m], &c2[m]);
+          }
           break;
 
         case kRotateAboutY:
-          RotateAboutAxis(value, &c2, &c0);
+          for (int m = 0; m < 4; ++m) {
+            RotateAboutAxis(values[m], &c2[m], &c0[m]);
+          }
           break;
 
         case kRotateAboutZ:
-          RotateAboutAxis(value, &c0, &c1);
+          for (int m = 0; m < 4; ++m) {
+            RotateAboutAxis(values[m], &c0[m], &c1[m]);
+          }
           break;
 
-        // ( |  |  |  |)(1  0  0 tx)   ( |  |  | tx*c0+ )
-        // (c0 c1 c2 c3)(0  1  0 ty) = (c0 c1 c2 ty*c1+ )
-        // ( |  |  |  |)(0  0  1 tz)   ( |  |  | tz*c2+ )
-        // ( |  |  |  |)(0  0  0  1)   ( |  |  |    c3  )
         case kTranslateX:
-          c3 += value * c0;
+          for (int m = 0; m < 4; ++m) c3[m] += values[m] * c0[m];
           break;
 
         case kTranslateY:
-          c3 += value * c1;
+          for (int m = 0; m < 4; ++m) c3[m] += values[m] * c1[m];
           break;
 
         case kTranslateZ:
-          c3 += value * c2;
+          for (int m = 0; m < 4; ++m) c3[m] += values[m] * c2[m];
           break;
 
-        // ( |  |  |  |)(sx 0  0  0)   ( |   |   |   |)
-        // (c0 c1 c2 c3)(0  sy 0  0) = (sx* sy* sz*  |)
-        // ( |  |  |  |)(0  0  sz 0)   (c0  c1  c2  c3)
-        // ( |  |  |  |)(0  0  0  1)   ( |   |   |   |)
         case kScaleX:
-          c0 *= value;
+          for (int m = 0; m < 4; ++m) c0[m] *= values[m];
           break;
 
         case kScaleY:
-          c1 *= value;
+          for (int m = 0; m < 4; ++m) c1[m] *= values[m];
           break;
 
         case kScaleZ:
-          c2 *= value;
+          for (int m = 0; m < 4; ++m) c2[m] *= values[m];
           break;
 
         case kScaleUniformly:
-          c0 *= value;
-          c1 *= value;
-          c2 *= value;
+          for (int m = 0; m < 4; ++m) {
+            c0[m] *= values[m];
+            c1[m] *= values[m];
+            c2[m] *= values[m];
+          }
+          break;
+
+        case kQuaternionW:
+          // Consume the whole (w, x, y, z) run for each matrix, as in
+          // ApplyOps() above.
+          assert(i + 3 < num_ops && ops[0][i + 1].Type() == kQuaternionX &&
+                 ops[0][i + 2].Type() == kQuaternionY &&
+                 ops[0][i + 3].Type() == kQuaternionZ);
+          for (int m = 0; m < 4; ++m) {
+            ApplyQuaternionValues(values[m], ops[m][i + 1].Value(),
+                                  ops[m][i + 2].Value(), ops[m][i + 3].Value(),
+                                  &c0[m], &c1[m], &c2[m], &c3[m]);
+          }
+          i += 3;
           break;
 
         default:
           assert(false);
       }
     }
-    return mathfu::mat4(c0, c1, c2, c3);
+
+    for (int m = 0; m < 4; ++m) {
+      *results[m] = mathfu::mat4(c0[m], c1[m], c2[m], c3[m]);
+    }
   }
 
  private:
   enum AnimationType {
     kInvalidAnimationType,
     kMotivatorAnimation,
-    kConstValueAnimation
+    kConstValueAnimation,
+    kInlineSplineAnimation
   };
 
   // Disable copies so we don't have to worry about copying the Motivator1f in
@@ -399,6 +709,13 @@ class MatrixOperation {
   union AnimatedValue {
     uint8_t motivator_memory[sizeof(Motivator1f)];
     float const_value;
+    /// Channel in the matrix processor's embedded evaluator; see the
+    /// inline-spline constructor. Plain pointer + index, so no manual
+    /// construction or destruction is needed.
+    struct {
+      BulkSplineEvaluator* evaluator;
+      MotiveIndex index;
+    } inline_spline;
   };
 
   void SetId(MatrixOpId id) {
@@ -28,6 +28,20 @@ class MatrixProcessor4f : public MotiveProcessor {
   /// Get the current matrix value from the processor.
   virtual const mathfu::mat4& Value(MotiveIndex index) const = 0;
 
+  /// Get the value most recently published for off-thread readers. Equal to
+  /// Value() unless the engine's frame snapshots are enabled (see
+  /// MotiveEngine::SetFrameSnapshots()), in which case it is last frame's
+  /// value and is safe to read while the simulation writes the next frame.
+  virtual const mathfu::mat4& SnapshotValue(MotiveIndex index) const {
+    return Value(index);
+  }
+
+  /// Return true if the last call to AdvanceFrame() changed Value().
+  /// Processors that don't track this return true, conservatively.
+  /// Consumers that cache data derived from Value() can use this to skip
+  /// recomputation while the matrix is settled.
+  virtual bool ValueChanged(MotiveIndex /*index*/) const { return true; }
+
   /// Get the number of matrix operations performed by this motivator.
   virtual int NumChildren(MotiveIndex index) const = 0;
 
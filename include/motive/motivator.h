@@ -16,6 +16,7 @@
 #define MOTIVE_MOTIVATOR_H_
 
 #include "motive/processor.h"
+#include "motive/util/capture.h"
 
 namespace motive {
 
@@ -86,6 +87,7 @@ class Motivator {
   /// Initialize() and Valid() can no longer be called afterwards.
   void Invalidate() {
     if (processor_ != nullptr) {
+      if (detail::capture_active) detail::CaptureRemove(this);
       processor_->RemoveMotivator(index_);
     }
   }
@@ -115,6 +117,81 @@ class Motivator {
   /// value is determined by the MotiveProcessor backing this motivator.
   MotiveDimension Dimensions() const { return processor_->Dimensions(index_); }
 
+  /// Assign this Motivator to an update-rate tier. Tier 0, the default,
+  /// advances every frame; tier `t` advances every (1 << t)-th frame, with
+  /// the skipped frames' delta_time applied in one larger step. Use higher
+  /// tiers for background items--distant crowd characters, say--where a
+  /// lower update rate is not noticeable. Motivators with child motivators,
+  /// such as rigs, forward the tier to their children.
+  /// See MotiveProcessor::SetUpdateTier() for restrictions.
+  /// @param tier Tier to assign, in [0, MotiveProcessor::kNumUpdateTiers).
+  void SetUpdateTier(int tier) { processor_->SetUpdateTier(index_, tier); }
+
+  /// Assign this Motivator to a dependency-ordered advance pass. Prefer
+  /// MotiveEngine::AddDependency(), which derives the pass from the
+  /// relationship. See MotiveProcessor::SetAdvancePass().
+  void SetAdvancePass(int pass) { processor_->SetAdvancePass(index_, pass); }
+
+  /// Returns the dependency pass this Motivator advances in; 0 by default.
+  int AdvancePass() const { return processor_->AdvancePass(index_); }
+
+  /// Pin this Motivator's indices in place. The MotiveProcessor's
+  /// defragmentation normally shuffles indices to keep its data arrays
+  /// compact, so references into processor storage go stale between frames.
+  /// A pinned motivator is excluded from those moves: its indices stay fixed
+  /// until it is invalidated or unpinned.
+  ///
+  /// Pin a run of motivators created with InitializeBatch() and their
+  /// indices form a stable contiguous block. For one-dimensional motivators,
+  /// MotivatorNf::Values() on the first motivator of the block then exposes
+  /// the whole block's output as a contiguous float array; see Values() for
+  /// the reallocation caveat.
+  ///
+  /// Holes next to pinned blocks may be unfillable, so pinning long-lived
+  /// motivators amid heavy creation and removal wastes some memory. Pin
+  /// homogeneous groups that live and die together, such as particle pools.
+  void SetPinned(bool pinned) { processor_->SetIndexPinned(index_, pinned); }
+
+  /// Returns true if SetPinned(true) has been called on this Motivator.
+  bool Pinned() const { return processor_->IndexPinned(index_); }
+
+  /// Tag this Motivator with a teardown group, so that
+  /// MotiveEngine::DestroyGroup() can later remove everything in the group
+  /// in one pass per processor. Tag motivators right after creation with
+  /// the id of the scene or level that owns them. Group 0, the default, is
+  /// never destroyed in bulk. Motivators with child motivators, such as
+  /// rigs, tear their children down as part of their own removal; tag the
+  /// parent only.
+  /// @param group Group to assign, in
+  ///              [0, MotiveProcessor::kNumMotivatorGroups).
+  void SetGroup(int group) { processor_->SetGroup(index_, group); }
+
+  /// Returns the teardown group this Motivator is tagged with; 0 by
+  /// default.
+  int Group() const { return processor_->Group(index_); }
+
+  /// Initialize `num_motivators` motivators of the same type in one batch.
+  ///
+  /// Equivalent to initializing each motivator individually, but the
+  /// MotiveProcessor allocates all the data in one contiguous run, so a
+  /// spawn spike (say, a crowd of 10k characters) performs a single
+  /// allocation instead of growing the internal arrays 10k times.
+  /// See also MotiveProcessor::ReserveIndices() to pre-allocate capacity.
+  ///
+  /// @param inits Array of `num_motivators` initialization parameters, one
+  ///              per motivator. All must have the same type().
+  /// @param engine The owner of all the MotiveProcessors.
+  /// @param motivators Array of `num_motivators` pointers to the Motivators
+  ///                   to initialize. Each is invalidated first, as in
+  ///                   Initialize().
+  /// @param num_motivators Number of motivators to initialize.
+  /// @param dimensions The dimension of each motivator, e.g. 3 for a
+  ///                   Motivator3f.
+  static void InitializeBatch(const MotivatorInit* const* inits,
+                              MotiveEngine* engine,
+                              Motivator* const* motivators, int num_motivators,
+                              MotiveDimension dimensions);
+
  protected:
   Motivator(const MotivatorInit& init, MotiveEngine* engine,
             MotiveDimension dimensions)
@@ -129,6 +206,10 @@ class Motivator {
   /// directly.
   friend class MotiveProcessor;
 
+  /// MotivatorValueView reads `processor_` and `index_` to batch value
+  /// read-back by processor. It does not modify data.
+  friend class MotivatorValueView;
+
   /// These should only be called by MotiveProcessor!
   void Init(MotiveProcessor* processor, MotiveIndex index) {
     processor_ = processor;
@@ -0,0 +1,75 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_OSCILLATOR_INIT_H_
+#define MOTIVE_OSCILLATOR_INIT_H_
+
+#include "motive/simple_init_template.h"
+
+namespace motive {
+
+/// @class OscillatorInit
+/// @brief Initialize a MotivatorNf to generate procedural periodic motion.
+///
+/// The value oscillates around `start_values` forever:
+///
+///     value = center + amplitude * blend(phase)
+///
+/// where blend() mixes a sine wave with smooth value noise according to
+/// `noise_weights`: 0 is a pure sine, 1 is pure noise, and in-between gives
+/// an irregular wobble. Ambient motion--foliage sway, idle bobbing, light
+/// flicker--needs no targets and therefore no retargeting: where a spline
+/// motivator pays SetTargets() and a curve solve every cycle, an oscillator
+/// is set up once and evaluated in bulk forever after.
+///
+/// All parameter arrays hold one value per dimension and, like
+/// SimpleInit::start_values, point at external values that the caller keeps
+/// alive for the life of this struct.
+struct OscillatorInit : public SimpleInit {
+  MOTIVE_INTERFACE();
+  OscillatorInit()
+      : SimpleInit(kType),
+        amplitudes(nullptr),
+        frequencies(nullptr),
+        phases(nullptr),
+        noise_weights(nullptr) {}
+
+  /// @param center_values Value each dimension oscillates around.
+  /// @param amplitudes Peak offset from the center value.
+  /// @param frequencies Angular speed, in radians per time unit, so a
+  ///                    frequency of 2pi/1000 cycles once per 1000 time
+  ///                    units.
+  /// @param phases Starting phase in radians, or nullptr for all zero.
+  ///               Stagger these so identical objects don't move in
+  ///               lockstep.
+  /// @param noise_weights Noise fraction of the blend, in [0, 1], or
+  ///                      nullptr for pure sine.
+  OscillatorInit(const float* center_values, const float* amplitudes,
+                 const float* frequencies, const float* phases = nullptr,
+                 const float* noise_weights = nullptr)
+      : SimpleInit(kType, center_values),
+        amplitudes(amplitudes),
+        frequencies(frequencies),
+        phases(phases),
+        noise_weights(noise_weights) {}
+
+  const float* amplitudes;
+  const float* frequencies;
+  const float* phases;
+  const float* noise_weights;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_OSCILLATOR_INIT_H_
@@ -15,18 +15,111 @@
 #ifndef MOTIVE_PROCESSOR_H_
 #define MOTIVE_PROCESSOR_H_
 
+#include <cassert>
 #include <vector>
 
 #include "motive/common.h"
 #include "motive/math/compact_spline.h"
 #include "motive/math/vector_converter.h"
 #include "motive/target.h"
+#include "motive/util/buffer_allocator.h"
 #include "motive/util/index_allocator.h"
 
 namespace motive {
 
 class Motivator;
 class MotiveEngine;
+class RigAnim;
+
+/// @struct MotiveCrossing
+/// @brief One threshold crossing detected during AdvanceFrame().
+///
+/// Reported through the callback set by MotiveEngine::SetCrossingCallback().
+/// See MotivatorNf::SetCrossingThreshold().
+struct MotiveCrossing {
+  /// The Motivator whose value crossed its threshold. Valid only during the
+  /// callback.
+  const Motivator* motivator;
+
+  /// Which dimension of the motivator crossed, 0 for Motivator1f.
+  MotiveDimension dimension;
+
+  /// kCrossingRising or kCrossingFalling.
+  MotiveCrossingDirection direction;
+};
+
+/// @struct MotiveValueDelta
+/// @brief One quantized value change detected during AdvanceFrame().
+///
+/// Reported through the callback set by
+/// MotiveEngine::SetValueDeltaCallback(). The value has moved
+/// `quantized_delta * epsilon` since it was last reported, where `epsilon`
+/// is the quantization registered with the callback.
+struct MotiveValueDelta {
+  /// The Motivator whose value moved. Valid only during the callback.
+  const Motivator* motivator;
+
+  /// Which dimension of the motivator moved, 0 for Motivator1f.
+  MotiveDimension dimension;
+
+  /// Movement since the last report, in units of the registered epsilon.
+  /// Never zero.
+  int32_t quantized_delta;
+};
+
+/// @struct MotiveMemoryStats
+/// @brief Memory usage of one or more MotiveProcessors.
+///
+/// Filled by MotiveProcessor::AccumulateMemoryStats() and
+/// MotiveEngine::MemoryStats(). Byte counts cover the heap storage the
+/// processors own--per-index data arrays, bookkeeping arrays, and pooled
+/// per-index resources such as local splines--not the processor objects
+/// themselves. Feed these into your telemetry to track animation memory
+/// over time and to flag fragmentation before it becomes a problem.
+struct MotiveMemoryStats {
+  MotiveMemoryStats()
+      : allocated_bytes(0),
+        live_bytes(0),
+        num_indices(0),
+        capacity_indices(0),
+        unused_indices(0),
+        num_holes(0) {}
+
+  /// Heap bytes held, including spare vector capacity and pooled resources
+  /// that are currently free.
+  size_t allocated_bytes;
+
+  /// Bytes backing indices that currently drive a Motivator. The gap
+  /// between this and `allocated_bytes` is overhead: holes, spare capacity,
+  /// and idle pool entries.
+  size_t live_bytes;
+
+  /// Total slots in the data arrays, including unused holes.
+  /// See MotiveProcessor::NumIndices().
+  MotiveIndex num_indices;
+
+  /// Slots the index bookkeeping can hold before reallocating.
+  /// See MotiveProcessor::ReserveIndices().
+  MotiveIndex capacity_indices;
+
+  /// Slots wasted in holes awaiting Defragment().
+  MotiveIndex unused_indices;
+
+  /// Number of distinct holes. Many small holes that never drain indicate
+  /// fragmentation--say, from pinned blocks or a too-small defragment
+  /// budget. See MotiveProcessor::SetDefragmentBudget() and
+  /// ForceDefragment().
+  MotiveIndex num_holes;
+};
+
+/// Signature of the spline-resolver callback passed to
+/// MotiveEngine::RestoreCheckpoint(). Checkpoints do not serialize splines
+/// the caller owns; they record CompactSpline::ContentHash() instead. On
+/// restore, this callback maps `content_hash` back to the equivalent spline
+/// in the running process. Return nullptr if the hash is unknown; the index
+/// is then restored holding its last value, without a spline.
+typedef const CompactSpline* MotiveSplineResolverFn(void* userdata,
+                                                    uint64_t content_hash);
 
 /// @class MotiveProcessor
 /// @brief A MotiveProcessor processes *all* instances of one type of Motivator.
@@ -57,9 +150,16 @@ class MotiveProcessor {
  public:
   MotiveProcessor()
       : index_allocator_(allocator_callbacks_),
+        defragment_budget_(kUnlimitedDefragmentBudget),
+        high_water_indices_(0),
+        capacity_locked_(false),
+        locked_capacity_(0),
+        num_tiered_(0),
+        max_advance_pass_(0),
         benchmark_id_for_advance_frame_(-1),
         benchmark_id_for_init_(-1) {
     allocator_callbacks_.set_processor(this);
+    for (int t = 0; t < kNumUpdateTiers; ++t) tier_pending_time_[t] = 0;
   }
   virtual ~MotiveProcessor();
 
@@ -85,6 +185,38 @@ class MotiveProcessor {
   void InitializeMotivator(const MotivatorInit& init, MotiveEngine* engine,
                            Motivator* motivator, MotiveDimension dimensions);
 
+  /// Instantiate data for `num_motivators` motivators in one call.
+  ///
+  /// Equivalent to calling InitializeMotivator() once per motivator, but the
+  /// indices are allocated in a single contiguous run, so the internal arrays
+  /// grow once instead of once per motivator. Use this for spawn spikes, such
+  /// as creating a crowd of characters.
+  ///
+  /// This function should only be called by Motivator::InitializeBatch().
+  ///
+  /// @param inits Array of `num_motivators` initialization parameters, one
+  ///              per motivator. All must have the type() of this
+  ///              MotiveProcessor.
+  /// @param engine The owner of all the MotiveProcessors.
+  /// @param motivators Array of `num_motivators` pointers to the Motivators
+  ///                   to initialize.
+  /// @param num_motivators Number of motivators to initialize.
+  /// @param dimensions The number of slots each motivator consumes.
+  void InitializeMotivators(const MotivatorInit* const* inits,
+                            MotiveEngine* engine, Motivator* const* motivators,
+                            int num_motivators, MotiveDimension dimensions);
+
+  /// Ensure the internal arrays have capacity for `num_indices` total
+  /// indices, without changing NumIndices(). Subsequent Motivator creation
+  /// up to that capacity will not reallocate. Call before a known spawn
+  /// spike, e.g. when loading a level.
+  ///
+  /// @param num_indices Total number of indices to reserve storage for,
+  ///                    including those already allocated.
+  void ReserveIndices(MotiveIndex num_indices) {
+    index_allocator_.Reserve(num_indices);
+  }
+
   /// Remove an motivator and return its index to the pile of allocatable
   /// indices.
   ///
@@ -104,6 +236,24 @@ class MotiveProcessor {
   ///                      `index`.
   void TransferMotivator(MotiveIndex index, Motivator* new_motivator);
 
+  /// Returns true if this MotiveProcessor can copy motivator state from
+  /// another MotiveProcessor of the same Type(), i.e. whether it implements
+  /// CopyIndices(). Processors whose state references engine-owned resources
+  /// or child motivators (matrices, rigs) do not support migration.
+  virtual bool SupportsMigration() const { return false; }
+
+  /// Move `motivator` from the MotiveProcessor that currently drives it into
+  /// this MotiveProcessor, preserving its animation state. Both processors
+  /// must have the same Type() and must support migration.
+  ///
+  /// Use via MotiveEngine::MigrateMotivators(), which looks up the target
+  /// processor by type. Update-rate tiers and pinning do not migrate; reapply
+  /// them after the move if needed.
+  ///
+  /// @param motivator The Motivator to adopt. Its handle is rebound to this
+  ///                  MotiveProcessor; the old indices are freed.
+  void MigrateMotivator(Motivator* motivator);
+
   /// Returns true if `index` is currently driving a motivator. Does not do
   /// any validity checking, however, like ValidMotivatorIndex() does.
   /// @param index Reference into the MotiveProcessor's internal arrays.
@@ -135,6 +285,209 @@ class MotiveProcessor {
   ///                   are determined by the user.
   virtual void AdvanceFrame(MotiveTime delta_time) = 0;
 
+  /// Called once, serially, before AdvanceFrameRange() jobs are issued for
+  /// this frame. Perform work that cannot run concurrently here, for example
+  /// Defragment(). Only called when the MotiveEngine has a MotiveJobSystem.
+  virtual void BeginAdvanceFrame(MotiveTime /*delta_time*/) {}
+
+  /// Number of indices spanned by one cache line in the narrowest
+  /// per-index arrays, whose elements are one byte (e.g. the evaluator's
+  /// dormant flags). The per-index arrays themselves start on a cache-line
+  /// boundary--see kBufferAlignment in motive/util/buffer_allocator.h--so
+  /// an index range that starts on a multiple of this also starts on a
+  /// cache-line boundary in every array.
+  static const MotiveIndex kIndicesPerCacheLine = 64;
+
+  /// Number of indices that one AdvanceFrameRange() job should process, or 0
+  /// if this MotiveProcessor cannot split AdvanceFrame() into independent
+  /// ranges. When non-zero, the MotiveEngine may call AdvanceFrameRange()
+  /// concurrently from several workers instead of calling AdvanceFrame().
+  /// The value must be a multiple of kIndicesPerCacheLine, so that adjacent
+  /// workers never write to the same cache line at a range boundary.
+  virtual MotiveIndex ParallelSliceSize() const { return 0; }
+
+  /// Advance only the indices in [start_index, end_index). Must be safe to
+  /// call concurrently with other, non-overlapping ranges. Only called when
+  /// ParallelSliceSize() returns non-zero.
+  virtual void AdvanceFrameRange(MotiveTime /*delta_time*/,
+                                 MotiveIndex /*start_index*/,
+                                 MotiveIndex /*end_index*/) {
+    assert(false);
+  }
+
+  /// Number of update-rate tiers supported by SetUpdateTier().
+  static const int kNumUpdateTiers = 3;
+
+  /// Assign the motivator at `index` to an update-rate tier. Tier 0, the
+  /// default, advances every frame. Tier `t` advances every (1 << t)-th
+  /// frame, with the skipped frames' delta_time applied in one larger step,
+  /// so no simulation time is lost. Use higher tiers for background items
+  /// where a lower update rate is not noticeable.
+  ///
+  /// Tiers only take effect on processors that support index ranges (see
+  /// ParallelSliceSize()); other processors advance every index every frame
+  /// regardless of tier. Moving a motivator between tiers mid-cycle may
+  /// advance it one step early or drop one skipped frame's time.
+  /// AdvanceFrameWithBudget() has its own catch-up bookkeeping and ignores
+  /// tiers.
+  ///
+  /// Virtual so that processors with child motivators, such as rigs, can
+  /// forward the tier to their children.
+  ///
+  /// @param index Reference into the MotiveProcessor's internal arrays.
+  /// @param tier Tier to assign, in [0, kNumUpdateTiers).
+  virtual void SetUpdateTier(MotiveIndex index, int tier);
+
+  /// Returns the update-rate tier of the motivator at `index`.
+  int UpdateTier(MotiveIndex index) const {
+    return update_tiers_.empty() ? 0 : update_tiers_[index];
+  }
+
+  /// Returns true if any index has been assigned a tier other than 0.
+  bool HasTieredIndices() const { return num_tiered_ > 0; }
+
+  /// Advance the simulation by `delta_time`, honoring update-rate tiers.
+  /// Equivalent to AdvanceFrame() when no index is tiered. Tier `t` is
+  /// advanced only when `frame_number` is a multiple of (1 << t), with the
+  /// time its indices accumulated since their last step.
+  ///
+  /// This function should only be called by the MotiveEngine, which supplies
+  /// its frame counter so that tiers stay in phase across processors.
+  void AdvanceFrameTiered(MotiveTime delta_time, uint32_t frame_number);
+
+  /// Number of dependency-ordered advance passes supported by
+  /// SetAdvancePass().
+  static const int kNumAdvancePasses = 4;
+
+  /// Assign the motivator at `index` to a dependency pass, in
+  /// [0, kNumAdvancePasses). Pass 0, the default, advances in the engine's
+  /// normal priority order. Indices in pass `p` advance only after every
+  /// processor has finished pass `p - 1`, so they read current-frame values
+  /// from processors that would otherwise advance after them--say, a spline
+  /// target fed by a matrix motivator's output. Prefer declaring the
+  /// relationship with MotiveEngine::AddDependency(), which computes the
+  /// pass.
+  ///
+  /// Update-rate tiers are honored only for pass-0 indices; indices in
+  /// later passes advance every frame. Processors that cannot advance index
+  /// ranges (ParallelSliceSize() <= 0) ignore passes and advance whole in
+  /// pass 0.
+  ///
+  /// Virtual so that processors with child motivators can forward the pass
+  /// to their children.
+  virtual void SetAdvancePass(MotiveIndex index, int pass);
+
+  /// Returns the dependency pass of the motivator at `index`.
+  int AdvancePass(MotiveIndex index) const {
+    return advance_passes_.empty() ? 0 : advance_passes_[index];
+  }
+
+  /// Highest pass any index is assigned to. The engine runs passes
+  /// [0, MaxAdvancePass()] each frame. May briefly overstate after the
+  /// last index of the highest pass is removed; the spurious passes
+  /// advance nothing.
+  int MaxAdvancePass() const { return max_advance_pass_; }
+
+  /// Advance only the indices assigned to `pass` by `delta_time`.
+  /// Equivalent to AdvanceFrameTiered() for pass 0 when every index is in
+  /// pass 0--the common case--and then a no-op for later passes.
+  ///
+  /// This function should only be called by the MotiveEngine, once per
+  /// frame for each pass, with passes ascending.
+  void AdvanceFramePass(MotiveTime delta_time, int pass,
+                        uint32_t frame_number);
+
+  /// Turn double-buffered value snapshots on or off. See
+  /// MotiveEngine::SetFrameSnapshots(). The default implementation does
+  /// nothing; only processors with renderer-facing values keep snapshots.
+  virtual void SetFrameSnapshots(bool /*enable*/) {}
+
+  /// Publish this frame's values to the snapshot read buffer. Called by the
+  /// MotiveEngine at the end of AdvanceFrame(), after every processor has
+  /// advanced, and only when snapshots are enabled.
+  virtual void PublishFrameSnapshot() {}
+
+  /// Turn completion tracking on or off. See
+  /// MotiveEngine::SetCompletionCallback(). The default implementation does
+  /// nothing; only processors that can detect arrival during AdvanceFrame()
+  /// report completions.
+  virtual void SetTrackCompletions(bool /*enable*/) {}
+
+  /// Append the Motivators whose animations finished since the last call to
+  /// `completed`. Called by the MotiveEngine at the end of AdvanceFrame(),
+  /// after every processor has advanced, and only when a completion callback
+  /// is set.
+  virtual void CollectCompletions(
+      std::vector<const Motivator*>* /*completed*/) {}
+
+  /// Append the threshold crossings detected since the last call to
+  /// `crossings`. Called by the MotiveEngine at the end of AdvanceFrame(),
+  /// after every processor has advanced, and only when a crossing callback
+  /// is set. The default implementation does nothing; only processors that
+  /// detect crossings during their bulk evaluation report them.
+  virtual void CollectCrossings(std::vector<MotiveCrossing>* /*crossings*/) {}
+
+  /// Turn changed-value tracking on or off. See
+  /// MotiveEngine::SetValueDeltaCallback(). `epsilon` is the quantization
+  /// step; movement smaller than it accumulates unreported. The default
+  /// implementation does nothing; only processors that keep their values
+  /// in bulk arrays report deltas.
+  virtual void SetTrackValueDeltas(bool /*enable*/, float /*epsilon*/) {}
+
+  /// Append the values that moved by at least the registered epsilon since
+  /// they were last reported to `deltas`. Called by the MotiveEngine at the
+  /// end of AdvanceFrame(), after every processor has advanced, and only
+  /// when a value-delta callback is set.
+  virtual void CollectValueDeltas(std::vector<MotiveValueDelta>* /*deltas*/) {
+  }
+
+  /// Pin evaluation to instruction selections that are bit-exact across
+  /// platforms. See MotiveEngine::SetDeterministic(). The default
+  /// implementation does nothing; only processors with platform-specific
+  /// optimized paths have anything to pin.
+  virtual void SetDeterministic(bool /*enable*/) {}
+
+  /// Returns true if this MotiveProcessor can serialize and restore its
+  /// per-index state via SaveCheckpointState()/RestoreCheckpointState().
+  /// The default is false; processors whose state references other
+  /// processors or engine-owned resources cannot checkpoint.
+  virtual bool SupportsCheckpoint() const { return false; }
+
+  /// Append this MotiveProcessor's per-index state to `out`, covering all
+  /// NumIndices() indices. Called by MotiveEngine::SaveCheckpoint(), after
+  /// a full defragment, and only when SupportsCheckpoint() returns true.
+  virtual void SaveCheckpointState(std::vector<uint8_t>* /*out*/) const {}
+
+  /// Restore state previously appended by SaveCheckpointState(). The
+  /// processor must already hold the same index layout it had when the
+  /// state was saved; see MotiveEngine::RestoreCheckpoint(). Returns false
+  /// if `num_bytes` doesn't match that layout or some state could not be
+  /// restored.
+  virtual bool RestoreCheckpointState(const uint8_t* /*bytes*/,
+                                      size_t /*num_bytes*/,
+                                      MotiveSplineResolverFn* /*resolver*/,
+                                      void* /*userdata*/) {
+    return false;
+  }
+
+  /// Re-point every index playing one of `old_splines` at the paired entry
+  /// in `new_splines`, preserving the current playback position and rate.
+  /// A null new spline means the old spline no longer exists; the index
+  /// then holds its current value, splineless. Called by
+  /// MotiveEngine::RebindSplines(); the default does nothing, which is
+  /// correct for processors that never hold caller-owned spline pointers.
+  virtual void RebindSplines(const CompactSpline* const* /*old_splines*/,
+                             const CompactSpline* const* /*new_splines*/,
+                             int /*num_splines*/) {}
+
+  /// Re-point any bookkeeping that references one of `old_anims` at the
+  /// paired entry in `new_anims`. The splines inside the anims are rebound
+  /// separately via RebindSplines(). Called by
+  /// MotiveEngine::RebindAnims(); the default does nothing.
+  virtual void RebindAnims(const RigAnim* const* /*old_anims*/,
+                           const RigAnim* const* /*new_anims*/,
+                           int /*num_anims*/) {}
+
   /// Should return kType of the MotivatorInit class for the derived processor.
   /// kType is defined by the macro MOTIVE_INTERFACE, which is put in
   /// a processor's MotivatorInit derivation.
@@ -152,6 +505,127 @@ class MotiveProcessor {
     return index_allocator_.CountForIndex(index);
   }
 
+  /// The total number of slots in the MotiveProcessor, including unused slots
+  /// that have yet to be reclaimed by Defragment(). Used by the MotiveEngine
+  /// to split AdvanceFrameRange() calls across workers.
+  MotiveIndex NumIndices() const { return index_allocator_.num_indices(); }
+
+  /// The number of slots currently driving Motivators. The difference
+  /// between this and NumIndices() is the slots wasted in holes awaiting
+  /// Defragment().
+  MotiveIndex NumLiveIndices() const {
+    return index_allocator_.num_indices() -
+           index_allocator_.NumUnusedIndices();
+  }
+
+  /// The largest value NumIndices() has ever reached in this processor's
+  /// lifetime. Record at shutdown and feed back through
+  /// MotiveEngine::ReserveCapacities() at the next startup, so a warmed
+  /// process sizes its data arrays once instead of re-learning the peak
+  /// through repeated growth; see MotiveEngine::CapacityHighWaterMarks().
+  /// ReserveIndices() counts toward the mark, so a reservation made from a
+  /// recorded mark carries it forward even if the session stays below it.
+  MotiveIndex HighWaterIndices() const { return high_water_indices_; }
+
+  /// Forbid the data arrays from growing past their current high-water
+  /// mark. After capacity has been reserved with ReserveIndices()--
+  /// typically from marks recorded by a tuning run; see
+  /// MotiveEngine::CapacityHighWaterMarks()--locking guarantees that no
+  /// later Motivator creation reallocates, so this processor's memory
+  /// footprint is fixed for the rest of the session. Creating motivators
+  /// beyond the locked capacity asserts. See
+  /// MotiveEngine::SetCapacitiesLocked().
+  void SetCapacityLocked(bool locked) {
+    capacity_locked_ = locked;
+    if (locked) locked_capacity_ = high_water_indices_;
+  }
+
+  /// Returns true while growth past the locked capacity is forbidden.
+  bool CapacityLocked() const { return capacity_locked_; }
+
+  /// Limit the number of indices that one Defragment() call may move.
+  ///
+  /// By default the budget is kUnlimitedDefragmentBudget, and each
+  /// AdvanceFrame() fully compacts the data arrays. When many Motivators are
+  /// removed in one frame (a level transition, say), that full compaction can
+  /// cause a frame spike. Setting a budget caps the per-frame compaction cost;
+  /// remaining holes are backfilled over succeeding frames. Holes that have
+  /// yet to be backfilled are still processed by AdvanceFrame(), so a small
+  /// budget trades steady-state throughput for smoother removal spikes.
+  ///
+  /// @param max_moved_indices Maximum indices to move per Defragment() call,
+  ///                          or kUnlimitedDefragmentBudget for no limit.
+  void SetDefragmentBudget(MotiveIndex max_moved_indices) {
+    defragment_budget_ = max_moved_indices;
+  }
+
+  /// Fully compact the data arrays, ignoring the defragment budget.
+  /// Useful behind loading screens, where a one-off spike is acceptable.
+  void ForceDefragment() { index_allocator_.Defragment(); }
+
+  /// Pin or unpin the motivator block at `index`. A pinned block is excluded
+  /// from Defragment() moves, so its indices stay fixed until the motivator
+  /// is removed or unpinned. Holes left by removing neighboring motivators
+  /// may be unfillable while a block is pinned; they are recycled by later
+  /// allocations instead.
+  /// See Motivator::SetPinned() for the intended use.
+  /// @param index Reference into the MotiveProcessor's internal arrays.
+  /// @param pinned True to exclude the block from Defragment() moves.
+  void SetIndexPinned(MotiveIndex index, bool pinned) {
+    assert(ValidMotivatorIndex(index));
+    if (pinned) {
+      index_allocator_.Pin(index);
+    } else {
+      index_allocator_.Unpin(index);
+    }
+  }
+
+  /// Returns true if the motivator block at `index` is pinned.
+  bool IndexPinned(MotiveIndex index) const {
+    return index_allocator_.Pinned(index);
+  }
+
+  /// Number of teardown groups supported by SetGroup(). Groups are stored
+  /// per index in one byte, like update-rate tiers.
+  static const int kNumMotivatorGroups = 256;
+
+  /// Tag the motivator at `index` with a teardown group, so that
+  /// DestroyGroup() can remove it--along with everything else in the
+  /// group--in one pass. Group 0, the default, is never destroyed in bulk.
+  /// See Motivator::SetGroup() for the intended use.
+  /// @param index Reference into the MotiveProcessor's internal arrays.
+  /// @param group Group to assign, in [0, kNumMotivatorGroups).
+  void SetGroup(MotiveIndex index, int group);
+
+  /// Returns the teardown group of the motivator at `index`; 0 by default.
+  int Group(MotiveIndex index) const {
+    return groups_.empty() ? 0 : groups_[index];
+  }
+
+  /// Remove every motivator tagged with `group` in one pass over the
+  /// internal arrays. Equivalent to invalidating each of the group's
+  /// motivators through its handle, but the per-motivator bookkeeping--a
+  /// virtual dispatch and a state verification per handle--is replaced by
+  /// one sweep, so mass teardown scales with the number of live indices
+  /// rather than with per-handle overhead. The destroyed Motivator handles
+  /// are reset, as when the processor is destroyed, so their destructors
+  /// later do nothing. The freed indices are compacted by the normal
+  /// Defragment(). Use via MotiveEngine::DestroyGroup().
+  /// @param group Group to destroy, in [1, kNumMotivatorGroups).
+  /// @return Number of motivators destroyed.
+  int DestroyGroup(int group);
+
+  /// Add this MotiveProcessor's memory usage to `stats`. Accumulates rather
+  /// than overwrites, so one MotiveMemoryStats can total several processors;
+  /// see MotiveEngine::MemoryStats() for the engine-wide sum.
+  ///
+  /// The shared bookkeeping--index allocator, motivator back-pointers,
+  /// update tiers--is counted here; each processor reports its own data
+  /// arrays via AccumulateDataMemoryStats().
+  ///
+  /// @param stats The stats to add this MotiveProcessor's usage to.
+  void AccumulateMemoryStats(MotiveMemoryStats* stats) const;
+
   /// Ensure that the internal state is consistent. Call periodically when
   /// debugging problems where the internal state is corrupt.
   void VerifyInternalState() const;
@@ -189,17 +663,51 @@ class MotiveProcessor {
   virtual void MoveIndices(MotiveIndex old_index, MotiveIndex new_index,
                            MotiveDimension dimensions) = 0;
 
+  /// Copy the state of [source_index, source_index + dimensions) in `source`
+  /// --a MotiveProcessor of the same Type()--into [index, index + dimensions)
+  /// in this MotiveProcessor. The target range is freshly allocated and
+  /// uninitialized. Used by MigrateMotivator(); only called on processors
+  /// whose SupportsMigration() returns true. Deep-copy any per-index
+  /// resources the processor owns (e.g. pooled splines), since the source's
+  /// indices are removed right after this call.
+  virtual void CopyIndices(MotiveIndex /*index*/,
+                           MotiveDimension /*dimensions*/,
+                           const MotiveProcessor& /*source*/,
+                           MotiveIndex /*source_index*/) {
+    assert(false);  // Processor claims SupportsMigration() but doesn't copy.
+  }
+
+  /// Add the memory usage of the per-index data arrays--which only the
+  /// derived processor knows the layout of--to `stats`. Called by
+  /// AccumulateMemoryStats(). Add vector capacities (and any per-index heap
+  /// resources, such as pooled splines) to `allocated_bytes`, and the bytes
+  /// backing NumLiveIndices() indices to `live_bytes`. The default adds
+  /// nothing, so processors that don't override this under-report their
+  /// data arrays rather than guessing.
+  virtual void AccumulateDataMemoryStats(MotiveMemoryStats* /*stats*/) const {}
+
   /// Increase or decrease the total number of indices.
   /// If decreased, existing indices >= num_indices should be uninitialized.
   /// If increased, internal arrays should be extended to new_indices, and
   /// new items in the arrays should be initialized as reset.
   virtual void SetNumIndices(MotiveIndex num_indices) = 0;
 
+  /// The Motivator that owns `index`, or nullptr if the index is free.
+  /// All indices of a multi-dimensional motivator's contiguous block return
+  /// the same Motivator.
+  const Motivator* MotivatorForIndex(MotiveIndex index) const {
+    return motivators_[index];
+  }
+
   /// When an index is moved, the Motivator that references that index is
   /// updated. Can be called at the discretion of your MotiveProcessor,
   /// but normally called at the beginning of your
   /// MotiveProcessor::AdvanceFrame.
-  void Defragment() { index_allocator_.Defragment(); }
+  /// Honors the budget set by SetDefragmentBudget(), so compaction may be
+  /// left unfinished and resumed on the next call.
+  void Defragment() {
+    index_allocator_.DefragmentWithBudget(defragment_budget_);
+  }
 
  private:
   typedef IndexAllocator<MotiveIndex> MotiveIndexAllocator;
@@ -235,7 +743,7 @@ class MotiveProcessor {
   /// Note that we only keep a reference to a single Motivator per index.
   /// When a copy of an Motivator is made, the old Motivator is Reset and the
   /// reference here is updated.
-  std::vector<Motivator*> motivators_;
+  std::vector<Motivator*, BufferAllocator<Motivator*>> motivators_;
 
   /// Proxy calbacks into MotiveProcessor. The other option is to derive
   /// MotiveProcessor from IndexAllocator::CallbackInterface, but that would
@@ -250,6 +758,49 @@ class MotiveProcessor {
   /// size of the data arrays.
   MotiveIndexAllocator index_allocator_;
 
+  /// Maximum number of indices that one Defragment() call may move.
+  /// See SetDefragmentBudget().
+  MotiveIndex defragment_budget_;
+
+  /// Largest value NumIndices() has ever reached. See HighWaterIndices().
+  MotiveIndex high_water_indices_;
+
+  /// When true, SetNumIndicesBase() asserts instead of growing past
+  /// `locked_capacity_`. See SetCapacityLocked().
+  bool capacity_locked_;
+
+  /// The high-water mark recorded when the capacity was locked. Only
+  /// meaningful while `capacity_locked_` is true.
+  MotiveIndex locked_capacity_;
+
+  /// Update-rate tier of each index. Empty until SetUpdateTier() assigns a
+  /// non-zero tier, since most processors never use tiers. Kept in lock-step
+  /// with `motivators_` when indices are moved or freed.
+  std::vector<uint8_t> update_tiers_;
+
+  /// Time accumulated for each tier since its indices last advanced.
+  /// Zeroed for a tier whenever AdvanceFrameTiered() steps that tier.
+  MotiveTime tier_pending_time_[kNumUpdateTiers];
+
+  /// Number of indices in a tier other than 0. When zero,
+  /// AdvanceFrameTiered() reduces to AdvanceFrame().
+  MotiveIndex num_tiered_;
+
+  /// Dependency pass of each index. Empty until SetAdvancePass() assigns a
+  /// non-zero pass, since most processors never need multiple passes. Kept
+  /// in lock-step with `motivators_` by the same bookkeeping as
+  /// `update_tiers_`.
+  std::vector<uint8_t> advance_passes_;
+
+  /// Highest pass in `advance_passes_`; zero when the array is empty.
+  int max_advance_pass_;
+
+  /// Teardown group of each index. Empty until SetGroup() assigns a
+  /// non-zero group, since most processors never use groups. Kept in
+  /// lock-step with `motivators_` by the same bookkeeping as
+  /// `update_tiers_`.
+  std::vector<uint8_t> groups_;
+
   int benchmark_id_for_advance_frame_;
   int benchmark_id_for_init_;
 };
@@ -262,6 +813,7 @@ struct MotiveProcessorFunctions {
   MotiveProcessorCreateFn* create;
   MotiveProcessorDestroyFn* destroy;
 
+  MotiveProcessorFunctions() : create(nullptr), destroy(nullptr) {}
   MotiveProcessorFunctions(MotiveProcessorCreateFn* create,
                            MotiveProcessorDestroyFn* destroy)
       : create(create), destroy(destroy) {}
@@ -57,9 +57,67 @@ class RigAnim {
     return idx < bone_names_.size() ? bone_names_[idx].c_str() : "unknown";
   }
 
+  /// True if `record_names` was specified in `Init()`, i.e. BoneName() and
+  /// anim_name() return recorded data rather than placeholders.
+  bool has_bone_names() const { return !bone_names_.empty(); }
+
   /// Total number of matrix operations across all MatrixAnims in this RigAnim.
   int NumOps() const;
 
+  /// Copy every bone's matrix ops into one contiguous array with per-bone
+  /// offsets, so that initialization and per-frame op iteration walk
+  /// sequential memory instead of one heap allocation per bone. Call once
+  /// after every bone's ops are fully constructed; loaders do this
+  /// automatically. The per-bone vectors remain the authoritative storage,
+  /// so call again if ops are mutated afterwards.
+  void PackOps();
+
+  /// True once PackOps() has been called.
+  bool ops_packed() const { return !packed_bone_starts_.empty(); }
+
+  /// Return a pointer to the `idx`th bone's ops, and their count in
+  /// `num_ops`. Reads the packed array when PackOps() has been called, and
+  /// the bone's own vector otherwise.
+  const MatrixOperationInit* BoneOps(BoneIndex idx, int* num_ops) const {
+    if (ops_packed()) {
+      assert(idx < NumBones());
+      const int start = packed_bone_starts_[idx];
+      *num_ops = packed_bone_starts_[idx + 1] - start;
+      return packed_ops_.data() + start;
+    }
+    const std::vector<MatrixOperationInit>& ops = Anim(idx).ops();
+    *num_ops = static_cast<int>(ops.size());
+    return ops.data();
+  }
+
+  /// For construction. Allocates one contiguous chunk of memory that holds
+  /// every CompactSpline in the whole rig animation--all bones' channels.
+  /// Create splines inside it with CompactSpline::CreateInPlace(), so that
+  /// loading a rig performs one spline allocation instead of one per bone,
+  /// and evaluating the anim touches one memory region. The chunk is owned
+  /// by this class; splines inside it must not be individually Destroy()ed,
+  /// so leave MatrixAnim::Spline::spline null when using this mode.
+  /// @param size Total bytes of all splines, i.e. the sum of
+  ///             CompactSpline::Size(num_nodes) over every spline.
+  uint8_t* AllocateSplineBuffer(size_t size) {
+    // Note: This buffer must not be moved after construction, since the
+    //       bones' ops point into it.
+    spline_buffer_.resize(size);
+    return spline_buffer_.data();
+  }
+
+  /// Approximate heap bytes held by this animation, dominated by its spline
+  /// data. Used for streaming memory budgets; not exact.
+  size_t ApproxSizeBytes() const;
+
+  /// Hash of everything that affects playback: end time, repeat flag, the
+  /// bone hierarchy, and every bone's ops with their constants and curves
+  /// (via CompactSpline::ContentHash()). Debug-only data--the animation and
+  /// bone names--is excluded, so the same clip exported under different
+  /// names hashes equally. AnimTable uses this to share one RigAnim between
+  /// byte-identical payloads.
+  uint64_t ContentHash() const;
+
   /// Gets the splines and constants that drive the operations in `ops`,
   /// for the specified bone. If an operation is not driven by the bone,
   /// return the default value for that op in `constants`.
@@ -120,6 +178,19 @@ class RigAnim {
  private:
   std::vector<MatrixAnim> anims_;
   std::vector<BoneIndex> bone_parents_;
+
+  /// All bones' ops packed into one contiguous array; see PackOps().
+  /// `packed_bone_starts_` has NumBones() + 1 entries, so bone i's ops are
+  /// packed_ops_[packed_bone_starts_[i]] .. packed_ops_[packed_bone_starts_[i + 1] - 1].
+  /// Empty until PackOps() is called.
+  std::vector<MatrixOperationInit> packed_ops_;
+  std::vector<int> packed_bone_starts_;
+
+  /// Optional single buffer holding every CompactSpline in every bone's
+  /// animation, created via AllocateSplineBuffer(). Empty when splines are
+  /// owned by the individual MatrixAnims.
+  std::vector<uint8_t> spline_buffer_;
+
   std::vector<std::string> bone_names_;
   MotiveTime end_time_;
   bool repeat_;
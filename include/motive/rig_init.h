@@ -40,6 +40,15 @@ class RigInit : public MotivatorInit {
                                BoneIndex len_b);
   static bool MatchesHierarchy(const RigAnim& anim_a, const RigAnim& anim_b);
 
+  // Returns true if every bone's parent precedes it in `bone_parents`
+  // (roots have parent kInvalidBoneIdx). Validated once here at init so the
+  // per-frame global-transform update can be a single forward pass over the
+  // bone array, with no hierarchy checks and no separate traversal order.
+  // The same memory-order guarantee lets a future SIMD pass process
+  // consecutive bones in groups.
+  static bool TopologicallyOrdered(const BoneIndex* bone_parents,
+                                   BoneIndex num_bones);
+
  private:
   /// Animation defining hierarchy and the union of matrix ops (across all
   /// animations).
@@ -20,6 +20,7 @@
 
 namespace motive {
 
+class BakedClip;
 class RigAnim;
 
 class RigMotivator : public Motivator {
@@ -43,17 +44,76 @@ class RigMotivator : public Motivator {
     Processor().BlendToAnim(index_, anim, playback);
   }
 
+  /// Blend from the current state to the weighted combination of `anims`.
+  /// All anims must fit the defining anim's hierarchy. Each frame, the
+  /// operation values of all anims are mixed with weighted sums (weights are
+  /// normalized internally) before the bone matrices are composed. This is a
+  /// good approximation when the anims' poses are similar--e.g. an
+  /// idle/walk/run/strafe locomotion set--but degrades when rotations
+  /// diverge by more than about a half turn.
+  void BlendToAnims(const RigAnim* const* anims, const float* weights,
+                    int num_anims, const SplinePlayback& playback) {
+    Processor().BlendToAnims(index_, anims, weights, num_anims, playback);
+  }
+
+  /// Update the weights of a blend started with BlendToAnims(). Cheap
+  /// enough to call every frame, e.g. while a character accelerates from
+  /// walk to run. If all weights are zero, the rig holds its last pose.
+  void SetBlendWeights(const float* weights, int num_weights) {
+    Processor().SetBlendWeights(index_, weights, num_weights);
+  }
+
+  /// Restrict animation to the bones with non-zero `enabled` entries.
+  /// Masked-out bones release their child motivators--shrinking spline
+  /// evaluation load and rig memory by the masked fraction--and hold the
+  /// constant pose the defining anim gives them. Typical use: distant
+  /// characters mask fingers and face. Pass nullptr to re-enable every
+  /// bone; re-enabled bones hold that pose until the next BlendToAnim().
+  void SetBoneMask(const uint8_t* enabled, int num_mask_bones) {
+    Processor().SetBoneMask(index_, enabled, num_mask_bones);
+  }
+
   void SetPlaybackRate(float playback_rate) {
     Processor().SetPlaybackRate(index_, playback_rate);
   }
 
+  /// Play `clip` by lerping its baked keyframes. No splines are evaluated
+  /// while the clip plays, so per-frame cost is a small constant regardless
+  /// of how dense the source anim's curves were. Intended as a
+  /// level-of-detail mode: distant or background characters play baked
+  /// clips, and BlendToAnim() restores full spline playback when the
+  /// character matters again. `clip` must be baked from an anim that fits
+  /// this rig, and must outlive the playback.
+  void PlayBakedClip(const BakedClip& clip) {
+    Processor().PlayBakedClip(index_, clip);
+  }
+
   /// Returns array of matricies: one for each bone position. The matrices are
   /// all in the space of the root bones. That is, the bone hierarchy has been
   /// flattened.
+  /// When MotiveEngine::SetFrameSnapshots() is enabled, returns the palette
+  /// published at the end of the last engine update, which is safe to read
+  /// from a render thread while the simulation writes the next frame.
   const mathfu::AffineTransform* GlobalTransforms() const {
     return Processor().GlobalTransforms(index_);
   }
 
+  /// Ask the processor to convert the global transforms into a
+  /// dual-quaternion palette as it composes them each frame, while the bone
+  /// data is still hot in cache. For renderers that skin with dual quats,
+  /// this replaces a separate full pass over every bone after the update.
+  void SetDualQuaternionPalette(bool enable) {
+    Processor().SetDualQuaternionPalette(index_, enable);
+  }
+
+  /// Returns one DualQuaternion per bone, equivalent to GlobalTransforms()
+  /// minus any scale, or nullptr if the palette is not enabled. Read it
+  /// after the engine update; it is not double-buffered by
+  /// MotiveEngine::SetFrameSnapshots().
+  const DualQuaternion* DualQuaternions() const {
+    return Processor().DualQuaternions(index_);
+  }
+
   /// Returns the shell aniamtion that defines this rig. It contains all the
   /// bones and operations-on-those-bones that can be animated.
   ///
@@ -19,8 +19,21 @@
 
 namespace motive {
 
+class BakedClip;
 class RigAnim;
 
+/// @struct DualQuaternion
+/// @brief One bone of a dual-quaternion skinning palette.
+///
+/// `real` carries the bone's rotation and `dual` its translation, both
+/// stored (x, y, z, w), so a palette uploads as two vec4s per bone.
+/// Dual quaternions represent rigid transforms only; scale in the bone's
+/// matrix is lost in the conversion.
+struct DualQuaternion {
+  float real[4];
+  float dual[4];
+};
+
 class RigProcessor : public MotiveProcessor {
  public:
   /// Returns an array of length `DefiningAnim.NumBones()`.
@@ -29,6 +42,18 @@ class RigProcessor : public MotiveProcessor {
   virtual const mathfu::AffineTransform* GlobalTransforms(
       MotiveIndex index) const = 0;
 
+  /// Enable or disable the dual-quaternion palette for this rig.
+  /// Processors that can't produce one ignore the call.
+  virtual void SetDualQuaternionPalette(MotiveIndex /*index*/,
+                                        bool /*enable*/) {}
+
+  /// Returns an array of length `DefiningAnim.NumBones()`, converted from
+  /// the same global transforms as GlobalTransforms() during the update, or
+  /// nullptr if SetDualQuaternionPalette() has not enabled the palette.
+  virtual const DualQuaternion* DualQuaternions(MotiveIndex /*index*/) const {
+    return nullptr;
+  }
+
   /// Return the time remaining in the current matrix animation.
   virtual MotiveTime TimeRemaining(MotiveIndex index) const = 0;
 
@@ -42,6 +67,34 @@ class RigProcessor : public MotiveProcessor {
   virtual void BlendToAnim(MotiveIndex index, const RigAnim& anim,
                            const motive::SplinePlayback& playback) = 0;
 
+  /// Smoothly transition to the weighted combination of `anims`.
+  /// Processors that don't support N-way blending fall back to the
+  /// highest-weighted anim.
+  virtual void BlendToAnims(MotiveIndex index, const RigAnim* const* anims,
+                            const float* weights, int num_anims,
+                            const motive::SplinePlayback& playback) {
+    assert(num_anims > 0);
+    int heaviest = 0;
+    for (int i = 1; i < num_anims; ++i) {
+      if (weights[i] > weights[heaviest]) heaviest = i;
+    }
+    BlendToAnim(index, *anims[heaviest], playback);
+  }
+
+  /// Update the weights of a blend started with BlendToAnims().
+  virtual void SetBlendWeights(MotiveIndex /*index*/, const float* /*weights*/,
+                               int /*num_weights*/) {}
+
+  /// Restrict animation to the bones with non-zero `enabled` entries.
+  /// Processors that don't support masking animate every bone.
+  virtual void SetBoneMask(MotiveIndex /*index*/, const uint8_t* /*enabled*/,
+                           int /*num_mask_bones*/) {}
+
+  /// Play `clip` by lerping its baked keyframes instead of evaluating
+  /// splines. Processors that don't support baked playback ignore the call.
+  virtual void PlayBakedClip(MotiveIndex /*index*/,
+                             const BakedClip& /*clip*/) {}
+
   /// Instantly change the playback speed of this animation.
   virtual void SetPlaybackRate(MotiveIndex index, float playback_rate) = 0;
 
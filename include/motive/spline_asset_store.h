@@ -0,0 +1,93 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_SPLINE_ASSET_STORE_H_
+#define MOTIVE_SPLINE_ASSET_STORE_H_
+
+#include <mutex>
+#include <unordered_map>
+
+#include "motive/math/compact_spline.h"
+
+namespace motive {
+
+/// @class SplineAssetStore
+/// @brief Process-wide store of immutable, shared CompactSplines.
+///
+/// With one MotiveEngine per worker thread, each engine would otherwise keep
+/// its own copy of every clip it plays, so 64 engines animating the same 200
+/// clips would hold 64 sets of node buffers. The store keeps exactly one
+/// immutable copy of each distinct spline--content-addressed, so two
+/// byte-identical splines loaded from different files still share storage--
+/// and hands out const pointers that stay valid for the lifetime of the
+/// store. Those pointers can be passed to MotivatorNf::SetSplines() from any
+/// number of engines and threads without copying; the spline processors and
+/// BulkSplineEvaluator only ever read the splines they are given.
+///
+/// Add() and Find() may be called concurrently from any thread. They take a
+/// lock, so call them at load or spawn time, not per frame.
+class SplineAssetStore {
+ public:
+  SplineAssetStore() {}
+  ~SplineAssetStore() { Clear(); }
+
+  /// Return the shared copy of `spline`, adding one to the store if no
+  /// spline with the same content exists yet. The returned pointer stays
+  /// valid until Clear() or destruction. The copy is exact--same quantized
+  /// nodes, y-range, and granularity--and trimmed to its node count, so the
+  /// store never holds unused node capacity.
+  const CompactSpline* Add(const CompactSpline& spline);
+
+  /// Return the stored spline whose ContentId() is `content_id`, or nullptr
+  /// if none has been added. Useful when clips are keyed by content id at
+  /// build time, so runtime lookups need not touch the node data at all.
+  const CompactSpline* Find(uint64_t content_id) const;
+
+  /// Free every stored spline. Only call when no motivator in any engine
+  /// still references them, e.g. at level teardown after the engines have
+  /// been Reset().
+  void Clear();
+
+  /// Number of distinct splines in the store.
+  size_t NumSplines() const;
+
+  /// Hash of the spline's content: its quantized nodes, y-range, and
+  /// x-granularity. Splines that evaluate identically hash identically,
+  /// regardless of where they were loaded from or how much spare node
+  /// capacity they carry.
+  static uint64_t ContentId(const CompactSpline& spline);
+
+  /// The store shared by the whole process. Engines on different threads
+  /// can reference its splines without coordinating with each other.
+  /// Distinct stores can still be created where tighter lifetime control
+  /// is needed, e.g. one store per level.
+  static SplineAssetStore& ProcessStore();
+
+ private:
+  SplineAssetStore(const SplineAssetStore&);
+  SplineAssetStore& operator=(const SplineAssetStore&);
+
+  /// Map from ContentId() to the store-owned spline. Pointers, not values,
+  /// so that rehashing never moves a spline that engines point into.
+  typedef std::unordered_map<uint64_t, CompactSpline*> SplineMap;
+
+  /// Guards `splines_`. Mutable so that Find() and NumSplines() are const.
+  mutable std::mutex mutex_;
+
+  SplineMap splines_;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_SPLINE_ASSET_STORE_H_
@@ -48,6 +48,44 @@ inline void AlignedFree(void* ptr) {
 #endif
 }
 
+/// Signatures of the memory functions set by SetMemoryFunctions().
+/// `alloc` must return memory aligned to at least `align` bytes.
+typedef void* MotiveAllocFn(size_t size, size_t align);
+typedef void MotiveFreeFn(void* ptr);
+
+namespace detail {
+struct MemoryFunctions {
+  MotiveAllocFn* alloc;
+  MotiveFreeFn* free;
+};
+
+inline MemoryFunctions& GetMemoryFunctions() {
+  static MemoryFunctions fns = {AlignedAlloc, AlignedFree};
+  return fns;
+}
+}  // namespace detail
+
+/// Route Motive's internal allocations--spline slabs, per-index matrix
+/// data, the bulk evaluator arrays--through your own allocator, e.g. a
+/// dedicated animation arena, a NUMA-bound region, or huge-page-backed
+/// storage.
+/// Call before creating any MotiveEngine, and do not change the functions
+/// while allocations from the old ones are still live. Pass nullptr for
+/// both to return to the defaults (AlignedAlloc / AlignedFree).
+inline void SetMemoryFunctions(MotiveAllocFn* alloc_fn, MotiveFreeFn* free_fn) {
+  detail::MemoryFunctions& fns = detail::GetMemoryFunctions();
+  fns.alloc = alloc_fn == nullptr ? AlignedAlloc : alloc_fn;
+  fns.free = free_fn == nullptr ? AlignedFree : free_fn;
+}
+
+/// Allocate through the functions set by SetMemoryFunctions().
+inline void* MotiveAlloc(size_t size, size_t align) {
+  return detail::GetMemoryFunctions().alloc(size, align);
+}
+
+/// Free memory allocated by MotiveAlloc().
+inline void MotiveFree(void* ptr) { detail::GetMemoryFunctions().free(ptr); }
+
 /// Direction to boost the value.
 enum TwitchDirection {
   kTwitchDirectionNone,      /// Do nothing.
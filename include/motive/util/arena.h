@@ -0,0 +1,93 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_ARENA_H_
+#define MOTIVE_UTIL_ARENA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace motive {
+
+/// @class FrameArena
+/// @brief Bump allocator for temporaries that live at most one frame.
+///
+/// MotiveEngine owns one and resets it at the top of AdvanceFrame(), so
+/// anything allocated from the arena stays valid for the rest of the frame
+/// and is reclaimed wholesale, with no per-allocation bookkeeping and no
+/// destructor calls. Reset() keeps the largest block it has ever grown, so
+/// once the first few frames warm the arena up, frame transients stop
+/// touching the global heap entirely.
+///
+/// Allocate only trivially-destructible types from it, and only from the
+/// thread driving AdvanceFrame()--the arena is not thread-safe.
+class FrameArena {
+ public:
+  /// `initial_capacity` pre-allocates one block of that many bytes, for
+  /// callers that know their per-frame footprint up front. Zero defers
+  /// allocation to the first Alloc().
+  explicit FrameArena(size_t initial_capacity = 0);
+  ~FrameArena();
+
+  /// Return `bytes` of storage aligned to `alignment`, valid until the
+  /// next Reset(). Grows a new block when the current one is exhausted, so
+  /// this never returns nullptr; previously returned pointers stay valid.
+  void* Alloc(size_t bytes, size_t alignment = 16);
+
+  /// Typed helper for arrays of `count` elements. T must be trivially
+  /// destructible, since Reset() destroys nothing.
+  template <class T>
+  T* AllocArray(size_t count) {
+    return static_cast<T*>(Alloc(count * sizeof(T), alignof(T)));
+  }
+
+  /// Reclaim every allocation. The largest block is kept for reuse and the
+  /// rest are freed, so a frame that overflowed into several blocks
+  /// converges on one block big enough for the whole frame.
+  void Reset();
+
+  /// Heap bytes currently held, across all blocks. For memory telemetry.
+  size_t CapacityBytes() const;
+
+ private:
+  /// Header at the front of each heap block. The block's storage follows
+  /// the header immediately; Alloc() re-aligns per allocation, so the
+  /// storage itself needs no particular alignment.
+  struct Block {
+    Block* next;
+    size_t capacity;
+  };
+
+  // Arena pointers must not be shared between copies.
+  FrameArena(const FrameArena&);
+  FrameArena& operator=(const FrameArena&);
+
+  /// Allocate a block of at least `min_capacity` usable bytes and push it
+  /// on `blocks_`, doubling the previous block size so repeated overflows
+  /// converge quickly.
+  void GrowBlock(size_t min_capacity);
+
+  /// Heap blocks, most recently allocated first. Allocations bump through
+  /// the head block only; older blocks hold earlier allocations until
+  /// Reset().
+  Block* blocks_;
+
+  /// Next free byte and end of the head block's storage.
+  uint8_t* cursor_;
+  uint8_t* end_;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_ARENA_H_
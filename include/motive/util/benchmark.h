@@ -15,12 +15,64 @@
 #ifndef MOTIVE_UTIL_BENCHMARK_H_
 #define MOTIVE_UTIL_BENCHMARK_H_
 
+#include <iosfwd>
+#include <stdint.h>
+
 namespace motive {
 
 #define FPL_TOKEN_PASTE_NESTED(a, b) a##b
 #define FPL_TOKEN_PASTE(a, b) FPL_TOKEN_PASTE_NESTED(a, b)
 #define FPL_UNIQUE(token) FPL_TOKEN_PASTE(token, __LINE__)
 
+/// The hot-path events counted by AddMotiveEvents(). Unlike the timing
+/// instrumentation below, the event counters are always compiled in:
+/// each increment is a relaxed atomic add, cheap enough for release
+/// builds and safe from worker threads.
+enum MotiveEventCounter {
+  /// Target way-points set on a processor. Each one compiles a new curve,
+  /// so a spike here is a retarget storm from game code.
+  kMotiveEventSetTargets,
+
+  /// Cubics (re)initialized by BulkSplineEvaluator::InitCubic(). Includes
+  /// both the segment crossings below and curves started fresh by
+  /// SetSplines() or a retarget.
+  kMotiveEventCubicInits,
+
+  /// Indices whose x passed the end of their cubic during an advance--the
+  /// mask hits in UpdateCubicXsAndGetMask(). Many splines crossing segment
+  /// boundaries on the same frame is the classic re-init storm.
+  kMotiveEventSegmentCrossings,
+
+  /// Indices moved by Defragment() to fill holes left by freed motivators.
+  kMotiveEventDefragmentMoves,
+
+  kMotiveEventCounterCount
+};
+
+/// @struct MotiveEventCounters
+/// @brief One frame's event totals, indexed by MotiveEventCounter.
+///
+/// Filled by ReadAndResetMotiveEvents(). Where the timing histograms say
+/// that a frame got slow, these say why: a frame with thousands of segment
+/// crossings and few retargets points at the spline evaluator, and vice
+/// versa.
+struct MotiveEventCounters {
+  MotiveEventCounters() {
+    for (int i = 0; i < kMotiveEventCounterCount; ++i) counts[i] = 0;
+  }
+  uint64_t counts[kMotiveEventCounterCount];
+};
+
+/// Add `n` occurrences to one of the global event counters. Called from
+/// the hot paths; call sites inside loops batch into a local count and
+/// add once.
+void AddMotiveEvents(MotiveEventCounter counter, uint64_t n);
+
+/// Copy the totals accumulated since the previous call into `counters`,
+/// then zero them. Call once per frame, after AdvanceFrame(), to get
+/// per-frame counts.
+void ReadAndResetMotiveEvents(MotiveEventCounters* counters);
+
 #if defined(BENCHMARK_MOTIVE)
 
 /// A raw tick count from the system. Guaranteed to increase.
@@ -44,6 +96,41 @@ int RegisterBenchmark(const char* name);
 /// Dump an analysis of the samples to stdout.
 void OutputBenchmarks();
 
+/// Record only one in every `one_in_n` Benchmark scopes, selected per-thread
+/// in round-robin order. 1, the default, records every scope. Gated scopes
+/// skip the timestamp reads entirely, so with a gate of, say, 64 the
+/// instrumentation is cheap enough to leave compiled into release builds
+/// and enabled permanently. The gate applies to trace events as well as
+/// duration samples. May be changed at runtime at any point.
+/// @param one_in_n Record one scope in this many. Must be >= 1.
+void SetBenchmarkSampling(int one_in_n);
+
+/// @private Used by the Benchmark constructor. Returns true if the current
+/// scope should be recorded under the SetBenchmarkSampling() gate.
+bool BenchmarkSampleGate();
+
+/// Begin recording begin/end timestamps for every `Benchmark` scope, in
+/// addition to the duration samples above. Events are written to a per-thread
+/// ring buffer, so recording is lock-free and safe to leave enabled while the
+/// engine updates processors from worker threads; when a buffer fills, the
+/// oldest events are overwritten.
+/// @param max_events_per_thread Capacity of each thread's ring buffer.
+void StartTrace(int max_events_per_thread);
+
+/// Stop recording trace events. The events recorded so far are retained,
+/// for output with OutputTraceJson().
+void StopTrace();
+
+/// Discard all recorded trace events. Ring buffers keep their storage.
+void ClearTrace();
+
+/// Write all recorded trace events to `out` in Chrome's Trace Event Format:
+/// a JSON array of complete ("ph":"X") events, one per `Benchmark` scope.
+/// Load the output in chrome://tracing or ui.perfetto.dev to line up
+/// per-processor AdvanceFrame costs against the rest of the frame.
+/// Timestamps are microseconds since an arbitrary system epoch.
+void OutputTraceJson(std::ostream& out);
+
 /// @class Benchmark
 /// @brief Record the time for the scope of this variable.
 ///
@@ -52,9 +139,13 @@ void OutputBenchmarks();
 /// The sample is the time between creation and destruction of the Benchmark.
 class Benchmark {
  public:
-  explicit Benchmark(int id) : id_(id), start_time_(GetBenchmarkTime()) {}
+  explicit Benchmark(int id)
+      : id_(BenchmarkSampleGate() ? id : -1),
+        start_time_(id_ < 0 ? 0 : GetBenchmarkTime()) {}
   ~Benchmark();
  private:
+  // The id to record the sample under, or -1 if this scope was gated out
+  // by SetBenchmarkSampling().
   int id_;
   BenchmarkTime start_time_;
 };
@@ -70,6 +161,12 @@ inline void InitBenchmarks(int /*num_ids*/) {}
 inline void ClearBenchmarks() {}
 inline int RegisterBenchmark(const char* /*name*/) { return -1; }
 inline void OutputBenchmarks() {}
+inline void SetBenchmarkSampling(int /*one_in_n*/) {}
+inline bool BenchmarkSampleGate() { return false; }
+inline void StartTrace(int /*max_events_per_thread*/) {}
+inline void StopTrace() {}
+inline void ClearTrace() {}
+inline void OutputTraceJson(std::ostream& /*out*/) {}
 class Benchmark {
  public:
   explicit Benchmark(int /*id*/) {}
@@ -0,0 +1,91 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_BUFFER_ALLOCATOR_H_
+#define MOTIVE_UTIL_BUFFER_ALLOCATOR_H_
+
+#include <stddef.h>
+
+namespace motive {
+
+/// Alignment of every bulk buffer: one cache line. This serves two
+/// purposes: the widest SIMD loads in the evaluator loops (32 bytes for
+/// AVX2) start aligned, and a per-index array never shares its first cache
+/// line with unrelated data, so workers advancing cache-line-aligned index
+/// ranges never false-share at range boundaries (see
+/// MotiveProcessor::kIndicesPerCacheLine). Installed hooks may align
+/// further (say, to a huge-page boundary) but never less.
+static const size_t kBufferAlignment = 64;
+
+/// Allocate/free `bytes` aligned to `alignment` through the functions
+/// installed with SetMemoryFunctions() in motive/util.h--the same hook the
+/// spline slabs and matrix-data pools already go through. This is where
+/// platform placement policy plugs in: binding buffers to the NUMA node
+/// that runs the engine (numa_alloc_onnode and friends) or backing them
+/// with 2MB huge pages (mmap + MAP_HUGETLB), while the library itself
+/// stays platform-neutral.
+void* AllocateBuffer(size_t bytes, size_t alignment);
+void FreeBuffer(void* buffer);
+
+/// @class BufferAllocator
+/// @brief STL allocator that routes through the installed memory functions.
+///
+/// Drop-in allocator parameter for the per-index vectors, in the mold of
+/// mathfu::simd_allocator:
+///
+///    std::vector<float, BufferAllocator<float>> ys_;
+///
+/// Stateless: all instances are interchangeable and compare equal.
+template <class T>
+class BufferAllocator {
+ public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+
+  template <class U>
+  struct rebind {
+    typedef BufferAllocator<U> other;
+  };
+
+  BufferAllocator() {}
+  template <class U>
+  BufferAllocator(const BufferAllocator<U>&) {}
+
+  pointer allocate(size_type n) {
+    const size_t alignment =
+        alignof(T) > kBufferAlignment ? alignof(T) : kBufferAlignment;
+    return static_cast<pointer>(AllocateBuffer(n * sizeof(T), alignment));
+  }
+
+  void deallocate(pointer p, size_type /*n*/) { FreeBuffer(p); }
+};
+
+template <class T, class U>
+inline bool operator==(const BufferAllocator<T>&, const BufferAllocator<U>&) {
+  return true;
+}
+
+template <class T, class U>
+inline bool operator!=(const BufferAllocator<T>&, const BufferAllocator<U>&) {
+  return false;
+}
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_BUFFER_ALLOCATOR_H_
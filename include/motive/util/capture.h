@@ -0,0 +1,155 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_CAPTURE_H_
+#define MOTIVE_UTIL_CAPTURE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "motive/common.h"
+
+namespace motive {
+
+class CompactSpline;
+class MotivatorInit;
+class MotiveEngine;
+class Motivator;
+class MotivatorNf;
+struct MotiveTarget1f;
+struct SplinePlayback;
+
+/// Begin recording the Motivator API call stream to an in-memory log.
+/// While active, spline-driven motivator creation (SplineInit), SetTargets(),
+/// SetSpline()/SetSplines(), motivator removal, and AdvanceFrame() deltas
+/// are appended to a compact binary log. Re-execute the log headlessly with
+/// MotiveCaptureReplay, so a capture from a problem scene can stand in for
+/// the scene itself when measuring optimizations.
+///
+/// When no capture is active the hooks cost one predicted branch, so they
+/// are compiled in unconditionally. While capturing, the hot-path cost is an
+/// append to a memory buffer; nothing is written to disk until
+/// StopMotiveCapture().
+///
+/// Limitations, by design of the log format:
+///   - Only motivators initialized with SplineInit are recorded. Matrix and
+///     rig motivators are captured indirectly, through the spline-driven
+///     child motivators they create, so replay reproduces their spline
+///     evaluation load but not the matrix composition on top of it.
+///   - SetTargetWithShape() and SetSplinesAndTargets() are not recorded.
+///   - Motivators moved with the copy operators during capture lose their
+///     identity; their subsequent calls are dropped from the log.
+///   - Capture is not thread-safe. Record from the simulation thread only,
+///     and stop capturing before using AdvanceFrameRange() workers.
+void StartMotiveCapture();
+
+/// Stop recording and return the log in `out`. Returns false if no capture
+/// was active.
+bool StopMotiveCapture(std::vector<uint8_t>* out);
+
+/// Stop recording and write the log to `file_name`. Returns false if no
+/// capture was active or the file could not be written.
+bool StopMotiveCapture(const char* file_name);
+
+/// Returns true between StartMotiveCapture() and StopMotiveCapture().
+bool MotiveCaptureActive();
+
+/// @class MotiveCaptureReplay
+/// @brief Re-execute a log recorded with StartMotiveCapture().
+///
+/// The replay owns the motivators and splines it creates. Drive it with an
+/// engine that has the spline processor registered:
+///
+///     MotiveCaptureReplay replay;
+///     replay.Load("scene.motivecapture");
+///     while (replay.AdvanceFrame(&engine)) {
+///     }
+///
+/// Each AdvanceFrame() call re-executes the API calls of one recorded frame
+/// and then advances `engine` by that frame's recorded delta time, so the
+/// replayed workload spikes where the captured scene spiked. Restart() can
+/// replay the same log repeatedly for stable measurements.
+class MotiveCaptureReplay {
+ public:
+  MotiveCaptureReplay() : cursor_(0), num_frames_(0) {}
+  ~MotiveCaptureReplay() { Clear(); }
+
+  /// Load a log written by StopMotiveCapture(const char*). Returns false on
+  /// read error or log format mismatch.
+  bool Load(const char* file_name);
+
+  /// Load a log from memory, e.g. from StopMotiveCapture(std::vector*).
+  /// Returns false on log format mismatch.
+  bool LoadFromMemory(const uint8_t* bytes, size_t num_bytes);
+
+  /// Number of AdvanceFrame() calls in the log.
+  int NumFrames() const { return num_frames_; }
+
+  /// Returns true when the whole log has been replayed.
+  bool Done() const { return cursor_ >= log_.size(); }
+
+  /// Re-execute the next recorded frame against `engine`. Returns false if
+  /// the log is exhausted.
+  bool AdvanceFrame(MotiveEngine* engine);
+
+  /// Rewind to the start of the log, destroying the motivators created so
+  /// far. The next AdvanceFrame() replays the first frame again.
+  void Restart();
+
+ private:
+  /// Free replay-owned motivators and splines.
+  void Clear();
+
+  /// The raw log, as recorded.
+  std::vector<uint8_t> log_;
+
+  /// Read position in `log_`, just past the last-executed record.
+  size_t cursor_;
+
+  /// Number of frame records in `log_`.
+  int num_frames_;
+
+  /// Replayed motivators, keyed by the serial number assigned at capture.
+  std::map<uint32_t, MotivatorNf*> motivators_;
+
+  /// Splines reconstructed from the log, owned by the replay. Freed on
+  /// Restart(), since motivators may still reference them until then.
+  std::vector<CompactSpline*> splines_;
+};
+
+namespace detail {
+
+/// @private True while a capture is recording. Checked inline by the hooks
+/// below so that an inactive capture costs one predicted branch.
+extern bool capture_active;
+
+/// @private Hooks called from the Motivator API. Call only when
+/// `capture_active` is true.
+void CaptureInitialize(const Motivator* m, const MotivatorInit& init,
+                       MotiveDimension dimensions);
+void CaptureSetTargets(const Motivator* m, const MotiveTarget1f* targets,
+                       MotiveDimension dimensions);
+void CaptureSetSplines(const Motivator* m, const CompactSpline* splines,
+                       MotiveDimension dimensions,
+                       const SplinePlayback& playback);
+void CaptureRemove(const Motivator* m);
+void CaptureAdvanceFrame(MotiveTime delta_time);
+
+}  // namespace detail
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_CAPTURE_H_
@@ -0,0 +1,142 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_COMMAND_QUEUE_H_
+#define MOTIVE_UTIL_COMMAND_QUEUE_H_
+
+#include <atomic>
+#include <stddef.h>
+
+#include "motive/math/compact_spline.h"
+#include "motive/target.h"
+
+namespace motive {
+
+class MotivatorNf;
+
+/// @struct MotiveCommand
+/// @brief One deferred mutation of a vector motivator.
+///
+/// Built on a worker thread with the static constructors below and enqueued
+/// on a MotiveCommandQueue; the engine thread applies it at the start of the
+/// next AdvanceFrame(). The referenced motivator--and, for SetSplines, the
+/// spline array--must stay valid until then.
+struct MotiveCommand {
+  /// Most dimensions a command's target array can carry. Matches the widest
+  /// vector motivator.
+  static const int kMaxDimensions = 4;
+
+  enum Type {
+    kSetTargets,
+    kSetSplines,
+    kSetSplinePlaybackRate,
+  };
+
+  /// Defer MotivatorNf::SetTargets(). `targets` is an array of the
+  /// motivator's Dimensions() targets, copied into the command.
+  static MotiveCommand SetTargets(MotivatorNf* motivator,
+                                  const MotiveTarget1f* targets,
+                                  int dimensions);
+
+  /// Defer MotivatorNf::SetSplines(). `splines` is an array of the
+  /// motivator's Dimensions() splines; only the pointer is carried, so the
+  /// splines must outlive the next AdvanceFrame().
+  static MotiveCommand SetSplines(MotivatorNf* motivator,
+                                  const CompactSpline* splines,
+                                  const SplinePlayback& playback);
+
+  /// Defer MotivatorNf::SetSplinePlaybackRate().
+  static MotiveCommand SetSplinePlaybackRate(MotivatorNf* motivator,
+                                             float playback_rate);
+
+  Type type;
+  MotivatorNf* motivator;
+
+  /// One target per dimension; kSetTargets only.
+  MotiveTarget1f targets[kMaxDimensions];
+
+  /// Spline array and playback parameters; kSetSplines only.
+  const CompactSpline* splines;
+  SplinePlayback playback;
+
+  /// kSetSplinePlaybackRate only.
+  float playback_rate;
+};
+
+/// @class MotiveCommandQueue
+/// @brief Bounded lock-free queue of MotiveCommands, many producers to one
+///        consumer.
+///
+/// Gameplay jobs on worker threads cannot call SetTargets() or SetSplines()
+/// directly--the processors' arrays are not thread-safe--so they enqueue
+/// commands here instead, without taking a lock. Hook the queue up with
+/// MotiveEngine::SetCommandQueue() and the engine drains it at the start of
+/// every AdvanceFrame(), applying runs of identical targets through the
+/// shared bulk path (see MotivatorNf::SetTargetsBatch()).
+///
+/// Enqueue() may be called concurrently from any number of threads. Drain()
+/// must only be called from the thread driving the engine, and never
+/// concurrently with itself.
+class MotiveCommandQueue {
+ public:
+  /// `capacity` is the most commands the queue holds between drains,
+  /// rounded up to a power of two. Size it for the worst frame; Enqueue()
+  /// fails rather than blocks when the queue is full.
+  explicit MotiveCommandQueue(size_t capacity);
+  ~MotiveCommandQueue();
+
+  /// Append `command`, to be applied at the start of the next
+  /// AdvanceFrame(). Lock-free and safe from any thread. Returns false if
+  /// the queue is full; the caller can apply the command directly next
+  /// frame or treat it as dropped.
+  bool Enqueue(const MotiveCommand& command);
+
+  /// Pop commands in the order they were enqueued into `commands`, up to
+  /// `max_commands` of them, and return how many were popped. Called by
+  /// the engine; call it yourself only to drain into your own application
+  /// logic instead of the engine's.
+  size_t Drain(MotiveCommand* commands, size_t max_commands);
+
+  /// Commands the queue can hold between drains.
+  size_t Capacity() const { return capacity_; }
+
+ private:
+  /// One queue slot. `sequence` implements the classic bounded MPMC
+  /// protocol: a producer claims the slot when sequence == its ticket,
+  /// writes the command, then publishes by storing ticket + 1; the consumer
+  /// reads when sequence == ticket + 1 and recycles the slot by storing
+  /// ticket + capacity.
+  struct Slot {
+    std::atomic<size_t> sequence;
+    MotiveCommand command;
+  };
+
+  // The slot array must not be shared between copies.
+  MotiveCommandQueue(const MotiveCommandQueue&);
+  MotiveCommandQueue& operator=(const MotiveCommandQueue&);
+
+  Slot* slots_;
+  size_t capacity_;  // Always a power of two, so `& (capacity_ - 1)` wraps.
+
+  /// Producers' next ticket. fetch_add here is the only cross-producer
+  /// coordination, so enqueues never spin on each other.
+  std::atomic<size_t> enqueue_pos_;
+
+  /// Consumer's next ticket. Only Drain() touches it.
+  size_t dequeue_pos_;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_COMMAND_QUEUE_H_
@@ -0,0 +1,128 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_HANDLE_POOL_H_
+#define MOTIVE_UTIL_HANDLE_POOL_H_
+
+#include <vector>
+
+#include "motive/vector_motivator.h"
+
+namespace motive {
+
+class MotiveEngine;
+
+/// Compact 32-bit reference to a Motivator held in a MotiveHandlePool.
+/// Packs a slot index and a generation counter; see MotiveHandlePool.
+/// The zero value is never a valid handle, so zero-initialized components
+/// read as kMotiveHandleInvalid.
+typedef uint32_t MotiveHandle;
+static const MotiveHandle kMotiveHandleInvalid = 0;
+
+/// @class MotiveHandlePool
+/// @brief Hold Motivators centrally and hand out 32-bit handles to them.
+///
+/// A Motivator is a 16-byte processor-and-index pair, and its MotiveProcessor
+/// keeps a back-pointer to it that defragmentation must rewrite whenever the
+/// index moves. Storing Motivators directly in game components therefore
+/// costs 16 bytes per reference and scatters those rewrites across
+/// gameplay-owned memory.
+///
+/// This pool keeps the Motivators themselves in a few contiguous slabs and
+/// gives the caller a 4-byte MotiveHandle instead: component memory shrinks
+/// 4x, and defragmentation's back-pointer fix-ups all land in the pool's
+/// slabs--table edits--rather than in scattered component memory. Slabs
+/// never move, so the processors' back-pointers stay valid as the pool
+/// grows.
+///
+/// Each handle carries an 8-bit generation that is bumped when its slot is
+/// destroyed, so handles held past Destroy() resolve to nullptr instead of
+/// to the slot's next occupant. A stale handle can alias again only after
+/// its slot is reused 256 times.
+///
+/// Not thread-safe; create, destroy, and resolve from the thread that owns
+/// the engine. Destroy the pool--or every handle--before the engine.
+class MotiveHandlePool {
+ public:
+  /// `engine` drives every motivator created from this pool. Not owned; it
+  /// must outlive the pool.
+  explicit MotiveHandlePool(MotiveEngine* engine);
+
+  /// Invalidates every live motivator and frees the slabs.
+  ~MotiveHandlePool();
+
+  /// Create a motivator of the type specified by `init`, as in
+  /// MotivatorNf::Initialize(), and return a handle to it. Set its initial
+  /// state through Resolve().
+  MotiveHandle Create(const MotivatorInit& init, MotiveDimension dimensions);
+
+  /// Invalidate the motivator behind `handle` and recycle its slot.
+  /// Invalid and stale handles are ignored.
+  void Destroy(MotiveHandle handle);
+
+  /// Return the motivator behind `handle`, or nullptr if the handle is
+  /// kMotiveHandleInvalid or stale. The pointer is stable for the life of
+  /// the handle; it is cheaper to resolve once per frame than per call.
+  MotivatorNf* Resolve(MotiveHandle handle);
+  const MotivatorNf* Resolve(MotiveHandle handle) const;
+
+  /// Return true if `handle` currently resolves to a live motivator.
+  bool Valid(MotiveHandle handle) const { return Resolve(handle) != nullptr; }
+
+  /// Number of live handles.
+  int NumLive() const { return num_live_; }
+
+ private:
+  /// Bit layout of a MotiveHandle: the low bits hold slot + 1--so that the
+  /// zero handle is never valid--and the high bits hold the generation.
+  static const int kSlotBits = 24;
+  static const uint32_t kSlotMask = (1u << kSlotBits) - 1;
+
+  /// Number of motivators carved from each slab allocation. Big enough that
+  /// slab allocations are rare; small enough that the last, partially-used
+  /// slab doesn't waste much memory.
+  static const int kHandlesPerSlab = 256;
+
+  /// Return the slot's motivator. Slots are numbered across the slabs in
+  /// the order they were carved.
+  MotivatorNf* Slot(uint32_t slot) const {
+    return &slabs_[slot / kHandlesPerSlab][slot % kHandlesPerSlab];
+  }
+
+  /// Carve another slab of motivators and push their slots onto the free
+  /// list.
+  void AllocateSlab();
+
+  /// Drives the motivators created from this pool. Not owned.
+  MotiveEngine* engine_;
+
+  /// Slabs of kHandlesPerSlab default-constructed motivators each. The
+  /// slabs never move or shrink, so processor back-pointers into them stay
+  /// valid. Freed en masse in the destructor.
+  std::vector<MotivatorNf*> slabs_;
+
+  /// Generation per slot, matched against the handle's generation on
+  /// Resolve(). Bumped in Destroy().
+  std::vector<uint8_t> generations_;
+
+  /// Slots awaiting reuse.
+  std::vector<uint32_t> free_slots_;
+
+  /// Number of live handles; see NumLive().
+  int num_live_;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_HANDLE_POOL_H_
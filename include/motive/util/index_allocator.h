@@ -155,15 +155,85 @@ class IndexAllocator {
     return new_index;
   }
 
+  /// Allocate `num_blocks` blocks of `count` indices each, in one contiguous
+  /// run at the end of the array. Unlike calling Alloc() once per block, this
+  /// skips the recycled-index search and grows the array---and therefore the
+  /// caller's data arrays, via the SetNumIndices() callback---exactly once.
+  /// Useful when many items are created in the same frame.
+  /// @param count The number of indices in each block. Same meaning as the
+  ///              `count` parameter of Alloc().
+  /// @param num_blocks The number of blocks to allocate.
+  /// @returns The first index of the first block. Block `b` starts at the
+  ///          returned index + b * count.
+  Index AllocBatch(Count count, Count num_blocks) {
+    const Index first_index = num_indices();
+    SetNumIndices(first_index + count * num_blocks);
+    for (Count i = 0; i < num_blocks; ++i) {
+      InitializeIndex(first_index + i * count, count);
+    }
+    return first_index;
+  }
+
+  /// Ensure the array can grow to `capacity` indices without reallocating.
+  ///
+  /// Works by growing the array to `capacity` and immediately shrinking it
+  /// back: std::vector keeps its storage on a shrinking resize, and callers
+  /// of SetNumIndices() are expected to do the same (MotiveProcessor
+  /// explicitly keeps its arrays at their high-water mark). num_indices() is
+  /// unchanged.
+  /// @param capacity Total number of indices to reserve storage for.
+  void Reserve(Index capacity) {
+    const Index current_num_indices = num_indices();
+    if (capacity <= current_num_indices) return;
+    SetNumIndices(capacity);
+    SetNumIndices(current_num_indices);
+  }
+
   /// Recycle 'index'. It will be used in the next allocation, or backfilled in
-  /// the next call to Defragment().
+  /// the next call to Defragment(). If the index was pinned, it is unpinned.
   /// @param index Index to be freed. Must be in the range
   ///              [0, num_indices_ - 1].
   void Free(Index index) {
     assert(ValidIndex(index));
+    Unpin(index);
     unused_indices_.push_back(index);
   }
 
+  /// Exclude the block at `index` from Defragment() moves. The block keeps
+  /// its indices until it is freed or unpinned, so callers can hold onto the
+  /// indices (and, if their arrays don't reallocate, pointers into the
+  /// corresponding data) across Defragment() calls.
+  ///
+  /// A hole that sits directly before a pinned block may be impossible to
+  /// backfill. Such holes are left in place--still available for recycling
+  /// by Alloc()--so pinning trades away some compactness.
+  /// @param index First index of the block, as returned by Alloc().
+  void Pin(Index index) {
+    assert(ValidIndex(index));
+    const typename std::vector<Index>::iterator it =
+        std::lower_bound(pinned_indices_.begin(), pinned_indices_.end(), index);
+    if (it == pinned_indices_.end() || *it != index) {
+      pinned_indices_.insert(it, index);
+    }
+  }
+
+  /// Allow the block at `index` to be moved by Defragment() again.
+  /// Does nothing if the block is not pinned.
+  /// @param index First index of the block, as returned by Alloc().
+  void Unpin(Index index) {
+    const typename std::vector<Index>::iterator it =
+        std::lower_bound(pinned_indices_.begin(), pinned_indices_.end(), index);
+    if (it != pinned_indices_.end() && *it == index) {
+      pinned_indices_.erase(it);
+    }
+  }
+
+  /// Returns true if the block at `index` is pinned.
+  bool Pinned(Index index) const {
+    return std::binary_search(pinned_indices_.begin(), pinned_indices_.end(),
+                              index);
+  }
+
   // Only one block of unused indices left, and they're at the end of the
   // array.
   bool UnusedAtEnd() const {
@@ -216,27 +286,71 @@ class IndexAllocator {
   /// reallocation of the underlying array (which would be slow).
   ///
   void Defragment() {
+    DefragmentWithBudget(std::numeric_limits<Count>::max());
+  }
+
+  /// Like Defragment(), but stop backfilling once `max_moved_indices` indices
+  /// have been moved. This bounds the cost of a single call, so compaction
+  /// can be amortized over many frames instead of causing a spike when many
+  /// indices are freed at once.
+  ///
+  /// The budget is checked between moves, so a single large block move may
+  /// exceed it; treat `max_moved_indices` as approximate.
+  ///
+  /// Note that the trailing hole is only trimmed (via SetNumIndices()) once
+  /// the array is fully compacted, so an unfinished defragment leaves
+  /// num_indices() unchanged.
+  ///
+  /// @param max_moved_indices Maximum number of indices to move before
+  ///                          returning.
+  /// @returns true if no further backfilling is possible--the array is fully
+  ///          defragmented, except for holes stuck behind pinned blocks;
+  ///          false if the budget ran out and holes remain.
+  bool DefragmentWithBudget(Count max_moved_indices) {
     // Quick check. An optimization.
-    if (unused_indices_.size() == 0) return;
+    if (unused_indices_.size() == 0) return true;
+
+    Count moved_indices = 0;
 
+    // Holes before `hole` (in sorted order) are stuck: a pinned block sits
+    // directly after them and no movable block fits inside. They keep their
+    // place, and stay available for recycling by Alloc(). Holes created by
+    // backfilling always start after the hole being filled, so `hole` keeps
+    // its meaning across iterations.
+    size_t hole = 0;
     for (;;) {
       // We check if unused index is the last index, so must be in sorted order.
       ConsolidateUnusedIndices();
 
-      // If all the holes have been pushed to the end, we are done and can
-      // trim the number of indices.
-      const bool unused_at_end = unused_indices_.size() == 1 &&
-                                 NextIndex(unused_indices_[0]) == num_indices();
+      // Every remaining hole is stuck behind a pinned block.
+      if (hole >= unused_indices_.size()) return true;
+
+      // If all the movable holes have been pushed to the end, we are done and
+      // can trim the number of indices.
+      const bool unused_at_end =
+          hole == unused_indices_.size() - 1 &&
+          NextIndex(unused_indices_[hole]) == num_indices();
       if (unused_at_end) break;
 
-      // Find range of indices that will fit into the first block of
-      // unused indices and move them into it.
-      BackfillFirstUnused();
+      // Out of budget. Leave the remaining holes for a later call.
+      if (moved_indices >= max_moved_indices) return false;
+
+      // Find range of indices that will fit into this block of unused
+      // indices and move them into it.
+      const Count moved = BackfillUnused(hole);
+      if (moved == 0) {
+        // The block directly after the hole is pinned and nothing movable
+        // fits inside: the hole is stuck. Skip it.
+        ++hole;
+        continue;
+      }
+      moved_indices += moved;
     }
 
     // Remove hole at end.
-    SetNumIndices(unused_indices_[0]);
-    unused_indices_.clear();
+    SetNumIndices(unused_indices_[hole]);
+    unused_indices_.resize(hole);
+    return true;
   }
 
   /// Returns true if there are no indices allocated.
@@ -270,6 +384,28 @@ class IndexAllocator {
     return count;
   }
 
+  /// Returns the number of distinct blocks of unused indices. Each block is
+  /// one hole that Defragment() has yet to backfill, so this is a measure of
+  /// fragmentation; NumUnusedIndices() sums the sizes of these blocks.
+  Index NumUnusedBlocks() const {
+    return static_cast<Index>(unused_indices_.size());
+  }
+
+  /// Returns the number of indices that can be allocated before the internal
+  /// arrays reallocate. At least num_indices(); more after Reserve() or
+  /// after Defragment() has shrunk num_indices() from a high-water mark.
+  Index Capacity() const { return static_cast<Index>(counts_.capacity()); }
+
+  /// Returns the bytes of heap storage held by this allocator's bookkeeping
+  /// arrays, including spare capacity. Note that the data arrays managed
+  /// through the callbacks are the bulk of an allocator's footprint, and are
+  /// accounted for by their owner.
+  size_t AllocatedBytes() const {
+    return counts_.capacity() * sizeof(Count) +
+           unused_indices_.capacity() * sizeof(Index) +
+           pinned_indices_.capacity() * sizeof(Index);
+  }
+
   /// Returns the `count` value specified in Alloc. That is, the number of
   /// consecutive indices associated with `index`.
   Count CountForIndex(Index index) const {
@@ -380,13 +516,15 @@ class IndexAllocator {
     unused_indices_.resize(new_num_unused);
   }
 
-  /// Move later blocks of indices into the first hole in `unused_indices_`.
-  /// That is, move the first hole farther back in the index array.
-  void BackfillFirstUnused() {
-    assert(unused_indices_.size() > 0);
+  /// Move later blocks of indices into the hole at `unused_indices_
+  /// [unused_i]`. That is, move that hole farther back in the index array.
+  /// Returns the number of indices moved, or 0 if the hole is stuck behind
+  /// a pinned block.
+  Count BackfillUnused(size_t unused_i) {
+    assert(unused_i < unused_indices_.size());
     const IndexRange unused_range(
-        unused_indices_[0],
-        unused_indices_[0] + CountForIndex(unused_indices_[0]));
+        unused_indices_[unused_i],
+        unused_indices_[unused_i] + CountForIndex(unused_indices_[unused_i]));
 
     // Find a fill_range after unused_range that we can move into unused_range.
     //
@@ -415,10 +553,22 @@ class IndexAllocator {
     const bool is_fill = fill_range.Valid();
     if (!is_fill) {
       // If there's no index range that will fit into the hole, shift over
-      // all the indices between this hole and the next.
-      const Index next_hole_index =
-          unused_indices_.size() > 1 ? unused_indices_[1] : num_indices();
-      fill_range = IndexRange(NextIndex(unused_range.start()), next_hole_index);
+      // all the indices between this hole and the next hole or pinned block,
+      // whichever comes first. Pinned blocks must not move.
+      Index shift_end = unused_i + 1 < unused_indices_.size()
+                            ? unused_indices_[unused_i + 1]
+                            : num_indices();
+      const typename std::vector<Index>::const_iterator pinned =
+          std::upper_bound(pinned_indices_.begin(), pinned_indices_.end(),
+                           unused_range.start());
+      if (pinned != pinned_indices_.end() && *pinned < shift_end) {
+        shift_end = *pinned;
+      }
+
+      // A pinned block sits directly after the hole: nothing can move.
+      if (shift_end <= unused_range.end()) return 0;
+
+      fill_range = IndexRange(NextIndex(unused_range.start()), shift_end);
     }
 
     // Allow the callback to move data associated with the indices.
@@ -432,7 +582,7 @@ class IndexAllocator {
     if (is_fill) {
       // See Case 1 above: Add a hole for the range we just moved.
       InitializeIndex(fill_range.start(), fill_range.Length());
-      unused_indices_[0] = fill_range.start();
+      unused_indices_[unused_i] = fill_range.start();
 
       // If we didn't completely fill unused_range, add a hole for the rest.
       const IndexRange unused_hole(unused_range.start() + fill_range.Length(),
@@ -446,10 +596,11 @@ class IndexAllocator {
       const IndexRange shift_hole(unused_range.start() + fill_range.Length(),
                                   fill_range.end());
       InitializeIndex(shift_hole.start(), shift_hole.Length());
-      unused_indices_[0] = shift_hole.start();
+      unused_indices_[unused_i] = shift_hole.start();
     }
 
     VerifyInternalState();
+    return fill_range.Length();
   }
 
   IndexRange LastIndexRangeSmallerThanHole(Index index) const {
@@ -469,11 +620,15 @@ class IndexAllocator {
         continue;
       }
 
+      // Skip over pinned blocks. They must not move.
+      if (Pinned(PrevIndex(end))) continue;
+
       // Loop towards the front while the size still fits into `count`.
       Index start = end;
       for (Index j = PrevIndex(end); j > index; j = PrevIndex(j)) {
         if (end - j > count) break;
         if (j == unused_start) break;
+        if (Pinned(j)) break;
         start = j;
       }
 
@@ -508,6 +663,10 @@ class IndexAllocator {
   // unused indices with the highest allocated indices. This reduces the total
   // size of the data arrays.
   std::vector<Index> unused_indices_;
+
+  // First index of every block that Pin() has excluded from Defragment()
+  // moves. Kept sorted so that Defragment() can binary search it.
+  std::vector<Index> pinned_indices_;
 };
 
 }  // namespace motive
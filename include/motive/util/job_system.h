@@ -0,0 +1,88 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_UTIL_JOB_SYSTEM_H_
+#define MOTIVE_UTIL_JOB_SYSTEM_H_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace motive {
+
+/// @class MotiveJobSystem
+/// @brief Interface through which MotiveEngine submits independent work items.
+///
+/// The engine never creates threads on its own. If you want
+/// MotiveEngine::AdvanceFrame() to update MotiveProcessors concurrently,
+/// give the engine a MotiveJobSystem via MotiveEngine::SetJobSystem().
+///
+/// You can use the ThreadPoolJobSystem below, or derive your own adapter that
+/// forwards Submit() to your game's job system. Jobs submitted between two
+/// calls to WaitForAll() are independent and may run in any order, on any
+/// thread.
+class MotiveJobSystem {
+ public:
+  /// Signature of a submitted work item.
+  typedef void JobFn(void* data);
+
+  virtual ~MotiveJobSystem() {}
+
+  /// Schedule `job` to be called with `data`. May be called from the thread
+  /// that calls MotiveEngine::AdvanceFrame() only. `data` must stay valid
+  /// until the next call to WaitForAll().
+  virtual void Submit(JobFn* job, void* data) = 0;
+
+  /// Block until every job submitted since the last call to WaitForAll()
+  /// has completed.
+  virtual void WaitForAll() = 0;
+};
+
+/// @class ThreadPoolJobSystem
+/// @brief Self-contained MotiveJobSystem backed by a pool of std::threads.
+///
+/// Useful when your game doesn't have its own job system. Worker threads are
+/// created once, in the constructor, and live until destruction.
+class ThreadPoolJobSystem : public MotiveJobSystem {
+ public:
+  /// Create `num_threads` worker threads. If `num_threads` is 0, create one
+  /// worker per hardware thread.
+  explicit ThreadPoolJobSystem(unsigned int num_threads = 0);
+  virtual ~ThreadPoolJobSystem();
+
+  virtual void Submit(JobFn* job, void* data);
+  virtual void WaitForAll();
+
+ private:
+  struct Job {
+    JobFn* fn;
+    void* data;
+  };
+
+  /// Entry point of each worker thread. Pops jobs off `jobs_` until `quit_`.
+  void WorkerLoop();
+
+  std::vector<std::thread> workers_;
+  std::vector<Job> jobs_;
+  std::mutex mutex_;
+  std::condition_variable jobs_available_;
+  std::condition_variable jobs_complete_;
+  int num_running_;
+  bool quit_;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_UTIL_JOB_SYSTEM_H_
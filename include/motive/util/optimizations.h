@@ -21,7 +21,8 @@ enum ProcessorOptimization {
   kNoOptimizations,
   kNeonOptimizations,  /// NEON is a SIMD instruction set for ARM processors
   kSse3Optimizations,  /// SSE is a SIMD instruction set for x86 processors
-  kSsse3Optimizations  /// SSSE3 is an extension of SSE3
+  kSsse3Optimizations, /// SSSE3 is an extension of SSE3
+  kAvx2Optimizations   /// AVX2+FMA, 256-bit wide SIMD on modern x86 processors
 };
 
 /// Look at the capabilities of the CPU and return the most performant set of
@@ -16,6 +16,7 @@
 #define MOTIVE_VECTOR_MOTIVATOR_H_
 
 #include "motive/motivator.h"
+#include "motive/util/capture.h"
 #include "motive/vector_processor.h"
 
 namespace motive {
@@ -90,6 +91,15 @@ class MotivatorNf : public Motivator {
   }
 
   // Get array of length `dimensions`.
+  //
+  // The pointer aims directly into the processor's value storage, so treat
+  // it as invalidated by the next MotiveEngine::AdvanceFrame() (indices may
+  // be defragmented) or Motivator creation (storage may grow and
+  // reallocate). For a pinned contiguous block of motivators--see
+  // Motivator::SetPinned()--the indices are stable and the span extends
+  // across the whole block, so systems can iterate the block's output
+  // directly; re-fetch the pointer after creating motivators, or
+  // pre-allocate with MotiveProcessor::ReserveIndices().
   const float* Values() const { return Processor().Values(index_); }
   void Velocities(float* out) const {
     return Processor().Velocities(index_, Dimensions(), out);
@@ -107,6 +117,23 @@ class MotivatorNf : public Motivator {
     return Processor().Differences(index_, Dimensions(), out);
   }
 
+  /// Write this motivator's values extrapolated `lookahead` time-units
+  /// ahead along their current velocities, one per dimension. For
+  /// renderers that tick faster than the simulation: advance the engine at
+  /// the simulation rate, and sample each rendered frame with `lookahead`
+  /// set to the render time elapsed since the last advance--smooth motion
+  /// at render rate for the cost of two multiply-adds per dimension.
+  /// Keep `lookahead` below one simulation tick; the extrapolation never
+  /// crosses curve-segment boundaries. With
+  /// MotiveEngine::SetFrameSnapshots() enabled, spline-driven motivators
+  /// serve this from the published snapshot, so a render thread can call
+  /// it while the simulation writes the next frame.
+  /// @param lookahead Time past the last engine advance to sample at.
+  /// @param out An array of length Dimensions().
+  void ExtrapolatedValues(MotiveTime lookahead, float* out) const {
+    Processor().ExtrapolatedValues(index_, Dimensions(), lookahead, out);
+  }
+
   /// Returns time remaining until target is reached.
   /// The unit of time is determined by the calling program.
   MotiveTime TargetTime() const {
@@ -141,6 +168,9 @@ class MotivatorNf : public Motivator {
   ///                 from the beginning after the end of the spline is reached.
   void SetSpline(const CompactSpline& spline, const SplinePlayback& playback) {
     assert(Dimensions() == 1);
+    if (detail::capture_active) {
+      detail::CaptureSetSplines(this, &spline, 1, playback);
+    }
     Processor().SetSplines(index_, Dimensions(), &spline, playback);
   }
 
@@ -153,6 +183,9 @@ class MotivatorNf : public Motivator {
   ///                 from the beginning after the end of the spline is reached.
   void SetSplines(const CompactSpline* splines,
                   const SplinePlayback& playback) {
+    if (detail::capture_active) {
+      detail::CaptureSetSplines(this, splines, Dimensions(), playback);
+    }
     Processor().SetSplines(index_, Dimensions(), splines, playback);
   }
 
@@ -171,15 +204,82 @@ class MotivatorNf : public Motivator {
     Processor().SetSplinePlaybackRate(index_, Dimensions(), playback_rate);
   }
 
+  /// Report when this motivator's value crosses a threshold--foot height
+  /// for footsteps, door angle for triggers. Crossings are detected during
+  /// the engine's bulk evaluation pass, replacing per-frame polling of
+  /// Value(), and are delivered in one batch through the callback set by
+  /// MotiveEngine::SetCrossingCallback(). The thresholds persist across
+  /// SetSpline()/SetTarget() calls, until cleared or the motivator is
+  /// invalidated.
+  /// @param ys The threshold each dimension's value is compared against.
+  ///           An array of length Dimensions().
+  /// @param direction Which crossings to report: rising, falling, or both.
+  void SetCrossingThresholds(const float* ys,
+                             MotiveCrossingDirection direction) {
+    Processor().SetCrossingThresholds(index_, Dimensions(), ys, direction);
+  }
+
+  /// Stop reporting threshold crossings for this motivator.
+  void ClearCrossingThresholds() {
+    Processor().ClearCrossingThresholds(index_, Dimensions());
+  }
+
+  /// Mirror `master`'s spline playback instead of evaluating this
+  /// motivator's own splines. Each dimension follows the corresponding
+  /// dimension of `master`, copying its value, derivative, and playback
+  /// position after every engine advance. For crowds playing the same
+  /// looping clip in lockstep, drive one master per distinct phase and
+  /// make the rest followers: the followers' per-frame evaluation
+  /// collapses to a few copies each, and retargeting the master's spline
+  /// retargets the whole group.
+  ///
+  /// Both motivators must be driven by the same processor--same engine and
+  /// motivator type--and have the same number of dimensions, and `master`
+  /// must not itself be a follower. Invalidating the master orphans its
+  /// followers, so clear or re-register them first. Following ends when
+  /// this motivator is given its own splines, time, or targets. Only
+  /// spline-backed processors support sharing; for others this is a no-op.
+  void SetPlaybackMaster(const MotivatorNf& master) {
+    assert(processor_ == master.processor_ &&
+           Dimensions() == master.Dimensions());
+    Processor().SetPlaybackMasters(index_, Dimensions(), master.index_);
+  }
+
+  /// Return to independent evaluation, continuing from the playback
+  /// position mirrored last.
+  void ClearPlaybackMaster() {
+    Processor().ClearPlaybackMasters(index_, Dimensions());
+  }
+
   /// Set the target and (optionally the current) motivator values.
   /// Use this call to procedurally drive the Motivator towards a specific
   /// target. The Motivator will transition smoothly to the new target.
   /// @param targets The targets that each value should achieve.
   ///                An array of length Dimensions().
   void SetTargets(const MotiveTarget1f* targets) {
+    if (detail::capture_active) {
+      detail::CaptureSetTargets(this, targets, Dimensions());
+    }
     Processor().SetTargets(index_, Dimensions(), targets);
   }
 
+  /// Set the same targets on several motivators of the same type at once.
+  /// Equivalent to calling SetTargets(targets) on each motivator, but the
+  /// processor may compile the shared way-point sequence once and reuse it
+  /// for every motivator--a significant saving when hundreds of motivators
+  /// receive an identical path in the same frame, as when steering a crowd
+  /// of agents along one route.
+  /// @param motivators Array of `num_motivators` pointers to the Motivators
+  ///                   to drive. All must be valid, driven by the same
+  ///                   processor (same type and engine), and have the same
+  ///                   number of dimensions.
+  /// @param num_motivators Number of motivators to drive.
+  /// @param targets The targets that each value should achieve. An array of
+  ///                length Dimensions(), applied to every motivator.
+  static void SetTargetsBatch(MotivatorNf* const* motivators,
+                              int num_motivators,
+                              const MotiveTarget1f* targets);
+
   /// Set the target values, velocities, and curve shape for the motivator.
   /// Procedurally drive the Motivator to 'target_values' and
   /// 'target_velocities' following a curve defined by 'shape'.
@@ -230,8 +330,15 @@ class MotivatorNf : public Motivator {
 /// For `kDimension > 1`, the vector type is determined by `VectorConverter`.
 /// We use `MathFuVectorConverter` below to create 2, 3, and 4 dimensional
 /// motivators (see Motivator2f, Motivator3f, and Motivator4f).
-/// You can use your own VectorConverter to create Motivators of that match
-/// your vector types.
+///
+/// Instantiate with your own VectorConverter to return your engine's vector
+/// types instead--including SIMD-native types--with no staging copies; the
+/// zero-copy contract a converter must meet is documented in
+/// motive/math/vector_converter.h. The conversions are header-inline, so a
+/// FromPtr() that is a plain (unaligned) load makes Value() a single load
+/// from the processor's internal array. Read paths that want the raw
+/// floats can use the inherited Values() instead, which returns a pointer
+/// directly into that array.
 ///
 template <class VectorConverter, MotiveDimension kDimensionsParam>
 class MotivatorXfTemplate : public MotivatorNf {
@@ -381,6 +488,95 @@ typedef MotivatorXfTemplate<MathFuVectorConverter, 2> Motivator2f;
 typedef MotivatorXfTemplate<MathFuVectorConverter, 3> Motivator3f;
 typedef MotivatorXfTemplate<MathFuVectorConverter, 4> Motivator4f;
 
+/// @class MotivatorValueView
+/// @brief Bulk read-back of the current values of many MotivatorNfs.
+///
+/// Game code often mirrors Motive's output into its own structures every
+/// frame--for example, copying the positions of tens of thousands of
+/// motivators into a render or physics array. Reading each motivator with
+/// Value() costs a virtual call per motivator. A view registers the
+/// motivators once, groups them by the MotiveProcessor that drives them,
+/// and then Gather() fills a contiguous float buffer with one virtual
+/// GatherValues() call per *processor*, so the read-back becomes a few
+/// memcpy-like loops over the processors' internal value arrays.
+///
+/// The view stores pointers to the registered motivators, so the motivators
+/// must outlive the view (or be unregistered with Clear()). Defragmentation
+/// may shuffle motivator indices between frames, so Gather() re-reads every
+/// motivator's current index; only the processor grouping is cached, and
+/// even that is rebuilt automatically if a motivator has been re-initialized
+/// onto a different processor since the last Gather().
+class MotivatorValueView {
+ public:
+  MotivatorValueView() : num_values_(0), grouped_(false) {}
+
+  /// Register `motivator`. Its values occupy the next Dimensions() floats of
+  /// the output buffer, in registration order. The motivator must stay valid,
+  /// with the same number of dimensions, until the view is Clear()ed.
+  void Add(const MotivatorNf* motivator);
+
+  /// Unregister all motivators.
+  void Clear();
+
+  /// Number of registered motivators.
+  int Count() const { return static_cast<int>(motivators_.size()); }
+
+  /// Total number of floats Gather() writes: the sum of Dimensions() over
+  /// all registered motivators.
+  int NumValues() const { return num_values_; }
+
+  /// Fill `out` with the current value of every registered motivator, in
+  /// registration order. One virtual call per distinct processor.
+  /// @param out Output array of length NumValues().
+  void Gather(float* out);
+
+  /// Fill the arrays with every registered motivator's playback progress,
+  /// in registration order: current spline time, the time its spline ends,
+  /// and its playback rate. The time-domain companion to Gather(), for UI
+  /// drawing progress bars or sync markers for many playing animations.
+  /// One entry per motivator--progress is shared by all of a motivator's
+  /// dimensions--so each array has Count() entries, and any may be null to
+  /// skip that field. Motivators not driven by a spline report a spline
+  /// time of 0, an end time of the time remaining to target, and a rate
+  /// of 1.
+  void GatherTimes(MotiveTime* spline_times, MotiveTime* end_times,
+                   float* rates);
+
+ private:
+  struct Group {
+    const MotiveProcessorNf* processor;
+    int start;  // First entry of this group in `order_`.
+    int count;  // Number of entries in this group.
+  };
+
+  void Rebuild();
+  bool GatherOnce(float* out);
+  bool GatherTimesOnce(MotiveTime* spline_times, MotiveTime* end_times,
+                       float* rates);
+
+  // Registered motivators, in registration order.
+  std::vector<const MotivatorNf*> motivators_;
+  // Output offset of each motivator's first value, in registration order.
+  std::vector<int> out_offsets_;
+  // Dimensions of each motivator when it was registered.
+  std::vector<MotiveDimension> dimensions_;
+  // Permutation of registration slots sorted by processor. The run of slots
+  // belonging to each processor is recorded in `groups_`.
+  std::vector<int> order_;
+  std::vector<Group> groups_;
+  // Scratch for the per-group GatherValues() calls, sized in Rebuild() for
+  // the largest group.
+  std::vector<MotiveIndex> index_scratch_;
+  std::vector<float> value_scratch_;
+  // Scratch for the per-group GatherTimes() calls: one entry per motivator
+  // of the largest group. Rates reuse `value_scratch_`, which is at least
+  // as large.
+  std::vector<MotiveTime> time_scratch_;
+  std::vector<MotiveTime> end_time_scratch_;
+  int num_values_;
+  bool grouped_;
+};
+
 }  // namespace motive
 
 #endif  // MOTIVE_VECTOR_MOTIVATOR_H_
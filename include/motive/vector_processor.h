@@ -57,12 +57,86 @@ class MotiveProcessorNf : public MotiveProcessor {
   }
 
   virtual const float* Values(MotiveIndex index) const = 0;
+
+  // Fill `out` with the current value of each of the `count` indices in
+  // `indices`. Equivalent to calling Value() once per index, but the whole
+  // batch costs a single virtual call, and derived classes override this
+  // with a direct copy out of their internal value arrays. Callers reading
+  // many motivators per frame should go through MotivatorValueView, which
+  // batches its registered motivators into one of these calls per processor.
+  virtual void GatherValues(const MotiveIndex* indices, MotiveIndex count,
+                            float* out) const {
+    for (MotiveIndex i = 0; i < count; ++i) {
+      out[i] = Values(indices[i])[0];
+    }
+  }
+
+  // Fill the output arrays with the playback progress of each of the
+  // `count` indices in `indices`: current spline time, the time at which
+  // the spline ends, and the playback rate. The time-domain companion to
+  // GatherValues(), for UI that draws progress bars or sync markers for
+  // many playing animations: the whole batch costs a single virtual call,
+  // and spline-backed processors override it to read straight out of their
+  // evaluator's time arrays. Any output array may be null to skip that
+  // field. This default forwards to SplineTime() and TargetTime(), so
+  // indices without a spline timeline report a spline time of 0, an end
+  // time of the time remaining to target, and a rate of 1.
+  virtual void GatherTimes(const MotiveIndex* indices, MotiveIndex count,
+                           MotiveTime* spline_times, MotiveTime* end_times,
+                           float* rates) const {
+    for (MotiveIndex i = 0; i < count; ++i) {
+      const MotiveIndex index = indices[i];
+      if (spline_times != nullptr) spline_times[i] = SplineTime(index);
+      if (end_times != nullptr) {
+        end_times[i] = SplineTime(index) + TargetTime(index, 1);
+      }
+      if (rates != nullptr) rates[i] = 1.0f;
+    }
+  }
+
   virtual void Velocities(MotiveIndex index, MotiveDimension dimensions,
                           float* out) const = 0;
+
+  // Predict the values `lookahead` time-units in the future, without
+  // advancing anything--a read-only query, safe to call at any time. Also
+  // predicts the velocities when `future_velocities` is non-null. The
+  // default extrapolates linearly from the current value and velocity;
+  // processors with analytic curves (notably splines) override this with
+  // exact evaluation, crossing curve-segment boundaries read-only. Useful
+  // for AI that aims at where an animated value will be.
+  virtual void FutureValues(MotiveIndex index, MotiveDimension dimensions,
+                            MotiveTime lookahead, float* future_values,
+                            float* future_velocities = nullptr) const {
+    // Use the output array as scratch for the current velocities.
+    Velocities(index, dimensions, future_values);
+    const float* values = Values(index);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      const float velocity = future_values[i];
+      if (future_velocities != nullptr) future_velocities[i] = velocity;
+      future_values[i] = values[i] + velocity * static_cast<float>(lookahead);
+    }
+  }
   virtual void Directions(MotiveIndex index, MotiveDimension dimensions,
                           float* out) const {
     Velocities(index, dimensions, out);
   }
+
+  // Write each dimension's value extrapolated `lookahead` time-units ahead
+  // along its current velocity, for render-rate sampling between simulation
+  // ticks; see MotivatorNf::ExtrapolatedValues(). Unlike FutureValues(),
+  // this never crosses curve-segment boundaries, so it stays a few
+  // multiply-adds per dimension, and processors that keep frame snapshots
+  // override it to read the published snapshot, making it safe to call
+  // from a render thread.
+  virtual void ExtrapolatedValues(MotiveIndex index, MotiveDimension dimensions,
+                                  MotiveTime lookahead, float* out) const {
+    // Use the output array as scratch for the current velocities.
+    Velocities(index, dimensions, out);
+    const float* values = Values(index);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      out[i] = values[i] + out[i] * static_cast<float>(lookahead);
+    }
+  }
   virtual void TargetValues(MotiveIndex index, MotiveDimension dimensions,
                             float* out) const = 0;
   virtual void TargetVelocities(MotiveIndex index, MotiveDimension dimensions,
@@ -86,6 +160,20 @@ class MotiveProcessorNf : public MotiveProcessor {
   virtual void SetTargets(MotiveIndex /*index*/, MotiveDimension /*dimensions*/,
                           const MotiveTarget1f* /*ts*/) {}
 
+  // Set the same target way points on several motivators at once. Each
+  // motivator occupies `dimensions` indices starting at indices[i].
+  // Equivalent to calling SetTargets() once per motivator--which is what
+  // this default implementation does--but processors that compile targets
+  // into curves can override it to compile the shared way-point sequence
+  // once and reuse it for every motivator.
+  virtual void SetSharedTargets(const MotiveIndex* indices, int num_motivators,
+                                MotiveDimension dimensions,
+                                const MotiveTarget1f* ts) {
+    for (int i = 0; i < num_motivators; ++i) {
+      SetTargets(indices[i], dimensions, ts);
+    }
+  }
+
   // Set the target we want the Motivator to achieve and describe the curve
   // shape it should use to get there.
   virtual void SetTargetWithShape(MotiveIndex /*index*/,
@@ -120,6 +208,27 @@ class MotiveProcessorNf : public MotiveProcessor {
   virtual void SetSplinePlaybackRate(MotiveIndex /*index*/,
                                      MotiveDimension /*dimensions*/,
                                      float /*playback_rate*/) {}
+
+  /// Register thresholds whose crossings are detected during the bulk
+  /// evaluation pass; `ys` holds one threshold per dimension. See
+  /// MotivatorNf::SetCrossingThreshold(). The default implementations do
+  /// nothing; only spline-backed processors detect crossings.
+  virtual void SetCrossingThresholds(MotiveIndex /*index*/,
+                                     MotiveDimension /*dimensions*/,
+                                     const float* /*ys*/,
+                                     MotiveCrossingDirection /*direction*/) {}
+  virtual void ClearCrossingThresholds(MotiveIndex /*index*/,
+                                       MotiveDimension /*dimensions*/) {}
+
+  /// Mirror another motivator's spline playback instead of evaluating
+  /// independently; see MotivatorNf::SetPlaybackMaster(). The default
+  /// implementations do nothing; only spline-backed processors share
+  /// playback.
+  virtual void SetPlaybackMasters(MotiveIndex /*index*/,
+                                  MotiveDimension /*dimensions*/,
+                                  MotiveIndex /*master_index*/) {}
+  virtual void ClearPlaybackMasters(MotiveIndex /*index*/,
+                                    MotiveDimension /*dimensions*/) {}
 };
 
 }  // namespace motive
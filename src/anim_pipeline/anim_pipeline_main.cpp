@@ -28,16 +28,18 @@ static void LogUsage(fplutil::Logger* log) {
   static const char kOptionIndent[] = "                           ";
   log->Log(
       kLogImportant,
-      "Usage: anim_pipeline [-v|-d|-i] [-o OUTPUT_FILE]\n"
+      "Usage: anim_pipeline [-v|-d|-i] [-o OUTPUT_FILE] [-c CACHE_DIR]\n"
       "                     [-st SCALE_TOLERANCE] [-rt ROTATE_TOLERANCE]\n"
       "                     [-tt TRANSLATE_TOLERANCE]\n"
       "                     [-at DERIVATIVE_TOLERANCE] [--repeat|--norepeat]\n"
       "                     [--stagger] [--start] [-a AXES]\n"
       "                     [-u (unit)|(scale)] [--roots] [--debug_time TIME]\n"
-      "                     FBX_FILE\n"
+      "                     [--batch] FBX_FILE\n"
       "\n"
       "Pipeline to convert FBX animations into FlatBuffer animations.\n"
-      "Outputs a .motiveanim file with the same base name as FBX_FILE.\n\n"
+      "Outputs a .motiveanim file with the same base name as FBX_FILE.\n"
+      "FBX_FILE may also be a glTF 2.0 file (.gltf or .glb); glTF files\n"
+      "are converted with a built-in importer that needs no FBX SDK.\n\n"
       "Options:\n"
       "  -v, --verbose output all informative messages\n"
       "  -d, --details output important informative messages\n"
@@ -46,6 +48,32 @@ static void LogUsage(fplutil::Logger* log) {
       "                file to write .motiveanim file to.\n"
       "                Can be an absolute or relative path.\n"
       "                when unspecified, uses base FBX name + .motiveanim.\n"
+      "  -c, --cache CACHE_DIR\n"
+      "                reuse previous conversions. The FBX file's contents\n"
+      "                and the conversion settings are hashed; if CACHE_DIR\n"
+      "                holds the output of an identical previous run, it is\n"
+      "                copied to the output file instead of reconverting.\n"
+      "                Each successful conversion adds its output to\n"
+      "                CACHE_DIR, which is created if needed.\n"
+      "  --report REPORT_FILE\n"
+      "                append a per-channel cost report to REPORT_FILE:\n"
+      "                one csv row per spline channel with node count,\n"
+      "                CompactSpline bytes, and node crossings per second\n"
+      "                of playback (how often the runtime evaluator\n"
+      "                re-derives a cubic for the channel), plus a total\n"
+      "                row per anim. Rows accumulate across runs, so one\n"
+      "                file can gate a whole batch; the worst offenders\n"
+      "                are also logged. Bypasses the conversion cache, so\n"
+      "                every anim in the batch is measured.\n"
+      "  --batch       treat FBX_FILE as a manifest instead of an FBX\n"
+      "                file: one FBX path per line, with blank lines and\n"
+      "                lines starting with '#' skipped. Every listed file\n"
+      "                is converted in this one process, sharing one FBX\n"
+      "                SDK instance, so small clips skip the per-process\n"
+      "                SDK startup cost. Each output is written beside\n"
+      "                its source file (-o is ignored); all other options\n"
+      "                apply to every file. After a combined summary,\n"
+      "                exits with the number of files that failed.\n"
       "  -st, --scale SCALE_TOLERANCE\n"
       "                max deviation of output scale curves from input\n"
       "                scale curves; unitless\n"
@@ -108,6 +136,18 @@ static void LogUsage(fplutil::Logger* log) {
       "                distance unit. For example, instead of '-u inches',\n"
       "                you could also use '-u 2.54'.\n"
       "                If unspecified, use FBX file's unit.\n"
+      "  -q, --quaternions\n"
+      "                output animated rotations as four quaternion\n"
+      "                component channels instead of Euler channels.\n"
+      "                Collapses pre-rotation, rotation, and post-rotation\n"
+      "                into one rotation per bone, and lets the runtime\n"
+      "                blend rotations with normalized lerps.\n"
+      "  --minimize, --minimize_nodes\n"
+      "                refit every channel to the fewest spline nodes that\n"
+      "                stay within the tolerances, and report the bytes\n"
+      "                saved. The default fit is greedy and typically\n"
+      "                leaves 20-30%% more nodes than needed. Slower to\n"
+      "                convert; smaller files and cheaper playback.\n"
       "  --roots, --root_bones_only\n"
       "                output only the root bones of each mesh.\n"
       "                Each mesh gets its animation file.\n"
@@ -123,6 +163,7 @@ static void LogUsage(fplutil::Logger* log) {
 static bool ParseAnimPipelineArgs(int argc, char** argv, fplutil::Logger& log,
                                   motive::AnimPipelineArgs* args) {
   bool valid_args = true;
+  bool batch = false;
 
   // Last parameter is used as file name.
   if (argc > 1) {
@@ -159,6 +200,22 @@ static bool ParseAnimPipelineArgs(int argc, char** argv, fplutil::Logger& log,
         valid_args = false;
       }
 
+    } else if (arg == "-c" || arg == "--cache") {
+      if (i + 1 < argc - 1) {
+        args->cache_dir = std::string(argv[i + 1]);
+        i++;
+      } else {
+        valid_args = false;
+      }
+
+    } else if (arg == "--report") {
+      if (i + 1 < argc - 1) {
+        args->report_file = std::string(argv[i + 1]);
+        i++;
+      } else {
+        valid_args = false;
+      }
+
     } else if (arg == "-st" || arg == "--scale") {
       if (i + 1 < argc - 1) {
         args->tolerances.scale = static_cast<float>(atof(argv[i + 1]));
@@ -225,9 +282,18 @@ static bool ParseAnimPipelineArgs(int argc, char** argv, fplutil::Logger& log,
         args->repeat_preference = repeat_preference;
       }
 
+    } else if (arg == "--batch") {
+      batch = true;
+
     } else if (arg == "--nouniformscale") {
       args->no_uniform_scale = true;
 
+    } else if (arg == "--minimize" || arg == "--minimize_nodes") {
+      args->minimize_nodes = true;
+
+    } else if (arg == "-q" || arg == "--quaternions") {
+      args->quaternion_rotations = true;
+
     } else if (arg == "--stagger" || arg == "--stagger_end_times") {
       args->stagger_end_times = true;
 
@@ -280,6 +346,14 @@ static bool ParseAnimPipelineArgs(int argc, char** argv, fplutil::Logger& log,
     }
   }
 
+  // In batch mode the trailing file argument is the manifest, not an FBX
+  // file; per-file output names are derived inside the pipeline.
+  if (batch) {
+    args->batch_file = args->fbx_file;
+    args->fbx_file.clear();
+    args->output_file.clear();
+  }
+
   // Print usage.
   if (!valid_args) {
     LogUsage(&log);
@@ -1,9 +1,12 @@
 #include "flat_anim.h"
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include "anim_generated.h"
 #include "anim_list_generated.h"
 #include "fplutil/file_utils.h"
+#include "motive/util/job_system.h"
 
 namespace motive {
 
@@ -50,14 +53,123 @@ void FlatAnim::LogAllChannels() const {
   }
 }
 
+// Number of channels named in the worst-offenders summary.
+static const size_t kNumWorstOffenders = 5;
+
+// True if the two fitted splines evaluate identically: same quantization
+// parameters and byte-identical node data. Mirrored limbs and
+// authored-identical tracks commonly fit to identical splines.
+static bool SplinesIdentical(const CompactSpline& a, const CompactSpline& b) {
+  return a.num_nodes() == b.num_nodes() && a.format() == b.format() &&
+         a.y_range().start() == b.y_range().start() &&
+         a.y_range().end() == b.y_range().end() &&
+         a.x_granularity() == b.x_granularity() &&
+         memcmp(a.node_data(), b.node_data(), a.node_data_size()) == 0;
+}
+
+bool FlatAnim::OutputReport(const std::string& report_file,
+                            const std::string& anim_name) const {
+  // Gather the cost drivers of every channel. Constant channels (a single
+  // node) are emitted as ConstantOpFb and carry no spline, so they cost
+  // nothing at runtime and are excluded.
+  struct ChannelCost {
+    const char* bone;
+    const char* op;
+    size_t num_nodes;
+    size_t spline_bytes;
+    double crossings_per_sec;
+  };
+  std::vector<ChannelCost> costs;
+  for (size_t bone_idx = 0; bone_idx < bones_.size(); ++bone_idx) {
+    const Bone& bone = bones_[bone_idx];
+    for (auto c = bone.channels.begin(); c != bone.channels.end(); ++c) {
+      const Nodes& n = c->nodes;
+      if (n.size() <= 1) continue;
+
+      ChannelCost cost;
+      cost.bone = BoneBaseName(bone.name);
+      cost.op = MatrixOpName(c->op);
+      cost.num_nodes = n.size();
+      cost.spline_bytes =
+          CompactSpline::Size(static_cast<CompactSplineIndex>(n.size()));
+
+      // Every node crossed during playback re-derives a cubic segment in
+      // the runtime evaluator, so node density--not just node count--is
+      // what a clip costs per second on device. Node times are in ms.
+      const FlatTime duration = n.back().time - n.front().time;
+      cost.crossings_per_sec =
+          duration <= 0
+              ? 0.0
+              : (n.size() - 1) * 1000.0 / static_cast<double>(duration);
+      costs.push_back(cost);
+    }
+  }
+
+  // Append to the report so that a batch of pipeline runs accumulates one
+  // file; the header is only written when the file starts empty.
+  FILE* file = fopen(report_file.c_str(), "at");
+  if (file == nullptr) {
+    log_.Log(fplutil::kLogError, "Could not open report file %s\n",
+             report_file.c_str());
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  if (ftell(file) == 0) {
+    fprintf(file, "anim,bone,operation,nodes,spline_bytes,crossings_per_sec\n");
+  }
+  size_t total_bytes = 0;
+  double total_crossings = 0.0;
+  for (size_t i = 0; i < costs.size(); ++i) {
+    const ChannelCost& cost = costs[i];
+    fprintf(file, "%s,%s,%s,%d,%d,%.2f\n", anim_name.c_str(), cost.bone,
+            cost.op, static_cast<int>(cost.num_nodes),
+            static_cast<int>(cost.spline_bytes), cost.crossings_per_sec);
+    total_bytes += cost.spline_bytes;
+    total_crossings += cost.crossings_per_sec;
+  }
+  fprintf(file, "%s,total,,%d,%d,%.2f\n", anim_name.c_str(),
+          static_cast<int>(costs.size()), static_cast<int>(total_bytes),
+          total_crossings);
+  fclose(file);
+
+  // Name the heaviest channels, so the animator learns which curve to
+  // simplify without opening the csv.
+  std::sort(costs.begin(), costs.end(),
+            [](const ChannelCost& a, const ChannelCost& b) {
+              return a.spline_bytes > b.spline_bytes;
+            });
+  log_.Log(fplutil::kLogImportant,
+           "  %d spline channels, %d spline bytes, %.1f node"
+           " crossings/sec\n",
+           static_cast<int>(costs.size()), static_cast<int>(total_bytes),
+           total_crossings);
+  const size_t num_offenders = std::min(kNumWorstOffenders, costs.size());
+  for (size_t i = 0; i < num_offenders; ++i) {
+    const ChannelCost& cost = costs[i];
+    log_.Log(fplutil::kLogImportant,
+             "    %s %s: %d nodes, %d bytes, %.1f crossings/sec\n", cost.bone,
+             cost.op, static_cast<int>(cost.num_nodes),
+             static_cast<int>(cost.spline_bytes), cost.crossings_per_sec);
+  }
+  return true;
+}
+
 bool FlatAnim::OutputFlatBuffer(const std::string& suggested_output_file,
-                                RepeatPreference repeat_preference) const {
+                                RepeatPreference repeat_preference,
+                                std::string* actual_output_file) const {
   const std::string anim_name = fplutil::RemoveDirectoryFromName(
       fplutil::RemoveExtensionFromName(suggested_output_file));
 
+  // Fit the spline for every non-constant channel up front, across a thread
+  // pool. The FlatBuffer write below consumes the fitted splines serially.
+  BuiltSplines splines;
+  BuildCompactSplines(&splines);
+
   // Build the flatbuffer into `fbb`.
   flatbuffers::FlatBufferBuilder fbb;
-  const int num_rig_anims = CreateFlatBuffer(fbb, repeat_preference, anim_name);
+  const int num_rig_anims =
+      CreateFlatBuffer(fbb, repeat_preference, anim_name, splines);
+  DestroySplines(&splines);
   if (num_rig_anims == 0) return false;
 
   // Set the extension appropriately.
@@ -90,12 +202,16 @@ bool FlatAnim::OutputFlatBuffer(const std::string& suggested_output_file,
   // Log summary.
   log_.Log(fplutil::kLogImportant, "  %s (%d bytes)\n",
            fplutil::RemoveDirectoryFromName(output_file).c_str(), NumBytes());
+  if (actual_output_file != nullptr) {
+    *actual_output_file = output_file;
+  }
   return true;
 }
 
 int FlatAnim::CreateFlatBuffer(flatbuffers::FlatBufferBuilder& fbb,
                                RepeatPreference repeat_preference,
-                               const std::string& anim_name) const {
+                               const std::string& anim_name,
+                               const BuiltSplines& splines) const {
   if (bones_.size() > kMaxNumBones) {
     log_.Log(fplutil::kLogError, "Too many bones: %d. Limit of %d.\n",
              bones_.size(), kMaxNumBones);
@@ -108,7 +224,8 @@ int FlatAnim::CreateFlatBuffer(flatbuffers::FlatBufferBuilder& fbb,
   if (!root_bones_only_) {
     const flatbuffers::Offset<RigAnimFb> rig_anim_offset =
         CreateRigAnimFbFromBoneRange(fbb, repeat_preference,
-                                     BoneRange(0, num_bones), anim_name);
+                                     BoneRange(0, num_bones), anim_name,
+                                     splines);
     motive::FinishRigAnimFbBuffer(fbb, rig_anim_offset);
     return 1;
   }
@@ -129,7 +246,7 @@ int FlatAnim::CreateFlatBuffer(flatbuffers::FlatBufferBuilder& fbb,
     // Create a RigAnim with only `bone_idx`.
     rig_anim_offsets.push_back(CreateRigAnimFbFromBoneRange(
         fbb, repeat_preference, BoneRange(bone_idx, bone_idx + 1),
-        bone_anim_name.str()));
+        bone_anim_name.str(), splines));
   }
 
   // No bones had any animation data, so do nothing.
@@ -159,10 +276,23 @@ int FlatAnim::CreateFlatBuffer(flatbuffers::FlatBufferBuilder& fbb,
 
 flatbuffers::Offset<RigAnimFb> FlatAnim::CreateRigAnimFbFromBoneRange(
     flatbuffers::FlatBufferBuilder& fbb, RepeatPreference repeat_preference,
-    const BoneRange& bone_range, const std::string& anim_name) const {
+    const BoneRange& bone_range, const std::string& anim_name,
+    const BuiltSplines& splines) const {
   std::vector<flatbuffers::Offset<motive::MatrixAnimFb>> matrix_anims;
   std::vector<flatbuffers::Offset<flatbuffers::String>> bone_names;
   std::vector<BoneIndex> bone_parents;
+
+  // Channels whose fitted splines are identical--mirrored limbs,
+  // authored-identical tracks--are emitted as one shared CompactSplineFb
+  // table, referenced by every matching op. Sharing the offset shrinks the
+  // file, and RigAnimFromFlatBuffers() binds the repeated table to a single
+  // runtime CompactSpline, so the deduplication carries through to spline
+  // memory and evaluator cache hit rates.
+  std::vector<std::pair<const CompactSpline*,
+                        flatbuffers::Offset<motive::CompactSplineFb>>>
+      spline_cache;
+  int num_shared = 0;
+
   const size_t num_bones = bone_range.Length();
   matrix_anims.reserve(num_bones);
   bone_names.reserve(num_bones);
@@ -193,11 +323,26 @@ flatbuffers::Offset<RigAnimFb> FlatAnim::CreateRigAnimFbFromBoneRange(
                    BoneBaseName(bone.name), MatrixOpName(c->op), n[0].time);
         }
 
-        // Output spline MatrixOp.
-        CompactSpline* s = CreateCompactSpline(*c);
-        value = CreateSplineFlatBuffer(fbb, *s).Union();
+        // Output spline MatrixOp, fitted up front by BuildCompactSplines().
+        // Identical splines already emitted for this anim are referenced
+        // instead of re-emitted; see `spline_cache` above.
+        const CompactSpline* s = splines[bone_idx][c - channels.begin()];
+        assert(s != nullptr);
+        flatbuffers::Offset<motive::CompactSplineFb> spline_fb;
+        for (auto cached = spline_cache.begin();; ++cached) {
+          if (cached == spline_cache.end()) {
+            spline_fb = CreateSplineFlatBuffer(fbb, *s);
+            spline_cache.emplace_back(s, spline_fb);
+            break;
+          }
+          if (SplinesIdentical(*cached->first, *s)) {
+            spline_fb = cached->second;
+            num_shared++;
+            break;
+          }
+        }
+        value = spline_fb.Union();
         value_type = motive::MatrixOpValueFb_CompactSplineFb;
-        CompactSpline::Destroy(s);
       }
 
       ops.push_back(motive::CreateMatrixOpFb(
@@ -214,6 +359,12 @@ flatbuffers::Offset<RigAnimFb> FlatAnim::CreateRigAnimFbFromBoneRange(
     bone_parents.push_back(BoneParent(bone_idx));
   }
 
+  if (num_shared > 0) {
+    log_.Log(fplutil::kLogInfo,
+             "  %d of %d spline channels deduplicated\n", num_shared,
+             num_shared + static_cast<int>(spline_cache.size()));
+  }
+
   // Finish off the FlatBuffer by creating the root RigAnimFb table.
   auto bone_names_fb = fbb.CreateVector(bone_names);
   auto bone_parents_fb = fbb.CreateVector(bone_parents);
@@ -225,6 +376,56 @@ flatbuffers::Offset<RigAnimFb> FlatAnim::CreateRigAnimFbFromBoneRange(
   return rig_anim_fb;
 }
 
+// static
+void FlatAnim::BuildSplineJob(void* data) {
+  BuildSplineJobData* d = static_cast<BuildSplineJobData*>(data);
+  *d->out = CreateCompactSpline(*d->channel);
+}
+
+void FlatAnim::BuildCompactSplines(BuiltSplines* splines) const {
+  // Gather the job data first, so that pointers into it stay stable while
+  // the pool runs.
+  splines->resize(bones_.size());
+  std::vector<BuildSplineJobData> jobs;
+  for (size_t bone_idx = 0; bone_idx < bones_.size(); ++bone_idx) {
+    const Channels& channels = bones_[bone_idx].channels;
+    std::vector<CompactSpline*>& out = (*splines)[bone_idx];
+    out.assign(channels.size(), nullptr);
+    for (size_t ch = 0; ch < channels.size(); ++ch) {
+      // Single-node channels are output as constants; see
+      // CreateRigAnimFbFromBoneRange().
+      if (channels[ch].nodes.size() <= 1) continue;
+      BuildSplineJobData job;
+      job.channel = &channels[ch];
+      job.out = &out[ch];
+      jobs.push_back(job);
+    }
+  }
+  if (jobs.empty()) return;
+
+  // Submit one job per channel. Fits vary wildly in cost--a root translation
+  // may have thousands of nodes while a finger rotation has three--so
+  // per-channel granularity keeps the pool balanced.
+  ThreadPoolJobSystem pool;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    pool.Submit(BuildSplineJob, &jobs[i]);
+  }
+  pool.WaitForAll();
+}
+
+// static
+void FlatAnim::DestroySplines(BuiltSplines* splines) {
+  for (size_t bone_idx = 0; bone_idx < splines->size(); ++bone_idx) {
+    std::vector<CompactSpline*>& bone_splines = (*splines)[bone_idx];
+    for (size_t ch = 0; ch < bone_splines.size(); ++ch) {
+      if (bone_splines[ch] != nullptr) {
+        CompactSpline::Destroy(bone_splines[ch]);
+      }
+    }
+  }
+  splines->clear();
+}
+
 flatbuffers::Offset<motive::CompactSplineFb> FlatAnim::CreateSplineFlatBuffer(
     flatbuffers::FlatBufferBuilder& fbb, const CompactSpline& s) {
   auto nodes_fb = fbb.CreateVectorOfStructs(
@@ -256,10 +457,25 @@ CompactSpline* FlatAnim::CreateCompactSpline(const Channel& ch) {
   const Nodes& nodes = ch.nodes;
   assert(nodes.size() > 1);
 
-  // Maximize the bits we get for x by making the last time the maximum
-  // x-value.
+  // Choose the x-granularity adaptively per channel. Node times are integral
+  // and usually share a common spacing (sampled curves land on multiples of
+  // the sample period), so their greatest common divisor is a granularity
+  // that represents every node time exactly, and lets animations up to
+  // gcd * 65535 ms fit in a single spline. Irregular channels fall back to
+  // making the last time the maximum x-value, maximizing the bits we get
+  // for x.
+  FlatTime time_spacing = 0;
+  for (auto n = nodes.begin(); n != nodes.end(); ++n) {
+    FlatTime t = std::max(0, n->time);
+    while (t != 0) {
+      const FlatTime remainder = time_spacing % t;
+      time_spacing = t;
+      t = remainder;
+    }
+  }
   const float x_granularity = CompactSpline::RecommendXGranularity(
-      static_cast<float>(nodes.back().time));
+      static_cast<float>(nodes.back().time),
+      static_cast<float>(time_spacing));
   const Range y_range = SplineYRange(ch);
 
   // Construct the Spline from the node data directly.
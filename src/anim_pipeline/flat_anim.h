@@ -14,22 +14,60 @@ class FlatAnim : public AnimData {
            fplutil::Logger& log)
       : AnimData(tolerances, root_bones_only, log) {}
 
+  // Write the animation to a binary FlatBuffer file. The file gets the base
+  // name of `suggested_output_file` and the extension of the format actually
+  // produced (RigAnimFb, or AnimListFb when several RigAnims are output);
+  // if `actual_output_file` is non-null, the chosen name is returned in it.
   bool OutputFlatBuffer(const std::string& suggested_output_file,
-                        RepeatPreference repeat_preference) const;
+                        RepeatPreference repeat_preference,
+                        std::string* actual_output_file = nullptr) const;
+
+  // Append one csv row per channel to `report_file`, characterizing the
+  // converted anim's runtime cost drivers:
+  //     anim, bone, operation, nodes, spline_bytes, crossings_per_sec
+  // plus one `total` row per anim. `spline_bytes` is the in-memory size of
+  // the channel's CompactSpline; `crossings_per_sec` is how often playback
+  // crosses a spline node, i.e. how often the runtime evaluator re-derives
+  // a cubic segment for the channel. Rows from successive pipeline runs
+  // accumulate in the file, so one report can gate a whole batch. Also logs
+  // a worst-offenders summary of the costliest channels.
+  bool OutputReport(const std::string& report_file,
+                    const std::string& anim_name) const;
 
   void LogChannel(FlatChannelId channel_id) const;
   void LogAllChannels() const;
 
  private:
+  // One fitted spline per channel, indexed [bone][channel]. Null entries are
+  // channels that are output as constants.
+  typedef std::vector<std::vector<CompactSpline*>> BuiltSplines;
+
+  // Data for one BuildSplineJob(): the channel to fit and where to store
+  // the resulting spline.
+  struct BuildSplineJobData {
+    const Channel* channel;
+    CompactSpline** out;
+  };
+
   // Build the FlatBuffer to be output into `fbb` and return the number of
   // `RigAnimFb` tables output to `fbb`. If the number is >1, then aggregate
   // them all into one `AnimListFb`.
   int CreateFlatBuffer(flatbuffers::FlatBufferBuilder& fbb,
                        RepeatPreference repeat_preference,
-                       const std::string& anim_name) const;
+                       const std::string& anim_name,
+                       const BuiltSplines& splines) const;
   flatbuffers::Offset<RigAnimFb> CreateRigAnimFbFromBoneRange(
       flatbuffers::FlatBufferBuilder& fbb, RepeatPreference repeat_preference,
-      const BoneRange& bone_range, const std::string& anim_name) const;
+      const BoneRange& bone_range, const std::string& anim_name,
+      const BuiltSplines& splines) const;
+  // Fit a CompactSpline to every non-constant channel of every bone, with
+  // the fits spread across a thread pool. Channels are independent of each
+  // other, so this is where conversion scales with cores; the FlatBuffer
+  // write that consumes the result stays serial.
+  void BuildCompactSplines(BuiltSplines* splines) const;
+  static void DestroySplines(BuiltSplines* splines);
+  // MotiveJobSystem entry point for one channel's spline fit.
+  static void BuildSplineJob(void* data);
   // Remove the namespacing from the bone name.
   static const char* BoneBaseName(const std::string& name);
   static Range SplineYRange(const Channel& ch);
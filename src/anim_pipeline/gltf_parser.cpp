@@ -0,0 +1,962 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "gltf_parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "anim_data.h"
+#include "flat_anim.h"
+#include "motive/matrix_op.h"
+
+namespace motive {
+
+using fplutil::kLogError;
+using fplutil::kLogVerbose;
+using fplutil::kLogWarning;
+using fplutil::Logger;
+
+// MatrixOpIds of the operations a glTF node can animate. glTF local
+// transforms compose as T * R * S, so the ids ascend in that order:
+// translation x, y, z; quaternion w, x, y, z; scale x, y, z.
+static const MatrixOpId kGltfTranslateBaseId = 0;
+static const MatrixOpId kGltfQuaternionBaseId = 3;
+static const MatrixOpId kGltfScaleBaseId = 7;
+
+// Number of samples taken across each CUBICSPLINE key interval. The Hermite
+// segment is smooth, so AddCurve()'s recursive subdivision reduces these to
+// as few spline nodes as the tolerance allows.
+static const int kGltfCubicSamples = 16;
+
+// glTF times are float seconds; FlatTime is integer milliseconds.
+static FlatTime GltfToFlatTime(float seconds) {
+  return static_cast<FlatTime>(floorf(seconds * 1000.0f + 0.5f));
+}
+
+// glTF derivatives are in units per second; FlatDerivative is per
+// millisecond.
+static FlatDerivative GltfToFlatDerivative(float d) { return d / 1000.0f; }
+
+// ---------------------------- JSON document ----------------------------
+// glTF is JSON plus binary buffers. The importer needs only a handful of
+// fields, so a small DOM keeps it dependency free.
+
+class JsonValue {
+ public:
+  enum Type { kNull, kBool, kNumber, kString, kArray, kObject };
+
+  JsonValue() : type_(kNull), number_(0.0) {}
+
+  Type type() const { return type_; }
+
+  // Object lookup; null when `this` is not an object or lacks `key`.
+  const JsonValue* Find(const char* key) const {
+    if (type_ != kObject) return nullptr;
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (keys_[i] == key) return &children_[i];
+    }
+    return nullptr;
+  }
+
+  // Array access.
+  size_t Size() const { return type_ == kArray ? children_.size() : 0; }
+  const JsonValue& operator[](size_t i) const { return children_[i]; }
+
+  // Scalar access, with defaults for absent or mistyped values.
+  double Number(double default_value) const {
+    return type_ == kNumber ? number_ : default_value;
+  }
+  int Int(int default_value) const {
+    return type_ == kNumber ? static_cast<int>(number_) : default_value;
+  }
+  const std::string& String() const { return string_; }
+
+  // Convenience: look up `key` and return its integer value.
+  int IntField(const char* key, int default_value) const {
+    const JsonValue* value = Find(key);
+    return value == nullptr ? default_value : value->Int(default_value);
+  }
+
+ private:
+  friend class JsonParser;
+
+  Type type_;
+  double number_;
+  std::string string_;  // kString; also reused for bools internally.
+  std::vector<std::string> keys_;  // kObject; parallel to children_.
+  std::vector<JsonValue> children_;  // kArray and kObject.
+};
+
+// Recursive-descent parser over the whole document held in memory.
+class JsonParser {
+ public:
+  JsonParser(const char* text, size_t len, Logger& log)
+      : p_(text), end_(text + len), log_(log) {}
+
+  bool Parse(JsonValue* root) {
+    if (!ParseValue(root, 0)) return false;
+    SkipWhitespace();
+    if (p_ != end_) return Fail("trailing characters after JSON document");
+    return true;
+  }
+
+ private:
+  // Deeper nesting than this is assumed to be a malformed file.
+  static const int kMaxDepth = 64;
+
+  bool Fail(const char* message) {
+    log_.Log(kLogError, "JSON error: %s\n", message);
+    return false;
+  }
+
+  void SkipWhitespace() {
+    while (p_ != end_ &&
+           (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+      ++p_;
+    }
+  }
+
+  bool Consume(char c) {
+    SkipWhitespace();
+    if (p_ == end_ || *p_ != c) return false;
+    ++p_;
+    return true;
+  }
+
+  bool ParseLiteral(const char* literal) {
+    const size_t len = strlen(literal);
+    if (static_cast<size_t>(end_ - p_) < len ||
+        strncmp(p_, literal, len) != 0) {
+      return Fail("invalid literal");
+    }
+    p_ += len;
+    return true;
+  }
+
+  bool ParseString(std::string* out) {
+    if (!Consume('"')) return Fail("expected string");
+    out->clear();
+    while (p_ != end_ && *p_ != '"') {
+      char c = *p_++;
+      if (c != '\\') {
+        out->push_back(c);
+        continue;
+      }
+      if (p_ == end_) return Fail("unterminated escape");
+      c = *p_++;
+      switch (c) {
+        case 'b': out->push_back('\b'); break;
+        case 'f': out->push_back('\f'); break;
+        case 'n': out->push_back('\n'); break;
+        case 'r': out->push_back('\r'); break;
+        case 't': out->push_back('\t'); break;
+        case 'u': {
+          if (end_ - p_ < 4) return Fail("truncated \\u escape");
+          unsigned int code = 0;
+          for (int i = 0; i < 4; ++i) {
+            const char h = *p_++;
+            code <<= 4;
+            if (h >= '0' && h <= '9') code |= h - '0';
+            else if (h >= 'a' && h <= 'f') code |= h - 'a' + 10;
+            else if (h >= 'A' && h <= 'F') code |= h - 'A' + 10;
+            else return Fail("bad hex digit in \\u escape");
+          }
+          // Encode as UTF-8. Surrogate pairs are passed through unpaired;
+          // names are only logged, so exotic text need not round-trip.
+          if (code < 0x80) {
+            out->push_back(static_cast<char>(code));
+          } else if (code < 0x800) {
+            out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+          } else {
+            out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+          }
+          break;
+        }
+        default: out->push_back(c); break;  // Covers \" \\ and \/.
+      }
+    }
+    if (!Consume('"')) return Fail("unterminated string");
+    return true;
+  }
+
+  bool ParseValue(JsonValue* out, int depth) {
+    if (depth > kMaxDepth) return Fail("document nested too deeply");
+    SkipWhitespace();
+    if (p_ == end_) return Fail("unexpected end of document");
+
+    switch (*p_) {
+      case '{': {
+        ++p_;
+        out->type_ = JsonValue::kObject;
+        if (Consume('}')) return true;
+        do {
+          out->keys_.push_back(std::string());
+          out->children_.push_back(JsonValue());
+          if (!ParseString(&out->keys_.back())) return false;
+          if (!Consume(':')) return Fail("expected ':' in object");
+          if (!ParseValue(&out->children_.back(), depth + 1)) return false;
+        } while (Consume(','));
+        if (!Consume('}')) return Fail("expected '}' or ','");
+        return true;
+      }
+      case '[': {
+        ++p_;
+        out->type_ = JsonValue::kArray;
+        if (Consume(']')) return true;
+        do {
+          out->children_.push_back(JsonValue());
+          if (!ParseValue(&out->children_.back(), depth + 1)) return false;
+        } while (Consume(','));
+        if (!Consume(']')) return Fail("expected ']' or ','");
+        return true;
+      }
+      case '"':
+        out->type_ = JsonValue::kString;
+        return ParseString(&out->string_);
+      case 't':
+        out->type_ = JsonValue::kBool;
+        out->number_ = 1.0;
+        return ParseLiteral("true");
+      case 'f':
+        out->type_ = JsonValue::kBool;
+        out->number_ = 0.0;
+        return ParseLiteral("false");
+      case 'n':
+        out->type_ = JsonValue::kNull;
+        return ParseLiteral("null");
+      default: {
+        char* number_end = nullptr;
+        out->type_ = JsonValue::kNumber;
+        out->number_ = strtod(p_, &number_end);
+        if (number_end == p_ || number_end > end_) {
+          return Fail("invalid number");
+        }
+        p_ = number_end;
+        return true;
+      }
+    }
+  }
+
+  const char* p_;
+  const char* end_;
+  Logger& log_;
+};
+
+// ------------------------- file and buffer I/O -------------------------
+
+static bool ReadFileBytes(const char* file_name, std::vector<uint8_t>* out,
+                          Logger& log) {
+  FILE* file = fopen(file_name, "rb");
+  if (file == nullptr) {
+    log.Log(kLogError, "Cannot open file %s\n", file_name);
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  const long file_size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  out->resize(file_size <= 0 ? 0 : static_cast<size_t>(file_size));
+  const size_t num_read =
+      out->empty() ? 0 : fread(out->data(), 1, out->size(), file);
+  fclose(file);
+  if (num_read != out->size()) {
+    log.Log(kLogError, "Cannot read file %s\n", file_name);
+    return false;
+  }
+  return true;
+}
+
+// Decode base64 `text` into `out`. Returns false on a character outside
+// the base64 alphabet.
+static bool DecodeBase64(const char* text, size_t len,
+                         std::vector<uint8_t>* out) {
+  static const char* const kAlphabet =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  out->clear();
+  out->reserve(len / 4 * 3);
+  uint32_t accum = 0;
+  int num_bits = 0;
+  for (size_t i = 0; i < len; ++i) {
+    const char c = text[i];
+    if (c == '=' || c == '\n' || c == '\r') continue;
+    const char* found = strchr(kAlphabet, c);
+    if (found == nullptr) return false;
+    accum = (accum << 6) | static_cast<uint32_t>(found - kAlphabet);
+    num_bits += 6;
+    if (num_bits >= 8) {
+      num_bits -= 8;
+      out->push_back(static_cast<uint8_t>(accum >> num_bits));
+    }
+  }
+  return true;
+}
+
+// ------------------------------ glTF file ------------------------------
+
+// GLB container constants; see the glTF 2.0 specification.
+static const uint32_t kGlbMagic = 0x46546C67;       // 'glTF'
+static const uint32_t kGlbChunkJson = 0x4E4F534A;   // 'JSON'
+static const uint32_t kGlbChunkBin = 0x004E4942;    // 'BIN\0'
+
+// The parsed JSON document plus every buffer's bytes, resolved from the
+// GLB BIN chunk, data: URIs, or files beside the source file.
+struct GltfFile {
+  JsonValue root;
+  std::vector<std::vector<uint8_t>> buffers;
+};
+
+static uint32_t ReadU32(const uint8_t* bytes) {
+  uint32_t value;
+  memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+static bool LoadGltfFile(const char* file_name, GltfFile* gltf, Logger& log) {
+  std::vector<uint8_t> bytes;
+  if (!ReadFileBytes(file_name, &bytes, log)) return false;
+
+  // Split GLB containers into their JSON and BIN chunks. A plain .gltf
+  // file is the JSON document itself.
+  const char* json_text = reinterpret_cast<const char*>(bytes.data());
+  size_t json_len = bytes.size();
+  std::vector<uint8_t> glb_bin;
+  const bool is_glb = bytes.size() >= 12 && ReadU32(bytes.data()) == kGlbMagic;
+  if (is_glb) {
+    json_len = 0;
+    size_t offset = 12;
+    while (offset + 8 <= bytes.size()) {
+      const uint32_t chunk_len = ReadU32(&bytes[offset]);
+      const uint32_t chunk_type = ReadU32(&bytes[offset + 4]);
+      offset += 8;
+      if (offset + chunk_len > bytes.size()) break;
+      if (chunk_type == kGlbChunkJson) {
+        json_text = reinterpret_cast<const char*>(&bytes[offset]);
+        json_len = chunk_len;
+      } else if (chunk_type == kGlbChunkBin) {
+        glb_bin.assign(&bytes[offset], &bytes[offset] + chunk_len);
+      }
+      offset += chunk_len;
+    }
+    if (json_len == 0) {
+      log.Log(kLogError, "%s has no JSON chunk\n", file_name);
+      return false;
+    }
+  }
+
+  JsonParser parser(json_text, json_len, log);
+  if (!parser.Parse(&gltf->root)) return false;
+
+  // Resolve every buffer. External URIs are relative to the source file.
+  std::string dir(file_name);
+  const size_t last_slash = dir.find_last_of("/\\");
+  dir.erase(last_slash == std::string::npos ? 0 : last_slash + 1);
+
+  static const char kBase64Prefix[] = ";base64,";
+  const JsonValue* buffers = gltf->root.Find("buffers");
+  const size_t num_buffers = buffers == nullptr ? 0 : buffers->Size();
+  gltf->buffers.resize(num_buffers);
+  for (size_t i = 0; i < num_buffers; ++i) {
+    const JsonValue* uri = (*buffers)[i].Find("uri");
+    if (uri == nullptr) {
+      // The GLB BIN chunk backs the URI-less buffer.
+      gltf->buffers[i].swap(glb_bin);
+      continue;
+    }
+    const std::string& uri_text = uri->String();
+    if (uri_text.compare(0, 5, "data:") == 0) {
+      const size_t comma = uri_text.find(kBase64Prefix);
+      if (comma == std::string::npos ||
+          !DecodeBase64(uri_text.c_str() + comma + sizeof(kBase64Prefix) - 1,
+                        uri_text.size() - comma - sizeof(kBase64Prefix) + 1,
+                        &gltf->buffers[i])) {
+        log.Log(kLogError, "Buffer %d has an undecodable data: URI\n",
+                static_cast<int>(i));
+        return false;
+      }
+      continue;
+    }
+    const std::string buffer_file = dir + uri_text;
+    if (!ReadFileBytes(buffer_file.c_str(), &gltf->buffers[i], log)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Read accessor `accessor_index` as floats, one value per component per
+// element, normalizing quantized component types per the glTF
+// specification. Returns false, with an error logged, when the accessor
+// is missing, sparse, or out of its buffer's bounds.
+static bool ReadAccessorFloats(const GltfFile& gltf, int accessor_index,
+                               int* num_components, std::vector<float>* out,
+                               Logger& log) {
+  const JsonValue* accessors = gltf.root.Find("accessors");
+  const JsonValue* views = gltf.root.Find("bufferViews");
+  if (accessors == nullptr || accessor_index < 0 ||
+      static_cast<size_t>(accessor_index) >= accessors->Size()) {
+    log.Log(kLogError, "Accessor %d does not exist\n", accessor_index);
+    return false;
+  }
+  const JsonValue& accessor = (*accessors)[accessor_index];
+  if (accessor.Find("sparse") != nullptr) {
+    log.Log(kLogError, "Sparse accessors are not supported\n");
+    return false;
+  }
+
+  const JsonValue* type = accessor.Find("type");
+  int components = 0;
+  if (type != nullptr) {
+    if (type->String() == "SCALAR") components = 1;
+    else if (type->String() == "VEC3") components = 3;
+    else if (type->String() == "VEC4") components = 4;
+  }
+  const int component_type = accessor.IntField("componentType", 0);
+  int component_size = 0;
+  switch (component_type) {
+    case 5120: case 5121: component_size = 1; break;  // byte, ubyte
+    case 5122: case 5123: component_size = 2; break;  // short, ushort
+    case 5126: component_size = 4; break;             // float
+  }
+  if (components == 0 || component_size == 0) {
+    log.Log(kLogError, "Accessor %d has unsupported type\n", accessor_index);
+    return false;
+  }
+
+  const int count = accessor.IntField("count", 0);
+  const int view_index = accessor.IntField("bufferView", -1);
+  if (count <= 0 || views == nullptr || view_index < 0 ||
+      static_cast<size_t>(view_index) >= views->Size()) {
+    log.Log(kLogError, "Accessor %d has no data\n", accessor_index);
+    return false;
+  }
+  const JsonValue& view = (*views)[view_index];
+  const int buffer_index = view.IntField("buffer", -1);
+  if (buffer_index < 0 ||
+      static_cast<size_t>(buffer_index) >= gltf.buffers.size()) {
+    log.Log(kLogError, "Accessor %d references a missing buffer\n",
+            accessor_index);
+    return false;
+  }
+  const std::vector<uint8_t>& buffer = gltf.buffers[buffer_index];
+
+  const int element_size = components * component_size;
+  const int stride = view.IntField("byteStride", element_size);
+  const size_t offset = static_cast<size_t>(
+      view.IntField("byteOffset", 0) + accessor.IntField("byteOffset", 0));
+  if (offset + (count - 1) * static_cast<size_t>(stride) + element_size >
+      buffer.size()) {
+    log.Log(kLogError, "Accessor %d overruns its buffer\n", accessor_index);
+    return false;
+  }
+
+  out->resize(static_cast<size_t>(count) * components);
+  for (int i = 0; i < count; ++i) {
+    const uint8_t* element = &buffer[offset + i * stride];
+    for (int c = 0; c < components; ++c) {
+      const uint8_t* bytes = element + c * component_size;
+      float value = 0.0f;
+      switch (component_type) {
+        case 5126: memcpy(&value, bytes, sizeof(value)); break;
+        case 5120:  // Normalized signed byte.
+          value = std::max(static_cast<int8_t>(*bytes) / 127.0f, -1.0f);
+          break;
+        case 5121:  // Normalized unsigned byte.
+          value = *bytes / 255.0f;
+          break;
+        case 5122: {  // Normalized signed short.
+          int16_t raw;
+          memcpy(&raw, bytes, sizeof(raw));
+          value = std::max(raw / 32767.0f, -1.0f);
+          break;
+        }
+        case 5123: {  // Normalized unsigned short.
+          uint16_t raw;
+          memcpy(&raw, bytes, sizeof(raw));
+          value = raw / 65535.0f;
+          break;
+        }
+      }
+      (*out)[static_cast<size_t>(i) * components + c] = value;
+    }
+  }
+  *num_components = components;
+  return true;
+}
+
+// --------------------------- animation gather ---------------------------
+
+// One animation sampler, with its accessors read into float arrays.
+// For kCubicSpline, `values` holds three elements per key:
+// in-tangent, value, out-tangent.
+struct GltfSampler {
+  enum Interpolation { kLinear, kStep, kCubicSpline };
+
+  Interpolation interpolation;
+  int components;
+  std::vector<float> times;   // Key times, in seconds.
+  std::vector<float> values;  // components floats per key element.
+
+  GltfSampler() : interpolation(kLinear), components(0) {}
+
+  size_t NumKeys() const { return times.size(); }
+
+  // Value of `component` at key `k`.
+  float Value(size_t k, int component) const {
+    const size_t element = interpolation == kCubicSpline ? 3 * k + 1 : k;
+    return values[element * components + component];
+  }
+
+  // In/out tangent of `component` at key `k`, in units per second.
+  // Zero for non-cubic interpolations.
+  float InTangent(size_t k, int component) const {
+    return interpolation == kCubicSpline
+               ? values[(3 * k) * components + component]
+               : 0.0f;
+  }
+  float OutTangent(size_t k, int component) const {
+    return interpolation == kCubicSpline
+               ? values[(3 * k + 2) * components + component]
+               : 0.0f;
+  }
+};
+
+class GltfAnimParser {
+ public:
+  GltfAnimParser(const GltfFile& gltf, Logger& log)
+      : gltf_(gltf), log_(log) {}
+
+  bool GatherFlatAnim(bool no_uniform_scale, FlatAnim* out) {
+    const JsonValue* animations = gltf_.root.Find("animations");
+    nodes_ = gltf_.root.Find("nodes");
+    if (animations == nullptr || animations->Size() == 0 ||
+        nodes_ == nullptr || nodes_->Size() == 0) {
+      log_.Log(kLogError, "File contains no animation\n");
+      return false;
+    }
+    if (animations->Size() > 1) {
+      log_.Log(kLogWarning,
+               "File contains %d animations; only the first is converted\n",
+               static_cast<int>(animations->Size()));
+    }
+    animation_ = &(*animations)[0];
+
+    // Mark the nodes the animation targets, then extend the marks upward:
+    // a node matters if it or any descendant is animated, just as the FBX
+    // path only emits bones on the paths to animated nodes.
+    const size_t num_nodes = nodes_->Size();
+    relevant_.assign(num_nodes, false);
+    const JsonValue* channels = animation_->Find("channels");
+    const size_t num_channels = channels == nullptr ? 0 : channels->Size();
+    for (size_t i = 0; i < num_channels; ++i) {
+      const JsonValue* target = (*channels)[i].Find("target");
+      const int node = target == nullptr ? -1 : target->IntField("node", -1);
+      if (node >= 0 && static_cast<size_t>(node) < num_nodes) {
+        relevant_[node] = true;
+      }
+    }
+
+    // Roots are the nodes never referenced as a child; scene membership
+    // is irrelevant to the animation data.
+    std::vector<bool> is_child(num_nodes, false);
+    for (size_t i = 0; i < num_nodes; ++i) {
+      const JsonValue* children = (*nodes_)[i].Find("children");
+      const size_t num_children =
+          children == nullptr ? 0 : children->Size();
+      for (size_t c = 0; c < num_children; ++c) {
+        const int child = (*children)[c].Int(-1);
+        if (child >= 0 && static_cast<size_t>(child) < num_nodes) {
+          is_child[child] = true;
+        }
+      }
+    }
+    for (size_t i = 0; i < num_nodes; ++i) {
+      if (!is_child[i]) MarkRelevantRecursive(static_cast<int>(i));
+    }
+
+    bool any_bones = false;
+    for (size_t i = 0; i < num_nodes; ++i) {
+      any_bones = any_bones || relevant_[i];
+    }
+    if (!any_bones) {
+      log_.Log(kLogError, "Animation targets no nodes\n");
+      return false;
+    }
+
+    for (size_t i = 0; i < num_nodes; ++i) {
+      if (!is_child[i]) {
+        GatherBonesRecursive(static_cast<int>(i), -1, no_uniform_scale, out);
+      }
+    }
+    return true;
+  }
+
+ private:
+  // Set relevant_[node] if any node in its subtree is animated. Returns
+  // the resulting flag.
+  bool MarkRelevantRecursive(int node) {
+    bool relevant = relevant_[node];
+    const JsonValue* children = (*nodes_)[node].Find("children");
+    const size_t num_children = children == nullptr ? 0 : children->Size();
+    for (size_t c = 0; c < num_children; ++c) {
+      const int child = (*children)[c].Int(-1);
+      if (child >= 0 && static_cast<size_t>(child) < nodes_->Size()) {
+        relevant = MarkRelevantRecursive(child) || relevant;
+      }
+    }
+    relevant_[node] = relevant;
+    return relevant;
+  }
+
+  void GatherBonesRecursive(int node, int parent_bone, bool no_uniform_scale,
+                            FlatAnim* out) {
+    if (!relevant_[node]) return;
+
+    const JsonValue* name = (*nodes_)[node].Find("name");
+    char generated_name[16];
+    const char* bone_name = name != nullptr && !name->String().empty()
+                                ? name->String().c_str()
+                                : generated_name;
+    if (bone_name == generated_name) {
+      snprintf(generated_name, sizeof(generated_name), "node_%d", node);
+    }
+    log_.Log(kLogVerbose, "Node: %s\n", bone_name);
+
+    const int bone = static_cast<int>(out->AllocBone(bone_name, parent_bone));
+    out->SetCurBoneIndex(bone);
+    GatherChannelsForNode(node, out);
+    out->PruneChannels(no_uniform_scale);
+    out->ResetCurBoneIndex();
+
+    if (!out->ShouldRecurse(bone)) return;
+    const JsonValue* children = (*nodes_)[node].Find("children");
+    const size_t num_children = children == nullptr ? 0 : children->Size();
+    for (size_t c = 0; c < num_children; ++c) {
+      const int child = (*children)[c].Int(-1);
+      if (child >= 0 && static_cast<size_t>(child) < nodes_->Size()) {
+        GatherBonesRecursive(child, bone, no_uniform_scale, out);
+      }
+    }
+  }
+
+  // Read the sampler behind channel `channel` of the animation. Returns
+  // false, with errors logged, when its accessors cannot be read.
+  bool ReadSampler(const JsonValue& channel, GltfSampler* sampler) {
+    const JsonValue* samplers = animation_->Find("samplers");
+    const int sampler_index = channel.IntField("sampler", -1);
+    if (samplers == nullptr || sampler_index < 0 ||
+        static_cast<size_t>(sampler_index) >= samplers->Size()) {
+      log_.Log(kLogError, "Channel references a missing sampler\n");
+      return false;
+    }
+    const JsonValue& sampler_json = (*samplers)[sampler_index];
+
+    const JsonValue* interpolation = sampler_json.Find("interpolation");
+    sampler->interpolation = GltfSampler::kLinear;
+    if (interpolation != nullptr) {
+      if (interpolation->String() == "STEP") {
+        sampler->interpolation = GltfSampler::kStep;
+      } else if (interpolation->String() == "CUBICSPLINE") {
+        sampler->interpolation = GltfSampler::kCubicSpline;
+      }
+    }
+
+    int time_components = 0;
+    if (!ReadAccessorFloats(gltf_, sampler_json.IntField("input", -1),
+                            &time_components, &sampler->times, log_) ||
+        !ReadAccessorFloats(gltf_, sampler_json.IntField("output", -1),
+                            &sampler->components, &sampler->values, log_)) {
+      return false;
+    }
+    if (time_components != 1 || sampler->times.empty()) {
+      log_.Log(kLogError, "Sampler has invalid key times\n");
+      return false;
+    }
+    const size_t elements_per_key =
+        sampler->interpolation == GltfSampler::kCubicSpline ? 3 : 1;
+    if (sampler->values.size() != sampler->times.size() * elements_per_key *
+                                      sampler->components) {
+      log_.Log(kLogError, "Sampler key and value counts disagree\n");
+      return false;
+    }
+    return true;
+  }
+
+  void GatherChannelsForNode(int node, FlatAnim* out) {
+    const JsonValue* channels = animation_->Find("channels");
+    const size_t num_channels = channels == nullptr ? 0 : channels->Size();
+    bool have_path[3] = {false, false, false};  // translation, rotation,
+                                                // scale; first one wins.
+    for (size_t i = 0; i < num_channels; ++i) {
+      const JsonValue& channel = (*channels)[i];
+      const JsonValue* target = channel.Find("target");
+      if (target == nullptr || target->IntField("node", -1) != node) continue;
+
+      const JsonValue* path = target->Find("path");
+      const std::string& path_text =
+          path == nullptr ? std::string() : path->String();
+      int path_index;
+      if (path_text == "translation") path_index = 0;
+      else if (path_text == "rotation") path_index = 1;
+      else if (path_text == "scale") path_index = 2;
+      else {
+        log_.Log(kLogWarning, "Skipping unsupported channel path '%s'\n",
+                 path_text.c_str());
+        continue;
+      }
+      if (have_path[path_index]) {
+        log_.Log(kLogWarning, "Duplicate %s channel; using the first one\n",
+                 path_text.c_str());
+        continue;
+      }
+
+      GltfSampler sampler;
+      if (!ReadSampler(channel, &sampler)) continue;
+      have_path[path_index] = true;
+
+      if (path_index == 1) {
+        GatherRotation(&sampler, out);
+      } else {
+        GatherVec3(sampler, path_index == 0 ? kTranslateX : kScaleX,
+                   path_index == 0 ? kGltfTranslateBaseId : kGltfScaleBaseId,
+                   out);
+      }
+    }
+  }
+
+  // True if every key of `component` stays within `tolerance` of the first
+  // key, with near-zero tangents; such channels collapse to a constant.
+  static bool ComponentConst(const GltfSampler& sampler, int component,
+                             float tolerance) {
+    const float first = sampler.Value(0, component);
+    for (size_t k = 0; k < sampler.NumKeys(); ++k) {
+      if (fabs(sampler.Value(k, component) - first) > tolerance) return false;
+      if (fabs(sampler.InTangent(k, component)) > tolerance ||
+          fabs(sampler.OutTangent(k, component)) > tolerance) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Emit the three components of a translation or scale sampler, skipping
+  // constant-default components and collapsing constant ones, exactly as
+  // the FBX path does.
+  void GatherVec3(const GltfSampler& sampler, MatrixOperationType base_op,
+                  MatrixOpId base_id, FlatAnim* out) {
+    if (sampler.components != 3) {
+      log_.Log(kLogError, "%s sampler is not VEC3\n", MatrixOpName(base_op));
+      return;
+    }
+    for (int c = 0; c < 3; ++c) {
+      const MatrixOperationType op =
+          static_cast<MatrixOperationType>(base_op + c);
+      const float tolerance = out->ToleranceForOp(op);
+      const bool is_const =
+          sampler.NumKeys() < 2 || ComponentConst(sampler, c, tolerance);
+      const float first_value = sampler.Value(0, c);
+      if (is_const && out->IsDefaultValue(op, first_value)) continue;
+
+      const FlatChannelId channel_id =
+          out->AllocChannel(op, static_cast<MatrixOpId>(base_id + c));
+      if (is_const) {
+        log_.Log(kLogVerbose, "  [channel %d] %s: constant %f\n", channel_id,
+                 MatrixOpName(op), first_value);
+        out->AddConstant(channel_id, first_value);
+        continue;
+      }
+      log_.Log(kLogVerbose, "  [channel %d] %s: curve\n", channel_id,
+               MatrixOpName(op));
+      GatherComponentCurve(sampler, c, channel_id, out);
+    }
+  }
+
+  // Emit the rotation sampler as a (w, x, y, z) quaternion channel run.
+  // The runtime consumes the run as one rotation, so when any component
+  // animates, every component gets a channel, constant or not; see
+  // MatrixOperation::ApplyOps(). A rotation that is constant identity is
+  // dropped entirely.
+  void GatherRotation(GltfSampler* sampler, FlatAnim* out) {
+    if (sampler->components != 4) {
+      log_.Log(kLogError, "Rotation sampler is not VEC4\n");
+      return;
+    }
+
+    // Keep consecutive keys in the same hemisphere so the component curves
+    // stay continuous; q and -q describe the same rotation. Tangents flip
+    // with their key's values.
+    std::vector<float>& values = sampler->values;
+    const size_t elements_per_key =
+        sampler->interpolation == GltfSampler::kCubicSpline ? 3 : 1;
+    float prev[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (size_t k = 0; k < sampler->NumKeys(); ++k) {
+      float* key = &values[k * elements_per_key * 4];
+      const float* q = key + (elements_per_key == 3 ? 4 : 0);
+      const float dot = q[0] * prev[0] + q[1] * prev[1] + q[2] * prev[2] +
+                        q[3] * prev[3];
+      if (k > 0 && dot < 0.0f) {
+        for (size_t i = 0; i < elements_per_key * 4; ++i) key[i] = -key[i];
+      }
+      memcpy(prev, key + (elements_per_key == 3 ? 4 : 0), sizeof(prev));
+    }
+
+    const float tolerance = out->ToleranceForOp(kQuaternionW);
+    bool all_const_identity = true;
+    for (int c = 0; c < 4 && all_const_identity; ++c) {
+      const MatrixOperationType op =
+          static_cast<MatrixOperationType>(kQuaternionW + c);
+      // glTF component order is (x, y, z, w); ours leads with w.
+      const int gltf_c = (c + 3) % 4;
+      all_const_identity =
+          (sampler->NumKeys() < 2 ||
+           ComponentConst(*sampler, gltf_c, tolerance)) &&
+          out->IsDefaultValue(op, sampler->Value(0, gltf_c));
+    }
+    if (all_const_identity) return;
+
+    for (int c = 0; c < 4; ++c) {
+      const MatrixOperationType op =
+          static_cast<MatrixOperationType>(kQuaternionW + c);
+      const int gltf_c = (c + 3) % 4;
+      const FlatChannelId channel_id = out->AllocChannel(
+          op, static_cast<MatrixOpId>(kGltfQuaternionBaseId + c));
+      if (sampler->NumKeys() < 2 ||
+          ComponentConst(*sampler, gltf_c, tolerance)) {
+        log_.Log(kLogVerbose, "  [channel %d] %s: constant %f\n", channel_id,
+                 MatrixOpName(op), sampler->Value(0, gltf_c));
+        out->AddConstant(channel_id, sampler->Value(0, gltf_c));
+        continue;
+      }
+      log_.Log(kLogVerbose, "  [channel %d] %s: quaternion curve\n",
+               channel_id, MatrixOpName(op));
+      GatherComponentCurve(*sampler, gltf_c, channel_id, out);
+    }
+  }
+
+  // Feed one component of `sampler` to AddCurve(), key interval by key
+  // interval, then prune the redundant nodes.
+  //
+  // LINEAR intervals become straight segments; for rotations this is
+  // per-component (nlerp-style) interpolation, which stays within the
+  // rotate tolerance at the key densities exporters emit. STEP holds each
+  // key's value and ramps to the next over the final millisecond of the
+  // interval, since spline nodes cannot be vertically discontinuous.
+  // CUBICSPLINE intervals are Hermite segments, sampled so AddCurve() can
+  // verify its cubics against the authored curve.
+  void GatherComponentCurve(const GltfSampler& sampler, int component,
+                            FlatChannelId channel_id, FlatAnim* out) const {
+    for (size_t k = 0; k + 1 < sampler.NumKeys(); ++k) {
+      const FlatTime t0 = GltfToFlatTime(sampler.times[k]);
+      const FlatTime t1 = GltfToFlatTime(sampler.times[k + 1]);
+      if (t1 <= t0) continue;
+      const float v0 = sampler.Value(k, component);
+      const float v1 = sampler.Value(k + 1, component);
+
+      switch (sampler.interpolation) {
+        case GltfSampler::kLinear: {
+          const float slope = (v1 - v0) / static_cast<float>(t1 - t0);
+          const float vals[2] = {v0, v1};
+          const float derivatives[2] = {slope, slope};
+          out->AddCurve(channel_id, t0, t1, vals, derivatives, 2);
+          break;
+        }
+        case GltfSampler::kStep: {
+          const FlatTime hold_end = std::max(t1 - 1, t0);
+          if (hold_end > t0) {
+            const float vals[2] = {v0, v0};
+            const float derivatives[2] = {0.0f, 0.0f};
+            out->AddCurve(channel_id, t0, hold_end, vals, derivatives, 2);
+          }
+          const float ramp = (v1 - v0) / static_cast<float>(t1 - hold_end);
+          const float vals[2] = {v0, v1};
+          const float derivatives[2] = {ramp, ramp};
+          out->AddCurve(channel_id, hold_end, t1, vals, derivatives, 2);
+          break;
+        }
+        case GltfSampler::kCubicSpline: {
+          // Hermite basis over the interval, with the spec's per-second
+          // tangents scaled by the interval length.
+          const float dt = sampler.times[k + 1] - sampler.times[k];
+          const float m0 = sampler.OutTangent(k, component) * dt;
+          const float m1 = sampler.InTangent(k + 1, component) * dt;
+          float vals[kGltfCubicSamples];
+          float derivatives[kGltfCubicSamples];
+          for (int s = 0; s < kGltfCubicSamples; ++s) {
+            const float u =
+                static_cast<float>(s) / (kGltfCubicSamples - 1);
+            const float u2 = u * u;
+            const float u3 = u2 * u;
+            vals[s] = (2.0f * u3 - 3.0f * u2 + 1.0f) * v0 +
+                      (u3 - 2.0f * u2 + u) * m0 +
+                      (-2.0f * u3 + 3.0f * u2) * v1 + (u3 - u2) * m1;
+            const float d_du = (6.0f * u2 - 6.0f * u) * v0 +
+                               (3.0f * u2 - 4.0f * u + 1.0f) * m0 +
+                               (-6.0f * u2 + 6.0f * u) * v1 +
+                               (3.0f * u2 - 2.0f * u) * m1;
+            derivatives[s] = GltfToFlatDerivative(d_du / dt);
+          }
+          out->AddCurve(channel_id, t0, t1, vals, derivatives,
+                        kGltfCubicSamples);
+          break;
+        }
+      }
+    }
+    out->PruneNodes(channel_id);
+    out->LogChannel(channel_id);
+  }
+
+  const GltfFile& gltf_;
+  const JsonValue* nodes_;
+  const JsonValue* animation_;
+
+  // True for nodes that are animated or have an animated descendant; only
+  // these become bones.
+  std::vector<bool> relevant_;
+
+  Logger& log_;
+};
+
+// Case-insensitive comparison; strcasecmp() is not portable to Windows.
+static bool EqualsIgnoreCase(const char* a, const char* b) {
+  for (; *a != '\0' && *b != '\0'; ++a, ++b) {
+    if (tolower(*a) != tolower(*b)) return false;
+  }
+  return *a == *b;
+}
+
+bool IsGltfFile(const char* file_name) {
+  const char* dot = strrchr(file_name, '.');
+  if (dot == nullptr) return false;
+  return EqualsIgnoreCase(dot, ".gltf") || EqualsIgnoreCase(dot, ".glb");
+}
+
+bool GatherGltfAnim(const char* file_name, bool no_uniform_scale,
+                    FlatAnim* out, Logger& log) {
+  GltfFile gltf;
+  if (!LoadGltfFile(file_name, &gltf, log)) return false;
+
+  GltfAnimParser parser(gltf, log);
+  return parser.GatherFlatAnim(no_uniform_scale, out);
+}
+
+}  // namespace motive
@@ -0,0 +1,46 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_GLTF_PARSER_H_
+#define MOTIVE_GLTF_PARSER_H_
+
+#include "anim_pipeline.h"
+
+namespace motive {
+
+class FlatAnim;
+
+// Returns true if `file_name` ends in .gltf or .glb, ignoring case.
+// Such files are converted by GatherGltfAnim() instead of the FBX SDK.
+bool IsGltfFile(const char* file_name);
+
+// Parse the glTF 2.0 file `file_name`--JSON .gltf with external or embedded
+// buffers, or binary .glb--and gather its first animation into `out`, the
+// same intermediate the FBX path fills. The importer has no external
+// dependencies, so conversion of glTF content runs anywhere the pipeline
+// compiles, without the FBX SDK installed.
+//
+// glTF stores rotations as quaternions, so rotation channels are always
+// emitted as the quaternion operations, as if --quaternions were passed.
+// Morph-target weight channels are not representable as matrix operations
+// and are skipped with a warning.
+//
+// Returns false, with errors logged, if the file cannot be read or parsed
+// or contains no animation.
+bool GatherGltfAnim(const char* file_name, bool no_uniform_scale,
+                    FlatAnim* out, fplutil::Logger& log);
+
+}  // namespace motive
+
+#endif  // MOTIVE_GLTF_PARSER_H_
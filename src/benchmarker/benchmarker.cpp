@@ -13,6 +13,10 @@
 // limitations under the License.
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
 #include <vector>
 #include "motive/common.h"
 #include "motive/engine.h"
@@ -21,6 +25,7 @@
 #include "motive/math/compact_spline.h"
 #include "motive/init.h"
 #include "motive/util/benchmark.h"
+#include "motive/util/capture.h"
 
 using motive::CompactSpline;
 using motive::CubicCurve;
@@ -43,6 +48,93 @@ static const SplineInit kRotateInit(kAngleRange);
 static const SplineInit kTranslateInit;
 static const int kNumBenchmarkIds = 10;
 
+// Default regression threshold when comparing against a baseline, as a
+// percentage of the baseline's ns/index. Frame times on a loaded machine
+// jitter a few percent run-to-run; anything past this is a real change.
+static const double kDefaultThresholdPercent = 5.0;
+
+static const char kCommandLineUsage[] =
+    "Usage: motivebenchmarker [-o RESULTS.csv] [-b BASELINE.csv]\n"
+    "                         [-t THRESHOLD_PERCENT] [CAPTURE_FILE]\n"
+    "\n"
+    "Runs the synthetic matrix scenario, or replays CAPTURE_FILE if given.\n"
+    "\n"
+    "Options:\n"
+    "  -o, --out        Write machine-readable results to this csv file:\n"
+    "                   one `scenario,indices,ns_per_index,p99_ns_per_index`\n"
+    "                   row per scenario.\n"
+    "  -b, --baseline   Compare against a results file from a previous run\n"
+    "                   and report per-scenario deltas. Exits non-zero if\n"
+    "                   any scenario's ns/index regressed past the\n"
+    "                   threshold, so one command answers whether a build\n"
+    "                   is safe to roll out.\n"
+    "  -t, --threshold  Regression threshold, in percent. Default 5.\n"
+    "\n";
+
+// Command line arguments.
+struct BenchmarkerArgs {
+  BenchmarkerArgs() : threshold_percent(kDefaultThresholdPercent) {}
+
+  std::string capture_file;
+  std::string out_file;
+  std::string baseline_file;
+  double threshold_percent;
+};
+
+// Measured cost of one scenario, normalized per live index so results are
+// comparable across scenarios of different sizes.
+struct ScenarioResult {
+  ScenarioResult() : num_indices(0), ns_per_index(0.0), p99_ns_per_index(0.0) {}
+
+  std::string name;
+  int num_indices;
+  double ns_per_index;
+  double p99_ns_per_index;
+};
+
+// Accumulates one timing sample per AdvanceFrame() call and reduces them
+// to mean and 99th-percentile ns/index. The index count is supplied at
+// Result() time since replayed captures grow their index count as they run.
+class ScenarioTimer {
+ public:
+  explicit ScenarioTimer(const char* name) : name_(name) {}
+
+  void BeginFrame() { frame_start_ = std::chrono::steady_clock::now(); }
+
+  void EndFrame() {
+    samples_.push_back(std::chrono::duration<double, std::nano>(
+                           std::chrono::steady_clock::now() - frame_start_)
+                           .count());
+  }
+
+  ScenarioResult Result(int num_indices) const {
+    ScenarioResult r;
+    r.name = name_;
+    r.num_indices = num_indices;
+    if (samples_.empty() || num_indices <= 0) return r;
+
+    double total = 0.0;
+    for (size_t i = 0; i < samples_.size(); ++i) {
+      total += samples_[i];
+    }
+    r.ns_per_index = total / (samples_.size() * num_indices);
+
+    // p99: the cost the worst 1% of frames pay. Regressions that only hit
+    // occasional frames (cache misses, defragmentation spikes) show up
+    // here long before they move the mean.
+    std::vector<double> sorted(samples_);
+    const size_t p99_index = (sorted.size() * 99) / 100;
+    std::nth_element(sorted.begin(), sorted.begin() + p99_index, sorted.end());
+    r.p99_ns_per_index = sorted[p99_index] / num_indices;
+    return r;
+  }
+
+ private:
+  std::string name_;
+  std::vector<double> samples_;
+  std::chrono::steady_clock::time_point frame_start_;
+};
+
 struct SplineNode {
   float x;
   float y;
@@ -128,18 +220,28 @@ class MotiveBenchmarker {
     }
   }
 
-  void Run() {
+  ScenarioResult Run() {
+    ScenarioTimer timer("matrix_synthetic");
     for (int i = 0; i < kNumReports; ++i) {
       // Advance the engine many times, gathering benchmark information on
       // each iteration.
       for (int j = 0; j < kNumIterationsPerReport; ++j) {
+        timer.BeginFrame();
         engine_.AdvanceFrame(1);
+        timer.EndFrame();
       }
 
       // Output benchmark statistics and empty the stats counter.
       motive::OutputBenchmarks();
       motive::ClearBenchmarks();
     }
+    return timer.Result(NumLiveIndices(engine_));
+  }
+
+  static int NumLiveIndices(const MotiveEngine& engine) {
+    const motive::MotiveMemoryStats stats = engine.MemoryStats();
+    const motive::MotiveIndex live = stats.num_indices - stats.unused_indices;
+    return live > 0 ? live : 1;
   }
 
  private:
@@ -165,9 +267,205 @@ class MotiveBenchmarker {
   MatrixMotivator4f matrices_[kNumMatrices];
 };
 
-int main() {
+// Re-execute a workload captured with motive::StartMotiveCapture(), so that
+// optimizations can be measured against a real scene's call stream rather
+// than the synthetic scenario above. Prints the same benchmark statistics.
+static int Replay(const std::string& file_name, ScenarioResult* result) {
+  SplineInit::Register();
+
+  motive::MotiveCaptureReplay replay;
+  if (!replay.Load(file_name.c_str())) {
+    printf("Failed to load capture '%s'.\n", file_name.c_str());
+    return 1;
+  }
+  printf("Replaying %d frames from '%s'.\n", replay.NumFrames(),
+         file_name.c_str());
+
+  // Name the scenario after the capture file, minus directories, so
+  // results from the same capture match up across runs and machines.
+  const size_t last_slash = file_name.find_last_of("/\\");
+  const std::string scenario_name = last_slash == std::string::npos
+                                        ? file_name
+                                        : file_name.substr(last_slash + 1);
+
+  MotiveEngine engine;
+  ScenarioTimer timer(scenario_name.c_str());
+  timer.BeginFrame();
+  bool more = replay.AdvanceFrame(&engine);
+  timer.EndFrame();
+  while (more) {
+    timer.BeginFrame();
+    more = replay.AdvanceFrame(&engine);
+    timer.EndFrame();
+  }
+  motive::OutputBenchmarks();
+  *result = timer.Result(MotiveBenchmarker::NumLiveIndices(engine));
+  return 0;
+}
+
+// Write one csv row per scenario. The format is the same one
+// LoadResults() reads, so today's `-o` file is tomorrow's `-b` baseline.
+static bool WriteResults(const std::string& file_name,
+                         const std::vector<ScenarioResult>& results) {
+  FILE* f = fopen(file_name.c_str(), "w");
+  if (f == nullptr) {
+    printf("ERROR: Could not open results file '%s'.\n", file_name.c_str());
+    return false;
+  }
+  fprintf(f, "scenario,indices,ns_per_index,p99_ns_per_index\n");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ScenarioResult& r = results[i];
+    fprintf(f, "%s,%d,%.3f,%.3f\n", r.name.c_str(), r.num_indices,
+            r.ns_per_index, r.p99_ns_per_index);
+  }
+  fclose(f);
+  printf("Wrote results to '%s'.\n", file_name.c_str());
+  return true;
+}
+
+static bool LoadResults(const std::string& file_name,
+                        std::vector<ScenarioResult>* results) {
+  FILE* f = fopen(file_name.c_str(), "r");
+  if (f == nullptr) {
+    printf("ERROR: Could not open baseline file '%s'.\n", file_name.c_str());
+    return false;
+  }
+  char line[512];
+  while (fgets(line, sizeof(line), f) != nullptr) {
+    char name[256];
+    ScenarioResult r;
+    const int fields =
+        sscanf(line, "%255[^,],%d,%lf,%lf", name, &r.num_indices,
+               &r.ns_per_index, &r.p99_ns_per_index);
+    // Skips the header row, which doesn't parse.
+    if (fields != 4) continue;
+    r.name = name;
+    results->push_back(r);
+  }
+  fclose(f);
+  return true;
+}
+
+// Report per-scenario deltas against `baselines` and return the number of
+// scenarios whose mean ns/index regressed past `threshold_percent`.
+static int CompareToBaseline(const std::vector<ScenarioResult>& results,
+                             const std::vector<ScenarioResult>& baselines,
+                             double threshold_percent) {
+  int num_regressed = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ScenarioResult& r = results[i];
+
+    const ScenarioResult* baseline = nullptr;
+    for (size_t j = 0; j < baselines.size(); ++j) {
+      if (baselines[j].name == r.name) {
+        baseline = &baselines[j];
+        break;
+      }
+    }
+    if (baseline == nullptr || baseline->ns_per_index <= 0.0) {
+      printf("%s: no baseline entry; skipping comparison.\n", r.name.c_str());
+      continue;
+    }
+
+    const double delta_percent =
+        100.0 * (r.ns_per_index - baseline->ns_per_index) /
+        baseline->ns_per_index;
+    const double p99_delta_percent =
+        baseline->p99_ns_per_index > 0.0
+            ? 100.0 * (r.p99_ns_per_index - baseline->p99_ns_per_index) /
+                  baseline->p99_ns_per_index
+            : 0.0;
+    const bool regressed = delta_percent > threshold_percent;
+    printf("%s: %.3f ns/index vs baseline %.3f (%+.1f%%),"
+           " p99 %.3f vs %.3f (%+.1f%%) -- %s\n",
+           r.name.c_str(), r.ns_per_index, baseline->ns_per_index,
+           delta_percent, r.p99_ns_per_index, baseline->p99_ns_per_index,
+           p99_delta_percent, regressed ? "REGRESSED" : "ok");
+    if (regressed) ++num_regressed;
+  }
+  return num_regressed;
+}
+
+static bool ParseCommandLine(int argc, char** argv, BenchmarkerArgs* args) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+
+    if (option == "-o" || option == "--out" || option == "-b" ||
+        option == "--baseline" || option == "-t" || option == "--threshold") {
+      if (i + 1 >= argc) {
+        printf("ERROR: Must specify a value for option %s\n\n",
+               option.c_str());
+        return false;
+      }
+      const std::string option_value = argv[++i];
+
+      if (option == "-o" || option == "--out") {
+        args->out_file = option_value;
+      } else if (option == "-b" || option == "--baseline") {
+        args->baseline_file = option_value;
+      } else {
+        args->threshold_percent = atof(option_value.c_str());
+        if (args->threshold_percent <= 0.0) {
+          printf("ERROR: Invalid threshold %s.\n\n", option_value.c_str());
+          return false;
+        }
+      }
+      continue;
+    }
+
+    if (option[0] == '-') {
+      printf("ERROR: Unknown option %s\n\n", option.c_str());
+      return false;
+    }
+
+    args->capture_file = option;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  BenchmarkerArgs args;
+  if (!ParseCommandLine(argc, argv, &args)) {
+    printf(kCommandLineUsage);
+    return 1;
+  }
+
   motive::InitBenchmarks(kNumBenchmarkIds);
-  MotiveBenchmarker benchmarker;
-  benchmarker.Run();
+
+  // With a capture file as argument, replay it instead of the synthetic
+  // scenario.
+  std::vector<ScenarioResult> results;
+  if (!args.capture_file.empty()) {
+    ScenarioResult result;
+    const int replay_status = Replay(args.capture_file, &result);
+    if (replay_status != 0) return replay_status;
+    results.push_back(result);
+  } else {
+    MotiveBenchmarker benchmarker;
+    results.push_back(benchmarker.Run());
+  }
+
+  for (size_t i = 0; i < results.size(); ++i) {
+    const ScenarioResult& r = results[i];
+    printf("%s: %d indices, %.3f ns/index, p99 %.3f ns/index\n",
+           r.name.c_str(), r.num_indices, r.ns_per_index, r.p99_ns_per_index);
+  }
+
+  if (!args.out_file.empty() && !WriteResults(args.out_file, results)) {
+    return 1;
+  }
+
+  if (!args.baseline_file.empty()) {
+    std::vector<ScenarioResult> baselines;
+    if (!LoadResults(args.baseline_file, &baselines)) return 1;
+    const int num_regressed =
+        CompareToBaseline(results, baselines, args.threshold_percent);
+    if (num_regressed > 0) {
+      printf("%d scenario(s) regressed more than %.1f%%.\n", num_regressed,
+             args.threshold_percent);
+      return 1;
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,346 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Microbenchmark suite for Motive's hot paths, built on Google Benchmark.
+//
+// Unlike the benchmarker target--which runs one large scenario and prints
+// histograms from Motive's own instrumentation--each case here isolates one
+// subsystem and is parameterized over the sizes that matter to it, so a
+// regression points at the code that caused it.
+//
+// To compare two builds, run each with
+//     microbench --benchmark_format=json --benchmark_out=<build>.json
+// and diff the JSON (the Google Benchmark repo ships tools/compare.py for
+// this). Use --benchmark_repetitions=N for stable timing on noisy machines,
+// and, when the benchmark library is built with libpfm,
+// --benchmark_perf_counters=CYCLES,INSTRUCTIONS to record hardware counters
+// per case.
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "anim_generated.h"
+#include "anim_list_generated.h"
+#include "benchmark/benchmark.h"
+#include "motive/anim_table.h"
+#include "motive/common.h"
+#include "motive/engine.h"
+#include "motive/math/angle.h"
+#include "motive/math/bulk_spline_evaluator.h"
+#include "motive/math/compact_spline.h"
+#include "motive/matrix_anim.h"
+#include "motive/matrix_init.h"
+#include "motive/rig_anim.h"
+#include "motive/rig_init.h"
+#include "motive/rig_motivator.h"
+#include "motive/spline_init.h"
+#include "motive/vector_motivator.h"
+
+using motive::AnimTable;
+using motive::BoneIndex;
+using motive::BulkSplineEvaluator;
+using motive::CompactSpline;
+using motive::kAngleRange;
+using motive::kInvalidBoneIdx;
+using motive::kPi;
+using motive::kTwoPi;
+using motive::MatrixAnim;
+using motive::MotiveEngine;
+using motive::Motivator1f;
+using motive::Range;
+using motive::RigAnim;
+using motive::RigInit;
+using motive::RigMotivator;
+using motive::SplineInit;
+using motive::SplinePlayback;
+using motive::Target1f;
+
+struct SplineNode {
+  float x;
+  float y;
+  float derivative;
+};
+
+// One period of a sine wave, and a straight line covering the same domain.
+// The line exercises the evaluator's cheap path (long segments, few
+// re-initializations); the sine wave forces frequent segment crossings.
+static const SplineNode kSinWave[] = {{0.0f, 0.0f, 1.0f},
+                                      {0.5f * kPi, 1.0f, 0.0f},
+                                      {kPi, 0.0f, -1.0f},
+                                      {1.5f * kPi, -1.0f, 0.0f},
+                                      {kTwoPi, 0.0f, 1.0f}};
+
+static const SplineNode kStraightLine[] = {{0.0f, 0.0f, 1.0f},
+                                           {1.0f, 1.0f, 1.0f}};
+
+static const float kSplinePeriod = 2000.0f;
+
+// Take an array of SplineNodes (x, y, derivative) values and scale them
+// to fill `spline`. Same construction as the benchmarker target, so the
+// two measure comparable curves.
+static void CreateSpline(const SplineNode* nodes, size_t num_nodes,
+                         float x_scale, float y_scale, CompactSpline* spline) {
+  float min = std::numeric_limits<float>::infinity();
+  float max = -std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i < num_nodes; ++i) {
+    min = std::min(nodes[i].y, min);
+    max = std::max(nodes[i].y, max);
+  }
+
+  spline->Init(
+      Range(y_scale * min, y_scale * max),
+      CompactSpline::RecommendXGranularity(x_scale * nodes[num_nodes - 1].x));
+  for (size_t i = 0; i < num_nodes; ++i) {
+    const SplineNode& n = nodes[i];
+    spline->AddNode(n.x * x_scale, n.y * y_scale, n.derivative / x_scale);
+  }
+}
+
+// ---- BulkSplineEvaluator::AdvanceFrame ----
+// The innermost loop of every spline-driven motivator. Parameterized over
+// index count (SIMD batch efficiency, cache footprint) and spline shape.
+
+static void BM_BulkSplineEvaluatorAdvance(benchmark::State& state) {
+  const int num_indices = static_cast<int>(state.range(0));
+  const bool curved = state.range(1) != 0;
+
+  CompactSpline spline;
+  if (curved) {
+    CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave), kSplinePeriod, 1.0f,
+                 &spline);
+  } else {
+    CreateSpline(kStraightLine, MOTIVE_ARRAY_SIZE(kStraightLine),
+                 kSplinePeriod, 1.0f, &spline);
+  }
+
+  BulkSplineEvaluator evaluator;
+  evaluator.SetNumIndices(num_indices);
+  const SplinePlayback playback(0.0f, true);
+  for (int i = 0; i < num_indices; ++i) {
+    evaluator.SetSplines(i, 1, &spline, playback);
+  }
+
+  while (state.KeepRunning()) {
+    evaluator.AdvanceFrame(1.0f);
+    benchmark::DoNotOptimize(evaluator.Y(0));
+  }
+  state.SetItemsProcessed(state.iterations() * num_indices);
+}
+BENCHMARK(BM_BulkSplineEvaluatorAdvance)
+    ->Args({64, 0})
+    ->Args({64, 1})
+    ->Args({512, 0})
+    ->Args({512, 1})
+    ->Args({4096, 0})
+    ->Args({4096, 1})
+    ->Args({16384, 0})
+    ->Args({16384, 1});
+
+// ---- Spline processor retarget storm ----
+// Every motivator gets a new target each iteration, the worst case for
+// gameplay code that re-aims ease-in curves every frame. Measures target
+// curve construction and spline (re)initialization, not steady-state
+// evaluation; the frame advance between storms is excluded from timing.
+
+static void BM_SplineProcessorSetTargets(benchmark::State& state) {
+  const int num_motivators = static_cast<int>(state.range(0));
+
+  MotiveEngine engine;
+  const SplineInit init;
+  std::vector<Motivator1f> motivators(num_motivators);
+  for (int i = 0; i < num_motivators; ++i) {
+    motivators[i].Initialize(init, &engine);
+    motivators[i].SetTarget(Target1f(0.0f, 0.0f, 1));
+  }
+  engine.AdvanceFrame(1);
+
+  float target = 1.0f;
+  while (state.KeepRunning()) {
+    for (int i = 0; i < num_motivators; ++i) {
+      motivators[i].SetTarget(Target1f(target, 0.0f, 1000));
+    }
+    state.PauseTiming();
+    engine.AdvanceFrame(1);
+    target = -target;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * num_motivators);
+}
+BENCHMARK(BM_SplineProcessorSetTargets)->Arg(64)->Arg(1024)->Arg(8192);
+
+// ---- Rig processor ----
+// Full skeletal update: spline evaluation for every op, matrix composition
+// per bone, and the global-transform hierarchy walk. Parameterized over
+// bone count; rig count is fixed so cases are comparable per bone.
+
+static void CreateBenchRigAnim(int num_bones, RigAnim* anim) {
+  anim->Init("bench_rig", static_cast<BoneIndex>(num_bones), false);
+  for (int i = 0; i < num_bones; ++i) {
+    const BoneIndex bone = static_cast<BoneIndex>(i);
+    const BoneIndex parent =
+        i == 0 ? kInvalidBoneIdx : static_cast<BoneIndex>(i - 1);
+    MatrixAnim& m = anim->InitMatrixAnim(bone, parent, "");
+    MatrixAnim::Spline* splines = m.Construct(1);
+    splines[0].spline = CompactSpline::Create(CompactSpline::kDefaultMaxNodes);
+    CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave), kSplinePeriod, 1.0f,
+                 splines[0].spline);
+    splines[0].init = SplineInit(kAngleRange);
+    m.ops().emplace_back(motive::MatrixOpId(0), motive::kRotateAboutY,
+                         splines[0].init, *splines[0].spline);
+  }
+  anim->set_end_time(static_cast<motive::MotiveTime>(kSplinePeriod));
+  anim->set_repeat(true);
+  anim->PackOps();
+}
+
+static void BM_RigProcessorAdvance(benchmark::State& state) {
+  static const int kNumRigs = 64;
+  const int num_bones = static_cast<int>(state.range(0));
+
+  RigAnim anim;
+  CreateBenchRigAnim(num_bones, &anim);
+  const RigInit init(anim, anim.bone_parents(),
+                     static_cast<BoneIndex>(num_bones));
+
+  MotiveEngine engine;
+  std::vector<RigMotivator> rigs(kNumRigs);
+  const SplinePlayback playback(0.0f, true);
+  for (int i = 0; i < kNumRigs; ++i) {
+    rigs[i].Initialize(init, &engine);
+    rigs[i].BlendToAnim(anim, playback);
+  }
+
+  while (state.KeepRunning()) {
+    engine.AdvanceFrame(1);
+    benchmark::DoNotOptimize(rigs[0].GlobalTransforms());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumRigs * num_bones);
+}
+BENCHMARK(BM_RigProcessorAdvance)->Arg(8)->Arg(32)->Arg(128);
+
+// ---- AnimTable lookups ----
+// One table of kNumTableAnims single-bone animations, built in memory so
+// the benchmark needs no data files. Compares the lookup paths: indexed
+// (the fast path), cached handle, name hash, and string name.
+
+static const int kNumTableAnims = 256;
+
+static const char* FailLoadFn(const char* /*file_name*/,
+                              std::string* /*scratch_buf*/) {
+  return nullptr;  // Every animation is embedded; nothing is loaded by name.
+}
+
+struct AnimTableBench {
+  AnimTable table;
+  std::vector<std::string> names;
+  std::vector<uint64_t> hashes;
+  std::vector<AnimTable::AnimHandle> handles;
+};
+
+static const AnimTableBench& BenchAnimTable() {
+  static AnimTableBench* bench = nullptr;
+  if (bench != nullptr) return *bench;
+  bench = new AnimTableBench();
+
+  flatbuffers::FlatBufferBuilder fbb;
+  std::vector<flatbuffers::Offset<motive::AnimSource>> sources;
+  for (int i = 0; i < kNumTableAnims; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "bench_anim_%04d", i);
+    bench->names.push_back(name);
+
+    // A one-bone animation with a single constant op: the smallest valid
+    // RigAnimFb. Lookup cost doesn't depend on animation size.
+    const auto value = motive::CreateConstantOpFb(fbb, 1.0f);
+    const auto op = motive::CreateMatrixOpFb(
+        fbb, 0, motive::MatrixOperationTypeFb_kTranslateX,
+        motive::MatrixOpValueFb_ConstantOpFb, value.Union());
+    const auto matrix_anim = motive::CreateMatrixAnimFb(
+        fbb, fbb.CreateVector(&op, 1));
+    const uint8_t root_parent = kInvalidBoneIdx;
+    const auto rig = motive::CreateRigAnimFb(
+        fbb, fbb.CreateVector(&matrix_anim, 1),
+        fbb.CreateVector(&root_parent, 1), 0, true, fbb.CreateString(name));
+    const auto embedded = motive::CreateAnimSourceEmbedded(fbb, rig);
+    sources.push_back(motive::CreateAnimSource(
+        fbb, motive::AnimSourceUnion_AnimSourceEmbedded, embedded.Union()));
+  }
+  const auto list = motive::CreateAnimListFb(fbb, 0, fbb.CreateVector(sources));
+  fbb.Finish(list);
+
+  const motive::AnimListFb* list_fb =
+      flatbuffers::GetRoot<motive::AnimListFb>(fbb.GetBufferPointer());
+  const bool ok = bench->table.InitFromFlatBuffers(*list_fb, FailLoadFn);
+  assert(ok);
+  (void)ok;
+
+  for (int i = 0; i < kNumTableAnims; ++i) {
+    bench->hashes.push_back(AnimTable::HashAnimName(bench->names[i].c_str()));
+    bench->handles.push_back(bench->table.Handle(bench->names[i].c_str()));
+  }
+  return *bench;
+}
+
+static void BM_AnimTableQueryByIndex(benchmark::State& state) {
+  const AnimTableBench& bench = BenchAnimTable();
+  int i = 0;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(bench.table.Query(0, i));
+    i = (i + 1) % kNumTableAnims;
+  }
+}
+BENCHMARK(BM_AnimTableQueryByIndex);
+
+static void BM_AnimTableQueryByHandle(benchmark::State& state) {
+  const AnimTableBench& bench = BenchAnimTable();
+  int i = 0;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(bench.table.Query(bench.handles[i]));
+    i = (i + 1) % kNumTableAnims;
+  }
+}
+BENCHMARK(BM_AnimTableQueryByHandle);
+
+static void BM_AnimTableQueryByHash(benchmark::State& state) {
+  const AnimTableBench& bench = BenchAnimTable();
+  int i = 0;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(bench.table.QueryByHash(bench.hashes[i]));
+    i = (i + 1) % kNumTableAnims;
+  }
+}
+BENCHMARK(BM_AnimTableQueryByHash);
+
+static void BM_AnimTableQueryByName(benchmark::State& state) {
+  const AnimTableBench& bench = BenchAnimTable();
+  int i = 0;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(bench.table.QueryByName(bench.names[i].c_str()));
+    i = (i + 1) % kNumTableAnims;
+  }
+}
+BENCHMARK(BM_AnimTableQueryByName);
+
+int main(int argc, char** argv) {
+  // Register the processors the engine-level benchmarks instantiate.
+  motive::SplineInit::Register();
+  motive::MatrixInit::Register();
+  motive::RigInit::Register();
+
+  ::benchmark::Initialize(&argc, argv);
+  if (::benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  ::benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
@@ -11,11 +11,13 @@
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
+#include <limits>
 #include <map>
 
 #include "anim_generated.h"
 #include "anim_table_generated.h"
 #include "motive/anim_table.h"
+#include "motive/io/baked_anim.h"
 #include "motive/io/flatbuffers.h"
 
 namespace motive {
@@ -162,7 +164,37 @@ class ListFileNamesDescriber : public TableDescriberInterface {
   const AnimTable::ListFileNames* list_names_;
 };
 
+// static
+uint64_t AnimTable::HashAnimName(const char* anim_name) {
+  // 64-bit FNV-1a. Stable everywhere--no dependence on platform, endianness,
+  // or the standard library--so hashes baked into content at build time
+  // match the ones computed here at load time.
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (const char* p = anim_name; *p != '\0'; ++p) {
+    hash = (hash ^ static_cast<uint64_t>(static_cast<uint8_t>(*p))) *
+           0x100000001b3ull;
+  }
+  return hash;
+}
+
+AnimTable::AnimTable()
+    : streaming_(false),
+      buffer_verification_(kTrustBuffers),
+      hash_fn_(nullptr),
+      strip_debug_names_(false),
+      baked_read_fn_(nullptr),
+      baked_write_fn_(nullptr),
+      baked_build_id_(0),
+      stream_load_fn_(nullptr),
+      play_counter_(0),
+      memory_budget_(0),
+      resident_bytes_(0),
+      num_never_loaded_(0),
+      defining_anims_ready_(false),
+      quit_loader_(false) {}
+
 AnimTable::~AnimTable() {
+  StopLoaderThread();
   for (size_t i = 0; i < anims_.size(); ++i) {
     delete anims_[i];
     anims_[i] = nullptr;
@@ -193,6 +225,68 @@ bool AnimTable::InitFromAnimFileNames(const ListFileNames& list_names,
   return Load(&describer, load_fn);
 }
 
+bool AnimTable::InitStreamingFromAnimFileNames(const TableFileNames& table_names,
+                                               LoadFn* load_fn) {
+  TableFileNamesDescriber describer(table_names);
+  return LoadStreaming(&describer, load_fn);
+}
+
+bool AnimTable::InitStreamingFromAnimFileNames(const ListFileNames& list_names,
+                                               LoadFn* load_fn) {
+  ListFileNamesDescriber describer(list_names);
+  return LoadStreaming(&describer, load_fn);
+}
+
+const RigAnimFb* AnimTable::VerifiedRigAnimFb(
+    const char* anim_buf, const std::string& scratch_buf,
+    const char* file_name) const {
+  if (anim_buf == nullptr) return nullptr;
+  // The buffer length is only known when the load function returned its
+  // data through `scratch_buf`; buffers from other memory cannot be measured
+  // and are trusted, as documented on SetBufferVerification().
+  if (buffer_verification_ != kTrustBuffers &&
+      anim_buf == scratch_buf.c_str()) {
+    const uint64_t pre_verified_hash =
+        buffer_verification_ == kVerifyByHash && hash_fn_ != nullptr
+            ? hash_fn_(file_name)
+            : 0;
+    if (!VerifyAnimBuffer(anim_buf, scratch_buf.length(), pre_verified_hash))
+      return nullptr;
+  }
+  return GetRigAnimFb(anim_buf);
+}
+
+// Produce the built RigAnim for the animation file `file_name`: from the
+// baked cache when one is set and holds a current image, and by loading and
+// converting the FlatBuffer otherwise--re-baking the result so the next run
+// hits the cache. Returns nullptr when the load or verification fails.
+RigAnim* AnimTable::LoadAndConvertAnim(const char* file_name, LoadFn* load_fn,
+                                       std::string* scratch_buf) const {
+  if (baked_read_fn_ != nullptr && baked_read_fn_(file_name, scratch_buf)) {
+    RigAnim* anim = new RigAnim();
+    if (InitRigAnimFromBaked(scratch_buf->data(), scratch_buf->size(),
+                             baked_build_id_, strip_debug_names_, anim)) {
+      return anim;
+    }
+    // Stale or truncated image; rebuild it from the source below.
+    delete anim;
+  }
+
+  const char* anim_buf = load_fn(file_name, scratch_buf);
+  const RigAnimFb* anim_fb =
+      VerifiedRigAnimFb(anim_buf, *scratch_buf, file_name);
+  if (anim_fb == nullptr) return nullptr;
+
+  RigAnim* anim = new RigAnim();
+  RigAnimFromFlatBuffers(*anim_fb, anim, strip_debug_names_);
+  if (baked_write_fn_ != nullptr) {
+    std::string baked;
+    BakeRigAnim(*anim, baked_build_id_, &baked);
+    baked_write_fn_(file_name, baked.data(), baked.size());
+  }
+  return anim;
+}
+
 bool AnimTable::Load(TableDescriberInterface* describer, LoadFn* load_fn) {
   std::string scratch_buf;
   bool success = true;
@@ -223,32 +317,50 @@ bool AnimTable::Load(TableDescriberInterface* describer, LoadFn* load_fn) {
       if (anim_name == nullptr || anim_name[0] == '\0') continue;
 
       // Case 2: source data has already been processed.
-      auto existing = name_map_.find(anim_name);
-      if (existing != name_map_.end()) {
-        list[anim_idx] = existing->second;
+      const AnimIndex existing = FindRegisteredName(anim_name);
+      if (existing != kInvalidAnimIndex) {
+        list[anim_idx] = existing;
         continue;
       }
 
-      // Case 3: load source data.
+      // Case 3: load source data. File-sourced animations go through the
+      // baked cache, when one is set; embedded ones convert in place.
+      RigAnim* anim;
       if (anim_fb == nullptr) {
-        const char* anim_buf = load_fn(anim_name, &scratch_buf);
-        anim_fb = anim_buf == nullptr ? nullptr : GetRigAnimFb(anim_buf);
+        anim = LoadAndConvertAnim(anim_name, load_fn, &scratch_buf);
 
-        // Error loading file. Keep loading but return false.
-        if (anim_fb == nullptr) {
+        // Error loading or verifying file. Keep loading but return false.
+        if (anim == nullptr) {
           success = false;
           continue;
         }
+      } else {
+        anim = new RigAnim();
+        RigAnimFromFlatBuffers(*anim_fb, anim, strip_debug_names_);
       }
 
-      // Create RigAnim from FlatBuffer.
-      const AnimIndex new_idx = static_cast<AnimIndex>(anims_.size());
-      RigAnim* anim = new RigAnim();
-      RigAnimFromFlatBuffers(*anim_fb, anim);
-      anims_.push_back(anim);
+      // Case 4: an identical payload was already loaded under another name.
+      // Clips are often exported once per character, so the same idle can
+      // arrive under many names; sharing one immutable RigAnim recovers
+      // that memory. Every name still gets its own map entries, so all
+      // lookups keep working; they just resolve to the shared animation,
+      // whose anim_name() is the name it was first loaded under.
+      const uint64_t content_hash = anim->ContentHash();
+      const auto duplicate = content_map_.find(content_hash);
+      AnimIndex new_idx;
+      if (duplicate != content_map_.end()) {
+        delete anim;
+        new_idx = duplicate->second;
+      } else {
+        new_idx = static_cast<AnimIndex>(anims_.size());
+        anims_.push_back(anim);
+        content_map_.insert(HashToIndex(content_hash, new_idx));
+      }
+
+      // Register the name so that we only load this anim once, and so that
+      // by-name and by-hash queries resolve to it.
+      RegisterAnimName(anim_name, new_idx);
 
-      // Insert index into name map so that we only load this anim once.
-      name_map_.insert(NameToIndex(anim_name, new_idx));
       list[anim_idx] = new_idx;
     }
   }
@@ -256,9 +368,284 @@ bool AnimTable::Load(TableDescriberInterface* describer, LoadFn* load_fn) {
   // Now that all animations have been loaded, calculate defining animation,
   // which is the union of all the animations on an object.
   CalculateDefiningAnims();
+  defining_anims_ready_ = true;
   return success;
 }
 
+bool AnimTable::LoadStreaming(TableDescriberInterface* describer,
+                              LoadFn* load_fn) {
+  streaming_ = true;
+  stream_load_fn_ = load_fn;
+
+  // Build the object/anim_idx table and the name indices from the source
+  // names alone. No files are read here.
+  const int num_objects = describer->NumObjects();
+  indices_.resize(num_objects);
+  defining_anims_.resize(num_objects);
+  for (int object = 0; object < num_objects; ++object) {
+    const int num_anims = describer->NumAnims(object);
+    indices_[object].resize(num_anims);
+
+    AnimList& list = indices_[object];
+    for (int anim_idx = 0; anim_idx < num_anims; ++anim_idx) {
+      list[anim_idx] = kInvalidAnimIndex;
+
+      const RigAnimFb* anim_fb = describer->SourceRigAnimFb(object, anim_idx);
+      const char* anim_name = anim_fb != nullptr
+                                  ? anim_fb->name()->c_str()
+                                  : describer->SourceFileName(object, anim_idx);
+
+      // Case 1: source data is empty.
+      if (anim_name == nullptr || anim_name[0] == '\0') continue;
+
+      // Case 2: source data has already been registered.
+      const AnimIndex existing = FindRegisteredName(anim_name);
+      if (existing != kInvalidAnimIndex) {
+        list[anim_idx] = existing;
+        continue;
+      }
+
+      // Case 3: register the source. Embedded animations are converted
+      // eagerly--they're already in memory--and are never evicted, since
+      // there is no file to restore them from. File-backed animations get
+      // an empty slot that the loader thread fills in.
+      const AnimIndex new_idx = static_cast<AnimIndex>(anims_.size());
+      if (anim_fb != nullptr) {
+        RigAnim* anim = new RigAnim();
+        RigAnimFromFlatBuffers(*anim_fb, anim, strip_debug_names_);
+        anims_.push_back(anim);
+        anim_file_names_.push_back(std::string());
+      } else {
+        anims_.push_back(nullptr);
+        anim_file_names_.push_back(anim_name);
+      }
+
+      RegisterAnimName(anim_name, new_idx);
+      list[anim_idx] = new_idx;
+    }
+  }
+
+  // Per-animation streaming bookkeeping.
+  const size_t num_unique = anims_.size();
+  anim_states_.assign(num_unique, kAnimUnloaded);
+  anim_bytes_.assign(num_unique, 0);
+  last_play_.assign(num_unique, 0);
+  pin_counts_.assign(num_unique, 0);
+  never_loaded_.assign(num_unique, 1);
+  num_never_loaded_ = 0;
+  for (size_t i = 0; i < num_unique; ++i) {
+    if (anims_[i] != nullptr) {
+      anim_states_[i] = kAnimResident;
+      anim_bytes_[i] = anims_[i]->ApproxSizeBytes();
+      resident_bytes_ += anim_bytes_[i];
+      never_loaded_[i] = 0;
+    } else {
+      ++num_never_loaded_;
+    }
+  }
+
+  // Everything was embedded; nothing to stream.
+  if (num_never_loaded_ == 0) {
+    CalculateDefiningAnims();
+    defining_anims_ready_ = true;
+    return true;
+  }
+
+  // Queue the whole table, in order, and let the loader thread work through
+  // it. On-demand queries jump to the front of this queue.
+  for (size_t i = 0; i < num_unique; ++i) {
+    if (anim_states_[i] != kAnimUnloaded) continue;
+    anim_states_[i] = kAnimQueued;
+    load_queue_.push_back(static_cast<AnimIndex>(i));
+  }
+  quit_loader_ = false;
+  loader_thread_ = std::thread(&AnimTable::LoaderThread, this);
+  return true;
+}
+
+const RigAnim* AnimTable::QueryStreaming(AnimIndex idx, int object) {
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  last_play_[idx] = ++play_counter_;
+
+  switch (anim_states_[idx]) {
+    case kAnimResident:
+      return anims_[idx];
+    case kAnimUnloaded:
+    case kAnimQueued:
+      // Request it (again), at the front of the queue.
+      EnqueueFrontLocked(idx);
+      break;
+    case kAnimLoading:
+      break;
+  }
+
+  // Placeholder until the payload lands: the object's defining animation,
+  // which covers the object's full rig. By-name and by-handle queries carry
+  // no object, so they get nullptr.
+  return object >= 0 && defining_anims_ready_ ? &defining_anims_[object]
+                                              : nullptr;
+}
+
+void AnimTable::LoaderThread() {
+  std::string scratch_buf;
+  std::unique_lock<std::mutex> lock(stream_mutex_);
+  for (;;) {
+    while (!quit_loader_ && load_queue_.empty()) {
+      stream_request_.wait(lock);
+    }
+    if (quit_loader_) return;
+
+    const AnimIndex idx = load_queue_.front();
+    load_queue_.pop_front();
+    if (anim_states_[idx] != kAnimQueued) continue;
+    anim_states_[idx] = kAnimLoading;
+    const std::string file_name = anim_file_names_[idx];
+
+    // Read, verify, and convert the file with the lock released, so queries
+    // never wait on I/O. Verifying here, per animation, means tables in
+    // kVerifyBuffers mode only pay verification for animations that are
+    // actually streamed in.
+    lock.unlock();
+    RigAnim* anim =
+        LoadAndConvertAnim(file_name.c_str(), stream_load_fn_, &scratch_buf);
+    lock.lock();
+
+    if (anim != nullptr) {
+      anims_[idx] = anim;
+      anim_states_[idx] = kAnimResident;
+      anim_bytes_[idx] = anim->ApproxSizeBytes();
+      resident_bytes_ += anim_bytes_[idx];
+    } else {
+      // Load failed. Drop back to unloaded so a later query can retry.
+      anim_states_[idx] = kAnimUnloaded;
+    }
+
+    // Count down to the end of the initial stream, even on failure, so that
+    // a missing file degrades the defining animations instead of deferring
+    // them forever. This mirrors eager Load(), which also keeps going.
+    if (never_loaded_[idx] != 0) {
+      never_loaded_[idx] = 0;
+      if (--num_never_loaded_ == 0) {
+        CalculateDefiningAnims();
+        defining_anims_ready_ = true;
+      }
+    }
+
+    // The budget is enforced only once the defining animations have been
+    // computed, since computing them needs every animation resident.
+    EvictOverBudgetLocked();
+    stream_complete_.notify_all();
+  }
+}
+
+void AnimTable::EnqueueFrontLocked(AnimIndex idx) {
+  if (anim_states_[idx] == kAnimQueued) {
+    // Already waiting; jump the queue.
+    for (auto it = load_queue_.begin(); it != load_queue_.end(); ++it) {
+      if (*it == idx) {
+        load_queue_.erase(it);
+        break;
+      }
+    }
+  } else {
+    anim_states_[idx] = kAnimQueued;
+  }
+  load_queue_.push_front(idx);
+  stream_request_.notify_one();
+}
+
+void AnimTable::EvictOverBudgetLocked() {
+  if (memory_budget_ == 0 || !defining_anims_ready_) return;
+  while (resident_bytes_ > memory_budget_) {
+    // Evict the least-recently-played resident animation. Pinned and
+    // embedded animations are skipped; the latter have no file to stream
+    // back from.
+    AnimIndex victim = kInvalidAnimIndex;
+    uint64_t oldest_play = std::numeric_limits<uint64_t>::max();
+    for (size_t i = 0; i < anims_.size(); ++i) {
+      if (anim_states_[i] != kAnimResident) continue;
+      if (pin_counts_[i] > 0 || anim_file_names_[i].empty()) continue;
+      if (last_play_[i] < oldest_play) {
+        oldest_play = last_play_[i];
+        victim = static_cast<AnimIndex>(i);
+      }
+    }
+    if (victim == kInvalidAnimIndex) return;
+
+    delete anims_[victim];
+    anims_[victim] = nullptr;
+    anim_states_[victim] = kAnimUnloaded;
+    resident_bytes_ -= anim_bytes_[victim];
+    anim_bytes_[victim] = 0;
+  }
+}
+
+void AnimTable::StopLoaderThread() {
+  if (!loader_thread_.joinable()) return;
+  {
+    std::lock_guard<std::mutex> lock(stream_mutex_);
+    quit_loader_ = true;
+  }
+  stream_request_.notify_all();
+  loader_thread_.join();
+}
+
+void AnimTable::SetMemoryBudget(size_t bytes) {
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  memory_budget_ = bytes;
+  EvictOverBudgetLocked();
+}
+
+void AnimTable::Pin(AnimHandle handle) {
+  if (handle == kInvalidAnimHandle || !streaming_) return;
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  ++pin_counts_[handle];
+}
+
+void AnimTable::Unpin(AnimHandle handle) {
+  if (handle == kInvalidAnimHandle || !streaming_) return;
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  assert(pin_counts_[handle] > 0);
+  --pin_counts_[handle];
+  EvictOverBudgetLocked();
+}
+
+bool AnimTable::IsLoaded(AnimHandle handle) const {
+  if (handle == kInvalidAnimHandle) return false;
+  if (!streaming_) return true;
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  return anim_states_[handle] == kAnimResident;
+}
+
+void AnimTable::BlockUntilLoaded(AnimHandle handle) {
+  if (handle == kInvalidAnimHandle || !streaming_) return;
+  std::unique_lock<std::mutex> lock(stream_mutex_);
+  last_play_[handle] = ++play_counter_;
+  if (anim_states_[handle] == kAnimUnloaded ||
+      anim_states_[handle] == kAnimQueued) {
+    EnqueueFrontLocked(handle);
+  }
+  while (anim_states_[handle] != kAnimResident) {
+    stream_complete_.wait(lock);
+    // A failed load drops back to unloaded; report rather than retry
+    // forever, in case the file is permanently missing.
+    if (anim_states_[handle] == kAnimUnloaded) return;
+  }
+}
+
+void AnimTable::BlockUntilAllLoaded() {
+  if (!streaming_) return;
+  std::unique_lock<std::mutex> lock(stream_mutex_);
+  while (num_never_loaded_ > 0) {
+    stream_complete_.wait(lock);
+  }
+}
+
+bool AnimTable::DefiningAnimsReady() const {
+  std::lock_guard<std::mutex> lock(stream_mutex_);
+  return defining_anims_ready_;
+}
+
 static const RigAnim* FindCompleteRig(const RigAnim** anims, size_t num_anims) {
   // We assume that that animation with the most bones has all the bones.
   // Not necessarily true, since all animations could animate a subset of the
@@ -274,12 +661,12 @@ static const RigAnim* FindCompleteRig(const RigAnim** anims, size_t num_anims) {
 }
 
 static void CreateDefiningAnim(const RigAnim** anims, size_t num_anims,
-                               RigAnim* defining_anim) {
+                               RigAnim* defining_anim, bool record_names) {
   // Get the bone hierarchy that covers all the hierarchies in `anims`.
   const RigAnim* complete_rig = FindCompleteRig(anims, num_anims);
   const BoneIndex num_bones = complete_rig->NumBones();
   const BoneIndex* parents = complete_rig->bone_parents();
-  defining_anim->Init("defining_anim", num_bones, true);
+  defining_anim->Init("defining_anim", num_bones, record_names);
 
   // For each bone, consider adding each operation in the canonical operations.
   for (BoneIndex j = 0; j < num_bones; ++j) {
@@ -348,6 +735,9 @@ static void CreateDefiningAnim(const RigAnim** anims, size_t num_anims,
       }
     }
   }
+
+  // The ops are final now, so pack them for sequential iteration.
+  defining_anim->PackOps();
 }
 
 size_t AnimTable::MaxAnimIndex() const {
@@ -374,7 +764,8 @@ void AnimTable::CalculateDefiningAnims() {
     const size_t num_anims = GatherObjectAnims(object, &anims[0]);
     if (num_anims == 0) continue;
 
-    CreateDefiningAnim(&anims[0], num_anims, &defining_anims_[object]);
+    CreateDefiningAnim(&anims[0], num_anims, &defining_anims_[object],
+                       !strip_debug_names_);
   }
 }
 
@@ -0,0 +1,149 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "motive/baked_clip.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "motive/math/compact_spline.h"
+#include "motive/rig_anim.h"
+
+namespace motive {
+
+void BakedClip::Bake(const RigAnim& anim, MotiveTime sample_period) {
+  assert(sample_period > 0);
+  const BoneIndex num_bones = anim.NumBones();
+  bone_parents_.assign(anim.bone_parents(), anim.bone_parents() + num_bones);
+  repeat_ = anim.repeat();
+  sample_period_ = sample_period;
+
+  // Gather every channel of every bone. Spline-driven channels are noted for
+  // the batched sampling pass below; everything else has a constant value for
+  // the whole clip.
+  op_types_.clear();
+  bone_starts_.resize(num_bones + 1);
+  std::vector<const CompactSpline*> splines;
+  std::vector<int> spline_channels;
+  std::vector<float> const_values;
+  float end_x = 0.0f;
+  for (BoneIndex i = 0; i < num_bones; ++i) {
+    bone_starts_[i] = NumChannels();
+    int num_ops = 0;
+    const MatrixOperationInit* ops = anim.BoneOps(i, &num_ops);
+    for (int j = 0; j < num_ops; ++j) {
+      const MatrixOperationInit& op = ops[j];
+      op_types_.push_back(static_cast<uint8_t>(op.type));
+      if (op.union_type == MatrixOperationInit::kUnionSpline) {
+        splines.push_back(op.spline);
+        spline_channels.push_back(NumChannels() - 1);
+        const_values.push_back(0.0f);
+        end_x = std::max(end_x, op.spline->EndX());
+      } else {
+        const float y = op.union_type == MatrixOperationInit::kUnionInitialValue
+                            ? op.initial_value
+                            : OperationDefaultValue(op.type);
+        const_values.push_back(y);
+      }
+    }
+  }
+  bone_starts_[num_bones] = NumChannels();
+
+  // Round the frame count up so the last frame is at or past the end of the
+  // longest spline. Splines clamp to their end value past EndX(), so the
+  // overshoot is harmless. An all-constant anim still gets two frames to
+  // keep the lerp in EvalLocalTransforms() branch-free.
+  clip_length_ =
+      std::max(static_cast<MotiveTime>(std::ceil(end_x)), sample_period);
+  num_frames_ =
+      static_cast<int>((clip_length_ + sample_period - 1) / sample_period) + 1;
+
+  // Replicate the constant channels into every frame. Spline channels are
+  // overwritten below.
+  const int num_channels = NumChannels();
+  values_.resize(static_cast<size_t>(num_frames_) * num_channels);
+  for (int f = 0; f < num_frames_; ++f) {
+    std::copy(const_values.begin(), const_values.end(),
+              values_.begin() + static_cast<size_t>(f) * num_channels);
+  }
+
+  // Sample all splines in one batched pass. BakeYs() writes channel-major,
+  // so transpose each channel's run into the frames-major values_ layout.
+  if (!splines.empty()) {
+    std::vector<float> baked(splines.size() * num_frames_);
+    CompactSpline::BakeYs(splines.data(), splines.size(), 0.0f,
+                          static_cast<float>(sample_period), num_frames_,
+                          baked.data(), 1, num_frames_);
+    for (size_t s = 0; s < splines.size(); ++s) {
+      const float* src = &baked[s * num_frames_];
+      float* dst = &values_[spline_channels[s]];
+      for (int f = 0; f < num_frames_; ++f) {
+        dst[static_cast<size_t>(f) * num_channels] = src[f];
+      }
+    }
+  }
+}
+
+void BakedClip::EvalLocalTransforms(MotiveTime time, mathfu::mat4* out) const {
+  assert(num_frames_ >= 2);
+
+  // Wrap repeating clips; clamp one-shot clips to their final pose.
+  if (repeat_) {
+    time %= clip_length_;
+    if (time < 0) time += clip_length_;
+  } else {
+    time = std::min(std::max<MotiveTime>(time, 0), clip_length_);
+  }
+
+  // The frame count guarantees (num_frames_ - 1) * sample_period_ covers
+  // clip_length_, so after clamping f0 the lerp parameter stays in [0, 1].
+  const int f0 = std::min(static_cast<int>(time / sample_period_),
+                          num_frames_ - 2);
+  const float t = static_cast<float>(time - f0 * sample_period_) /
+                  static_cast<float>(sample_period_);
+  const int num_channels = NumChannels();
+  const float* frame0 = &values_[static_cast<size_t>(f0) * num_channels];
+  const float* frame1 = frame0 + num_channels;
+
+  const BoneIndex num_bones = NumBones();
+  for (BoneIndex i = 0; i < num_bones; ++i) {
+    mathfu::vec4 c0 = mathfu::kAxisX4f;
+    mathfu::vec4 c1 = mathfu::kAxisY4f;
+    mathfu::vec4 c2 = mathfu::kAxisZ4f;
+    mathfu::vec4 c3 = mathfu::kAxisW4f;
+    const int end = bone_starts_[i + 1];
+    for (int c = bone_starts_[i]; c < end; ++c) {
+      const float value = frame0[c] + t * (frame1[c] - frame0[c]);
+      const MatrixOperationType type =
+          static_cast<MatrixOperationType>(op_types_[c]);
+      if (type == kQuaternionW) {
+        // Component-wise lerped quaternions are renormalized inside
+        // ApplyQuaternionValues(), so this is an nlerp between the two
+        // baked rotations.
+        assert(c + 3 < end);
+        MatrixOperation::ApplyQuaternionValues(
+            value, frame0[c + 1] + t * (frame1[c + 1] - frame0[c + 1]),
+            frame0[c + 2] + t * (frame1[c + 2] - frame0[c + 2]),
+            frame0[c + 3] + t * (frame1[c + 3] - frame0[c + 3]), &c0, &c1, &c2,
+            &c3);
+        c += 3;
+        continue;
+      }
+      MatrixOperation::ApplyOpValue(type, value, &c0, &c1, &c2, &c3);
+    }
+    out[i] = mathfu::mat4(c0, c1, c2, c3);
+  }
+}
+
+}  // namespace motive
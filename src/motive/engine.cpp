@@ -12,40 +12,104 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
 #include "motive/engine.h"
+#include "motive/motivator.h"
 #include "motive/processor.h"
+#include "motive/rig_anim.h"
+#include "motive/vector_motivator.h"
 #include "motive/version.h"
 #include "motive/util/benchmark.h"
+#include "motive/util/capture.h"
+#include "motive/util/command_queue.h"
+#include "motive/util/job_system.h"
 
 namespace motive {
 
 // static
-MotiveEngine::FunctionMap MotiveEngine::function_map_;
+MotiveEngine::FactoryEntry MotiveEngine::function_registry_[kMaxProcessorTypes];
+
+// static
+std::atomic<int> MotiveEngine::function_registry_count_(0);
 
 // static
 void MotiveEngine::RegisterProcessorFactory(
     MotivatorType type, const MotiveProcessorFunctions& fns) {
-  function_map_.insert(FunctionPair(type, fns));
+  // Registering a type twice is a no-op, as it was when the registry was a
+  // map. Two threads racing to register the *same* type can each claim a
+  // slot; lookups return the first published one, so this only wastes a slot.
+  if (LookupProcessorFactory(type) != nullptr) return;
+
+  // Claim a slot. Concurrent registrations of different types each get
+  // their own, so no lock is needed.
+  const int slot =
+      function_registry_count_.fetch_add(1, std::memory_order_relaxed);
+  assert(slot < kMaxProcessorTypes);
+
+  // Fill the slot, then publish it. The release-store of `type` pairs with
+  // the acquire-load in LookupProcessorFactory(): a lookup that sees `type`
+  // is guaranteed to see `fns` too.
+  FactoryEntry& entry = function_registry_[slot];
+  entry.fns = fns;
+  entry.type.store(type, std::memory_order_release);
+}
+
+// static
+const MotiveProcessorFunctions* MotiveEngine::LookupProcessorFactory(
+    MotivatorType type) {
+  // The registry is append-only and entries never change once published, so
+  // scanning while another thread registers is safe. A slot that has been
+  // claimed but not yet published reads as kMotivatorTypeInvalid, which
+  // matches no real type.
+  const int count = std::min(
+      function_registry_count_.load(std::memory_order_relaxed),
+      static_cast<int>(kMaxProcessorTypes));
+  for (int i = 0; i < count; ++i) {
+    if (function_registry_[i].type.load(std::memory_order_acquire) == type) {
+      return &function_registry_[i].fns;
+    }
+  }
+  return nullptr;
 }
 
 // Prevent the version string from being stripped from the binary by keeping
 // a reference to it here.
-MotiveEngine::MotiveEngine() : version_(&Version()) {}
+MotiveEngine::MotiveEngine()
+    : job_system_(nullptr),
+      command_queue_(nullptr),
+      frame_snapshots_(false),
+      deterministic_(false),
+      capacities_locked_(false),
+      frame_number_(0),
+      completion_fn_(nullptr),
+      completion_userdata_(nullptr),
+      crossing_fn_(nullptr),
+      crossing_userdata_(nullptr),
+      value_delta_fn_(nullptr),
+      value_delta_epsilon_(0.0f),
+      value_delta_userdata_(nullptr),
+      version_(&Version()) {}
 
 void MotiveEngine::Reset() {
   for (ProcessorMap::iterator it = mapped_processors_.begin();
        it != mapped_processors_.end(); ++it) {
     // Get the factory for each processor. Factory must exist since it is what
     // created the processor in the first place.
-    const MotiveProcessorFunctions& fns = function_map_.find(it->first)->second;
+    const MotiveProcessorFunctions* fns = LookupProcessorFactory(it->first);
+    assert(fns != nullptr);
 
     // Destroy each processor in turn.
-    fns.destroy(it->second);
+    fns->destroy(it->second);
     it->second = nullptr;
   }
 
   // Remove all elements from the map. Their processors have all been destroyed.
   mapped_processors_.clear();
+  schedule_states_.clear();
 }
 
 MotiveProcessor* MotiveEngine::Processor(MotivatorType type) {
@@ -54,15 +118,20 @@ MotiveProcessor* MotiveEngine::Processor(MotivatorType type) {
   if (it != mapped_processors_.end()) return it->second;
 
   // Look up the processor-creation-function in the registry.
-  const auto function_pair = function_map_.find(type);
-  if (function_pair == function_map_.end()) return nullptr;
-  const MotiveProcessorFunctions& fns = function_pair->second;
+  const MotiveProcessorFunctions* fns = LookupProcessorFactory(type);
+  if (fns == nullptr) return nullptr;
 
   // Remember processor for next time. We only want at most one processor per
   // type in an engine
   ProcessorDetails details;
-  details.processor = fns.create();
+  details.processor = fns->create();
   details.processor->RegisterBenchmarks();
+  details.processor->SetFrameSnapshots(frame_snapshots_);
+  details.processor->SetDeterministic(deterministic_);
+  details.processor->SetCapacityLocked(capacities_locked_);
+  details.processor->SetTrackCompletions(completion_fn_ != nullptr);
+  details.processor->SetTrackValueDeltas(value_delta_fn_ != nullptr,
+                                         value_delta_epsilon_);
   mapped_processors_.insert(ProcessorPair(type, details.processor));
   sorted_processors_.insert(details);
 
@@ -70,17 +139,715 @@ MotiveProcessor* MotiveEngine::Processor(MotivatorType type) {
 }
 
 void MotiveEngine::AdvanceFrame(MotiveTime delta_time) {
-  // Advance the simulation in each processor.
-  // TODO: At some point, we'll want to do several passes. An item in
-  // processor A might depend on the output of an item in processor B,
-  // which might in turn depend on the output of a *different* item in
-  // processor A. In this case, we have to do two passes. For now, just
-  // assume that one pass is sufficient.
+  if (detail::capture_active) detail::CaptureAdvanceFrame(delta_time);
+
+  // Determines which update-rate tiers step this frame. Shared by the serial
+  // and parallel paths, so tiers stay in phase across processors either way.
+  ++frame_number_;
+
+  // Last frame's transients--parallel job records and any per-frame scratch
+  // processors took from the arena--are reclaimed wholesale here.
+  frame_arena_.Reset();
+
+  // Apply mutations queued by worker threads since the last frame, before
+  // any processor advances.
+  if (command_queue_ != nullptr) ApplyCommands();
+
+  // Submit independent processors to the job system, when one has been set.
+  if (job_system_ != nullptr) {
+    AdvanceFrameParallel(delta_time);
+    return;
+  }
+
+  AdvanceFramePasses(delta_time);
+
+  PublishFrameSnapshots();
+  NotifyCompletions();
+  NotifyCrossings();
+  NotifyValueDeltas();
+}
+
+void MotiveEngine::AdvanceFramePasses(MotiveTime delta_time) {
+  // Advance the simulation in each processor, pass by pass. Within a pass,
+  // processors run in priority order; indices assigned to a later pass via
+  // AddDependency() advance only after every processor finishes the
+  // earlier passes, so dependencies that run against the priority order--
+  // an item in processor A reading an item in processor B that reads a
+  // *different* item in processor A--see current-frame values. Most frames
+  // need a single pass.
+  int num_passes = 1;
   for (ProcessorSet::iterator it = sorted_processors_.begin();
        it != sorted_processors_.end(); ++it) {
-    const motive::Benchmark b(it->processor->benchmark_id_for_advance_frame());
-    it->processor->AdvanceFrame(delta_time);
+    num_passes = std::max(num_passes, it->processor->MaxAdvancePass() + 1);
+  }
+  for (int pass = 0; pass < num_passes; ++pass) {
+    for (ProcessorSet::iterator it = sorted_processors_.begin();
+         it != sorted_processors_.end(); ++it) {
+      const motive::Benchmark b(
+          it->processor->benchmark_id_for_advance_frame());
+      it->processor->AdvanceFramePass(delta_time, pass, frame_number_);
+    }
   }
 }
 
+void MotiveEngine::AdvanceFrames(MotiveTime delta_time, int num_frames) {
+  if (num_frames <= 0) return;
+
+  // Record each tick individually, so that a replay that re-issues
+  // AdvanceFrame() per record reproduces the same frame boundaries.
+  if (detail::capture_active) {
+    for (int frame = 0; frame < num_frames; ++frame) {
+      detail::CaptureAdvanceFrame(delta_time);
+    }
+  }
+
+  frame_arena_.Reset();
+  if (command_queue_ != nullptr) ApplyCommands();
+
+  // Tick serially, bumping frame_number_ per tick so that update-rate tiers
+  // step through the batch exactly as they would through individual calls.
+  for (int frame = 0; frame < num_frames; ++frame) {
+    ++frame_number_;
+    AdvanceFramePasses(delta_time);
+  }
+
+  PublishFrameSnapshots();
+  NotifyCompletions();
+  NotifyCrossings();
+  NotifyValueDeltas();
+}
+
+void MotiveEngine::SetDeterministic(bool enable) {
+  deterministic_ = enable;
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->SetDeterministic(enable);
+  }
+}
+
+void MotiveEngine::SetCapacitiesLocked(bool locked) {
+  capacities_locked_ = locked;
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->SetCapacityLocked(locked);
+  }
+}
+
+void MotiveEngine::SetFrameSnapshots(bool enable) {
+  frame_snapshots_ = enable;
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->SetFrameSnapshots(enable);
+  }
+}
+
+void MotiveEngine::PublishFrameSnapshots() {
+  if (!frame_snapshots_) return;
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    it->processor->PublishFrameSnapshot();
+  }
+}
+
+void MotiveEngine::SetCompletionCallback(MotiveCompletionFn* fn,
+                                         void* userdata) {
+  completion_fn_ = fn;
+  completion_userdata_ = userdata;
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->SetTrackCompletions(fn != nullptr);
+  }
+}
+
+void MotiveEngine::SetCrossingCallback(MotiveCrossingFn* fn, void* userdata) {
+  crossing_fn_ = fn;
+  crossing_userdata_ = userdata;
+}
+
+void MotiveEngine::SetValueDeltaCallback(MotiveValueDeltaFn* fn, float epsilon,
+                                         void* userdata) {
+  assert(fn == nullptr || epsilon > 0.0f);
+  value_delta_fn_ = fn;
+  value_delta_epsilon_ = epsilon;
+  value_delta_userdata_ = userdata;
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->SetTrackValueDeltas(fn != nullptr, epsilon);
+  }
+}
+
+void MotiveEngine::MigrateMotivators(Motivator* const* motivators,
+                                     int num_motivators) {
+  for (int i = 0; i < num_motivators; ++i) {
+    Motivator* motivator = motivators[i];
+    assert(motivator != nullptr && motivator->Valid());
+
+    // Our processor of the motivator's type adopts it. MigrateMotivator()
+    // is a no-op for motivators this engine already drives.
+    Processor(motivator->Type())->MigrateMotivator(motivator);
+  }
+}
+
+int MotiveEngine::DestroyGroup(int group) {
+  // Sweep in reverse priority order, so parents (rigs, matrices) are
+  // destroyed before the motivators they drive. Either order is correct--a
+  // destroyed handle's later teardown is a no-op--but this order lets each
+  // parent release its children through its normal removal path.
+  int num_destroyed = 0;
+  for (ProcessorSet::reverse_iterator it = sorted_processors_.rbegin();
+       it != sorted_processors_.rend(); ++it) {
+    num_destroyed += it->processor->DestroyGroup(group);
+  }
+  return num_destroyed;
+}
+
+size_t MotiveEngine::CapacityHighWaterMarks(MotiveProcessorCapacity* marks,
+                                            size_t max_marks) const {
+  size_t num_processors = 0;
+  for (ProcessorMap::const_iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it, ++num_processors) {
+    if (num_processors >= max_marks) continue;
+
+    // A MotivatorType is a pointer to the type's static name string, so
+    // dereferencing it yields a name that is stable across runs.
+    marks[num_processors].type_name = *it->first;
+    marks[num_processors].num_indices = it->second->HighWaterIndices();
+  }
+  return num_processors;
+}
+
+void MotiveEngine::ReserveCapacities(const MotiveProcessorCapacity* marks,
+                                     size_t num_marks) {
+  // Match recorded names against the factory registry, since the marks may
+  // come from an earlier run where the type pointers differed. Names with
+  // no registered factory are skipped: the type isn't linked into this
+  // binary, so nothing can be reserved for it.
+  const int count =
+      std::min(function_registry_count_.load(std::memory_order_relaxed),
+               static_cast<int>(kMaxProcessorTypes));
+  for (size_t m = 0; m < num_marks; ++m) {
+    for (int i = 0; i < count; ++i) {
+      const MotivatorType type =
+          function_registry_[i].type.load(std::memory_order_acquire);
+      if (type == kMotivatorTypeInvalid) continue;
+      if (strcmp(*type, marks[m].type_name) != 0) continue;
+      ReserveIndices(type, marks[m].num_indices);
+      break;
+    }
+  }
+}
+
+MotiveMemoryStats MotiveEngine::MemoryStats() const {
+  MotiveMemoryStats stats;
+  for (ProcessorMap::const_iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->AccumulateMemoryStats(&stats);
+  }
+  return stats;
+}
+
+// Version tag at the front of every checkpoint blob. Bump when the format
+// of the engine header or any processor's record changes.
+static const uint32_t kCheckpointVersion = 1;
+
+static void AppendCheckpointBytes(const void* bytes, size_t num_bytes,
+                                  std::vector<uint8_t>* out) {
+  const uint8_t* p = static_cast<const uint8_t*>(bytes);
+  out->insert(out->end(), p, p + num_bytes);
+}
+
+static void AppendCheckpointU32(uint32_t value, std::vector<uint8_t>* out) {
+  AppendCheckpointBytes(&value, sizeof(value), out);
+}
+
+static bool ReadCheckpointU32(const uint8_t* bytes, size_t num_bytes,
+                              size_t* pos, uint32_t* value) {
+  if (*pos + sizeof(*value) > num_bytes) return false;
+  memcpy(value, bytes + *pos, sizeof(*value));
+  *pos += sizeof(*value);
+  return true;
+}
+
+void MotiveEngine::SaveCheckpoint(std::vector<uint8_t>* out) {
+  out->clear();
+  AppendCheckpointU32(kCheckpointVersion, out);
+
+  // One record per supporting processor: the processor's type name (so the
+  // record finds its processor in the restored process, where pointers
+  // differ), then its state as an opaque, size-prefixed blob.
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    MotiveProcessor* processor = it->second;
+    if (!processor->SupportsCheckpoint()) continue;
+
+    // Compact first, so the saved index layout has no holes and is
+    // reproduced by re-creating the same motivators in the same order.
+    processor->ForceDefragment();
+
+    const char* name = *it->first;
+    const uint32_t name_len = static_cast<uint32_t>(strlen(name));
+    AppendCheckpointU32(name_len, out);
+    AppendCheckpointBytes(name, name_len, out);
+
+    // Reserve the size field, then write the state after it.
+    const size_t size_offset = out->size();
+    AppendCheckpointU32(0, out);
+    processor->SaveCheckpointState(out);
+    const uint32_t state_size =
+        static_cast<uint32_t>(out->size() - size_offset - sizeof(uint32_t));
+    memcpy(out->data() + size_offset, &state_size, sizeof(state_size));
+  }
+}
+
+bool MotiveEngine::RestoreCheckpoint(const uint8_t* bytes, size_t num_bytes,
+                                     MotiveSplineResolverFn* resolver,
+                                     void* userdata) {
+  size_t pos = 0;
+  uint32_t version = 0;
+  if (!ReadCheckpointU32(bytes, num_bytes, &pos, &version)) return false;
+  if (version != kCheckpointVersion) return false;
+
+  // Restore every record we can, like AnimTable::Load() keeps loading past
+  // a bad file, and report failure if any record didn't restore cleanly.
+  bool success = true;
+  while (pos < num_bytes) {
+    uint32_t name_len = 0;
+    if (!ReadCheckpointU32(bytes, num_bytes, &pos, &name_len)) return false;
+    if (pos + name_len > num_bytes) return false;
+    const char* name = reinterpret_cast<const char*>(bytes + pos);
+    pos += name_len;
+
+    uint32_t state_size = 0;
+    if (!ReadCheckpointU32(bytes, num_bytes, &pos, &state_size)) return false;
+    if (pos + state_size > num_bytes) return false;
+
+    // Find the processor whose type name matches. It exists already if the
+    // caller re-created its motivators, as RestoreCheckpoint() requires.
+    MotiveProcessor* processor = nullptr;
+    for (ProcessorMap::iterator it = mapped_processors_.begin();
+         it != mapped_processors_.end(); ++it) {
+      const char* processor_name = *it->first;
+      if (strlen(processor_name) == name_len &&
+          memcmp(processor_name, name, name_len) == 0) {
+        processor = it->second;
+        break;
+      }
+    }
+
+    if (processor == nullptr ||
+        !processor->RestoreCheckpointState(bytes + pos, state_size, resolver,
+                                           userdata)) {
+      success = false;
+    }
+    pos += state_size;
+  }
+  return success;
+}
+
+// Gather the (old, new) spline pairs implied by reloading `old_anim` as
+// `new_anim`. Operations are matched by bone index and operation id, the
+// same identity BlendToOps() uses. An old spline whose operation vanished,
+// or became a non-spline operation, pairs with nullptr so its motivators
+// hold their current value.
+static void CollectSplinePairs(
+    const RigAnim& old_anim, const RigAnim& new_anim,
+    std::vector<const CompactSpline*>* old_splines,
+    std::vector<const CompactSpline*>* new_splines) {
+  const BoneIndex old_num_bones = old_anim.NumBones();
+  const BoneIndex new_num_bones = new_anim.NumBones();
+  for (BoneIndex i = 0; i < old_num_bones; ++i) {
+    const std::vector<MatrixOperationInit>& old_ops = old_anim.Anim(i).ops();
+    for (size_t o = 0; o < old_ops.size(); ++o) {
+      const MatrixOperationInit& old_op = old_ops[o];
+      if (old_op.union_type != MatrixOperationInit::kUnionSpline ||
+          old_op.spline == nullptr)
+        continue;
+
+      const CompactSpline* new_spline = nullptr;
+      if (i < new_num_bones) {
+        const std::vector<MatrixOperationInit>& new_ops =
+            new_anim.Anim(i).ops();
+        for (size_t n = 0; n < new_ops.size(); ++n) {
+          const MatrixOperationInit& new_op = new_ops[n];
+          if (new_op.id != old_op.id) continue;
+          if (new_op.union_type == MatrixOperationInit::kUnionSpline) {
+            new_spline = new_op.spline;
+          }
+          break;
+        }
+      }
+
+      if (new_spline == old_op.spline) continue;
+      old_splines->push_back(old_op.spline);
+      new_splines->push_back(new_spline);
+    }
+  }
+}
+
+void MotiveEngine::RebindAnims(const RigAnim* const* old_anims,
+                               const RigAnim* const* new_anims,
+                               int num_anims) {
+  // Re-point the splines the anims own. This reaches every motivator
+  // playing the old anims--the rigs' op motivators, blend layers' op
+  // motivators, and any spline motivator handed an anim spline directly.
+  std::vector<const CompactSpline*> old_splines;
+  std::vector<const CompactSpline*> new_splines;
+  for (int a = 0; a < num_anims; ++a) {
+    if (old_anims[a] == nullptr || new_anims[a] == nullptr) continue;
+    CollectSplinePairs(*old_anims[a], *new_anims[a], &old_splines,
+                       &new_splines);
+  }
+  if (!old_splines.empty()) {
+    RebindSplines(old_splines.data(), new_splines.data(),
+                  static_cast<int>(old_splines.size()));
+  }
+
+  // Then fix the bookkeeping pointers that reference the anims themselves.
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->RebindAnims(old_anims, new_anims, num_anims);
+  }
+}
+
+void MotiveEngine::RebindSplines(const CompactSpline* const* old_splines,
+                                 const CompactSpline* const* new_splines,
+                                 int num_splines) {
+  for (ProcessorMap::iterator it = mapped_processors_.begin();
+       it != mapped_processors_.end(); ++it) {
+    it->second->RebindSplines(old_splines, new_splines, num_splines);
+  }
+}
+
+// Returns true if `a` and `b` retarget same-width motivators of the same
+// type with identical targets, so one shared-target bulk call covers both.
+static bool SameTargetRun(const MotiveCommand& a, const MotiveCommand& b) {
+  if (b.type != MotiveCommand::kSetTargets) return false;
+  if (a.motivator->Type() != b.motivator->Type()) return false;
+  const MotiveDimension dimensions = a.motivator->Dimensions();
+  if (b.motivator->Dimensions() != dimensions) return false;
+
+  for (MotiveDimension d = 0; d < dimensions; ++d) {
+    const MotiveTarget1f& ta = a.targets[d];
+    const MotiveTarget1f& tb = b.targets[d];
+    if (ta.num_nodes() != tb.num_nodes()) return false;
+    for (int n = 0; n < ta.num_nodes(); ++n) {
+      const MotiveNode1f& na = ta.Node(n);
+      const MotiveNode1f& nb = tb.Node(n);
+      if (na.value != nb.value || na.velocity != nb.velocity ||
+          na.time != nb.time || na.direction != nb.direction)
+        return false;
+    }
+  }
+  return true;
+}
+
+void MotiveEngine::ApplyCommands() {
+  // Drain into the frame arena, so a full queue costs no heap traffic.
+  const size_t capacity = command_queue_->Capacity();
+  MotiveCommand* const commands =
+      frame_arena_.AllocArray<MotiveCommand>(capacity);
+  const size_t num_commands = command_queue_->Drain(commands, capacity);
+
+  size_t i = 0;
+  while (i < num_commands) {
+    const MotiveCommand& command = commands[i];
+    switch (command.type) {
+      case MotiveCommand::kSetTargets: {
+        // Gather the run of consecutive commands applying identical
+        // targets. Workers retargeting a crowd along one route enqueue
+        // such runs back to back, and the bulk path compiles the shared
+        // way-point sequence once for the whole run.
+        size_t end = i + 1;
+        while (end < num_commands && SameTargetRun(command, commands[end])) {
+          ++end;
+        }
+        const size_t run_length = end - i;
+        if (run_length == 1) {
+          command.motivator->SetTargets(command.targets);
+        } else {
+          MotivatorNf** const motivators =
+              frame_arena_.AllocArray<MotivatorNf*>(run_length);
+          for (size_t m = 0; m < run_length; ++m) {
+            motivators[m] = commands[i + m].motivator;
+          }
+          MotivatorNf::SetTargetsBatch(
+              motivators, static_cast<int>(run_length), command.targets);
+        }
+        i = end;
+        continue;
+      }
+
+      case MotiveCommand::kSetSplines:
+        command.motivator->SetSplines(command.splines, command.playback);
+        break;
+
+      case MotiveCommand::kSetSplinePlaybackRate:
+        command.motivator->SetSplinePlaybackRate(command.playback_rate);
+        break;
+    }
+    ++i;
+  }
+}
+
+void MotiveEngine::AddDependency(const Motivator& source,
+                                 Motivator* dependent) {
+  assert(source.Valid() && dependent != nullptr && dependent->Valid());
+
+  // When the priority order already advances the source's processor
+  // strictly earlier, the dependent sees current-frame values within the
+  // source's pass. Otherwise it must wait for the next pass.
+  const int source_priority = Processor(source.Type())->Priority();
+  const int dependent_priority = Processor(dependent->Type())->Priority();
+  const int required_pass =
+      source.AdvancePass() + (source_priority < dependent_priority ? 0 : 1);
+
+  // Never lower an assignment; the dependent may have other sources.
+  if (dependent->AdvancePass() < required_pass) {
+    dependent->SetAdvancePass(required_pass);
+  }
+}
+
+void MotiveEngine::NotifyCompletions() {
+  if (completion_fn_ == nullptr) return;
+
+  completed_motivators_.clear();
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    it->processor->CollectCompletions(&completed_motivators_);
+  }
+
+  if (!completed_motivators_.empty()) {
+    completion_fn_(completion_userdata_, completed_motivators_.data(),
+                   static_cast<int>(completed_motivators_.size()));
+  }
+}
+
+void MotiveEngine::NotifyCrossings() {
+  if (crossing_fn_ == nullptr) return;
+
+  crossings_.clear();
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    it->processor->CollectCrossings(&crossings_);
+  }
+
+  if (!crossings_.empty()) {
+    crossing_fn_(crossing_userdata_, crossings_.data(),
+                 static_cast<int>(crossings_.size()));
+  }
+}
+
+void MotiveEngine::NotifyValueDeltas() {
+  if (value_delta_fn_ == nullptr) return;
+
+  value_deltas_.clear();
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    it->processor->CollectValueDeltas(&value_deltas_);
+  }
+
+  if (!value_deltas_.empty()) {
+    value_delta_fn_(value_delta_userdata_, value_deltas_.data(),
+                    static_cast<int>(value_deltas_.size()));
+  }
+}
+
+bool MotiveEngine::AdvanceFrameWithBudget(MotiveTime delta_time,
+                                          int64_t budget_usec) {
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::microseconds(budget_usec);
+
+  // This is a frame boundary too; see AdvanceFrame().
+  frame_arena_.Reset();
+  if (command_queue_ != nullptr) ApplyCommands();
+
+  bool caught_up = true;
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    MotiveProcessor* processor = it->processor;
+    ScheduleState& state = schedule_states_[processor];
+    state.pending_time += delta_time;
+    if (state.pending_time == 0 && state.carry_time == 0) continue;
+
+    // Once the budget is spent, keep walking so that the remaining
+    // processors accumulate their time, but don't advance them.
+    if (std::chrono::steady_clock::now() >= deadline) {
+      caught_up = false;
+      continue;
+    }
+
+    const motive::Benchmark b(processor->benchmark_id_for_advance_frame());
+
+    // Processors that can't be split are advanced whole; they may overshoot
+    // the budget by one processor's worth of work, at most.
+    const MotiveIndex slice = processor->ParallelSliceSize();
+    if (slice <= 0) {
+      processor->AdvanceFrame(state.pending_time);
+      state.pending_time = 0;
+      continue;
+    }
+
+    // Finish the sweep that ran out of budget last call. Its skipped
+    // indices catch up with one large step, so no time is lost.
+    if (state.carry_time > 0 && !FinishSweep(processor, &state, deadline)) {
+      caught_up = false;
+      continue;
+    }
+
+    // Start a new sweep with the accumulated time. BeginAdvanceFrame() runs
+    // only here, between sweeps, so defragmentation can't move indices
+    // while a sweep is partially applied.
+    if (state.pending_time > 0) {
+      processor->BeginAdvanceFrame(state.pending_time);
+      state.carry_time = state.pending_time;
+      state.pending_time = 0;
+      state.resume_index = 0;
+      if (!FinishSweep(processor, &state, deadline)) caught_up = false;
+    }
+  }
+
+  PublishFrameSnapshots();
+  NotifyCompletions();
+  NotifyCrossings();
+  NotifyValueDeltas();
+  return caught_up;
+}
+
+bool MotiveEngine::FinishSweep(
+    MotiveProcessor* processor, ScheduleState* state,
+    const std::chrono::steady_clock::time_point& deadline) {
+  const MotiveIndex slice = processor->ParallelSliceSize();
+  const MotiveIndex num_indices = processor->NumIndices();
+  while (state->resume_index < num_indices) {
+    if (std::chrono::steady_clock::now() >= deadline) return false;
+    const MotiveIndex end = std::min(state->resume_index + slice, num_indices);
+    processor->AdvanceFrameRange(state->carry_time, state->resume_index, end);
+    state->resume_index = end;
+  }
+  state->carry_time = 0;
+  state->resume_index = 0;
+  return true;
+}
+
+// static
+void MotiveEngine::RunAdvanceJob(void* data) {
+  const AdvanceJob& job = *static_cast<const AdvanceJob*>(data);
+
+  // Each worker gets its own Benchmark scope, so per-processor timings keep
+  // working when a processor is advanced by several workers.
+  const motive::Benchmark b(job.processor->benchmark_id_for_advance_frame());
+  if (job.start_index == kMotiveIndexInvalid) {
+    if (job.end_index == kMotiveIndexInvalid) {
+      job.processor->AdvanceFrameTiered(job.delta_time, job.frame_number);
+    } else {
+      // Pass 0 of a multi-pass processor; `end_index` carries the pass.
+      // Later passes run serially after the batches drain; see
+      // AdvanceFrameParallel().
+      job.processor->AdvanceFramePass(
+          job.delta_time, static_cast<int>(job.end_index), job.frame_number);
+    }
+  } else if (job.end_index == kMotiveIndexInvalid) {
+    job.processor->AdvanceFrame(job.delta_time);
+  } else {
+    job.processor->AdvanceFrameRange(job.delta_time, job.start_index,
+                                     job.end_index);
+  }
+}
+
+void MotiveEngine::AdvanceFrameParallel(MotiveTime delta_time) {
+  // Processors of equal priority are independent of each other, so each
+  // priority level forms one batch of concurrent jobs. We wait for a batch to
+  // complete before starting the next one, since higher priority levels may
+  // read the output of lower ones (e.g. matrix motivators driven by spline
+  // motivators).
+  ProcessorSet::iterator it = sorted_processors_.begin();
+  while (it != sorted_processors_.end()) {
+    const int priority = it->processor->Priority();
+
+    // The jobs live in the frame arena, which never moves what it has
+    // handed out, so each job can be submitted as soon as it is built. The
+    // arena is reset at the top of AdvanceFrame(), after the previous
+    // frame's jobs have long since drained.
+    for (; it != sorted_processors_.end() &&
+           it->processor->Priority() == priority;
+         ++it) {
+      MotiveProcessor* processor = it->processor;
+
+      // A multi-pass processor advances only its pass-0 indices now; the
+      // later passes run serially once every batch has drained, so their
+      // cross-processor reads see final values.
+      if (processor->MaxAdvancePass() > 0) {
+        AdvanceJob* const job = frame_arena_.AllocArray<AdvanceJob>(1);
+        const AdvanceJob pass0 = {processor, delta_time, kMotiveIndexInvalid,
+                                  0, frame_number_};
+        *job = pass0;
+        job_system_->Submit(RunAdvanceJob, job);
+        continue;
+      }
+
+      // Processors with update-rate tiers advance as one job, so that the
+      // tier sweep sees a consistent view of its index runs. Its serial
+      // pre-pass runs inside the job, which is safe since no other worker
+      // touches the processor.
+      if (processor->HasTieredIndices()) {
+        AdvanceJob* const job = frame_arena_.AllocArray<AdvanceJob>(1);
+        const AdvanceJob tiered = {processor, delta_time, kMotiveIndexInvalid,
+                                   kMotiveIndexInvalid, frame_number_};
+        *job = tiered;
+        job_system_->Submit(RunAdvanceJob, job);
+        continue;
+      }
+
+      // Serial pre-pass, e.g. Defragment(), before any workers touch the
+      // processor's arrays.
+      processor->BeginAdvanceFrame(delta_time);
+
+      const MotiveIndex slice = processor->ParallelSliceSize();
+      const MotiveIndex num_indices = processor->NumIndices();
+      if (slice <= 0 || num_indices <= slice) {
+        // Advance the whole processor in one job.
+        AdvanceJob* const job = frame_arena_.AllocArray<AdvanceJob>(1);
+        const AdvanceJob whole = {processor, delta_time, 0,
+                                  kMotiveIndexInvalid, frame_number_};
+        *job = whole;
+        job_system_->Submit(RunAdvanceJob, job);
+      } else {
+        // Split a big processor into ranges that are advanced concurrently.
+        const size_t num_jobs =
+            static_cast<size_t>((num_indices + slice - 1) / slice);
+        AdvanceJob* const jobs = frame_arena_.AllocArray<AdvanceJob>(num_jobs);
+        size_t j = 0;
+        for (MotiveIndex start = 0; start < num_indices; start += slice, ++j) {
+          const AdvanceJob job = {processor, delta_time, start,
+                                  std::min(start + slice, num_indices),
+                                  frame_number_};
+          jobs[j] = job;
+          job_system_->Submit(RunAdvanceJob, &jobs[j]);
+        }
+      }
+    }
+
+    job_system_->WaitForAll();
+  }
+
+  // Later dependency passes are rare and touch few indices, so they are
+  // advanced serially rather than scheduled as jobs.
+  int num_passes = 1;
+  for (ProcessorSet::iterator it = sorted_processors_.begin();
+       it != sorted_processors_.end(); ++it) {
+    num_passes = std::max(num_passes, it->processor->MaxAdvancePass() + 1);
+  }
+  for (int pass = 1; pass < num_passes; ++pass) {
+    for (ProcessorSet::iterator it = sorted_processors_.begin();
+         it != sorted_processors_.end(); ++it) {
+      it->processor->AdvanceFramePass(delta_time, pass, frame_number_);
+    }
+  }
+
+  PublishFrameSnapshots();
+  NotifyCompletions();
+  NotifyCrossings();
+  NotifyValueDeltas();
+}
+
 }  // namespace motive
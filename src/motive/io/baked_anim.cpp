@@ -0,0 +1,391 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+
+#include <map>
+#include <set>
+
+#include "motive/io/baked_anim.h"
+#include "motive/matrix_anim.h"
+#include "motive/matrix_op.h"
+#include "motive/rig_anim.h"
+
+namespace motive {
+
+// Image magic: 'M' 'V' 'B' 'A', read as a little-endian u32.
+static const uint32_t kBakedMagic = 0x4142564d;
+static const uint32_t kBakedVersion = 1;
+
+// Op kinds in the baked image; see the format comment in baked_anim.h.
+static const uint8_t kBakedOpMotivator = 0;
+static const uint8_t kBakedOpConstant = 1;
+static const uint8_t kBakedOpSpline = 2;
+static const uint8_t kBakedOpSharedSpline = 3;
+
+static void AppendU8(std::string* out, uint8_t value) {
+  out->append(1, static_cast<char>(value));
+}
+
+static void AppendU16(std::string* out, uint16_t value) {
+  char bytes[2];
+  bytes[0] = static_cast<char>(value & 0xff);
+  bytes[1] = static_cast<char>((value >> 8) & 0xff);
+  out->append(bytes, 2);
+}
+
+static void AppendU32(std::string* out, uint32_t value) {
+  char bytes[4];
+  bytes[0] = static_cast<char>(value & 0xff);
+  bytes[1] = static_cast<char>((value >> 8) & 0xff);
+  bytes[2] = static_cast<char>((value >> 16) & 0xff);
+  bytes[3] = static_cast<char>((value >> 24) & 0xff);
+  out->append(bytes, 4);
+}
+
+static void AppendU64(std::string* out, uint64_t value) {
+  AppendU32(out, static_cast<uint32_t>(value & 0xffffffffu));
+  AppendU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+static void AppendF32(std::string* out, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  AppendU32(out, bits);
+}
+
+// Strings are written as a u16 length followed by the bytes, no terminator.
+static void AppendString(std::string* out, const char* s) {
+  const size_t len = strlen(s);
+  assert(len <= 0xffff);
+  AppendU16(out, static_cast<uint16_t>(len));
+  out->append(s, len);
+}
+
+// Bounds-checked cursor over the image bytes. A failed read sticks, so call
+// sites can chain several reads and check ok() once.
+class BakedReader {
+ public:
+  BakedReader(const void* data, size_t size)
+      : p_(static_cast<const uint8_t*>(data)), remaining_(size), ok_(true) {}
+
+  bool ok() const { return ok_; }
+
+  uint8_t ReadU8() {
+    const uint8_t* p = Take(1);
+    return p == nullptr ? 0 : p[0];
+  }
+
+  uint16_t ReadU16() {
+    const uint8_t* p = Take(2);
+    if (p == nullptr) return 0;
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+  }
+
+  uint32_t ReadU32() {
+    const uint8_t* p = Take(4);
+    if (p == nullptr) return 0;
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) |
+           (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  uint64_t ReadU64() {
+    const uint64_t lo = ReadU32();
+    const uint64_t hi = ReadU32();
+    return lo | (hi << 32);
+  }
+
+  float ReadF32() {
+    const uint32_t bits = ReadU32();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  // Returns nullptr if fewer than `num_bytes` remain.
+  const uint8_t* ReadBytes(size_t num_bytes) { return Take(num_bytes); }
+
+  void ReadString(std::string* s) {
+    const uint16_t len = ReadU16();
+    const uint8_t* p = Take(len);
+    if (p != nullptr) s->assign(reinterpret_cast<const char*>(p), len);
+  }
+
+ private:
+  const uint8_t* Take(size_t num_bytes) {
+    if (!ok_ || remaining_ < num_bytes) {
+      ok_ = false;
+      return nullptr;
+    }
+    const uint8_t* p = p_;
+    p_ += num_bytes;
+    remaining_ -= num_bytes;
+    return p;
+  }
+
+  const uint8_t* p_;
+  size_t remaining_;
+  bool ok_;
+};
+
+// Bytes one spline occupies in the rig's pooled buffer. Keyed off
+// num_nodes(), not max_nodes(): the baked copy is trimmed to its contents.
+static size_t BakedSplineSize(const CompactSpline& spline) {
+  return CompactSpline::SizeWithFormat(spline.num_nodes(), spline.format(),
+                                       spline.x_index_log2());
+}
+
+bool IsBakedAnim(const void* data, size_t size) {
+  if (size < sizeof(uint32_t)) return false;
+  uint32_t magic;
+  memcpy(&magic, data, sizeof(magic));
+  return magic == kBakedMagic;
+}
+
+void BakeRigAnim(const RigAnim& anim, uint64_t build_id, std::string* out) {
+  const BoneIndex num_bones = anim.NumBones();
+  const bool has_names = anim.has_bone_names();
+
+  // Header. The end time is baked directly, so repeating animations keep
+  // their infinite end time without re-deriving it from the splines.
+  AppendU32(out, kBakedMagic);
+  AppendU32(out, kBakedVersion);
+  AppendU64(out, build_id);
+  AppendU32(out, static_cast<uint32_t>(anim.end_time()));
+  AppendU8(out, anim.repeat() ? 1 : 0);
+  AppendU8(out, has_names ? 1 : 0);
+  AppendU16(out, num_bones);
+
+  // Total spline bytes, so that loading can make the rig's single spline
+  // allocation before walking the bones. Ops bound to one shared
+  // CompactSpline instance bake--and occupy--it only once.
+  size_t total_spline_bytes = 0;
+  std::set<const CompactSpline*> counted;
+  for (BoneIndex i = 0; i < num_bones; ++i) {
+    const std::vector<MatrixOperationInit>& ops = anim.Anim(i).ops();
+    for (size_t j = 0; j < ops.size(); ++j) {
+      if (ops[j].union_type == MatrixOperationInit::kUnionSpline &&
+          counted.insert(ops[j].spline).second) {
+        total_spline_bytes += BakedSplineSize(*ops[j].spline);
+      }
+    }
+  }
+  AppendU32(out, static_cast<uint32_t>(total_spline_bytes));
+  AppendString(out, anim.anim_name().c_str());
+
+  // Splines baked so far, mapped to their bake-order ordinal; repeats of a
+  // shared spline reference the first baked copy by ordinal.
+  std::map<const CompactSpline*, uint32_t> baked;
+
+  const BoneIndex* parents = anim.bone_parents();
+  for (BoneIndex i = 0; i < num_bones; ++i) {
+    AppendU8(out, parents[i]);
+    if (has_names) AppendString(out, anim.BoneName(i));
+
+    // Motivator-driven ops--with or without a spline--each consume one
+    // MatrixAnim::Spline slot for their SplineInit; see
+    // MatrixAnimFromFlatBuffers().
+    const std::vector<MatrixOperationInit>& ops = anim.Anim(i).ops();
+    uint16_t num_splines = 0;
+    for (size_t j = 0; j < ops.size(); ++j) {
+      if (ops[j].init != nullptr) ++num_splines;
+    }
+    AppendU16(out, num_splines);
+    AppendU16(out, static_cast<uint16_t>(ops.size()));
+
+    for (size_t j = 0; j < ops.size(); ++j) {
+      const MatrixOperationInit& op = ops[j];
+      AppendU8(out, op.id);
+      AppendU8(out, static_cast<uint8_t>(op.type));
+      switch (op.union_type) {
+        case MatrixOperationInit::kUnionInitialValue:
+          // Loader-built const ops carry no motivator; see baked_anim.h.
+          assert(op.init == nullptr);
+          AppendU8(out, kBakedOpConstant);
+          AppendF32(out, op.initial_value);
+          break;
+
+        case MatrixOperationInit::kUnionEmpty:
+          assert(op.init != nullptr);
+          AppendU8(out, kBakedOpMotivator);
+          break;
+
+        case MatrixOperationInit::kUnionSpline: {
+          const CompactSpline& spline = *op.spline;
+          auto shared = baked.find(&spline);
+          if (shared != baked.end()) {
+            AppendU8(out, kBakedOpSharedSpline);
+            AppendU32(out, shared->second);
+            break;
+          }
+          baked.insert(
+              std::make_pair(&spline, static_cast<uint32_t>(baked.size())));
+          AppendU8(out, kBakedOpSpline);
+          AppendF32(out, spline.y_range().start());
+          AppendF32(out, spline.y_range().end());
+          AppendF32(out, spline.x_granularity());
+          AppendU16(out, spline.num_nodes());
+          AppendU8(out, static_cast<uint8_t>(spline.format()));
+          AppendU8(out, static_cast<uint8_t>(spline.x_index_log2()));
+          out->append(static_cast<const char*>(spline.node_data()),
+                      spline.node_data_size());
+          break;
+        }
+
+        default:
+          assert(false);  // Targets are runtime-only; see baked_anim.h.
+      }
+    }
+  }
+}
+
+bool InitRigAnimFromBaked(const void* data, size_t size, uint64_t build_id,
+                          bool strip_debug_names, RigAnim* anim) {
+  BakedReader r(data, size);
+  const uint32_t magic = r.ReadU32();
+  const uint32_t version = r.ReadU32();
+  const uint64_t baked_build_id = r.ReadU64();
+  const MotiveTime end_time = static_cast<MotiveTime>(r.ReadU32());
+  const uint8_t repeat = r.ReadU8();
+  const uint8_t has_names = r.ReadU8();
+  const uint16_t num_bones = r.ReadU16();
+  const uint32_t total_spline_bytes = r.ReadU32();
+  if (!r.ok() || magic != kBakedMagic || version != kBakedVersion ||
+      baked_build_id != build_id || num_bones > kMaxNumBones) {
+    return false;
+  }
+
+  std::string anim_name;
+  r.ReadString(&anim_name);
+  if (!r.ok()) return false;
+
+  const bool record_names = !strip_debug_names && has_names != 0;
+  anim->Init(anim_name.c_str(), static_cast<BoneIndex>(num_bones),
+             record_names);
+  uint8_t* spline_buf = anim->AllocateSplineBuffer(total_spline_bytes);
+  uint8_t* const spline_buf_end = spline_buf + total_spline_bytes;
+
+  // Splines created so far, in bake order, so shared-spline ops can bind
+  // to the instance their ordinal names.
+  std::vector<const CompactSpline*> created;
+
+  std::string bone_name;
+  for (uint16_t i = 0; i < num_bones; ++i) {
+    const uint8_t parent = r.ReadU8();
+    if (has_names != 0) r.ReadString(&bone_name);
+    const uint16_t num_splines = r.ReadU16();
+    const uint16_t num_ops = r.ReadU16();
+    if (!r.ok()) return false;
+    // InitMatrixAnim() requires parents to precede their children.
+    if (parent != kInvalidBoneIdx && parent >= i) return false;
+
+    MatrixAnim& m = anim->InitMatrixAnim(static_cast<BoneIndex>(i), parent,
+                                         bone_name.c_str());
+    MatrixAnim::Spline* splines = m.Construct(num_splines);
+    std::vector<MatrixOperationInit>& ops = m.ops();
+    ops.reserve(num_ops);
+
+    int spline_idx = 0;
+    for (uint16_t j = 0; j < num_ops; ++j) {
+      const MatrixOpId id = r.ReadU8();
+      const uint8_t type = r.ReadU8();
+      const uint8_t kind = r.ReadU8();
+      if (!r.ok() || type >= kNumMatrixOperationTypes) return false;
+      const MatrixOperationType op_type =
+          static_cast<MatrixOperationType>(type);
+
+      switch (kind) {
+        case kBakedOpConstant: {
+          const float value = r.ReadF32();
+          if (!r.ok()) return false;
+          ops.emplace_back(id, op_type, value);
+          break;
+        }
+
+        case kBakedOpMotivator: {
+          if (spline_idx >= num_splines) return false;
+          MatrixAnim::Spline& s = splines[spline_idx++];
+          s.init = SplineInit(RangeOfOp(op_type));
+          ops.emplace_back(id, op_type, s.init);
+          break;
+        }
+
+        case kBakedOpSpline: {
+          if (spline_idx >= num_splines) return false;
+          MatrixAnim::Spline& s = splines[spline_idx++];
+          s.init = SplineInit(RangeOfOp(op_type));
+
+          const float y_start = r.ReadF32();
+          const float y_end = r.ReadF32();
+          const float x_granularity = r.ReadF32();
+          const uint16_t num_nodes = r.ReadU16();
+          const uint8_t format = r.ReadU8();
+          const uint8_t x_index_log2 = r.ReadU8();
+          if (!r.ok() || format > kNodeFormatImplied || x_index_log2 >= 16) {
+            return false;
+          }
+
+          const size_t spline_size = CompactSpline::SizeWithFormat(
+              num_nodes, static_cast<CompactSplineNodeFormat>(format),
+              x_index_log2);
+          if (spline_size >
+              static_cast<size_t>(spline_buf_end - spline_buf)) {
+            return false;
+          }
+          // Create the CompactSpline inside the rig's pooled buffer. It is
+          // owned by the buffer, so `s.spline` stays null.
+          CompactSpline* spline = CompactSpline::CreateInPlaceWithFormat(
+              num_nodes, spline_buf,
+              static_cast<CompactSplineNodeFormat>(format), x_index_log2);
+          spline_buf += spline_size;
+
+          const uint8_t* node_data =
+              r.ReadBytes(num_nodes * spline->NodeSize());
+          if (node_data == nullptr) return false;
+          spline->Init(Range(y_start, y_end), x_granularity);
+          spline->AppendNodeData(node_data, num_nodes);
+          // The x-index is derived data; rebuild rather than deserialize.
+          if (spline->has_x_index()) spline->BuildXIndex();
+
+          created.push_back(spline);
+          ops.emplace_back(id, op_type, s.init, *spline);
+          break;
+        }
+
+        case kBakedOpSharedSpline: {
+          if (spline_idx >= num_splines) return false;
+          MatrixAnim::Spline& s = splines[spline_idx++];
+          s.init = SplineInit(RangeOfOp(op_type));
+
+          const uint32_t ordinal = r.ReadU32();
+          if (!r.ok() || ordinal >= created.size()) return false;
+          ops.emplace_back(id, op_type, s.init, *created[ordinal]);
+          break;
+        }
+
+        default:
+          return false;
+      }
+    }
+  }
+
+  anim->set_end_time(end_time);
+  anim->set_repeat(repeat != 0);
+  anim->PackOps();
+  return true;
+}
+
+}  // namespace motive
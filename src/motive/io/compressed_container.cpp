@@ -0,0 +1,376 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+
+#include "motive/io/compressed_container.h"
+
+namespace motive {
+
+// Container magic: 'M' 'V' 'A' 'N', read as a little-endian u32.
+static const uint32_t kContainerMagic = 0x4e41564d;
+static const uint32_t kContainerVersion = 1;
+static const size_t kHeaderSize = 16;
+static const size_t kDirectoryEntrySize = 16;
+static const size_t kChunkHeaderSize = 8;
+
+// Matches below this length aren't worth a sequence.
+static const size_t kMinMatch = 4;
+
+// Log2 of the match hash table size. 8KB of stack per compress call.
+static const int kHashLog = 13;
+
+static uint32_t ReadU32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+         (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint64_t ReadU64(const uint8_t* p) {
+  return static_cast<uint64_t>(ReadU32(p)) |
+         (static_cast<uint64_t>(ReadU32(p + 4)) << 32);
+}
+
+static void AppendU32(std::string* out, uint32_t value) {
+  char bytes[4];
+  bytes[0] = static_cast<char>(value & 0xff);
+  bytes[1] = static_cast<char>((value >> 8) & 0xff);
+  bytes[2] = static_cast<char>((value >> 16) & 0xff);
+  bytes[3] = static_cast<char>((value >> 24) & 0xff);
+  out->append(bytes, 4);
+}
+
+static void AppendU64(std::string* out, uint64_t value) {
+  AppendU32(out, static_cast<uint32_t>(value & 0xffffffffu));
+  AppendU32(out, static_cast<uint32_t>(value >> 32));
+}
+
+// Hash of the four bytes at `p`, used to find match candidates.
+static uint32_t HashPosition(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return (v * 2654435761u) >> (32 - kHashLog);
+}
+
+size_t LZCompressBound(size_t size) { return size + size / 255 + 16; }
+
+size_t LZCompress(const void* src_v, size_t src_size, void* dst_v,
+                  size_t dst_capacity) {
+  if (dst_capacity < LZCompressBound(src_size)) return 0;
+
+  const uint8_t* const src = static_cast<const uint8_t*>(src_v);
+  uint8_t* const dst = static_cast<uint8_t*>(dst_v);
+  const uint8_t* ip = src;
+  const uint8_t* anchor = src;
+  const uint8_t* const iend = src + src_size;
+  uint8_t* op = dst;
+
+  // LZ4 format constraints: the last 5 bytes are always literals, and no
+  // match may begin within the last 12 bytes.
+  const uint8_t* const match_limit = iend - 5;
+  const uint8_t* const mf_limit = iend - 12;
+
+  // Most recent position of each hash, stored +1 so that 0 means empty.
+  uint32_t table[1 << kHashLog];
+  memset(table, 0, sizeof(table));
+
+  if (src_size >= 13) {
+    while (ip < mf_limit) {
+      // Probe the table for a usable match at `ip`.
+      const uint32_t h = HashPosition(ip);
+      const uint32_t candidate = table[h];
+      table[h] = static_cast<uint32_t>(ip - src) + 1;
+      const uint8_t* match = src + candidate - 1;
+      if (candidate == 0 || ip - match > 0xffff ||
+          memcmp(match, ip, kMinMatch) != 0) {
+        ++ip;
+        continue;
+      }
+
+      // Extend the match as far as the format allows.
+      const uint8_t* p = ip + kMinMatch;
+      const uint8_t* mp = match + kMinMatch;
+      while (p < match_limit && *p == *mp) {
+        ++p;
+        ++mp;
+      }
+      const size_t match_len = static_cast<size_t>(p - ip);
+
+      // Emit the sequence: token, literal run, offset, extra match length.
+      size_t lit_len = static_cast<size_t>(ip - anchor);
+      uint8_t* const token = op++;
+      if (lit_len >= 15) {
+        *token = 15 << 4;
+        size_t remaining = lit_len - 15;
+        for (; remaining >= 255; remaining -= 255) *op++ = 255;
+        *op++ = static_cast<uint8_t>(remaining);
+      } else {
+        *token = static_cast<uint8_t>(lit_len << 4);
+      }
+      memcpy(op, anchor, lit_len);
+      op += lit_len;
+
+      const size_t offset = static_cast<size_t>(ip - match);
+      *op++ = static_cast<uint8_t>(offset & 0xff);
+      *op++ = static_cast<uint8_t>(offset >> 8);
+
+      const size_t ml_code = match_len - kMinMatch;
+      if (ml_code >= 15) {
+        *token |= 15;
+        size_t remaining = ml_code - 15;
+        for (; remaining >= 255; remaining -= 255) *op++ = 255;
+        *op++ = static_cast<uint8_t>(remaining);
+      } else {
+        *token |= static_cast<uint8_t>(ml_code);
+      }
+
+      ip = p;
+      anchor = ip;
+    }
+  }
+
+  // Final run of literals, with no match after it.
+  {
+    const size_t lit_len = static_cast<size_t>(iend - anchor);
+    uint8_t* const token = op++;
+    if (lit_len >= 15) {
+      *token = 15 << 4;
+      size_t remaining = lit_len - 15;
+      for (; remaining >= 255; remaining -= 255) *op++ = 255;
+      *op++ = static_cast<uint8_t>(remaining);
+    } else {
+      *token = static_cast<uint8_t>(lit_len << 4);
+    }
+    memcpy(op, anchor, lit_len);
+    op += lit_len;
+  }
+
+  return static_cast<size_t>(op - dst);
+}
+
+size_t LZDecompress(const void* src_v, size_t src_size, void* dst_v,
+                    size_t dst_size) {
+  const uint8_t* ip = static_cast<const uint8_t*>(src_v);
+  const uint8_t* const iend = ip + src_size;
+  uint8_t* const dst = static_cast<uint8_t*>(dst_v);
+  uint8_t* op = dst;
+  uint8_t* const oend = dst + dst_size;
+
+  while (ip < iend) {
+    const uint32_t token = *ip++;
+
+    // Literal run.
+    size_t lit_len = token >> 4;
+    if (lit_len == 15) {
+      uint8_t extra;
+      do {
+        if (ip >= iend) return 0;
+        extra = *ip++;
+        lit_len += extra;
+      } while (extra == 255);
+    }
+    if (lit_len > static_cast<size_t>(iend - ip) ||
+        lit_len > static_cast<size_t>(oend - op)) {
+      return 0;
+    }
+    memcpy(op, ip, lit_len);
+    op += lit_len;
+    ip += lit_len;
+
+    // The last sequence is literals only.
+    if (ip >= iend) break;
+
+    // Match.
+    if (iend - ip < 2) return 0;
+    const size_t offset = static_cast<size_t>(ip[0]) |
+                          (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<size_t>(op - dst)) return 0;
+
+    size_t match_len = (token & 15) + kMinMatch;
+    if ((token & 15) == 15) {
+      uint8_t extra;
+      do {
+        if (ip >= iend) return 0;
+        extra = *ip++;
+        match_len += extra;
+      } while (extra == 255);
+    }
+    if (match_len > static_cast<size_t>(oend - op)) return 0;
+
+    // Byte-wise copy: the match may overlap the output (offset < length).
+    const uint8_t* match = op - offset;
+    for (size_t i = 0; i < match_len; ++i) {
+      op[i] = match[i];
+    }
+    op += match_len;
+  }
+
+  return static_cast<size_t>(op - dst);
+}
+
+bool IsAnimContainer(const void* data, size_t size) {
+  return size >= kHeaderSize &&
+         ReadU32(static_cast<const uint8_t*>(data)) == kContainerMagic;
+}
+
+void AnimContainerWriter::AddFrame(uint64_t name_hash, const void* data,
+                                   size_t size) {
+  assert(!finished_);
+
+  Frame frame;
+  frame.name_hash = name_hash;
+  frame.data_offset = static_cast<uint32_t>(data_.size());
+  frame.uncompressed_size = static_cast<uint32_t>(size);
+  frames_.push_back(frame);
+
+  // Compress chunk by chunk. Chunks that don't shrink are stored raw, with
+  // a compressed_size of 0, so incompressible data costs only the headers.
+  const uint8_t* src = static_cast<const uint8_t*>(data);
+  for (size_t pos = 0; pos < size; pos += kAnimContainerChunkSize) {
+    const size_t chunk_size =
+        size - pos < kAnimContainerChunkSize ? size - pos
+                                             : kAnimContainerChunkSize;
+    scratch_.resize(LZCompressBound(chunk_size));
+    const size_t compressed_size =
+        LZCompress(src + pos, chunk_size, scratch_.data(), scratch_.size());
+    if (compressed_size > 0 && compressed_size < chunk_size) {
+      AppendU32(&data_, static_cast<uint32_t>(compressed_size));
+      AppendU32(&data_, static_cast<uint32_t>(chunk_size));
+      data_.append(reinterpret_cast<const char*>(scratch_.data()),
+                   compressed_size);
+    } else {
+      AppendU32(&data_, 0);
+      AppendU32(&data_, static_cast<uint32_t>(chunk_size));
+      data_.append(reinterpret_cast<const char*>(src + pos), chunk_size);
+    }
+  }
+}
+
+void AnimContainerWriter::Finish() {
+  assert(!finished_);
+  finished_ = true;
+
+  AppendU32(out_, kContainerMagic);
+  AppendU32(out_, kContainerVersion);
+  AppendU32(out_, static_cast<uint32_t>(frames_.size()));
+  AppendU32(out_, static_cast<uint32_t>(kAnimContainerChunkSize));
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    AppendU64(out_, frames_[i].name_hash);
+    AppendU32(out_, frames_[i].data_offset);
+    AppendU32(out_, frames_[i].uncompressed_size);
+  }
+  out_->append(data_);
+}
+
+bool AnimContainerReader::Init(const void* data, size_t size) {
+  data_ = static_cast<const uint8_t*>(data);
+  size_ = size;
+  frames_.clear();
+
+  if (!IsAnimContainer(data, size)) return false;
+  if (ReadU32(data_ + 4) != kContainerVersion) return false;
+  const uint32_t num_frames = ReadU32(data_ + 8);
+  if (ReadU32(data_ + 12) != kAnimContainerChunkSize) return false;
+  if (kHeaderSize + num_frames * kDirectoryEntrySize > size) return false;
+
+  frames_.resize(num_frames);
+  const uint8_t* entry = data_ + kHeaderSize;
+  for (uint32_t i = 0; i < num_frames; ++i, entry += kDirectoryEntrySize) {
+    frames_[i].name_hash = ReadU64(entry);
+    frames_[i].data_offset = ReadU32(entry + 8);
+    frames_[i].uncompressed_size = ReadU32(entry + 12);
+  }
+  return true;
+}
+
+int AnimContainerReader::FrameForHash(uint64_t name_hash) const {
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    if (frames_[i].name_hash == name_hash) return static_cast<int>(i);
+  }
+  return -1;
+}
+
+int AnimContainerReader::NumChunks(int frame) const {
+  const size_t size = frames_[frame].uncompressed_size;
+  return static_cast<int>((size + kAnimContainerChunkSize - 1) /
+                          kAnimContainerChunkSize);
+}
+
+const uint8_t* AnimContainerReader::ChunkStart(int frame, int chunk) const {
+  const size_t data_start =
+      kHeaderSize + frames_.size() * kDirectoryEntrySize;
+  const uint8_t* p = data_ + data_start + frames_[frame].data_offset;
+  const uint8_t* const end = data_ + size_;
+  for (int i = 0; i < chunk; ++i) {
+    if (end - p < static_cast<ptrdiff_t>(kChunkHeaderSize)) return nullptr;
+    const size_t compressed_size = ReadU32(p);
+    const size_t stored_size =
+        compressed_size == 0 ? ReadU32(p + 4) : compressed_size;
+    p += kChunkHeaderSize + stored_size;
+  }
+  return end - p < static_cast<ptrdiff_t>(kChunkHeaderSize) ? nullptr : p;
+}
+
+size_t AnimContainerReader::DecompressChunk(int frame, int chunk, void* dst,
+                                            size_t dst_capacity) const {
+  const uint8_t* p = ChunkStart(frame, chunk);
+  if (p == nullptr) return 0;
+
+  const size_t compressed_size = ReadU32(p);
+  const size_t uncompressed_size = ReadU32(p + 4);
+  const size_t stored_size =
+      compressed_size == 0 ? uncompressed_size : compressed_size;
+  p += kChunkHeaderSize;
+  if (p + stored_size > data_ + size_) return 0;
+  if (uncompressed_size > dst_capacity) return 0;
+
+  if (compressed_size == 0) {
+    memcpy(dst, p, uncompressed_size);
+    return uncompressed_size;
+  }
+  const size_t written =
+      LZDecompress(p, compressed_size, dst, uncompressed_size);
+  return written == uncompressed_size ? written : 0;
+}
+
+bool AnimContainerReader::DecompressFrame(int frame, std::string* out) const {
+  const size_t frame_size = frames_[frame].uncompressed_size;
+  out->resize(frame_size);
+
+  size_t pos = 0;
+  const int num_chunks = NumChunks(frame);
+  for (int chunk = 0; chunk < num_chunks; ++chunk) {
+    const size_t written =
+        DecompressChunk(frame, chunk, &(*out)[0] + pos, frame_size - pos);
+    if (written == 0) return false;
+    pos += written;
+  }
+  return pos == frame_size;
+}
+
+const char* DecompressAnimFrameByHash(const void* container,
+                                      size_t container_size,
+                                      uint64_t name_hash,
+                                      std::string* scratch_buf) {
+  AnimContainerReader reader;
+  if (!reader.Init(container, container_size)) return nullptr;
+  const int frame = reader.FrameForHash(name_hash);
+  if (frame < 0) return nullptr;
+  if (!reader.DecompressFrame(frame, scratch_buf)) return nullptr;
+  return scratch_buf->c_str();
+}
+
+}  // namespace motive
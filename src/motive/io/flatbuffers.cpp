@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "motive/io/flatbuffers.h"
+#include <map>
+#include <set>
 #include "anim_generated.h"
 #include "anim_table_generated.h"
 #include "motive/overshoot_init.h"
@@ -39,6 +41,10 @@ MOTIVE_VERIFY_MATRIX_OP_ENUM(kScaleX);
 MOTIVE_VERIFY_MATRIX_OP_ENUM(kScaleY);
 MOTIVE_VERIFY_MATRIX_OP_ENUM(kScaleZ);
 MOTIVE_VERIFY_MATRIX_OP_ENUM(kScaleUniformly);
+MOTIVE_VERIFY_MATRIX_OP_ENUM(kQuaternionW);
+MOTIVE_VERIFY_MATRIX_OP_ENUM(kQuaternionX);
+MOTIVE_VERIFY_MATRIX_OP_ENUM(kQuaternionY);
+MOTIVE_VERIFY_MATRIX_OP_ENUM(kQuaternionZ);
 MOTIVE_VERIFY_MATRIX_OP_ENUM(kNumMatrixOperationTypes);
 #undef MOTIVE_VERIFY_OP_ENUM
 
@@ -68,19 +74,53 @@ void Settled1fFromFlatBuffers(const Settled1fParameters& params,
   settled->max_difference = params.max_difference();
 }
 
-void MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim) {
-  std::vector<MatrixOperationInit>& ops = anim->ops();
-  ops.clear();
-  ops.reserve(params.ops()->size());
+// The quantized node layouts must match for the bulk copy in
+// MatrixAnimFromFlatBuffers() below. Both are (x:uint16, y:uint16,
+// angle:int16), but the compiler may only be trusted about the sizes.
+static_assert(sizeof(CompactSplineNodeFb) == sizeof(detail::CompactSplineNode),
+              "FlatBuffer node and CompactSplineNode layouts do not match");
+
+// anim_pipeline emits channels with identical fitted curves as one shared
+// CompactSplineFb table, referenced by every matching op; see
+// FlatAnim::CreateRigAnimFbFromBoneRange(). Tracking the tables already
+// converted--by table pointer, since shared references resolve to the same
+// address--carries the deduplication through to runtime spline memory.
+typedef std::map<const CompactSplineFb*, const CompactSpline*> SplineFbMap;
 
-  // Count the number of splines.
+// Count the number of splines in `params`, and add to `spline_bytes` the
+// total memory their CompactSpline images occupy. Spline tables already in
+// `counted` are shared with an earlier op and occupy no further memory.
+static int CountSplines(const MatrixAnimFb& params, size_t* spline_bytes,
+                        std::set<const CompactSplineFb*>* counted) {
   int num_splines = 0;
   for (auto op = params.ops()->begin(); op != params.ops()->end(); ++op) {
-    if (op->value_type() == MatrixOpValueFb_CompactSplineFb) num_splines++;
+    if (op->value_type() != MatrixOpValueFb_CompactSplineFb) continue;
+    num_splines++;
+    const CompactSplineFb* spline_fb =
+        reinterpret_cast<const CompactSplineFb*>(op->value());
+    if (spline_fb && counted->insert(spline_fb).second) {
+      *spline_bytes += CompactSpline::Size(
+          static_cast<CompactSplineIndex>(spline_fb->nodes()->size()));
+    }
   }
+  return num_splines;
+}
+
+static uint8_t* MatrixAnimFromFlatBuffers(const MatrixAnimFb& params,
+                                          MatrixAnim* anim,
+                                          uint8_t* spline_buffer,
+                                          SplineFbMap* created) {
+  std::vector<MatrixOperationInit>& ops = anim->ops();
+  ops.clear();
+  ops.reserve(params.ops()->size());
 
   // Initialize the output structure with the correct number of splines.
+  // All splines live contiguously in `spline_buffer`, owned by the caller.
+  size_t spline_bytes = 0;
+  std::set<const CompactSplineFb*> counted;
+  const int num_splines = CountSplines(params, &spline_bytes, &counted);
   MatrixAnim::Spline* splines = anim->Construct(num_splines);
+  uint8_t* spline_buf = spline_buffer;
 
   // Loop through each op, adding to the MatrixAnim ops.
   int spline_idx = 0;
@@ -100,25 +140,34 @@ void MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim) {
         s.init = SplineInit(op_range);
 
         if (spline_fb) {
-          // Ensure the spline will fit into our memory buffer.
+          // Ops sharing a spline table bind to the CompactSpline converted
+          // for the first such op, so duplicated channels share one node
+          // array at runtime.
+          auto shared = created->find(spline_fb);
+          if (shared != created->end()) {
+            ops.emplace_back(op->id(), op_type, s.init, *shared->second);
+            break;
+          }
+
+          // Create the CompactSpline inside the caller's spline buffer.
+          // It is owned by the buffer, so `s.spline` stays null.
           const CompactSplineIndex num_spline_nodes =
               static_cast<CompactSplineIndex>(spline_fb->nodes()->size());
+          CompactSpline* spline =
+              CompactSpline::CreateInPlace(num_spline_nodes, spline_buf);
+          spline_buf += spline->Size();
 
-          // Create the CompactSpline in the memory buffer.
-          s.spline = CompactSpline::Create(num_spline_nodes);
-
-          // Copy the spline data into s.spline.
-          // TODO: modify CompactSpline so we can just point at spline data
-          //       instead of copying it.
+          // The quantized node data in the FlatBuffer has the same layout as
+          // CompactSpline's nodes (see static_assert above), so the nodes can
+          // be copied in bulk instead of being re-added one at a time.
           const Range y_range(spline_fb->y_range_start(),
                               spline_fb->y_range_end());
-          s.spline->Init(y_range, spline_fb->x_granularity());
-          for (auto n = spline_fb->nodes()->begin();
-               n != spline_fb->nodes()->end(); ++n) {
-            s.spline->AddNodeVerbatim(n->x(), n->y(), n->angle());
-          }
-          assert(s.spline->num_nodes() == s.spline->max_nodes());
-          ops.emplace_back(op->id(), op_type, s.init, *s.spline);
+          spline->Init(y_range, spline_fb->x_granularity());
+          spline->AddNodesVerbatim(spline_fb->nodes()->Data(),
+                                   num_spline_nodes);
+          assert(spline->num_nodes() == spline->max_nodes());
+          (*created)[spline_fb] = spline;
+          ops.emplace_back(op->id(), op_type, s.init, *spline);
         } else {
           ops.emplace_back(op->id(), op_type, s.init);
         }
@@ -136,6 +185,23 @@ void MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim) {
         assert(false);  // Invalid FlatBuffer data.
     }
   }
+  return spline_buf;
+}
+
+uint8_t* MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim,
+                                   uint8_t* spline_buffer) {
+  SplineFbMap created;
+  return MatrixAnimFromFlatBuffers(params, anim, spline_buffer, &created);
+}
+
+void MatrixAnimFromFlatBuffers(const MatrixAnimFb& params, MatrixAnim* anim) {
+  // Standalone anim: all splines live in one buffer owned by the MatrixAnim,
+  // so loading performs a single allocation rather than one per spline.
+  size_t spline_bytes = 0;
+  std::set<const CompactSplineFb*> counted;
+  CountSplines(params, &spline_bytes, &counted);
+  MatrixAnimFromFlatBuffers(params, anim,
+                            anim->AllocateSplineBuffer(spline_bytes));
 }
 
 // Maximum duration of any of the splines.
@@ -151,11 +217,13 @@ static MotiveTime EndTime(const std::vector<MatrixOperationInit>& ops) {
   return end_time;
 }
 
-void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim) {
+void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim,
+                            bool strip_debug_names) {
   const size_t num_bones = flatbuffers::VectorLength(params.matrix_anims());
   const auto names = params.bone_names();
   const auto parents = params.bone_parents();
-  const bool record_names = names != nullptr && names->Length() == num_bones;
+  const bool record_names =
+      !strip_debug_names && names != nullptr && names->Length() == num_bones;
   assert(flatbuffers::VectorLength(parents) == num_bones);
 
   const char* anim_name =
@@ -163,12 +231,28 @@ void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim) {
   anim->Init(anim_name, static_cast<motive::BoneIndex>(num_bones),
              record_names);
 
+  // Pool every bone's splines in one buffer owned by the RigAnim, so that
+  // loading a rig performs one spline allocation rather than one per bone,
+  // and evaluating the anim walks one contiguous memory region. Spline
+  // sharing crosses bones--mirrored limbs live on different bones--so the
+  // counted and created tables span the whole rig.
+  size_t total_spline_bytes = 0;
+  std::set<const CompactSplineFb*> counted;
+  for (BoneIndex i = 0; i < num_bones; ++i) {
+    CountSplines(*params.matrix_anims()->Get(i), &total_spline_bytes,
+                 &counted);
+  }
+  uint8_t* spline_buf = anim->AllocateSplineBuffer(total_spline_bytes);
+
   MotiveTime end_time = 0;
+  SplineFbMap created;
   for (BoneIndex i = 0; i < num_bones; ++i) {
     const BoneIndex parent = parents->Get(i);
     const char* name = record_names ? names->Get(i)->c_str() : "";
     MatrixAnim& m = anim->InitMatrixAnim(i, parent, name);
-    MatrixAnimFromFlatBuffers(*params.matrix_anims()->Get(i), &m);
+    spline_buf =
+        MatrixAnimFromFlatBuffers(*params.matrix_anims()->Get(i), &m,
+                                  spline_buf, &created);
     end_time = std::max(end_time, EndTime(m.ops()));
   }
 
@@ -176,6 +260,47 @@ void RigAnimFromFlatBuffers(const RigAnimFb& params, RigAnim* anim) {
   anim->set_end_time(params.repeat() ? std::numeric_limits<MotiveTime>::max()
                                      : end_time);
   anim->set_repeat(params.repeat() != 0);
+
+  // The ops are final now, so pack them for sequential iteration.
+  anim->PackOps();
+}
+
+const char* AnimNameFromAnimBuffer(const void* buf) {
+  const RigAnimFb& params = *GetRigAnimFb(buf);
+  return params.name() == nullptr ? nullptr : params.name()->c_str();
+}
+
+const char* BoneNameFromAnimBuffer(const void* buf, int bone_idx) {
+  const RigAnimFb& params = *GetRigAnimFb(buf);
+  const auto names = params.bone_names();
+  if (names == nullptr || bone_idx < 0 ||
+      static_cast<flatbuffers::uoffset_t>(bone_idx) >= names->Length()) {
+    return nullptr;
+  }
+  return names->Get(bone_idx)->c_str();
+}
+
+uint64_t HashAnimBuffer(const void* buf, size_t len) {
+  // 64-bit FNV-1a, the same hash AnimTable::HashAnimName() uses for names.
+  const uint8_t* bytes = static_cast<const uint8_t*>(buf);
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ static_cast<uint64_t>(bytes[i])) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+bool VerifyAnimBuffer(const void* buf, size_t len,
+                      uint64_t pre_verified_hash) {
+  // A matching content hash means the buffer is byte-for-byte the one the
+  // build pipeline verified at pack time, so the structural check can be
+  // skipped.
+  if (pre_verified_hash != 0 &&
+      HashAnimBuffer(buf, len) == pre_verified_hash) {
+    return true;
+  }
+  flatbuffers::Verifier verifier(static_cast<const uint8_t*>(buf), len);
+  return VerifyRigAnimFbBuffer(verifier);
 }
 
 }  // namespace motive
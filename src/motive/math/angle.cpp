@@ -28,6 +28,18 @@ static const mathfu::vec3 kUpVectors[] = {
 static_assert(MOTIVE_ARRAY_SIZE(kUpVectors) == kAngleToVectorCount,
               "kUpVectors out of sync with AngleToVectorSystem enum");
 
+// static
+void Angle::WrapAngles(const float* in, size_t count, float* out) {
+  // Same arithmetic as WrapAngle(), element by element. The ternary
+  // compiles to a select, so the loop has no branches and the compiler can
+  // vectorize it to wrap several angles per iteration.
+  for (size_t i = 0; i < count; ++i) {
+    const float angle = in[i];
+    const float wrapped = angle - (floor(angle / kTwoPi) + 1.0f) * kTwoPi;
+    out[i] = wrapped <= -kPi ? wrapped + kTwoPi : wrapped;
+  }
+}
+
 // static
 const mathfu::vec3& VectorSystemUp(const AngleToVectorSystem system) {
   assert(0 <= system && system < kAngleToVectorCount);
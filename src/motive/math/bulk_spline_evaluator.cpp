@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <vector>
@@ -20,6 +21,10 @@
 #include "motive/math/dual_cubic.h"
 #include "motive/util/benchmark.h"
 
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>  // For _mm_prefetch().
+#endif
+
 using mathfu::Lerp;
 
 namespace motive {
@@ -35,6 +40,48 @@ extern "C" void EvaluateCubics_Neon(const CubicCurve* curves, const float* xs,
                                     const void* y_ranges, int num_curves,
                                     float* ys);
 
+#if defined(MOTIVE_NEON_INTRINSICS)
+// These functions are implemented with NEON intrinsics in
+// bulk_spline_evaluator_neon_intrinsics.cpp. They are used on NEON targets
+// that the hand-written 32-bit assembly above cannot serve, e.g. AArch64.
+extern "C" void EvaluateCubics_NeonIntrinsics(const void* curves,
+                                              const float* xs, int num_curves,
+                                              float* ys);
+extern "C" void UpdateCubicXsAndGetMask_NeonIntrinsics(
+    float delta_x, const float* x_ends, const void* sources, int source_stride,
+    int num_xs, float* xs, uint8_t* masks);
+#endif  // defined(MOTIVE_NEON_INTRINSICS)
+
+#if defined(MOTIVE_AVX2)
+// These functions are implemented with AVX2+FMA intrinsics in
+// bulk_spline_evaluator_avx2.cpp, which is compiled with AVX2 code generation
+// enabled. They process eight cubics per iteration.
+extern "C" void EvaluateCubics_Avx2(const void* curves, const float* xs,
+                                    int num_curves, float* ys);
+extern "C" void UpdateCubicXsAndGetMask_Avx2(float delta_x,
+                                             const float* x_ends,
+                                             const void* sources,
+                                             int source_stride, int num_xs,
+                                             float* xs, uint8_t* masks);
+#endif  // defined(MOTIVE_AVX2)
+
+// Hint the processor to pull the cache line holding `address` into cache,
+// for reading. Purely a performance hint: on compilers without a prefetch
+// intrinsic this compiles to nothing, and the address is never dereferenced.
+static inline void PrefetchForRead(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+  __builtin_prefetch(address, 0 /* read */, 3 /* keep in all cache levels */);
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+  _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+  (void)address;
+#endif
+}
+
+// Out-of-line definition, since std::vector::resize() takes the fill value
+// by const reference.
+const BulkSplineEvaluator::Index BulkSplineEvaluator::kNoPlaybackMaster;
+
 void BulkSplineEvaluator::SetNumIndices(const Index num_indices) {
   sources_.resize(num_indices);
   y_ranges_.resize(num_indices);
@@ -43,6 +90,119 @@ void BulkSplineEvaluator::SetNumIndices(const Index num_indices) {
   cubics_.resize(num_indices);
   ys_.resize(num_indices, 0.0f);
   scratch_.resize(num_indices, 0);
+  dormant_.resize(num_indices, 0);
+  if (!completed_.empty()) {
+    completed_.resize(num_indices, 0);
+  }
+  if (!crossing_states_.empty()) {
+    crossing_ys_.resize(num_indices, 0.0f);
+    crossing_states_.resize(num_indices, 0);
+  }
+  if (!loop_x_ends_.empty()) {
+    loop_cubics_.resize(num_indices);
+    loop_x_ends_.resize(num_indices, 0.0f);
+  }
+  if (!follower_masters_.empty()) {
+    follower_masters_.resize(num_indices, kNoPlaybackMaster);
+  }
+}
+
+size_t BulkSplineEvaluator::AllocatedBytes() const {
+  return sources_.capacity() * sizeof(Source) +
+         y_ranges_.capacity() * sizeof(YRange) +
+         (cubic_xs_.capacity() + cubic_x_ends_.capacity() + ys_.capacity()) *
+             sizeof(float) +
+         cubics_.capacity() * sizeof(CubicCurve) +
+         scratch_.capacity() * sizeof(Index) +
+         dormant_.capacity() * sizeof(uint8_t) +
+         completed_.capacity() * sizeof(uint8_t) +
+         crossing_ys_.capacity() * sizeof(float) +
+         crossing_states_.capacity() * sizeof(uint8_t) +
+         loop_cubics_.capacity() * sizeof(CubicCurve) +
+         loop_x_ends_.capacity() * sizeof(float) +
+         follower_masters_.capacity() * sizeof(Index);
+}
+
+size_t BulkSplineEvaluator::BytesPerIndex() {
+  // One element of each array in SetNumIndices(), counting `completed_`,
+  // the crossing arrays, the loop-cubic cache, and the follower masters
+  // even though they're only populated when their features are in use.
+  return sizeof(Source) + sizeof(YRange) + 5 * sizeof(float) +
+         2 * sizeof(CubicCurve) + 2 * sizeof(Index) + 3 * sizeof(uint8_t);
+}
+
+void BulkSplineEvaluator::SetTrackCompletions(bool enable) {
+  if (enable) {
+    completed_.assign(NumIndices(), 0);
+  } else {
+    completed_.clear();
+  }
+}
+
+void BulkSplineEvaluator::ClearCompletions() {
+  std::fill(completed_.begin(), completed_.end(), static_cast<uint8_t>(0));
+}
+
+void BulkSplineEvaluator::SetCrossingThreshold(
+    const Index index, const float y, const MotiveCrossingDirection direction) {
+  if (crossing_states_.empty()) {
+    crossing_ys_.assign(NumIndices(), 0.0f);
+    crossing_states_.assign(NumIndices(), 0);
+  }
+  crossing_ys_[index] = y;
+
+  // Seed the side from the current value, so that registration itself never
+  // reports a crossing.
+  crossing_states_[index] =
+      static_cast<uint8_t>((direction & kCrossingDirectionMask) |
+                           (ys_[index] > y ? kCrossingAboveBit : 0));
+}
+
+void BulkSplineEvaluator::ClearCrossingThreshold(const Index index) {
+  if (crossing_states_.empty()) return;
+  crossing_states_[index] = 0;
+}
+
+void BulkSplineEvaluator::CollectCrossings(std::vector<Crossing>* crossings) {
+  const Index num_states = static_cast<Index>(crossing_states_.size());
+  for (Index i = 0; i < num_states; ++i) {
+    const uint8_t fired = static_cast<uint8_t>(
+        (crossing_states_[i] >> kCrossingFiredShift) & kCrossingDirectionMask);
+    if (fired == 0) continue;
+    crossing_states_[i] &= static_cast<uint8_t>(
+        ~(kCrossingDirectionMask << kCrossingFiredShift));
+
+    Crossing crossing;
+    crossing.index = i;
+    if (fired & kCrossingRising) {
+      crossing.direction = kCrossingRising;
+      crossings->push_back(crossing);
+    }
+    if (fired & kCrossingFalling) {
+      crossing.direction = kCrossingFalling;
+      crossings->push_back(crossing);
+    }
+  }
+}
+
+void BulkSplineEvaluator::DetectCrossings(const Index start, const Index end) {
+  for (Index i = start; i < end; ++i) {
+    const uint8_t state = crossing_states_[i];
+    const uint8_t directions = state & kCrossingDirectionMask;
+    if (directions == 0) continue;
+
+    const uint8_t above =
+        ys_[i] > crossing_ys_[i] ? kCrossingAboveBit : static_cast<uint8_t>(0);
+    if (above == (state & kCrossingAboveBit)) continue;
+
+    // The value changed sides. Record the crossing if its direction is
+    // registered; fired bits accumulate until CollectCrossings().
+    const uint8_t crossed = above != 0 ? kCrossingRising : kCrossingFalling;
+    const uint8_t fired =
+        static_cast<uint8_t>((directions & crossed) << kCrossingFiredShift);
+    crossing_states_[i] = static_cast<uint8_t>(
+        (state & ~kCrossingAboveBit) | above | fired);
+  }
 }
 
 void BulkSplineEvaluator::MoveIndices(
@@ -56,6 +216,106 @@ void BulkSplineEvaluator::MoveIndices(
     cubic_x_ends_[new_i] = cubic_x_ends_[old_i];
     cubics_[new_i] = cubics_[old_i];
     ys_[new_i] = ys_[old_i];
+    dormant_[new_i] = dormant_[old_i];
+    if (!completed_.empty()) {
+      completed_[new_i] = completed_[old_i];
+    }
+    if (!crossing_states_.empty()) {
+      crossing_ys_[new_i] = crossing_ys_[old_i];
+      crossing_states_[new_i] = crossing_states_[old_i];
+    }
+    if (!loop_x_ends_.empty()) {
+      loop_cubics_[new_i] = loop_cubics_[old_i];
+      loop_x_ends_[new_i] = loop_x_ends_[old_i];
+    }
+    if (!follower_masters_.empty()) {
+      follower_masters_[new_i] = follower_masters_[old_i];
+    }
+  }
+
+  // Followers anywhere may reference a master that just moved; retarget
+  // them. Masters that are overwritten without moving--e.g. when the hole
+  // being filled belonged to one--orphan their followers, as documented on
+  // SetPlaybackMaster().
+  if (!follower_masters_.empty()) {
+    const Index delta = new_index - old_index;
+    for (size_t i = 0; i < follower_masters_.size(); ++i) {
+      const Index master = follower_masters_[i];
+      if (master >= old_index && master < old_index + count) {
+        follower_masters_[i] = master + delta;
+      }
+    }
+  }
+}
+
+void BulkSplineEvaluator::CopyIndices(const Index index, const Index count,
+                                      const BulkSplineEvaluator& source,
+                                      const Index source_index) {
+  for (Index i = 0; i < count; ++i) {
+    const Index src_i = source_index + i;
+    const Index dst_i = index + i;
+    sources_[dst_i] = source.sources_[src_i];
+    y_ranges_[dst_i] = source.y_ranges_[src_i];
+    cubic_xs_[dst_i] = source.cubic_xs_[src_i];
+    cubic_x_ends_[dst_i] = source.cubic_x_ends_[src_i];
+    cubics_[dst_i] = source.cubics_[src_i];
+    ys_[dst_i] = source.ys_[src_i];
+    dormant_[dst_i] = source.dormant_[src_i];
+    if (!completed_.empty()) {
+      completed_[dst_i] =
+          source.completed_.empty() ? 0 : source.completed_[src_i];
+    }
+    if (!crossing_states_.empty()) {
+      crossing_ys_[dst_i] =
+          source.crossing_ys_.empty() ? 0.0f : source.crossing_ys_[src_i];
+      crossing_states_[dst_i] =
+          source.crossing_states_.empty() ? 0 : source.crossing_states_[src_i];
+    }
+
+    // Rebuild rather than copy the loop-cubic cache: this evaluator's cache
+    // arrays may not be allocated yet, and the rebuild allocates them only
+    // if the migrated index actually repeats.
+    UpdateLoopCubic(dst_i);
+
+    // A master index is meaningless in another evaluator, so migrated
+    // followers resume independent evaluation from their mirrored state;
+    // the caller re-registers them if the master migrates too. Clearing
+    // the skip flag keeps them advancing.
+    if (!source.follower_masters_.empty() &&
+        source.follower_masters_[src_i] != kNoPlaybackMaster) {
+      dormant_[dst_i] = 0;
+    }
+    if (!follower_masters_.empty()) {
+      follower_masters_[dst_i] = kNoPlaybackMaster;
+    }
+  }
+}
+
+void BulkSplineEvaluator::NormalizedYs(const Index index, const Index count,
+                                       float* out) const {
+  // Partition [index, index + count) into runs that share the same modular
+  // range. SetYRanges() is applied to whole channels, so in practice a
+  // block is one or two runs: most indices have an invalid (non-modular)
+  // range, and the modular ones--e.g. the three angles of a rotation--share
+  // a range. Each run then gets a specialized branch-free loop: a straight
+  // copy for non-modular runs, and Range's batch normalization (which
+  // vectorizes over the common within-one-length case) for modular runs.
+  Index run_start = 0;
+  while (run_start < count) {
+    const Range& r = y_ranges_[index + run_start].modular_range;
+    Index run_end = run_start + 1;
+    while (run_end < count && y_ranges_[index + run_end].modular_range == r) {
+      ++run_end;
+    }
+
+    const float* run_ys = &ys_[index + run_start];
+    const size_t run_count = static_cast<size_t>(run_end - run_start);
+    if (r.Valid()) {
+      r.NormalizeCloseValues(run_ys, run_count, out + run_start);
+    } else {
+      std::copy(run_ys, run_ys + run_count, out + run_start);
+    }
+    run_start = run_end;
   }
 }
 
@@ -143,6 +403,9 @@ void BulkSplineEvaluator::BlendToSpline(const Index index,
   cubic_x_ends_[index] = cubic_start_x + playback.blend_x;
   cubics_[index].Init(blend_init);
   cubics_[index].ShiftRight(cubic_start_x);
+  SetDormant(index, false);
+  UpdateLoopCubic(index);
+  StopFollowing(index);
 }
 
 void BulkSplineEvaluator::JumpToSpline(const Index index,
@@ -155,6 +418,9 @@ void BulkSplineEvaluator::JumpToSpline(const Index index,
   s.spline = &spline;
   s.x_index = kInvalidSplineIndex;
   s.repeat = playback.repeat;
+  SetDormant(index, false);
+  UpdateLoopCubic(index);
+  StopFollowing(index);
   InitCubic(index, playback.start_x);
 }
 
@@ -200,12 +466,113 @@ void BulkSplineEvaluator::ClearSplines(const Index index, const Index count) {
     cubics_[i] = CubicCurve(0.0f, 0.0f, 0.0f, cubic_xs_[i]);
     cubic_xs_[i] = 0.0f;
     cubic_x_ends_[i] = std::numeric_limits<float>::infinity();
+
+    // A cleared index evaluates to a constant forever, so skip it too.
+    SetDormant(i, true);
+
+    // Cleared indices get recycled for new motivators, which must not
+    // inherit the old owner's threshold or master.
+    if (!crossing_states_.empty()) crossing_states_[i] = 0;
+    StopFollowing(i);
+  }
+}
+
+void BulkSplineEvaluator::SetConstantYs(const Index index, const Index count,
+                                        const float y) {
+  ClearSplines(index, count);
+  for (Index i = index; i < index + count; ++i) {
+    ys_[i] = y;
+  }
+}
+
+void BulkSplineEvaluator::SetPlaybackMaster(const Index index,
+                                            const Index master) {
+  assert(index != master && Valid(master));
+  assert(!FollowingMaster(master));  // Chains are not supported.
+  if (follower_masters_.empty()) {
+    follower_masters_.resize(NumIndices(), kNoPlaybackMaster);
+  }
+  follower_masters_[index] = master;
+
+  // Snap onto the master's playback. Mirroring the full per-index state
+  // keeps every accessor--X(), Derivative(), Cubic()--valid without any
+  // redirection. The dormant byte doubles as the skip flag that keeps the
+  // advance paths off this index; Dormant() filters followers out.
+  sources_[index] = sources_[master];
+  cubic_xs_[index] = cubic_xs_[master];
+  cubic_x_ends_[index] = cubic_x_ends_[master];
+  cubics_[index] = cubics_[master];
+  ys_[index] = ys_[master];
+  UpdateLoopCubic(index);
+  dormant_[index] = 1;
+  if (!completed_.empty()) completed_[index] = 0;
+}
+
+void BulkSplineEvaluator::ClearPlaybackMaster(const Index index) {
+  if (!FollowingMaster(index)) return;
+  const Index master = follower_masters_[index];
+  follower_masters_[index] = kNoPlaybackMaster;
+
+  // Resume independent evaluation from the phase mirrored last. A follower
+  // of a genuinely dormant master is itself finished, so it stays skipped.
+  dormant_[index] = dormant_[master];
+}
+
+// Copy each follower's value and playback state from its master; see
+// SetPlaybackMaster(). Runs once per advance, after the masters have been
+// advanced and evaluated. The per-follower cost is a few float copies;
+// cubic coefficients are only copied when the master entered a new
+// segment, which its spline pointer and x_index record.
+void BulkSplineEvaluator::BroadcastToFollowers() {
+  const Index num_indices = NumIndices();
+  for (Index i = 0; i < num_indices; ++i) {
+    const Index master = follower_masters_[i];
+    if (master == kNoPlaybackMaster) continue;
+
+    ys_[i] = ys_[master];
+    cubic_xs_[i] = cubic_xs_[master];
+
+    const Source& master_source = sources_[master];
+    Source& source = sources_[i];
+    source.rate = master_source.rate;  // Derivative() reads our own rate.
+    if (source.spline != master_source.spline) {
+      // The master was given a new spline--e.g. the whole group switched
+      // clips through it. Followers pick up the new loop cubic too.
+      source = master_source;
+      cubic_x_ends_[i] = cubic_x_ends_[master];
+      cubics_[i] = cubics_[master];
+      UpdateLoopCubic(i);
+    } else if (source.x_index != master_source.x_index) {
+      source.x_index = master_source.x_index;
+      cubic_x_ends_[i] = cubic_x_ends_[master];
+      cubics_[i] = cubics_[master];
+    }
+  }
+}
+
+void BulkSplineEvaluator::NotifySplineEdited(const CompactSpline* spline) {
+  assert(spline != nullptr);
+  for (Index i = 0; i < NumIndices(); ++i) {
+    Source& s = sources_[i];
+    if (s.spline != spline) continue;
+
+    // Both the current cubic and the cached loop-wrap cubic may describe
+    // segments that no longer exist. Rebuild them at the current x, and
+    // wake the index in case a finished spline grew a new tail.
+    const float x = X(i);
+    SetDormant(i, false);
+    s.x_index = kInvalidSplineIndex;
+    UpdateLoopCubic(i);
+    InitCubic(i, x);
+    EvaluateIndex(i);
   }
 }
 
 void BulkSplineEvaluator::SetXs(const Index index, const Index count,
                                 const float x) {
   for (Index i = index; i < index + count; ++i) {
+    SetDormant(i, false);
+    StopFollowing(i);
     InitCubic(i, x);
     EvaluateIndex(i);
   }
@@ -283,11 +650,62 @@ size_t BulkSplineEvaluator::UpdateCubicXs_OneStep(const float delta_x,
   return num_to_init;
 }
 
+// Cache the cubic of `index`'s first spline segment, with the index's
+// y-scale and y-offset baked in, so that a loop wraparound in InitCubic()
+// is a coefficient copy instead of a node lookup and recomputation. Called
+// whenever a spline is assigned to `index`. The cache arrays are only
+// allocated once some index repeats, since most evaluators never loop.
+void BulkSplineEvaluator::UpdateLoopCubic(const Index index) {
+  const Source& s = sources_[index];
+  const bool loops =
+      s.repeat && s.spline != nullptr && s.spline->num_nodes() >= 2;
+  if (!loops) {
+    if (!loop_x_ends_.empty()) loop_x_ends_[index] = 0.0f;
+    return;
+  }
+
+  if (loop_cubics_.empty()) {
+    loop_cubics_.resize(NumIndices());
+    loop_x_ends_.resize(NumIndices(), 0.0f);
+  }
+  CubicCurve& c = loop_cubics_[index];
+  c.Init(s.spline->CreateCubicInit(0));
+  c.ScaleUp(s.y_scale);
+  c.ShiftUp(s.y_offset);
+  loop_x_ends_[index] = s.spline->RangeX(0).Length();
+}
+
 void BulkSplineEvaluator::InitCubic(const Index index, const float start_x) {
   // Do nothing if the requested index has no spline.
   Source& s = sources_[index];
   if (s.spline == nullptr) return;
 
+  AddMotiveEvents(kMotiveEventCubicInits, 1);
+
+  // Loop wraparound fast path. When hundreds of indices play the same
+  // looped clip in lockstep, they all run off the spline's end in the same
+  // frame, and re-deriving every cubic from the nodes doubles that frame's
+  // cost. A wrap that lands in the first segment--the common case, since
+  // one frame rarely advances past it--instead copies the cubic cached by
+  // UpdateLoopCubic(). Matches the slow path exactly: the wrapped x below
+  // is the NormalizeCloseValue() result, and the cached cubic is the one
+  // CreateCubicInit(0) would build.
+  if (s.repeat && !loop_x_ends_.empty() && loop_x_ends_[index] > 0.0f) {
+    const float end_x = s.spline->EndX();
+    if (start_x > end_x) {
+      const float wrapped_x = start_x - end_x;
+      const float first_segment_start = s.spline->StartX();
+      if (wrapped_x >= first_segment_start &&
+          wrapped_x < first_segment_start + loop_x_ends_[index]) {
+        s.x_index = 0;
+        cubic_xs_[index] = wrapped_x - first_segment_start;
+        cubic_x_ends_[index] = loop_x_ends_[index];
+        cubics_[index] = loop_cubics_[index];
+        return;
+      }
+    }
+  }
+
   // Get the spline index for start_x.
   float new_start_x = 0.0f;
   const CompactSplineIndex x_index = s.spline->IndexForXAllowingRepeat(
@@ -313,6 +731,62 @@ void BulkSplineEvaluator::InitCubic(const Index index, const float start_x) {
   c.ShiftUp(s.y_offset);
 }
 
+void BulkSplineEvaluator::FutureYs(const Index index, const Index count,
+                                   const float* lookaheads, float* future_ys,
+                                   float* future_derivatives) const {
+  for (Index i = 0; i < count; ++i) {
+    const Index idx = index + i;
+    const Source& s = sources_[idx];
+    assert(lookaheads[i] >= 0.0f);
+    const float future_x = cubic_xs_[idx] + lookaheads[i] * s.rate;
+
+    // Common case: the predicted x is still inside the current cubic, so
+    // the coefficients already in hand answer the query. Splineless and
+    // finished indices also land here, since their `cubic_x_ends_` is
+    // infinite.
+    if (future_x <= cubic_x_ends_[idx] || s.spline == nullptr) {
+      const CubicCurve& c = cubics_[idx];
+      future_ys[i] = c.Evaluate(future_x);
+      if (future_derivatives != nullptr) {
+        future_derivatives[i] = s.rate * c.Derivative(future_x);
+      }
+      continue;
+    }
+
+    // Cross node boundaries read-only: find the segment holding the
+    // predicted x and build its cubic locally, exactly as InitCubic()
+    // would, leaving the played-back state untouched.
+    float new_x = 0.0f;
+    const CompactSplineIndex x_index = s.spline->IndexForXAllowingRepeat(
+        CubicStartX(idx) + future_x, s.x_index + 1, s.repeat, &new_x);
+    const Range x_range = s.spline->RangeX(x_index);
+    CubicCurve c(s.spline->CreateCubicInit(x_index));
+    c.ScaleUp(s.y_scale);
+    c.ShiftUp(s.y_offset);
+    const float local_x = new_x - x_range.start();
+    future_ys[i] = c.Evaluate(local_x);
+    if (future_derivatives != nullptr) {
+      future_derivatives[i] = s.rate * c.Derivative(local_x);
+    }
+  }
+}
+
+void BulkSplineEvaluator::ExtrapolatedYs(const Index index, const Index count,
+                                         const float lookahead,
+                                         float* out) const {
+  assert(Valid(index) && Valid(index + count - 1) && lookahead >= 0.0f);
+
+  // Straight-line prediction from the already-evaluated state; a dormant
+  // index's constant cubic has zero derivative, so it simply holds its end
+  // value.
+  for (Index i = 0; i < count; ++i) {
+    const Index idx = index + i;
+    const float derivative =
+        sources_[idx].rate * cubics_[idx].Derivative(cubic_xs_[idx]);
+    out[i] = ys_[idx] + derivative * lookahead;
+  }
+}
+
 void BulkSplineEvaluator::EvaluateIndex(const Index index) {
   // Evaluate the cubic spline.
   CubicCurve& c = cubics_[index];
@@ -325,21 +799,206 @@ void BulkSplineEvaluator::EvaluateCubics_C() {
   }
 }
 
+// An index that has played off the end of a non-repeating spline holds
+// EndY() with zero derivative forever: InitCubic() has given it a constant
+// cubic and an infinite `cubic_x_ends_`. Mark it dormant so succeeding
+// AdvanceFrame() calls can skip it.
+void BulkSplineEvaluator::MarkDormantIfFinished(const Index index) {
+  const Source& s = sources_[index];
+  if (!s.repeat && s.x_index == kAfterSplineIndex) {
+    SetDormant(index, true);
+
+    // This is the one transition where an index arrives at the end of its
+    // spline, so completion tracking hooks in here. Set after SetDormant(),
+    // which clears the flag.
+    if (!completed_.empty()) {
+      completed_[index] = 1;
+    }
+  }
+}
+
+// Serial variant of AdvanceFrame() that skips dormant indices.
+// Newly-dormant indices are evaluated one last time, to record the spline's
+// end y-value, and then skipped from the next frame onward.
+void BulkSplineEvaluator::AdvanceFrameSkippingDormant(const float delta_x) {
+  const Index num_indices = NumIndices();
+  uint64_t num_crossed = 0;
+  for (Index i = 0; i < num_indices; ++i) {
+    if (dormant_[i] != 0) continue;
+
+    cubic_xs_[i] += delta_x * sources_[i].rate;
+    if (cubic_xs_[i] > cubic_x_ends_[i]) {
+      ++num_crossed;
+      InitCubic(i, X(i));
+      MarkDormantIfFinished(i);
+    }
+    EvaluateIndex(i);
+  }
+  if (num_crossed > 0) {
+    AddMotiveEvents(kMotiveEventSegmentCrossings, num_crossed);
+  }
+
+  // Followers mirror their (just-advanced) masters before crossings are
+  // detected, so thresholds on followers fire on this frame's values.
+  if (!follower_masters_.empty()) BroadcastToFollowers();
+
+  // Dormant indices never change sides, so scanning them all is correct;
+  // the pass is skipped entirely when no thresholds are registered.
+  if (!crossing_states_.empty()) DetectCrossings(0, num_indices);
+}
+
 void BulkSplineEvaluator::AdvanceFrame(const float delta_x) {
+  // When some indices are dormant, process the rest serially, skipping the
+  // dormant ones. In idle-heavy scenes, where most splines sit at their end
+  // values, this does far less work than the bulk algorithm below, which
+  // always processes every index. The count is a cheap byte scan, negligible
+  // next to the cubic evaluation it saves.
+  // Note that dormant indices are stable under the bulk algorithm too
+  // (constant cubic, infinite end-x), so the choice of path only affects
+  // performance, never output. Followers (see SetPlaybackMaster()) carry
+  // the dormant flag, so any follower also routes us through the skipping
+  // path, which is the one that broadcasts masters to followers.
+  const Index num_dormant = static_cast<Index>(
+      std::count(dormant_.begin(), dormant_.end(), static_cast<uint8_t>(1)));
+  if (num_dormant > 0) {
+    AdvanceFrameSkippingDormant(delta_x);
+    return;
+  }
+
   // Add 'delta_x' to 'cubic_xs'.
   // Gather a list of indices that are now beyond the end of the cubic.
   Index* indices_to_init = scratch_.size() == 0 ? nullptr : &scratch_.front();
   const size_t num_to_init = UpdateCubicXs(delta_x, indices_to_init);
+  if (num_to_init > 0) {
+    AddMotiveEvents(kMotiveEventSegmentCrossings, num_to_init);
+  }
+
+  // The re-init loop below chases sources_[index].spline into externally-
+  // owned node data, which costs a scattered cache miss per index when many
+  // splines cross a segment boundary on the same frame. Prefetch each
+  // spline's header and its upcoming node pair first, so those loads
+  // overlap instead of serializing with the cubic math. The guess index
+  // x_index + 1 is where IndexForXAllowingRepeat() starts its search; a
+  // repeating spline that loops back to its start misses the second hint
+  // but still benefits from the header line.
+  for (size_t i = 0; i < num_to_init; ++i) {
+    const Source& s = sources_[indices_to_init[i]];
+    if (s.spline == nullptr) continue;
+    PrefetchForRead(s.spline);
+    PrefetchForRead(s.spline->NodeAddressForPrefetch(
+        static_cast<CompactSplineIndex>(s.x_index + 1)));
+  }
 
   // Reinitialize indices that have traversed beyond the end of their cubic.
   for (size_t i = 0; i < num_to_init; ++i) {
     const Index index = indices_to_init[i];
     InitCubic(index, X(index));
+    MarkDormantIfFinished(index);
   }
 
   // Update 'ys_' array. Also might affect the constant coefficients of
   // 'cubics_', if we're adjusting for modular arithmetic.
   EvaluateCubics();
+
+  if (!crossing_states_.empty()) DetectCrossings(0, NumIndices());
+}
+
+void BulkSplineEvaluator::AdvanceFrameRange(const float delta_x,
+                                            const Index start,
+                                            const Index end) {
+  // Same algorithm as AdvanceFrameSkippingDormant(), restricted to
+  // [start, end). Re-inits are performed inline instead of being gathered,
+  // since each worker's range is small. Dormant flags are per-index bytes,
+  // so concurrent workers with non-overlapping ranges never write the same
+  // flag--nor the same cache line: the arrays are cache-line aligned and
+  // range boundaries fall on multiples of kIndicesPerCacheLine, so even
+  // the byte arrays split cleanly between workers. Playback followers are
+  // unsupported here: a follower's master may sit in another worker's
+  // range, so the broadcast would race with the master's update.
+  assert(follower_masters_.empty());
+  uint64_t num_crossed = 0;
+  for (Index i = start; i < end; ++i) {
+    if (dormant_[i] != 0) continue;
+
+    cubic_xs_[i] += delta_x * sources_[i].rate;
+    if (cubic_xs_[i] > cubic_x_ends_[i]) {
+      ++num_crossed;
+      InitCubic(i, X(i));
+      MarkDormantIfFinished(i);
+    }
+    EvaluateIndex(i);
+  }
+  if (num_crossed > 0) {
+    AddMotiveEvents(kMotiveEventSegmentCrossings, num_crossed);
+  }
+
+  if (!crossing_states_.empty()) DetectCrossings(start, end);
+}
+
+// Advance positions and segment state exactly as AdvanceFrame() does, but
+// leave `ys_` for an external evaluator. Dormant skipping matches
+// AdvanceFrameSkippingDormant(): a dormant index's cubic is constant, so
+// the external evaluator reproduces its held end value without special
+// casing. Note that the modular re-centering some optimized EvaluateCubics()
+// variants perform is skipped here; modular indices should be normalized by
+// the external evaluator using the ranges from ExportYRanges().
+void BulkSplineEvaluator::AdvanceFrameWithoutEvaluation(const float delta_x) {
+  const Index num_indices = NumIndices();
+  uint64_t num_crossed = 0;
+  for (Index i = 0; i < num_indices; ++i) {
+    if (dormant_[i] != 0) continue;
+
+    cubic_xs_[i] += delta_x * sources_[i].rate;
+    if (cubic_xs_[i] > cubic_x_ends_[i]) {
+      ++num_crossed;
+      InitCubic(i, X(i));
+      MarkDormantIfFinished(i);
+    }
+  }
+  if (num_crossed > 0) {
+    AddMotiveEvents(kMotiveEventSegmentCrossings, num_crossed);
+  }
+
+  // Mirror masters' cubic state onto followers so the external evaluator
+  // computes correct follower ys. The y copy is stale here--everyone's ys
+  // await ImportYs()--which is harmless.
+  if (!follower_masters_.empty()) BroadcastToFollowers();
+}
+
+void BulkSplineEvaluator::ExportCubics(const Index index, const Index count,
+                                       float* coefficients) const {
+  assert(0 <= index && index + count <= NumIndices());
+  float* out = coefficients;
+  for (Index i = index; i < index + count; ++i) {
+    const CubicCurve& c = cubics_[i];
+    for (int j = 0; j < CubicCurve::kNumCoeff; ++j) {
+      *out++ = c.Coeff(j);
+    }
+  }
+}
+
+void BulkSplineEvaluator::ExportCubicXs(const Index index, const Index count,
+                                        float* xs) const {
+  assert(0 <= index && index + count <= NumIndices());
+  std::copy(cubic_xs_.begin() + index, cubic_xs_.begin() + index + count, xs);
+}
+
+void BulkSplineEvaluator::ExportYRanges(const Index index, const Index count,
+                                        float* ranges) const {
+  assert(0 <= index && index + count <= NumIndices());
+  float* out = ranges;
+  for (Index i = index; i < index + count; ++i) {
+    const Range& r = y_ranges_[i].modular_range;
+    const bool modular = r.Valid();
+    *out++ = modular ? r.start() : 0.0f;
+    *out++ = modular ? r.Length() : 0.0f;
+  }
+}
+
+void BulkSplineEvaluator::ImportYs(const Index index, const Index count,
+                                   const float* ys) {
+  assert(0 <= index && index + count <= NumIndices());
+  std::copy(ys, ys + count, ys_.begin() + index);
 }
 
 bool BulkSplineEvaluator::Valid(const Index index) const {
@@ -360,7 +1019,7 @@ inline void BulkSplineEvaluator::UpdateCubicXsAndGetMask(const float delta_x,
                                                          uint8_t* masks) {
 #if defined(MOTIVE_ASSEMBLY_TEST)
   const int num_xs = NumIndices();
-  std::vector<float> xs_assembly(cubic_xs_);
+  std::vector<float> xs_assembly(cubic_xs_.begin(), cubic_xs_.end());
   std::vector<uint8_t> masks_assembly(num_xs);
 
   UpdateCubicXsAndGetMask_C(delta_x, masks);
@@ -380,6 +1039,22 @@ inline void BulkSplineEvaluator::UpdateCubicXsAndGetMask(const float delta_x,
     UpdateCubicXsAndGetMask_Neon(delta_x, &cubic_x_ends_.front(),
                                   NumIndices(), &cubic_xs_.front(), masks);
   } else
+#endif
+#if defined(MOTIVE_NEON_INTRINSICS)
+  if (optimization_ == kNeonOptimizations) {
+    UpdateCubicXsAndGetMask_NeonIntrinsics(
+        delta_x, &cubic_x_ends_.front(), &sources_.front().rate,
+        static_cast<int>(sizeof(Source)), NumIndices(), &cubic_xs_.front(),
+        masks);
+  } else
+#endif
+#if defined(MOTIVE_AVX2)
+  if (optimization_ == kAvx2Optimizations) {
+    UpdateCubicXsAndGetMask_Avx2(
+        delta_x, &cubic_x_ends_.front(), &sources_.front().rate,
+        static_cast<int>(sizeof(Source)), NumIndices(), &cubic_xs_.front(),
+        masks);
+  } else
 #endif
   {
     UpdateCubicXsAndGetMask_C(delta_x, masks);
@@ -391,13 +1066,13 @@ inline void BulkSplineEvaluator::UpdateCubicXsAndGetMask(const float delta_x,
 inline size_t BulkSplineEvaluator::UpdateCubicXs(const float delta_x,
                                                  Index* indices_to_init) {
 #if defined(MOTIVE_ASSEMBLY_TEST)
-  std::vector<float> xs_original(cubic_xs_);
+  std::vector<float> xs_original(cubic_xs_.begin(), cubic_xs_.end());
   std::vector<Index> indices_one(NumIndices());
 
   const size_t num_one = UpdateCubicXs_OneStep(delta_x, &indices_one.front());
-  std::vector<float> xs_one(cubic_xs_);
+  std::vector<float> xs_one(cubic_xs_.begin(), cubic_xs_.end());
 
-  cubic_xs_ = xs_original;
+  cubic_xs_.assign(xs_original.begin(), xs_original.end());
   const size_t num_two = UpdateCubicXs_TwoSteps(delta_x, indices_to_init);
 
   assert(num_two == num_one);
@@ -415,6 +1090,16 @@ inline size_t BulkSplineEvaluator::UpdateCubicXs(const float delta_x,
   if (optimization_ == kNeonOptimizations) {
     return UpdateCubicXs_TwoSteps(delta_x, indices_to_init);
   } else
+#endif
+#if defined(MOTIVE_NEON_INTRINSICS)
+  if (optimization_ == kNeonOptimizations) {
+    return UpdateCubicXs_TwoSteps(delta_x, indices_to_init);
+  } else
+#endif
+#if defined(MOTIVE_AVX2)
+  if (optimization_ == kAvx2Optimizations) {
+    return UpdateCubicXs_TwoSteps(delta_x, indices_to_init);
+  } else
 #endif
   {
     return UpdateCubicXs_OneStep(delta_x, indices_to_init);
@@ -426,7 +1111,7 @@ inline size_t BulkSplineEvaluator::UpdateCubicXs(const float delta_x,
 inline void BulkSplineEvaluator::EvaluateCubics() {
 #if defined(MOTIVE_ASSEMBLY_TEST)
   std::vector<float> ys_assembly(NumIndices());
-  std::vector<CubicCurve> cubics_assembly(cubics_);
+  std::vector<CubicCurve> cubics_assembly(cubics_.begin(), cubics_.end());
 
   MOTIVE_ASSEMBLY_FUNCTION_NAME(EvaluateCubics_)(
       &cubics_assembly.front(), &cubic_xs_.front(), &y_ranges_.front(),
@@ -446,6 +1131,18 @@ inline void BulkSplineEvaluator::EvaluateCubics() {
     EvaluateCubics_Neon(&cubics_.front(), &cubic_xs_.front(),
                         &y_ranges_.front(), NumIndices(), &ys_.front());
   } else
+#endif
+#if defined(MOTIVE_NEON_INTRINSICS)
+  if (optimization_ == kNeonOptimizations) {
+    EvaluateCubics_NeonIntrinsics(&cubics_.front(), &cubic_xs_.front(),
+                                  NumIndices(), &ys_.front());
+  } else
+#endif
+#if defined(MOTIVE_AVX2)
+  if (optimization_ == kAvx2Optimizations) {
+    EvaluateCubics_Avx2(&cubics_.front(), &cubic_xs_.front(), NumIndices(),
+                        &ys_.front());
+  } else
 #endif
   {
       EvaluateCubics_C();
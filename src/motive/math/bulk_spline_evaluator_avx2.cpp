@@ -0,0 +1,134 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// AVX2+FMA variants of the BulkSplineEvaluator hot loops. This translation
+// unit is compiled with AVX2 code generation enabled (see the top-level
+// CMakeLists.txt), so nothing here may be called unless
+// BestProcessorOptimization() reports kAvx2Optimizations at runtime.
+//
+// The float arrays passed in here are the evaluator's bulk buffers, which
+// are kBufferAlignment (64-byte) aligned, and the loops below step in
+// groups of eight floats, so every vector access is 32-byte aligned and
+// uses the aligned load/store forms. AlignmentOk() asserts the contract.
+
+#if defined(MOTIVE_AVX2)
+
+#include <immintrin.h>
+#include <cassert>
+#include <cstdint>
+
+namespace motive {
+
+// Process eight cubics per iteration.
+static const int kSimdWidth = 8;
+
+// One cubic is four consecutive floats: c0, c1, c2, c3, with
+//   f(x) = ((c3*x + c2)*x + c1)*x + c0
+// See CubicCurve in motive/math/curve.h.
+static const int kFloatsPerCubic = 4;
+
+// True if `p` may be the base of aligned 32-byte vector accesses.
+static inline bool AlignmentOk(const void* p) {
+  return (reinterpret_cast<uintptr_t>(p) & 31) == 0;
+}
+
+}  // namespace motive
+
+// `curves` points to an array of CubicCurve, i.e. packed groups of four
+// coefficient floats. Writes `ys[i] = curves[i].Evaluate(xs[i])` for
+// `num_curves` curves.
+extern "C" void EvaluateCubics_Avx2(const void* curves, const float* xs,
+                                    int num_curves, float* ys) {
+  using namespace motive;
+
+  const float* coeffs = static_cast<const float*>(curves);
+  assert(AlignmentOk(xs) && AlignmentOk(ys));
+
+  // Gather indices for coefficient k of eight consecutive cubics:
+  // k, k+4, k+8, ..., k+28 (in floats).
+  const __m256i gather_base = _mm256_setr_epi32(
+      0, kFloatsPerCubic, 2 * kFloatsPerCubic, 3 * kFloatsPerCubic,
+      4 * kFloatsPerCubic, 5 * kFloatsPerCubic, 6 * kFloatsPerCubic,
+      7 * kFloatsPerCubic);
+
+  int i = 0;
+  for (; i + kSimdWidth <= num_curves; i += kSimdWidth) {
+    const float* base = coeffs + i * kFloatsPerCubic;
+    const __m256 c0 = _mm256_i32gather_ps(base + 0, gather_base, 4);
+    const __m256 c1 = _mm256_i32gather_ps(base + 1, gather_base, 4);
+    const __m256 c2 = _mm256_i32gather_ps(base + 2, gather_base, 4);
+    const __m256 c3 = _mm256_i32gather_ps(base + 3, gather_base, 4);
+    const __m256 x = _mm256_load_ps(xs + i);
+
+    // Horner's rule with fused multiply-adds, as in CubicCurve::Evaluate().
+    __m256 y = _mm256_fmadd_ps(c3, x, c2);
+    y = _mm256_fmadd_ps(y, x, c1);
+    y = _mm256_fmadd_ps(y, x, c0);
+    _mm256_store_ps(ys + i, y);
+  }
+
+  // Mop up the remaining (num_curves % 8) cubics in scalar code.
+  for (; i < num_curves; ++i) {
+    const float* c = coeffs + i * kFloatsPerCubic;
+    const float x = xs[i];
+    ys[i] = ((c[3] * x + c[2]) * x + c[1]) * x + c[0];
+  }
+}
+
+// Advances `xs[i] += delta_x * rate[i]` and sets `masks[i]` to 0xFF when
+// `xs[i] > x_ends[i]`, i.e. when the cubic must be re-initialized from the
+// next spline segment. The playback rates live inside an array of
+// BulkSplineEvaluator::Source structs; `sources` is the address of the first
+// rate and `source_stride` is sizeof(Source) in bytes.
+extern "C" void UpdateCubicXsAndGetMask_Avx2(float delta_x,
+                                             const float* x_ends,
+                                             const void* sources,
+                                             int source_stride, int num_xs,
+                                             float* xs, uint8_t* masks) {
+  using namespace motive;
+
+  // Rates are gathered with a stride of `source_stride` bytes. Gather indices
+  // are in units of floats, so the stride must be float-aligned.
+  const int stride_floats = source_stride / static_cast<int>(sizeof(float));
+  const float* rates = static_cast<const float*>(sources);
+  const __m256i rate_indices = _mm256_setr_epi32(
+      0, stride_floats, 2 * stride_floats, 3 * stride_floats,
+      4 * stride_floats, 5 * stride_floats, 6 * stride_floats,
+      7 * stride_floats);
+  const __m256 delta = _mm256_set1_ps(delta_x);
+  assert(AlignmentOk(xs) && AlignmentOk(x_ends));
+
+  int i = 0;
+  for (; i + kSimdWidth <= num_xs; i += kSimdWidth) {
+    const __m256 rate =
+        _mm256_i32gather_ps(rates + i * stride_floats, rate_indices, 4);
+    const __m256 x = _mm256_fmadd_ps(delta, rate, _mm256_load_ps(xs + i));
+    _mm256_store_ps(xs + i, x);
+
+    // One bit per lane: x > x_end.
+    const __m256 past_end =
+        _mm256_cmp_ps(x, _mm256_load_ps(x_ends + i), _CMP_GT_OQ);
+    const int mask_bits = _mm256_movemask_ps(past_end);
+    for (int lane = 0; lane < kSimdWidth; ++lane) {
+      masks[i + lane] = (mask_bits & (1 << lane)) != 0 ? 0xFF : 0x00;
+    }
+  }
+
+  for (; i < num_xs; ++i) {
+    xs[i] += delta_x * rates[i * stride_floats];
+    masks[i] = xs[i] > x_ends[i] ? 0xFF : 0x00;
+  }
+}
+
+#endif  // defined(MOTIVE_AVX2)
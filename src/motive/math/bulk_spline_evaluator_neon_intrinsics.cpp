@@ -0,0 +1,111 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// NEON-intrinsic variants of the BulkSplineEvaluator hot loops.
+//
+// The hand-written assembly in bulk_spline_evaluator_neon.s only assembles
+// for 32-bit ARM (armeabi-v7a). These intrinsic versions cover every other
+// NEON target -- notably AArch64, where NEON is architecturally guaranteed --
+// and also honor the per-spline playback rate, which the old assembly
+// predates.
+
+#if defined(MOTIVE_NEON_INTRINSICS)
+
+#include <arm_neon.h>
+#include <cstdint>
+
+namespace motive {
+
+// Process four cubics per iteration.
+static const int kSimdWidth = 4;
+
+// One cubic is four consecutive floats: c0, c1, c2, c3, with
+//   f(x) = ((c3*x + c2)*x + c1)*x + c0
+// See CubicCurve in motive/math/curve.h.
+static const int kFloatsPerCubic = 4;
+
+}  // namespace motive
+
+// `curves` points to an array of CubicCurve, i.e. packed groups of four
+// coefficient floats. Writes `ys[i] = curves[i].Evaluate(xs[i])` for
+// `num_curves` curves.
+extern "C" void EvaluateCubics_NeonIntrinsics(const void* curves,
+                                              const float* xs, int num_curves,
+                                              float* ys) {
+  using namespace motive;
+
+  const float* coeffs = static_cast<const float*>(curves);
+
+  int i = 0;
+  for (; i + kSimdWidth <= num_curves; i += kSimdWidth) {
+    // vld4q de-interleaves four cubics into one register per coefficient.
+    const float32x4x4_t c = vld4q_f32(coeffs + i * kFloatsPerCubic);
+    const float32x4_t x = vld1q_f32(xs + i);
+
+    // Horner's rule with multiply-accumulates, as in CubicCurve::Evaluate().
+    float32x4_t y = vmlaq_f32(c.val[2], c.val[3], x);
+    y = vmlaq_f32(c.val[1], y, x);
+    y = vmlaq_f32(c.val[0], y, x);
+    vst1q_f32(ys + i, y);
+  }
+
+  // Mop up the remaining (num_curves % 4) cubics in scalar code.
+  for (; i < num_curves; ++i) {
+    const float* c = coeffs + i * kFloatsPerCubic;
+    const float x = xs[i];
+    ys[i] = ((c[3] * x + c[2]) * x + c[1]) * x + c[0];
+  }
+}
+
+// Advances `xs[i] += delta_x * rate[i]` and sets `masks[i]` to 0xFF when
+// `xs[i] > x_ends[i]`. The playback rates live inside an array of
+// BulkSplineEvaluator::Source structs; `sources` is the address of the first
+// rate and `source_stride` is sizeof(Source) in bytes.
+extern "C" void UpdateCubicXsAndGetMask_NeonIntrinsics(
+    float delta_x, const float* x_ends, const void* sources, int source_stride,
+    int num_xs, float* xs, uint8_t* masks) {
+  using namespace motive;
+
+  const int stride_floats = source_stride / static_cast<int>(sizeof(float));
+  const float* rates = static_cast<const float*>(sources);
+  const float32x4_t delta = vdupq_n_f32(delta_x);
+
+  int i = 0;
+  for (; i + kSimdWidth <= num_xs; i += kSimdWidth) {
+    // Rates are strided through the Source array, so load them per lane.
+    const float* rate_base = rates + i * stride_floats;
+    float32x4_t rate = vdupq_n_f32(rate_base[0]);
+    rate = vsetq_lane_f32(rate_base[stride_floats], rate, 1);
+    rate = vsetq_lane_f32(rate_base[2 * stride_floats], rate, 2);
+    rate = vsetq_lane_f32(rate_base[3 * stride_floats], rate, 3);
+
+    const float32x4_t x = vmlaq_f32(vld1q_f32(xs + i), delta, rate);
+    vst1q_f32(xs + i, x);
+
+    // Narrow the 32-bit comparison result to one byte per lane.
+    const uint32x4_t past_end = vcgtq_f32(x, vld1q_f32(x_ends + i));
+    const uint16x4_t narrow16 = vmovn_u32(past_end);
+    const uint8x8_t narrow8 =
+        vmovn_u16(vcombine_u16(narrow16, vdup_n_u16(0)));
+    vst1_lane_u32(reinterpret_cast<uint32_t*>(masks + i),
+                  vreinterpret_u32_u8(narrow8), 0);
+  }
+
+  for (; i < num_xs; ++i) {
+    xs[i] += delta_x * rates[i * stride_floats];
+    masks[i] = xs[i] > x_ends[i] ? 0xFF : 0x00;
+  }
+}
+
+#endif  // defined(MOTIVE_NEON_INTRINSICS)
@@ -12,11 +12,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <sstream>
 #include <vector>
 #include "motive/math/bulk_spline_evaluator.h"
 #include "motive/math/dual_cubic.h"
+#include "motive/util/job_system.h"
 
 namespace motive {
 
@@ -139,7 +142,7 @@ void CompactSpline::AddNode(const float x, const float y,
     // a discontinuity, but for any more, the middle points will just take up
     // space, so remove it.
     const bool already_ends_in_discontinuity =
-        num_nodes_ >= 2 && Back().x() == nodes_[num_nodes_ - 2].x();
+        num_nodes_ >= 2 && Back().x() == NodeCompactX(num_nodes_ - 2);
     if (already_ends_in_discontinuity) num_nodes_--;
   }
 
@@ -147,7 +150,7 @@ void CompactSpline::AddNode(const float x, const float y,
   const bool add_middle_node =
       !discontinuity && method == kEnsureCubicWellBehaved && num_nodes_ != 0;
   if (add_middle_node) {
-    const CompactSplineNode& last_node = Back();
+    const CompactSplineNode last_node = Back();
     const CubicInit init = CreateCubicInit(last_node, new_node);
     const CubicCurve curve(init);
 
@@ -184,6 +187,54 @@ void CompactSpline::AddUncompressedNodes(const UncompressedNode* nodes,
   }
 }
 
+bool CompactSpline::ReplaceNode(const CompactSplineIndex index, const float x,
+                                const float y, const float derivative) {
+  assert(index < num_nodes_);
+  const CompactSplineNode new_node(x, y, derivative, x_granularity_, y_range_);
+
+  // Re-validate only the neighboring segments: the replacement must keep
+  // the node x's in non-decreasing order.
+  const bool after_prev = index == 0 || new_node.x() >= NodeCompactX(index - 1);
+  const bool before_next =
+      index + 1 == num_nodes_ || new_node.x() <= NodeCompactX(index + 1);
+  if (!after_prev || !before_next) return false;
+
+  SetNode(index, new_node);
+  if (x_index_log2_ != 0) BuildXIndex();
+  return true;
+}
+
+bool CompactSpline::InsertNode(const CompactSplineIndex index, const float x,
+                               const float y, const float derivative) {
+  assert(index <= num_nodes_);
+  if (num_nodes_ >= max_nodes_) return false;
+  const CompactSplineNode new_node(x, y, derivative, x_granularity_, y_range_);
+
+  // Same ordering constraint as ReplaceNode(), against the nodes that will
+  // precede and follow the insertion point.
+  const bool after_prev = index == 0 || new_node.x() >= NodeCompactX(index - 1);
+  const bool before_next =
+      index == num_nodes_ || new_node.x() <= NodeCompactX(index);
+  if (!after_prev || !before_next) return false;
+
+  // Shift the tail up one slot. Both node formats are fixed-size, so the
+  // tail moves as raw bytes.
+  uint8_t* slot = reinterpret_cast<uint8_t*>(nodes_) + index * NodeSize();
+  memmove(slot + NodeSize(), slot, (num_nodes_ - index) * NodeSize());
+  num_nodes_++;
+  SetNode(index, new_node);
+  if (x_index_log2_ != 0) BuildXIndex();
+  return true;
+}
+
+void CompactSpline::RemoveNode(const CompactSplineIndex index) {
+  assert(index < num_nodes_);
+  uint8_t* slot = reinterpret_cast<uint8_t*>(nodes_) + index * NodeSize();
+  memmove(slot, slot + NodeSize(), (num_nodes_ - index - 1) * NodeSize());
+  num_nodes_--;
+  if (x_index_log2_ != 0) BuildXIndex();
+}
+
 float CompactSpline::NodeX(const CompactSplineIndex index) const {
   // Note that, when `index` is before the spline, we return x=0 instead of
   // x=first node's x. This is because logically the spline always starts at
@@ -192,14 +243,14 @@ float CompactSpline::NodeX(const CompactSplineIndex index) const {
   if (index == kAfterSplineIndex) return EndX();
   if (index == kBeforeSplineIndex) return 0.0f;
   assert(index < num_nodes_);
-  return nodes_[index].X(x_granularity_);
+  return Node(index).X(x_granularity_);
 }
 
 float CompactSpline::NodeY(const CompactSplineIndex index) const {
   if (index == kAfterSplineIndex) return EndY();
   if (index == kBeforeSplineIndex) return StartY();
   assert(index < num_nodes_);
-  return nodes_[index].Y(y_range_);
+  return Node(index).Y(y_range_);
 }
 
 float CompactSpline::CalculatedSlowly(const float x,
@@ -249,6 +300,114 @@ void CompactSpline::BulkEvaluate(const CompactSpline* const splines,
   }
 }
 
+// Number of splines each baking job evaluates. Large enough to amortize the
+// per-batch evaluator setup and to keep the SIMD lanes of AdvanceFrame()
+// full; small enough to split an animation set across worker threads.
+static const size_t kBakeBatchSize = 64;
+
+// One contiguous run of splines baked by a single job. Also used for the
+// whole set when baking serially.
+struct BakeBatch {
+  const CompactSpline* const* splines;
+  size_t num_splines;
+  float start_x;
+  float delta_x;
+  size_t num_points;
+  float* ys;
+  size_t y_point_stride;
+  size_t y_spline_stride;
+  float* derivatives;
+  size_t derivative_point_stride;
+  size_t derivative_spline_stride;
+  BulkSplineEvaluator* evaluator;  // If null, the batch makes its own.
+};
+
+static void BakeBatchJob(void* data) {
+  const BakeBatch& b = *static_cast<const BakeBatch*>(data);
+
+  BulkSplineEvaluator local_evaluator;
+  BulkSplineEvaluator& evaluator =
+      b.evaluator != nullptr ? *b.evaluator : local_evaluator;
+
+  // Load every spline in the batch. The splines are scattered in memory, so
+  // each is set individually.
+  const int num_splines = static_cast<int>(b.num_splines);
+  const SplinePlayback playback(b.start_x);
+  evaluator.SetNumIndices(num_splines);
+  for (int i = 0; i < num_splines; ++i) {
+    evaluator.SetSplines(i, 1, b.splines[i], playback);
+  }
+
+  // Advance all splines in lock-step, scattering each point into the strided
+  // output buffers.
+  for (size_t j = 0; j < b.num_points; ++j) {
+    for (int i = 0; i < num_splines; ++i) {
+      b.ys[i * b.y_spline_stride + j * b.y_point_stride] = evaluator.Y(i);
+      if (b.derivatives != nullptr) {
+        b.derivatives[i * b.derivative_spline_stride +
+                      j * b.derivative_point_stride] = evaluator.Derivative(i);
+      }
+    }
+    evaluator.AdvanceFrame(b.delta_x);
+  }
+}
+
+// static
+void CompactSpline::BakeYs(const CompactSpline* const* splines,
+                           size_t num_splines, float start_x, float delta_x,
+                           size_t num_points, float* ys, size_t y_point_stride,
+                           size_t y_spline_stride, float* derivatives,
+                           size_t derivative_point_stride,
+                           size_t derivative_spline_stride,
+                           BulkSplineEvaluator* evaluator,
+                           MotiveJobSystem* job_system) {
+  assert(ys != nullptr);
+  if (num_splines == 0 || num_points == 0) return;
+
+  BakeBatch batch;
+  batch.splines = splines;
+  batch.num_splines = num_splines;
+  batch.start_x = start_x;
+  batch.delta_x = delta_x;
+  batch.num_points = num_points;
+  batch.ys = ys;
+  batch.y_point_stride = y_point_stride;
+  batch.y_spline_stride = y_spline_stride;
+  batch.derivatives = derivatives;
+  batch.derivative_point_stride = derivative_point_stride;
+  batch.derivative_spline_stride = derivative_spline_stride;
+  batch.evaluator = evaluator;
+
+  // Serial: one batch covering the whole set, on the caller's evaluator if
+  // one was provided.
+  if (job_system == nullptr) {
+    BakeBatchJob(&batch);
+    return;
+  }
+
+  // Parallel: split the set into fixed-size runs of splines. Each job bakes
+  // a disjoint slice of the output, so jobs need no synchronization beyond
+  // WaitForAll(). A caller-provided evaluator can't be shared across
+  // threads, so parallel batches always use their own.
+  std::vector<BakeBatch> batches;
+  batches.reserve((num_splines + kBakeBatchSize - 1) / kBakeBatchSize);
+  for (size_t begin = 0; begin < num_splines; begin += kBakeBatchSize) {
+    BakeBatch job_batch = batch;
+    job_batch.splines = splines + begin;
+    job_batch.num_splines = std::min(kBakeBatchSize, num_splines - begin);
+    job_batch.ys = ys + begin * y_spline_stride;
+    job_batch.derivatives =
+        derivatives == nullptr ? nullptr
+                               : derivatives + begin * derivative_spline_stride;
+    job_batch.evaluator = nullptr;
+    batches.push_back(job_batch);
+  }
+  for (size_t i = 0; i < batches.size(); ++i) {
+    job_system->Submit(BakeBatchJob, &batches[i]);
+  }
+  job_system->WaitForAll();
+}
+
 // static
 void CompactSpline::BulkYs(const CompactSpline* const splines,
                            const size_t num_splines, const float start_x,
@@ -268,8 +427,8 @@ Range CompactSpline::RangeX(const CompactSplineIndex index) const {
   if (index == kAfterSplineIndex)
     return Range(EndX(), std::numeric_limits<float>::infinity());
 
-  return Range(nodes_[index].X(x_granularity_),
-               nodes_[index + 1].X(x_granularity_));
+  return Range(Node(index).X(x_granularity_),
+               Node(index + 1).X(x_granularity_));
 }
 
 CompactSplineIndex CompactSpline::IndexForX(
@@ -296,13 +455,15 @@ CompactSplineIndex CompactSpline::IndexForX(
       static_cast<CompactSplineXGrain>(quantized_x);
   if (IndexContainsX(compact_x, guess_index) && guess_index < LastNodeIndex()) {
     const CompactSplineIndex next_index = guess_index + 1;
-    if (WidthX(nodes_[guess_index], nodes_[next_index]) > 0.f) {
+    if (WidthX(Node(guess_index), Node(next_index)) > 0.f) {
       return guess_index;
     }
   }
 
   // Search for it, if the initial guess fails.
-  const CompactSplineIndex index = BinarySearchIndexForX(compact_x);
+  const CompactSplineIndex index = x_index_log2_ != 0
+                                       ? XIndexLookup(compact_x)
+                                       : BinarySearchIndexForX(compact_x);
   assert(IndexContainsX(compact_x, index));
   return index;
 }
@@ -341,52 +502,101 @@ CompactSplineIndex CompactSpline::ClampIndex(const CompactSplineIndex index,
 
 bool CompactSpline::IndexContainsX(const CompactSplineXGrain compact_x,
                                    const CompactSplineIndex index) const {
-  return index < LastNodeIndex() && nodes_[index].x() <= compact_x &&
-         compact_x <= nodes_[index + 1].x();
-}
-
-static inline bool CompareSplineNodeX(const CompactSplineXGrain compact_x,
-                                      const CompactSplineNode& n) {
-  return compact_x < n.x();
+  return index < LastNodeIndex() && NodeCompactX(index) <= compact_x &&
+         compact_x <= NodeCompactX(index + 1);
 }
 
 CompactSplineIndex CompactSpline::BinarySearchIndexForX(
     const CompactSplineXGrain compact_x) const {
-  // Binary search nodes by x.
-  // TODO OPT: avoid the pointer arithmetic (which is expensive on ARM since it
-  // requires an integer division) by searching with indices instead of
-  // iterators.
-  //     int low = 0;
-  //     int hi = max_hi;
-  //     while (low + 1 < hi) {
-  //       const int mid = (low + hi) / 2;
-  //
-  //       if (compact_x < nodes_[mid].x()) {
-  //         hi = mid;
-  //       } else {
-  //         low = mid;
-  //       }
-  //     }
-  const auto upper_it = std::upper_bound(nodes_, &nodes_[num_nodes_], compact_x,
-                                         CompareSplineNodeX);
-  const int low = static_cast<int>(upper_it - nodes_) - 1;
+  // Binary search nodes by x, with indices instead of iterators. Indices
+  // avoid pointer arithmetic (which is expensive on ARM since it requires an
+  // integer division), and let the same search cover both node formats.
+  int low = 0;
+  int hi = num_nodes_;
+  while (low + 1 < hi) {
+    const int mid = (low + hi) / 2;
+
+    if (compact_x < NodeCompactX(static_cast<CompactSplineIndex>(mid))) {
+      hi = mid;
+    } else {
+      low = mid;
+    }
+  }
   assert(0 <= low && low < LastNodeIndex());
 
   // We return the lower index: x is in the segment bt 'index' and 'index' + 1.
   return static_cast<CompactSplineIndex>(low);
 }
 
+CompactSplineIndex CompactSpline::XIndexLookup(
+    const CompactSplineXGrain compact_x) const {
+  // Start at the bucket's node and walk to the containing segment. A fresh
+  // index puts the start node at most one bucket-width before `compact_x`,
+  // so the forward walk covers only the nodes inside one bucket--zero or one
+  // steps at sensible bucket counts. The backward walk and the clamp only
+  // run when the index is stale, i.e. nodes were added after BuildXIndex();
+  // a stale index is slower but never wrong.
+  CompactSplineIndex index = XIndex()[compact_x >> (16 - x_index_log2_)];
+  if (index > LastSegmentIndex()) index = LastSegmentIndex();
+  while (index > 0 && NodeCompactX(index) > compact_x) --index;
+  while (index < LastSegmentIndex() && NodeCompactX(index + 1) <= compact_x) {
+    ++index;
+  }
+  return index;
+}
+
+void CompactSpline::BuildXIndex() {
+  if (x_index_log2_ == 0) return;
+
+  CompactSplineIndex* buckets = XIndex();
+  const int num_buckets = 1 << x_index_log2_;
+  if (num_nodes_ == 0) {
+    memset(buckets, 0, num_buckets * sizeof(buckets[0]));
+    return;
+  }
+
+  // buckets[b] = index of the last node whose x is <= the first x of bucket
+  // b (or 0 when the first node comes later), so XIndexLookup() can start at
+  // that node and walk forward within the bucket. One pass over buckets and
+  // nodes together.
+  const int shift = 16 - x_index_log2_;
+  CompactSplineIndex node = 0;
+  for (int b = 0; b < num_buckets; ++b) {
+    const CompactSplineXGrain bucket_start =
+        static_cast<CompactSplineXGrain>(b << shift);
+    while (node + 1 < num_nodes_ && NodeCompactX(node + 1) <= bucket_start) {
+      ++node;
+    }
+    buckets[b] = node;
+  }
+}
+
+// static
+CompactSpline* CompactSpline::CreateIndexedCopy(const CompactSpline& spline,
+                                                int x_index_log2) {
+  const CompactSplineIndex num_nodes = spline.num_nodes();
+  const CompactSplineNodeFormat format = spline.format();
+  uint8_t* buffer =
+      new uint8_t[SizeWithFormat(num_nodes, format, x_index_log2)];
+  CompactSpline* copy =
+      CreateInPlaceWithFormat(num_nodes, buffer, format, x_index_log2);
+  copy->Init(spline.y_range(), spline.x_granularity());
+  copy->AppendNodeData(spline.node_data(), num_nodes);
+  copy->BuildXIndex();
+  return copy;
+}
+
 CubicInit CompactSpline::CreateCubicInit(const CompactSplineIndex index) const {
   // Handle case where we are outside of the interpolatable range.
   if (OutsideSpline(index)) {
-    const CompactSplineNode& n = index == kBeforeSplineIndex ? Front() : Back();
+    const CompactSplineNode n = index == kBeforeSplineIndex ? Front() : Back();
     const float constant_y = n.Y(y_range_);
     return CubicInit(constant_y, 0.0f, constant_y, 0.0f, 1.0f);
   }
 
   // Interpolate between the nodes at 'index' and 'index' + 1.
   assert(index + 1 < num_nodes_);
-  return CreateCubicInit(nodes_[index], nodes_[index + 1]);
+  return CreateCubicInit(Node(index), Node(index + 1));
 }
 
 CubicInit CompactSpline::CreateCubicInit(const CompactSplineNode& s,
@@ -395,9 +605,124 @@ CubicInit CompactSpline::CreateCubicInit(const CompactSplineNode& s,
                    WidthX(s, e));
 }
 
+detail::CompactSplineNode CompactSpline::WidenImplied(
+    const CompactSplineIndex index) const {
+  const detail::CompactSplineImpliedNode* nodes = implied_nodes();
+
+  // Secant through the neighboring nodes, Catmull-Rom style; one-sided at
+  // the endpoints. A single-node spline has no neighbors, so dx is zero
+  // and its derivative is zero.
+  const CompactSplineIndex prev = index > 0 ? index - 1 : index;
+  const CompactSplineIndex next = index + 1 < num_nodes_ ? index + 1 : index;
+  const detail::CompactSplineNode prev_wide(nodes[prev].x(), nodes[prev].y(),
+                                            0);
+  const detail::CompactSplineNode next_wide(nodes[next].x(), nodes[next].y(),
+                                            0);
+  const float dx = WidthX(prev_wide, next_wide);
+  const float derivative =
+      dx > 0.0f ? (next_wide.Y(y_range_) - prev_wide.Y(y_range_)) / dx : 0.0f;
+  return nodes[index].Widen(derivative);
+}
+
+// static
+bool CompactSpline::NarrowFormatFits(const UncompressedNode* nodes,
+                                     size_t num_nodes, float tolerance) {
+  if (num_nodes == 0) return true;
+
+  // Match the quantization parameters that InitFromNodes() will choose.
+  const float end_x = nodes[num_nodes - 1].x;
+  const float x_granularity = RecommendXGranularity(end_x);
+  const Range y_range = Range::CoversLambda(
+      nodes, num_nodes, [](const UncompressedNode& n) { return n.y; });
+
+  // Round-trip every node through the narrow format and measure the drift
+  // against the uncompressed values, so the check accounts for the total
+  // quantization error, not just the extra error of narrowing.
+  for (size_t i = 0; i < num_nodes; ++i) {
+    const CompactSplineNode wide(nodes[i].x, nodes[i].y, nodes[i].derivative,
+                                 x_granularity, y_range);
+    const CompactSplineNode narrowed =
+        detail::CompactSplineNarrowNode(wide).Widen();
+    if (fabs(narrowed.Y(y_range) - nodes[i].y) > tolerance) return false;
+    if (fabs(narrowed.Derivative() - nodes[i].derivative) > tolerance)
+      return false;
+  }
+  return true;
+}
+
+// static
+bool CompactSpline::ImpliedFormatFits(const UncompressedNode* nodes,
+                                      size_t num_nodes, float tolerance) {
+  // The implied format keeps the full wide-format x and y, so only the
+  // derivatives can drift: each node's tangent becomes the secant through
+  // its neighbors, as WidenImplied() reconstructs it. Compare that secant
+  // against the authored derivative on the uncompressed values; the
+  // angle-quantization error on top is shared with the wide format.
+  for (size_t i = 0; i < num_nodes; ++i) {
+    const size_t prev = i > 0 ? i - 1 : i;
+    const size_t next = i + 1 < num_nodes ? i + 1 : i;
+    const float dx = nodes[next].x - nodes[prev].x;
+    const float secant =
+        dx > 0.0f ? (nodes[next].y - nodes[prev].y) / dx : 0.0f;
+    if (fabs(secant - nodes[i].derivative) > tolerance) return false;
+  }
+  return true;
+}
+
+// static
+CompactSpline* CompactSpline::CreateFromNodes(const UncompressedNode* nodes,
+                                              size_t num_nodes,
+                                              float tolerance) {
+  assert(num_nodes <= kMaxSplineIndex);
+  // Both compact formats are 4 bytes per node; prefer implied, which keeps
+  // the full 16-bit y precision.
+  const CompactSplineNodeFormat format =
+      ImpliedFormatFits(nodes, num_nodes, tolerance)
+          ? kNodeFormatImplied
+          : NarrowFormatFits(nodes, num_nodes, tolerance) ? kNodeFormatNarrow
+                                                          : kNodeFormatWide;
+  CompactSpline* spline =
+      CreateWithFormat(static_cast<CompactSplineIndex>(num_nodes), format);
+  spline->InitFromNodes(nodes, num_nodes);
+  return spline;
+}
+
+static uint64_t HashContentBytes(const void* bytes, size_t len,
+                                 uint64_t hash) {
+  const uint8_t* p = static_cast<const uint8_t*>(bytes);
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ static_cast<uint64_t>(p[i])) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+uint64_t CompactSpline::ContentHash() const {
+  // Hash everything that affects evaluation: the quantization parameters,
+  // the node format, and the quantized nodes themselves.
+  const float y_bounds[2] = {y_range_.start(), y_range_.end()};
+  uint64_t hash = 0xcbf29ce484222325ull;
+  hash = HashContentBytes(y_bounds, sizeof(y_bounds), hash);
+  hash = HashContentBytes(&x_granularity_, sizeof(x_granularity_), hash);
+  hash = HashContentBytes(&format_, sizeof(format_), hash);
+  return HashContentBytes(node_data(), node_data_size(), hash);
+}
+
 // static
 float CompactSpline::RecommendXGranularity(const float max_x) {
   return max_x <= 0.0f ? 1.0f : max_x / CompactSplineNode::MaxX();
 }
 
+// static
+float CompactSpline::RecommendXGranularity(const float max_x,
+                                           const float x_spacing) {
+  // A granularity equal to the common node spacing quantizes every node x
+  // exactly, so prefer it whenever the whole curve fits in the quantized
+  // range at that granularity. Otherwise fall back to the finest granularity
+  // that fits `max_x`, which spreads the quantization error evenly over the
+  // curve.
+  const bool exact_fits =
+      x_spacing > 0.0f && max_x <= x_spacing * CompactSplineNode::MaxX();
+  return exact_fits ? x_spacing : RecommendXGranularity(max_x);
+}
+
 }  // namespace motive
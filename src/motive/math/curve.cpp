@@ -81,6 +81,51 @@ void QuadraticCurve::ShiftLeft(const float x_shift) {
   c_[1] = new_b;
 }
 
+// The bulk loops below hoist the coefficients into locals and keep the body
+// a branch-free Horner evaluation over contiguous arrays, so the compiler
+// holds the coefficients in registers and vectorizes with whatever SIMD the
+// build targets. Explicit per-platform assembly lives only in the
+// BulkSplineEvaluator, where the loop also handles modular re-centering.
+
+void QuadraticCurve::BulkEvaluate(const float* xs, int num_xs,
+                                  float* ys) const {
+  const float c2 = c_[2];
+  const float c1 = c_[1];
+  const float c0 = c_[0];
+  for (int i = 0; i < num_xs; ++i) {
+    const float x = xs[i];
+    ys[i] = (c2 * x + c1) * x + c0;
+  }
+}
+
+void QuadraticCurve::BulkDerivative(const float* xs, int num_xs,
+                                    float* ys) const {
+  const float two_c2 = 2.0f * c_[2];
+  const float c1 = c_[1];
+  for (int i = 0; i < num_xs; ++i) {
+    ys[i] = two_c2 * xs[i] + c1;
+  }
+}
+
+void QuadraticCurve::BulkEvaluate(const QuadraticCurve* curves,
+                                  const float* xs, int num_curves,
+                                  float* ys) {
+  for (int i = 0; i < num_curves; ++i) {
+    const float* c = curves[i].c_;
+    const float x = xs[i];
+    ys[i] = (c[2] * x + c[1]) * x + c[0];
+  }
+}
+
+void QuadraticCurve::BulkDerivative(const QuadraticCurve* curves,
+                                    const float* xs, int num_curves,
+                                    float* ys) {
+  for (int i = 0; i < num_curves; ++i) {
+    const float* c = curves[i].c_;
+    ys[i] = 2.0f * c[2] * xs[i] + c[1];
+  }
+}
+
 float QuadraticCurve::ReliableDiscriminant(const float epsilon) const {
   // When discriminant is (relative to coefficients) close to zero, we treat
   // it as zero. It's possible that the discriminant is barely below zero due
@@ -348,6 +393,49 @@ bool CubicCurve::UniformCurvature(const Range& x_limits) const {
   return start_second_derivative * end_second_derivative >= 0.0f;
 }
 
+// See the comment on QuadraticCurve::BulkEvaluate() for why these loops are
+// plain Horner evaluations.
+
+void CubicCurve::BulkEvaluate(const float* xs, int num_xs, float* ys) const {
+  const float c3 = c_[3];
+  const float c2 = c_[2];
+  const float c1 = c_[1];
+  const float c0 = c_[0];
+  for (int i = 0; i < num_xs; ++i) {
+    const float x = xs[i];
+    ys[i] = ((c3 * x + c2) * x + c1) * x + c0;
+  }
+}
+
+void CubicCurve::BulkDerivative(const float* xs, int num_xs,
+                                float* ys) const {
+  const float three_c3 = 3.0f * c_[3];
+  const float two_c2 = 2.0f * c_[2];
+  const float c1 = c_[1];
+  for (int i = 0; i < num_xs; ++i) {
+    const float x = xs[i];
+    ys[i] = (three_c3 * x + two_c2) * x + c1;
+  }
+}
+
+void CubicCurve::BulkEvaluate(const CubicCurve* curves, const float* xs,
+                              int num_curves, float* ys) {
+  for (int i = 0; i < num_curves; ++i) {
+    const float* c = curves[i].c_;
+    const float x = xs[i];
+    ys[i] = ((c[3] * x + c[2]) * x + c[1]) * x + c[0];
+  }
+}
+
+void CubicCurve::BulkDerivative(const CubicCurve* curves, const float* xs,
+                                int num_curves, float* ys) {
+  for (int i = 0; i < num_curves; ++i) {
+    const float* c = curves[i].c_;
+    const float x = xs[i];
+    ys[i] = (3.0f * c[3] * x + 2.0f * c[2]) * x + c[1];
+  }
+}
+
 bool CubicCurve::operator==(const CubicCurve& rhs) const {
   for (int i = 0; i < kNumCoeff; ++i) {
     if (c_[i] != rhs.c_[i]) return false;
@@ -14,6 +14,8 @@
 
 #include "motive/math/curve_util.h"
 
+#include "motive/math/float.h"
+
 // Define flags for debugging the math.
 #if !defined(NDEBUG)
 #define MOTIVE_CURVE_SANITY_CHECKS 1
@@ -531,6 +533,7 @@ QuadraticSpring::QuadraticSpring(float current_value, float current_derivative,
   r_ = b == 1.0f ? 2.0f * d : d * (1.0f + b) / (sqrt_b - b);
   sqrt_b_ = sqrt_b;
   log_sqrt_b_reciprocal_ = 1.0f / std::log(sqrt_b);
+  log2_sqrt_b_ = std::log(sqrt_b) * 1.44269504088896341f;  // 1 / log(2).
 }
 
 void QuadraticSpring::IncrementContextInternal(float x, Context* c) const {
@@ -590,12 +593,16 @@ QuadraticSpring::Context QuadraticSpring::CalculateContext(
   if (inside_log <= kAtEndPercent || inside_log != inside_log)
     return Context(0.0f, 0.0f, 0.0f, x, std::numeric_limits<float>::infinity());
 
-  // TODO(jsanmiya): If required, replace the std::pow() call with an integer
-  //                 power function. Unclear if it will be faster, though.
+  // Note that std::log() stays exact here, since `iterations` is floored
+  // below and we don't want boundary values to round to the wrong peak.
+  // Raising sqrt_b_ to that power only scales the dampened amplitude,
+  // though, so the approximate FastExp2() is plenty accurate. The exact
+  // log2(sqrt_b_) is cached, so FastExp2()'s ~0.02% relative error is not
+  // amplified by the (potentially large) iteration count.
   const float iterations = std::log(inside_log) * log_sqrt_b_reciprocal_;
   const float iterations_of_peak_before = std::floor(iterations);
   const float sqrt_b_pow_peak_before =
-      std::pow(sqrt_b_, iterations_of_peak_before);
+      FastExp2(iterations_of_peak_before * log2_sqrt_b_);
   const float x_of_peak_before = r_ * (1.0f - sqrt_b_pow_peak_before);
   const float x_of_peak_after = r_ * (1.0f - sqrt_b_pow_peak_before * sqrt_b_);
   const float zero_percent = 1.0f / (1.0f + bias_);
@@ -627,7 +634,7 @@ float QuadraticSpring::IterationX(float iterations) const {
   if (bias_ == 1.0f) return r_ * iterations;
 
   // From (5), X = R(1 - sqrt(b)^N)
-  const float sqrt_b_pow = std::pow(sqrt_b_, iterations);
+  const float sqrt_b_pow = FastExp2(iterations * log2_sqrt_b_);
   const float x = r_ * (1.0f - sqrt_b_pow);
   return ToExternalX(x);
 }
@@ -232,38 +232,111 @@ static float ApproximateMidPercent(const SplineControlNode& start,
   return mid_percent;
 }
 
-void CalculateDualCubicMidNode(const CubicInit& init, float* x, float* y,
-                               float* derivative) {
-  // The initial y and derivative values of our node are given by the
-  // 'init' control nodes. We scale to x from 0~1, because all of our math
-  // assumes x on this domain.
-  SplineControlNode start(0.0f, init.start_y,
-                          init.start_derivative * init.width_x);
-  SplineControlNode end(1.0f, init.end_y, init.end_derivative * init.width_x);
-
-  // Use a heuristic to guess a reasonably close place to split the cubic into
-  // two cubics.
+// Number of cubics processed per chunk of the batched mid-node calculation.
+// Small enough for the scratch arrays to stay in L1; large enough to keep
+// the vectorized evaluation loop busy.
+static const size_t kMidNodeChunkSize = 64;
+
+// Characterize the start and end control nodes of `init` (including their
+// skewed second derivatives) and choose the split point `k`. This is the
+// branchy half of the mid-node calculation; the remaining evaluation is
+// straight-line arithmetic.
+static float CharacterizeControlNodes(SplineControlNode* start,
+                                      SplineControlNode* end) {
+  // Use a heuristic to guess a reasonably close place to split the cubic
+  // into two cubics.
   float start_percent, end_percent;
   const float approx_mid_percent =
-      ApproximateMidPercent(start, end, &start_percent, &end_percent);
+      ApproximateMidPercent(*start, *end, &start_percent, &end_percent);
 
   // Given the start and end conditions and the place to split the cubic,
   // find the extreme second derivatives for start and end curves. See the
   // Dual Cubic document for a derivation of the math here.
   const float start_extreme_second =
-      ExtremeSecondDerivativeForStart(start, end, approx_mid_percent);
+      ExtremeSecondDerivativeForStart(*start, *end, approx_mid_percent);
   const float end_extreme_second =
-      ExtremeSecondDerivativeForEnd(start, end, approx_mid_percent);
+      ExtremeSecondDerivativeForEnd(*start, *end, approx_mid_percent);
 
   // Don't just use the extreme values since this will create a curve that's
   // flat in the middle. Skew the second derivative to favor the steeper side.
-  start.second_derivative = Lerp(0.0f, start_extreme_second, start_percent);
-  end.second_derivative = Lerp(0.0f, end_extreme_second, end_percent);
+  start->second_derivative = Lerp(0.0f, start_extreme_second, start_percent);
+  end->second_derivative = Lerp(0.0f, end_extreme_second, end_percent);
 
-  // Now that we have the full characterization of the start end end nodes
+  // Now that we have the full characterization of the start and end nodes
   // (including second derivatives), calculate the actual ideal mid percent
   // (i.e. the place to split the curve).
-  const float mid_percent = CalculateMidPercent(start, end);
+  return CalculateMidPercent(*start, *end);
+}
+
+void CalculateDualCubicMidNodes(const CubicInit* inits, size_t count,
+                                float* xs, float* ys, float* derivatives) {
+  float start_ys[kMidNodeChunkSize];
+  float end_ys[kMidNodeChunkSize];
+  float start_ss[kMidNodeChunkSize];
+  float end_ss[kMidNodeChunkSize];
+  float start_ws[kMidNodeChunkSize];
+  float end_ws[kMidNodeChunkSize];
+  float mid_percents[kMidNodeChunkSize];
+  float widths[kMidNodeChunkSize];
+
+  for (size_t begin = 0; begin < count; begin += kMidNodeChunkSize) {
+    const size_t n = std::min(kMidNodeChunkSize, count - begin);
+
+    // Phase 1, per cubic: the branchy split-point search, gathering the
+    // fully-characterized control nodes into the scratch arrays.
+    for (size_t i = 0; i < n; ++i) {
+      const CubicInit& init = inits[begin + i];
+      SplineControlNode start(0.0f, init.start_y,
+                              init.start_derivative * init.width_x);
+      SplineControlNode end(1.0f, init.end_y,
+                            init.end_derivative * init.width_x);
+      mid_percents[i] = CharacterizeControlNodes(&start, &end);
+      start_ys[i] = start.y;
+      end_ys[i] = end.y;
+      start_ss[i] = start.derivative;
+      end_ss[i] = end.derivative;
+      start_ws[i] = start.second_derivative;
+      end_ws[i] = end.second_derivative;
+      widths[i] = init.width_x;
+    }
+
+    // Phase 2, across the chunk: the mid-node evaluation--the math in
+    // CalculateMidNode(), followed by the re-scale to the cubic's x-width--
+    // as a branch-free elementwise loop that the compiler can vectorize.
+    for (size_t i = 0; i < n; ++i) {
+      const float k = mid_percents[i];
+      const float j = 1.0f - k;
+      const float y_diff = end_ys[i] - start_ys[i];
+      const float s_diff = end_ss[i] - start_ss[i];
+      const float derivative_k = Lerp(end_ss[i], start_ss[i], k);
+      const float y_k = Lerp(start_ys[i], end_ys[i], k);
+      const float second_k = Lerp(end_ws[i], start_ws[i], k);
+      const float second_k_squared = k * k * start_ws[i] - j * j * end_ws[i];
+
+      const float s =
+          3.0f * y_diff - 2.0f * derivative_k - 0.5f * second_k_squared;
+      const float y =
+          y_k + k * j * (-2.0f / 3.0f * s_diff + 1.0f / 6.0f * second_k);
+
+      xs[begin + i] = k * widths[i];
+      ys[begin + i] = y;
+      derivatives[begin + i] = s / widths[i];
+    }
+  }
+}
+
+void CalculateDualCubicMidNode(const CubicInit& init, float* x, float* y,
+                               float* derivative) {
+  // The initial y and derivative values of our node are given by the
+  // 'init' control nodes. We scale to x from 0~1, because all of our math
+  // assumes x on this domain.
+  SplineControlNode start(0.0f, init.start_y,
+                          init.start_derivative * init.width_x);
+  SplineControlNode end(1.0f, init.end_y, init.end_derivative * init.width_x);
+
+  // Fully characterize the start and end nodes (including second
+  // derivatives) and choose the place to split the curve.
+  const float mid_percent = CharacterizeControlNodes(&start, &end);
 
   // With a full characterization of start and end nodes, and a place to
   // split the curve, we can uniquely calculate the mid node.
@@ -0,0 +1,199 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "motive/math/spline_util.h"
+
+namespace motive {
+
+// Padding applied to the fitted y-range. The dual-cubic mid-nodes that
+// AddNode() inserts can overshoot the source samples slightly, so the
+// compressed range must be a little wider than the samples' extents.
+// Matches the buffer used by CompactSpline::InitFromSpline().
+static const float kFitYRangeBufferPercent = 1.05f;
+
+// Return true if the single cubic interpolating samples `a` and `b`--their
+// values and derivatives--stays within `tolerance` of every sample between
+// them.
+static bool CubicFitsSamples(const float* xs, const float* ys,
+                             const float* derivatives, const int a,
+                             const int b, const float tolerance) {
+  const CubicInit init(ys[a], derivatives[a], ys[b], derivatives[b],
+                       xs[b] - xs[a]);
+  const CubicCurve curve(init);
+  for (int i = a + 1; i < b; ++i) {
+    if (fabs(curve.Evaluate(xs[i] - xs[a]) - ys[i]) > tolerance) return false;
+  }
+  return true;
+}
+
+// Estimate derivatives from the samples: central differences in the
+// interior, one-sided differences at the end points.
+static void EstimateDerivatives(const float* xs, const float* ys,
+                                const int num_samples, float* derivatives) {
+  if (num_samples == 1) {
+    derivatives[0] = 0.0f;
+    return;
+  }
+  derivatives[0] = (ys[1] - ys[0]) / (xs[1] - xs[0]);
+  for (int i = 1; i < num_samples - 1; ++i) {
+    derivatives[i] = (ys[i + 1] - ys[i - 1]) / (xs[i + 1] - xs[i - 1]);
+  }
+  derivatives[num_samples - 1] =
+      (ys[num_samples - 1] - ys[num_samples - 2]) /
+      (xs[num_samples - 1] - xs[num_samples - 2]);
+}
+
+size_t FitNodesToSamples(const float* xs, const float* ys,
+                         const float* derivatives, int num_samples,
+                         float tolerance, UncompressedNode* nodes) {
+  assert(num_samples >= 1 && tolerance > 0.0f);
+
+  // Estimate derivatives with differences when the caller has none.
+  std::vector<float> estimated;
+  if (derivatives == nullptr) {
+    estimated.resize(num_samples);
+    EstimateDerivatives(xs, ys, num_samples, &estimated.front());
+    derivatives = &estimated.front();
+  }
+
+  // The first sample is always kept.
+  size_t num_nodes = 0;
+  nodes[num_nodes].x = xs[0];
+  nodes[num_nodes].y = ys[0];
+  nodes[num_nodes].derivative = derivatives[0];
+  ++num_nodes;
+
+  const int last = num_samples - 1;
+  int a = 0;
+  while (a < last) {
+    // Find the farthest sample the segment starting at `a` can reach.
+    // The adjacent sample always fits, since the cubic interpolates its end
+    // points and there is nothing in between to miss.
+    int good = a + 1;
+
+    // Exponential probe: double the reach until the tolerance breaks or we
+    // reach the last sample. Together with the bisection below, this keeps
+    // the fit O(log n) tolerance checks per kept node instead of O(n), so
+    // long flat stretches--a settled ragdoll--stay cheap.
+    int fail = last + 1;  // Sentinel: no failing end point found.
+    for (int step = 1; good + step <= last; step *= 2) {
+      const int probe = good + step;
+      if (CubicFitsSamples(xs, ys, derivatives, a, probe, tolerance)) {
+        good = probe;
+      } else {
+        fail = probe;
+        break;
+      }
+    }
+
+    // Bisect for the farthest fitting end point in (good, fail).
+    while (fail - good > 1) {
+      const int mid = (good + fail) / 2;
+      if (CubicFitsSamples(xs, ys, derivatives, a, mid, tolerance)) {
+        good = mid;
+      } else {
+        fail = mid;
+      }
+    }
+
+    nodes[num_nodes].x = xs[good];
+    nodes[num_nodes].y = ys[good];
+    nodes[num_nodes].derivative = derivatives[good];
+    ++num_nodes;
+    a = good;
+  }
+  return num_nodes;
+}
+
+// Initialize `spline` with the fitted `nodes`, compressing as we add.
+// kEnsureCubicWellBehaved lets AddNode() insert dual-cubic mid-nodes where
+// a fitted segment's curvature is not uniform.
+static void InitSplineFromFitNodes(CompactSpline* spline,
+                                   const UncompressedNode* nodes,
+                                   const size_t num_nodes,
+                                   const float x_spacing) {
+  // Kept nodes sit at sample x's, so when the samples are uniformly spaced
+  // the two-parameter granularity quantizes every kept node's x exactly.
+  const float end_x = nodes[num_nodes - 1].x;
+  const Range y_range = Range::CoversLambda(
+      nodes, num_nodes, [](const UncompressedNode& n) { return n.y; });
+  spline->Init(y_range.Lengthen(kFitYRangeBufferPercent),
+               CompactSpline::RecommendXGranularity(end_x, x_spacing));
+  for (size_t i = 0; i < num_nodes; ++i) {
+    spline->AddNode(nodes[i].x, nodes[i].y, nodes[i].derivative,
+                    kEnsureCubicWellBehaved);
+  }
+}
+
+// AddNode() may insert one mid-node per fitted segment, so a spline must
+// have room for twice the fitted nodes, less one.
+static CompactSplineIndex MaxNodesForFit(const size_t num_fit_nodes) {
+  const size_t max_nodes = 2 * num_fit_nodes - 1;
+  assert(max_nodes <= kMaxSplineIndex);
+  return static_cast<CompactSplineIndex>(max_nodes);
+}
+
+CompactSpline* FitCompactSpline(const float* xs, const float* ys,
+                                const float* derivatives, int num_samples,
+                                float tolerance) {
+  std::vector<UncompressedNode> nodes(num_samples);
+  const size_t num_nodes = FitNodesToSamples(xs, ys, derivatives, num_samples,
+                                             tolerance, &nodes.front());
+
+  const float x_spacing = num_samples > 1 ? xs[1] - xs[0] : 0.0f;
+  CompactSpline* spline = CompactSpline::Create(MaxNodesForFit(num_nodes));
+  InitSplineFromFitNodes(spline, &nodes.front(), num_nodes, x_spacing);
+  return spline;
+}
+
+size_t FitCompactSplines(const float* xs, int num_samples, int num_channels,
+                         const float* ys, const float* derivatives,
+                         float tolerance, void* buffer, size_t buffer_size,
+                         CompactSpline** splines) {
+  std::vector<UncompressedNode> nodes(num_samples);
+  const float x_spacing = num_samples > 1 ? xs[1] - xs[0] : 0.0f;
+  uint8_t* buf = static_cast<uint8_t*>(buffer);
+  uint8_t* const end = buf + buffer_size;
+
+  for (int c = 0; c < num_channels; ++c) {
+    const float* channel_ys = ys + c * num_samples;
+    const float* channel_derivatives =
+        derivatives == nullptr ? nullptr : derivatives + c * num_samples;
+    const size_t num_nodes =
+        FitNodesToSamples(xs, channel_ys, channel_derivatives, num_samples,
+                          tolerance, &nodes.front());
+
+    // Create the spline in `buffer` with worst-case node capacity, then
+    // shrink it to the nodes actually added so the next channel's spline
+    // starts right after it.
+    const CompactSplineIndex max_nodes = MaxNodesForFit(num_nodes);
+    if (buf + CompactSpline::Size(max_nodes) > end) return 0;
+    CompactSpline* spline = CompactSpline::CreateInPlace(max_nodes, buf);
+    InitSplineFromFitNodes(spline, &nodes.front(), num_nodes, x_spacing);
+    spline->Finalize();
+
+    splines[c] = spline;
+    buf += spline->Size();
+  }
+  return static_cast<size_t>(buf - static_cast<uint8_t*>(buffer));
+}
+
+size_t FitCompactSplinesBufferSize(int num_samples, int num_channels) {
+  return num_channels *
+         CompactSpline::Size(MaxNodesForFit(static_cast<size_t>(num_samples)));
+}
+
+}  // namespace motive
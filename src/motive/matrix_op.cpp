@@ -28,6 +28,10 @@ static const char* kMatrixOpNames[] = {
     "Scale Y",                   // kScaleY
     "Scale Z",                   // kScaleZ
     "Scale Uniformly",           // kScaleUniformly
+    "Quaternion W",              // kQuaternionW
+    "Quaternion X",              // kQuaternionX
+    "Quaternion Y",              // kQuaternionY
+    "Quaternion Z",              // kQuaternionZ
 };
 static_assert(MOTIVE_ARRAY_SIZE(kMatrixOpNames) == kNumMatrixOperationTypes,
               "Adjust kMatrixOpNames to match enumeration");
@@ -29,6 +29,39 @@ void Motivator::InitializeWithDimension(const MotivatorInit& init,
 
   // Register and initialize ourselves with the MotiveProcessor.
   processor->InitializeMotivator(init, engine, this, dimensions);
+
+  if (detail::capture_active) {
+    detail::CaptureInitialize(this, init, dimensions);
+  }
+}
+
+void Motivator::InitializeBatch(const MotivatorInit* const* inits,
+                                MotiveEngine* engine,
+                                Motivator* const* motivators,
+                                int num_motivators,
+                                MotiveDimension dimensions) {
+  if (num_motivators <= 0) return;
+
+  // Unregister the motivators with their existing MotiveProcessors.
+  for (int i = 0; i < num_motivators; ++i) {
+    motivators[i]->Invalidate();
+  }
+
+  // All the motivators are registered with the one MotiveProcessor that
+  // handles their shared type.
+  MotiveProcessor* processor = engine->Processor(inits[0]->type());
+  for (int i = 1; i < num_motivators; ++i) {
+    assert(inits[i]->type() == inits[0]->type());
+  }
+
+  processor->InitializeMotivators(inits, engine, motivators, num_motivators,
+                                  dimensions);
+
+  if (detail::capture_active) {
+    for (int i = 0; i < num_motivators; ++i) {
+      detail::CaptureInitialize(motivators[i], *inits[i], dimensions);
+    }
+  }
 }
 
 }  // namespace motive
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+
 #include "motive/processor.h"
 #include "motive/motivator.h"
 #include "motive/util/benchmark.h"
@@ -32,6 +34,27 @@ MotiveProcessor::~MotiveProcessor() {
   assert(index_allocator_.Empty());
 }
 
+void MotiveProcessor::AccumulateMemoryStats(MotiveMemoryStats* stats) const {
+  const MotiveIndex num_indices = index_allocator_.num_indices();
+  const MotiveIndex num_unused = index_allocator_.NumUnusedIndices();
+  stats->num_indices += num_indices;
+  stats->capacity_indices += index_allocator_.Capacity();
+  stats->unused_indices += num_unused;
+  stats->num_holes += index_allocator_.NumUnusedBlocks();
+
+  // Bookkeeping common to every processor: the allocator's arrays, the
+  // motivator back-pointers, and the update tiers (when in use).
+  stats->allocated_bytes += index_allocator_.AllocatedBytes() +
+                            motivators_.capacity() * sizeof(Motivator*) +
+                            update_tiers_.capacity() * sizeof(uint8_t) +
+                            advance_passes_.capacity() * sizeof(uint8_t) +
+                            groups_.capacity() * sizeof(uint8_t);
+  stats->live_bytes += (num_indices - num_unused) * sizeof(Motivator*);
+
+  // The data arrays, whose layout only the derived processor knows.
+  AccumulateDataMemoryStats(stats);
+}
+
 void MotiveProcessor::VerifyInternalState() const {
 #if MOTIVE_VERIFY_INTERNAL_STATE
   // Check the validity of the IndexAllocator.
@@ -86,6 +109,191 @@ void MotiveProcessor::InitializeMotivator(const MotivatorInit& init,
   VerifyInternalState();
 }
 
+void MotiveProcessor::InitializeMotivators(const MotivatorInit* const* inits,
+                                           MotiveEngine* engine,
+                                           Motivator* const* motivators,
+                                           int num_motivators,
+                                           MotiveDimension dimensions) {
+  const motive::Benchmark b(benchmark_id_for_init());
+
+  // Allocate every block of indices in one call. The internal arrays grow
+  // once, instead of once per motivator.
+  const MotiveIndex first_index =
+      index_allocator_.AllocBatch(dimensions, num_motivators);
+
+  // Register and initialize each Motivator with its block, as in
+  // InitializeMotivator().
+  MotiveIndex index = first_index;
+  for (int m = 0; m < num_motivators; ++m, index += dimensions) {
+    Motivator* motivator = motivators[m];
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      motivators_[index + i] = motivator;
+    }
+    motivator->Init(this, index);
+    InitializeIndices(*inits[m], index, dimensions, engine);
+  }
+
+  VerifyInternalState();
+}
+
+void MotiveProcessor::SetUpdateTier(MotiveIndex index, int tier) {
+  assert(ValidIndex(index) && 0 <= tier && tier < kNumUpdateTiers);
+
+  // Allocate the tier array lazily. Most processors never use tiers, and an
+  // empty array means "everything is tier 0".
+  if (update_tiers_.empty()) {
+    if (tier == 0) return;
+    update_tiers_.resize(motivators_.size(), 0);
+  }
+
+  const MotiveDimension dimensions = Dimensions(index);
+  for (MotiveDimension i = 0; i < dimensions; ++i) {
+    num_tiered_ += (tier != 0 ? 1 : 0) - (update_tiers_[index + i] != 0 ? 1 : 0);
+    update_tiers_[index + i] = static_cast<uint8_t>(tier);
+  }
+}
+
+void MotiveProcessor::SetGroup(MotiveIndex index, int group) {
+  assert(ValidIndex(index) && 0 <= group && group < kNumMotivatorGroups);
+
+  // Allocate the group array lazily, like `update_tiers_`: an empty array
+  // means "everything is in group 0".
+  if (groups_.empty()) {
+    if (group == 0) return;
+    groups_.resize(motivators_.size(), 0);
+  }
+
+  const MotiveDimension dimensions = Dimensions(index);
+  for (MotiveDimension i = 0; i < dimensions; ++i) {
+    groups_[index + i] = static_cast<uint8_t>(group);
+  }
+}
+
+int MotiveProcessor::DestroyGroup(int group) {
+  assert(0 < group && group < kNumMotivatorGroups);
+  if (groups_.empty()) return 0;
+
+  // One sweep over the blocks, removing each of the group's motivators as
+  // RemoveMotivator() would, but verifying internal state once at the end
+  // instead of once per motivator.
+  int num_destroyed = 0;
+  const MotiveIndex num_indices = index_allocator_.num_indices();
+  for (MotiveIndex index = 0; index < num_indices;
+       index += Dimensions(index)) {
+    if (motivators_[index] == nullptr || groups_[index] != group) continue;
+    RemoveIndices(index, Dimensions(index));
+    RemoveMotivatorWithoutNotifying(index);
+    ++num_destroyed;
+  }
+
+  VerifyInternalState();
+  return num_destroyed;
+}
+
+void MotiveProcessor::AdvanceFrameTiered(MotiveTime delta_time,
+                                         uint32_t frame_number) {
+  // Every tier owes the elapsed time, whether or not it steps this frame.
+  for (int t = 0; t < kNumUpdateTiers; ++t) {
+    tier_pending_time_[t] += delta_time;
+  }
+
+  // Fast path: nothing is tiered--the common case--or this processor can't
+  // advance sub-ranges, so every index advances every frame.
+  if (num_tiered_ == 0 || ParallelSliceSize() <= 0) {
+    for (int t = 0; t < kNumUpdateTiers; ++t) {
+      tier_pending_time_[t] = 0;
+    }
+    AdvanceFrame(delta_time);
+    return;
+  }
+
+  // Serial pre-pass, e.g. Defragment(), as in the engine's parallel path.
+  // Note that Defragment() keeps `update_tiers_` in lock-step via
+  // MoveIndexRangeBase().
+  BeginAdvanceFrame(delta_time);
+
+  // Tier t steps on every (1 << t)-th frame.
+  bool tier_active[kNumUpdateTiers];
+  for (int t = 0; t < kNumUpdateTiers; ++t) {
+    tier_active[t] = (frame_number & ((1u << t) - 1)) == 0;
+  }
+
+  // Advance maximal runs of same-tier indices, each run with the time its
+  // tier has accumulated. Motivators created in one batch are contiguous,
+  // so assigning tiers per spawn wave keeps the runs long.
+  const MotiveIndex num_indices = NumIndices();
+  MotiveIndex start = 0;
+  while (start < num_indices) {
+    const uint8_t tier = update_tiers_[start];
+    MotiveIndex end = start + 1;
+    while (end < num_indices && update_tiers_[end] == tier) ++end;
+    if (tier_active[tier]) {
+      AdvanceFrameRange(tier_pending_time_[tier], start, end);
+    }
+    start = end;
+  }
+
+  for (int t = 0; t < kNumUpdateTiers; ++t) {
+    if (tier_active[t]) tier_pending_time_[t] = 0;
+  }
+}
+
+void MotiveProcessor::SetAdvancePass(MotiveIndex index, int pass) {
+  assert(ValidIndex(index) && 0 <= pass && pass < kNumAdvancePasses);
+
+  // Allocate the pass array lazily, like `update_tiers_`: an empty array
+  // means "everything advances in pass 0".
+  if (advance_passes_.empty()) {
+    if (pass == 0) return;
+    advance_passes_.resize(motivators_.size(), 0);
+  }
+
+  const MotiveDimension dimensions = Dimensions(index);
+  for (MotiveDimension i = 0; i < dimensions; ++i) {
+    advance_passes_[index + i] = static_cast<uint8_t>(pass);
+  }
+
+  if (pass >= max_advance_pass_) {
+    max_advance_pass_ = pass;
+  } else {
+    // The index may have held the highest pass; recompute. Passes are
+    // assigned at setup time, so the scan doesn't matter.
+    max_advance_pass_ = 0;
+    for (size_t i = 0; i < advance_passes_.size(); ++i) {
+      const int p = advance_passes_[i];
+      if (p > max_advance_pass_) max_advance_pass_ = p;
+    }
+  }
+}
+
+void MotiveProcessor::AdvanceFramePass(MotiveTime delta_time, int pass,
+                                       uint32_t frame_number) {
+  // Fast path: every index is in pass 0--the common case--or this
+  // processor can't advance sub-ranges, so everything advances up front.
+  if (max_advance_pass_ == 0 || ParallelSliceSize() <= 0) {
+    if (pass == 0) AdvanceFrameTiered(delta_time, frame_number);
+    return;
+  }
+
+  // Serial pre-pass once per frame, before any index advances. Note that
+  // Defragment() keeps `advance_passes_` in lock-step via
+  // MoveIndexRangeBase().
+  if (pass == 0) BeginAdvanceFrame(delta_time);
+
+  // Advance maximal runs of indices assigned to `pass`. Dependent
+  // motivators are typically created right after their sources, so the
+  // runs stay long.
+  const MotiveIndex num_indices = NumIndices();
+  MotiveIndex start = 0;
+  while (start < num_indices) {
+    const uint8_t p = advance_passes_[start];
+    MotiveIndex end = start + 1;
+    while (end < num_indices && advance_passes_[end] == p) ++end;
+    if (p == pass) AdvanceFrameRange(delta_time, start, end);
+    start = end;
+  }
+}
+
 // Don't notify derived classes. Useful in the destructor, since derived classes
 // have already been destroyed.
 void MotiveProcessor::RemoveMotivatorWithoutNotifying(MotiveIndex index) {
@@ -98,6 +306,32 @@ void MotiveProcessor::RemoveMotivatorWithoutNotifying(MotiveIndex index) {
     motivators_[index + i] = nullptr;
   }
 
+  // Freed indices drop back to tier 0, so that a recycled index doesn't
+  // inherit the old motivator's update rate.
+  if (!update_tiers_.empty()) {
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      if (update_tiers_[index + i] != 0) --num_tiered_;
+      update_tiers_[index + i] = 0;
+    }
+  }
+
+  // Likewise for dependency passes. `max_advance_pass_` may now overstate
+  // the highest live pass; the spurious passes advance nothing, and the
+  // next SetAdvancePass() recomputes it.
+  if (!advance_passes_.empty()) {
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      advance_passes_[index + i] = 0;
+    }
+  }
+
+  // And for teardown groups, so a recycled index isn't destroyed with the
+  // old motivator's group.
+  if (!groups_.empty()) {
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      groups_[index + i] = 0;
+    }
+  }
+
   // Recycle 'index'. It will be used in the next allocation, or back-filled in
   // the next call to Defragment().
   index_allocator_.Free(index);
@@ -116,6 +350,36 @@ void MotiveProcessor::RemoveMotivator(MotiveIndex index) {
   VerifyInternalState();
 }
 
+void MotiveProcessor::MigrateMotivator(Motivator* motivator) {
+  MotiveProcessor* source = motivator->processor_;
+  if (source == this) return;
+  assert(source != nullptr && source->Type() == Type());
+  assert(SupportsMigration() && source->SupportsMigration());
+
+  const MotiveIndex source_index = motivator->index_;
+  const MotiveDimension dimensions = source->Dimensions(source_index);
+
+  // Allocate a block here and copy the per-index state across, before the
+  // source releases any resources the state references.
+  const MotiveIndex index = index_allocator_.Alloc(dimensions);
+  CopyIndices(index, dimensions, *source, source_index);
+
+  // Release the source block, as in RemoveMotivator(). This resets
+  // `motivator`, so rebind it afterwards. Update-rate tiers and pinning are
+  // dropped with the old indices; they do not migrate.
+  source->RemoveIndices(source_index, dimensions);
+  source->RemoveMotivatorWithoutNotifying(source_index);
+  source->VerifyInternalState();
+
+  // Register the handle against the new block, as in InitializeMotivator().
+  for (MotiveDimension i = 0; i < dimensions; ++i) {
+    motivators_[index + i] = motivator;
+  }
+  motivator->Init(this, index);
+
+  VerifyInternalState();
+}
+
 void MotiveProcessor::TransferMotivator(MotiveIndex index,
                                         Motivator* new_motivator) {
   assert(ValidMotivatorIndex(index));
@@ -153,6 +417,11 @@ bool MotiveProcessor::ValidMotivatorIndex(MotiveIndex index) const {
 }
 
 void MotiveProcessor::SetNumIndicesBase(MotiveIndex num_indices) {
+  // With capacities locked, growth past the reserved high-water mark is a
+  // programming error: it would reallocate the data arrays whose addresses
+  // and footprint the lock promises stay fixed. See SetCapacityLocked().
+  assert(!capacity_locked_ || num_indices <= locked_capacity_);
+  high_water_indices_ = std::max(high_water_indices_, num_indices);
   // When the size decreases, we don't bother reallocating the size of the
   // 'motivators_' vector. We want to avoid reallocating as much as possible,
   // so we let it grow to its high-water mark.
@@ -161,6 +430,17 @@ void MotiveProcessor::SetNumIndicesBase(MotiveIndex num_indices) {
   // for motivators_. That would require adding a user-defined initialization
   // parameter.
   motivators_.resize(num_indices);
+  if (!update_tiers_.empty()) {
+    // Freed indices have already been returned to tier 0, so shrinking never
+    // discards a live tier assignment.
+    update_tiers_.resize(num_indices, 0);
+  }
+  if (!advance_passes_.empty()) {
+    advance_passes_.resize(num_indices, 0);
+  }
+  if (!groups_.empty()) {
+    groups_.resize(num_indices, 0);
+  }
 
   // Call derived class.
   SetNumIndices(num_indices);
@@ -176,6 +456,8 @@ void MotiveProcessor::MoveIndexRangeBase(const IndexRange& source,
 
   // Tell derivated class about the move.
   MoveIndices(source.start(), target, source.Length());
+  AddMotiveEvents(kMotiveEventDefragmentMoves,
+                  static_cast<uint64_t>(source.Length()));
 
   // Reinitialize the motivator pointers.
   for (MotiveIndex i = source.start(); i < source.end(); ++i) {
@@ -186,6 +468,26 @@ void MotiveProcessor::MoveIndexRangeBase(const IndexRange& source,
     motivators_[i + index_diff] = motivators_[i];
     motivators_[i] = nullptr;
   }
+
+  // Tier and pass assignments travel with their indices.
+  if (!update_tiers_.empty()) {
+    for (MotiveIndex i = source.start(); i < source.end(); ++i) {
+      update_tiers_[i + index_diff] = update_tiers_[i];
+      update_tiers_[i] = 0;
+    }
+  }
+  if (!advance_passes_.empty()) {
+    for (MotiveIndex i = source.start(); i < source.end(); ++i) {
+      advance_passes_[i + index_diff] = advance_passes_[i];
+      advance_passes_[i] = 0;
+    }
+  }
+  if (!groups_.empty()) {
+    for (MotiveIndex i = source.start(); i < source.end(); ++i) {
+      groups_[i + index_diff] = groups_[i];
+      groups_[i] = 0;
+    }
+  }
 }
 
 void MotiveProcessor::RegisterBenchmarks() {
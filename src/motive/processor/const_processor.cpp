@@ -12,55 +12,160 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <vector>
+
 #include "motive/const_init.h"
-#include "motive/math/curve_util.h"
-#include "motive/processor/const_data.h"
-#include "motive/simple_processor_template.h"
+#include "motive/vector_processor.h"
 
 namespace motive {
 
-// The following "Simple" functions are called by the SimpleProcessorTemplate.
-// The current `value` is stored external to ConstData, so it is passed in.
-
-// Velocity never changes.
-static inline float SimpleVelocity(const ConstData& d, float /*value*/) {
-  return d.velocity;
-}
-
-// The target value the initial value, since value is constant.
-static inline float SimpleTargetValue(const ConstData& /*d*/, float value) {
-  return value;
-}
-
-// The target velocity is the initial velocity, since velocity is constant.
-static inline float SimpleTargetVelocity(const ConstData& d, float /*value*/) {
-  return d.velocity;
-}
-
-static inline float SimpleDifference(const ConstData& d, float value) {
-  return SimpleTargetValue(d, value) - value;
-}
-
-// Since we're constant, we're always at our target.
-static inline MotiveTime SimpleTargetTime(const ConstData& /*d*/) {
-  return static_cast<MotiveTime>(0);
-}
-
-class ConstMotiveProcessor : public SimpleProcessorTemplate<ConstData> {
+// Constant motivators never move, so this processor is pure storage: the
+// current value doubles as the target value, the difference is always zero,
+// and AdvanceFrame() does no simulation at all.
+//
+// Scenes hold tens of thousands of const motivators, so per-index memory
+// matters more than anything else here. The value array must stay dense--
+// MotivatorNf::Values() exposes a contiguous float array over pinned
+// blocks--but the velocity array is elided entirely until some motivator is
+// initialized with a non-zero start derivative, which almost none are. In
+// the common case each const motivator costs one float.
+class ConstMotiveProcessor : public MotiveProcessorNf {
  public:
   virtual ~ConstMotiveProcessor() {}
 
   virtual void AdvanceFrame(MotiveTime /*delta_time*/) {
+    // Pure storage: the only per-frame work is reclaiming holes.
     Defragment();
   }
 
   virtual MotivatorType Type() const { return ConstInit::kType; }
   virtual int Priority() const { return 1; }
 
+  virtual bool SupportsMigration() const { return true; }
+
+  virtual const float* Values(MotiveIndex index) const {
+    return &values_[index];
+  }
+
+  virtual void GatherValues(const MotiveIndex* indices, MotiveIndex count,
+                            float* out) const {
+    for (MotiveIndex i = 0; i < count; ++i) {
+      out[i] = values_[indices[i]];
+    }
+  }
+
+  virtual void Velocities(MotiveIndex index, MotiveDimension dimensions,
+                          float* out) const {
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      out[i] = Velocity(index + i);
+    }
+  }
+
+  // A constant value is always at its target.
+  virtual void TargetValues(MotiveIndex index, MotiveDimension dimensions,
+                            float* out) const {
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      out[i] = values_[index + i];
+    }
+  }
+
+  virtual void TargetVelocities(MotiveIndex index, MotiveDimension dimensions,
+                                float* out) const {
+    Velocities(index, dimensions, out);
+  }
+
+  virtual void Differences(MotiveIndex /*index*/, MotiveDimension dimensions,
+                           float* out) const {
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      out[i] = 0.0f;
+    }
+  }
+
+  virtual MotiveTime TargetTime(MotiveIndex /*index*/,
+                                MotiveDimension /*dimensions*/) const {
+    return static_cast<MotiveTime>(0);
+  }
+
   virtual MotiveCurveShape MotiveShape(MotiveIndex /*index*/) const {
     //TODO(jsanmiya): Find a way to store this shape.
     return MotiveCurveShape();
   }
+
+ protected:
+  virtual void InitializeIndices(const MotivatorInit& init, MotiveIndex index,
+                                 MotiveDimension dimensions,
+                                 MotiveEngine* /*engine*/) {
+    const SimpleInit& simple_init = static_cast<const SimpleInit&>(init);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      values_[index + i] = simple_init.start_values[i];
+      SetVelocity(index + i, simple_init.start_derivatives[i]);
+    }
+  }
+
+  virtual void RemoveIndices(MotiveIndex index, MotiveDimension dimensions) {
+    for (MotiveIndex i = index; i < index + dimensions; ++i) {
+      values_[i] = 0.0f;
+      if (!velocities_.empty()) velocities_[i] = 0.0f;
+    }
+  }
+
+  virtual void MoveIndices(MotiveIndex old_index, MotiveIndex new_index,
+                           MotiveDimension dimensions) {
+    MotiveIndex old_i = old_index;
+    MotiveIndex new_i = new_index;
+    for (MotiveDimension i = 0; i < dimensions; ++i, ++new_i, ++old_i) {
+      values_[new_i] = values_[old_i];
+      if (!velocities_.empty()) velocities_[new_i] = velocities_[old_i];
+    }
+  }
+
+  virtual void CopyIndices(MotiveIndex index, MotiveDimension dimensions,
+                           const MotiveProcessor& source,
+                           MotiveIndex source_index) {
+    // `source` has the same Type() as us, and therefore the same class.
+    const ConstMotiveProcessor& src =
+        static_cast<const ConstMotiveProcessor&>(source);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      values_[index + i] = src.values_[source_index + i];
+      SetVelocity(index + i, src.Velocity(source_index + i));
+    }
+  }
+
+  virtual void SetNumIndices(MotiveIndex num_indices) {
+    values_.resize(num_indices, 0.0f);
+    if (!velocities_.empty()) {
+      velocities_.resize(num_indices, 0.0f);
+    }
+  }
+
+  virtual void AccumulateDataMemoryStats(MotiveMemoryStats* stats) const {
+    stats->allocated_bytes +=
+        (values_.capacity() + velocities_.capacity()) * sizeof(float);
+    const size_t bytes_per_index =
+        (velocities_.empty() ? 1 : 2) * sizeof(float);
+    stats->live_bytes += NumLiveIndices() * bytes_per_index;
+  }
+
+ private:
+  float Velocity(MotiveIndex index) const {
+    return velocities_.empty() ? 0.0f : velocities_[index];
+  }
+
+  void SetVelocity(MotiveIndex index, float velocity) {
+    if (velocity == 0.0f && velocities_.empty()) return;
+    if (velocities_.empty()) {
+      velocities_.resize(values_.size(), 0.0f);
+    }
+    velocities_[index] = velocity;
+  }
+
+  // Current (and target) value per index.
+  std::vector<float> values_;
+
+  // Velocity per index. Empty--costing nothing--until some motivator is
+  // initialized with a non-zero start derivative. Velocity is only ever
+  // reported through Velocities(); a const motivator's value never moves.
+  std::vector<float> velocities_;
 };
 
 MOTIVE_INSTANCE(ConstInit, ConstMotiveProcessor);
@@ -16,11 +16,41 @@
 #include "motive/math/curve_util.h"
 #include "motive/processor/ease_in_ease_out_data.h"
 #include "motive/simple_processor_template.h"
+#include "motive/util/benchmark.h"
+#include "motive/util/buffer_allocator.h"
 
 namespace motive {
 
 static const float kDerivativeEpsilon = 0.000001f;
 
+// Size of the per-processor cache of CalculateQuadraticEaseInEaseOut()
+// results. Direct-mapped, so must be a power of two. UI-style retargeting
+// reuses a handful of shapes thousands of times per frame, so a small cache
+// gets nearly all of the hits.
+static const int kCurveCacheSize = 64;
+
+// Distances and derivatives are quantized to this many steps per typical
+// value before keying and solving, so float jitter in the current state
+// still hits the cache. The resulting curve can miss the requested end
+// value by up to 1/4096 of the shape's typical_delta_value, which is far
+// below perceptible for the UI motions this cache targets.
+static const float kCurveCacheQuantScale = 4096.0f;
+
+static inline uint32_t FloatBits(float f) {
+  // Use union to avoid potential aliasing bugs.
+  union {
+    float f;
+    uint32_t bits;
+  } u;
+  u.f = f;
+  return u.bits;
+}
+
+static inline int32_t QuantizeForCache(float x) {
+  return static_cast<int32_t>(x * kCurveCacheQuantScale +
+                              (x >= 0.0f ? 0.5f : -0.5f));
+}
+
 // The following "Simple" functions are called by SimpleProcessorTemplate.
 
 static inline float SimpleVelocity(const EaseInEaseOutData& d,
@@ -60,49 +90,55 @@ static inline MotiveTime SimpleTargetTime(const EaseInEaseOutData& d) {
 class EaseInEaseOutMotiveProcessor
     : public SimpleProcessorTemplate<EaseInEaseOutData> {
  public:
+  EaseInEaseOutMotiveProcessor() {
+    for (int i = 0; i < kCurveCacheSize; ++i) {
+      curve_cache_[i].valid = false;
+    }
+  }
   virtual ~EaseInEaseOutMotiveProcessor() {}
 
+  // Structure-of-arrays evaluation, mirroring the BulkSplineEvaluator
+  // design. `data_` stays authoritative--it holds the full
+  // QuadraticEaseInEaseOut for the accessors and for retargeting--but the
+  // coefficients of each index's *active* quadratic segment (in-curve or
+  // out-curve) are shadowed in the parallel arrays c0_, c1_, c2_, with the
+  // segment-local time in xs_ and the time at which the segment expires in
+  // x_ends_. Each frame is then two passes:
+  //   1. a scalar maintenance pass that advances times and, for the rare
+  //      indices whose x crossed x_ends_, flips segments or retargets;
+  //   2. a branch-free Horner loop over the coefficient arrays that the
+  //      compiler can vectorize 4-8 wide.
+  // Segments change at most a few times per curve, so with thousands of
+  // in-flight indices nearly all the per-frame work is in pass 2.
   virtual void AdvanceFrame(MotiveTime delta_time) {
     Defragment();
 
-    // Loop through every motivator one at a time.
-    for (size_t i = 0; i < data_.size(); ++i) {
-      EaseInEaseOutData& d = data_[i];
-
-      // Advance the time and then update the current value.
-      d.elapsed_time += static_cast<float>(delta_time);
-
-      float q_time = d.elapsed_time - d.q_start_time;
-
-      // If we go past the end value, with a non-zero derivative and there's
-      // no instruction to go to another target, make it so that our curve is
-      // adjusted to hit target value with a zero derivative.
-      if (q_time >= d.q.total_x()) {
-        float target_value = d.q.Evaluate(d.q.total_x());
-        float target_velocity = d.q.Derivative(d.q.total_x());
-        d.q_start_time += d.q.total_x();
-        q_time = d.elapsed_time - d.q_start_time;
-        const bool ends_with_nonzero_derivative =
-            std::fabs(target_velocity) > kDerivativeEpsilon;
-        if (ends_with_nonzero_derivative) {
-          // Create curve to hit target value with zero derivative.
-          float start_second_derivative_abs = 0.0f;
-          float end_second_derivative_abs = 0.0f;
-          CalculateSecondDerivativesFromTypicalCurve(
-              d.shape.typical_delta_value, d.shape.typical_total_time,
-              d.shape.bias, &start_second_derivative_abs,
-              &end_second_derivative_abs);
-          d.q = CalculateQuadraticEaseInEaseOut(
-              target_value, target_velocity, start_second_derivative_abs,
-              target_value, 0.0f, end_second_derivative_abs,
-              d.shape.typical_delta_value, d.shape.typical_total_time);
-        } else {
-          // Curve is a flat line at target_value.
-          d.q = QuadraticEaseInEaseOut(QuadraticCurve(0.0f, 0.0f, target_value),
-                                       std::numeric_limits<float>::infinity());
-        }
+    const float delta = static_cast<float>(delta_time);
+    EaseInEaseOutData* data = data_.data();
+    float* xs = xs_.data();
+    const float* x_ends = x_ends_.data();
+    const MotiveIndex num_indices = static_cast<MotiveIndex>(data_.size());
+
+    // Pass 1: advance times and refresh expired segments.
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      EaseInEaseOutData& d = data[i];
+      d.elapsed_time += delta;
+      float x = d.elapsed_time - d.q_start_time;
+      if (x >= x_ends[i]) {
+        RefreshSegment(i, &x);
       }
-      values_[i] = d.q.Evaluate(q_time);
+      xs[i] = x;
+    }
+
+    // Pass 2: evaluate every active quadratic. No branches, no loads from
+    // `data_`; just a Horner evaluation over the parallel arrays.
+    const float* c0 = c0_.data();
+    const float* c1 = c1_.data();
+    const float* c2 = c2_.data();
+    float* values = values_.data();
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      const float x = xs[i];
+      values[i] = (c2[i] * x + c1[i]) * x + c0[i];
     }
   }
 
@@ -113,25 +149,20 @@ class EaseInEaseOutMotiveProcessor
                                   const float* target_values,
                                   const float* target_velocities,
                                   const MotiveCurveShape& shape) {
+    AddMotiveEvents(kMotiveEventSetTargets, 1);
     for (MotiveDimension i = 0; i < dimensions; ++i) {
       int processor_index = index + i;
       EaseInEaseOutData& d = Data(processor_index);
 
       // Initialize curve to go from current to target.
-      float start_second_derivative_abs = 0.0f;
-      float end_second_derivative_abs = 0.0f;
-      CalculateSecondDerivativesFromTypicalCurve(
-          shape.typical_delta_value, shape.typical_total_time, shape.bias,
-          &start_second_derivative_abs, &end_second_derivative_abs);
-      d.q = CalculateQuadraticEaseInEaseOut(
-          Value(processor_index),  Velocity(processor_index),
-          start_second_derivative_abs, target_values[i], target_velocities[i],
-          end_second_derivative_abs, shape.typical_delta_value,
-          shape.typical_total_time);
+      d.q = EaseInEaseOutForTarget(Value(processor_index),
+                                   Velocity(processor_index), target_values[i],
+                                   target_velocities[i], shape);
       d.target_time = d.q.total_x();
       d.q_start_time = 0.0f;
       d.elapsed_time = 0.0f;
       d.shape = shape;
+      SyncSegment(processor_index);
     }
   }
 
@@ -139,6 +170,227 @@ class EaseInEaseOutMotiveProcessor
     const EaseInEaseOutData& d = Data(index);
     return d.shape;
   }
+
+ protected:
+  // The lifecycle functions keep the shadow arrays in step with `data_`.
+  virtual void InitializeIndices(const MotivatorInit& init, MotiveIndex index,
+                                 MotiveDimension dimensions,
+                                 MotiveEngine* engine) {
+    SimpleProcessorTemplate::InitializeIndices(init, index, dimensions, engine);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      SyncSegment(index + i);
+    }
+  }
+
+  virtual void RemoveIndices(MotiveIndex index, MotiveDimension dimensions) {
+    SimpleProcessorTemplate::RemoveIndices(index, dimensions);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      SyncSegment(index + i);
+    }
+  }
+
+  virtual void MoveIndices(MotiveIndex old_index, MotiveIndex new_index,
+                           MotiveDimension dimensions) {
+    SimpleProcessorTemplate::MoveIndices(old_index, new_index, dimensions);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      SyncSegment(new_index + i);
+    }
+  }
+
+  virtual void CopyIndices(MotiveIndex index, MotiveDimension dimensions,
+                           const MotiveProcessor& source,
+                           MotiveIndex source_index) {
+    SimpleProcessorTemplate::CopyIndices(index, dimensions, source,
+                                         source_index);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      SyncSegment(index + i);
+    }
+  }
+
+  virtual void SetNumIndices(MotiveIndex num_indices) {
+    SimpleProcessorTemplate::SetNumIndices(num_indices);
+    xs_.resize(num_indices);
+    x_ends_.resize(num_indices);
+    c0_.resize(num_indices);
+    c1_.resize(num_indices);
+    c2_.resize(num_indices);
+  }
+
+  virtual void AccumulateDataMemoryStats(MotiveMemoryStats* stats) const {
+    SimpleProcessorTemplate::AccumulateDataMemoryStats(stats);
+    const size_t shadow_bytes = 5 * sizeof(float);
+    stats->allocated_bytes += xs_.capacity() * shadow_bytes;
+    stats->live_bytes += NumLiveIndices() * shadow_bytes;
+  }
+
+ private:
+  // Quantized, value-translation-independent description of a retarget.
+  // All fields are 32-bit, so the struct has no padding.
+  struct CurveCacheKey {
+    int32_t distance;
+    int32_t start_derivative;
+    int32_t end_derivative;
+    uint32_t typical_delta_bits;
+    uint32_t typical_time_bits;
+    uint32_t bias_bits;
+
+    bool operator==(const CurveCacheKey& rhs) const {
+      return distance == rhs.distance &&
+             start_derivative == rhs.start_derivative &&
+             end_derivative == rhs.end_derivative &&
+             typical_delta_bits == rhs.typical_delta_bits &&
+             typical_time_bits == rhs.typical_time_bits &&
+             bias_bits == rhs.bias_bits;
+    }
+  };
+
+  struct CurveCacheEntry {
+    bool valid;
+    CurveCacheKey key;
+    // Curve for `key`, starting at value 0. Shifted up to the caller's
+    // start value on every hit.
+    QuadraticEaseInEaseOut q;
+  };
+
+  // The uncached solve: derive the second derivatives from `shape` and run
+  // the iterative fly-out/fly-in calculation.
+  static QuadraticEaseInEaseOut Solve(float start_value, float start_derivative,
+                                      float end_value, float end_derivative,
+                                      const MotiveCurveShape& shape) {
+    float start_second_derivative_abs = 0.0f;
+    float end_second_derivative_abs = 0.0f;
+    CalculateSecondDerivativesFromTypicalCurve(
+        shape.typical_delta_value, shape.typical_total_time, shape.bias,
+        &start_second_derivative_abs, &end_second_derivative_abs);
+    return CalculateQuadraticEaseInEaseOut(
+        start_value, start_derivative, start_second_derivative_abs, end_value,
+        end_derivative, end_second_derivative_abs, shape.typical_delta_value,
+        shape.typical_total_time);
+  }
+
+  // Cached version of Solve(). The solve depends only on the value
+  // *difference* between start and end, so curves are cached starting at
+  // value 0 and shifted up to the current value on the way out. Repeated
+  // retargets with the same shape--thousands per frame during UI
+  // scrolling--skip the iterative solve entirely.
+  QuadraticEaseInEaseOut EaseInEaseOutForTarget(float start_value,
+                                                float start_derivative,
+                                                float end_value,
+                                                float end_derivative,
+                                                const MotiveCurveShape& shape) {
+    const float typical_value = shape.typical_delta_value;
+    const float typical_time = shape.typical_total_time;
+
+    // Degenerate shapes can't be normalized for quantization; solve directly.
+    if (!(typical_value > 0.0f) || !(typical_time > 0.0f)) {
+      return Solve(start_value, start_derivative, end_value, end_derivative,
+                   shape);
+    }
+
+    // Quantize distance and derivatives relative to the shape's typical
+    // scale, so float jitter in the current state maps to the same key.
+    const float derivative_scale = typical_time / typical_value;
+    CurveCacheKey key;
+    key.distance = QuantizeForCache((end_value - start_value) / typical_value);
+    key.start_derivative =
+        QuantizeForCache(start_derivative * derivative_scale);
+    key.end_derivative = QuantizeForCache(end_derivative * derivative_scale);
+    key.typical_delta_bits = FloatBits(typical_value);
+    key.typical_time_bits = FloatBits(typical_time);
+    key.bias_bits = FloatBits(shape.bias);
+
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ static_cast<uint32_t>(key.distance)) * 16777619u;
+    hash = (hash ^ static_cast<uint32_t>(key.start_derivative)) * 16777619u;
+    hash = (hash ^ static_cast<uint32_t>(key.end_derivative)) * 16777619u;
+    hash = (hash ^ key.typical_delta_bits) * 16777619u;
+    hash = (hash ^ key.typical_time_bits) * 16777619u;
+    hash = (hash ^ key.bias_bits) * 16777619u;
+
+    CurveCacheEntry& entry = curve_cache_[hash & (kCurveCacheSize - 1)];
+    if (!entry.valid || !(entry.key == key)) {
+      // Miss: solve the canonical problem--start at value 0, with the
+      // quantized distance and derivatives--and take the slot.
+      const float distance =
+          (key.distance / kCurveCacheQuantScale) * typical_value;
+      const float quantized_start_derivative =
+          (key.start_derivative / kCurveCacheQuantScale) / derivative_scale;
+      const float quantized_end_derivative =
+          (key.end_derivative / kCurveCacheQuantScale) / derivative_scale;
+      entry.q = Solve(0.0f, quantized_start_derivative, distance,
+                      quantized_end_derivative, shape);
+      entry.key = key;
+      entry.valid = true;
+    }
+
+    // Shift the canonical curve up to the current value.
+    QuadraticCurve in_curve = entry.q.in_curve();
+    QuadraticCurve out_curve = entry.q.out_curve();
+    in_curve.ShiftUp(start_value);
+    out_curve.ShiftUp(start_value);
+    return QuadraticEaseInEaseOut(in_curve, out_curve,
+                                  entry.q.intersection_x(), entry.q.total_x());
+  }
+
+  // Load index's active segment into the shadow arrays: the quadratic that
+  // covers segment-local time `x`, and the time at which it stops covering.
+  void LoadSegment(MotiveIndex index, float x) {
+    const EaseInEaseOutData& d = data_[index];
+    const QuadraticCurve& curve = d.q.Curve(x);
+    c0_[index] = curve.Coeff(0);
+    c1_[index] = curve.Coeff(1);
+    c2_[index] = curve.Coeff(2);
+    x_ends_[index] =
+        x <= d.q.intersection_x() ? d.q.intersection_x() : d.q.total_x();
+  }
+
+  // Rebuild index's shadow entries from `data_` after the data changed
+  // underneath them (retarget, initialization, defragmentation).
+  void SyncSegment(MotiveIndex index) {
+    const EaseInEaseOutData& d = data_[index];
+    const float x = d.elapsed_time - d.q_start_time;
+    xs_[index] = x;
+    LoadSegment(index, x);
+  }
+
+  // Slow path of AdvanceFrame() pass 1: `*x` has reached x_ends_[index].
+  // Either the in-curve expired and we switch to the out-curve, or the whole
+  // curve expired and we retarget. Runs a handful of times per curve.
+  void RefreshSegment(MotiveIndex index, float* x) {
+    EaseInEaseOutData& d = data_[index];
+
+    // If we go past the end value, with a non-zero derivative and there's
+    // no instruction to go to another target, make it so that our curve is
+    // adjusted to hit target value with a zero derivative.
+    if (*x >= d.q.total_x()) {
+      const float target_value = d.q.Evaluate(d.q.total_x());
+      const float target_velocity = d.q.Derivative(d.q.total_x());
+      d.q_start_time += d.q.total_x();
+      *x = d.elapsed_time - d.q_start_time;
+      const bool ends_with_nonzero_derivative =
+          std::fabs(target_velocity) > kDerivativeEpsilon;
+      if (ends_with_nonzero_derivative) {
+        // Create curve to hit target value with zero derivative.
+        d.q = EaseInEaseOutForTarget(target_value, target_velocity,
+                                     target_value, 0.0f, d.shape);
+      } else {
+        // Curve is a flat line at target_value.
+        d.q = QuadraticEaseInEaseOut(QuadraticCurve(0.0f, 0.0f, target_value),
+                                     std::numeric_limits<float>::infinity());
+      }
+    }
+    LoadSegment(index, *x);
+  }
+
+  // Shadow arrays for AdvanceFrame(), parallel to `data_` and `values_`.
+  // See the comment on AdvanceFrame().
+  std::vector<float, BufferAllocator<float>> xs_;
+  std::vector<float, BufferAllocator<float>> x_ends_;
+  std::vector<float, BufferAllocator<float>> c0_;
+  std::vector<float, BufferAllocator<float>> c1_;
+  std::vector<float, BufferAllocator<float>> c2_;
+
+  CurveCacheEntry curve_cache_[kCurveCacheSize];
 };
 
 MOTIVE_INSTANCE(EaseInEaseOutInit, EaseInEaseOutMotiveProcessor);
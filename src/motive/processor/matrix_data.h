@@ -15,6 +15,8 @@
 #ifndef MOTIVE_MATRIX_DATA_H_
 #define MOTIVE_MATRIX_DATA_H_
 
+#include <map>
+
 #include "mathfu/constants.h"
 #include "motive/engine.h"
 #include "motive/math/angle.h"
@@ -25,6 +27,88 @@
 
 namespace motive {
 
+// Recycles the variable-size MatrixData allocations of a processor.
+// Freed blocks are bucketed by size, so motivators with the same op count
+// reuse each other's memory, and the steady-state create/destroy path never
+// touches the underlying allocator.
+class MatrixDataPool {
+ public:
+  ~MatrixDataPool() {
+    for (auto it = buckets_.begin(); it != buckets_.end(); ++it) {
+      std::vector<void*>& blocks = it->second;
+      for (size_t i = 0; i < blocks.size(); ++i) {
+        MotiveFree(blocks[i]);
+      }
+    }
+  }
+
+  void* Alloc(size_t size, size_t align) {
+    std::vector<void*>& blocks = buckets_[size];
+    if (blocks.empty()) return MotiveAlloc(size, align);
+
+    void* block = blocks.back();
+    blocks.pop_back();
+    return block;
+  }
+
+  void Free(void* block, size_t size) { buckets_[size].push_back(block); }
+
+  // Bytes held by the free lists, for memory telemetry. Blocks checked out
+  // of the pool are counted by their owning MatrixData.
+  size_t AllocatedBytes() const {
+    size_t bytes = 0;
+    for (auto it = buckets_.begin(); it != buckets_.end(); ++it) {
+      bytes += it->first * it->second.size();
+    }
+    return bytes;
+  }
+
+ private:
+  // Free lists of blocks, keyed by block size. Op counts cluster around a
+  // few values per game--one per animated prop type--so the map stays tiny.
+  std::map<size_t, std::vector<void*>> buckets_;
+};
+
+// The matrix processor's embedded spline evaluator, plus a recycler for its
+// channel indices. Ops created with MatrixInit::inline_splines() read their
+// values straight out of this evaluator, instead of hopping to the spline
+// processor through a child motivator.
+class InlineSplineChannels {
+ public:
+  BulkSplineEvaluator& evaluator() { return evaluator_; }
+  const BulkSplineEvaluator& evaluator() const { return evaluator_; }
+
+  // Allocate one channel, recycling a freed one before growing the
+  // evaluator.
+  MotiveIndex Alloc() {
+    if (!free_indices_.empty()) {
+      const MotiveIndex index = free_indices_.back();
+      free_indices_.pop_back();
+      return index;
+    }
+    const MotiveIndex index = evaluator_.NumIndices();
+    evaluator_.SetNumIndices(index + 1);
+    return index;
+  }
+
+  void Free(MotiveIndex index) {
+    evaluator_.ClearSplines(index, 1);
+    free_indices_.push_back(index);
+  }
+
+  size_t AllocatedBytes() const {
+    return evaluator_.AllocatedBytes() +
+           free_indices_.capacity() * sizeof(MotiveIndex);
+  }
+
+ private:
+  BulkSplineEvaluator evaluator_;
+
+  // Channels returned by Free(), reused by Alloc(). Channels are allocated
+  // one per op, so holes left by destroyed motivators are refilled exactly.
+  std::vector<MotiveIndex> free_indices_;
+};
+
 // Hold a series of matrix operations, and their resultant matrix.
 //
 // This class is of variable size, to keep compact and to avoid cache misses
@@ -38,7 +122,73 @@ class MatrixData {
  public:
 
   void UpdateResultMatrix() {
-    result_matrix_ = MatrixOperation::CalculateResultMatrix(ops_, num_ops_);
+    if (plan_dirty_) CompilePlan();
+
+    // Execute the compiled plan: precomputed matrices for constant runs,
+    // the generic op dispatch for everything else.
+    mathfu::vec4 c0 = mathfu::kAxisX4f;
+    mathfu::vec4 c1 = mathfu::kAxisY4f;
+    mathfu::vec4 c2 = mathfu::kAxisZ4f;
+    mathfu::vec4 c3 = mathfu::kAxisW4f;
+    for (auto it = plan_.begin(); it != plan_.end(); ++it) {
+      if (it->num_ops == 0) {
+        MatrixOperation::ApplyAffineMatrix(it->constant, &c0, &c1, &c2, &c3);
+      } else {
+        MatrixOperation::ApplyOps(ops_ + it->first_op, it->num_ops, &c0, &c1,
+                                  &c2, &c3);
+      }
+    }
+    const mathfu::mat4 new_matrix(c0, c1, c2, c3);
+    result_changed_ = !(new_matrix == result_matrix_);
+    result_matrix_ = new_matrix;
+  }
+
+  // True if the most recent update changed result_matrix(). Consumers that
+  // cache derived data (e.g. the rig processor's global transforms) use this
+  // to skip recomputation for settled matrices.
+  bool result_changed() const { return result_changed_; }
+
+  // True if the compiled plan replaces at least one run of constant ops with
+  // a precomputed matrix. Folded MatrixDatas are cheaper to update one at a
+  // time than through the generic four-wide path, so the processor excludes
+  // them from batching. Compiles the plan if it is out of date.
+  bool HasFoldedOps() {
+    if (plan_dirty_) CompilePlan();
+    return has_folded_ops_;
+  }
+
+  // Set the value of a constant op. Goes through MatrixData, rather than
+  // directly to Op(), so that the folded matrices can be recomputed.
+  void SetChildValue(int child_index, float value) {
+    Op(child_index).SetValue1f(value);
+    plan_dirty_ = true;
+  }
+
+  // True if `a` and `b` run the same sequence of operation types, and can
+  // therefore be composed together with UpdateResultMatrices4().
+  static bool SameOps(const MatrixData& a, const MatrixData& b) {
+    if (a.num_ops_ != b.num_ops_) return false;
+    for (int i = 0; i < a.num_ops_; ++i) {
+      if (a.ops_[i].Type() != b.ops_[i].Type()) return false;
+    }
+    return true;
+  }
+
+  // Update the result matrices of four MatrixDatas at once. All four must
+  // have the same op signature; see SameOps(). Batching keeps the per-op
+  // dispatch cost amortized over four matrices.
+  static void UpdateResultMatrices4(MatrixData* const* d) {
+    const MatrixOperation* ops[4] = {d[0]->ops_, d[1]->ops_, d[2]->ops_,
+                                     d[3]->ops_};
+    mathfu::mat4* results[4] = {&d[0]->result_matrix_, &d[1]->result_matrix_,
+                                &d[2]->result_matrix_, &d[3]->result_matrix_};
+    const mathfu::mat4 old_matrices[4] = {
+        d[0]->result_matrix_, d[1]->result_matrix_, d[2]->result_matrix_,
+        d[3]->result_matrix_};
+    MatrixOperation::CalculateResultMatrices4(ops, d[0]->num_ops_, results);
+    for (int m = 0; m < 4; ++m) {
+      d[m]->result_changed_ = !(d[m]->result_matrix_ == old_matrices[m]);
+    }
   }
 
   void BlendToOps(const std::vector<MatrixOperationInit>& new_ops,
@@ -60,6 +210,10 @@ class MatrixData {
       }
     }
     assert(new_op_idx == num_new_ops);
+
+    // Blending can change the values of constant ops, so the folded
+    // matrices must be recomputed.
+    plan_dirty_ = true;
   }
 
   void SetPlaybackRate(float playback_rate) {
@@ -69,6 +223,17 @@ class MatrixData {
     }
   }
 
+  // Forward an update-rate tier to the child motivators that drive the
+  // operation values. Constant ops have no motivator and nothing to skip;
+  // inline spline channels advance with the matrix processor's embedded
+  // evaluator, which is not tiered.
+  void SetUpdateTier(int tier) {
+    for (int i = 0; i < num_ops_; ++i) {
+      Motivator1f* motivator = ops_[i].ValueMotivator();
+      if (motivator != nullptr) motivator->SetUpdateTier(tier);
+    }
+  }
+
   MotiveTime TimeRemaining() const {
     MotiveTime time = 0;
     for (int i = 0; i < num_ops_; ++i) {
@@ -91,41 +256,170 @@ class MatrixData {
   const mathfu::mat4& result_matrix() const { return result_matrix_; }
   int num_ops() const { return num_ops_; }
 
-  static MatrixData* Create(const MatrixInit& init, MotiveEngine* engine) {
-    // Allocate a buffer that is big enough to hold MatrixData.
-    static const int kAlign = 16;
-    const std::vector<MatrixOperationInit>& ops = init.ops();
-    const int num_ops = static_cast<int>(ops.size());
-    // Round up size to the next multiple of 16 to match minimum alignment.
-    const size_t size = ((SizeOfClass(num_ops) + kAlign - 1) / kAlign) * kAlign;
-    uint8_t* buffer = (uint8_t*)AlignedAlloc(size, kAlign);
+  // Heap bytes owned by this MatrixData: its variable-size allocation and
+  // the compiled plan. The op motivators' state lives in their processors
+  // and is counted there.
+  size_t AllocatedBytes() const {
+    return AllocSize(num_ops_) + plan_.capacity() * sizeof(CompiledStep);
+  }
+
+  static MatrixData* Create(const MatrixInit& init, MotiveEngine* engine,
+                            MatrixDataPool* pool = nullptr,
+                            InlineSplineChannels* channels = nullptr) {
+    // Allocate a buffer that is big enough to hold MatrixData, recycling one
+    // from `pool` when a pool is supplied.
+    const MatrixOperationInit* ops = init.ops();
+    const int num_ops = init.num_ops();
+    const size_t size = AllocSize(num_ops);
+    uint8_t* buffer = static_cast<uint8_t*>(
+        pool != nullptr ? pool->Alloc(size, kAlign) : MotiveAlloc(size, kAlign));
     MatrixData* d = new (buffer) MatrixData();
     d->result_matrix_ = mathfu::mat4::Identity();
+    d->result_changed_ = true;
+    d->plan_dirty_ = true;
+    d->has_folded_ops_ = false;
     d->num_ops_ = num_ops;
     for (int i = 0; i < num_ops; ++i) {
-      new (&d->ops_[i]) MatrixOperation(ops[i], engine);
+      // When `channels` is supplied, animated ops run as inline spline
+      // channels in the processor's embedded evaluator. Target-driven ops
+      // (kUnionTarget) still need a child motivator; see
+      // MatrixOperation::BlendToOp().
+      const bool inline_op =
+          channels != nullptr && ops[i].init != nullptr &&
+          ops[i].union_type != MatrixOperationInit::kUnionTarget;
+      if (inline_op) {
+        new (&d->ops_[i])
+            MatrixOperation(ops[i], &channels->evaluator(), channels->Alloc());
+      } else {
+        new (&d->ops_[i]) MatrixOperation(ops[i], engine);
+      }
     }
     return d;
   }
 
-  static void Destroy(MatrixData* d) {
+  static void Destroy(MatrixData* d, MatrixDataPool* pool = nullptr,
+                      InlineSplineChannels* channels = nullptr) {
     // Explicitly delete MatrixData the same way it was allocated.
+    const size_t size = AllocSize(d->num_ops_);
     for (int i = 0; i < d->num_ops_; ++i) {
+      // Reclaim the op's inline channel, if it has one.
+      const MotiveIndex spline_index = d->ops_[i].InlineSplineIndex();
+      if (spline_index != kMotiveIndexInvalid) {
+        assert(channels != nullptr);
+        channels->Free(spline_index);
+      }
       d->ops_[i].~MatrixOperation();
     }
     d->~MatrixData();
-    AlignedFree(d);
+    if (pool != nullptr) {
+      pool->Free(d, size);
+    } else {
+      MotiveFree(d);
+    }
   }
 
  private:
+  static const int kAlign = 16;
+
   static size_t SizeOfClass(int num_ops) {
     return sizeof(MatrixData) +
            sizeof(MatrixOperation) * std::max(0, num_ops - 1);
   }
 
+  // Round up size to the next multiple of 16 to match minimum alignment.
+  static size_t AllocSize(int num_ops) {
+    return ((SizeOfClass(num_ops) + kAlign - 1) / kAlign) * kAlign;
+  }
+
+  /// One step of the compiled plan executed by UpdateResultMatrix().
+  /// When `num_ops` is 0, post-multiply the precomputed `constant` matrix.
+  /// Otherwise, run ops_[first_op] .. ops_[first_op + num_ops - 1] through
+  /// the generic op dispatch.
+  struct CompiledStep {
+    mathfu::mat4 constant;
+    int first_op;
+    int num_ops;
+  };
+
+  /// Compile `ops_` into `plan_`. Runs of constant ops--fixed-axis rotations,
+  /// rig offsets, unit scales--are folded into a single precomputed matrix,
+  /// so their per-frame cost drops to one affine multiply, with no sin/cos.
+  /// A lone constant rotate is still worth folding for the sin/cos alone;
+  /// lone constant translates and scales are cheaper left to the dispatch.
+  /// Recompiled whenever a constant value may have changed; see BlendToOps()
+  /// and SetChildValue().
+  void CompilePlan() {
+    plan_.clear();
+    has_folded_ops_ = false;
+    int i = 0;
+    while (i < num_ops_) {
+      // Find the maximal run of constant ops starting at i. A quaternion
+      // (w, x, y, z) run is consumed as one rotation by the op dispatch, so
+      // it joins a constant run only when all four components are constant.
+      int const_end = i;
+      while (const_end < num_ops_) {
+        if (ops_[const_end].Type() == kQuaternionW) {
+          assert(const_end + 4 <= num_ops_);
+          bool quat_constant = true;
+          for (int q = 0; q < 4; ++q) {
+            quat_constant &= ops_[const_end + q].Constant();
+          }
+          if (!quat_constant) break;
+          const_end += 4;
+          continue;
+        }
+        if (!ops_[const_end].Constant()) break;
+        const_end++;
+      }
+      const int const_run = const_end - i;
+      const bool fold = const_run >= 2 ||
+                        (const_run == 1 && RotateOp(ops_[i].Type()));
+      if (fold) {
+        CompiledStep step;
+        step.constant = MatrixOperation::CalculateResultMatrix(ops_ + i,
+                                                               const_run);
+        step.first_op = i;
+        step.num_ops = 0;
+        plan_.push_back(step);
+        has_folded_ops_ = true;
+        i = const_end;
+        continue;
+      }
+
+      // Gather the run of ops, up to the next foldable run, to execute
+      // through the generic dispatch. Extend an existing dispatch step if
+      // the previous run was too short to fold.
+      if (plan_.empty() || plan_.back().num_ops == 0) {
+        CompiledStep step;
+        step.constant = mathfu::mat4::Identity();
+        step.first_op = i;
+        step.num_ops = 0;
+        plan_.push_back(step);
+      }
+      // An animated quaternion run moves to the dispatch step whole.
+      const int advance = ops_[i].Type() == kQuaternionW ? 4 : 1;
+      plan_.back().num_ops = i + advance - plan_.back().first_op;
+      i += advance;
+    }
+    plan_dirty_ = false;
+  }
+
   /// Result of the most recent matrix update.
   mathfu::mat4 result_matrix_;
 
+  /// Compiled form of `ops_`, executed by UpdateResultMatrix().
+  /// See CompilePlan().
+  std::vector<CompiledStep, mathfu::simd_allocator<CompiledStep>> plan_;
+
+  /// True if the most recent update changed `result_matrix_`.
+  bool result_changed_;
+
+  /// True if `plan_` must be recompiled before the next update.
+  bool plan_dirty_;
+
+  /// True if `plan_` contains at least one folded constant matrix.
+  bool has_folded_ops_;
+
   /// Length of the `ops_` array below, which extends past the end of the
   /// defined class.
   int num_ops_;
@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
+
 #include "motive/matrix_processor.h"
 #include "mathfu/constants.h"
 #include "motive/engine.h"
@@ -22,28 +24,101 @@
 
 namespace motive {
 
+// Number of indices each worker advances when AdvanceFrame is split across
+// a job system. Composing a matrix costs far more than evaluating a spline,
+// so the slices are smaller than the spline processor's.
+static const MotiveIndex kParallelSliceSize = 256;
+
 // See comments on MatrixInit for details on this class.
 class MatrixMotiveProcessor : public MatrixProcessor4f {
  public:
-  MatrixMotiveProcessor() : time_(0) {}
+  MatrixMotiveProcessor()
+      : time_(0), frame_snapshots_(false), snapshot_front_(0) {}
 
   virtual ~MatrixMotiveProcessor() {
     RemoveIndices(0, NumIndices());
   }
 
   virtual void AdvanceFrame(MotiveTime delta_time) {
-    Defragment();
+    BeginAdvanceFrame(delta_time);
+    AdvanceFrameRange(delta_time, 0, NumIndices());
+  }
 
-    // Process the series of matrix operations for each index.
-    const MotiveIndex num_indices = NumIndices();
-    for (MotiveIndex index = 0; index < num_indices; ++index) {
-      MatrixData& d = Data(index);
-      d.UpdateResultMatrix();
-    }
+  virtual void BeginAdvanceFrame(MotiveTime delta_time) {
+    // Index moves would change where concurrent snapshot readers look, so
+    // compaction is suspended while frame snapshots are on. Freed indices
+    // are still recycled in place by the allocator.
+    if (!frame_snapshots_) Defragment();
 
     // Update our global time. It shouldn't matter if this wraps
     // around, since we only calculate times relative to it.
     time_ += delta_time;
+
+    // Advance the inline spline channels before any matrices compose from
+    // them. Motivators created without MatrixInit::inline_splines() have no
+    // channels here, so this is free for them.
+    if (inline_channels_.evaluator().NumIndices() > 0) {
+      inline_channels_.evaluator().AdvanceFrame(static_cast<float>(delta_time));
+    }
+  }
+
+  virtual MotiveIndex ParallelSliceSize() const { return kParallelSliceSize; }
+
+  virtual void AdvanceFrameRange(MotiveTime /*delta_time*/,
+                                 MotiveIndex start_index,
+                                 MotiveIndex end_index) {
+    // Process the series of matrix operations for each index in the range.
+    // Runs of indices whose op signatures match--common when many props are
+    // spawned from the same animation--are composed four matrices at a time;
+    // everything else falls back to one at a time.
+    const MotiveIndex num_indices = end_index;
+    MotiveIndex index = start_index;
+    while (index < num_indices) {
+      MatrixData* const d = data_[index];
+
+      // Skip holes that a budgeted Defragment() has yet to backfill.
+      if (d == nullptr) {
+        ++index;
+        continue;
+      }
+
+      if (index + 4 <= num_indices) {
+        MatrixData* const batch[4] = {d, data_[index + 1], data_[index + 2],
+                                      data_[index + 3]};
+        // MatrixDatas with folded constant runs are cheaper through their
+        // compiled plans than through the four-wide path, so leave them to
+        // the one-at-a-time case below.
+        const bool batchable =
+            batch[1] != nullptr && batch[2] != nullptr &&
+            batch[3] != nullptr && !d->HasFoldedOps() &&
+            !batch[1]->HasFoldedOps() && !batch[2]->HasFoldedOps() &&
+            !batch[3]->HasFoldedOps() && MatrixData::SameOps(*d, *batch[1]) &&
+            MatrixData::SameOps(*d, *batch[2]) &&
+            MatrixData::SameOps(*d, *batch[3]);
+        if (batchable) {
+          MatrixData::UpdateResultMatrices4(batch);
+          if (frame_snapshots_) {
+            for (int m = 0; m < 4; ++m) {
+              if (batch[m]->result_changed()) MarkSnapshotStale(index + m);
+            }
+          }
+          index += 4;
+          continue;
+        }
+      }
+
+      d->UpdateResultMatrix();
+      if (frame_snapshots_ && d->result_changed()) MarkSnapshotStale(index);
+      ++index;
+    }
+  }
+
+  virtual void SetUpdateTier(MotiveIndex index, int tier) {
+    MotiveProcessor::SetUpdateTier(index, tier);
+
+    // Forward the tier to the child motivators that drive the operation
+    // values, so that they skip the same frames.
+    Data(index).SetUpdateTier(tier);
   }
 
   virtual MotivatorType Type() const { return MatrixInit::kType; }
@@ -53,6 +128,60 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
     return Data(index).result_matrix();
   }
 
+  virtual bool ValueChanged(MotiveIndex index) const {
+    return Data(index).result_changed();
+  }
+
+  virtual const mathfu::mat4& SnapshotValue(MotiveIndex index) const {
+    if (!frame_snapshots_) return Value(index);
+    const int front = snapshot_front_.load(std::memory_order_acquire);
+    return snapshot_values_[front][index];
+  }
+
+  virtual void SetFrameSnapshots(bool enable) {
+    if (enable == frame_snapshots_) return;
+    frame_snapshots_ = enable;
+    if (!enable) {
+      for (int b = 0; b < 2; ++b) {
+        snapshot_values_[b].clear();
+        snapshot_stale_[b].clear();
+      }
+      return;
+    }
+
+    // Seed both buffers with the current values, so that reads are sensible
+    // before the first publish.
+    const MotiveIndex num_indices = NumIndices();
+    snapshot_front_.store(0, std::memory_order_relaxed);
+    for (int b = 0; b < 2; ++b) {
+      snapshot_values_[b].assign(num_indices, mathfu::mat4::Identity());
+      snapshot_stale_[b].assign(num_indices, 0);
+      for (MotiveIndex i = 0; i < num_indices; ++i) {
+        if (data_[i] != nullptr) {
+          snapshot_values_[b][i] = data_[i]->result_matrix();
+        }
+      }
+    }
+  }
+
+  virtual void PublishFrameSnapshot() {
+    if (!frame_snapshots_) return;
+
+    // Copy this frame's changed matrices into the back buffer, then flip.
+    // An index is stale in a buffer if its matrix changed since that buffer
+    // was last published, so untouched matrices cost nothing here.
+    const int back = 1 - snapshot_front_.load(std::memory_order_relaxed);
+    std::vector<uint8_t>& stale = snapshot_stale_[back];
+    const MotiveIndex num_indices = NumIndices();
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      if (stale[i] == 0) continue;
+      stale[i] = 0;
+      if (data_[i] == nullptr) continue;
+      snapshot_values_[back][i] = data_[i]->result_matrix();
+    }
+    snapshot_front_.store(back, std::memory_order_release);
+  }
+
   virtual int NumChildren(MotiveIndex index) const {
     return Data(index).num_ops();
   }
@@ -80,7 +209,7 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
                               MotiveChildIndex count, const float* values) {
     MatrixData& d = Data(index);
     for (MotiveChildIndex i = 0; i < count; ++i) {
-      d.Op(child_index + i).SetValue1f(values[i]);
+      d.SetChildValue(child_index + i, values[i]);
     }
   }
 
@@ -111,15 +240,17 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
     // TODO OPT: Create only one MatrixData that holds `dimensions` matrices,
     //           so that we can process in bulk.
     auto init_params = static_cast<const MatrixInit&>(init);
+    InlineSplineChannels* channels =
+        init_params.inline_splines() ? &inline_channels_ : nullptr;
     for (MotiveIndex i = index; i < index + dimensions; ++i) {
-      data_[i] = MatrixData::Create(init_params, engine);
+      data_[i] = MatrixData::Create(init_params, engine, &pool_, channels);
     }
   }
 
   virtual void RemoveIndices(MotiveIndex index, MotiveDimension dimensions) {
     for (MotiveIndex i = index; i < index + dimensions; ++i) {
       if (data_[i] == nullptr) continue;
-      MatrixData::Destroy(data_[i]);
+      MatrixData::Destroy(data_[i], &pool_, &inline_channels_);
       data_[i] = nullptr;
     }
   }
@@ -143,6 +274,38 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
 
     // Initialize new items to nullptr.
     data_.resize(num_indices, nullptr);
+    if (frame_snapshots_) {
+      for (int b = 0; b < 2; ++b) {
+        snapshot_values_[b].resize(num_indices, mathfu::mat4::Identity());
+        snapshot_stale_[b].resize(num_indices, 1);
+      }
+    }
+  }
+
+  virtual void AccumulateDataMemoryStats(MotiveMemoryStats* stats) const {
+    stats->allocated_bytes += data_.capacity() * sizeof(MatrixData*) +
+                              pool_.AllocatedBytes() +
+                              inline_channels_.AllocatedBytes();
+    for (int b = 0; b < 2; ++b) {
+      stats->allocated_bytes +=
+          snapshot_values_[b].capacity() * sizeof(mathfu::mat4) +
+          snapshot_stale_[b].capacity() * sizeof(uint8_t);
+    }
+
+    // Each live matrix owns a variable-size MatrixData allocation.
+    for (size_t i = 0; i < data_.size(); ++i) {
+      if (data_[i] == nullptr) continue;
+      const size_t bytes = data_[i]->AllocatedBytes();
+      stats->allocated_bytes += bytes;
+      stats->live_bytes += bytes + sizeof(MatrixData*);
+    }
+  }
+
+  /// Mark `index` as needing a copy into both snapshot buffers before they
+  /// are next published.
+  void MarkSnapshotStale(MotiveIndex index) {
+    snapshot_stale_[0][index] = 1;
+    snapshot_stale_[1][index] = 1;
   }
 
   const MatrixData& Data(MotiveIndex index) const {
@@ -155,8 +318,29 @@ class MatrixMotiveProcessor : public MatrixProcessor4f {
     return *data_[index];
   }
 
-  std::vector<MatrixData*> data_;
+  std::vector<MatrixData*, BufferAllocator<MatrixData*>> data_;
   MotiveTime time_;
+
+  /// Recycles the MatrixData allocations, so steady-state motivator churn
+  /// never touches the heap.
+  MatrixDataPool pool_;
+
+  /// Embedded spline evaluator for motivators created with
+  /// MatrixInit::inline_splines(): their animated ops read values from here
+  /// instead of from child motivators in the spline processor.
+  InlineSplineChannels inline_channels_;
+
+  /// True if the engine keeps frame snapshots. See
+  /// MotiveEngine::SetFrameSnapshots().
+  bool frame_snapshots_;
+
+  /// Double-buffered copies of the result matrices, indexed like `data_`.
+  /// Readers follow `snapshot_front_`; PublishFrameSnapshot() writes the
+  /// other buffer and then flips.
+  std::vector<mathfu::mat4, mathfu::simd_allocator<mathfu::mat4>>
+      snapshot_values_[2];
+  std::vector<uint8_t> snapshot_stale_[2];
+  std::atomic<int> snapshot_front_;
 };
 
 MOTIVE_INSTANCE(MatrixInit, MatrixMotiveProcessor);
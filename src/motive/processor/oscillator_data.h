@@ -0,0 +1,79 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MOTIVE_OSCILLATOR_DATA_H_
+#define MOTIVE_OSCILLATOR_DATA_H_
+
+#include "motive/oscillator_init.h"
+#include "motive/simple_processor_template.h"
+
+namespace motive {
+
+// Number of value-noise cells before the noise pattern repeats. One cell
+// spans one radian of phase, so at noise weight 1 the pattern repeats
+// roughly every 41 cycles--long enough that ambient motion never visibly
+// loops.
+static const float kOscillatorNoisePeriod = 256.0f;
+
+struct OscillatorData {
+  OscillatorData()
+      : center(0.0f),
+        amplitude(0.0f),
+        frequency(0.0f),
+        noise_weight(0.0f),
+        phase(0.0f),
+        noise_x(0.0f),
+        noise_seed(0) {}
+
+  OscillatorData(const SimpleInit& init, MotiveIndex current_dimension)
+      : center(init.start_values[current_dimension]),
+        noise_x(0.0f),
+        noise_seed(0) {
+    // InitializeIndices() only constructs us from inits of our own type.
+    const OscillatorInit& osc = static_cast<const OscillatorInit&>(init);
+    amplitude = osc.amplitudes[current_dimension];
+    frequency = osc.frequencies[current_dimension];
+    noise_weight = osc.noise_weights == nullptr
+                       ? 0.0f
+                       : osc.noise_weights[current_dimension];
+    phase = osc.phases == nullptr ? 0.0f : osc.phases[current_dimension];
+  }
+
+  // Value the oscillation is centered on.
+  float center;
+
+  // Peak offset from `center`.
+  float amplitude;
+
+  // Angular speed, in radians per time unit.
+  float frequency;
+
+  // Noise fraction of the sine/noise blend, in [0, 1].
+  float noise_weight;
+
+  // Current sine phase, kept wrapped to [-pi, pi).
+  float phase;
+
+  // Current noise coordinate, in cells, kept wrapped to
+  // [0, kOscillatorNoisePeriod). Advances one cell per radian of phase.
+  float noise_x;
+
+  // Per-index salt for the noise hash, so identically-parameterized
+  // oscillators still flicker independently. Assigned at initialization.
+  uint32_t noise_seed;
+};
+
+}  // namespace motive
+
+#endif  // MOTIVE_OSCILLATOR_DATA_H_
@@ -0,0 +1,206 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+
+#include "motive/math/angle.h"
+#include "motive/oscillator_init.h"
+#include "motive/processor/oscillator_data.h"
+#include "motive/simple_processor_template.h"
+
+#if defined(MOTIVE_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
+
+namespace motive {
+
+// Number of noise cells, as an integer mask. Must match
+// kOscillatorNoisePeriod, which must therefore be a power of two.
+static const uint32_t kOscillatorNoiseMask =
+    static_cast<uint32_t>(kOscillatorNoisePeriod) - 1;
+
+// Coefficients of the quadratic sine approximation in FastSine().
+static const float kSineB = 4.0f / kPi;
+static const float kSineC = -4.0f / (kPi * kPi);
+static const float kSineP = 0.225f;
+
+// Approximate sin(p) for p in [-pi, pi): a parabola through the zeroes and
+// extrema of the sine wave, refined once toward the true curve. Maximum
+// error is ~0.1% of the amplitude--invisible in ambient motion--and the
+// evaluation is branchless arithmetic, so the bulk loop in AdvanceFrame()
+// vectorizes.
+static inline float FastSine(float p) {
+  const float y = kSineB * p + kSineC * p * fabsf(p);
+  return kSineP * (y * fabsf(y) - y) + y;
+}
+
+// Hash a noise cell to a repeatable pseudo-random value in [-1, 1].
+// Integer bit mixing, so neighboring cells are uncorrelated.
+static inline float NoiseCellValue(uint32_t cell, uint32_t seed) {
+  uint32_t h = cell * 0x9E3779B9u + seed;
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+  return static_cast<float>(h) * (2.0f / 4294967295.0f) - 1.0f;
+}
+
+// Smooth value noise at coordinate `x` in [0, kOscillatorNoisePeriod):
+// cubic interpolation between the hashed values of the neighboring cells.
+// `slope`, when non-null, receives the derivative with respect to x.
+static inline float SmoothNoise(float x, uint32_t seed, float* slope) {
+  const float floor_x = floorf(x);
+  const float t = x - floor_x;
+  const uint32_t cell = static_cast<uint32_t>(floor_x);
+  const float v0 = NoiseCellValue(cell & kOscillatorNoiseMask, seed);
+  const float v1 = NoiseCellValue((cell + 1) & kOscillatorNoiseMask, seed);
+  const float smooth_t = t * t * (3.0f - 2.0f * t);
+  if (slope != nullptr) {
+    *slope = (v1 - v0) * 6.0f * t * (1.0f - t);
+  }
+  return v0 + (v1 - v0) * smooth_t;
+}
+
+// The following functions are called from SimpleProcessorTemplate.
+static inline float SimpleVelocity(const OscillatorData& d, float /*value*/) {
+  // cosf() here and FastSine() in the bulk loop disagree by the
+  // approximation error (~0.1%); queries prefer the exact derivative.
+  float noise_slope = 0.0f;
+  SmoothNoise(d.noise_x, d.noise_seed, &noise_slope);
+  const float blend_slope = (1.0f - d.noise_weight) * cosf(d.phase) +
+                            d.noise_weight * noise_slope;
+  return d.amplitude * d.frequency * blend_slope;
+}
+
+static inline float SimpleTargetValue(const OscillatorData& d,
+                                      float /*value*/) {
+  return d.center;
+}
+
+static inline float SimpleTargetVelocity(const OscillatorData& /*d*/,
+                                         float /*value*/) {
+  return 0.0f;
+}
+
+static inline float SimpleDifference(const OscillatorData& d, float value) {
+  return d.center - value;
+}
+
+static inline MotiveTime SimpleTargetTime(const OscillatorData& /*d*/) {
+  // Oscillators never settle.
+  return 0;
+}
+
+class OscillatorMotiveProcessor
+    : public SimpleProcessorTemplate<OscillatorData> {
+ public:
+  OscillatorMotiveProcessor() : next_noise_seed_(0) {}
+  virtual ~OscillatorMotiveProcessor() {}
+
+  virtual void AdvanceFrame(MotiveTime delta_time) {
+    Defragment();
+
+    // First pass, scalar: advance each oscillator's phase and noise
+    // coordinate, evaluate the noise term (integer hashing, so it stays in
+    // the scalar pass), and gather the sine term's inputs into parallel
+    // arrays. Wrapping keeps the phase small, so precision never degrades
+    // no matter how long an oscillator runs.
+    const float delta = static_cast<float>(delta_time);
+    const size_t num_indices = data_.size();
+    for (size_t i = 0; i < num_indices; ++i) {
+      OscillatorData& d = data_[i];
+      const float advance = d.frequency * delta;
+      d.phase += advance;
+      if (d.phase >= kPi) d.phase -= kTwoPi;
+      d.noise_x += advance;
+      if (d.noise_x >= kOscillatorNoisePeriod) {
+        d.noise_x -= kOscillatorNoisePeriod;
+      }
+
+      phases_[i] = d.phase;
+      sine_amplitudes_[i] = d.amplitude * (1.0f - d.noise_weight);
+      bases_[i] = d.center + d.amplitude * d.noise_weight *
+                                 SmoothNoise(d.noise_x, d.noise_seed, nullptr);
+    }
+
+    // Second pass: evaluate every sine in bulk from the parallel arrays.
+    //   value = base + sine_amplitude * FastSine(phase)
+#if defined(MOTIVE_NEON_INTRINSICS)
+    const float32x4_t b = vdupq_n_f32(kSineB);
+    const float32x4_t c = vdupq_n_f32(kSineC);
+    const float32x4_t p225 = vdupq_n_f32(kSineP);
+    size_t i = 0;
+    for (; i + 4 <= num_indices; i += 4) {
+      const float32x4_t p = vld1q_f32(&phases_[i]);
+      const float32x4_t y = vmlaq_f32(vmulq_f32(b, p), c,
+                                      vmulq_f32(p, vabsq_f32(p)));
+      const float32x4_t sine =
+          vmlaq_f32(y, p225, vsubq_f32(vmulq_f32(y, vabsq_f32(y)), y));
+      const float32x4_t value =
+          vmlaq_f32(vld1q_f32(&bases_[i]), vld1q_f32(&sine_amplitudes_[i]),
+                    sine);
+      vst1q_f32(&values_[i], value);
+    }
+    for (; i < num_indices; ++i) {
+      values_[i] = bases_[i] + sine_amplitudes_[i] * FastSine(phases_[i]);
+    }
+#else
+    // Contiguous independent iterations; the compiler can auto-vectorize.
+    for (size_t i = 0; i < num_indices; ++i) {
+      values_[i] = bases_[i] + sine_amplitudes_[i] * FastSine(phases_[i]);
+    }
+#endif  // defined(MOTIVE_NEON_INTRINSICS)
+  }
+
+  virtual MotivatorType Type() const { return OscillatorInit::kType; }
+  virtual int Priority() const { return 1; }
+
+ protected:
+  virtual void InitializeIndices(const MotivatorInit& init, MotiveIndex index,
+                                 MotiveDimension dimensions,
+                                 MotiveEngine* engine) {
+    SimpleProcessorTemplate<OscillatorData>::InitializeIndices(
+        init, index, dimensions, engine);
+
+    // Salt each index's noise differently, so identically-parameterized
+    // oscillators still flicker independently.
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      Data(index + i).noise_seed = next_noise_seed_++;
+    }
+  }
+
+  virtual void SetNumIndices(MotiveIndex num_indices) {
+    SimpleProcessorTemplate<OscillatorData>::SetNumIndices(num_indices);
+    phases_.resize(num_indices);
+    sine_amplitudes_.resize(num_indices);
+    bases_.resize(num_indices);
+  }
+
+ private:
+  // Per-frame scratch arrays holding each oscillator's sine inputs, with
+  // the center value and the noise term pre-folded into `bases_`. Kept in
+  // struct-of-arrays form so the evaluation loop in AdvanceFrame() can be
+  // processed with SIMD.
+  std::vector<float> phases_;
+  std::vector<float> sine_amplitudes_;
+  std::vector<float> bases_;
+
+  // Source of per-index noise seeds; see InitializeIndices().
+  uint32_t next_noise_seed_;
+};
+
+MOTIVE_INSTANCE(OscillatorInit, OscillatorMotiveProcessor);
+
+}  // namespace motive
@@ -12,12 +12,27 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cmath>
+
 #include "motive/engine.h"
 #include "motive/overshoot_init.h"
 #include "motive/processor/overshoot_data.h"
+#include "motive/util/benchmark.h"
 
 namespace motive {
 
+// Maximum number of analytic segments to advance per frame before giving the
+// rest of the frame's time to the stepped integrator. Each segment is at
+// least a quarter oscillation, so this is more than any sane frame needs.
+static const int kMaxAnalyticSegments = 16;
+
+// A quarter turn (pi/2) and a full turn (2*pi) of oscillation
+// phase, plus the smallest phase angle we bother advancing by. Regime
+// changes happen every quarter turn; see AdvanceAnalytically().
+static const float kQuarterTurn = 1.57079632679489661923f;
+static const float kFullTurn = 4.0f * kQuarterTurn;
+static const float kMinAngleStep = 1e-4f;
+
 class OvershootMotiveProcessor : public MotiveProcessorNf {
  public:
   virtual ~OvershootMotiveProcessor() {}
@@ -26,30 +41,41 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
     Defragment();
 
     // Loop through every motivator one at a time.
-    // TODO: change this to a closed-form equation.
     // TODO OPT: reorder data and then optimize with SIMD to process in groups
     // of 4 floating-point or 8 fixed-point values.
     for (size_t i = 0; i < data_.size(); ++i) {
       OvershootData& d = data_[i];
-      for (MotiveTime time_remaining = delta_time; time_remaining > 0;) {
-        MotiveTime dt = std::min(time_remaining, d.init.max_delta_time());
 
-        d.velocity = CalculateVelocity(dt, d, values_[i]);
-        values_[i] = CalculateValue(dt, d, values_[i]);
-
-        time_remaining -= dt;
+      // A settled motivator is parked exactly at its target with zero
+      // velocity (the AtTarget() snap guarantees exact zeros), and stays
+      // there until SetTargets() gives it somewhere to go. Skip the curve
+      // math entirely. Most motivators idle like this most of the time.
+      if (d.velocity == 0.0f &&
+          Normalize(d, d.target_value - values_[i]) == 0.0f) {
+        continue;
       }
+
+      AdvanceAnalytically(delta_time, d, &values_[i]);
     }
   }
 
   virtual MotivatorType Type() const { return OvershootInit::kType; }
   virtual int Priority() const { return 1; }
 
+  virtual bool SupportsMigration() const { return true; }
+
   // Accessors to allow the user to get and set simluation values.
   virtual const float* Values(MotiveIndex index) const {
     return &values_[index];
   }
 
+  virtual void GatherValues(const MotiveIndex* indices, MotiveIndex count,
+                            float* out) const {
+    for (MotiveIndex i = 0; i < count; ++i) {
+      out[i] = values_[indices[i]];
+    }
+  }
+
   virtual void Velocities(MotiveIndex index, MotiveDimension dimensions,
                           float* out) const {
     for (MotiveDimension i = 0; i < dimensions; ++i) {
@@ -88,6 +114,7 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
 
   virtual void SetTargets(MotiveIndex index, MotiveDimension dimensions,
                           const MotiveTarget1f* ts) {
+    AddMotiveEvents(kMotiveEventSetTargets, 1);
     const MotiveTarget1f* t = ts;
     for (MotiveIndex i = index; i < index + dimensions; ++i, ++t) {
       OvershootData& d = Data(i);
@@ -110,6 +137,143 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
   }
 
  protected:
+  /// Advance the simulation with closed-form curves instead of
+  /// max_delta_time() steps.
+  ///
+  /// The overshoot system is an undamped spring with piecewise-constant
+  /// parameters: acceleration is `accel_per_difference * difference`, scaled
+  /// by `wrong_direction_multiplier` whenever we move away from the target,
+  /// and speed is capped at the maximum velocity. Between those regime
+  /// changes the motion is exactly harmonic,
+  ///     difference(t) = -(V/w) * sin(w*t - phase)
+  ///     velocity(t)   =   V    * cos(w*t - phase)
+  /// so we jump analytically from regime boundary to regime boundary rather
+  /// than looping once per millisecond.
+  void AdvanceAnalytically(MotiveTime delta_time, OvershootData& d,
+                           float* value) {
+    const float k = d.init.accel_per_difference();
+    if (k <= 0.0f) {
+      // Degenerate spring. Keep the original stepped behavior.
+      AdvanceStepped(delta_time, d, value);
+      return;
+    }
+
+    float t = static_cast<float>(delta_time);
+    float diff = Normalize(d, d.target_value - *value);
+    float v = d.velocity;
+
+    // The stepped integrator limits movement per max_delta_time() step to
+    // max_delta(), which amounts to an extra speed cap.
+    const MotiveTime max_dt = d.init.max_delta_time();
+    const float delta_cap = max_dt > 0
+                                ? d.init.max_delta() / static_cast<float>(max_dt)
+                                : d.init.max_velocity();
+    const float max_velocity = std::min(d.init.max_velocity(), delta_cap);
+
+    int segment = 0;
+    for (; segment < kMaxAnalyticSegments && t > 0.0f; ++segment) {
+      // Snap to the target once we're close and slow, like the stepped
+      // integrator does. This is what bleeds energy out of the system.
+      if (d.init.AtTarget(diff, v)) {
+        diff = 0.0f;
+        v = 0.0f;
+        t = 0.0f;
+        break;
+      }
+
+      // While moving towards the target at the speed cap, the value closes
+      // on the target linearly. This regime ends when we pass the target.
+      const bool at_speed_cap = std::fabs(v) >= max_velocity;
+      const bool moving_towards = v * diff > 0.0f;
+      if (at_speed_cap && moving_towards) {
+        v = v > 0.0f ? max_velocity : -max_velocity;
+        const float time_to_target = diff / v;
+        if (time_to_target >= t) {
+          diff -= v * t;
+          t = 0.0f;
+        } else {
+          diff = 0.0f;
+          t -= time_to_target;
+        }
+        continue;
+      }
+
+      // Harmonic regime. The multiplier, and therefore the frequency, is
+      // constant until `v` or `diff` changes sign, i.e. for a quarter of an
+      // oscillation. In angle u = w*t - phase,
+      //     v = magnitude * cos(u),   diff = -(magnitude / w) * sin(u)
+      // and regimes change at multiples of pi/2.
+      const bool wrong_direction = v * diff < 0.0f;
+      const float multiplier =
+          wrong_direction ? d.init.wrong_direction_multiplier() : 1.0f;
+      const float w = std::sqrt(k * multiplier);
+      const float magnitude = std::sqrt(v * v + w * w * diff * diff);
+      if (w <= 0.0f || magnitude <= 0.0f) break;
+
+      const float u_start = std::atan2(-w * diff, v);
+      const float u_quadrant =
+          (std::floor(u_start / kQuarterTurn) + 1.0f) * kQuarterTurn;
+      const float u_frame = u_start + w * t;
+      float u_next = std::min(u_quadrant, u_frame);
+
+      // If our speed would exceed the cap within this quarter turn, stop at
+      // the moment the cap is reached instead.
+      if (magnitude > max_velocity &&
+          std::fabs(v) < max_velocity &&
+          std::fabs(magnitude * std::cos(u_next)) >= max_velocity) {
+        const float cap_sign = std::cos(u_start) >= 0.0f ? 1.0f : -1.0f;
+        u_next = AngleForCos(cap_sign * max_velocity / magnitude, u_start,
+                             u_next);
+      }
+
+      // Evaluate the harmonic curves at `u_next` and consume the elapsed
+      // time. Nudge past exact quadrant boundaries so we can't get stuck.
+      const float u_advanced = std::max(u_next, u_start + kMinAngleStep);
+      t -= (u_advanced - u_start) / w;
+      v = magnitude * std::cos(u_advanced);
+      diff = -(magnitude / w) * std::sin(u_advanced);
+    }
+
+    // Give any remaining time to the stepped integrator. Only pathological
+    // parameters (e.g. enormous frequencies) can leave time over.
+    d.velocity = v;
+    *value = d.init.range().Clamp(Normalize(d, d.target_value - diff));
+    if (segment >= kMaxAnalyticSegments && t >= 1.0f) {
+      AdvanceStepped(static_cast<MotiveTime>(t), d, value);
+    }
+  }
+
+  /// The original integrator: steps of at most max_delta_time(). Kept as the
+  /// fallback for degenerate spring parameters.
+  void AdvanceStepped(MotiveTime delta_time, OvershootData& d, float* value) {
+    for (MotiveTime time_remaining = delta_time; time_remaining > 0;) {
+      MotiveTime dt = std::min(time_remaining, d.init.max_delta_time());
+
+      d.velocity = CalculateVelocity(dt, d, *value);
+      *value = CalculateValue(dt, d, *value);
+
+      time_remaining -= dt;
+    }
+  }
+
+  /// Return u in (u_lo, u_hi] with cos(u) == cos_value. The interval must be
+  /// within one quadrant, where cos is monotonic, so at most one such u
+  /// exists. Returns u_hi if rounding pushes the solution outside.
+  static float AngleForCos(float cos_value, float u_lo, float u_hi) {
+    const float base = std::acos(mathfu::Clamp(cos_value, -1.0f, 1.0f));
+    const float turn = std::floor(u_lo / kFullTurn) * kFullTurn;
+    for (int n = 0; n <= 1; ++n) {
+      const float offset = turn + static_cast<float>(n) * kFullTurn;
+      const float candidates[2] = {offset + base, offset - base};
+      for (int c = 0; c < 2; ++c) {
+        if (u_lo < candidates[c] && candidates[c] <= u_hi) {
+          return candidates[c];
+        }
+      }
+    }
+    return u_hi;
+  }
+
   virtual void InitializeIndices(const MotivatorInit& init, MotiveIndex index,
                                  MotiveDimension dimensions,
                                  MotiveEngine* /*engine*/) {
@@ -133,11 +297,29 @@ class OvershootMotiveProcessor : public MotiveProcessorNf {
     }
   }
 
+  virtual void CopyIndices(MotiveIndex index, MotiveDimension dimensions,
+                           const MotiveProcessor& source,
+                           MotiveIndex source_index) {
+    const OvershootMotiveProcessor& src =
+        static_cast<const OvershootMotiveProcessor&>(source);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      data_[index + i] = src.data_[source_index + i];
+      values_[index + i] = src.values_[source_index + i];
+    }
+  }
+
   virtual void SetNumIndices(MotiveIndex num_indices) {
     data_.resize(num_indices);
     values_.resize(num_indices);
   }
 
+  virtual void AccumulateDataMemoryStats(MotiveMemoryStats* stats) const {
+    stats->allocated_bytes += data_.capacity() * sizeof(OvershootData) +
+                              values_.capacity() * sizeof(float);
+    stats->live_bytes +=
+        NumLiveIndices() * (sizeof(OvershootData) + sizeof(float));
+  }
+
   const OvershootData& Data(MotiveIndex index) const {
     assert(ValidIndex(index));
     return data_[index];
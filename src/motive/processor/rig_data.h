@@ -15,17 +15,27 @@
 #ifndef MOTIVE_RIG_DATA_H_
 #define MOTIVE_RIG_DATA_H_
 
+#include <algorithm>
+#include <atomic>
 #include <iomanip>
 #include <sstream>
 
 #include "mathfu/constants.h"
+#include "mathfu/quaternion.h"
+#include "motive/baked_clip.h"
 #include "motive/engine.h"
 #include "motive/math/angle.h"
 #include "motive/math/bulk_spline_evaluator.h"
 #include "motive/matrix_init.h"
 #include "motive/matrix_motivator.h"
+#include "motive/processor/matrix_data.h"
 #include "motive/rig_anim.h"
 #include "motive/rig_init.h"
+#include "motive/rig_processor.h"
+
+#if defined(MOTIVE_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
 
 namespace motive {
 
@@ -36,32 +46,53 @@ class RigData {
  public:
   explicit RigData(const RigInit& init, MotiveTime start_time,
                    MotiveEngine* engine)
-      : defining_anim_(&init.defining_anim()),
+      : mask_pose_dirty_(false),
+        update_tier_(0),
+        snapshots_enabled_(false),
+        dual_quats_enabled_(false),
+        snapshot_front_(0),
+        defining_anim_(&init.defining_anim()),
         current_anim_(nullptr),
-        end_time_(start_time) {
+        baked_clip_(nullptr),
+        clip_start_time_(0),
+        clip_time_remaining_(0),
+        end_time_(start_time),
+        engine_(engine) {
     const BoneIndex num_bones = defining_anim_->NumBones();
 
     motivators_.resize(num_bones);
     global_transforms_.resize(num_bones);
+    global_dirty_.resize(num_bones);
 
-    // Initialize the motivators that drive the local transforms.
+    // Initialize the motivators that drive the local transforms. BoneOps()
+    // walks the packed op array when the defining anim provides one, so
+    // initialization reads sequential memory.
     for (BoneIndex i = 0; i < num_bones; ++i) {
-      const std::vector<MatrixOperationInit>& ops =
-          defining_anim_->Anim(i).ops();
-      motivators_[i].Initialize(MatrixInit(ops), engine);
+      int num_ops = 0;
+      const MatrixOperationInit* ops = defining_anim_->BoneOps(i, &num_ops);
+      motivators_[i].Initialize(MatrixInit(ops, num_ops), engine);
     }
 
     // Initialize global transforms to default pose.
     // These will get overridden the first time AdvanceFrame() is called, but
     // we initialize them nicely anyway.
-    UpdateGlobalTransforms();
+    UpdateGlobalTransforms(start_time);
   }
 
   ~RigData() {
+    ClearBlendLayers();
   }
 
   void BlendToAnim(const RigAnim& anim, const motive::SplinePlayback& playback,
                    MotiveTime start_time) {
+    // If an N-way blend is active, carry its pose into the per-bone
+    // motivators so that this blend starts from the pose on screen.
+    if (!blend_layers_.empty()) {
+      SnapMotivatorsToBlendedPose();
+      ClearBlendLayers();
+    }
+    baked_clip_ = nullptr;
+
     end_time_ = start_time + anim.end_time();
 
     // When animation has only one bone, or mesh has only one bone,
@@ -71,17 +102,195 @@ class RigData {
     assert(defining_num_bones == 1 || anim_num_bones == 1 ||
            RigInit::MatchesHierarchy(anim, *defining_anim_));
 
-    // Update the motivators to blend to our new values.
+    // Update the motivators to blend to our new values. Masked-out bones
+    // have no motivators and keep their constant pose.
     for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+      if (!BoneEnabled(i)) continue;
       const std::vector<MatrixOperationInit>& ops =
           i >= anim_num_bones ? kEmptyOps : anim.Anim(i).ops();
       motivators_[i].BlendToOps(ops, playback);
     }
 
+    // Blending may create new op motivators; keep them in our tier.
+    if (update_tier_ != 0) SetUpdateTier(update_tier_);
+
     // Remember the currently playing animation, for debugging purposes.
     current_anim_ = &anim;
   }
 
+  /// Blend to the weighted combination of `anims`. Each anim gets its own
+  /// layer of child motivators (whose splines are all evaluated through the
+  /// engine's shared BulkSplineEvaluator), and each frame the operation
+  /// values of all layers are mixed with normalized weighted sums before the
+  /// local matrices are composed. Weighted sums of rotation angles are a good
+  /// approximation when the anims' poses are similar--the locomotion case--
+  /// but degrade as rotations diverge.
+  void BlendToAnims(const RigAnim* const* anims, const float* weights,
+                    int num_anims, const motive::SplinePlayback& playback,
+                    MotiveTime start_time) {
+    assert(num_anims > 0);
+    if (num_anims == 1) {
+      BlendToAnim(*anims[0], playback, start_time);
+      return;
+    }
+
+    ClearBlendLayers();
+    baked_clip_ = nullptr;
+
+    const int defining_num_bones = NumBones();
+    MotiveTime latest_end_time = start_time;
+    bool endless = false;
+    blend_layers_.resize(num_anims);
+    for (int k = 0; k < num_anims; ++k) {
+      const RigAnim& anim = *anims[k];
+      const int anim_num_bones = anim.NumBones();
+      assert(defining_num_bones == 1 || anim_num_bones == 1 ||
+             RigInit::MatchesHierarchy(anim, *defining_anim_));
+
+      BlendLayer& layer = blend_layers_[k];
+      layer.weight = weights[k];
+      layer.bone_data.resize(defining_num_bones);
+      for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+        // Masked-out bones get no layer data; resize() left them null.
+        if (!BoneEnabled(i)) continue;
+        const std::vector<MatrixOperationInit>& ops =
+            i >= anim_num_bones ? kEmptyOps : anim.Anim(i).ops();
+        layer.bone_data[i] = MatrixData::Create(MatrixInit(ops), engine_);
+        layer.bone_data[i]->BlendToOps(ops, playback);
+      }
+
+      if (anim.end_time() == kMotiveTimeEndless) {
+        endless = true;
+      } else {
+        latest_end_time = std::max(latest_end_time,
+                                   start_time + anim.end_time());
+      }
+    }
+    end_time_ = endless ? kMotiveTimeEndless : latest_end_time;
+
+    // Force every bone to be recomposed on the next update.
+    blend_prev_.clear();
+    blend_locals_.resize(defining_num_bones);
+    blend_bone_dirty_.resize(defining_num_bones);
+
+    // The new layers' op motivators default to tier 0; keep them in ours.
+    if (update_tier_ != 0) SetUpdateTier(update_tier_);
+
+    // Remember the first animation, for debugging purposes.
+    current_anim_ = anims[0];
+  }
+
+  /// Update the weights of a blend started with BlendToAnims(). Cheap; safe
+  /// to call every frame, e.g. as a character accelerates from walk to run.
+  /// Weights are normalized each frame, so they needn't sum to one. If all
+  /// weights are zero, the rig holds its last pose.
+  void SetBlendWeights(const float* weights, int num_weights) {
+    const int num_layers = static_cast<int>(blend_layers_.size());
+    const int n = std::min(num_weights, num_layers);
+    for (int k = 0; k < n; ++k) {
+      blend_layers_[k].weight = weights[k];
+    }
+  }
+
+  /// Restrict animation to the bones with non-zero `enabled` entries.
+  /// Masked-out bones release their op motivators--removing their splines
+  /// from bulk evaluation and freeing their per-index state--and hold the
+  /// constant local transform given by the defining anim's op values.
+  /// Re-enabled bones get fresh motivators at that same pose; blend to an
+  /// anim afterwards to put them back in motion. Pass nullptr to enable
+  /// every bone. Bones past `num_mask_bones` stay enabled. Baked-clip
+  /// playback composes every bone from the clip and ignores the mask.
+  void SetBoneMask(const uint8_t* enabled, int num_mask_bones) {
+    const int num_bones = NumBones();
+
+    // Build the new mask. Empty means every bone is enabled.
+    std::vector<uint8_t> new_mask;
+    if (enabled != nullptr) {
+      new_mask.assign(num_bones, 1);
+      bool any_masked = false;
+      const int n = std::min(num_bones, num_mask_bones);
+      for (int i = 0; i < n; ++i) {
+        if (enabled[i] == 0) {
+          new_mask[i] = 0;
+          any_masked = true;
+        }
+      }
+      if (!any_masked) new_mask.clear();
+    }
+
+    // Create or release motivators for bones whose state changed.
+    for (BoneIndex i = 0; i < num_bones; ++i) {
+      const bool was = bone_enabled_.empty() || bone_enabled_[i] != 0;
+      const bool now = new_mask.empty() || new_mask[i] != 0;
+      if (was == now) continue;
+      mask_pose_dirty_ = true;
+      if (now) {
+        int num_ops = 0;
+        const MatrixOperationInit* ops = defining_anim_->BoneOps(i, &num_ops);
+        motivators_[i].Initialize(MatrixInit(ops, num_ops), engine_);
+        if (update_tier_ != 0) motivators_[i].SetUpdateTier(update_tier_);
+      } else {
+        motivators_[i].Invalidate();
+      }
+    }
+
+    bone_enabled_.swap(new_mask);
+    if (bone_enabled_.empty()) {
+      masked_locals_.clear();
+      return;
+    }
+    masked_locals_.resize(num_bones);
+    for (BoneIndex i = 0; i < num_bones; ++i) {
+      if (bone_enabled_[i] == 0) {
+        ComposeDefiningLocal(i, &masked_locals_[i]);
+      }
+    }
+  }
+
+  /// Switch to baked-clip playback: each frame the pose is lerped from
+  /// `clip`'s keyframes and composed directly, with no spline evaluation.
+  /// The per-bone op motivators are eased to rest so their splines settle
+  /// into the bulk evaluator's dormant path. Call BlendToAnim() to return to
+  /// spline playback; that blend eases in from the rest pose, so give it a
+  /// blend time when the transition is visible.
+  void PlayBakedClip(const BakedClip* clip, MotiveTime start_time) {
+    assert(clip != nullptr && clip->NumBones() == NumBones());
+    if (!blend_layers_.empty()) ClearBlendLayers();
+
+    const int defining_num_bones = NumBones();
+    for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+      if (!BoneEnabled(i)) continue;
+      motivators_[i].BlendToOps(kEmptyOps, motive::SplinePlayback());
+    }
+
+    baked_clip_ = clip;
+    clip_start_time_ = start_time;
+    clip_time_remaining_ = clip->clip_length();
+    end_time_ = clip->repeat() ? kMotiveTimeEndless
+                               : start_time + clip->clip_length();
+    clip_locals_.resize(defining_num_bones);
+    current_anim_ = nullptr;
+  }
+
+  /// Swap references to `old_anim` for `new_anim` after a hot reload. The
+  /// splines inside the anims are re-pointed separately, through the spline
+  /// processor; this fixes the pointers the rig itself keeps. If the
+  /// defining anim was reloaded, its op layout must be unchanged--the
+  /// motivator structure built in the constructor derives from it.
+  void RebindAnim(const RigAnim& old_anim, const RigAnim& new_anim) {
+    if (defining_anim_ == &old_anim) defining_anim_ = &new_anim;
+    if (current_anim_ != &old_anim) return;
+
+    // The reloaded anim may have a different length; keep the same position
+    // within it by shifting the expected completion time.
+    if (end_time_ != kMotiveTimeEndless &&
+        old_anim.end_time() != kMotiveTimeEndless &&
+        new_anim.end_time() != kMotiveTimeEndless) {
+      end_time_ += new_anim.end_time() - old_anim.end_time();
+    }
+    current_anim_ = &new_anim;
+  }
+
   const RigAnim* current_anim() const { return current_anim_; }
 
   void SetPlaybackRate(float playback_rate) {
@@ -89,34 +298,228 @@ class RigData {
     // TODO: Do this in bulk.
     const int defining_num_bones = NumBones();
     for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+      if (!BoneEnabled(i)) continue;
       motivators_[i].SetPlaybackRate(playback_rate);
     }
+
+    // Blend layers play their own copies of the anims' splines.
+    const int num_layers = static_cast<int>(blend_layers_.size());
+    for (int k = 0; k < num_layers; ++k) {
+      for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+        if (blend_layers_[k].bone_data[i] == nullptr) continue;
+        blend_layers_[k].bone_data[i]->SetPlaybackRate(playback_rate);
+      }
+    }
+  }
+
+  /// Forward an update-rate tier to every motivator in the rig's hierarchy:
+  /// the per-bone matrix motivators, their op motivators, and--when an N-way
+  /// blend is active--the blend layers' op motivators. The tier is
+  /// remembered, so motivators created by later blends inherit it.
+  void SetUpdateTier(int tier) {
+    update_tier_ = tier;
+    const int defining_num_bones = NumBones();
+    for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+      if (!BoneEnabled(i)) continue;
+      motivators_[i].SetUpdateTier(tier);
+    }
+    const int num_layers = static_cast<int>(blend_layers_.size());
+    for (int k = 0; k < num_layers; ++k) {
+      for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+        if (blend_layers_[k].bone_data[i] == nullptr) continue;
+        blend_layers_[k].bone_data[i]->SetUpdateTier(tier);
+      }
+    }
   }
 
   MotiveTime TimeRemaining() const {
     if (end_time_ == kMotiveTimeEndless) {
       return kMotiveTimeEndless;
     }
+    if (baked_clip_ != nullptr) {
+      return clip_time_remaining_;
+    }
     MotiveTime time = 0;
     const int defining_num_bones = NumBones();
+    if (!blend_layers_.empty()) {
+      const int num_layers = static_cast<int>(blend_layers_.size());
+      for (int k = 0; k < num_layers; ++k) {
+        for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+          if (blend_layers_[k].bone_data[i] == nullptr) continue;
+          time = std::max(time, blend_layers_[k].bone_data[i]->TimeRemaining());
+        }
+      }
+      return time;
+    }
     for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+      if (!BoneEnabled(i)) continue;
       time = std::max(time, motivators_[i].TimeRemaining());
     }
     return time;
   }
 
-  void UpdateGlobalTransforms() {
-    CalculateGlobalTransforms(global_transforms_.data());
+  /// Convert local transforms from `motivators_` into global transforms,
+  /// recomputing only the bones that need it. A bone is dirty when its local
+  /// transform changed this frame, or when its parent's global transform was
+  /// recomputed; clean bones keep their cached globals. Partial-body anims
+  /// touch only a fraction of the rig, so this skips most of the hierarchy
+  /// walk. The `bone_parents` are layed out such that the parent always
+  /// comes before the child, so one pass suffices; the order is validated
+  /// once by RigInit (see RigInit::TopologicallyOrdered()), so the loop
+  /// carries no hierarchy checks.
+  // TODO OPT: process runs of sibling bones in SIMD groups; the validated
+  //           memory order guarantees parents are already computed.
+  void UpdateGlobalTransforms(MotiveTime time) {
+    if (baked_clip_ != nullptr) {
+      UpdateGlobalTransformsFromClip(time);
+      return;
+    }
+
+    const bool blending = !blend_layers_.empty();
+    if (blending) UpdateBlendedLocals();
+
+    const BoneIndex* parents = defining_anim_->bone_parents();
+    const int num_bones = NumBones();
+    for (int i = 0; i < num_bones; ++i) {
+      const int parent_idx = parents[i];
+      const bool parent_dirty =
+          parent_idx != kInvalidBoneIdx && global_dirty_[parent_idx] != 0;
+      const bool enabled = BoneEnabled(static_cast<BoneIndex>(i));
+      const bool local_changed =
+          !enabled ? mask_pose_dirty_
+                   : blending ? blend_bone_dirty_[i] != 0
+                              : motivators_[i].ValueChanged();
+      const bool dirty = parent_dirty || local_changed;
+      global_dirty_[i] = static_cast<uint8_t>(dirty);
+      if (!dirty) continue;
+      if (snapshots_enabled_) {
+        snapshot_stale_[0][i] = 1;
+        snapshot_stale_[1][i] = 1;
+      }
+
+      // TODO: Return an AffineTransform from the MatrixMotivator.
+      const mathfu::mat4& local_transform =
+          !enabled ? masked_locals_[i]
+                   : blending ? blend_locals_[i] : motivators_[i].Value();
+      if (parent_idx == kInvalidBoneIdx) {
+        global_transforms_[i] =
+            mathfu::mat4::ToAffineTransform(local_transform);
+      } else {
+        global_transforms_[i] = mathfu::mat4::ToAffineTransform(
+            mathfu::mat4::FromAffineTransform(global_transforms_[parent_idx]) *
+            local_transform);
+      }
+      if (dual_quats_enabled_) UpdateDualQuaternion(i);
+    }
+    mask_pose_dirty_ = false;
   }
 
   const mathfu::AffineTransform* GlobalTransforms() const {
+    if (snapshots_enabled_) {
+      const int front = snapshot_front_.load(std::memory_order_acquire);
+      return snapshot_transforms_[front].data();
+    }
     return global_transforms_.data();
   }
 
+  /// Turn the dual-quaternion palette on or off. On enable, the palette is
+  /// converted from the current pose immediately, so reads are valid before
+  /// the next update.
+  void SetDualQuaternionPalette(bool enable) {
+    dual_quats_enabled_ = enable;
+    if (!enable) {
+      dual_quaternions_.clear();
+      return;
+    }
+    const int num_bones = NumBones();
+    dual_quaternions_.resize(num_bones);
+    for (int i = 0; i < num_bones; ++i) {
+      UpdateDualQuaternion(i);
+    }
+  }
+
+  const DualQuaternion* DualQuaternions() const {
+    return dual_quats_enabled_ ? dual_quaternions_.data() : nullptr;
+  }
+
+  /// Turn double-buffered palette snapshots on or off. See
+  /// MotiveEngine::SetFrameSnapshots().
+  void SetFrameSnapshots(bool enable) {
+    if (enable == snapshots_enabled_) return;
+    snapshots_enabled_ = enable;
+    if (!enable) {
+      for (int b = 0; b < 2; ++b) {
+        snapshot_transforms_[b].clear();
+        snapshot_stale_[b].clear();
+      }
+      return;
+    }
+
+    // Seed both buffers with the current pose, so that reads are sensible
+    // before the first publish.
+    snapshot_front_.store(0, std::memory_order_relaxed);
+    for (int b = 0; b < 2; ++b) {
+      snapshot_transforms_[b] = global_transforms_;
+      snapshot_stale_[b].assign(NumBones(), 0);
+    }
+  }
+
+  /// Copy this frame's recomputed bones into the back buffer, then flip.
+  /// A bone is stale in a buffer if its global transform changed since that
+  /// buffer was last published, so settled bones cost nothing here.
+  void PublishSnapshot() {
+    if (!snapshots_enabled_) return;
+    const int back = 1 - snapshot_front_.load(std::memory_order_relaxed);
+    std::vector<uint8_t>& stale = snapshot_stale_[back];
+    const int num_bones = NumBones();
+    for (int i = 0; i < num_bones; ++i) {
+      if (stale[i] == 0) continue;
+      stale[i] = 0;
+      snapshot_transforms_[back][i] = global_transforms_[i];
+    }
+    snapshot_front_.store(back, std::memory_order_release);
+  }
+
   BoneIndex NumBones() const { return defining_anim_->NumBones(); }
 
   MotiveTime end_time() const { return end_time_; }
 
+  /// Heap bytes owned by this rig: the object itself, the per-bone arrays,
+  /// the blend scratch, and the blend layers' matrix op data. The op
+  /// motivators' spline and matrix state lives in their processors and is
+  /// counted there.
+  size_t AllocatedBytes() const {
+    size_t bytes =
+        sizeof(*this) + motivators_.capacity() * sizeof(MatrixMotivator4f) +
+        global_transforms_.capacity() * sizeof(mathfu::AffineTransform) +
+        global_dirty_.capacity() * sizeof(uint8_t) +
+        bone_enabled_.capacity() * sizeof(uint8_t) +
+        masked_locals_.capacity() * sizeof(mathfu::mat4) +
+        dual_quaternions_.capacity() * sizeof(DualQuaternion) +
+        blend_layers_.capacity() * sizeof(BlendLayer) +
+        (blend_values_.capacity() + blend_mixed_.capacity() +
+         blend_prev_.capacity()) *
+            sizeof(float) +
+        blend_locals_.capacity() * sizeof(mathfu::mat4) +
+        blend_bone_dirty_.capacity() * sizeof(uint8_t) +
+        clip_locals_.capacity() * sizeof(mathfu::mat4);
+    for (int b = 0; b < 2; ++b) {
+      bytes +=
+          snapshot_transforms_[b].capacity() * sizeof(mathfu::AffineTransform) +
+          snapshot_stale_[b].capacity() * sizeof(uint8_t);
+    }
+    for (size_t k = 0; k < blend_layers_.size(); ++k) {
+      const BlendLayer& layer = blend_layers_[k];
+      bytes += layer.bone_data.capacity() * sizeof(MatrixData*);
+      for (size_t i = 0; i < layer.bone_data.size(); ++i) {
+        if (layer.bone_data[i] != nullptr) {
+          bytes += layer.bone_data[i]->AllocatedBytes();
+        }
+      }
+    }
+    return bytes;
+  }
+
   const RigAnim* defining_anim() const { return defining_anim_; }
 
   void ChildValuesForDebugging(std::vector<float>* values) const {
@@ -125,6 +528,15 @@ class RigData {
     int k = 0;
     const int defining_num_bones = NumBones();
     for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+      if (!BoneEnabled(i)) {
+        // Masked-out bones hold the defining anim's constant op values.
+        int num_ops = 0;
+        const MatrixOperationInit* ops = defining_anim_->BoneOps(i, &num_ops);
+        for (int j = 0; j < num_ops; ++j) {
+          (*values)[k++] = OpConstValue(ops[j]);
+        }
+        continue;
+      }
       const MotiveChildIndex num_children = motivators_[i].NumChildren();
       for (MotiveChildIndex j = 0; j < num_children; ++j) {
         (*values)[k++] = motivators_[i].ChildValue1f(j);
@@ -185,13 +597,19 @@ class RigData {
       const char* bone_name = defining_anim_->BoneName(idx);
       oss << bone_name << std::endl;
 
-      // Output the bone's matrix.
-      const mathfu::mat4& m = motivators_[idx].Value();
+      // Output the bone's matrix. Masked-out bones have no motivators and
+      // hold their constant pose; see SetBoneMask().
+      const mathfu::mat4& m =
+          BoneEnabled(idx) ? motivators_[idx].Value() : masked_locals_[idx];
       for (int row = 0; row < 3; ++row) {
         oss << "  (" << std::setw(7) << m(row, 0) << std::setw(7) << m(row, 1)
             << std::setw(7) << m(row, 2) << std::setw(7) << m(row, 3) << ')'
             << std::endl;
       }
+      if (!BoneEnabled(idx)) {
+        oss << "  (masked)" << std::endl << std::endl;
+        continue;
+      }
 
       // Output the operations on this bone.
       const std::vector<MatrixOperationInit>& ops =
@@ -215,38 +633,380 @@ class RigData {
   }
 
  private:
-  /// Traverse hierarchy, converting local transforms from `motivators_` into
-  /// global transforms. The `parents` are layed out such that the parent
-  /// always come before the child.
-  // TODO OPT: optimize `parents` layout so that we can parallelize this call.
-  void CalculateGlobalTransforms(mathfu::AffineTransform* out) const {
+  bool BoneEnabled(BoneIndex i) const {
+    return bone_enabled_.empty() || bone_enabled_[i] != 0;
+  }
+
+  /// The constant value the defining anim assigns `op` when it isn't
+  /// animated: its constant where it has one, the op's default otherwise.
+  static float OpConstValue(const MatrixOperationInit& op) {
+    return op.union_type == MatrixOperationInit::kUnionInitialValue
+               ? op.initial_value
+               : OperationDefaultValue(op.type);
+  }
+
+  /// Compose the constant local transform the defining anim gives `bone`.
+  /// Masked-out bones hold this pose.
+  void ComposeDefiningLocal(BoneIndex bone, mathfu::mat4* out) const {
+    int num_ops = 0;
+    const MatrixOperationInit* ops = defining_anim_->BoneOps(bone, &num_ops);
+    mathfu::vec4 c0 = mathfu::kAxisX4f;
+    mathfu::vec4 c1 = mathfu::kAxisY4f;
+    mathfu::vec4 c2 = mathfu::kAxisZ4f;
+    mathfu::vec4 c3 = mathfu::kAxisW4f;
+    for (int j = 0; j < num_ops; ++j) {
+      if (ops[j].type == kQuaternionW) {
+        assert(j + 3 < num_ops);
+        MatrixOperation::ApplyQuaternionValues(
+            OpConstValue(ops[j]), OpConstValue(ops[j + 1]),
+            OpConstValue(ops[j + 2]), OpConstValue(ops[j + 3]), &c0, &c1, &c2,
+            &c3);
+        j += 3;
+        continue;
+      }
+      MatrixOperation::ApplyOpValue(ops[j].type, OpConstValue(ops[j]), &c0,
+                                    &c1, &c2, &c3);
+    }
+    *out = mathfu::mat4(c0, c1, c2, c3);
+  }
+
+  /// Convert bone `i`'s global transform into `dual_quaternions_[i]`.
+  /// Called right after the matrix is composed, while it is hot in cache,
+  /// so enabling the palette adds no extra pass over the bones. Any scale
+  /// in the matrix is dropped; dual quaternions carry rigid transforms
+  /// only.
+  void UpdateDualQuaternion(int i) {
+    const mathfu::mat4 m =
+        mathfu::mat4::FromAffineTransform(global_transforms_[i]);
+    const mathfu::Matrix<float, 3> rotation(m(0, 0), m(1, 0), m(2, 0),
+                                            m(0, 1), m(1, 1), m(2, 1),
+                                            m(0, 2), m(1, 2), m(2, 2));
+    mathfu::Quaternion<float> q =
+        mathfu::Quaternion<float>::FromMatrix(rotation);
+    q.Normalize();
+    const mathfu::vec3 v = q.vector();
+    const float w = q.scalar();
+    const mathfu::vec3 t = m.TranslationVector3D();
+
+    DualQuaternion& out = dual_quaternions_[i];
+    out.real[0] = v.x;
+    out.real[1] = v.y;
+    out.real[2] = v.z;
+    out.real[3] = w;
+
+    // dual = 0.5 * (t.x, t.y, t.z, 0) * real, with quaternion
+    // multiplication written out.
+    out.dual[0] = 0.5f * (t.x * w + t.y * v.z - t.z * v.y);
+    out.dual[1] = 0.5f * (-t.x * v.z + t.y * w + t.z * v.x);
+    out.dual[2] = 0.5f * (t.x * v.y - t.y * v.x + t.z * w);
+    out.dual[3] = -0.5f * (t.x * v.x + t.y * v.y + t.z * v.z);
+  }
+
+  /// Lerp this frame's pose from the baked clip and compose the globals in
+  /// one forward pass. The lerp changes every channel continuously, so every
+  /// bone is recomposed each frame; dirty tracking would never skip work
+  /// here, and the flat math is cheap enough not to miss it.
+  void UpdateGlobalTransformsFromClip(MotiveTime time) {
+    baked_clip_->EvalLocalTransforms(time - clip_start_time_,
+                                     clip_locals_.data());
+
     const BoneIndex* parents = defining_anim_->bone_parents();
     const int num_bones = NumBones();
     for (int i = 0; i < num_bones; ++i) {
-      // TODO: Return an AffineTransform from the MatrixMotivator.
-      const mathfu::mat4& local_transform = motivators_[i].Value();
+      global_dirty_[i] = 1;
+      if (snapshots_enabled_) {
+        snapshot_stale_[0][i] = 1;
+        snapshot_stale_[1][i] = 1;
+      }
       const int parent_idx = parents[i];
       if (parent_idx == kInvalidBoneIdx) {
-        out[i] = mathfu::mat4::ToAffineTransform(local_transform);
+        global_transforms_[i] =
+            mathfu::mat4::ToAffineTransform(clip_locals_[i]);
       } else {
-        assert(i > parent_idx);
-        out[i] = mathfu::mat4::ToAffineTransform(
-            mathfu::mat4::FromAffineTransform(out[parent_idx]) *
-            local_transform);
+        global_transforms_[i] = mathfu::mat4::ToAffineTransform(
+            mathfu::mat4::FromAffineTransform(global_transforms_[parent_idx]) *
+            clip_locals_[i]);
+      }
+      if (dual_quats_enabled_) UpdateDualQuaternion(i);
+    }
+
+    if (end_time_ != kMotiveTimeEndless) {
+      clip_time_remaining_ = std::max<MotiveTime>(end_time_ - time, 0);
+    }
+  }
+
+  /// Gather every layer's operation values, mix them with normalized
+  /// weighted sums, and compose the mixed values into per-bone local
+  /// transforms. Bones whose mixed values are unchanged since the last call
+  /// are not recomposed, and are marked clean for UpdateGlobalTransforms().
+  void UpdateBlendedLocals() {
+    const int num_bones = NumBones();
+    const int num_layers = static_cast<int>(blend_layers_.size());
+    const int num_values = defining_anim_->NumOps();
+
+    // Normalize the weights. If all weights are zero, hold the last pose.
+    float total_weight = 0.0f;
+    for (int k = 0; k < num_layers; ++k) {
+      total_weight += blend_layers_[k].weight;
+    }
+    if (total_weight <= 0.0f) {
+      std::fill(blend_bone_dirty_.begin(), blend_bone_dirty_.end(),
+                static_cast<uint8_t>(false));
+      return;
+    }
+    const float weight_scale = 1.0f / total_weight;
+
+    // Gather each layer's op values into a flat array, in defining-anim
+    // order. Ops the layer's anim doesn't animate contribute their default
+    // value. The layer's ops are an ordered subset of the defining anim's,
+    // matched by op id, as in MatrixData::BlendToOps().
+    blend_values_.resize(num_layers * num_values);
+    for (int k = 0; k < num_layers; ++k) {
+      float* out = blend_values_.data() + k * num_values;
+      int v = 0;
+      for (BoneIndex i = 0; i < num_bones; ++i) {
+        int num_defining_ops = 0;
+        const MatrixOperationInit* defining_ops =
+            defining_anim_->BoneOps(i, &num_defining_ops);
+
+        // Masked-out bones have no layer data; their slots are filled with
+        // the constant values so the flat indexing stays aligned, and the
+        // compose pass below skips them.
+        if (blend_layers_[k].bone_data[i] == nullptr) {
+          for (int j = 0; j < num_defining_ops; ++j) {
+            out[v++] = OpConstValue(defining_ops[j]);
+          }
+          continue;
+        }
+        const MatrixData& data = *blend_layers_[k].bone_data[i];
+        int op_idx = 0;
+        for (int j = 0; j < num_defining_ops; ++j) {
+          if (op_idx < data.num_ops() &&
+              data.Op(op_idx).Blendable(defining_ops[j])) {
+            out[v++] = data.Op(op_idx).Value();
+            op_idx++;
+          } else {
+            out[v++] = OperationDefaultValue(defining_ops[j].type);
+          }
+        }
+        assert(op_idx == data.num_ops());
+      }
+      assert(v == num_values);
+      (void)v;
+    }
+
+    // Mix the layers into `blend_mixed_` with weighted sums. One flat pass
+    // per layer over contiguous arrays, so the vector units stay busy.
+    blend_mixed_.assign(num_values, 0.0f);
+    for (int k = 0; k < num_layers; ++k) {
+      const float w = blend_layers_[k].weight * weight_scale;
+      const float* values = blend_values_.data() + k * num_values;
+      float* mixed = blend_mixed_.data();
+      int v = 0;
+#if defined(MOTIVE_NEON_INTRINSICS)
+      const float32x4_t w4 = vdupq_n_f32(w);
+      for (; v + 4 <= num_values; v += 4) {
+        vst1q_f32(mixed + v,
+                  vmlaq_f32(vld1q_f32(mixed + v), w4, vld1q_f32(values + v)));
+      }
+#endif  // defined(MOTIVE_NEON_INTRINSICS)
+      for (; v < num_values; ++v) {
+        mixed[v] += w * values[v];
+      }
+    }
+
+    // Compose local transforms for bones whose mixed values changed.
+    // On the first frame of a blend, `blend_prev_` is empty and every bone
+    // is composed.
+    const bool force_all = blend_prev_.size() != blend_mixed_.size();
+    int v = 0;
+    for (BoneIndex i = 0; i < num_bones; ++i) {
+      int num_ops = 0;
+      const MatrixOperationInit* defining_ops =
+          defining_anim_->BoneOps(i, &num_ops);
+
+      // Masked-out bones keep their constant pose; see SetBoneMask().
+      if (!BoneEnabled(i)) {
+        blend_bone_dirty_[i] = 0;
+        v += num_ops;
+        continue;
+      }
+
+      bool changed = force_all;
+      for (int j = 0; !changed && j < num_ops; ++j) {
+        changed = blend_mixed_[v + j] != blend_prev_[v + j];
+      }
+      blend_bone_dirty_[i] = static_cast<uint8_t>(changed);
+      if (changed) {
+        mathfu::vec4 c0 = mathfu::kAxisX4f;
+        mathfu::vec4 c1 = mathfu::kAxisY4f;
+        mathfu::vec4 c2 = mathfu::kAxisZ4f;
+        mathfu::vec4 c3 = mathfu::kAxisW4f;
+        for (int j = 0; j < num_ops; ++j) {
+          // Quaternion components are mixed per-component above, which is
+          // nlerp before normalization; ApplyQuaternionValues() normalizes
+          // as it consumes the (w, x, y, z) run.
+          if (defining_ops[j].type == kQuaternionW) {
+            assert(j + 3 < num_ops);
+            MatrixOperation::ApplyQuaternionValues(
+                blend_mixed_[v + j], blend_mixed_[v + j + 1],
+                blend_mixed_[v + j + 2], blend_mixed_[v + j + 3], &c0, &c1,
+                &c2, &c3);
+            j += 3;
+            continue;
+          }
+          MatrixOperation::ApplyOpValue(defining_ops[j].type,
+                                        blend_mixed_[v + j], &c0, &c1, &c2,
+                                        &c3);
+        }
+        blend_locals_[i] = mathfu::mat4(c0, c1, c2, c3);
+      }
+      v += num_ops;
+    }
+    blend_prev_ = blend_mixed_;
+  }
+
+  /// Carry the current blended pose into the per-bone motivators, so that a
+  /// subsequent single-anim blend starts from the pose on screen rather than
+  /// from wherever the motivators left off.
+  void SnapMotivatorsToBlendedPose() {
+    if (blend_mixed_.empty()) return;
+    int v = 0;
+    const int defining_num_bones = NumBones();
+    for (BoneIndex i = 0; i < defining_num_bones; ++i) {
+      int num_defining_ops = 0;
+      defining_anim_->BoneOps(i, &num_defining_ops);
+      if (!BoneEnabled(i)) {
+        v += num_defining_ops;
+        continue;
+      }
+      for (int j = 0; j < num_defining_ops; ++j, ++v) {
+        const MotiveChildIndex child = static_cast<MotiveChildIndex>(j);
+        if (motivators_[i].ChildMotivator1f(child) != nullptr) {
+          motivators_[i].SetChildTarget1f(child, Current1f(blend_mixed_[v]));
+        } else {
+          motivators_[i].SetChildValue1f(child, blend_mixed_[v]);
+        }
       }
     }
   }
 
+  void ClearBlendLayers() {
+    const int num_layers = static_cast<int>(blend_layers_.size());
+    for (int k = 0; k < num_layers; ++k) {
+      std::vector<MatrixData*>& bone_data = blend_layers_[k].bone_data;
+      for (size_t i = 0; i < bone_data.size(); ++i) {
+        if (bone_data[i] != nullptr) MatrixData::Destroy(bone_data[i]);
+      }
+    }
+    blend_layers_.clear();
+    blend_values_.clear();
+    blend_mixed_.clear();
+    blend_prev_.clear();
+  }
+
+  /// One layer of an N-way blend: the weight and the per-bone matrix op
+  /// data playing that layer's anim. The op motivators inside `bone_data`
+  /// register with the engine as usual, so their splines are evaluated in
+  /// bulk alongside everything else.
+  struct BlendLayer {
+    BlendLayer() : weight(0.0f) {}
+    float weight;
+    std::vector<MatrixData*> bone_data;  // Indexed by defining-anim bone.
+  };
+
   std::vector<MatrixMotivator4f, mathfu::simd_allocator<MatrixMotivator4f>>
       motivators_;
   std::vector<mathfu::AffineTransform,
               mathfu::simd_allocator<mathfu::AffineTransform>>
       global_transforms_;
+
+  /// One entry per bone: non-zero if the bone's global transform was
+  /// recomputed by the last UpdateGlobalTransforms(). Children of dirty
+  /// bones must also be recomputed, so this doubles as the propagation
+  /// state of the pass.
+  std::vector<uint8_t> global_dirty_;
+
+  /// One entry per bone: zero if the bone is masked out by SetBoneMask().
+  /// Empty when every bone is enabled, which is the common case and keeps
+  /// the per-bone test cheap.
+  std::vector<uint8_t> bone_enabled_;
+
+  /// Constant local transforms for masked-out bones, composed from the
+  /// defining anim's op values. Sized NumBones() only while a mask is
+  /// active; entries for enabled bones are unused.
+  std::vector<mathfu::mat4, mathfu::simd_allocator<mathfu::mat4>>
+      masked_locals_;
+
+  /// True when SetBoneMask() changed which bones are masked; forces the
+  /// next UpdateGlobalTransforms() to recompose the affected bones.
+  bool mask_pose_dirty_;
+
+  /// Layers of the active N-way blend. Empty when a single anim is playing.
+  std::vector<BlendLayer> blend_layers_;
+
+  /// Blend scratch, all indexed by flattened defining-anim op: each layer's
+  /// gathered op values (layer-major), the mixed values, and the previous
+  /// frame's mixed values for change detection.
+  std::vector<float> blend_values_;
+  std::vector<float> blend_mixed_;
+  std::vector<float> blend_prev_;
+
+  /// Local transforms composed from the mixed op values, one per bone, and
+  /// a flag per bone marking which of them changed this frame.
+  std::vector<mathfu::mat4, mathfu::simd_allocator<mathfu::mat4>>
+      blend_locals_;
+  std::vector<uint8_t> blend_bone_dirty_;
+
+  /// Update-rate tier assigned to the whole rig. See
+  /// MotiveProcessor::SetUpdateTier().
+  int update_tier_;
+
+  /// True if the engine keeps frame snapshots. See
+  /// MotiveEngine::SetFrameSnapshots().
+  bool snapshots_enabled_;
+
+  /// True if a dual-quaternion palette is kept alongside the global
+  /// transforms. See RigMotivator::SetDualQuaternionPalette().
+  bool dual_quats_enabled_;
+
+  /// One dual quaternion per bone, converted from `global_transforms_` as
+  /// each dirty bone is composed. Empty unless `dual_quats_enabled_`.
+  std::vector<DualQuaternion> dual_quaternions_;
+
+  /// Double-buffered copies of `global_transforms_`. Readers follow
+  /// `snapshot_front_`; PublishSnapshot() writes the other buffer and then
+  /// flips.
+  std::vector<mathfu::AffineTransform,
+              mathfu::simd_allocator<mathfu::AffineTransform>>
+      snapshot_transforms_[2];
+  std::vector<uint8_t> snapshot_stale_[2];
+  std::atomic<int> snapshot_front_;
   const RigAnim* defining_anim_;
   const RigAnim* current_anim_;
 
+  /// Active baked clip, or null when playing spline anims. Owned by the
+  /// caller of PlayBakedClip(), typically alongside the source anims.
+  const BakedClip* baked_clip_;
+
+  /// Processor time at which PlayBakedClip() was called; clip time is
+  /// measured from here.
+  MotiveTime clip_start_time_;
+
+  /// Time until a one-shot clip reaches its last frame. Unused when the
+  /// clip repeats (end_time_ is endless then).
+  MotiveTime clip_time_remaining_;
+
+  /// Local transforms lerped from the baked clip, one per bone. Scratch for
+  /// UpdateGlobalTransformsFromClip().
+  std::vector<mathfu::mat4, mathfu::simd_allocator<mathfu::mat4>>
+      clip_locals_;
+
   /// Time that the animation is expected to complete.
   MotiveTime end_time_;
+
+  /// Engine that the blend layers' op motivators are registered with.
+  MotiveEngine* engine_;
 };
 
 }  // namespace motive
@@ -26,35 +26,114 @@
 
 namespace motive {
 
+// Number of indices each worker advances when AdvanceFrame is split across
+// a job system. Each index is a whole skeleton, so the slices are small.
+static const MotiveIndex kParallelSliceSize = 16;
+
 // See comments on RigInit for details on this class.
 class MotiveRigProcessor : public RigProcessor {
  public:
-  MotiveRigProcessor() : time_(0) {}
+  MotiveRigProcessor() : time_(0), frame_snapshots_(false) {}
 
   virtual ~MotiveRigProcessor() {
     RemoveIndices(0, NumIndices());
   }
 
   void AdvanceFrame(MotiveTime delta_time) override {
-    Defragment();
+    BeginAdvanceFrame(delta_time);
+    AdvanceFrameRange(delta_time, 0, NumIndices());
+  }
 
-    // Process the series of matrix operations for each index.
-    const MotiveIndex num_indices = NumIndices();
-    for (MotiveIndex index = 0; index < num_indices; ++index) {
-      RigData& d = Data(index);
-      d.UpdateGlobalTransforms();
-    }
+  void BeginAdvanceFrame(MotiveTime delta_time) override {
+    // Index moves would change where concurrent snapshot readers look, so
+    // compaction is suspended while frame snapshots are on. Freed indices
+    // are still recycled in place by the allocator.
+    if (!frame_snapshots_) Defragment();
 
     // Update our global time. It shouldn't matter if this wraps
     // around, since we only calculate times relative to it.
     time_ += delta_time;
   }
 
+  MotiveIndex ParallelSliceSize() const override { return kParallelSliceSize; }
+
+  void AdvanceFrameRange(MotiveTime /*delta_time*/, MotiveIndex start_index,
+                         MotiveIndex end_index) override {
+    // Compose the global transforms for each rig in the range.
+    for (MotiveIndex index = start_index; index < end_index; ++index) {
+      RigData* const d = data_[index];
+
+      // Skip holes left while compaction is suspended or budgeted.
+      if (d == nullptr) continue;
+      d->UpdateGlobalTransforms(time_);
+    }
+  }
+
+  void SetUpdateTier(MotiveIndex index, int tier) override {
+    MotiveProcessor::SetUpdateTier(index, tier);
+
+    // Forward the tier down the rig's whole motivator hierarchy, so that the
+    // bone matrices and the splines that drive them skip the same frames.
+    Data(index).SetUpdateTier(tier);
+  }
+
   void BlendToAnim(MotiveIndex index, const RigAnim& anim,
                    const motive::SplinePlayback& playback) override {
     Data(index).BlendToAnim(anim, playback, time_);
   }
 
+  void BlendToAnims(MotiveIndex index, const RigAnim* const* anims,
+                    const float* weights, int num_anims,
+                    const motive::SplinePlayback& playback) override {
+    Data(index).BlendToAnims(anims, weights, num_anims, playback, time_);
+  }
+
+  void SetBoneMask(MotiveIndex index, const uint8_t* enabled,
+                   int num_mask_bones) override {
+    Data(index).SetBoneMask(enabled, num_mask_bones);
+  }
+
+  void SetBlendWeights(MotiveIndex index, const float* weights,
+                       int num_weights) override {
+    Data(index).SetBlendWeights(weights, num_weights);
+  }
+
+  void PlayBakedClip(MotiveIndex index, const BakedClip& clip) override {
+    Data(index).PlayBakedClip(&clip, time_);
+  }
+
+  void RebindAnims(const RigAnim* const* old_anims,
+                   const RigAnim* const* new_anims, int num_anims) override {
+    // The op motivators' splines are rebound separately through the spline
+    // processor; here we fix the anim pointers each rig remembers.
+    const MotiveIndex num_indices = NumIndices();
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      if (data_[i] == nullptr) continue;
+      for (int a = 0; a < num_anims; ++a) {
+        if (old_anims[a] == nullptr || new_anims[a] == nullptr) continue;
+        data_[i]->RebindAnim(*old_anims[a], *new_anims[a]);
+      }
+    }
+  }
+
+  void SetFrameSnapshots(bool enable) override {
+    frame_snapshots_ = enable;
+    const MotiveIndex num_indices = NumIndices();
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      if (data_[i] == nullptr) continue;
+      data_[i]->SetFrameSnapshots(enable);
+    }
+  }
+
+  void PublishFrameSnapshot() override {
+    if (!frame_snapshots_) return;
+    const MotiveIndex num_indices = NumIndices();
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      if (data_[i] == nullptr) continue;
+      data_[i]->PublishSnapshot();
+    }
+  }
+
   void SetPlaybackRate(MotiveIndex index, float playback_rate) override {
     Data(index).SetPlaybackRate(playback_rate);
   }
@@ -67,6 +146,14 @@ class MotiveRigProcessor : public RigProcessor {
     return Data(index).GlobalTransforms();
   }
 
+  void SetDualQuaternionPalette(MotiveIndex index, bool enable) override {
+    Data(index).SetDualQuaternionPalette(enable);
+  }
+
+  const DualQuaternion* DualQuaternions(MotiveIndex index) const override {
+    return Data(index).DualQuaternions();
+  }
+
   MotiveTime TimeRemaining(MotiveIndex index) const override {
     return Data(index).TimeRemaining();
   }
@@ -104,6 +191,7 @@ class MotiveRigProcessor : public RigProcessor {
     auto rig_init = static_cast<const RigInit&>(init);
     for (MotiveIndex i = index; i < index + dimensions; ++i) {
       data_[i] = new RigData(rig_init, time_, engine);
+      data_[i]->SetFrameSnapshots(frame_snapshots_);
     }
   }
 
@@ -136,6 +224,18 @@ class MotiveRigProcessor : public RigProcessor {
     data_.resize(num_indices, nullptr);
   }
 
+  void AccumulateDataMemoryStats(MotiveMemoryStats* stats) const override {
+    stats->allocated_bytes += data_.capacity() * sizeof(RigData*);
+
+    // Each live rig owns a heap-allocated RigData.
+    for (size_t i = 0; i < data_.size(); ++i) {
+      if (data_[i] == nullptr) continue;
+      const size_t bytes = data_[i]->AllocatedBytes();
+      stats->allocated_bytes += bytes;
+      stats->live_bytes += bytes + sizeof(RigData*);
+    }
+  }
+
   const RigData& Data(MotiveIndex index) const {
     assert(ValidIndex(index));
     return *data_[index];
@@ -146,8 +246,12 @@ class MotiveRigProcessor : public RigProcessor {
     return *data_[index];
   }
 
-  std::vector<RigData*> data_;
+  std::vector<RigData*, BufferAllocator<RigData*>> data_;
   MotiveTime time_;
+
+  /// True if the engine keeps frame snapshots. See
+  /// MotiveEngine::SetFrameSnapshots().
+  bool frame_snapshots_;
 };
 
 MOTIVE_INSTANCE(RigInit, MotiveRigProcessor);
@@ -12,10 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
+#include <cstring>
+
 #include "motive/engine.h"
 #include "motive/spline_init.h"
 #include "motive/math/bulk_spline_evaluator.h"
 #include "motive/processor/spline_data.h"
+#include "motive/util.h"
+#include "motive/util/benchmark.h"
 
 namespace motive {
 
@@ -23,19 +28,236 @@ namespace motive {
 // that go above or below the supplied nodes.
 static const float kYRangeBufferPercent = 1.2f;
 
+// Number of indices each worker advances when AdvanceFrame is split across
+// a job system. Big enough to amortize job overhead; small enough that an
+// 80k-motivator processor still fans out across many workers.
+static const MotiveIndex kParallelSliceSize = 1024;
+static_assert(kParallelSliceSize % MotiveProcessor::kIndicesPerCacheLine == 0,
+              "Workers would false-share cache lines at range boundaries");
+
+// Number of local splines carved from each slab allocation. Big enough that
+// slab allocations are rare; small enough that the last, partially-used slab
+// doesn't waste much memory.
+static const int kSplinesPerSlab = 64;
+
+// Per-index record for engine checkpoints. Fixed-size so that the whole
+// processor state is NumIndices() of these, written and read in bulk.
+// Local splines fit inline: they hold at most kDefaultMaxNodes wide nodes.
+struct SplineCheckpointRecord {
+  float x;         // Current playback position.
+  float rate;      // SplinePlayback::playback_rate.
+  float y_offset;  // SplinePlayback::y_offset.
+  float y_scale;   // SplinePlayback::y_scale.
+  float y;         // Last evaluated y, for indices without a spline.
+  uint32_t flags;  // Combination of the kCheckpoint* flags below.
+  uint16_t num_local_nodes;  // Node count of the inline local spline.
+  uint16_t padding;
+  uint64_t spline_hash;  // ContentHash() of the caller-owned spline.
+  float local_y_start;   // y_range of the inline local spline.
+  float local_y_end;
+  float local_x_granularity;
+  uint8_t local_nodes[CompactSpline::kDefaultMaxNodes *
+                      sizeof(detail::CompactSplineNode)];
+};
+
+// A spline was playing at this index when the checkpoint was saved.
+static const uint32_t kCheckpointValid = 1 << 0;
+// The playing spline repeats.
+static const uint32_t kCheckpointRepeat = 1 << 1;
+// The playing spline was processor-owned, and is stored inline.
+static const uint32_t kCheckpointLocalSpline = 1 << 2;
+
 class SplineMotiveProcessor : public MotiveProcessorNf {
  public:
+  SplineMotiveProcessor()
+      : track_value_deltas_(false),
+        value_delta_epsilon_(0.0f),
+        frame_snapshots_(false),
+        snapshot_front_(0) {}
+
   virtual ~SplineMotiveProcessor() {
-    for (auto it = spline_pool_.begin(); it != spline_pool_.end(); ++it) {
-      delete *(it);
+    // Every local spline--pooled or still assigned to an index--lives inside
+    // one of the slabs, so freeing the slabs reclaims them all. CompactSpline
+    // is trivially destructible; see CompactSpline::CreateInPlace().
+    for (size_t i = 0; i < spline_slabs_.size(); ++i) {
+      MotiveFree(spline_slabs_[i]);
     }
   }
 
   virtual void AdvanceFrame(MotiveTime delta_time) {
-    Defragment();
+    // Index moves would change where concurrent snapshot readers look, so
+    // compaction is suspended while frame snapshots are on.
+    if (!frame_snapshots_) Defragment();
     interpolator_.AdvanceFrame(static_cast<float>(delta_time));
   }
 
+  virtual void BeginAdvanceFrame(MotiveTime /*delta_time*/) {
+    // Shuffle indices on the main thread, before workers are let loose on
+    // AdvanceFrameRange().
+    if (!frame_snapshots_) Defragment();
+  }
+
+  virtual MotiveIndex ParallelSliceSize() const { return kParallelSliceSize; }
+
+  virtual void AdvanceFrameRange(MotiveTime delta_time, MotiveIndex start_index,
+                                 MotiveIndex end_index) {
+    interpolator_.AdvanceFrameRange(static_cast<float>(delta_time), start_index,
+                                    end_index);
+  }
+
+  virtual void SetTrackCompletions(bool enable) {
+    interpolator_.SetTrackCompletions(enable);
+  }
+
+  virtual void SetDeterministic(bool enable) {
+    // The scalar path is the one path every build shares, so pinning to it
+    // makes spline evaluation bit-exact across SSE, NEON, and scalar builds.
+    interpolator_.SetOptimization(enable ? kNoOptimizations
+                                         : BestProcessorOptimization());
+  }
+
+  virtual void CollectCompletions(std::vector<const Motivator*>* completed) {
+    // The interpolator flags indices as they play off the end of their
+    // splines; see BulkSplineEvaluator::Completed(). A motivator is reported
+    // once, on the frame its last dimension finishes.
+    const MotiveIndex num_indices = NumIndices();
+    const Motivator* last = nullptr;
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      if (!interpolator_.Completed(i)) continue;
+
+      // Skip freed indices, and indices belonging to a motivator we've
+      // already reported this frame. A motivator's indices are contiguous,
+      // so comparing against the previous report suffices.
+      const Motivator* motivator = MotivatorForIndex(i);
+      if (motivator == nullptr || motivator == last) continue;
+
+      // Only report when every dimension has finished. Dimensions that
+      // finished on an earlier frame are dormant but no longer flagged.
+      MotiveIndex start = i;
+      while (start > 0 && MotivatorForIndex(start - 1) == motivator) --start;
+      const MotiveIndex end = start + Dimensions(start);
+      bool all_finished = true;
+      for (MotiveIndex j = start; all_finished && j < end; ++j) {
+        all_finished = interpolator_.Dormant(j);
+      }
+      if (!all_finished) continue;
+
+      completed->push_back(motivator);
+      last = motivator;
+    }
+    interpolator_.ClearCompletions();
+  }
+
+  virtual void SetCrossingThresholds(MotiveIndex index,
+                                     MotiveDimension dimensions,
+                                     const float* ys,
+                                     MotiveCrossingDirection direction) {
+    for (MotiveIndex i = 0; i < dimensions; ++i) {
+      interpolator_.SetCrossingThreshold(index + i, ys[i], direction);
+    }
+  }
+
+  virtual void ClearCrossingThresholds(MotiveIndex index,
+                                       MotiveDimension dimensions) {
+    for (MotiveIndex i = 0; i < dimensions; ++i) {
+      interpolator_.ClearCrossingThreshold(index + i);
+    }
+  }
+
+  virtual void SetPlaybackMasters(MotiveIndex index,
+                                  MotiveDimension dimensions,
+                                  MotiveIndex master_index) {
+    for (MotiveIndex i = 0; i < dimensions; ++i) {
+      interpolator_.SetPlaybackMaster(index + i, master_index + i);
+    }
+  }
+
+  virtual void ClearPlaybackMasters(MotiveIndex index,
+                                    MotiveDimension dimensions) {
+    for (MotiveIndex i = 0; i < dimensions; ++i) {
+      interpolator_.ClearPlaybackMaster(index + i);
+    }
+  }
+
+  virtual void CollectCrossings(std::vector<MotiveCrossing>* crossings) {
+    // The interpolator flags crossings per index as it evaluates; see
+    // BulkSplineEvaluator::SetCrossingThreshold(). Translate indices into
+    // (motivator, dimension) pairs for the engine's callback.
+    crossing_scratch_.clear();
+    interpolator_.CollectCrossings(&crossing_scratch_);
+    for (size_t i = 0; i < crossing_scratch_.size(); ++i) {
+      const BulkSplineEvaluator::Crossing& c = crossing_scratch_[i];
+      const Motivator* motivator = MotivatorForIndex(c.index);
+      if (motivator == nullptr) continue;
+
+      // A motivator's indices are contiguous, so the dimension is the
+      // offset from the first index it owns.
+      MotiveIndex start = c.index;
+      while (start > 0 && MotivatorForIndex(start - 1) == motivator) --start;
+
+      MotiveCrossing crossing;
+      crossing.motivator = motivator;
+      crossing.dimension = c.index - start;
+      crossing.direction = c.direction;
+      crossings->push_back(crossing);
+    }
+  }
+
+  virtual void SetTrackValueDeltas(bool enable, float epsilon) {
+    track_value_deltas_ = enable;
+    value_delta_epsilon_ = epsilon;
+    if (!enable) {
+      reported_ys_.clear();
+      return;
+    }
+
+    // Seed every baseline with the current value, so the stream carries
+    // movement from this point on rather than one burst of absolute values.
+    assert(epsilon > 0.0f);
+    const MotiveIndex num_indices = NumIndices();
+    reported_ys_.resize(num_indices);
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      reported_ys_[i] = interpolator_.Y(i);
+    }
+  }
+
+  virtual void CollectValueDeltas(std::vector<MotiveValueDelta>* deltas) {
+    if (!track_value_deltas_) return;
+
+    // One pass over the values the interpolator just wrote, while they are
+    // still in cache. Dormant indices cannot have moved, so they are
+    // skipped without their values being read.
+    const float inv_epsilon = 1.0f / value_delta_epsilon_;
+    const MotiveIndex num_indices = NumIndices();
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      if (interpolator_.Dormant(i)) continue;
+
+      const float moved = interpolator_.Y(i) - reported_ys_[i];
+      const int32_t quantized = static_cast<int32_t>(
+          moved * inv_epsilon + (moved >= 0.0f ? 0.5f : -0.5f));
+      if (quantized == 0) continue;
+
+      const Motivator* motivator = MotivatorForIndex(i);
+      if (motivator == nullptr) continue;
+
+      // Advance the baseline by what was reported, not to the value itself,
+      // so the sub-epsilon remainder carries over and a receiver that
+      // accumulates the deltas never drifts from the true value.
+      reported_ys_[i] += quantized * value_delta_epsilon_;
+
+      // A motivator's indices are contiguous, so the dimension is the
+      // offset from the first index it owns.
+      MotiveIndex start = i;
+      while (start > 0 && MotivatorForIndex(start - 1) == motivator) --start;
+
+      MotiveValueDelta delta;
+      delta.motivator = motivator;
+      delta.dimension = i - start;
+      delta.quantized_delta = quantized;
+      deltas->push_back(delta);
+    }
+  }
+
   virtual MotivatorType Type() const { return SplineInit::kType; }
   virtual int Priority() const { return 0; }
 
@@ -43,14 +265,94 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
   virtual const float* Values(MotiveIndex index) const {
     return interpolator_.Ys(index);
   }
+  virtual void GatherValues(const MotiveIndex* indices, MotiveIndex count,
+                            float* out) const {
+    for (MotiveIndex i = 0; i < count; ++i) {
+      out[i] = interpolator_.Y(indices[i]);
+    }
+  }
+  virtual void GatherTimes(const MotiveIndex* indices, MotiveIndex count,
+                           MotiveTime* spline_times, MotiveTime* end_times,
+                           float* rates) const {
+    for (MotiveIndex i = 0; i < count; ++i) {
+      const MotiveIndex index = indices[i];
+      if (spline_times != nullptr) {
+        spline_times[i] = static_cast<MotiveTime>(interpolator_.X(index));
+      }
+      if (end_times != nullptr) {
+        end_times[i] = static_cast<MotiveTime>(interpolator_.EndX(index));
+      }
+      if (rates != nullptr) rates[i] = interpolator_.PlaybackRate(index);
+    }
+  }
   virtual void Velocities(MotiveIndex index, MotiveDimension dimensions,
                           float* out) const {
     return interpolator_.Derivatives(index, dimensions, out);
   }
+  virtual void ExtrapolatedValues(MotiveIndex index, MotiveDimension dimensions,
+                                  MotiveTime lookahead, float* out) const {
+    if (!frame_snapshots_) {
+      interpolator_.ExtrapolatedYs(index, dimensions,
+                                   static_cast<float>(lookahead), out);
+      return;
+    }
+
+    // Extrapolate from the published snapshot, so a render thread samples
+    // consistent (value, velocity) pairs while the simulation writes the
+    // next frame.
+    const int front = snapshot_front_.load(std::memory_order_acquire);
+    const std::vector<float>& ys = snapshot_ys_[front];
+    const std::vector<float>& derivatives = snapshot_derivatives_[front];
+    const float x = static_cast<float>(lookahead);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      out[i] = ys[index + i] + derivatives[index + i] * x;
+    }
+  }
+  virtual void SetFrameSnapshots(bool enable) {
+    if (enable == frame_snapshots_) return;
+    frame_snapshots_ = enable;
+    if (!enable) {
+      for (int b = 0; b < 2; ++b) {
+        snapshot_ys_[b].clear();
+        snapshot_derivatives_[b].clear();
+      }
+      return;
+    }
+
+    // Seed both buffers with the current values, so that reads are sensible
+    // before the first publish.
+    snapshot_front_.store(0, std::memory_order_relaxed);
+    for (int b = 0; b < 2; ++b) {
+      CopySnapshot(&snapshot_ys_[b], &snapshot_derivatives_[b]);
+    }
+  }
+  virtual void PublishFrameSnapshot() {
+    if (!frame_snapshots_) return;
+
+    // Copy this frame's values and velocities into the back buffer, then
+    // flip. Unlike the matrix processor there is no per-index staleness to
+    // exploit--the evaluator rewrites `ys_` wholesale--but the copy is two
+    // floats per index.
+    const int back = 1 - snapshot_front_.load(std::memory_order_relaxed);
+    CopySnapshot(&snapshot_ys_[back], &snapshot_derivatives_[back]);
+    snapshot_front_.store(back, std::memory_order_release);
+  }
   virtual void Directions(MotiveIndex index, MotiveDimension dimensions,
                           float* out) const {
     return interpolator_.DerivativesWithoutPlayback(index, dimensions, out);
   }
+  virtual void FutureValues(MotiveIndex index, MotiveDimension dimensions,
+                            MotiveTime lookahead, float* future_values,
+                            float* future_velocities) const {
+    // Every dimension shares the lookahead; the evaluator wants one per
+    // index.
+    const float x = static_cast<float>(lookahead);
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      interpolator_.FutureYs(
+          index + i, 1, &x, future_values + i,
+          future_velocities != nullptr ? future_velocities + i : nullptr);
+    }
+  }
   virtual void TargetValues(MotiveIndex index, MotiveDimension dimensions,
                             float* out) const {
     return interpolator_.EndYs(index, dimensions, out);
@@ -80,11 +382,57 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
 
   virtual void SetTargets(MotiveIndex index, MotiveDimension dimensions,
                           const MotiveTarget1f* ts) {
+    AddMotiveEvents(kMotiveEventSetTargets, 1);
     for (MotiveDimension i = 0; i < dimensions; ++i) {
       SetTarget(index + i, ts[i]);
     }
   }
 
+  virtual void SetSharedTargets(const MotiveIndex* indices, int num_motivators,
+                                MotiveDimension dimensions,
+                                const MotiveTarget1f* ts) {
+    AddMotiveEvents(kMotiveEventSetTargets,
+                    static_cast<uint64_t>(num_motivators));
+    for (MotiveDimension d = 0; d < dimensions; ++d) {
+      const MotiveTarget1f& t = ts[d];
+
+      // The spline compiled from `t` is identical for every index only when
+      // the start state comes from the target itself--that is, when the
+      // first way point is at time 0--rather than snapping to each index's
+      // current value and velocity. Modular indices are also excluded,
+      // since their y-values are normalized per index.
+      const bool shareable = t.Node(0).time == 0;
+
+      const CompactSpline* compiled = nullptr;
+      for (int m = 0; m < num_motivators; ++m) {
+        const MotiveIndex index = indices[m] + d;
+        if (!shareable || interpolator_.ModularArithmetic(index)) {
+          SetTarget(index, t);
+          continue;
+        }
+
+        // Compile the way points once, for the first shareable index.
+        if (compiled == nullptr) {
+          SetTarget(index, t);
+          compiled = Data(index).local_spline;
+          continue;
+        }
+
+        // Reuse the compiled spline for the remaining indices: copying the
+        // quantized nodes is far cheaper than re-running the per-way-point
+        // range math and quantization. Slabs never move, so `compiled`
+        // stays valid even if AllocateSpline() grows the pool.
+        SplineData& data = Data(index);
+        if (data.local_spline == nullptr) {
+          data.local_spline = AllocateSpline();
+        }
+        *data.local_spline = *compiled;
+        interpolator_.SetSplines(index, 1, data.local_spline,
+                                 SplinePlayback());
+      }
+    }
+  }
+
   virtual void SetSplines(MotiveIndex index, MotiveDimension dimensions,
                           const CompactSpline* splines,
                           const SplinePlayback& playback) {
@@ -195,6 +543,14 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
                                  MotiveEngine* /*engine*/) {
     auto spline_init = static_cast<const SplineInit&>(init);
     interpolator_.SetYRanges(index, dimensions, spline_init.range());
+
+    // Fresh indices report movement only; the spawn path carries the
+    // starting value. See MotiveEngine::SetValueDeltaCallback().
+    if (track_value_deltas_) {
+      for (MotiveDimension i = 0; i < dimensions; ++i) {
+        reported_ys_[index + i] = interpolator_.Y(index + i);
+      }
+    }
   }
 
   virtual void RemoveIndices(MotiveIndex index, MotiveDimension dimensions) {
@@ -215,13 +571,205 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
     MotiveIndex new_i = new_index;
     for (MotiveDimension i = 0; i < dimensions; ++i, ++new_i, ++old_i) {
       data_[new_i] = data_[old_i];
+      if (track_value_deltas_) reported_ys_[new_i] = reported_ys_[old_i];
     }
     interpolator_.MoveIndices(old_index, new_index, dimensions);
   }
 
+  virtual bool SupportsMigration() const { return true; }
+
+  virtual void CopyIndices(MotiveIndex index, MotiveDimension dimensions,
+                           const MotiveProcessor& source,
+                           MotiveIndex source_index) {
+    const SplineMotiveProcessor& src =
+        static_cast<const SplineMotiveProcessor&>(source);
+    interpolator_.CopyIndices(index, dimensions, src.interpolator_,
+                              source_index);
+
+    for (MotiveDimension i = 0; i < dimensions; ++i) {
+      // Migrated indices start a fresh delta baseline in this engine.
+      if (track_value_deltas_) {
+        reported_ys_[index + i] = interpolator_.Y(index + i);
+      }
+
+      const SplineData& src_d = src.data_[source_index + i];
+      SplineData& d = data_[index + i];
+      if (src_d.local_spline == nullptr) {
+        d.local_spline = nullptr;
+        continue;
+      }
+
+      // The source owns its spline, and recycles it into its own pool when
+      // the old indices are removed. Deep-copy it into our pool and point
+      // the interpolator at the copy.
+      d.local_spline = AllocateSpline();
+      *d.local_spline = *src_d.local_spline;
+      interpolator_.RepointSpline(index + i, d.local_spline);
+    }
+  }
+
+  virtual bool SupportsCheckpoint() const { return true; }
+
+  virtual void SaveCheckpointState(std::vector<uint8_t>* out) const {
+    const MotiveIndex num_indices = NumIndices();
+    const size_t start = out->size();
+    out->resize(start + num_indices * sizeof(SplineCheckpointRecord));
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      // The engine's checkpoint blob gives records no alignment guarantee,
+      // so build each one in an aligned local and memcpy it into place.
+      SplineCheckpointRecord r;
+      memset(&r, 0, sizeof(r));
+      r.y = interpolator_.Y(i);
+      if (interpolator_.Valid(i)) {
+        r.flags = kCheckpointValid;
+        if (interpolator_.Repeat(i)) r.flags |= kCheckpointRepeat;
+        r.x = interpolator_.X(i);
+        r.rate = interpolator_.PlaybackRate(i);
+        r.y_offset = interpolator_.YOffset(i);
+        r.y_scale = interpolator_.YScale(i);
+
+        const CompactSpline* local = data_[i].local_spline;
+        if (local != nullptr) {
+          // Processor-owned splines exist nowhere else, so save them inline.
+          r.flags |= kCheckpointLocalSpline;
+          r.num_local_nodes = local->num_nodes();
+          r.local_y_start = local->y_range().start();
+          r.local_y_end = local->y_range().end();
+          r.local_x_granularity = local->x_granularity();
+          memcpy(r.local_nodes, local->node_data(), local->node_data_size());
+        } else {
+          // Caller-owned splines are recorded by content hash, and re-bound
+          // through the resolver on restore.
+          r.spline_hash = interpolator_.SourceSpline(i)->ContentHash();
+        }
+      }
+      memcpy(out->data() + start + i * sizeof(r), &r, sizeof(r));
+    }
+  }
+
+  virtual bool RestoreCheckpointState(const uint8_t* bytes, size_t num_bytes,
+                                      MotiveSplineResolverFn* resolver,
+                                      void* userdata) {
+    const MotiveIndex num_indices = NumIndices();
+    if (num_bytes != num_indices * sizeof(SplineCheckpointRecord))
+      return false;
+
+    bool success = true;
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      // `bytes` has no alignment guarantee; memcpy to an aligned local.
+      SplineCheckpointRecord r;
+      memcpy(&r, bytes + i * sizeof(r), sizeof(r));
+      if ((r.flags & kCheckpointValid) == 0 ||
+          r.num_local_nodes > CompactSpline::kDefaultMaxNodes) {
+        RestoreWithoutSpline(i, r.y);
+        continue;
+      }
+
+      // Re-binding the spline and seeking to the checkpointed x rebuilds
+      // the evaluator's cubic state; a blend_x of 0 jumps rather than
+      // blends, so no transition curve is synthesized.
+      const SplinePlayback playback(r.x, (r.flags & kCheckpointRepeat) != 0,
+                                    r.rate, 0.0f, r.y_offset, r.y_scale);
+      if ((r.flags & kCheckpointLocalSpline) != 0) {
+        SplineData& d = data_[i];
+        if (d.local_spline == nullptr) {
+          d.local_spline = AllocateSpline();
+        }
+        d.local_spline->Init(Range(r.local_y_start, r.local_y_end),
+                             r.local_x_granularity);
+        d.local_spline->AppendNodeData(r.local_nodes, r.num_local_nodes);
+        interpolator_.SetSplines(i, 1, d.local_spline, playback);
+        continue;
+      }
+
+      const CompactSpline* spline =
+          resolver != nullptr ? resolver(userdata, r.spline_hash) : nullptr;
+      if (spline == nullptr) {
+        // Unknown hash. Leave the index holding its last value.
+        RestoreWithoutSpline(i, r.y);
+        success = false;
+        continue;
+      }
+      FreeSpline(data_[i].local_spline);
+      data_[i].local_spline = nullptr;
+      interpolator_.SetSplines(i, 1, spline, playback);
+    }
+    return success;
+  }
+
+  virtual void RebindSplines(const CompactSpline* const* old_splines,
+                             const CompactSpline* const* new_splines,
+                             int num_splines) {
+    const MotiveIndex num_indices = NumIndices();
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      if (!interpolator_.Valid(i)) continue;
+      const CompactSpline* source = interpolator_.SourceSpline(i);
+      for (int s = 0; s < num_splines; ++s) {
+        if (source != old_splines[s]) continue;
+
+        const CompactSpline* new_spline = new_splines[s];
+        if (new_spline == nullptr) {
+          // The spline no longer exists. Hold the current value, as when a
+          // checkpointed spline fails to resolve.
+          RestoreWithoutSpline(i, interpolator_.Y(i));
+          break;
+        }
+
+        // Re-issue the playback at the current position so the evaluator
+        // rebuilds its cubic from the new spline's nodes. The position is
+        // clamped in case the reloaded spline got shorter; a blend_x of 0
+        // jumps rather than blends.
+        const SplinePlayback playback(
+            std::min(interpolator_.X(i), new_spline->EndX()),
+            interpolator_.Repeat(i), interpolator_.PlaybackRate(i), 0.0f,
+            interpolator_.YOffset(i), interpolator_.YScale(i));
+        FreeSpline(data_[i].local_spline);
+        data_[i].local_spline = nullptr;
+        interpolator_.SetSplines(i, 1, new_spline, playback);
+        break;
+      }
+    }
+  }
+
+  virtual void AccumulateDataMemoryStats(MotiveMemoryStats* stats) const {
+    const size_t spline_size =
+        CompactSpline::Size(CompactSpline::kDefaultMaxNodes);
+
+    // The data array, the interpolator's per-index arrays, and the slabs
+    // that back the local-spline pool. Slabs are never returned, so they
+    // count as allocated whether their splines are live or pooled.
+    stats->allocated_bytes +=
+        data_.capacity() * sizeof(SplineData) + interpolator_.AllocatedBytes() +
+        reported_ys_.capacity() * sizeof(float) +
+        spline_pool_.capacity() * sizeof(CompactSpline*) +
+        spline_slabs_.capacity() * sizeof(uint8_t*) +
+        spline_slabs_.size() * kSplinesPerSlab * spline_size;
+    for (int b = 0; b < 2; ++b) {
+      stats->allocated_bytes +=
+          (snapshot_ys_[b].capacity() + snapshot_derivatives_[b].capacity()) *
+          sizeof(float);
+    }
+
+    // Live bytes: each live index's slice of the arrays, plus the local
+    // splines currently checked out of the pool.
+    const size_t live_splines =
+        spline_slabs_.size() * kSplinesPerSlab - spline_pool_.size();
+    stats->live_bytes +=
+        NumLiveIndices() *
+            (sizeof(SplineData) + BulkSplineEvaluator::BytesPerIndex()) +
+        live_splines * spline_size;
+  }
+
   virtual void SetNumIndices(MotiveIndex num_indices) {
     data_.resize(num_indices);
+    if (track_value_deltas_) reported_ys_.resize(num_indices);
     interpolator_.SetNumIndices(num_indices);
+    if (frame_snapshots_) {
+      for (int b = 0; b < 2; ++b) {
+        snapshot_ys_[b].resize(num_indices, 0.0f);
+        snapshot_derivatives_[b].resize(num_indices, 0.0f);
+      }
+    }
   }
 
   const SplineData& Data(MotiveIndex index) const {
@@ -235,16 +783,33 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
   }
 
   CompactSpline* AllocateSpline() {
-    // Only create a new spline if there are no left in the pool.
-    if (spline_pool_.empty()) return new CompactSpline();
+    // Carve another slab of splines when the pool runs dry. Splines are
+    // recycled through the pool, so eventually we'll reach the high water
+    // mark of simultaneously-live local splines and stop allocating; from
+    // then on the create/destroy path never touches the heap.
+    if (spline_pool_.empty()) AllocateSplineSlab();
 
-    // Return a spline from the pool. Eventually we'll reach a high water mark
-    // and we will stop allocating new splines.
     CompactSpline* spline = spline_pool_.back();
     spline_pool_.pop_back();
     return spline;
   }
 
+  void AllocateSplineSlab() {
+    // One allocation--through the memory functions the user may have
+    // overridden with SetMemoryFunctions()--holds kSplinesPerSlab splines.
+    static const size_t kAlign = 16;
+    const size_t spline_size =
+        CompactSpline::Size(CompactSpline::kDefaultMaxNodes);
+    uint8_t* slab = static_cast<uint8_t*>(
+        MotiveAlloc(kSplinesPerSlab * spline_size, kAlign));
+    spline_slabs_.push_back(slab);
+
+    for (int i = 0; i < kSplinesPerSlab; ++i) {
+      spline_pool_.push_back(CompactSpline::CreateInPlace(
+          CompactSpline::kDefaultMaxNodes, slab + i * spline_size));
+    }
+  }
+
   void FreeSplineForIndex(MotiveIndex index) {
     SplineData& d = Data(index);
     FreeSpline(d.local_spline);
@@ -257,6 +822,30 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
     }
   }
 
+  // Restore an index that has no spline to play: detach any current spline
+  // and hold the checkpointed y value.
+  void RestoreWithoutSpline(MotiveIndex index, float y) {
+    interpolator_.ClearSplines(index, 1);
+    FreeSpline(data_[index].local_spline);
+    data_[index].local_spline = nullptr;
+    interpolator_.ImportYs(index, 1, &y);
+  }
+
+  // Fill `ys` and `derivatives` with every index's current value and
+  // velocity, for the snapshot buffers. Indices without a spline hold a
+  // constant cubic, so their derivative is zero and their y is whatever
+  // they were cleared to.
+  void CopySnapshot(std::vector<float>* ys,
+                    std::vector<float>* derivatives) const {
+    const MotiveIndex num_indices = NumIndices();
+    ys->resize(num_indices);
+    derivatives->resize(num_indices);
+    for (MotiveIndex i = 0; i < num_indices; ++i) {
+      (*ys)[i] = interpolator_.Y(i);
+      (*derivatives)[i] = interpolator_.Derivative(i);
+    }
+  }
+
   Range CalculateYRange(MotiveIndex index, const MotiveTarget1f& t,
                         float start_y) const {
     if (interpolator_.ModularArithmetic(index)) {
@@ -279,16 +868,47 @@ class SplineMotiveProcessor : public MotiveProcessorNf {
 
   // Hold index-specific data, for example a pointer to the spline allocated
   // from 'spline_pool_'.
-  std::vector<SplineData> data_;
+  std::vector<SplineData, BufferAllocator<SplineData>> data_;
 
   // Holds unused splines. When we need another local spline (because we're
   // supplied with target values but not the actual curve to get there),
   // try to recycle an old one from this pool first.
   std::vector<CompactSpline*> spline_pool_;
 
+  // Slabs of memory that the pool's splines are carved from, each holding
+  // kSplinesPerSlab splines. Freed en masse in the destructor.
+  std::vector<uint8_t*> spline_slabs_;
+
   // Perform the spline evaluation, over time. Indices in 'interpolator_'
   // are the same as the MotiveIndex values in this class.
   BulkSplineEvaluator interpolator_;
+
+  // Scratch list for CollectCrossings(). A member so that its allocation is
+  // reused from frame to frame.
+  std::vector<BulkSplineEvaluator::Crossing> crossing_scratch_;
+
+  // True if the engine wants a changed-value stream; see
+  // SetTrackValueDeltas().
+  bool track_value_deltas_;
+
+  // Quantization step of the changed-value stream, in value units.
+  float value_delta_epsilon_;
+
+  // Last reported value per index, on the epsilon grid relative to the
+  // value at seeding. Empty unless tracking is enabled.
+  std::vector<float, BufferAllocator<float>> reported_ys_;
+
+  // True if the engine keeps frame snapshots. See
+  // MotiveEngine::SetFrameSnapshots().
+  bool frame_snapshots_;
+
+  // Double-buffered (value, velocity) snapshot per index, for render-rate
+  // extrapolation while the simulation advances; see ExtrapolatedValues().
+  // Readers follow `snapshot_front_`; PublishFrameSnapshot() writes the
+  // other buffer and flips. Empty unless frame snapshots are on.
+  std::vector<float> snapshot_ys_[2];
+  std::vector<float> snapshot_derivatives_[2];
+  std::atomic<int> snapshot_front_;
 };
 
 MOTIVE_INSTANCE(SplineInit, SplineMotiveProcessor);
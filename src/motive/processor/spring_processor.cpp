@@ -16,6 +16,11 @@
 #include "motive/math/curve_util.h"
 #include "motive/processor/spring_data.h"
 #include "motive/simple_processor_template.h"
+#include "motive/util/benchmark.h"
+
+#if defined(MOTIVE_NEON_INTRINSICS)
+#include <arm_neon.h>
+#endif
 
 namespace motive {
 
@@ -48,17 +53,45 @@ class SpringMotiveProcessor : public SimpleProcessorTemplate<SpringData> {
   virtual void AdvanceFrame(MotiveTime delta_time) {
     Defragment();
 
-    // Loop through every motivator, one at a time.
-    // At some point we can write an assembly language function to process
-    // these in parallel.
-    for (size_t i = 0; i < data_.size(); ++i) {
+    // First pass, scalar: advance each spring's time, roll its Context
+    // forward when the current quadratic piece expires (rare for small time
+    // steps), and gather the evaluation constants into parallel arrays.
+    // The constants let the curve value be computed with two multiplies and
+    // an add; see QuadraticSpring::BulkEvaluationConstants().
+    const float delta = static_cast<float>(delta_time);
+    const size_t num_indices = data_.size();
+    for (size_t i = 0; i < num_indices; ++i) {
       SpringData& d = data_[i];
-
-      // Advance the time and then update the current value.
-      d.elapsed_time += static_cast<float>(delta_time);
+      d.elapsed_time += delta;
       d.q.IncrementContext(d.elapsed_time, &d.c);
-      values_[i] = d.q.EvaluateWithContext(d.elapsed_time, d.c);
+
+      float x_offset;
+      float valid_x_end;
+      d.q.BulkEvaluationConstants(d.c, &coeffs_[i], &bases_[i], &x_offset,
+                                  &valid_x_end);
+      quad_xs_[i] = d.elapsed_time + x_offset;
+    }
+
+    // Second pass: evaluate every spring in bulk from the parallel arrays.
+    //   value = base + coeff * quad_x^2
+#if defined(MOTIVE_NEON_INTRINSICS)
+    size_t i = 0;
+    for (; i + 4 <= num_indices; i += 4) {
+      const float32x4_t quad_x = vld1q_f32(&quad_xs_[i]);
+      const float32x4_t value =
+          vmlaq_f32(vld1q_f32(&bases_[i]), vld1q_f32(&coeffs_[i]),
+                    vmulq_f32(quad_x, quad_x));
+      vst1q_f32(&values_[i], value);
     }
+    for (; i < num_indices; ++i) {
+      values_[i] = bases_[i] + coeffs_[i] * quad_xs_[i] * quad_xs_[i];
+    }
+#else
+    // Contiguous independent iterations; the compiler can auto-vectorize.
+    for (size_t i = 0; i < num_indices; ++i) {
+      values_[i] = bases_[i] + coeffs_[i] * quad_xs_[i] * quad_xs_[i];
+    }
+#endif  // defined(MOTIVE_NEON_INTRINSICS)
   }
 
   virtual MotivatorType Type() const { return SpringInit::kType; }
@@ -68,6 +101,7 @@ class SpringMotiveProcessor : public SimpleProcessorTemplate<SpringData> {
                                   const float* target_values,
                                   const float* /*target_velocities*/,
                                   const MotiveCurveShape& shape) {
+    AddMotiveEvents(kMotiveEventSetTargets, 1);
     for (MotiveDimension i = 0; i < dimensions; ++i) {
       int processor_index = index + i;
       SpringData& d = Data(processor_index);
@@ -85,6 +119,22 @@ class SpringMotiveProcessor : public SimpleProcessorTemplate<SpringData> {
     // TODO(jsanmiya): We'll be removing MotiveShape in the next change.
     return MotiveCurveShape();
   }
+
+ protected:
+  virtual void SetNumIndices(MotiveIndex num_indices) {
+    SimpleProcessorTemplate<SpringData>::SetNumIndices(num_indices);
+    coeffs_.resize(num_indices);
+    bases_.resize(num_indices);
+    quad_xs_.resize(num_indices);
+  }
+
+ private:
+  // Per-frame scratch arrays holding the evaluation constants of each
+  // spring's current quadratic piece. Kept in struct-of-arrays form so the
+  // evaluation loop in AdvanceFrame() can be processed with SIMD.
+  std::vector<float> coeffs_;
+  std::vector<float> bases_;
+  std::vector<float> quad_xs_;
 };
 
 MOTIVE_INSTANCE(SpringInit, SpringMotiveProcessor);
@@ -42,6 +42,19 @@ MatrixAnim& RigAnim::InitMatrixAnim(BoneIndex idx, BoneIndex parent,
   return anims_[idx];
 }
 
+void RigAnim::PackOps() {
+  const BoneIndex num_bones = NumBones();
+  packed_bone_starts_.resize(num_bones + 1);
+  packed_ops_.clear();
+  packed_ops_.reserve(NumOps());
+  for (BoneIndex i = 0; i < num_bones; ++i) {
+    packed_bone_starts_[i] = static_cast<int>(packed_ops_.size());
+    const std::vector<MatrixOperationInit>& ops = anims_[i].ops();
+    packed_ops_.insert(packed_ops_.end(), ops.begin(), ops.end());
+  }
+  packed_bone_starts_[num_bones] = static_cast<int>(packed_ops_.size());
+}
+
 int RigAnim::NumOps() const {
   size_t num_ops = 0;
   for (BoneIndex i = 0; i < NumBones(); ++i) {
@@ -51,6 +64,82 @@ int RigAnim::NumOps() const {
   return static_cast<int>(num_ops);
 }
 
+size_t RigAnim::ApproxSizeBytes() const {
+  size_t bytes = sizeof(*this) + anims_.capacity() * sizeof(MatrixAnim) +
+                 bone_parents_.capacity() * sizeof(BoneIndex) +
+                 packed_ops_.capacity() * sizeof(MatrixOperationInit) +
+                 packed_bone_starts_.capacity() * sizeof(int) +
+                 spline_buffer_.capacity() + anim_name_.capacity();
+  for (size_t i = 0; i < anims_.size(); ++i) {
+    bytes += anims_[i].ApproxSizeBytes();
+  }
+  for (size_t i = 0; i < bone_names_.size(); ++i) {
+    bytes += bone_names_[i].capacity();
+  }
+  return bytes;
+}
+
+// 64-bit FNV-1a over `len` bytes, continuing from `hash`. Same scheme as
+// CompactSpline::ContentHash(), whose per-spline hashes are folded in below.
+static uint64_t HashRigBytes(const void* bytes, size_t len, uint64_t hash) {
+  const uint8_t* p = static_cast<const uint8_t*>(bytes);
+  for (size_t i = 0; i < len; ++i) {
+    hash = (hash ^ static_cast<uint64_t>(p[i])) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+uint64_t RigAnim::ContentHash() const {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  hash = HashRigBytes(&end_time_, sizeof(end_time_), hash);
+  const uint8_t repeat = repeat_ ? 1 : 0;
+  hash = HashRigBytes(&repeat, sizeof(repeat), hash);
+  const int32_t num_bones = NumBones();
+  hash = HashRigBytes(&num_bones, sizeof(num_bones), hash);
+  if (!bone_parents_.empty()) {
+    hash = HashRigBytes(bone_parents_.data(),
+                        bone_parents_.size() * sizeof(BoneIndex), hash);
+  }
+
+  for (BoneIndex i = 0; i < NumBones(); ++i) {
+    const std::vector<MatrixOperationInit>& ops = anims_[i].ops();
+    const int32_t num_ops = static_cast<int32_t>(ops.size());
+    hash = HashRigBytes(&num_ops, sizeof(num_ops), hash);
+    for (size_t j = 0; j < ops.size(); ++j) {
+      const MatrixOperationInit& op = ops[j];
+      const int32_t header[3] = {static_cast<int32_t>(op.id),
+                                 static_cast<int32_t>(op.type),
+                                 static_cast<int32_t>(op.union_type)};
+      hash = HashRigBytes(header, sizeof(header), hash);
+
+      // The init's range affects modular normalization during playback.
+      if (op.init != nullptr && op.init->type() == SplineInit::kType) {
+        const Range& range =
+            static_cast<const SplineInit*>(op.init)->range();
+        const float bounds[2] = {range.start(), range.end()};
+        hash = HashRigBytes(bounds, sizeof(bounds), hash);
+      }
+
+      switch (op.union_type) {
+        case MatrixOperationInit::kUnionInitialValue:
+          hash =
+              HashRigBytes(&op.initial_value, sizeof(op.initial_value), hash);
+          break;
+
+        case MatrixOperationInit::kUnionSpline: {
+          const uint64_t spline_hash = op.spline->ContentHash();
+          hash = HashRigBytes(&spline_hash, sizeof(spline_hash), hash);
+          break;
+        }
+
+        default:
+          break;
+      }
+    }
+  }
+  return hash;
+}
+
 void RigAnim::GetSplinesAndConstants(BoneIndex bone,
                                      const MatrixOperationType* ops,
                                      int num_ops, const CompactSpline** splines,
@@ -26,10 +26,24 @@ RigInit::RigInit(const RigAnim& defining_anim, const BoneIndex* bone_parents,
   // puppets).
   assert(defining_anim.NumBones() == 1 ||
          MatchesHierarchy(defining_anim, bone_parents, num_bones));
+
+  // Validate the traversal order once, so the per-frame pass doesn't have to.
+  // See TopologicallyOrdered() in the header.
+  assert(TopologicallyOrdered(bone_parents, num_bones));
   (void)bone_parents;
   (void)num_bones;
 }
 
+// static
+bool RigInit::TopologicallyOrdered(const BoneIndex* bone_parents,
+                                   BoneIndex num_bones) {
+  for (BoneIndex i = 0; i < num_bones; ++i) {
+    const BoneIndex parent = bone_parents[i];
+    if (parent != kInvalidBoneIdx && parent >= i) return false;
+  }
+  return true;
+}
+
 // static
 bool RigInit::MatchesHierarchy(const BoneIndex* parents_a, BoneIndex len_a,
                                const BoneIndex* parents_b, BoneIndex len_b) {
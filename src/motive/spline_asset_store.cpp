@@ -0,0 +1,119 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <assert.h>
+#include <string.h>
+
+#include "motive/spline_asset_store.h"
+#include "motive/util.h"
+
+namespace motive {
+
+// Alignment of store-owned splines. Matches the alignment the spline
+// processor uses for its local-spline slabs.
+static const size_t kSplineAlign = 16;
+
+// 64-bit FNV-1a. Plenty for content addressing a few hundred clips, and
+// needs no extra dependencies.
+static const uint64_t kHashSeed = 0xcbf29ce484222325ull;
+static const uint64_t kHashPrime = 0x100000001b3ull;
+
+static uint64_t HashBytes(const void* bytes, size_t num_bytes, uint64_t hash) {
+  const uint8_t* p = static_cast<const uint8_t*>(bytes);
+  for (size_t i = 0; i < num_bytes; ++i) {
+    hash = (hash ^ p[i]) * kHashPrime;
+  }
+  return hash;
+}
+
+// True if the splines evaluate identically: same node format, quantized
+// nodes, y-range, and granularity. Spare node capacity is ignored.
+static bool SameContent(const CompactSpline& a, const CompactSpline& b) {
+  return a.num_nodes() == b.num_nodes() && a.format() == b.format() &&
+         a.y_range() == b.y_range() &&
+         a.x_granularity() == b.x_granularity() &&
+         memcmp(a.node_data(), b.node_data(), a.node_data_size()) == 0;
+}
+
+uint64_t SplineAssetStore::ContentId(const CompactSpline& spline) {
+  const Range& y_range = spline.y_range();
+  const float range_and_granularity[3] = {y_range.start(), y_range.end(),
+                                          spline.x_granularity()};
+  uint64_t hash =
+      HashBytes(range_and_granularity, sizeof(range_and_granularity),
+                kHashSeed);
+  // Fold in the node format so a compact spline never aliases a wide one,
+  // then the raw node bytes, which are format-specific.
+  const uint8_t format = static_cast<uint8_t>(spline.format());
+  hash = HashBytes(&format, sizeof(format), hash);
+  return HashBytes(spline.node_data(), spline.node_data_size(), hash);
+}
+
+const CompactSpline* SplineAssetStore::Add(const CompactSpline& spline) {
+  const uint64_t content_id = ContentId(spline);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  // Already stored? Hand out the shared copy. A hash collision between
+  // splines with different content would alias them; with 64-bit content
+  // ids that is vanishingly unlikely, but cheap to check.
+  SplineMap::const_iterator it = splines_.find(content_id);
+  if (it != splines_.end()) {
+    assert(SameContent(*it->second, spline));
+    return it->second;
+  }
+
+  // Copy the spline, exactly and trimmed to its node count, into memory we
+  // own. The copy is never modified again, so any number of evaluators can
+  // read it concurrently.
+  const CompactSplineIndex num_nodes = spline.num_nodes();
+  const CompactSplineNodeFormat format = spline.format();
+  uint8_t* buffer = static_cast<uint8_t*>(MotiveAlloc(
+      CompactSpline::SizeWithFormat(num_nodes, format), kSplineAlign));
+  CompactSpline* copy =
+      CompactSpline::CreateInPlaceWithFormat(num_nodes, buffer, format);
+  copy->Init(spline.y_range(), spline.x_granularity());
+  copy->AppendNodeData(spline.node_data(), num_nodes);
+
+  splines_.insert(SplineMap::value_type(content_id, copy));
+  return copy;
+}
+
+const CompactSpline* SplineAssetStore::Find(uint64_t content_id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SplineMap::const_iterator it = splines_.find(content_id);
+  return it == splines_.end() ? nullptr : it->second;
+}
+
+void SplineAssetStore::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (SplineMap::iterator it = splines_.begin(); it != splines_.end(); ++it) {
+    // CompactSpline is trivially destructible; see
+    // CompactSpline::CreateInPlace().
+    MotiveFree(it->second);
+  }
+  splines_.clear();
+}
+
+size_t SplineAssetStore::NumSplines() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return splines_.size();
+}
+
+SplineAssetStore& SplineAssetStore::ProcessStore() {
+  static SplineAssetStore store;
+  return store;
+}
+
+}  // namespace motive
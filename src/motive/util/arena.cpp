@@ -0,0 +1,105 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "motive/util/arena.h"
+
+#include <cassert>
+
+namespace motive {
+
+// Blocks smaller than this aren't worth the allocator round trip.
+static const size_t kMinBlockCapacity = 4096;
+
+FrameArena::FrameArena(size_t initial_capacity)
+    : blocks_(nullptr), cursor_(nullptr), end_(nullptr) {
+  if (initial_capacity > 0) {
+    GrowBlock(initial_capacity);
+  }
+}
+
+FrameArena::~FrameArena() {
+  while (blocks_ != nullptr) {
+    Block* const next = blocks_->next;
+    delete[] reinterpret_cast<uint8_t*>(blocks_);
+    blocks_ = next;
+  }
+}
+
+void FrameArena::GrowBlock(size_t min_capacity) {
+  // Double the previous block so a workload that keeps overflowing reaches
+  // a big-enough block in a few frames.
+  size_t capacity =
+      blocks_ != nullptr ? blocks_->capacity * 2 : kMinBlockCapacity;
+  if (capacity < min_capacity) capacity = min_capacity;
+  if (capacity < kMinBlockCapacity) capacity = kMinBlockCapacity;
+
+  uint8_t* const bytes = new uint8_t[sizeof(Block) + capacity];
+  Block* const block = reinterpret_cast<Block*>(bytes);
+  block->next = blocks_;
+  block->capacity = capacity;
+  blocks_ = block;
+  cursor_ = bytes + sizeof(Block);
+  end_ = cursor_ + capacity;
+}
+
+void* FrameArena::Alloc(size_t bytes, size_t alignment) {
+  assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+  uintptr_t aligned = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) &
+                      ~static_cast<uintptr_t>(alignment - 1);
+  if (blocks_ == nullptr ||
+      aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+    // The slack covers worst-case alignment of the fresh block's storage.
+    GrowBlock(bytes + alignment);
+    aligned = (reinterpret_cast<uintptr_t>(cursor_) + alignment - 1) &
+              ~static_cast<uintptr_t>(alignment - 1);
+  }
+  cursor_ = reinterpret_cast<uint8_t*>(aligned + bytes);
+  return reinterpret_cast<void*>(aligned);
+}
+
+void FrameArena::Reset() {
+  if (blocks_ == nullptr) return;
+
+  // Keep the largest block and free the rest. In steady state there is only
+  // one block, so this loop touches nothing and frees nothing.
+  Block* largest = blocks_;
+  Block* rest = blocks_->next;
+  blocks_->next = nullptr;
+  while (rest != nullptr) {
+    Block* const next = rest->next;
+    if (rest->capacity > largest->capacity) {
+      delete[] reinterpret_cast<uint8_t*>(largest);
+      largest = rest;
+      largest->next = nullptr;
+    } else {
+      delete[] reinterpret_cast<uint8_t*>(rest);
+    }
+    rest = next;
+  }
+
+  blocks_ = largest;
+  cursor_ = reinterpret_cast<uint8_t*>(largest) + sizeof(Block);
+  end_ = cursor_ + largest->capacity;
+}
+
+size_t FrameArena::CapacityBytes() const {
+  size_t total = 0;
+  for (const Block* b = blocks_; b != nullptr; b = b->next) {
+    total += sizeof(Block) + b->capacity;
+  }
+  return total;
+}
+
+}  // namespace motive
@@ -12,15 +12,41 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <atomic>
+#include "motive/util/benchmark.h"
+
+namespace motive {
+
+// The event counters are always compiled in, independent of the
+// BENCHMARK_MOTIVE timing instrumentation below. Plain globals: the hot
+// paths add with relaxed ordering, and the per-frame reader swaps each
+// counter back to zero.
+static std::atomic<uint64_t> g_event_counts[kMotiveEventCounterCount];
+
+void AddMotiveEvents(const MotiveEventCounter counter, const uint64_t n) {
+  g_event_counts[counter].fetch_add(n, std::memory_order_relaxed);
+}
+
+void ReadAndResetMotiveEvents(MotiveEventCounters* counters) {
+  for (int i = 0; i < kMotiveEventCounterCount; ++i) {
+    counters->counts[i] =
+        g_event_counts[i].exchange(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace motive
+
 #if defined(BENCHMARK_MOTIVE)
 
+#include <algorithm>
 #include <assert.h>
 #include <limits>
 #include <math.h>
+#include <mutex>
+#include <ostream>
 #include <sstream>
 #include <stdint.h>
 #include <vector>
-#include "motive/util/benchmark.h"
 #include "benchmark_common.h" // From mathfu
 
 
@@ -28,111 +54,194 @@ namespace motive {
 
 static const double kMicrosecondsPerSecond = 1000000.0;
 
-// Holds an array of sampled data. Provide statistical analysis functions.
+// Samples are recorded into an HDR-style histogram rather than stored
+// individually: values below 2^kSubBucketBits land in exact buckets, and
+// above that each power of two is split into 2^kSubBucketBits sub-buckets,
+// bounding the relative error of any recorded value to 2^-kSubBucketBits
+// (~3%). Storage is a few KB regardless of how long the capture runs, and
+// percentiles--including the tail ones that linear buckets distort--read
+// straight off the bucket counts.
+static const int kSubBucketBits = 5;
+static const BenchmarkTime kSubBuckets = 1ULL << kSubBucketBits;
+
+// Index of the histogram bucket that holds `t`. Buckets are contiguous:
+// bucket b holds exactly value b for b < 2 * kSubBuckets, and a power-of-two
+// sub-range above that.
+static inline int BucketForSample(BenchmarkTime t) {
+  if (t < kSubBuckets) return static_cast<int>(t);
+
+  // Position of the highest set bit of `t`. At least kSubBucketBits.
+  int msb = kSubBucketBits;
+  for (BenchmarkTime v = t >> (kSubBucketBits + 1); v != 0; v >>= 1) {
+    ++msb;
+  }
+
+  const int shift = msb - kSubBucketBits;
+  return static_cast<int>(((shift + 1) << kSubBucketBits) +
+                          ((t >> shift) & (kSubBuckets - 1)));
+}
+
+// Smallest value that lands in `bucket`. Inverse of BucketForSample().
+static inline BenchmarkTime BucketMin(int bucket) {
+  if (bucket < static_cast<int>(2 * kSubBuckets))
+    return static_cast<BenchmarkTime>(bucket);
+  const int shift = (bucket >> kSubBucketBits) - 1;
+  return (kSubBuckets + (bucket & (kSubBuckets - 1))) << shift;
+}
+
+// Midpoint of `bucket`. Reported for percentiles.
+static inline BenchmarkTime BucketMid(int bucket) {
+  if (bucket < static_cast<int>(2 * kSubBuckets))
+    return static_cast<BenchmarkTime>(bucket);
+  const int shift = (bucket >> kSubBucketBits) - 1;
+  return BucketMin(bucket) + (1ULL << shift) / 2;
+}
+
+// Holds a histogram of sampled data. Provides statistical analysis functions.
 template<class T>
 class SampleAnalyzer {
  public:
   // Buckets are used in the histogram functions.
-  typedef uint16_t BucketType;
+  typedef uint32_t BucketType;
   typedef typename std::vector<BucketType> BucketArray;
   static const int kDefaultHistogramWidth = 80;
   static const int kDefaultHistogramHeight = 10;
 
   // Functions to set the time data.
-  explicit SampleAnalyzer(const char* name) : name_(name) {}
-  void Append(T sample) { samples_.push_back(sample); }
-  void Clear() { samples_.clear(); }
+  explicit SampleAnalyzer(const char* name)
+      : name_(name),
+        count_(0),
+        sum_(0.0),
+        sum_squares_(0.0),
+        min_(std::numeric_limits<BenchmarkTime>::max()),
+        max_(std::numeric_limits<BenchmarkTime>::min()) {}
+
+  void Append(T sample) {
+    ++count_;
+    sum_ += static_cast<double>(sample);
+    sum_squares_ += static_cast<double>(sample) * static_cast<double>(sample);
+    min_ = std::min(min_, static_cast<BenchmarkTime>(sample));
+    max_ = std::max(max_, static_cast<BenchmarkTime>(sample));
+
+    // The bucket array grows to cover the largest sample seen, then stops
+    // reallocating. ~32 buckets per power of two keeps it small.
+    const int bucket = BucketForSample(sample);
+    if (bucket >= static_cast<int>(counts_.size())) {
+      counts_.resize(bucket + 1, 0);
+    }
+    counts_[bucket]++;
+  }
+
+  void Clear() {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    sum_ = 0.0;
+    sum_squares_ = 0.0;
+    min_ = std::numeric_limits<BenchmarkTime>::max();
+    max_ = std::numeric_limits<BenchmarkTime>::min();
+  }
+
   void SetName(const char* name) { name_ = name; }
+  const std::string& Name() const { return name_; }
 
   // Const-functions to analyze the samples.
-  size_t NumSamples() const { return samples_.size(); }
+  size_t NumSamples() const { return static_cast<size_t>(count_); }
   BenchmarkTime Average() const;
   BenchmarkTime StandardDeviation(BenchmarkTime average) const;
-  void MinMax(BenchmarkTime* min_time, BenchmarkTime* max_time) const;
-  void Histogram(BenchmarkTime min, BenchmarkTime max,
-                 BucketArray* buckets_pointer) const;
+  BenchmarkTime Percentile(double fraction) const;
+  void MinMax(BenchmarkTime* min_time, BenchmarkTime* max_time) const {
+    *min_time = min_;
+    *max_time = max_;
+  }
+  void Histogram(BucketArray* buckets_pointer) const;
   std::string Statistics(double to_usec, int width = kDefaultHistogramWidth,
                          int height = kDefaultHistogramHeight) const;
 
  private:
-  // The sampled data. This vector is never shrunk. It will incur some
-  // overhead when it gets reallocated, but once it reaches its highwater
-  // mark, there will be no reallocation.
-  std::vector<T> samples_;
-
   // The name is used in functions that output text, like Statistics().
   std::string name_;
+
+  // Count of samples per HDR bucket. Grows to cover the largest sample,
+  // then reaches its highwater mark and stops reallocating.
+  std::vector<BucketType> counts_;
+
+  // Aggregates for the statistics that the buckets can't answer exactly.
+  // Sums are doubles so that long captures don't overflow.
+  uint64_t count_;
+  double sum_;
+  double sum_squares_;
+  BenchmarkTime min_;
+  BenchmarkTime max_;
 };
 
 template<class T>
 BenchmarkTime SampleAnalyzer<T>::Average() const {
-  // Gather the sum of all the samples.
-  // TODO: properly handle overflow in sum.
-  BenchmarkTime sum = 0;
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    sum += *it;
-  }
-
-  // Divide by the count, with proper rounding.
-  const BenchmarkTime count = samples_.size();
-  return (sum + count / 2) / count;
+  if (count_ == 0) return 0;
+  return static_cast<BenchmarkTime>(
+      floor(sum_ / static_cast<double>(count_) + 0.5));
 }
 
 template<class T>
 BenchmarkTime SampleAnalyzer<T>::StandardDeviation(BenchmarkTime average) const {
-  // Gather the sum of squares.
-  // TODO: handle possible overflow in sum.
-  BenchmarkTime deviation_sum = 0;
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    const BenchmarkTime diff = *it - average;
-    deviation_sum += diff * diff;
-  }
-
-  // Use doubles to calculate the square root of deviation_sum.
-  const BenchmarkTime count = samples_.size();
-  const BenchmarkTime deviation_squared = (deviation_sum + count / 2) / count;
-  const double deviation = sqrt(static_cast<double>(deviation_squared));
-  const double deviation_rounded = floor(deviation + 0.5);
-  return static_cast<BenchmarkTime>(deviation_rounded);
+  if (count_ == 0) return 0;
+  const double avg = static_cast<double>(average);
+  const double deviation_squared =
+      sum_squares_ / static_cast<double>(count_) - avg * avg;
+  const double deviation = sqrt(std::max(deviation_squared, 0.0));
+  return static_cast<BenchmarkTime>(floor(deviation + 0.5));
 }
 
+// Returns the sample value at the given cumulative fraction, e.g. 0.99 for
+// p99. Accurate to the bucket resolution (~3%), at every fraction: the
+// count-weighted walk makes the tail percentiles exact-to-bucket, where a
+// fixed linear histogram would lump the whole tail into its last bucket.
 template<class T>
-void SampleAnalyzer<T>::MinMax(BenchmarkTime* min_time, BenchmarkTime* max_time) const {
-  BenchmarkTime min = std::numeric_limits<BenchmarkTime>::max();
-  BenchmarkTime max = std::numeric_limits<BenchmarkTime>::min();
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    min = std::min(min, *it);
-    max = std::max(max, *it);
+BenchmarkTime SampleAnalyzer<T>::Percentile(double fraction) const {
+  if (count_ == 0) return 0;
+  const uint64_t target = std::min(
+      count_,
+      std::max<uint64_t>(
+          1, static_cast<uint64_t>(
+                 ceil(fraction * static_cast<double>(count_)))));
+
+  uint64_t cumulative = 0;
+  for (size_t b = 0; b < counts_.size(); ++b) {
+    cumulative += counts_[b];
+    if (cumulative >= target) {
+      // Clamp the bucket midpoint to the observed range, so percentiles
+      // never report beyond the true min or max.
+      return std::min(std::max(BucketMid(static_cast<int>(b)), min_), max_);
+    }
   }
-  *min_time = min;
-  *max_time = max;
+  return max_;
 }
 
+// Condense the HDR bucket counts into `buckets_pointer->capacity()` display
+// columns. Columns span the bucket-index range of the observed samples, so
+// the x-axis is logarithmic above 2^kSubBucketBits.
 template<class T>
-void SampleAnalyzer<T>::Histogram(BenchmarkTime min, BenchmarkTime max,
-                                  BucketArray* buckets_pointer) const {
+void SampleAnalyzer<T>::Histogram(BucketArray* buckets_pointer) const {
   // Use all the buckets we can.
   BucketArray& buckets = *buckets_pointer;
   buckets.resize(buckets.capacity());
 
   // Empty the buckets.
   std::fill(buckets.begin(), buckets.end(), 0);
+  if (count_ == 0) return;
 
   // Handle case where all samples are the same, to avoid division by zero.
-  const BenchmarkTime num_buckets = buckets.size();
-  const BenchmarkTime width = max - min;
-  if (width == 0) {
-    buckets[0] = static_cast<BucketType>(samples_.size());
+  const int num_columns = static_cast<int>(buckets.size());
+  const int first = BucketForSample(min_);
+  const int last = BucketForSample(max_);
+  if (first == last) {
+    buckets[0] = static_cast<BucketType>(count_);
     return;
   }
 
-  // Place each sample in the appropriate bucket.
-  // TODO: handle possible overflow in multiplication.
-  for (auto it = samples_.begin(); it != samples_.end(); ++it) {
-    const BenchmarkTime t = *it;
-    const BenchmarkTime bucket = (num_buckets - 1) * (t - min) / (max - min);
-    assert(bucket < num_buckets);
-    buckets[static_cast<size_t>(bucket)]++;
+  // Place each HDR bucket's count in the appropriate column.
+  for (int b = first; b <= last && b < static_cast<int>(counts_.size()); ++b) {
+    const int column = (num_columns - 1) * (b - first) / (last - first);
+    buckets[column] += counts_[b];
   }
 }
 
@@ -152,10 +261,14 @@ std::string SampleAnalyzer<T>::Statistics(double to_usec, int width,
     << ", min " << min * to_usec << "usec"
     << ", max " << max * to_usec << "usec"
     << ", standard deviation " << stdev * to_usec << "usec" << std::endl;
+  s << "  p50 " << Percentile(0.5) * to_usec << "usec"
+    << ", p90 " << Percentile(0.9) * to_usec << "usec"
+    << ", p99 " << Percentile(0.99) * to_usec << "usec"
+    << ", p99.9 " << Percentile(0.999) * to_usec << "usec" << std::endl;
 
-  // Gather a histogram with 'width' buckets.
+  // Gather a histogram with 'width' columns. Log-scale above 2^kSubBucketBits.
   BucketArray buckets(width);
-  Histogram(min, max, &buckets);
+  Histogram(&buckets);
 
   // Find the histogram bucket with the most samples so that we can scale the
   // height.
@@ -163,6 +276,7 @@ std::string SampleAnalyzer<T>::Statistics(double to_usec, int width,
   for (int j = 1; j < width; ++j) {
     biggest_bucket = std::max(biggest_bucket, buckets[j]);
   }
+  if (biggest_bucket == 0) biggest_bucket = 1;
 
   // Output an ASCII histogram.
   for (int i = 0; i < height; ++i) {
@@ -210,11 +324,150 @@ void OutputBenchmarks() {
   }
 }
 
+// ---- Sampling gate ----
+
+// Scopes in this many are recorded; the rest skip timing entirely.
+static std::atomic<int> gSampleOneInN(1);
+
+void SetBenchmarkSampling(int one_in_n) {
+  assert(one_in_n >= 1);
+  gSampleOneInN = one_in_n;
+}
+
+bool BenchmarkSampleGate() {
+  const int n = gSampleOneInN.load(std::memory_order_relaxed);
+  if (n <= 1) return true;
+
+  // Per-thread countdown, so worker threads don't contend on a shared
+  // counter. Each thread independently records one scope in every `n`.
+  static thread_local int countdown = 0;
+  if (countdown > 0) {
+    --countdown;
+    return false;
+  }
+  countdown = n - 1;
+  return true;
+}
+
+// ---- Trace event recording ----
+//
+// Each thread that executes a `Benchmark` scope while tracing is enabled
+// gets its own ring buffer of events, so recording takes no locks. The
+// global mutex below guards only the list of buffers: it is taken once per
+// thread (on that thread's first event) and during output.
+
+struct TraceEvent {
+  int id;
+  BenchmarkTime begin;
+  BenchmarkTime end;
+};
+
+class ThreadTraceBuffer {
+ public:
+  ThreadTraceBuffer(int tid, size_t capacity)
+      : tid_(tid), write_index_(0), events_(capacity) {}
+
+  void Record(int id, BenchmarkTime begin, BenchmarkTime end) {
+    // Overwrite the oldest event when the ring buffer is full.
+    TraceEvent& e = events_[write_index_ % events_.size()];
+    e.id = id;
+    e.begin = begin;
+    e.end = end;
+    write_index_++;
+  }
+
+  void Clear() { write_index_ = 0; }
+
+  int tid() const { return tid_; }
+  size_t NumEvents() const { return std::min(write_index_, events_.size()); }
+
+  // Return the i'th recorded event, oldest first.
+  const TraceEvent& Event(size_t i) const {
+    const size_t oldest =
+        write_index_ <= events_.size() ? 0 : write_index_ % events_.size();
+    return events_[(oldest + i) % events_.size()];
+  }
+
+ private:
+  int tid_;
+  size_t write_index_;
+  std::vector<TraceEvent> events_;
+};
+
+static std::atomic<bool> gTracing(false);
+static size_t gTraceCapacity = 0;
+static std::mutex gTraceMutex;
+
+// All buffers ever created. Buffers live until ClearTrace() resets them; they
+// are intentionally never freed, since a thread may outlive a trace session
+// and start recording into its buffer again on the next StartTrace().
+static std::vector<ThreadTraceBuffer*> gTraceBuffers;
+
+// Lazily create the calling thread's buffer on its first recorded event.
+static ThreadTraceBuffer* ThreadBuffer() {
+  static thread_local ThreadTraceBuffer* buffer = nullptr;
+  if (buffer == nullptr) {
+    std::lock_guard<std::mutex> lock(gTraceMutex);
+    buffer = new ThreadTraceBuffer(static_cast<int>(gTraceBuffers.size()),
+                                   gTraceCapacity);
+    gTraceBuffers.push_back(buffer);
+  }
+  return buffer;
+}
+
+void StartTrace(int max_events_per_thread) {
+  assert(max_events_per_thread > 0);
+  std::lock_guard<std::mutex> lock(gTraceMutex);
+  gTraceCapacity = static_cast<size_t>(max_events_per_thread);
+  gTracing = true;
+}
+
+void StopTrace() { gTracing = false; }
+
+void ClearTrace() {
+  std::lock_guard<std::mutex> lock(gTraceMutex);
+  for (auto it = gTraceBuffers.begin(); it != gTraceBuffers.end(); ++it) {
+    (*it)->Clear();
+  }
+}
+
+void OutputTraceJson(std::ostream& out) {
+  std::lock_guard<std::mutex> lock(gTraceMutex);
+  const double to_usec = Timer::tick_period() * kMicrosecondsPerSecond;
+
+  // Trace Event Format: a JSON array of complete ("ph":"X") events.
+  // Events needn't be sorted; the viewer orders them by timestamp.
+  out << "[";
+  bool first = true;
+  for (auto it = gTraceBuffers.begin(); it != gTraceBuffers.end(); ++it) {
+    const ThreadTraceBuffer& buffer = **it;
+    for (size_t i = 0; i < buffer.NumEvents(); ++i) {
+      const TraceEvent& e = buffer.Event(i);
+      out << (first ? "\n" : ",\n");
+      first = false;
+      out << "{\"name\":\"" << gTimes[e.id].Name()
+          << "\",\"cat\":\"motive\",\"ph\":\"X\""
+          << ",\"ts\":" << e.begin * to_usec
+          << ",\"dur\":" << (e.end - e.begin) * to_usec
+          << ",\"pid\":0,\"tid\":" << buffer.tid() << "}";
+    }
+  }
+  out << "\n]\n";
+}
+
 Benchmark::~Benchmark() {
+  // Gated out by SetBenchmarkSampling(), or registered while benchmarking
+  // was disabled.
+  if (id_ < 0) return;
+
   BenchmarkTime end_time = GetBenchmarkTime();
 
-  assert(0 <= id_ && id_ < static_cast<int>(gTimes.size()));
+  assert(id_ < static_cast<int>(gTimes.size()));
   gTimes[id_].Append(end_time - start_time_);
+
+  if (gTracing) {
+    ThreadBuffer()->Record(id_, start_time_, end_time);
+  }
 }
 
 }  // namespace motive
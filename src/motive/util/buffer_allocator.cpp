@@ -0,0 +1,39 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "motive/util/buffer_allocator.h"
+
+#include <cassert>
+
+#include "motive/util.h"
+
+namespace motive {
+
+// These live in a translation unit, rather than inline in the header,
+// because motive/util.h includes motivator.h and so cannot be included
+// from the low-level headers that parameterize their vectors on
+// BufferAllocator.
+
+void* AllocateBuffer(size_t bytes, size_t alignment) {
+  assert(alignment >= kBufferAlignment &&
+         (alignment & (alignment - 1)) == 0);
+  return MotiveAlloc(bytes, alignment);
+}
+
+void FreeBuffer(void* buffer) {
+  if (buffer == nullptr) return;
+  MotiveFree(buffer);
+}
+
+}  // namespace motive
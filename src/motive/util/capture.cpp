@@ -0,0 +1,467 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "motive/util/capture.h"
+
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#include "motive/engine.h"
+#include "motive/math/compact_spline.h"
+#include "motive/spline_init.h"
+#include "motive/target.h"
+#include "motive/vector_motivator.h"
+
+namespace motive {
+
+// ---- Log format ----
+// Little-endian, packed. A 8-byte header--the magic "MOCP" and a version--
+// followed by records. Each record is a 1-byte opcode and a fixed layout
+// payload; splines and targets carry their element counts inline. Floats
+// are stored as their native 4-byte representation.
+static const uint8_t kCaptureMagic[4] = {'M', 'O', 'C', 'P'};
+static const uint32_t kCaptureVersion = 1;
+static const size_t kCaptureHeaderSize = 8;
+
+enum CaptureOpcode {
+  kOpAdvanceFrame = 1,  // int32 delta_time
+  kOpInitSpline = 2,    // uint32 serial, uint8 dims, uint8 modular,
+                        // float range_start, float range_end
+  kOpSetTargets = 3,    // uint32 serial, uint8 dims, then per dimension:
+                        // uint8 num_nodes, then per node:
+                        // float value, float velocity, int32 time, uint8 dir
+  kOpSetSplines = 4,    // uint32 serial, uint8 dims,
+                        // float start_x, blend_x, playback_rate, y_offset,
+                        // y_scale, uint8 repeat, then per dimension:
+                        // uint16 num_nodes, then per node:
+                        // float x, float y, float derivative
+  kOpRemove = 5,        // uint32 serial
+};
+
+// ---- Recording ----
+
+namespace detail {
+bool capture_active = false;
+}  // namespace detail
+
+// All capture state, so one delete tears the whole thing down.
+struct CaptureState {
+  CaptureState() : next_serial(0) {}
+
+  // The log under construction.
+  std::vector<uint8_t> log;
+
+  // Serial number assigned to each recorded motivator at Initialize().
+  // Identity is the Motivator's address, so a motivator that is moved with
+  // the copy operators drops out of the capture; see the header comment.
+  std::unordered_map<const Motivator*, uint32_t> serials;
+
+  uint32_t next_serial;
+};
+
+static CaptureState* g_capture = nullptr;
+
+template <typename T>
+static void Write(std::vector<uint8_t>* log, const T& value) {
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+  log->insert(log->end(), bytes, bytes + sizeof(T));
+}
+
+void StartMotiveCapture() {
+  if (g_capture != nullptr) return;
+  g_capture = new CaptureState();
+  g_capture->log.insert(g_capture->log.end(), kCaptureMagic,
+                        kCaptureMagic + sizeof(kCaptureMagic));
+  Write(&g_capture->log, kCaptureVersion);
+  detail::capture_active = true;
+}
+
+bool StopMotiveCapture(std::vector<uint8_t>* out) {
+  if (g_capture == nullptr) return false;
+  detail::capture_active = false;
+  out->swap(g_capture->log);
+  delete g_capture;
+  g_capture = nullptr;
+  return true;
+}
+
+bool StopMotiveCapture(const char* file_name) {
+  std::vector<uint8_t> log;
+  if (!StopMotiveCapture(&log)) return false;
+
+  FILE* f = fopen(file_name, "wb");
+  if (f == nullptr) return false;
+  const size_t written = fwrite(log.data(), 1, log.size(), f);
+  fclose(f);
+  return written == log.size();
+}
+
+bool MotiveCaptureActive() { return detail::capture_active; }
+
+namespace detail {
+
+void CaptureInitialize(const Motivator* m, const MotivatorInit& init,
+                       MotiveDimension dimensions) {
+  // Only spline-driven motivators are representable in the log. Other types
+  // are skipped here, which also drops their later calls, since they never
+  // receive a serial.
+  if (init.type() != SplineInit::kType) return;
+  const SplineInit& spline_init = static_cast<const SplineInit&>(init);
+
+  const uint32_t serial = g_capture->next_serial++;
+  g_capture->serials[m] = serial;
+
+  std::vector<uint8_t>& log = g_capture->log;
+  Write(&log, static_cast<uint8_t>(kOpInitSpline));
+  Write(&log, serial);
+  Write(&log, static_cast<uint8_t>(dimensions));
+  Write(&log, static_cast<uint8_t>(spline_init.range().Valid() ? 1 : 0));
+  Write(&log, spline_init.range().start());
+  Write(&log, spline_init.range().end());
+}
+
+void CaptureSetTargets(const Motivator* m, const MotiveTarget1f* targets,
+                       MotiveDimension dimensions) {
+  const auto it = g_capture->serials.find(m);
+  if (it == g_capture->serials.end()) return;
+
+  std::vector<uint8_t>& log = g_capture->log;
+  Write(&log, static_cast<uint8_t>(kOpSetTargets));
+  Write(&log, it->second);
+  Write(&log, static_cast<uint8_t>(dimensions));
+  for (MotiveDimension i = 0; i < dimensions; ++i) {
+    const MotiveTarget1f& t = targets[i];
+    Write(&log, static_cast<uint8_t>(t.num_nodes()));
+    for (int n = 0; n < t.num_nodes(); ++n) {
+      const MotiveNode1f& node = t.Node(n);
+      Write(&log, node.value);
+      Write(&log, node.velocity);
+      Write(&log, static_cast<int32_t>(node.time));
+      Write(&log, static_cast<uint8_t>(node.direction));
+    }
+  }
+}
+
+void CaptureSetSplines(const Motivator* m, const CompactSpline* splines,
+                       MotiveDimension dimensions,
+                       const SplinePlayback& playback) {
+  const auto it = g_capture->serials.find(m);
+  if (it == g_capture->serials.end()) return;
+
+  std::vector<uint8_t>& log = g_capture->log;
+  Write(&log, static_cast<uint8_t>(kOpSetSplines));
+  Write(&log, it->second);
+  Write(&log, static_cast<uint8_t>(dimensions));
+  Write(&log, playback.start_x);
+  Write(&log, playback.blend_x);
+  Write(&log, playback.playback_rate);
+  Write(&log, playback.y_offset);
+  Write(&log, playback.y_scale);
+  Write(&log, static_cast<uint8_t>(playback.repeat ? 1 : 0));
+
+  // Store nodes uncompressed. The capture is bigger than the quantized
+  // source data, but replay doesn't need to know which node format the
+  // source spline used.
+  const CompactSpline* spline = splines;
+  for (MotiveDimension i = 0; i < dimensions;
+       ++i, spline = spline->Next()) {
+    const uint16_t num_nodes = static_cast<uint16_t>(spline->num_nodes());
+    Write(&log, num_nodes);
+    for (uint16_t n = 0; n < num_nodes; ++n) {
+      Write(&log, spline->NodeX(n));
+      Write(&log, spline->NodeY(n));
+      Write(&log, spline->NodeDerivative(n));
+    }
+  }
+}
+
+void CaptureRemove(const Motivator* m) {
+  const auto it = g_capture->serials.find(m);
+  if (it == g_capture->serials.end()) return;
+
+  Write(&g_capture->log, static_cast<uint8_t>(kOpRemove));
+  Write(&g_capture->log, it->second);
+  g_capture->serials.erase(it);
+}
+
+void CaptureAdvanceFrame(MotiveTime delta_time) {
+  Write(&g_capture->log, static_cast<uint8_t>(kOpAdvanceFrame));
+  Write(&g_capture->log, static_cast<int32_t>(delta_time));
+}
+
+}  // namespace detail
+
+// ---- Replay ----
+
+// Bounds-checked reader over the log bytes. On truncated input, reads fail
+// and the replay stops instead of running off the buffer.
+class CaptureLogReader {
+ public:
+  CaptureLogReader(const std::vector<uint8_t>& log, size_t cursor)
+      : log_(log), cursor_(cursor), ok_(true) {}
+
+  template <typename T>
+  T Read() {
+    T value = T();
+    if (cursor_ + sizeof(T) > log_.size()) {
+      ok_ = false;
+      cursor_ = log_.size();
+      return value;
+    }
+    memcpy(&value, &log_[cursor_], sizeof(T));
+    cursor_ += sizeof(T);
+    return value;
+  }
+
+  size_t cursor() const { return cursor_; }
+  bool ok() const { return ok_; }
+  bool AtEnd() const { return cursor_ >= log_.size(); }
+
+ private:
+  const std::vector<uint8_t>& log_;
+  size_t cursor_;
+  bool ok_;
+};
+
+bool MotiveCaptureReplay::Load(const char* file_name) {
+  FILE* f = fopen(file_name, "rb");
+  if (f == nullptr) return false;
+  fseek(f, 0, SEEK_END);
+  const long size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  std::vector<uint8_t> bytes(size < 0 ? 0 : static_cast<size_t>(size));
+  const size_t read = fread(bytes.data(), 1, bytes.size(), f);
+  fclose(f);
+  if (read != bytes.size()) return false;
+
+  return LoadFromMemory(bytes.data(), bytes.size());
+}
+
+bool MotiveCaptureReplay::LoadFromMemory(const uint8_t* bytes,
+                                         size_t num_bytes) {
+  if (num_bytes < kCaptureHeaderSize ||
+      memcmp(bytes, kCaptureMagic, sizeof(kCaptureMagic)) != 0) {
+    return false;
+  }
+  uint32_t version;
+  memcpy(&version, bytes + sizeof(kCaptureMagic), sizeof(version));
+  if (version != kCaptureVersion) return false;
+
+  Clear();
+  log_.assign(bytes, bytes + num_bytes);
+  cursor_ = kCaptureHeaderSize;
+
+  // Validate the record stream and count frames, by walking it the same way
+  // AdvanceFrame() will.
+  num_frames_ = 0;
+  CaptureLogReader r(log_, cursor_);
+  while (!r.AtEnd() && r.ok()) {
+    switch (r.Read<uint8_t>()) {
+      case kOpAdvanceFrame:
+        r.Read<int32_t>();
+        num_frames_++;
+        break;
+      case kOpInitSpline:
+        r.Read<uint32_t>();
+        r.Read<uint8_t>();
+        r.Read<uint8_t>();
+        r.Read<float>();
+        r.Read<float>();
+        break;
+      case kOpSetTargets: {
+        r.Read<uint32_t>();
+        const uint8_t dims = r.Read<uint8_t>();
+        for (uint8_t i = 0; i < dims && r.ok(); ++i) {
+          const uint8_t num_nodes = r.Read<uint8_t>();
+          for (uint8_t n = 0; n < num_nodes && r.ok(); ++n) {
+            r.Read<float>();
+            r.Read<float>();
+            r.Read<int32_t>();
+            r.Read<uint8_t>();
+          }
+        }
+        break;
+      }
+      case kOpSetSplines: {
+        r.Read<uint32_t>();
+        const uint8_t dims = r.Read<uint8_t>();
+        for (int i = 0; i < 5; ++i) r.Read<float>();
+        r.Read<uint8_t>();
+        for (uint8_t i = 0; i < dims && r.ok(); ++i) {
+          const uint16_t num_nodes = r.Read<uint16_t>();
+          for (uint16_t n = 0; n < num_nodes && r.ok(); ++n) {
+            r.Read<float>();
+            r.Read<float>();
+            r.Read<float>();
+          }
+        }
+        break;
+      }
+      case kOpRemove:
+        r.Read<uint32_t>();
+        break;
+      default:
+        return false;
+    }
+  }
+  if (!r.ok()) return false;
+  return true;
+}
+
+bool MotiveCaptureReplay::AdvanceFrame(MotiveEngine* engine) {
+  if (Done()) return false;
+
+  CaptureLogReader r(log_, cursor_);
+  while (!r.AtEnd() && r.ok()) {
+    const uint8_t opcode = r.Read<uint8_t>();
+    switch (opcode) {
+      case kOpAdvanceFrame: {
+        const MotiveTime delta_time =
+            static_cast<MotiveTime>(r.Read<int32_t>());
+        cursor_ = r.cursor();
+        engine->AdvanceFrame(delta_time);
+        return true;
+      }
+
+      case kOpInitSpline: {
+        const uint32_t serial = r.Read<uint32_t>();
+        const MotiveDimension dims =
+            static_cast<MotiveDimension>(r.Read<uint8_t>());
+        const bool modular = r.Read<uint8_t>() != 0;
+        const float range_start = r.Read<float>();
+        const float range_end = r.Read<float>();
+        if (!r.ok()) break;
+
+        const SplineInit init(modular ? Range(range_start, range_end)
+                                      : Range());
+        MotivatorNf* m = new MotivatorNf();
+        m->Initialize(init, engine, dims);
+        motivators_[serial] = m;
+        break;
+      }
+
+      case kOpSetTargets: {
+        const uint32_t serial = r.Read<uint32_t>();
+        const MotiveDimension dims =
+            static_cast<MotiveDimension>(r.Read<uint8_t>());
+        std::vector<MotiveTarget1f> targets;
+        for (MotiveDimension i = 0; i < dims && r.ok(); ++i) {
+          const uint8_t num_nodes = r.Read<uint8_t>();
+          MotiveNode1f nodes[3];
+          for (uint8_t n = 0; n < num_nodes && n < 3 && r.ok(); ++n) {
+            nodes[n].value = r.Read<float>();
+            nodes[n].velocity = r.Read<float>();
+            nodes[n].time = static_cast<MotiveTime>(r.Read<int32_t>());
+            nodes[n].direction =
+                static_cast<ModularDirection>(r.Read<uint8_t>());
+          }
+          targets.push_back(
+              num_nodes >= 3 ? MotiveTarget1f(nodes[0], nodes[1], nodes[2])
+              : num_nodes == 2 ? MotiveTarget1f(nodes[0], nodes[1])
+              : num_nodes == 1 ? MotiveTarget1f(nodes[0])
+                               : MotiveTarget1f());
+        }
+        if (!r.ok()) break;
+
+        const auto it = motivators_.find(serial);
+        if (it != motivators_.end()) {
+          it->second->SetTargets(targets.data());
+        }
+        break;
+      }
+
+      case kOpSetSplines: {
+        const uint32_t serial = r.Read<uint32_t>();
+        const MotiveDimension dims =
+            static_cast<MotiveDimension>(r.Read<uint8_t>());
+        SplinePlayback playback;
+        playback.start_x = r.Read<float>();
+        playback.blend_x = r.Read<float>();
+        playback.playback_rate = r.Read<float>();
+        playback.y_offset = r.Read<float>();
+        playback.y_scale = r.Read<float>();
+        playback.repeat = r.Read<uint8_t>() != 0;
+
+        std::vector<const CompactSpline*> spline_ptrs;
+        std::vector<UncompressedNode> nodes;
+        for (MotiveDimension i = 0; i < dims && r.ok(); ++i) {
+          const uint16_t num_nodes = r.Read<uint16_t>();
+          nodes.resize(num_nodes);
+          for (uint16_t n = 0; n < num_nodes && r.ok(); ++n) {
+            nodes[n].x = r.Read<float>();
+            nodes[n].y = r.Read<float>();
+            nodes[n].derivative = r.Read<float>();
+          }
+          if (!r.ok()) break;
+          CompactSpline* spline =
+              CompactSpline::CreateFromNodes(nodes.data(), nodes.size());
+          splines_.push_back(spline);
+          spline_ptrs.push_back(spline);
+        }
+        if (!r.ok()) break;
+
+        const auto it = motivators_.find(serial);
+        if (it != motivators_.end()) {
+          // The replayed splines are individual allocations, not the
+          // contiguous array SetSplines() expects, so set them through the
+          // pointer-array variant. The targets are only read for null
+          // spline entries, of which there are none.
+          const std::vector<MotiveTarget1f> unused_targets(dims);
+          it->second->SetSplinesAndTargets(spline_ptrs.data(), playback,
+                                           unused_targets.data());
+        }
+        break;
+      }
+
+      case kOpRemove: {
+        const uint32_t serial = r.Read<uint32_t>();
+        const auto it = motivators_.find(serial);
+        if (it != motivators_.end()) {
+          delete it->second;
+          motivators_.erase(it);
+        }
+        break;
+      }
+
+      default:
+        // Unknown record; Load() validated the stream, so this means the
+        // log was modified since. Stop replaying.
+        cursor_ = log_.size();
+        return false;
+    }
+  }
+
+  cursor_ = r.cursor();
+  return false;
+}
+
+void MotiveCaptureReplay::Restart() {
+  Clear();
+  cursor_ = log_.empty() ? 0 : kCaptureHeaderSize;
+}
+
+void MotiveCaptureReplay::Clear() {
+  for (auto it = motivators_.begin(); it != motivators_.end(); ++it) {
+    delete it->second;
+  }
+  motivators_.clear();
+  for (size_t i = 0; i < splines_.size(); ++i) {
+    CompactSpline::Destroy(splines_[i]);
+  }
+  splines_.clear();
+}
+
+}  // namespace motive
@@ -0,0 +1,129 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "motive/util/command_queue.h"
+
+#include <cassert>
+
+namespace motive {
+
+// static
+MotiveCommand MotiveCommand::SetTargets(MotivatorNf* motivator,
+                                        const MotiveTarget1f* targets,
+                                        int dimensions) {
+  assert(motivator != nullptr && 0 < dimensions &&
+         dimensions <= kMaxDimensions);
+  MotiveCommand command;
+  command.type = kSetTargets;
+  command.motivator = motivator;
+  for (int i = 0; i < dimensions; ++i) {
+    command.targets[i] = targets[i];
+  }
+  command.splines = nullptr;
+  command.playback_rate = 0.0f;
+  return command;
+}
+
+// static
+MotiveCommand MotiveCommand::SetSplines(MotivatorNf* motivator,
+                                        const CompactSpline* splines,
+                                        const SplinePlayback& playback) {
+  assert(motivator != nullptr && splines != nullptr);
+  MotiveCommand command;
+  command.type = kSetSplines;
+  command.motivator = motivator;
+  command.splines = splines;
+  command.playback = playback;
+  command.playback_rate = 0.0f;
+  return command;
+}
+
+// static
+MotiveCommand MotiveCommand::SetSplinePlaybackRate(MotivatorNf* motivator,
+                                                   float playback_rate) {
+  assert(motivator != nullptr);
+  MotiveCommand command;
+  command.type = kSetSplinePlaybackRate;
+  command.motivator = motivator;
+  command.splines = nullptr;
+  command.playback_rate = playback_rate;
+  return command;
+}
+
+// Smallest power of two >= n, and at least 2 so the wrap mask works.
+static size_t RoundUpToPowerOfTwo(size_t n) {
+  size_t pow2 = 2;
+  while (pow2 < n) pow2 *= 2;
+  return pow2;
+}
+
+MotiveCommandQueue::MotiveCommandQueue(size_t capacity)
+    : slots_(nullptr),
+      capacity_(RoundUpToPowerOfTwo(capacity)),
+      enqueue_pos_(0),
+      dequeue_pos_(0) {
+  slots_ = new Slot[capacity_];
+  for (size_t i = 0; i < capacity_; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+MotiveCommandQueue::~MotiveCommandQueue() { delete[] slots_; }
+
+bool MotiveCommandQueue::Enqueue(const MotiveCommand& command) {
+  // Claim a ticket. The matching slot is ours alone once its sequence
+  // equals the ticket; the store below hands it to the consumer.
+  for (;;) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    Slot& slot = slots_[pos & (capacity_ - 1)];
+    const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+    if (sequence == pos) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1,
+                                             std::memory_order_relaxed)) {
+        slot.command = command;
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+      // Another producer took the ticket; retry with the new position.
+    } else if (sequence < pos) {
+      // The consumer hasn't recycled this slot yet: the queue is full.
+      return false;
+    }
+    // sequence > pos: another producer advanced the queue under us; retry.
+  }
+}
+
+size_t MotiveCommandQueue::Drain(MotiveCommand* commands,
+                                 size_t max_commands) {
+  size_t num_popped = 0;
+  while (num_popped < max_commands) {
+    Slot& slot = slots_[dequeue_pos_ & (capacity_ - 1)];
+    const size_t sequence = slot.sequence.load(std::memory_order_acquire);
+
+    // A slot is readable once its producer has published ticket + 1.
+    // Stopping at the first unpublished slot keeps the drain in enqueue
+    // order; a command mid-write is simply picked up next frame.
+    if (sequence != dequeue_pos_ + 1) break;
+
+    commands[num_popped++] = slot.command;
+
+    // Recycle the slot for the producer that will lap around to it.
+    slot.sequence.store(dequeue_pos_ + capacity_, std::memory_order_release);
+    ++dequeue_pos_;
+  }
+  return num_popped;
+}
+
+}  // namespace motive
@@ -0,0 +1,110 @@
+// Copyright 2014 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "motive/util/handle_pool.h"
+
+#include <cassert>
+#include <new>
+
+#include "motive/util.h"
+
+namespace motive {
+
+MotiveHandlePool::MotiveHandlePool(MotiveEngine* engine)
+    : engine_(engine), num_live_(0) {
+  assert(engine != nullptr);
+}
+
+MotiveHandlePool::~MotiveHandlePool() {
+  // A motivator's destructor removes it from its processor. Freed slots
+  // hold invalidated motivators, so destroying every slot is safe.
+  const uint32_t num_slots =
+      static_cast<uint32_t>(slabs_.size()) * kHandlesPerSlab;
+  for (uint32_t slot = 0; slot < num_slots; ++slot) {
+    Slot(slot)->~MotivatorNf();
+  }
+  for (size_t i = 0; i < slabs_.size(); ++i) {
+    MotiveFree(slabs_[i]);
+  }
+}
+
+MotiveHandle MotiveHandlePool::Create(const MotivatorInit& init,
+                                      MotiveDimension dimensions) {
+  if (free_slots_.empty()) AllocateSlab();
+
+  const uint32_t slot = free_slots_.back();
+  free_slots_.pop_back();
+  Slot(slot)->Initialize(init, engine_, dimensions);
+  ++num_live_;
+
+  // Slot + 1, so that the zero handle stays invalid.
+  return (static_cast<uint32_t>(generations_[slot]) << kSlotBits) |
+         (slot + 1);
+}
+
+void MotiveHandlePool::Destroy(MotiveHandle handle) {
+  MotivatorNf* motivator = Resolve(handle);
+  if (motivator == nullptr) return;
+
+  motivator->Invalidate();
+
+  // Bump the generation so copies of the destroyed handle go stale, then
+  // recycle the slot. The 8-bit generation wraps; see the class comment.
+  const uint32_t slot = (handle & kSlotMask) - 1;
+  ++generations_[slot];
+  free_slots_.push_back(slot);
+  --num_live_;
+}
+
+const MotivatorNf* MotiveHandlePool::Resolve(MotiveHandle handle) const {
+  if (handle == kMotiveHandleInvalid) return nullptr;
+  const uint32_t slot = (handle & kSlotMask) - 1;
+  if (slot >= generations_.size()) return nullptr;
+  if (generations_[slot] != static_cast<uint8_t>(handle >> kSlotBits)) {
+    return nullptr;
+  }
+  return Slot(slot);
+}
+
+MotivatorNf* MotiveHandlePool::Resolve(MotiveHandle handle) {
+  return const_cast<MotivatorNf*>(
+      static_cast<const MotiveHandlePool*>(this)->Resolve(handle));
+}
+
+void MotiveHandlePool::AllocateSlab() {
+  // Handles must still fit in kSlotBits after this slab is carved.
+  assert((slabs_.size() + 1) * kHandlesPerSlab < kSlotMask);
+
+  // One allocation--through the memory functions the user may have
+  // overridden with SetMemoryFunctions()--holds kHandlesPerSlab motivators,
+  // constructed in their reset state.
+  static const size_t kAlign = 16;
+  MotivatorNf* slab = static_cast<MotivatorNf*>(
+      MotiveAlloc(kHandlesPerSlab * sizeof(MotivatorNf), kAlign));
+  for (int i = 0; i < kHandlesPerSlab; ++i) {
+    new (slab + i) MotivatorNf();
+  }
+  slabs_.push_back(slab);
+  generations_.resize(slabs_.size() * kHandlesPerSlab, 0);
+
+  // Push the new slots in reverse, so the lowest slots are handed out
+  // first and live handles stay dense in the low slots.
+  const uint32_t base =
+      static_cast<uint32_t>(slabs_.size() - 1) * kHandlesPerSlab;
+  for (int i = kHandlesPerSlab - 1; i >= 0; --i) {
+    free_slots_.push_back(base + static_cast<uint32_t>(i));
+  }
+}
+
+}  // namespace motive
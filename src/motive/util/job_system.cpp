@@ -0,0 +1,85 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "motive/util/job_system.h"
+
+namespace motive {
+
+ThreadPoolJobSystem::ThreadPoolJobSystem(unsigned int num_threads)
+    : num_running_(0), quit_(false) {
+  if (num_threads == 0) {
+    num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0) num_threads = 1;
+  }
+  workers_.reserve(num_threads);
+  for (unsigned int i = 0; i < num_threads; ++i) {
+    workers_.push_back(std::thread(&ThreadPoolJobSystem::WorkerLoop, this));
+  }
+}
+
+ThreadPoolJobSystem::~ThreadPoolJobSystem() {
+  // Flush outstanding jobs so that no job data is left dangling.
+  WaitForAll();
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  jobs_available_.notify_all();
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i].join();
+  }
+}
+
+void ThreadPoolJobSystem::Submit(JobFn* job, void* data) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Job j = {job, data};
+    jobs_.push_back(j);
+  }
+  jobs_available_.notify_one();
+}
+
+void ThreadPoolJobSystem::WaitForAll() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!jobs_.empty() || num_running_ > 0) {
+    jobs_complete_.wait(lock);
+  }
+}
+
+void ThreadPoolJobSystem::WorkerLoop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    while (jobs_.empty() && !quit_) {
+      jobs_available_.wait(lock);
+    }
+    if (quit_) return;
+
+    // Pop from the back. Order between two WaitForAll() calls is unspecified.
+    const Job job = jobs_.back();
+    jobs_.pop_back();
+    ++num_running_;
+
+    lock.unlock();
+    job.fn(job.data);
+    lock.lock();
+
+    --num_running_;
+    if (jobs_.empty() && num_running_ == 0) {
+      jobs_complete_.notify_all();
+    }
+  }
+}
+
+}  // namespace motive
@@ -18,8 +18,45 @@
 #include <cpu-features.h>
 #endif  // defined(__ANDROID__)
 
+// Detect x86 outside of Android. On Android, cpu-features.h is authoritative.
+#if !defined(__ANDROID__) &&                                 \
+    (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+     defined(_M_IX86))
+#define MOTIVE_OPTIMIZATIONS_X86 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif  // defined(_MSC_VER)
+#endif
+
 namespace motive {
 
+#if defined(MOTIVE_OPTIMIZATIONS_X86) && defined(MOTIVE_AVX2)
+// Return true if both the CPU and the OS support AVX2 and FMA.
+static bool SupportsAvx2AndFma() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) return false;
+
+  __cpuid(info, 1);
+  const bool fma = (info[2] & (1 << 12)) != 0;
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  if (!fma || !osxsave) return false;
+
+  __cpuidex(info, 7, 0);
+  const bool avx2 = (info[1] & (1 << 5)) != 0;
+  if (!avx2) return false;
+
+  // The OS must save the ymm registers on context switch.
+  const unsigned long long xcr0 = _xgetbv(0);
+  return (xcr0 & 6) == 6;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#endif  // defined(_MSC_VER)
+}
+#endif  // defined(MOTIVE_OPTIMIZATIONS_X86) && defined(MOTIVE_AVX2)
+
 ProcessorOptimization BestProcessorOptimization() {
 // TODO: Add checks for other operating systems.
 #if defined(__ANDROID__)
@@ -33,11 +70,31 @@ ProcessorOptimization BestProcessorOptimization() {
       return features & ANDROID_CPU_X86_FEATURE_SSSE3 ? kSsse3Optimizations
                                                       : kSse3Optimizations;
 
+#if defined(ANDROID_CPU_FAMILY_ARM64)
+    case ANDROID_CPU_FAMILY_ARM64:
+      // NEON (here "Advanced SIMD") is architecturally guaranteed on AArch64.
+      return kNeonOptimizations;
+#endif  // defined(ANDROID_CPU_FAMILY_ARM64)
+
     default:
       break;
   }
 #endif  // defined(__ANDROID__)
 
+#if !defined(__ANDROID__) && (defined(__aarch64__) || defined(__ARM_NEON))
+  // NEON is architecturally guaranteed on AArch64, and 32-bit compilers only
+  // define __ARM_NEON when they may assume NEON support, so there is no
+  // runtime check to make.
+  return kNeonOptimizations;
+#endif  // !defined(__ANDROID__) && (defined(__aarch64__) || ...)
+
+#if defined(MOTIVE_OPTIMIZATIONS_X86)
+  // Only report AVX2 when the AVX2 kernels are actually in the build.
+#if defined(MOTIVE_AVX2)
+  if (SupportsAvx2AndFma()) return kAvx2Optimizations;
+#endif  // defined(MOTIVE_AVX2)
+#endif  // defined(MOTIVE_OPTIMIZATIONS_X86)
+
   return kNoOptimizations;
 }
 
@@ -0,0 +1,217 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <vector>
+
+#include "motive/vector_motivator.h"
+
+namespace motive {
+
+void MotivatorNf::SetTargetsBatch(MotivatorNf* const* motivators,
+                                  int num_motivators,
+                                  const MotiveTarget1f* targets) {
+  if (num_motivators <= 0) return;
+
+  // All the motivators must be driven by the one processor, analogous to
+  // Motivator::InitializeBatch() requiring one shared type.
+  MotiveProcessorNf& processor = motivators[0]->Processor();
+  const MotiveDimension dimensions = motivators[0]->Dimensions();
+
+  std::vector<MotiveIndex> indices(num_motivators);
+  for (int i = 0; i < num_motivators; ++i) {
+    assert(motivators[i]->processor_ == motivators[0]->processor_ &&
+           motivators[i]->Dimensions() == dimensions);
+    indices[i] = motivators[i]->index_;
+
+    if (detail::capture_active) {
+      detail::CaptureSetTargets(motivators[i], targets, dimensions);
+    }
+  }
+
+  processor.SetSharedTargets(&indices.front(), num_motivators, dimensions,
+                             targets);
+}
+
+void MotivatorValueView::Add(const MotivatorNf* motivator) {
+  assert(motivator != nullptr && motivator->Valid());
+  motivators_.push_back(motivator);
+  out_offsets_.push_back(num_values_);
+  const MotiveDimension dimensions = motivator->Dimensions();
+  dimensions_.push_back(dimensions);
+  num_values_ += dimensions;
+  grouped_ = false;
+}
+
+void MotivatorValueView::Clear() {
+  motivators_.clear();
+  out_offsets_.clear();
+  dimensions_.clear();
+  order_.clear();
+  groups_.clear();
+  num_values_ = 0;
+  grouped_ = false;
+}
+
+void MotivatorValueView::Rebuild() {
+  const int count = Count();
+  order_.resize(count);
+  for (int i = 0; i < count; ++i) {
+    order_[i] = i;
+  }
+
+  // Stable sort keeps registration order within each processor, so the
+  // scatter back into the output buffer walks it mostly forwards.
+  const std::vector<const MotivatorNf*>& motivators = motivators_;
+  std::stable_sort(order_.begin(), order_.end(), [&motivators](int a, int b) {
+    return motivators[a]->processor_ < motivators[b]->processor_;
+  });
+
+  // Record the run of slots belonging to each processor, and size the
+  // scratch buffers for the largest run.
+  groups_.clear();
+  int max_values = 0;
+  for (int i = 0; i < count;) {
+    Group group;
+    group.processor = static_cast<const MotiveProcessorNf*>(
+        motivators_[order_[i]]->processor_);
+    group.start = i;
+    int num_values = 0;
+    for (; i < count && motivators_[order_[i]]->processor_ == group.processor;
+         ++i) {
+      num_values += dimensions_[order_[i]];
+    }
+    group.count = i - group.start;
+    groups_.push_back(group);
+    max_values = std::max(max_values, num_values);
+  }
+  index_scratch_.resize(max_values);
+  value_scratch_.resize(max_values);
+
+  // Time gathers produce one entry per motivator, not per dimension, so the
+  // largest group's motivator count bounds the time scratches.
+  int max_motivators = 0;
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    max_motivators = std::max(max_motivators, groups_[g].count);
+  }
+  time_scratch_.resize(max_motivators);
+  end_time_scratch_.resize(max_motivators);
+  grouped_ = true;
+}
+
+// Returns false if the cached grouping is stale and must be rebuilt.
+bool MotivatorValueView::GatherOnce(float* out) {
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    const Group& group = groups_[g];
+
+    // Collect the current index of every dimension in this group. Indices
+    // move under defragmentation, so they're re-read on every gather.
+    MotiveIndex num_indices = 0;
+    for (int i = group.start; i < group.start + group.count; ++i) {
+      const int slot = order_[i];
+      const MotivatorNf* motivator = motivators_[slot];
+
+      // Re-initializing a motivator can move it to another processor, which
+      // makes the cached grouping stale.
+      if (motivator->processor_ != group.processor) return false;
+      assert(motivator->Dimensions() == dimensions_[slot]);
+
+      for (MotiveDimension d = 0; d < dimensions_[slot]; ++d) {
+        index_scratch_[num_indices++] = motivator->index_ + d;
+      }
+    }
+
+    // One virtual call gathers the whole group.
+    group.processor->GatherValues(index_scratch_.data(), num_indices,
+                                  value_scratch_.data());
+
+    // Scatter back into registration order.
+    MotiveIndex value = 0;
+    for (int i = group.start; i < group.start + group.count; ++i) {
+      const int slot = order_[i];
+      for (MotiveDimension d = 0; d < dimensions_[slot]; ++d) {
+        out[out_offsets_[slot] + d] = value_scratch_[value++];
+      }
+    }
+  }
+  return true;
+}
+
+void MotivatorValueView::Gather(float* out) {
+  if (!grouped_) Rebuild();
+  if (!GatherOnce(out)) {
+    // A registered motivator changed processors. Regroup and gather again;
+    // the grouping is now consistent.
+    Rebuild();
+    const bool gathered = GatherOnce(out);
+    (void)gathered;
+    assert(gathered);
+  }
+}
+
+// Returns false if the cached grouping is stale and must be rebuilt.
+bool MotivatorValueView::GatherTimesOnce(MotiveTime* spline_times,
+                                         MotiveTime* end_times, float* rates) {
+  for (size_t g = 0; g < groups_.size(); ++g) {
+    const Group& group = groups_[g];
+
+    // Collect one index per motivator--playback progress is shared by all
+    // of a motivator's dimensions. Indices move under defragmentation, so
+    // they're re-read on every gather.
+    MotiveIndex num_indices = 0;
+    for (int i = group.start; i < group.start + group.count; ++i) {
+      const MotivatorNf* motivator = motivators_[order_[i]];
+
+      // Re-initializing a motivator can move it to another processor, which
+      // makes the cached grouping stale.
+      if (motivator->processor_ != group.processor) return false;
+
+      index_scratch_[num_indices++] = motivator->index_;
+    }
+
+    // One virtual call gathers the whole group. Skip the fields the caller
+    // skipped; rates reuse the value scratch.
+    group.processor->GatherTimes(
+        index_scratch_.data(), num_indices,
+        spline_times != nullptr ? time_scratch_.data() : nullptr,
+        end_times != nullptr ? end_time_scratch_.data() : nullptr,
+        rates != nullptr ? value_scratch_.data() : nullptr);
+
+    // Scatter back into registration order.
+    MotiveIndex value = 0;
+    for (int i = group.start; i < group.start + group.count; ++i) {
+      const int slot = order_[i];
+      if (spline_times != nullptr) spline_times[slot] = time_scratch_[value];
+      if (end_times != nullptr) end_times[slot] = end_time_scratch_[value];
+      if (rates != nullptr) rates[slot] = value_scratch_[value];
+      ++value;
+    }
+  }
+  return true;
+}
+
+void MotivatorValueView::GatherTimes(MotiveTime* spline_times,
+                                     MotiveTime* end_times, float* rates) {
+  if (!grouped_) Rebuild();
+  if (!GatherTimesOnce(spline_times, end_times, rates)) {
+    // A registered motivator changed processors. Regroup and gather again;
+    // the grouping is now consistent.
+    Rebuild();
+    const bool gathered = GatherTimesOnce(spline_times, end_times, rates);
+    (void)gathered;
+    assert(gathered);
+  }
+}
+
+}  // namespace motive
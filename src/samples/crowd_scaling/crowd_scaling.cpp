@@ -0,0 +1,225 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Crowd scaling sample: how does AdvanceFrame() cost grow with motivator
+// count, and how well does it spread across cores?
+//
+// The other samples demonstrate the API on a handful of motivators; this one
+// spawns crowds from 1,000 up to 100,000 motivators--a mix of spline-driven
+// scalars and small skeletal rigs--and prints a scaling table:
+//
+//     motivators  threads  ms/frame  ns/motivator  efficiency  memory
+//
+// Use the table for capacity planning per release. The ns/motivator column
+// should stay flat as the crowd grows: an upward drift means per-index cost
+// is no longer O(n) and some processor has picked up super-linear work. The
+// efficiency column is the parallel speedup divided by the thread count;
+// values well below 1.0 show where the job-system split stops paying.
+//
+// Build with -Dmotive_enable_benchmarks=ON to also dump Motive's internal
+// per-subsystem histograms after the sweep.
+
+#include <stdio.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "motive/common.h"
+#include "motive/engine.h"
+#include "motive/math/angle.h"
+#include "motive/math/compact_spline.h"
+#include "motive/matrix_anim.h"
+#include "motive/matrix_init.h"
+#include "motive/rig_anim.h"
+#include "motive/rig_init.h"
+#include "motive/rig_motivator.h"
+#include "motive/spline_init.h"
+#include "motive/util/benchmark.h"
+#include "motive/util/job_system.h"
+#include "motive/vector_motivator.h"
+
+using motive::BoneIndex;
+using motive::CompactSpline;
+using motive::kAngleRange;
+using motive::kInvalidBoneIdx;
+using motive::kPi;
+using motive::kTwoPi;
+using motive::MatrixAnim;
+using motive::MotiveEngine;
+using motive::MotiveMemoryStats;
+using motive::MotiveTime;
+using motive::Motivator1f;
+using motive::Range;
+using motive::RigAnim;
+using motive::RigInit;
+using motive::RigMotivator;
+using motive::SplineInit;
+using motive::SplinePlayback;
+using motive::Target1f;
+using motive::ThreadPoolJobSystem;
+
+// Crowd sizes to sweep. Each size is measured serially and at every thread
+// count, so the table shows both axes of scaling.
+static const int kCrowdSizes[] = {1000, 3000, 10000, 30000, 100000};
+
+// One rig motivator is spawned per kMotivatorsPerRig motivators; the rest
+// are spline-driven scalars. Rigs are the expensive per-index work (matrix
+// composition, hierarchy walk); scalars are the bulk-evaluated cheap work.
+// Both need to scale.
+static const int kMotivatorsPerRig = 10;
+static const int kBonesPerRig = 8;
+
+// Frames advanced before timing starts, to spread the initial spline
+// evaluation and defragmentation out of the measurement, and frames timed.
+static const int kWarmupFrames = 10;
+static const int kTimedFrames = 60;
+static const MotiveTime kDeltaTime = 16;
+
+// One period of a sine wave. Every spline in the sample plays this,
+// repeating, so all motivators stay busy for the whole measurement.
+struct SplineNode {
+  float x;
+  float y;
+  float derivative;
+};
+static const SplineNode kSinWave[] = {{0.0f, 0.0f, 1.0f},
+                                      {0.5f * kPi, 1.0f, 0.0f},
+                                      {kPi, 0.0f, -1.0f},
+                                      {1.5f * kPi, -1.0f, 0.0f},
+                                      {kTwoPi, 0.0f, 1.0f}};
+static const float kSplinePeriod = 2000.0f;
+
+static void CreateSineSpline(CompactSpline* spline) {
+  const float x_scale = kSplinePeriod / kTwoPi;
+  spline->Init(Range(-1.0f, 1.0f),
+               CompactSpline::RecommendXGranularity(kSplinePeriod));
+  for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(kSinWave); ++i) {
+    const SplineNode& n = kSinWave[i];
+    spline->AddNode(n.x * x_scale, n.y, n.derivative / x_scale);
+  }
+}
+
+// A synthetic rig: a chain of kBonesPerRig bones, each rotating about Y on
+// the shared sine wave. Built in code so the sample needs no data files.
+static void CreateCrowdRigAnim(RigAnim* anim) {
+  anim->Init("crowd_rig", static_cast<BoneIndex>(kBonesPerRig), false);
+  for (int i = 0; i < kBonesPerRig; ++i) {
+    const BoneIndex bone = static_cast<BoneIndex>(i);
+    const BoneIndex parent =
+        i == 0 ? kInvalidBoneIdx : static_cast<BoneIndex>(i - 1);
+    MatrixAnim& m = anim->InitMatrixAnim(bone, parent, "");
+    MatrixAnim::Spline* splines = m.Construct(1);
+    splines[0].spline = CompactSpline::Create(CompactSpline::kDefaultMaxNodes);
+    CreateSineSpline(splines[0].spline);
+    splines[0].init = SplineInit(kAngleRange);
+    m.ops().emplace_back(motive::MatrixOpId(0), motive::kRotateAboutY,
+                         splines[0].init, *splines[0].spline);
+  }
+  anim->set_end_time(static_cast<MotiveTime>(kSplinePeriod));
+  anim->set_repeat(true);
+  anim->PackOps();
+}
+
+// One measured configuration: `num_motivators` total, advanced with
+// `num_threads` workers (0 = serial, no job system). Returns milliseconds
+// per frame, and the engine's memory stats in `memory`.
+static double MeasureCrowd(const RigAnim& anim, int num_motivators,
+                           unsigned int num_threads,
+                           MotiveMemoryStats* memory) {
+  MotiveEngine engine;
+  ThreadPoolJobSystem job_system(num_threads == 0 ? 1 : num_threads);
+  if (num_threads > 0) engine.SetJobSystem(&job_system);
+
+  // Spawn the crowd: one rig per kMotivatorsPerRig motivators, splines for
+  // the rest. Every spline motivator chases a repeating ease-in target.
+  const int num_rigs = num_motivators / kMotivatorsPerRig;
+  const int num_splines = num_motivators - num_rigs;
+  const RigInit rig_init(anim, anim.bone_parents(),
+                         static_cast<BoneIndex>(kBonesPerRig));
+  const SplineInit spline_init;
+  const SplinePlayback playback(0.0f, true);
+
+  std::vector<RigMotivator> rigs(num_rigs);
+  for (int i = 0; i < num_rigs; ++i) {
+    rigs[i].Initialize(rig_init, &engine);
+    rigs[i].BlendToAnim(anim, playback);
+  }
+  std::vector<Motivator1f> splines(num_splines);
+  for (int i = 0; i < num_splines; ++i) {
+    splines[i].Initialize(spline_init, &engine);
+    splines[i].SetTarget(
+        Target1f(static_cast<float>(i % 100), 0.0f,
+                 static_cast<MotiveTime>(kSplinePeriod)));
+  }
+
+  for (int frame = 0; frame < kWarmupFrames; ++frame) {
+    engine.AdvanceFrame(kDeltaTime);
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int frame = 0; frame < kTimedFrames; ++frame) {
+    engine.AdvanceFrame(kDeltaTime);
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  *memory = engine.MemoryStats();
+  const double total_ms =
+      std::chrono::duration<double, std::milli>(end - start).count();
+  return total_ms / kTimedFrames;
+}
+
+int main() {
+  motive::SplineInit::Register();
+  motive::MatrixInit::Register();
+  motive::RigInit::Register();
+  motive::InitBenchmarks(10);
+
+  RigAnim anim;
+  CreateCrowdRigAnim(&anim);
+
+  // Thread counts to sweep: serial, then powers of two up to the hardware.
+  std::vector<unsigned int> thread_counts;
+  thread_counts.push_back(0);
+  const unsigned int max_threads = std::thread::hardware_concurrency();
+  for (unsigned int t = 2; t <= max_threads; t *= 2) {
+    thread_counts.push_back(t);
+  }
+
+  printf("%10s  %7s  %9s  %12s  %10s  %10s\n", "motivators", "threads",
+         "ms/frame", "ns/motivator", "efficiency", "memory_kb");
+  for (size_t s = 0; s < MOTIVE_ARRAY_SIZE(kCrowdSizes); ++s) {
+    const int num_motivators = kCrowdSizes[s];
+    double serial_ms = 0.0;
+    for (size_t t = 0; t < thread_counts.size(); ++t) {
+      const unsigned int num_threads = thread_counts[t];
+      MotiveMemoryStats memory;
+      const double ms =
+          MeasureCrowd(anim, num_motivators, num_threads, &memory);
+      if (num_threads == 0) serial_ms = ms;
+
+      // Efficiency: parallel speedup over serial, per thread. 1.0 is
+      // perfect scaling; serial rows are 1.0 by definition.
+      const double efficiency =
+          num_threads == 0 ? 1.0 : serial_ms / (ms * num_threads);
+      const double ns_per_motivator = ms * 1e6 / num_motivators;
+      printf("%10d  %7u  %9.3f  %12.1f  %10.2f  %10zu\n", num_motivators,
+             num_threads == 0 ? 1u : num_threads, ms, ns_per_motivator,
+             efficiency, memory.allocated_bytes / 1024);
+    }
+  }
+
+  // Per-subsystem histograms, when built with motive_enable_benchmarks.
+  motive::OutputBenchmarks();
+  return 0;
+}
@@ -0,0 +1,459 @@
+// Copyright 2017 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Soak harness for long-running engine instances.
+//
+// Servers run one MotiveEngine for days, and their bugs look different from
+// a microbenchmark regression: throughput that drifts as index arrays
+// fragment, or memory that creeps when create/destroy churn defeats
+// amortization. This harness runs a sustained randomized
+// create/retarget/destroy workload across the processor types, samples
+// ns-per-motivator and the MotiveMemoryStats surface at a fixed period, and
+// exits non-zero when either drifts past a configurable fraction of its
+// post-warmup baseline.
+//
+// A sample must breach its threshold for several consecutive periods to
+// fail the run, so an OS scheduling hiccup doesn't fail an overnight soak.
+//
+// Typical overnight run:
+//     soak --seconds 28800 --motivators 8192 --seed 3
+// and a quick smoke run of the harness itself:
+//     soak --seconds 30
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "motive/common.h"
+#include "motive/engine.h"
+#include "motive/math/angle.h"
+#include "motive/math/compact_spline.h"
+#include "motive/matrix_anim.h"
+#include "motive/matrix_init.h"
+#include "motive/overshoot_init.h"
+#include "motive/rig_anim.h"
+#include "motive/rig_init.h"
+#include "motive/rig_motivator.h"
+#include "motive/spline_init.h"
+#include "motive/vector_motivator.h"
+
+using motive::BoneIndex;
+using motive::CompactSpline;
+using motive::kAngleRange;
+using motive::kInvalidBoneIdx;
+using motive::kPi;
+using motive::kTwoPi;
+using motive::MatrixAnim;
+using motive::MotiveEngine;
+using motive::MotiveMemoryStats;
+using motive::MotiveTime;
+using motive::Motivator1f;
+using motive::OvershootInit;
+using motive::Range;
+using motive::RigAnim;
+using motive::RigInit;
+using motive::RigMotivator;
+using motive::SplineInit;
+using motive::SplinePlayback;
+using motive::Target1f;
+
+// Simulation time advanced per frame. The workload runs flat out; this is
+// the delta handed to AdvanceFrame(), not a real-time pace.
+static const MotiveTime kDeltaTime = 10;
+
+// Time over which retargeted values are reached. Long enough that most
+// motivators are mid-flight--the expensive state--at any moment.
+static const MotiveTime kTargetTime = 1000;
+
+// Value range for the spline pool's targets.
+static const float kTargetRange = 100.0f;
+
+// Bones per soaked rig. Small, since the rig pool exists to churn the rig,
+// matrix, and spline processors together, not to be a skinning benchmark.
+static const int kBonesPerRig = 4;
+
+// Number of consecutive over-threshold samples required to fail the run.
+static const int kConsecutiveBreaches = 3;
+
+// Samples discarded before the baseline is recorded, while the pools reach
+// their steady-state high-water marks.
+static const int kWarmupSamples = 2;
+
+struct SoakOptions {
+  SoakOptions()
+      : seconds(60),
+        motivators(4096),
+        sample_seconds(10),
+        churn(0.02),
+        seed(1),
+        max_throughput_drift(0.25),
+        max_memory_growth(0.10) {}
+
+  int seconds;         // Total run time, wall clock.
+  int motivators;      // Live motivators, split evenly across the pools.
+  int sample_seconds;  // Period between samples.
+  double churn;        // Fraction of each pool destroyed and recreated, and
+                       // fraction retargeted, per frame.
+  unsigned int seed;   // Seed for the workload's random stream.
+  double max_throughput_drift;  // Allowed ns-per-motivator growth over
+                                // baseline, as a fraction.
+  double max_memory_growth;     // Allowed allocated-bytes growth over
+                                // baseline, as a fraction.
+};
+
+static void PrintUsage() {
+  printf(
+      "Usage: soak [options]\n"
+      "Sustained randomized create/retarget/destroy workload against one\n"
+      "MotiveEngine. Samples throughput and memory periodically; exits\n"
+      "non-zero when either drifts past its threshold for %d consecutive\n"
+      "samples.\n"
+      "Options:\n"
+      "  --seconds N                total run time (default 60)\n"
+      "  --motivators N             live motivators (default 4096)\n"
+      "  --sample_seconds N         seconds between samples (default 10)\n"
+      "  --churn F                  fraction of each pool replaced and\n"
+      "                             retargeted per frame (default 0.02)\n"
+      "  --seed N                   random seed (default 1)\n"
+      "  --max_throughput_drift F   allowed ns-per-motivator growth over\n"
+      "                             baseline (default 0.25)\n"
+      "  --max_memory_growth F      allowed allocated-bytes growth over\n"
+      "                             baseline (default 0.10)\n",
+      kConsecutiveBreaches);
+}
+
+static bool ParseOptions(int argc, char** argv, SoakOptions* options) {
+  for (int i = 1; i < argc; ++i) {
+    const char* arg = argv[i];
+    const bool has_value = i + 1 < argc;
+    if (strcmp(arg, "--seconds") == 0 && has_value) {
+      options->seconds = atoi(argv[++i]);
+    } else if (strcmp(arg, "--motivators") == 0 && has_value) {
+      options->motivators = atoi(argv[++i]);
+    } else if (strcmp(arg, "--sample_seconds") == 0 && has_value) {
+      options->sample_seconds = atoi(argv[++i]);
+    } else if (strcmp(arg, "--churn") == 0 && has_value) {
+      options->churn = atof(argv[++i]);
+    } else if (strcmp(arg, "--seed") == 0 && has_value) {
+      options->seed = static_cast<unsigned int>(atoi(argv[++i]));
+    } else if (strcmp(arg, "--max_throughput_drift") == 0 && has_value) {
+      options->max_throughput_drift = atof(argv[++i]);
+    } else if (strcmp(arg, "--max_memory_growth") == 0 && has_value) {
+      options->max_memory_growth = atof(argv[++i]);
+    } else {
+      PrintUsage();
+      return false;
+    }
+  }
+  return options->seconds > 0 && options->motivators > 0 &&
+         options->sample_seconds > 0 && options->churn >= 0.0;
+}
+
+struct SplineNode {
+  float x;
+  float y;
+  float derivative;
+};
+
+// One period of a sine wave, driving the soaked rigs' rotation channel.
+// Same construction as the benchmarker and microbench targets.
+static const SplineNode kSinWave[] = {{0.0f, 0.0f, 1.0f},
+                                      {0.5f * kPi, 1.0f, 0.0f},
+                                      {kPi, 0.0f, -1.0f},
+                                      {1.5f * kPi, -1.0f, 0.0f},
+                                      {kTwoPi, 0.0f, 1.0f}};
+
+static const float kSplinePeriod = 2000.0f;
+
+// Take an array of SplineNodes (x, y, derivative) values and scale them
+// to fill `spline`.
+static void CreateSpline(const SplineNode* nodes, size_t num_nodes,
+                         float x_scale, float y_scale, CompactSpline* spline) {
+  float min = std::numeric_limits<float>::infinity();
+  float max = -std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i < num_nodes; ++i) {
+    min = std::min(nodes[i].y, min);
+    max = std::max(nodes[i].y, max);
+  }
+
+  spline->Init(
+      Range(y_scale * min, y_scale * max),
+      CompactSpline::RecommendXGranularity(x_scale * nodes[num_nodes - 1].x));
+  for (size_t i = 0; i < num_nodes; ++i) {
+    const SplineNode& n = nodes[i];
+    spline->AddNode(n.x * x_scale, n.y * y_scale, n.derivative / x_scale);
+  }
+}
+
+// The soaked workload: three pools of motivators that together touch the
+// overshoot, spline, matrix, and rig processors. Each frame a random slice
+// of every pool is destroyed and recreated--exercising index allocation,
+// hole creation, and Defragment()--and another random slice is retargeted,
+// exercising target curve construction and the local-spline pools.
+class SoakWorkload {
+ public:
+  SoakWorkload(MotiveEngine* engine, int num_motivators, unsigned int seed)
+      : engine_(engine),
+        spline_init_(Range(-kTargetRange, kTargetRange)),
+        rng_(seed),
+        uniform_(0.0f, 1.0f) {
+    // Percent-style overshoot configuration, as in the unit tests.
+    overshoot_init_.set_modular(false);
+    overshoot_init_.set_range(Range(0.0f, kTargetRange));
+    overshoot_init_.set_max_velocity(10.0f);
+    overshoot_init_.set_max_delta(50.0f);
+    overshoot_init_.at_target().max_difference = 0.087f;
+    overshoot_init_.at_target().max_velocity = 0.00059f;
+    overshoot_init_.set_accel_per_difference(0.00032f);
+    overshoot_init_.set_wrong_direction_multiplier(4.0f);
+    overshoot_init_.set_max_delta_time(10);
+
+    CreateSoakRigAnim(&rig_anim_);
+    rig_init_ = new RigInit(rig_anim_, rig_anim_.bone_parents(),
+                            static_cast<BoneIndex>(kBonesPerRig));
+
+    // A rig costs roughly one motivator per bone, so size the rig pool to
+    // consume its third of the budget in bones.
+    const int num_per_pool = std::max(1, num_motivators / 3);
+    splines_.resize(num_per_pool);
+    overshoots_.resize(num_per_pool);
+    rigs_.resize(std::max(1, num_per_pool / kBonesPerRig));
+    for (size_t i = 0; i < splines_.size(); ++i) CreateSplineMotivator(i);
+    for (size_t i = 0; i < overshoots_.size(); ++i) CreateOvershoot(i);
+    for (size_t i = 0; i < rigs_.size(); ++i) CreateRig(i);
+  }
+
+  ~SoakWorkload() { delete rig_init_; }
+
+  // Destroy/recreate and retarget `churn` of each pool. Recreating through
+  // Initialize() invalidates any previous motivator in the slot first, so
+  // every recreation is one destroy plus one create.
+  void Churn(double churn) {
+    const int spline_events = NumChurnEvents(splines_.size(), churn);
+    for (int i = 0; i < spline_events; ++i) {
+      CreateSplineMotivator(RandomIndex(splines_.size()));
+      RetargetSpline(RandomIndex(splines_.size()));
+    }
+    const int overshoot_events = NumChurnEvents(overshoots_.size(), churn);
+    for (int i = 0; i < overshoot_events; ++i) {
+      CreateOvershoot(RandomIndex(overshoots_.size()));
+      RetargetOvershoot(RandomIndex(overshoots_.size()));
+    }
+    const int rig_events = NumChurnEvents(rigs_.size(), churn);
+    for (int i = 0; i < rig_events; ++i) {
+      CreateRig(RandomIndex(rigs_.size()));
+    }
+  }
+
+  // Live motivators, for normalizing throughput. Rigs count one per bone,
+  // since that is roughly what they cost to advance.
+  int NumMotivators() const {
+    return static_cast<int>(splines_.size() + overshoots_.size() +
+                            rigs_.size() * kBonesPerRig);
+  }
+
+ private:
+  // A chain of kBonesPerRig bones, each driven by one looping rotation
+  // spline. Same shape as the microbench rig, but fixed-size.
+  static void CreateSoakRigAnim(RigAnim* anim) {
+    anim->Init("soak_rig", static_cast<BoneIndex>(kBonesPerRig), false);
+    for (int i = 0; i < kBonesPerRig; ++i) {
+      const BoneIndex bone = static_cast<BoneIndex>(i);
+      const BoneIndex parent =
+          i == 0 ? kInvalidBoneIdx : static_cast<BoneIndex>(i - 1);
+      MatrixAnim& m = anim->InitMatrixAnim(bone, parent, "");
+      MatrixAnim::Spline* splines = m.Construct(1);
+      splines[0].spline =
+          CompactSpline::Create(CompactSpline::kDefaultMaxNodes);
+      CreateSpline(kSinWave, MOTIVE_ARRAY_SIZE(kSinWave), kSplinePeriod, 1.0f,
+                   splines[0].spline);
+      splines[0].init = SplineInit(kAngleRange);
+      m.ops().emplace_back(motive::MatrixOpId(0), motive::kRotateAboutY,
+                           splines[0].init, *splines[0].spline);
+    }
+    anim->set_end_time(static_cast<MotiveTime>(kSplinePeriod));
+    anim->set_repeat(true);
+    anim->PackOps();
+  }
+
+  void CreateSplineMotivator(size_t i) {
+    splines_[i].Initialize(spline_init_, engine_);
+    RetargetSpline(i);
+  }
+
+  void CreateOvershoot(size_t i) {
+    overshoots_[i].Initialize(overshoot_init_, engine_);
+    RetargetOvershoot(i);
+  }
+
+  void CreateRig(size_t i) {
+    rigs_[i].Initialize(*rig_init_, engine_);
+    // Start at a random phase so the rigs don't cross segment boundaries in
+    // lockstep.
+    const SplinePlayback playback(uniform_(rng_) * kSplinePeriod, true);
+    rigs_[i].BlendToAnim(rig_anim_, playback);
+  }
+
+  void RetargetSpline(size_t i) {
+    splines_[i].SetTarget(Target1f(RandomTarget(), 0.0f, kTargetTime));
+  }
+
+  void RetargetOvershoot(size_t i) {
+    // Overshoot targets live in the non-modular [0, kTargetRange) range.
+    // Overshoot motivators move at their own physics-driven pace, so the
+    // target time is nominal.
+    overshoots_[i].SetTarget(
+        Target1f(0.5f * (RandomTarget() + kTargetRange), 0.0f, 1));
+  }
+
+  static int NumChurnEvents(size_t pool_size, double churn) {
+    // At least one event per frame, so tiny pools still churn.
+    return std::max(1, static_cast<int>(pool_size * churn));
+  }
+
+  size_t RandomIndex(size_t size) {
+    return std::min(static_cast<size_t>(uniform_(rng_) * size), size - 1);
+  }
+
+  float RandomTarget() { return (2.0f * uniform_(rng_) - 1.0f) * kTargetRange; }
+
+  MotiveEngine* engine_;
+  OvershootInit overshoot_init_;
+  SplineInit spline_init_;
+  RigAnim rig_anim_;
+  RigInit* rig_init_;
+  std::mt19937 rng_;
+  std::uniform_real_distribution<float> uniform_;
+
+  std::vector<Motivator1f> splines_;
+  std::vector<Motivator1f> overshoots_;
+  std::vector<RigMotivator> rigs_;
+};
+
+int main(int argc, char** argv) {
+  SoakOptions options;
+  if (!ParseOptions(argc, argv, &options)) return 2;
+
+  // Register the processors the workload instantiates.
+  motive::OvershootInit::Register();
+  motive::SplineInit::Register();
+  motive::MatrixInit::Register();
+  motive::RigInit::Register();
+
+  MotiveEngine engine;
+  SoakWorkload workload(&engine, options.motivators, options.seed);
+
+  typedef std::chrono::steady_clock Clock;
+  const Clock::time_point start = Clock::now();
+  const Clock::duration run_time = std::chrono::seconds(options.seconds);
+  const Clock::duration sample_period =
+      std::chrono::seconds(options.sample_seconds);
+
+  // Per-sample accumulators. Only AdvanceFrame() is timed; the churn
+  // around it is workload generation, not engine throughput.
+  long long advance_ns = 0;
+  long long frames = 0;
+  int sample_index = 0;
+  int throughput_breaches = 0;
+  int memory_breaches = 0;
+  double baseline_ns_per_motivator = 0.0;
+  double baseline_allocated_bytes = 0.0;
+  bool failed = false;
+
+  Clock::time_point next_sample = start + sample_period;
+  for (;;) {
+    const Clock::time_point frame_start = Clock::now();
+    if (frame_start - start >= run_time) break;
+
+    engine.AdvanceFrame(kDeltaTime);
+    advance_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      Clock::now() - frame_start)
+                      .count();
+    ++frames;
+
+    workload.Churn(options.churn);
+
+    if (Clock::now() < next_sample) continue;
+    next_sample += sample_period;
+
+    // Sample: throughput since the last sample, and current memory stats.
+    const double ns_per_motivator =
+        static_cast<double>(advance_ns) /
+        (static_cast<double>(frames) * workload.NumMotivators());
+    advance_ns = 0;
+    frames = 0;
+    const MotiveMemoryStats stats = engine.MemoryStats();
+    const long long elapsed_s = static_cast<long long>(
+        std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - start)
+            .count());
+    printf(
+        "[soak] t=%llds ns/motivator=%.1f allocated=%lu live=%lu "
+        "indices=%d holes=%d\n",
+        elapsed_s, ns_per_motivator,
+        static_cast<unsigned long>(stats.allocated_bytes),
+        static_cast<unsigned long>(stats.live_bytes),
+        static_cast<int>(stats.num_indices), static_cast<int>(stats.num_holes));
+    fflush(stdout);
+
+    ++sample_index;
+    if (sample_index < kWarmupSamples + 1) continue;
+    if (sample_index == kWarmupSamples + 1) {
+      // First post-warmup sample is the baseline for both drifts.
+      baseline_ns_per_motivator = ns_per_motivator;
+      baseline_allocated_bytes = static_cast<double>(stats.allocated_bytes);
+      continue;
+    }
+
+    // Track consecutive breaches: a lone spike is an OS hiccup, a run of
+    // them is drift.
+    const bool throughput_bad =
+        ns_per_motivator >
+        baseline_ns_per_motivator * (1.0 + options.max_throughput_drift);
+    const bool memory_bad =
+        static_cast<double>(stats.allocated_bytes) >
+        baseline_allocated_bytes * (1.0 + options.max_memory_growth);
+    throughput_breaches = throughput_bad ? throughput_breaches + 1 : 0;
+    memory_breaches = memory_bad ? memory_breaches + 1 : 0;
+    if (throughput_breaches >= kConsecutiveBreaches) {
+      printf(
+          "[soak] FAIL: ns/motivator %.1f drifted past baseline %.1f "
+          "(+%.0f%% allowed) for %d samples\n",
+          ns_per_motivator, baseline_ns_per_motivator,
+          options.max_throughput_drift * 100.0, throughput_breaches);
+      failed = true;
+      break;
+    }
+    if (memory_breaches >= kConsecutiveBreaches) {
+      printf(
+          "[soak] FAIL: allocated bytes %lu grew past baseline %.0f "
+          "(+%.0f%% allowed) for %d samples\n",
+          static_cast<unsigned long>(stats.allocated_bytes),
+          baseline_allocated_bytes, options.max_memory_growth * 100.0,
+          memory_breaches);
+      failed = true;
+      break;
+    }
+  }
+
+  if (!failed) {
+    printf("[soak] PASS: no sustained drift over %d seconds\n",
+           options.seconds);
+  }
+  return failed ? 1 : 0;
+}
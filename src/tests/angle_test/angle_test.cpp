@@ -173,6 +173,29 @@ TEST_F(AngleTests, WrapAngleTest) {
   EXPECT_TRUE(Angle::IsAngleInRange(a6));
 }
 
+// Batch wrapping should produce the same values as wrapping one at a time.
+TEST_F(AngleTests, WrapAnglesMatchesWrapAngle) {
+  static const int kNumAngles = 100;
+  float in[kNumAngles];
+  float out[kNumAngles];
+  for (int i = 0; i < kNumAngles; ++i) {
+    // Sweep from below -2pi to above 2pi.
+    in[i] = -2.5f * kTwoPi + i * (5.0f * kTwoPi / kNumAngles);
+  }
+
+  Angle::WrapAngles(in, kNumAngles, out);
+  for (int i = 0; i < kNumAngles; ++i) {
+    EXPECT_TRUE(Angle::IsAngleInRange(out[i]));
+    EXPECT_FLOAT_EQ(out[i], Angle::WrapAngle(in[i]));
+  }
+
+  // Wrapping in place should work too.
+  Angle::WrapAngles(in, kNumAngles, in);
+  for (int i = 0; i < kNumAngles; ++i) {
+    EXPECT_FLOAT_EQ(in[i], out[i]);
+  }
+}
+
 // Clamping a value that's inside the range should not change the value.
 TEST_F(AngleTests, ClampInside) {
   const Angle a(kHalfPi + 0.1f);
@@ -26,6 +26,7 @@
 #include "motive/matrix_init.h"
 #include "motive/matrix_motivator.h"
 #include "motive/matrix_op.h"
+#include "motive/oscillator_init.h"
 #include "motive/spline_init.h"
 
 #define DEBUG_PRINT_MATRICES 0
@@ -488,6 +489,32 @@ TEST_F(MotiveTests, EaseInEaseOut3DMultiMotivators) {
                                    0.60f, 1, this);
 }
 
+// An oscillator with no noise is a plain sine wave: check the peak and
+// trough of one cycle. Values use a fast sine approximation, so the
+// tolerance is a fraction of the amplitude.
+TEST_F(MotiveTests, OscillatorSineWave) {
+  static const float kCenter = 10.0f;
+  static const float kAmplitude = 2.0f;
+  static const float kFrequency = motive::kTwoPi / 1000.0f;  // Cycle per 1000.
+
+  motive::OscillatorInit::Register();
+  const motive::OscillatorInit init(&kCenter, &kAmplitude, &kFrequency);
+  Motivator1f motivator(init, &engine());
+  EXPECT_NEAR(motivator.Value(), kCenter, kAmplitude * 0.01f);
+
+  // A quarter cycle reaches the peak, where the velocity is ~zero.
+  for (int i = 0; i < 250; ++i) engine().AdvanceFrame(1);
+  EXPECT_NEAR(motivator.Value(), kCenter + kAmplitude, kAmplitude * 0.01f);
+  EXPECT_NEAR(motivator.Velocity(), 0.0f, kAmplitude * kFrequency * 0.05f);
+
+  // Half a cycle later it reaches the trough.
+  for (int i = 0; i < 500; ++i) engine().AdvanceFrame(1);
+  EXPECT_NEAR(motivator.Value(), kCenter - kAmplitude, kAmplitude * 0.01f);
+
+  // The oscillation is centered on the target value it reports.
+  EXPECT_EQ(motivator.TargetValue(), kCenter);
+}
+
 // Ensure we wrap around from pi to -pi.
 template <class MotivatorT>
 void ModularMovement(MotiveTests& t) {
@@ -790,10 +817,10 @@ static mat4 CreateMatrixFromOp(const MatrixOperationInit& op_init) {
 
 // Return the product of the matrices for each operation in 'matrix_init'.
 static mat4 CreateMatrixFromOps(const MatrixInit& matrix_init) {
-  const std::vector<MatrixOperationInit>& ops = matrix_init.ops();
+  const motive::MatrixOperationInit* ops = matrix_init.ops();
 
   mat4 m = mat4::Identity();
-  for (size_t i = 0; i < ops.size(); ++i) {
+  for (int i = 0; i < matrix_init.num_ops(); ++i) {
     m *= CreateMatrixFromOp(ops[i]);
   }
   return m;
@@ -942,6 +969,37 @@ TEST_F(MotiveTests, MatrixTranslateRotateScaleGoneWild) {
   TestMatrixMotivator(MatrixInit(ops), &engine_);
 }
 
+// The same op series evaluated through inline spline channels should produce
+// the same matrix as child motivators.
+TEST_F(MotiveTests, MatrixTranslateRotateScaleInlineSplines) {
+  std::vector<MatrixOperationInit> ops;
+  ops.emplace_back(0, motive::kTranslateY, spline_scalar_init, 1.0f);
+  ops.emplace_back(0, motive::kRotateAboutX, spline_angle_init_, kHalfPi);
+  ops.emplace_back(0, motive::kScaleZ, spline_scalar_init, -1.4f);
+  MatrixInit init(ops);
+  init.set_inline_splines(true);
+  TestMatrixMotivator(init, &engine_);
+}
+
+// A spline-driven op evaluated inline should match the same op driven by a
+// child motivator, frame for frame.
+TEST_F(MotiveTests, MatrixInlineSplineMatchesChildMotivator) {
+  const motive::CompactSpline* spline = simple_splines(1);
+  std::vector<MatrixOperationInit> ops;
+  ops.emplace_back(0, motive::kTranslateX, spline_scalar_init, *spline);
+
+  MatrixInit inline_init(ops);
+  inline_init.set_inline_splines(true);
+  MatrixMotivator4f inline_motivator(inline_init, &engine_);
+  MatrixMotivator4f child_motivator(MatrixInit(ops), &engine_);
+
+  for (int i = 0; i < 10; ++i) {
+    engine_.AdvanceFrame(kTimePerFrame);
+    ExpectMatricesEqual(inline_motivator.Value(), child_motivator.Value(),
+                        kMatrixEpsilon);
+  }
+}
+
 // Test the MotivatorVector::SplineTime() function.
 template <class MotivatorT>
 void SplineTime(MotiveTests& t) {
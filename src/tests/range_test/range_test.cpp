@@ -137,6 +137,27 @@ TEST_F(RangeTests, Clamp_BeforeEnd) {
   EXPECT_EQ(-2.0f, r.ClampBeforeEnd(-2.0f));
 }
 
+// The batch clamp should match the scalar clamp, element for element.
+TEST_F(RangeTests, Clamp_Batch) {
+  const Range zero_one(0.0f, 1.0f);
+  const float values[] = {-1.0f, 0.0f, 0.5f, 1.0f, 1.0000001f, kInf, -kInf};
+  float out[MOTIVE_ARRAY_SIZE(values)];
+  zero_one.Clamp(values, MOTIVE_ARRAY_SIZE(values), out);
+  for (size_t i = 0; i < MOTIVE_ARRAY_SIZE(values); ++i) {
+    EXPECT_EQ(zero_one.Clamp(values[i]), out[i]);
+  }
+}
+
+// The batch clamp should support clamping in place.
+TEST_F(RangeTests, Clamp_BatchInPlace) {
+  const Range zero_one(0.0f, 1.0f);
+  float values[] = {-1.0f, 0.5f, 2.0f};
+  zero_one.Clamp(values, MOTIVE_ARRAY_SIZE(values), values);
+  EXPECT_EQ(0.0f, values[0]);
+  EXPECT_EQ(0.5f, values[1]);
+  EXPECT_EQ(1.0f, values[2]);
+}
+
 // Distance from the range should be zero for elements inside the range.
 TEST_F(RangeTests, DistanceFrom_Inside) {
   const Range zero_one(0.0f, 1.0f);
@@ -285,6 +306,14 @@ static float NormalizeClose(const Range& r, float x) {
   return r.NormalizeCloseValue(x);
 }
 
+// Run the batch normalization through the scalar test suites, one value at
+// a time, to verify it matches NormalizeCloseValue() everywhere.
+static float NormalizeCloseBatch(const Range& r, float x) {
+  float out = 0.0f;
+  r.NormalizeCloseValues(&x, 1, &out);
+  return out;
+}
+
 void TestNormalize_Inside(NormalizeFn* fn) {
   const Range a(-kPi, kPi);
   const Range zero_one(0.0f, 1.0f);
@@ -362,6 +391,33 @@ TEST_F(RangeTests, NormalizeClose_Distant) {
   TestNormalize_Distant(NormalizeClose);
 }
 
+TEST_F(RangeTests, NormalizeCloseValues_Inside) {
+  TestNormalize_Inside(NormalizeCloseBatch);
+}
+TEST_F(RangeTests, NormalizeCloseValues_Border) {
+  TestNormalize_Border(NormalizeCloseBatch);
+}
+TEST_F(RangeTests, NormalizeCloseValues_JustOutside) {
+  TestNormalize_JustOutside(NormalizeCloseBatch);
+}
+TEST_F(RangeTests, NormalizeCloseValues_FartherOutside) {
+  TestNormalize_FartherOutside(NormalizeCloseBatch);
+}
+TEST_F(RangeTests, NormalizeCloseValues_Distant) {
+  TestNormalize_Distant(NormalizeCloseBatch);
+}
+
+// The batch normalization should support normalizing in place.
+TEST_F(RangeTests, NormalizeCloseValues_InPlace) {
+  const Range zero_one(0.0f, 1.0f);
+  float values[] = {-0.5f, 0.5f, 1.5f, 3.5f};
+  zero_one.NormalizeCloseValues(values, MOTIVE_ARRAY_SIZE(values), values);
+  EXPECT_NEAR(0.5f, values[0], kZeroOneEpsilon);
+  EXPECT_NEAR(0.5f, values[1], kZeroOneEpsilon);
+  EXPECT_NEAR(0.5f, values[2], kZeroOneEpsilon);
+  EXPECT_NEAR(0.5f, values[3], kZeroOneEpsilon);
+}
+
 TEST_F(RangeTests, Covers) {
   const float a[] = {1.0f, -3.0f, 2.0f, 5.0f, 0.0f, 6.0f};
   const Range covers = Range::Covers(a, MOTIVE_ARRAY_SIZE(a));
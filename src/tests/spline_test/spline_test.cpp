@@ -17,6 +17,7 @@
 #include "motive/math/angle.h"
 #include "motive/math/bulk_spline_evaluator.h"
 #include "motive/math/compact_spline.h"
+#include "motive/math/spline_util.h"
 
 using motive::QuadraticCurve;
 using motive::CubicCurve;
@@ -480,6 +481,67 @@ static void CheckUncompressedNodes(const CompactSpline& spline,
   }
 }
 
+// In-place node edits should keep the node list ordered, and reject edits
+// that would reorder it.
+TEST_F(SplineTests, NodeEditing) {
+  const CompactSplineIndex num_nodes = short_spline_.num_nodes();
+
+  // Replace the middle node and verify the new values read back.
+  EXPECT_TRUE(short_spline_.ReplaceNode(2, 5.0f, 0.3f, 0.0f));
+  EXPECT_EQ(num_nodes, short_spline_.num_nodes());
+  EXPECT_NEAR(5.0f, short_spline_.NodeX(2), 0.01f);
+  EXPECT_NEAR(0.3f, short_spline_.NodeY(2), 0.01f);
+
+  // A replacement that would reorder the nodes is rejected unchanged.
+  EXPECT_FALSE(short_spline_.ReplaceNode(2, 0.5f, 0.3f, 0.0f));
+  EXPECT_NEAR(5.0f, short_spline_.NodeX(2), 0.01f);
+
+  // Insert a node between the middle nodes, then remove it again.
+  EXPECT_TRUE(short_spline_.InsertNode(3, 20.0f, 0.5f, 0.0f));
+  EXPECT_EQ(num_nodes + 1, short_spline_.num_nodes());
+  EXPECT_NEAR(20.0f, short_spline_.NodeX(3), 0.01f);
+  EXPECT_NEAR(40.0f, short_spline_.NodeX(4), 0.01f);
+  short_spline_.RemoveNode(3);
+  EXPECT_EQ(num_nodes, short_spline_.num_nodes());
+  EXPECT_NEAR(40.0f, short_spline_.NodeX(3), 0.01f);
+
+  // An insertion whose x lies past the following node is rejected.
+  EXPECT_FALSE(short_spline_.InsertNode(3, 200.0f, 0.5f, 0.0f));
+  EXPECT_EQ(num_nodes, short_spline_.num_nodes());
+}
+
+// FutureYs() should predict exactly what AdvanceFrame() will produce,
+// including across node boundaries and loop wraparound, without mutating
+// the evaluator.
+TEST_F(SplineTests, FutureYs) {
+  static const float kLookahead = 30.0f;
+  const motive::SplinePlayback playback(0.0f, true);
+
+  BulkSplineEvaluator predicted;
+  predicted.SetNumIndices(1);
+  predicted.SetSplines(0, 1, &short_spline_, playback);
+
+  BulkSplineEvaluator advanced;
+  advanced.SetNumIndices(1);
+  advanced.SetSplines(0, 1, &short_spline_, playback);
+
+  for (int step = 0; step < 10; ++step) {
+    float future_y = 0.0f;
+    float future_derivative = 0.0f;
+    const float x_before = predicted.X(0);
+    predicted.FutureYs(0, 1, &kLookahead, &future_y, &future_derivative);
+
+    advanced.AdvanceFrame(kLookahead);
+    EXPECT_NEAR(future_y, advanced.Y(0), 1e-5f);
+    EXPECT_NEAR(future_derivative, advanced.Derivative(0), 1e-5f);
+
+    // The query must not move the queried evaluator.
+    EXPECT_EQ(x_before, predicted.X(0));
+
+    predicted.AdvanceFrame(kLookahead);
+  }
+}
+
 // Uncompressed nodes should be evaluated pretty much unchanged.
 TEST_F(SplineTests, InitFromUncompressedNodes) {
   CompactSpline* spline = CompactSpline::CreateFromNodes(
@@ -557,6 +619,100 @@ TEST_F(SplineTests, YScaleAndOffset) {
   }
 }
 
+// Parameters for the runtime fitting tests: a smooth curve sampled finely
+// enough that the fitter should discard most samples.
+static const int kFitNumSamples = 101;
+static const float kFitDeltaX = 0.1f;
+static const float kFitTolerance = 0.02f;
+
+static float FitSampleY(float x) { return sinf(x) + 0.1f * x; }
+static float FitSampleDerivative(float x) { return cosf(x) + 0.1f; }
+
+static void GatherFitSamples(float* xs, float* ys, float* derivatives) {
+  for (int i = 0; i < kFitNumSamples; ++i) {
+    xs[i] = i * kFitDeltaX;
+    ys[i] = FitSampleY(xs[i]);
+    derivatives[i] = FitSampleDerivative(xs[i]);
+  }
+}
+
+// Verify `spline` stays within `tolerance` of every sample.
+static void CheckFitAgainstSamples(const CompactSpline& spline,
+                                   const float* xs, const float* ys,
+                                   int num_samples, float tolerance) {
+  BulkSplineEvaluator evaluator;
+  evaluator.SetNumIndices(1);
+  evaluator.SetSplines(0, 1, &spline, motive::SplinePlayback());
+  for (int i = 0; i < num_samples; ++i) {
+    evaluator.SetXs(0, 1, xs[i]);
+    EXPECT_NEAR(ys[i], evaluator.Y(0), tolerance);
+  }
+}
+
+TEST_F(SplineTests, FitCompactSplineWithinTolerance) {
+  float xs[kFitNumSamples];
+  float ys[kFitNumSamples];
+  float derivatives[kFitNumSamples];
+  GatherFitSamples(xs, ys, derivatives);
+
+  CompactSpline* spline = motive::FitCompactSpline(
+      xs, ys, derivatives, kFitNumSamples, kFitTolerance);
+
+  // The fitter should discard most of the densely-spaced samples.
+  EXPECT_LT(spline->num_nodes(), kFitNumSamples / 2);
+
+  // Allow a little extra for compression error on top of the fit tolerance.
+  CheckFitAgainstSamples(*spline, xs, ys, kFitNumSamples,
+                         2.0f * kFitTolerance);
+  CompactSpline::Destroy(spline);
+}
+
+TEST_F(SplineTests, FitCompactSplineEstimatedDerivatives) {
+  float xs[kFitNumSamples];
+  float ys[kFitNumSamples];
+  float derivatives[kFitNumSamples];
+  GatherFitSamples(xs, ys, derivatives);
+
+  // Fitting without derivatives estimates them from the samples, which is
+  // less exact, so only the tolerance guarantee is checked.
+  CompactSpline* spline =
+      motive::FitCompactSpline(xs, ys, nullptr, kFitNumSamples, kFitTolerance);
+  CheckFitAgainstSamples(*spline, xs, ys, kFitNumSamples,
+                         2.0f * kFitTolerance);
+  CompactSpline::Destroy(spline);
+}
+
+TEST_F(SplineTests, FitCompactSplinesBatched) {
+  static const int kFitNumChannels = 3;
+  float xs[kFitNumSamples];
+  float ys[kFitNumChannels * kFitNumSamples];
+  float derivatives[kFitNumChannels * kFitNumSamples];
+  GatherFitSamples(xs, ys, derivatives);
+
+  // Give each channel a different scale of the same curve.
+  for (int c = 1; c < kFitNumChannels; ++c) {
+    const float scale = 1.0f + c;
+    for (int i = 0; i < kFitNumSamples; ++i) {
+      ys[c * kFitNumSamples + i] = scale * ys[i];
+      derivatives[c * kFitNumSamples + i] = scale * derivatives[i];
+    }
+  }
+
+  std::vector<uint8_t> buffer(
+      motive::FitCompactSplinesBufferSize(kFitNumSamples, kFitNumChannels));
+  CompactSpline* splines[kFitNumChannels];
+  const size_t bytes_consumed = motive::FitCompactSplines(
+      xs, kFitNumSamples, kFitNumChannels, ys, derivatives, kFitTolerance,
+      &buffer.front(), buffer.size(), splines);
+
+  EXPECT_GT(bytes_consumed, 0u);
+  EXPECT_LE(bytes_consumed, buffer.size());
+  for (int c = 0; c < kFitNumChannels; ++c) {
+    CheckFitAgainstSamples(*splines[c], xs, ys + c * kFitNumSamples,
+                           kFitNumSamples, 2.0f * kFitTolerance);
+  }
+}
+
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
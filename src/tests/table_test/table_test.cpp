@@ -12,6 +12,8 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <map>
+
 #include "anim_generated.h"
 #include "anim_table_generated.h"
 #include "gtest/gtest.h"
@@ -50,10 +52,24 @@ static bool ValidTestName(const char* name) {
 
 static flatbuffers::Offset<motive::RigAnimFb> CreateRigAnimFbOffset(
     flatbuffers::FlatBufferBuilder& fbb, const std::string& name) {
-  return ValidTestName(name.c_str())
-             ? motive::CreateRigAnimFb(fbb, 0, 0, 0, false,
-                                       fbb.CreateString(name))
-             : 0;
+  if (!ValidTestName(name.c_str())) return 0;
+
+  // Give each payload one constant op whose value is the character after
+  // "valid", so that valid1 and valid2 have different content. Without
+  // this, content-hash deduplication would collapse every mock animation
+  // into one shared RigAnim. Names sharing that character--valid1 and
+  // valid1copy--produce byte-identical payloads under different names,
+  // which the table does share; see ListContentDuplicate.
+  auto value = motive::CreateConstantOpFb(fbb, static_cast<float>(name[5]));
+  std::vector<flatbuffers::Offset<motive::MatrixOpFb>> ops;
+  ops.push_back(motive::CreateMatrixOpFb(
+      fbb, 0, motive::MatrixOperationTypeFb_kTranslateX,
+      motive::MatrixOpValueFb_ConstantOpFb, value.Union()));
+  std::vector<flatbuffers::Offset<motive::MatrixAnimFb>> anims;
+  anims.push_back(motive::CreateMatrixAnimFbDirect(fbb, &ops));
+  std::vector<uint8_t> parents(1, motive::kInvalidBoneIdx);
+  return motive::CreateRigAnimFbDirect(fbb, &anims, &parents, nullptr, false,
+                                       name.c_str());
 }
 
 static const char* RigAnimFbLoadFn(const char* file_name,
@@ -206,6 +222,106 @@ void ListConsecutiveDuplicates(AnimTableInitMethod method) {
 }
 TEST_ALL_INIT_METHODS(ListConsecutiveDuplicates)
 
+void ListContentDuplicate(AnimTableInitMethod method) {
+  // Different names, but byte-identical payloads (see
+  // CreateRigAnimFbOffset); both resolve to one shared RigAnim.
+  AnimTable::ListFileNames names;
+  names.push_back("valid1.motiveanim");
+  names.push_back("valid1copy.motiveanim");
+  names.push_back("valid2.motiveanim");
+
+  AnimTable table;
+  EXPECT_TRUE(InitFromList(names, method, &table));
+  EXPECT_EQ(table.NumObjects(), 1);
+  EXPECT_EQ(table.NumAnims(0), 3);
+  EXPECT_EQ(table.NumUniqueAnims(), 2);
+  EXPECT_EQ(table.Query(0, 0), table.Query(0, 1));
+  EXPECT_NE(table.Query(0, 0), table.Query(0, 2));
+
+  // Both names remain queryable, landing on the shared animation.
+  EXPECT_EQ(table.QueryByName("valid1.motiveanim"),
+            table.QueryByName("valid1copy.motiveanim"));
+}
+TEST_ALL_INIT_METHODS(ListContentDuplicate)
+
+void ListStrippedNames(AnimTableInitMethod method) {
+  AnimTable::ListFileNames names;
+  names.push_back("valid1.motiveanim");
+  names.push_back("valid2.motiveanim");
+
+  AnimTable table;
+  table.SetStripDebugNames(true);
+  EXPECT_TRUE(InitFromList(names, method, &table));
+  EXPECT_EQ(table.NumObjects(), 1);
+  EXPECT_EQ(table.NumUniqueAnims(), 2);
+
+  // By-name queries still resolve, through the hash index.
+  const motive::RigAnim* anim = table.QueryByName("valid1.motiveanim");
+  EXPECT_NE(anim, nullptr);
+  EXPECT_EQ(anim, table.Query(0, 0));
+  EXPECT_EQ(table.QueryByName("missing.motiveanim"), nullptr);
+
+  // The debug strings were not materialized.
+  EXPECT_TRUE(anim->anim_name().empty());
+}
+TEST_ALL_INIT_METHODS(ListStrippedNames)
+
+// In-memory baked-anim cache backing the callbacks below.
+static std::map<std::string, std::string> g_baked_cache;
+static int g_file_loads = 0;
+
+static bool BakedCacheReadFn(const char* file_name, std::string* out_buf) {
+  const auto it = g_baked_cache.find(file_name);
+  if (it == g_baked_cache.end()) return false;
+  *out_buf = it->second;
+  return true;
+}
+
+static void BakedCacheWriteFn(const char* file_name, const void* bytes,
+                              size_t num_bytes) {
+  g_baked_cache[file_name].assign(static_cast<const char*>(bytes), num_bytes);
+}
+
+static const char* CountingLoadFn(const char* file_name,
+                                  std::string* scratch_buf) {
+  ++g_file_loads;
+  return RigAnimFbLoadFn(file_name, scratch_buf);
+}
+
+TEST_F(TableTests, ListBakedCache) {
+  g_baked_cache.clear();
+  g_file_loads = 0;
+
+  AnimTable::ListFileNames names;
+  names.push_back("valid1.motiveanim");
+  names.push_back("valid2.motiveanim");
+
+  // Cold run: every animation is loaded, converted, and baked.
+  AnimTable cold;
+  cold.SetBakedAnimCache(BakedCacheReadFn, BakedCacheWriteFn, 7);
+  EXPECT_TRUE(cold.InitFromAnimFileNames(names, CountingLoadFn));
+  EXPECT_EQ(g_file_loads, 2);
+  EXPECT_EQ(g_baked_cache.size(), 2u);
+
+  // Warm run: every animation comes from the cache; no file is loaded, and
+  // the rebuilt animation's playback content matches the converted one.
+  AnimTable warm;
+  warm.SetBakedAnimCache(BakedCacheReadFn, BakedCacheWriteFn, 7);
+  EXPECT_TRUE(warm.InitFromAnimFileNames(names, CountingLoadFn));
+  EXPECT_EQ(g_file_loads, 2);
+  EXPECT_EQ(warm.NumUniqueAnims(), 2);
+  EXPECT_EQ(warm.Query(0, 0)->ContentHash(), cold.Query(0, 0)->ContentHash());
+  EXPECT_EQ(warm.Query(0, 1)->ContentHash(), cold.Query(0, 1)->ContentHash());
+
+  // A new build id invalidates the cache: the table falls back to
+  // conversion and re-bakes.
+  AnimTable stale;
+  stale.SetBakedAnimCache(BakedCacheReadFn, BakedCacheWriteFn, 8);
+  EXPECT_TRUE(stale.InitFromAnimFileNames(names, CountingLoadFn));
+  EXPECT_EQ(g_file_loads, 4);
+  EXPECT_EQ(stale.NumUniqueAnims(), 2);
+}
+
 void ListSingleInvalid(AnimTableInitMethod method) {
   AnimTable::ListFileNames names;
   names.push_back("valid1.motiveanim");
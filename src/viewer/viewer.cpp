@@ -13,7 +13,9 @@
 // limitations under the License.
 
 #include <cassert>
+#include <chrono>
 #include <cstdlib>
+#include <thread>
 #include "anim_generated.h"
 #include "fplbase/asset_manager.h"
 #include "fplbase/input.h"
@@ -475,6 +477,41 @@ static float AspectRatio(const fplbase::Renderer& renderer) {
          renderer.window_size().y;
 }
 
+// Per-stage frame costs, accumulated between reports so the averages are
+// stable enough to read. Times are in milliseconds.
+struct StageTimings {
+  StageTimings()
+      : advance_ms(0.0), palette_ms(0.0), upload_ms(0.0), frames(0) {}
+
+  double advance_ms;  // MotiveEngine::AdvanceFrame().
+  double palette_ms;  // Bone palette build from GlobalTransforms().
+  double upload_ms;   // Palette upload and draw.
+  int frames;
+};
+
+typedef std::chrono::steady_clock TimingClock;
+
+static double MillisecondsSince(const TimingClock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(TimingClock::now() - start)
+      .count();
+}
+
+// Print a rolling average of the per-stage costs roughly once a second, so
+// the viewer doubles as a performance test bed: change an animation or a
+// processor and watch the stage that moved.
+static void ReportStageTimings(StageTimings* timings,
+                               TimingClock::time_point* last_report) {
+  if (timings->frames == 0 || MillisecondsSince(*last_report) < 1000.0) return;
+
+  const double inv_frames = 1.0 / timings->frames;
+  printf("timings: advance %.3fms, palette %.3fms, upload+draw %.3fms"
+         " (avg of %d frames)\n",
+         timings->advance_ms * inv_frames, timings->palette_ms * inv_frames,
+         timings->upload_ms * inv_frames, timings->frames);
+  *timings = StageTimings();
+  *last_report = TimingClock::now();
+}
+
 static const char* AnimLoadFn(const char* file_name, std::string* scratch_buf) {
   const bool load_ok = fplbase::LoadFile(file_name, scratch_buf);
   if (!load_ok) {
@@ -504,19 +541,28 @@ extern "C" int FPL_main(int argc, char* argv[]) {
   fplbase::InputSystem input;
   input.Initialize();
 
-  // Load animation file.
+  // Load the animation files on a background thread, like a streaming
+  // production setup would, so their I/O and parsing overlap the mesh and
+  // texture loads below. The table is not touched on this thread until the
+  // loader has been joined.
   fplbase::AssetManager asset_manager(renderer);
   motive::AnimTable anim_table;
+  bool anim_result = true;
+  std::thread anim_load_thread;
   if (args.anim_files.size() > 0) {
-    const bool anim_result =
-        anim_table.InitFromAnimFileNames(args.anim_files, AnimLoadFn);
-    if (!anim_result) return 1;
+    anim_load_thread = std::thread([&anim_table, &anim_result, &args]() {
+      anim_result = anim_table.InitFromAnimFileNames(args.anim_files,
+                                                     AnimLoadFn);
+    });
   }
 
   // Load mesh file.
   fplbase::Mesh* mesh = asset_manager.LoadMesh(args.mesh_file.c_str());
   if (!mesh) {
     printf("ERROR: Could not load mesh file `%s`\n\n", args.mesh_file.c_str());
+    if (anim_load_thread.joinable()) {
+      anim_load_thread.join();
+    }
     return 1;
   }
   asset_manager.StartLoadingTextures();
@@ -525,6 +571,12 @@ extern "C" int FPL_main(int argc, char* argv[]) {
   while (!asset_manager.TryFinalize()) {
   }
 
+  // Wait for the animations before we query the table.
+  if (anim_load_thread.joinable()) {
+    anim_load_thread.join();
+  }
+  if (!anim_result) return 1;
+
   // UX values.
   Camera camera(args.coordinate_system, AspectRatio(renderer),
                 mesh->min_position(), mesh->max_position());
@@ -604,6 +656,10 @@ extern "C" int FPL_main(int argc, char* argv[]) {
     fprintf(out_file, "%s", motivator.CsvHeaderForDebugging().c_str());
   }
 
+  StageTimings timings;
+  TimingClock::time_point last_report = TimingClock::now();
+  bool palette_dirty = true;
+
   while (!(input.exit_requested() ||
            input.GetButton(fplbase::FPLK_AC_BACK).went_down())) {
     const MotiveTime motive_delta_time =
@@ -629,7 +685,10 @@ extern "C" int FPL_main(int argc, char* argv[]) {
     input.AdvanceFrame(&renderer.window_size());
     if (animation_state == kAnimationStateAnimating ||
         animation_state == kAnimationStateStepOneFrame) {
+      const TimingClock::time_point advance_start = TimingClock::now();
       engine.AdvanceFrame(motive_delta_time);
+      timings.advance_ms += MillisecondsSince(advance_start);
+      palette_dirty = true;
 
       // Output debug information for this frame.
       if (out_file) {
@@ -649,22 +708,35 @@ extern "C" int FPL_main(int argc, char* argv[]) {
     mat4 mvp = CalculateMvp(camera);
 
     if (use_skinning) {
-      // If not animating, use default identity matrices.
-      if (animation_state != kAnimationStateNoAnimation) {
+      // Rebuild the bone palette only on frames where the animation
+      // advanced; `shader_transforms` persists across frames, so a paused
+      // viewer re-uploads the same palette without re-gathering it.
+      if (animation_state != kAnimationStateNoAnimation && palette_dirty) {
+        const TimingClock::time_point palette_start = TimingClock::now();
         mesh->GatherShaderTransforms(motivator.GlobalTransforms(),
                                      shader_transforms.data());
+        timings.palette_ms += MillisecondsSince(palette_start);
+        palette_dirty = false;
       }
+      const TimingClock::time_point upload_start = TimingClock::now();
       renderer.SetBoneTransforms(shader_transforms.data(),
                                  static_cast<int>(mesh->num_shader_bones()));
-    } else if (animation_state != kAnimationStateNoAnimation) {
-      // We're animating but there are no bones uniforms. Just move the
-      // root bone.
-      mvp *= mat4::FromAffineTransform(motivator.GlobalTransforms()[0]);
+      renderer.set_model_view_projection(mvp);
+      renderer.SetShader(shader);
+      renderer.Render(mesh);
+      timings.upload_ms += MillisecondsSince(upload_start);
+    } else {
+      if (animation_state != kAnimationStateNoAnimation) {
+        // We're animating but there are no bones uniforms. Just move the
+        // root bone.
+        mvp *= mat4::FromAffineTransform(motivator.GlobalTransforms()[0]);
+      }
+      renderer.set_model_view_projection(mvp);
+      renderer.SetShader(shader);
+      renderer.Render(mesh);
     }
-
-    renderer.set_model_view_projection(mvp);
-    renderer.SetShader(shader);
-    renderer.Render(mesh);
+    ++timings.frames;
+    ReportStageTimings(&timings, &last_report);
   }
 
   asset_manager.ClearAllAssets();